@@ -23,17 +23,20 @@
 //   extend this class later, if I choose to.  This sort of standardizes the
 //   delegate handling also, which is an added benefit.
 @class CS_service;
+@class CS_netReactor;
 @interface CS_basicIOConnection : NSObject <CS_basicIOConnectionDelegate>
 +(NSUInteger) ioBlockSize;
 +(NSUInteger) maximumPayload;
 -(id) initWithConnectionToService:(CS_service *) svc;
 -(id) initWithSocket:(int) fd;
+-(id) initWithSocket:(int) fd usingReactor:(CS_netReactor *) reactor;
 -(id) initLocalConnectionWithPort:(uint16_t) localPort;
 -(BOOL) connectWithError:(NSError **) err;
 -(NSTimeInterval) timeIntervalSinceConnection;
 -(BOOL) sendData:(NSData *) d withError:(NSError **) err;
 -(BOOL) hasDataForRead;
 -(BOOL) hasPendingIO;
+-(NSUInteger) pendingOutputLength;
 -(BOOL) isConnectionOKWithError:(NSError **) err;
 -(NSData *) checkForDataWithError:(NSError **) err;
 -(void) disconnect;
@@ -7,10 +7,12 @@
 //
 
 #include <sys/socket.h>
+#include <fcntl.h>
 #import "CS_basicIOConnection.h"
 #import "CS_serviceRadar.h"
 #import "ChatSeal.h"
 #import "CS_serviceResolved.h"
+#import "CS_netReactor.h"
 
 // - constants
 static const NSUInteger CS_BOI_READ_BLOCK_SIZE     = (16 * 1024);
@@ -28,7 +30,7 @@ typedef enum {
 
 
 // - forward declarations
-@interface CS_basicIOConnection (internal) <NSStreamDelegate, CS_serviceResolvedDelegate>
+@interface CS_basicIOConnection (internal) <NSStreamDelegate, CS_serviceResolvedDelegate, CS_netReactorTarget>
 -(BOOL) setErrorStateTo:(NSError *) err andReturnInValue:(NSError **) ret;
 -(void) configureReadStream:(CFReadStreamRef) readStream andWriteStream:(CFWriteStreamRef) writeStream;
 -(BOOL) tryToSendPendingDataWithError:(NSError **) err;
@@ -37,6 +39,11 @@ typedef enum {
 -(BOOL) sendUnlimitedData:(NSData *) d withError:(NSError **) err;
 -(BOOL) isStreamConnected:(NSStream *) stream;
 -(BOOL) sendRawData:(NSData *) d withError:(NSError **) err;
+-(BOOL) configureReactorSocketWithError:(NSError **) err;
+-(void) completeReactorOpen;
+-(BOOL) tryToReadSocketDataWithError:(NSError **) err;
+-(BOOL) extractPayloadsWithError:(NSError **) err;
+-(void) updateWriteInterest;
 @end
 
 /*************************
@@ -62,6 +69,10 @@ typedef enum {
     NSMutableArray             *maReadBlocks;
     NSUInteger                 totalDataToSend;
     NSUInteger                 dataSent;
+    CS_netReactor              *reactor;
+    int                        socketIO;
+    NSMutableData              *mdReadOverflow;
+    BOOL                       hasWriteInterest;
 }
 @synthesize delegate;
 
@@ -103,6 +114,10 @@ typedef enum {
         dataSent            = 0;
         mdPartialRead       = [[NSMutableData alloc] init];
         maReadBlocks        = [[NSMutableArray alloc] init];
+        reactor             = nil;
+        socketIO            = -1;
+        mdReadOverflow      = nil;
+        hasWriteInterest    = NO;
     }
     return self;
 }
@@ -139,6 +154,22 @@ typedef enum {
     return self;
 }
 
+/*
+ *  Initialize the object.
+ *  - a connection that uses the reactor reads and writes its socket directly as soon as it is
+ *    notified instead of going through a pair of streams.
+ */
+-(id) initWithSocket:(int) fd usingReactor:(CS_netReactor *) r
+{
+    self = [self initCommon];
+    if (self) {
+        socketExisting = fd;
+        reactor        = [r retain];
+        mdReadOverflow = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
 /*
  *  Initialize the object.
  */
@@ -178,6 +209,9 @@ typedef enum {
     [maReadBlocks release];
     maReadBlocks = nil;
     
+    [mdReadOverflow release];
+    mdReadOverflow = nil;
+    
     [super dealloc];
 }
 
@@ -213,6 +247,13 @@ typedef enum {
             return NO;
         }
     }
+    else if (reactor && socketExisting != -1) {
+        // - the reactor watches an existing socket without any streams.
+        if (![self configureReactorSocketWithError:&tmp]) {
+            [self setErrorStateTo:tmp andReturnInValue:err];
+            return NO;
+        }
+    }
     else {
         // - there are one of two options, either we have an existing socket or we're
         //   going to connect locally to a known port.
@@ -257,7 +298,19 @@ typedef enum {
     if (socketExisting != -1) {
         shutdown(socketExisting, SHUT_RDWR);
         close(socketExisting);
+        socketExisting = -1;
+    }
+    
+    // - a reactor socket must be unwatched before it is closed so that its number can be reused.
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(completeReactorOpen) object:nil];
+    if (socketIO != -1) {
+        [reactor unwatchDescriptor:socketIO];
+        shutdown(socketIO, SHUT_RDWR);
+        close(socketIO);
+        socketIO = -1;
     }
+    [reactor release];
+    reactor = nil;
 
     isRead.delegate = nil;
     [isRead removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
@@ -320,6 +373,14 @@ typedef enum {
     return NO;
 }
 
+/*
+ *  Return the number of bytes that have been sent, but are still waiting to be written.
+ */
+-(NSUInteger) pendingOutputLength
+{
+    return [mdPendingOutput length];
+}
+
 /*
  *  Determines if the connection is well-formed and usable.
  */
@@ -373,6 +434,11 @@ typedef enum {
 -(BOOL) isConnected
 {
     if ((connectionState == CS_BIO_CS_CONNECTED || connectionState == CS_BIO_CS_DATA) && !lastError) {
+        // - a reactor socket is usable until it is closed.
+        if (socketIO != -1) {
+            return YES;
+        }
+        
         // - more precise check using the stream itself, which is the final authority.
         if ([self isStreamConnected:isRead] && [self isStreamConnected:osWrite]) {
             return YES;
@@ -570,15 +636,32 @@ typedef enum {
     
     // - alright, try to send as much as possible.
     while ([mdPendingOutput length]) {
-        // - no capacity on the write end, then try again later.
-        if (![osWrite hasSpaceAvailable]) {
-            break;
+        NSInteger sentLength = 0;
+        if (socketIO != -1) {
+            // - the socket doesn't block, so it tells us when it is full.
+            sentLength = write(socketIO, mdPendingOutput.bytes, [mdPendingOutput length]);
+            if (sentLength == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                [CS_error fillError:err withCode:CSErrorNetworkWriteFailure andFailureReason:@"Unable to send data."];
+                return NO;
+            }
         }
-        
-        NSInteger sentLength = [osWrite write:(const uint8_t *) mdPendingOutput.bytes maxLength:[mdPendingOutput length]];
-        if (sentLength == -1) {
-            [CS_error fillError:err withCode:CSErrorNetworkWriteFailure andFailureReason:@"Unable to send data."];
-            return NO;
+        else {
+            // - no capacity on the write end, then try again later.
+            if (![osWrite hasSpaceAvailable]) {
+                break;
+            }
+            
+            sentLength = [osWrite write:(const uint8_t *) mdPendingOutput.bytes maxLength:[mdPendingOutput length]];
+            if (sentLength == -1) {
+                [CS_error fillError:err withCode:CSErrorNetworkWriteFailure andFailureReason:@"Unable to send data."];
+                return NO;
+            }
         }
         
         // - just not enough space, so don't worry about it.
@@ -608,6 +691,8 @@ typedef enum {
         dataSent = totalDataToSend = 0;
     }
     
+    // - a reactor socket only hears about free space while it has something to send.
+    [self updateWriteInterest];
     return YES;
 }
 
@@ -622,6 +707,11 @@ typedef enum {
         return NO;
     }
 
+    // - a reactor socket is read directly.
+    if (socketIO != -1) {
+        return [self tryToReadSocketDataWithError:err];
+    }
+    
     // - continue to read as long as there is content.
     while ([isRead hasBytesAvailable]) {
         if ([mdPartialRead length] - actualPartialCount < CS_BOI_READ_BLOCK_SIZE) {
@@ -641,50 +731,124 @@ typedef enum {
         }
         
         actualPartialCount += (NSUInteger) numRead;
+        if (![self extractPayloadsWithError:err]) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+/*
+ *  Save off every complete payload in the partial read buffer.
+ */
+-(BOOL) extractPayloadsWithError:(NSError **) err
+{
+    // - see if we have data buffers to save off.
+    BOOL addedData = NO;
+    uint8_t *buf   = [mdPartialRead mutableBytes];
+    while (actualPartialCount >= sizeof(uint32_t)) {
+        uint32_t len = ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | (uint32_t) buf[3];
+        // - this is serious and we need to abort right now.
+        if (len > CS_BIO_MAX_REQUEST_PAYLOAD) {
+            NSError *tmp = nil;
+            [CS_error fillError:&tmp withCode:CSErrorMaliciousActivity andFailureReason:@"Client protocol failure (1)."];
+            [self setErrorStateTo:tmp andReturnInValue:err];
+            [self disconnect];
+            return NO;
+        }
         
-        // - see if we have data buffers to save off.
-        BOOL addedData = NO;
-        while (actualPartialCount >= sizeof(uint32_t)) {
-            uint32_t len = ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | (uint32_t) buf[3];
-            // - this is serious and we need to abort right now.
-            if (len > CS_BIO_MAX_REQUEST_PAYLOAD) {
-                NSError *tmp = nil;
-                [CS_error fillError:&tmp withCode:CSErrorMaliciousActivity andFailureReason:@"Client protocol failure (1)."];
-                [self setErrorStateTo:tmp andReturnInValue:err];
-                [self disconnect];
-                return NO;
+        // - send the status update
+        NSUInteger bytesOfCurrent = actualPartialCount - sizeof(uint32_t);
+        if (bytesOfCurrent > len) {
+            bytesOfCurrent = len;
+        }
+        [self basicConnectionDataRecvProgress:self ofPct:[NSNumber numberWithFloat:len > 0.0f ? (float)bytesOfCurrent/(float)len : 100.0f]];
+        
+        // - not enough data yet.
+        if (actualPartialCount - sizeof(uint32_t) < len) {
+            break;
+        }
+        
+        // - save off a new buffer.
+        NSData *dSaved     = [NSData dataWithBytes:buf+sizeof(uint32_t) length:len];
+        [maReadBlocks addObject:dSaved];
+        addedData          = YES;
+        uint32_t toDiscard = sizeof(uint32_t) + len;
+        if (toDiscard < actualPartialCount) {
+            memmove(buf, buf+toDiscard, actualPartialCount-toDiscard);
+        }
+        actualPartialCount -= toDiscard;
+        [mdPartialRead setLength:actualPartialCount];
+    }
+    
+    //  -only send one of these notifications.
+    if (addedData) {
+        [self basicConnectionHasData:self];
+    }
+    return YES;
+}
+
+/*
+ *  Read everything that is available on a reactor socket.
+ *  - the socket is edge-triggered so we must continue until it would block or we won't hear about it again.
+ */
+-(BOOL) tryToReadSocketDataWithError:(NSError **) err
+{
+    for (;;) {
+        // - when the length of the current payload is known, the read is sized to finish it in one pass and
+        //   anything beyond it lands in the overflow.
+        NSUInteger toRead = CS_BOI_READ_BLOCK_SIZE;
+        if (actualPartialCount >= sizeof(uint32_t)) {
+            const uint8_t *buf = (const uint8_t *) [mdPartialRead bytes];
+            uint32_t len       = ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | (uint32_t) buf[3];
+            if (len <= CS_BIO_MAX_REQUEST_PAYLOAD && len + sizeof(uint32_t) > actualPartialCount + toRead) {
+                toRead = len + sizeof(uint32_t) - actualPartialCount;
             }
-            
-            // - send the status update
-            NSUInteger bytesOfCurrent = actualPartialCount - sizeof(uint32_t);
-            if (bytesOfCurrent > len) {
-                bytesOfCurrent = len;
+        }
+        if ([mdPartialRead length] < actualPartialCount + toRead) {
+            [mdPartialRead setLength:actualPartialCount + toRead];
+        }
+        
+        [mdReadOverflow setLength:0];
+        uint8_t *buf    = [mdPartialRead mutableBytes];
+        ssize_t numRead = [reactor readFromDescriptor:socketIO intoBuffer:buf + actualPartialCount ofLength:toRead withOverflow:mdReadOverflow];
+        if (numRead == -1) {
+            if (errno == EINTR) {
+                continue;
             }
-            [self basicConnectionDataRecvProgress:self ofPct:[NSNumber numberWithFloat:len > 0.0f ? (float)bytesOfCurrent/(float)len : 100.0f]];
-            
-            // - not enough data yet.
-            if (actualPartialCount - sizeof(uint32_t) < len) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;
             }
-            
-            // - save off a new buffer.
-            NSData *dSaved     = [NSData dataWithBytes:buf+sizeof(uint32_t) length:len];
-            [maReadBlocks addObject:dSaved];
-            addedData          = YES;
-            uint32_t toDiscard = sizeof(uint32_t) + len;
-            if (toDiscard < actualPartialCount) {
-                memmove(buf, buf+toDiscard, actualPartialCount-toDiscard);
+            [CS_error fillError:err withCode:CSErrorNetworkReadFailure andFailureReason:@"Failure to read data."];
+            return NO;
+        }
+        
+        // - no bytes read means the other side closed the connection.
+        if (numRead == 0) {
+            if (connectionState != CS_BIO_CS_CLOSED) {
+                [self markClosedConnection];
+                [self basicConnectionDisconnected:self];
             }
-            actualPartialCount -= toDiscard;
+            break;
+        }
+        
+        actualPartialCount += MIN((NSUInteger) numRead, toRead);
+        if ([mdReadOverflow length]) {
             [mdPartialRead setLength:actualPartialCount];
+            [mdPartialRead appendData:mdReadOverflow];
+            actualPartialCount += [mdReadOverflow length];
         }
         
-        //  -only send one of these notifications.
-        if (addedData) {
-            [self basicConnectionHasData:self];
+        if (![self extractPayloadsWithError:err]) {
+            return NO;
+        }
+        
+        // - the delegate may have disconnected while it was handling the data.
+        if (socketIO == -1) {
+            break;
         }
     }
-    
     return YES;
 }
 
@@ -781,4 +945,106 @@ typedef enum {
 {
     [self setErrorStateTo:err andReturnInValue:nil];
 }
+
+/*
+ *  Prepare an existing socket to be serviced by the reactor.
+ */
+-(BOOL) configureReactorSocketWithError:(NSError **) err
+{
+    int on = 1;
+    if (fcntl(socketExisting, F_SETFL, fcntl(socketExisting, F_GETFL, 0) | O_NONBLOCK) == -1 ||
+        setsockopt(socketExisting, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on)) == -1) {
+        [CS_error fillError:err withCode:CSErrorConnectionFailure andFailureReason:@"Failed to configure the socket."];
+        return NO;
+    }
+    
+    if (![reactor watchDescriptor:socketExisting forTarget:self withError:err]) {
+        return NO;
+    }
+    socketIO       = socketExisting;
+    socketExisting = -1;
+    
+    // - the socket is already open, but the delegate expects to hear about it after this returns, like with a stream.
+    connectionState = CS_BIO_CS_CONNECTED;
+    [self performSelector:@selector(completeReactorOpen) withObject:nil afterDelay:0.0f];
+    return YES;
+}
+
+/*
+ *  Let the delegate know that a reactor socket is ready for use.
+ *  - this may happen early if data arrives before the deferred notification.
+ */
+-(void) completeReactorOpen
+{
+    if (connectionState != CS_BIO_CS_CONNECTED) {
+        return;
+    }
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(completeReactorOpen) object:nil];
+    
+    [[self retain] autorelease];
+    [self basicConnectionConnected:self];
+    if (connectionState != CS_BIO_CS_CONNECTED) {
+        return;
+    }
+    
+    connectionState = CS_BIO_CS_DATA;
+    NSError *tmp    = nil;
+    if (![self tryToSendPendingDataWithError:&tmp]) {
+        [self setErrorStateTo:tmp andReturnInValue:nil];
+    }
+}
+
+/*
+ *  Only ask for write notifications when the socket couldn't take everything we had.
+ */
+-(void) updateWriteInterest
+{
+    if (socketIO == -1) {
+        return;
+    }
+    
+    BOOL isInterested = [mdPendingOutput length] ? YES : NO;
+    if (isInterested != hasWriteInterest) {
+        [reactor setWriteInterest:isInterested forDescriptor:socketIO];
+        hasWriteInterest = isInterested;
+    }
+}
+
+/*
+ *  The reactor socket has data or was closed.
+ */
+-(void) reactor:(CS_netReactor *) r descriptorIsReadable:(int) fd withAvailable:(NSUInteger) numAvail atEnd:(BOOL) isAtEnd
+{
+    // - the delegate could release this object while handling the data.
+    [[self retain] autorelease];
+    if (fd != socketIO) {
+        return;
+    }
+    
+    [self completeReactorOpen];
+    if (connectionState != CS_BIO_CS_DATA) {
+        return;
+    }
+    
+    NSError *tmp = nil;
+    if (![self tryToReadIncomingDataWithError:&tmp]) {
+        [self setErrorStateTo:tmp andReturnInValue:nil];
+    }
+}
+
+/*
+ *  The reactor socket has room for more output.
+ */
+-(void) reactor:(CS_netReactor *) r descriptorIsWritable:(int) fd
+{
+    [[self retain] autorelease];
+    if (fd != socketIO) {
+        return;
+    }
+    
+    NSError *tmp = nil;
+    if (![self tryToSendPendingDataWithError:&tmp]) {
+        [self setErrorStateTo:tmp andReturnInValue:nil];
+    }
+}
 @end
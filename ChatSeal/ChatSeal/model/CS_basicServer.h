@@ -23,6 +23,7 @@
 //   delegate handling also, which is an added benefit.
 @interface CS_basicServer : NSObject <CS_basicServerDelegate>
 -(id) initWithPort:(uint16_t) port;
+-(id) initWithPort:(uint16_t) port asEventDriven:(BOOL) eventDriven;
 -(BOOL) startServerWithError:(NSError **) err;
 -(uint16_t) serverPort;
 -(void) stopServer;
@@ -8,18 +8,25 @@
 
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <fcntl.h>
 #include <dns_sd.h>
 #import "CS_basicServer.h"
 #import "ChatSeal.h"
 #import "CS_basicIOConnection.h"
+#import "CS_netReactor.h"
+
+// - constants
+static const int            CS_BS_LISTEN_BACKLOG = 128;
+static const NSTimeInterval CS_BS_ACCEPT_TIMER   = 0.5f;
 
 // - forward declarations
-@interface CS_basicServer (internal)
+@interface CS_basicServer (internal) <CS_netReactorTarget>
 -(int) socketForV4:(BOOL) isV4 andPort:(uint16_t) port withError:(NSError **) err;
 -(BOOL) socketHasContent:(int) sock;
 -(int) nonBlockingAcceptOnSocket:(int) sock asV4:(BOOL) isV4;
 -(void) cleanSocketShutdown:(int) sock;
 -(void) serverAcceptTimer;
+-(void) acceptPendingConnections;
 @end
 
 /************************
@@ -30,10 +37,12 @@
  *  Object attributes
  */
 {
-    uint16_t serverPort;
-    int      sockV4;
-    int      sockV6;
-    NSTimer  *tmAcceptTimer;
+    uint16_t      serverPort;
+    int           sockV4;
+    int           sockV6;
+    NSTimer       *tmAcceptTimer;
+    BOOL          isEventDriven;
+    CS_netReactor *reactor;
 }
 @synthesize delegate;
 
@@ -41,6 +50,16 @@
  *  Initialize the object.
  */
 -(id) initWithPort:(uint16_t)port
+{
+    return [self initWithPort:port asEventDriven:YES];
+}
+
+/*
+ *  Initialize the object.
+ *  - an event-driven server accepts connections as soon as they arrive and services them with the
+ *    network reactor instead of streams.  The other kind only checks when its timer fires.
+ */
+-(id) initWithPort:(uint16_t) port asEventDriven:(BOOL) eventDriven
 {
     self = [super init];
     if (self) {
@@ -49,6 +68,8 @@
         sockV4        = -1;
         sockV6        = -1;
         tmAcceptTimer = nil;
+        isEventDriven = eventDriven;
+        reactor       = nil;
     }
     return self;
 }
@@ -100,8 +121,23 @@
         return NO;
     }
     
+    // - the reactor reports new connections immediately, but the timer is still used to pick up any
+    //   that were deferred by the delegate and to give the delegate its regular processing time.
+    if (isEventDriven) {
+        reactor = [[CS_netReactor reactorForCurrentRunLoop] retain];
+        if (!reactor ||
+            ![reactor watchDescriptor:sockV4 forTarget:self withError:err] ||
+            ![reactor watchDescriptor:sockV6 forTarget:self withError:err]) {
+            if (!reactor) {
+                [CS_error fillError:err withCode:CSErrorSecureServiceNotEnabled andFailureReason:@"Failed to create the network reactor."];
+            }
+            [self stopServer];
+            return NO;
+        }
+    }
+    
     // - and start the accept timer.
-    tmAcceptTimer = [[NSTimer timerWithTimeInterval:0.5f target:self selector:@selector(serverAcceptTimer) userInfo:nil repeats:YES] retain];
+    tmAcceptTimer = [[NSTimer timerWithTimeInterval:CS_BS_ACCEPT_TIMER target:self selector:@selector(serverAcceptTimer) userInfo:nil repeats:YES] retain];
     [[NSRunLoop currentRunLoop] addTimer:tmAcceptTimer forMode:NSRunLoopCommonModes];
     
     return YES;
@@ -125,6 +161,17 @@
     [tmAcceptTimer release];
     tmAcceptTimer = nil;
     
+    if (reactor) {
+        if (sockV4 != -1) {
+            [reactor unwatchDescriptor:sockV4];
+        }
+        if (sockV6 != -1) {
+            [reactor unwatchDescriptor:sockV6];
+        }
+        [reactor release];
+        reactor = nil;
+    }
+    
     [self cleanSocketShutdown:sockV4];
     sockV4   = -1;
     [self cleanSocketShutdown:sockV6];
@@ -260,7 +307,15 @@
         return -1;
     }
     
-    if (listen(sockFD, 16) != 0) {
+    // - an event-driven server drains the backlog until it would block, so its listening sockets must not.
+    if (isEventDriven && fcntl(sockFD, F_SETFL, fcntl(sockFD, F_GETFL, 0) | O_NONBLOCK) == -1) {
+        [self cleanSocketShutdown:sockFD];
+        NSString *failReason = [NSString stringWithFormat:@"Failed to make the %@ server socket non-blocking.", isV4 ? @"v4" : @"v6"];
+        [CS_error fillError:err withCode:CSErrorSecureServiceNotEnabled andFailureReason:failReason];
+        return -1;
+    }
+    
+    if (listen(sockFD, CS_BS_LISTEN_BACKLOG) != 0) {
         [self cleanSocketShutdown:sockFD];
         NSString *failReason = [NSString stringWithFormat:@"Failed to listen on the %@ server socket.", isV4 ? @"v4" : @"v6"];
         [CS_error fillError:err withCode:CSErrorSecureServiceNotEnabled andFailureReason:failReason];
@@ -298,7 +353,8 @@
  */
 -(int) nonBlockingAcceptOnSocket:(int) sock asV4:(BOOL) isV4;
 {
-    if (![self socketHasContent:sock]) {
+    // - the event-driven sockets don't block, so there is no reason to check them first.
+    if (sock == -1 || (!isEventDriven && ![self socketHasContent:sock])) {
         return -1;
     }
     
@@ -335,6 +391,17 @@
  *    app that they occur in a very predictable way an often in a serialized manner.
  */
 -(void) serverAcceptTimer
+{
+    [self acceptPendingConnections];
+    
+    // - make sure the delegate knows we just completed another pass of the server processing.
+    [self acceptProcessingCompletedInServer:self];
+}
+
+/*
+ *  Pull every waiting connection off of the listening sockets.
+ */
+-(void) acceptPendingConnections
 {
     // - figure out if an existing client requires more time.
     if ([self shouldCheckForNewConnectionsInServer:self]) {
@@ -361,7 +428,13 @@
             // - if we need to accept the connection, we must then build an object to
             //   contain it.
             if (shouldAccept) {
-                CS_basicIOConnection *bio = [[[CS_basicIOConnection alloc] initWithSocket:newSock] autorelease];
+                CS_basicIOConnection *bio = nil;
+                if (isEventDriven) {
+                    bio = [[[CS_basicIOConnection alloc] initWithSocket:newSock usingReactor:reactor] autorelease];
+                }
+                else {
+                    bio = [[[CS_basicIOConnection alloc] initWithSocket:newSock] autorelease];
+                }
                 [self connectionReceived:bio inServer:self];
                 
             }
@@ -371,9 +444,16 @@
             }
         }
     }
-    
-    // - make sure the delegate knows we just completed another pass of the server processing.
-    [self acceptProcessingCompletedInServer:self];
+}
+
+/*
+ *  The reactor has detected new connections on one of the listening sockets.
+ *  - the sockets are edge-triggered, so anything the delegate doesn't want now stays in the backlog
+ *    until the timer tries again.
+ */
+-(void) reactor:(CS_netReactor *) r descriptorIsReadable:(int) fd withAvailable:(NSUInteger) numAvail atEnd:(BOOL) isAtEnd
+{
+    [self acceptPendingConnections];
 }
 
 @end
@@ -20,6 +20,7 @@
 +(NSString *) processedMessageEntryForHash:(NSString *) msgHash;
 +(BOOL) hasProcessedMessageEntry:(NSString *) entryId;
 +(void) discardProcessedMessageEntry:(NSString *) entryId;
++(void) closeProcessedMessageEntries;
 +(UIImage *) imagePlaceholderForBase:(NSString *) baseName andMessage:(NSString *) mid usingSeal:(RSISecureSeal *) seal;
 +(void) saveImage:(UIImage *) img asPlaceholderForBase:(NSString *) baseName andMessage:(NSString *) mid usingSeal:(RSISecureSeal *) seal;
 +(void) discardPlaceholderForBase:(NSString *) baseName andMessage:(NSString *) mid;
@@ -10,6 +10,9 @@
 #import "CS_diskCache.h"
 #import "CS_messageIndex.h"
 #import "CS_error.h"
+#import "CS_image.h"
+#import "CS_processedEntryCache.h"
+#import "CS_cacheMessageTable.h"
 
 // - constants
 static NSString *CS_MSGCACHE_CATEGORY = @"messages";
@@ -21,25 +24,27 @@ static NSString *CS_SYNOPIS_KEY       = @"synopsis";
 static NSString *CS_SALT_KEY          = @"salt";
 static NSString *CS_IDXCACHE_CATEGORY = @"indices";
 static NSString *CS_ISREAD_KEY        = @"isread";
-static NSString *CS_PROC_IDS          = @"mproc";
+static NSString *CS_PROC_IDS          = @"mproc";                 //  the original archive, which is imported once.
+static NSString *CS_PROC_STORE        = @"mproc-store";
 static NSString *CS_PLACEHOLDER_KEY   = @"phold";
 static NSString *CS_AUTHOR_KEY        = @"author";
 static NSString *CS_FEED_KEY          = @"feed";
+static NSString *CS_PLACEHOLDER_IMG   = @"msg-placeholder/";
 
 // - local data
-static NSMutableArray       *maMessageIds              = nil;
-static NSMutableDictionary  *mdMessages                = nil;
-static BOOL                 isValidated                = NO;
-static BOOL                 processedLoaded            = NO;
-static NSMutableDictionary  *mdProcessedMessageEntries = nil;
+static CS_cacheMessageTable   *cmtMessages  = nil;
+static BOOL                   isValidated   = NO;
+static CS_processedEntryCache *pecProcessed = nil;
 
 // - forward declarations
 @interface CS_cacheMessage (internal) <NSCoding>
 -(void) regenerateSalt;
 -(BOOL) hasGoodSalt;
 +(NSString *) categoryForMessageItem:(NSString *) mid;
-+(void) loadProcessedMessageEntryCache;
-+(void) saveProcessedMessageEntryCache;
++(BOOL) openProcessedMessageEntryCache;
++(void) importLegacyProcessedMessageEntries;
++(NSString *) placeholderImageKeyPrefixForMessage:(NSString *) mid;
++(NSString *) placeholderImageKeyForBase:(NSString *) baseName andMessage:(NSString *) mid;
 @end
 
 // - shared with the general-purpose message infrastructure to
@@ -84,9 +89,8 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(void) initialize
 {
-    maMessageIds              = [[NSMutableArray alloc] init];
-    mdMessages                = [[NSMutableDictionary alloc] init];
-    mdProcessedMessageEntries = [[NSMutableDictionary alloc] init];
+    cmtMessages  = [[CS_cacheMessageTable alloc] init];
+    pecProcessed = [[CS_processedEntryCache alloc] initWithBaseName:CS_PROC_STORE];
 }
 
 /*
@@ -94,20 +98,17 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(void) releaseAllCachedContent
 {
-    @synchronized (maMessageIds) {
-        [maMessageIds removeAllObjects];
-        [mdMessages removeAllObjects];
-    }
+    [cmtMessages removeAllMessages];
+    [CS_image discardCachedImagesWithKeyPrefix:CS_PLACEHOLDER_IMG];
 }
 
 /*
  *  Return a reference to the cached list of messages.
+ *  - the list is an immutable snapshot in creation date order.
  */
 +(NSArray *) messageList
 {
-    @synchronized (maMessageIds) {
-        return [NSArray arrayWithArray:maMessageIds];
-    }
+    return [cmtMessages sortedMessageIds];
 }
 
 /*
@@ -115,9 +116,7 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(NSUInteger) messageCount
 {
-    @synchronized (maMessageIds) {
-        return [maMessageIds count];
-    }
+    return [cmtMessages count];
 }
 
 /*
@@ -125,16 +124,7 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(NSArray *) messageItemList
 {
-    @synchronized (maMessageIds) {
-        NSMutableArray *maRet = [NSMutableArray array];
-        for (NSString *mid in maMessageIds) {
-            CS_cacheMessage *cm = [mdMessages objectForKey:mid];
-            if (cm) {
-                [maRet addObject:cm];
-            }
-        }
-        return maRet;
-    }
+    return [cmtMessages sortedMessages];
 }
 
 /*
@@ -142,9 +132,7 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(CS_cacheMessage *) messageForId:(NSString *) mid
 {
-    @synchronized (maMessageIds) {
-        return [[[mdMessages objectForKey:mid] retain] autorelease];
-    }
+    return [cmtMessages messageForId:mid];
 }
 
 /*
@@ -158,10 +146,23 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return;
     }
     
-    @synchronized (mdProcessedMessageEntries) {
-        [CS_cacheMessage loadProcessedMessageEntryCache];
-        [mdProcessedMessageEntries setObject:entryId forKey:msgHash];
-        [CS_cacheMessage saveProcessedMessageEntryCache];
+    // - each change is appended to the store on its own, so this is a cheap operation no matter how many
+    //   entries have been processed before.
+    @synchronized (pecProcessed) {
+        NSError *err = nil;
+        if ([CS_cacheMessage openProcessedMessageEntryCache] && ![pecProcessed setEntry:entryId forHash:msgHash withError:&err]) {
+            NSLog(@"CS:  Failed to save the processed entry.  %@", [err localizedDescription]);
+        }
+    }
+}
+
+/*
+ *  Close the processed entry store, which forgets its key until the vault is opened again.
+ */
++(void) closeProcessedMessageEntries
+{
+    @synchronized (pecProcessed) {
+        [pecProcessed close];
     }
 }
 
@@ -174,9 +175,11 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return nil;
     }
     
-    @synchronized (mdProcessedMessageEntries) {
-        [CS_cacheMessage loadProcessedMessageEntryCache];
-        return [mdProcessedMessageEntries objectForKey:msgHash];
+    @synchronized (pecProcessed) {
+        if (![CS_cacheMessage openProcessedMessageEntryCache]) {
+            return nil;
+        }
+        return [pecProcessed entryForHash:msgHash];
     }
 }
 
@@ -192,10 +195,11 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return NO;
     }
     
-    @synchronized (mdProcessedMessageEntries) {
-        [CS_cacheMessage loadProcessedMessageEntryCache];
-        NSArray *arr = [mdProcessedMessageEntries allKeysForObject:entryId];
-        return (arr && [arr count] ? YES : NO);
+    @synchronized (pecProcessed) {
+        if (![CS_cacheMessage openProcessedMessageEntryCache]) {
+            return NO;
+        }
+        return [pecProcessed hasEntry:entryId];
     }
 }
 
@@ -208,18 +212,18 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return;
     }
     
-    @synchronized (mdProcessedMessageEntries) {
-        [CS_cacheMessage loadProcessedMessageEntryCache];
-        NSArray *arr = [mdProcessedMessageEntries allKeysForObject:entryId];
-        if (arr && [arr count]) {
-            [mdProcessedMessageEntries removeObjectsForKeys:arr];
-            [CS_cacheMessage saveProcessedMessageEntryCache];
+    @synchronized (pecProcessed) {
+        NSError *err = nil;
+        if ([CS_cacheMessage openProcessedMessageEntryCache] && ![pecProcessed discardEntry:entryId withError:&err]) {
+            NSLog(@"CS:  Failed to discard the processed entry.  %@", [err localizedDescription]);
         }
     }
 }
 
 /*
  *  Try to locate an image placeholder, which is the blurred version of a message item image.
+ *  - the decoded placeholder is kept in memory because the same ones are requested every time a
+ *    conversation is scrolled.
  */
 +(UIImage *) imagePlaceholderForBase:(NSString *) baseName andMessage:(NSString *) mid usingSeal:(RSISecureSeal *) seal
 {
@@ -227,7 +231,12 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return nil;
     }
     
-    UIImage *img = nil;
+    NSString *sImageKey = [CS_cacheMessage placeholderImageKeyForBase:baseName andMessage:mid];
+    UIImage *img        = [CS_image cachedImageForKey:sImageKey];
+    if (img) {
+        return img;
+    }
+    
     @autoreleasepool {
         NSObject *obj = [CS_diskCache cachedDataWithBaseName:baseName andCategory:[CS_cacheMessage categoryForMessageItem:mid]];
         if (!obj || ![obj isKindOfClass:[NSData class]]) {
@@ -242,7 +251,12 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         
         obj = [dict objectForKey:CS_PLACEHOLDER_KEY];
         if (obj && [obj isKindOfClass:[NSData class]]) {
-            img = [[UIImage imageWithData:(NSData *) obj] retain];
+            img = [CS_image loadJPGImmediatelyWithData:(NSData *) obj withError:nil];
+            if (!img) {
+                img = [UIImage imageWithData:(NSData *) obj];
+            }
+            [CS_image cacheImage:img forKey:sImageKey];
+            [img retain];
         }
     }
     return [img autorelease];
@@ -268,6 +282,9 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         NSLog(@"CS:  Failed to encrypt placeholder content.  %@", [err localizedDescription]);
     }
     [CS_diskCache saveCachedData:dEncrypted withBaseName:baseName andCategory:[CS_cacheMessage categoryForMessageItem:mid]];
+    if (dEncrypted) {
+        [CS_image cacheImage:img forKey:[CS_cacheMessage placeholderImageKeyForBase:baseName andMessage:mid]];
+    }
 }
 
 /*
@@ -275,6 +292,7 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(void) discardPlaceholderForBase:(NSString *) baseName andMessage:(NSString *) mid
 {
+    [CS_image discardCachedImagesWithKeyPrefix:[CS_cacheMessage placeholderImageKeyForBase:baseName andMessage:mid]];
     [CS_diskCache invalidateCacheItemWithBaseName:baseName andCategory:[CS_cacheMessage categoryForMessageItem:mid]];
 }
 
@@ -461,54 +479,47 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
 }
 
 /*
- *  Attempt to load all the processed message entries from disk if they haven't been loaded yet.
+ *  Return the prefix shared by all the in-memory placeholder images for a message.
+ */
++(NSString *) placeholderImageKeyPrefixForMessage:(NSString *) mid
+{
+    return [NSString stringWithFormat:@"%@%@/", CS_PLACEHOLDER_IMG, mid];
+}
+
+/*
+ *  Return the key used to keep a decoded placeholder image in memory.
+ */
++(NSString *) placeholderImageKeyForBase:(NSString *) baseName andMessage:(NSString *) mid
+{
+    return [NSString stringWithFormat:@"%@%@", [CS_cacheMessage placeholderImageKeyPrefixForMessage:mid], baseName];
+}
+
+/*
+ *  Open the processed message entry store if it hasn't been opened yet.
  *  - even though this is a cache, it is one that we don't want to be deleted to recover space, so
  *    it will be in the normal vault.
+ *  - the store is only read a little at a time when it is queried, so opening it is quick regardless of its size.
  */
-+(void) loadProcessedMessageEntryCache
++(BOOL) openProcessedMessageEntryCache
 {
-    if (processedLoaded) {
-        return;
+    if ([pecProcessed isOpen]) {
+        return YES;
     }
     
-    //  - don't release the old content because a crypto error could cause the on-disk file from
-    //    being loaded and we'll attempt to not overwrite is needlessly.
     NSError *err = nil;
-    NSURL *u = [RealSecureImage absoluteURLForVaultFile:CS_PROC_IDS withError:&err];
-    if (!u) {
-        NSLog(@"CS:  Failed to generate a vault name for processed ids.  %@", [err localizedDescription]);
-        return;
-    }
-    
-    // - if the file exists, attempt to load it into the dictionary.
-    if ([[NSFileManager defaultManager] fileExistsAtPath:[u path]]) {
-        RSISecureData *secD = nil;
-        if ([RealSecureImage readVaultURL:u intoData:&secD withError:&err]) {
-            NSObject *obj = nil;
-            @try {
-                obj = [NSKeyedUnarchiver unarchiveObjectWithData:secD.rawData];
-            }
-            @catch (NSException *exception) {
-                NSLog(@"CS:  The message cache archive caused an exception.  %@", [exception description]);
-            }
-            if (obj) {
-                if ([obj isKindOfClass:[NSDictionary class]]) {
-                    [mdProcessedMessageEntries addEntriesFromDictionary:(NSDictionary *) obj];
-                }
-            }
-        }
-        else {
-            NSLog(@"CS:  Failed to read the processed ids file.  %@", [err localizedDescription]);
-            return;         //  we don't assume it is loaded here because it could have been a crypto error due to out of space.
-        }
+    if (![pecProcessed openWithError:&err]) {
+        NSLog(@"CS:  Failed to open the processed ids store.  %@", [err localizedDescription]);
+        return NO;
     }
-    processedLoaded = YES;
+    [CS_cacheMessage importLegacyProcessedMessageEntries];
+    return YES;
 }
 
 /*
- *  Attempt to save all the procssed message entries in memory to disk.
+ *  The processed entries used to be saved as a single keyed archive that was rewritten with every change.  If that
+ *  file still exists, move its content into the store.
  */
-+(void) saveProcessedMessageEntryCache
++(void) importLegacyProcessedMessageEntries
 {
     NSError *err = nil;
     NSURL *u = [RealSecureImage absoluteURLForVaultFile:CS_PROC_IDS withError:&err];
@@ -516,25 +527,44 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         NSLog(@"CS:  Failed to generate a vault name for processed ids.  %@", [err localizedDescription]);
         return;
     }
+    if (![[NSFileManager defaultManager] fileExistsAtPath:[u path]]) {
+        return;
+    }
     
-    // - create an archive to save.
-    NSData *d = nil;
+    //  - when the file can't be read, it is left alone because it could have been a crypto error due to out of space.
+    RSISecureData *secD = nil;
+    if (![RealSecureImage readVaultURL:u intoData:&secD withError:&err]) {
+        NSLog(@"CS:  Failed to read the processed ids file.  %@", [err localizedDescription]);
+        return;
+    }
+    
+    NSObject *obj = nil;
     @try {
-        d = [NSKeyedArchiver archivedDataWithRootObject:mdProcessedMessageEntries];
+        obj = [NSKeyedUnarchiver unarchiveObjectWithData:secD.rawData];
     }
     @catch (NSException *exception) {
-        NSLog(@"CS:  The message cache archive generated an exception.  %@", [exception description]);
-    }
-    if (!d) {
-        return;
+        NSLog(@"CS:  The message cache archive caused an exception.  %@", [exception description]);
+    }
+    if (obj && [obj isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *dict = (NSDictionary *) obj;
+        for (NSString *msgHash in dict) {
+            NSObject *entryId = [dict objectForKey:msgHash];
+            if (![msgHash isKindOfClass:[NSString class]] || ![entryId isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            if (![pecProcessed setEntry:(NSString *) entryId forHash:msgHash withError:&err]) {
+                NSLog(@"CS:  Failed to import the processed ids.  %@", [err localizedDescription]);
+                return;
+            }
+        }
+        if (![pecProcessed compactWithError:&err]) {
+            NSLog(@"CS:  Failed to compact the imported processed ids.  %@", [err localizedDescription]);
+            return;
+        }
     }
     
-    // - this happens atomically, so a failure to write is actually OK because the prior content will
-    //   remain.
-    // - cache consistency here isn't a priority because it will just require extra work next time to rule out
-    //   the message.
-    if (![RealSecureImage writeVaultData:d toURL:u withError:&err]) {
-        NSLog(@"CS:  Failed to save the processed ids cache.  %@", [err localizedDescription]);
+    if (![[NSFileManager defaultManager] removeItemAtURL:u error:&err]) {
+        NSLog(@"CS:  Failed to remove the original processed ids file.  %@", [err localizedDescription]);
     }
 }
 
@@ -550,14 +580,13 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(BOOL) isValidated
 {
-    @synchronized (maMessageIds) {
+    @synchronized (cmtMessages) {
         if (isValidated) {
             return YES;
         }
         
         // - determine if there is on-disk content that we can use.
-        [maMessageIds removeAllObjects];
-        [mdMessages removeAllObjects];
+        [cmtMessages removeAllMessages];
         NSObject *obj = [CS_diskCache secureCachedDataWithBaseName:CS_MSGLIST_BASE andCategory:CS_MSGCACHE_CATEGORY];
         if (obj && [obj isKindOfClass:[NSArray class]] && [(NSArray *) obj count] == 3) {
             NSArray *arr = (NSArray *) obj;
@@ -569,9 +598,8 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
                 NSNumber *nEpoch = [arr objectAtIndex:0];
                 if (nEpoch.integerValue == [ChatSeal cacheEpoch]) {
                     NSArray      *arrIds = [arr objectAtIndex:1];
-                    [maMessageIds addObjectsFromArray:arrIds];
                     NSDictionary *mdMsgs = [arr objectAtIndex:2];
-                    [mdMessages addEntriesFromDictionary:mdMsgs];
+                    [cmtMessages replaceAllWithMessages:mdMsgs inOrder:arrIds];
                     isValidated = YES;
                     return YES;
                 }
@@ -592,10 +620,10 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(void) saveCache
 {
-    @synchronized (maMessageIds) {
+    @synchronized (cmtMessages) {
         // - save both items because the array has the messages in sorted order.
-        NSArray *arr = [NSArray arrayWithObjects:[NSNumber numberWithInteger:[ChatSeal cacheEpoch]], maMessageIds, mdMessages, nil];
-        if (![CS_diskCache saveSecureCachedData:arr withBaseName:CS_MSGLIST_BASE andCategory:CS_MSGCACHE_CATEGORY]) {
+        NSArray *arr = [NSArray arrayWithObjects:[NSNumber numberWithInteger:[ChatSeal cacheEpoch]], [cmtMessages sortedMessageIds], [cmtMessages messagesById], nil];
+        if (![CS_diskCache saveSecureCachedData:arr withBaseName:CS_MSGLIST_BASE andCategory:CS_MSGCACHE_CATEGORY andWaitForWrite:YES]) {
             // - when the message cache cannot be saved, then it is deleted on disk and the associated indices
             //   are also invalid because their salt values will be out of date the next time the app starts up.
             //   This is unfortunately the side-effect of the approach we use here to optimize cache accesses.
@@ -607,30 +635,16 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
 
 /*
  *  Cache the new message item.
+ *  - the item's creation date must be assigned first because that is how it is ordered.
  */
 +(void) cacheItem:(CS_cacheMessage *) newItem
 {
-    @synchronized (maMessageIds) {
-        NSString *mid = [newItem messageId];
-        if (!newItem || !mid) {
-            return;
-        }
-        
-        // - create the arrays if they don't exist.
-        if (!maMessageIds) {
-            maMessageIds = [[NSMutableArray alloc] init];
-        }
-        
-        if (!mdMessages) {
-            mdMessages = [[NSMutableDictionary alloc] init];
-        }
-        
-        // - add/overwrite the content as necessary.
-        if ([maMessageIds indexOfObject:mid] == NSNotFound) {
-            [maMessageIds addObject:mid];
-        }
-        [mdMessages setObject:newItem forKey:mid];
+    if (!newItem || ![newItem messageId]) {
+        return;
     }
+    
+    // - add/overwrite the content as necessary.
+    [cmtMessages cacheMessage:newItem];
 }
 
 /*
@@ -638,10 +652,8 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
  */
 +(void) discardCachedMessage:(NSString *) mid
 {
-    @synchronized (maMessageIds) {
-        [maMessageIds removeObject:mid];
-        [mdMessages removeObjectForKey:mid];        
-    }
+    [cmtMessages removeMessageForId:mid];
+    [CS_image discardCachedImagesWithKeyPrefix:[CS_cacheMessage placeholderImageKeyPrefixForMessage:mid]];
     [CS_diskCache invalidateCacheItemWithBaseName:mid andCategory:CS_IDXCACHE_CATEGORY];
     [CS_diskCache invalidateCacheCategory:[CS_cacheMessage categoryForMessageItem:mid]];
 }
@@ -681,15 +693,18 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
 
 /*
  *  Assign the date the message was created.
+ *  - the message table is ordered by this date, so it has to move the message when it is cached.
  */
 -(void) setDateCreated:(NSDate *)newDC
 {
-    @synchronized (self) {
-        if (dateCreated != newDC) {
-            [dateCreated release];
-            dateCreated = [newDC retain];
+    [cmtMessages reorderMessage:self whileChangingDate:^(void) {
+        @synchronized (self) {
+            if (dateCreated != newDC) {
+                [dateCreated release];
+                dateCreated = [newDC retain];
+            }
         }
-    }
+    }];
 }
 
 /*
@@ -773,12 +788,12 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
         return;
     }
     
-    @synchronized (maMessageIds) {
+    @synchronized (cmtMessages) {
         BOOL shouldSave = NO;
         
         // - for every message that matches the seal, we are going to discard all of the cultivated information to
         //   completely wipe it.
-        for (CS_cacheMessage *cm in mdMessages.allValues) {
+        for (CS_cacheMessage *cm in [cmtMessages sortedMessages]) {
             if ([sealId isEqualToString:cm.seal.sealId]) {
                 // -  if the seal is no longer in the seal cache, we need to break
                 //    that connection because the seal cache never references a seal
@@ -793,6 +808,7 @@ static NSMutableDictionary  *mdProcessedMessageEntries = nil;
                 [cm setDefaultFeed:nil];
                 [cm setIsRead:YES];
                 [cm regenerateIndexWithStringArray:[NSArray array]];
+                [CS_image discardCachedImagesWithKeyPrefix:[CS_cacheMessage placeholderImageKeyPrefixForMessage:cm.messageId]];
                 shouldSave = YES;
             }
         }
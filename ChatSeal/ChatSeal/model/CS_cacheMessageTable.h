@@ -0,0 +1,28 @@
+//
+//  CS_cacheMessageTable.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CS_cacheMessage;
+
+// - the message table holds the cached messages by id and in creation date order.
+// - lookups by id are spread over independently locked stripes so that they never wait on one another or on
+//   the ordered lists.
+// - the ordered lists are immutable snapshots that are shared by every caller until the next change.
+@interface CS_cacheMessageTable : NSObject
+-(CS_cacheMessage *) messageForId:(NSString *) mid;
+-(void) cacheMessage:(CS_cacheMessage *) cm;
+-(void) removeMessageForId:(NSString *) mid;
+-(void) removeAllMessages;
+-(void) replaceAllWithMessages:(NSDictionary *) dictMessages inOrder:(NSArray *) arrIds;
+-(void) reorderMessage:(CS_cacheMessage *) cm whileChangingDate:(void (^)(void)) changeBlock;
+-(NSArray *) sortedMessageIds;
+-(NSArray *) sortedMessages;
+-(NSDictionary *) messagesById;
+-(NSUInteger) count;
+@end
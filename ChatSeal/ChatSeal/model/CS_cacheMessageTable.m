@@ -0,0 +1,381 @@
+//
+//  CS_cacheMessageTable.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_cacheMessageTable.h"
+#import "CS_cacheMessage.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - every change takes the order lock first and then the lock for the one stripe it affects, which keeps the
+//    stripes and the ordered lists consistent with one another.  Lookups by id take only their stripe's lock and
+//    readers of the ordered lists take only the order lock, and only long enough to retain the current snapshot.
+
+// - constants
+#define CMT_NUM_STRIPES 16                          //  must be a power of two.
+
+// - forward declarations
+@interface CS_cacheMessageTable (internal)
+-(NSMutableDictionary *) stripeForId:(NSString *) mid;
++(NSDate *) sortDateForMessage:(CS_cacheMessage *) cm;
+-(NSUInteger) insertionIndexForDate:(NSDate *) dt;
+-(void) removeFromOrderWithoutLock:(CS_cacheMessage *) cm;
+-(void) insertIntoOrderWithoutLock:(CS_cacheMessage *) cm;
+-(void) assertOrderAroundIndex:(NSUInteger) idx;
+-(void) discardSnapshotsWithoutLock;
+@end
+
+/****************************
+ CS_cacheMessageTable
+ ****************************/
+@implementation CS_cacheMessageTable
+/*
+ *  Object attributes.
+ */
+{
+    NSMutableDictionary *mdStripes[CMT_NUM_STRIPES];
+    NSMutableArray      *maOrderedIds;              //  in creation date order, and then in the order they were cached.
+    NSMutableArray      *maOrderedMessages;         //  parallel to the ids.
+    NSArray             *arrIdSnapshot;
+    NSArray             *arrMessageSnapshot;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    self = [super init];
+    if (self) {
+        for (NSUInteger i = 0; i < CMT_NUM_STRIPES; i++) {
+            mdStripes[i] = [[NSMutableDictionary alloc] init];
+        }
+        maOrderedIds       = [[NSMutableArray alloc] init];
+        maOrderedMessages  = [[NSMutableArray alloc] init];
+        arrIdSnapshot      = nil;
+        arrMessageSnapshot = nil;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    for (NSUInteger i = 0; i < CMT_NUM_STRIPES; i++) {
+        [mdStripes[i] release];
+        mdStripes[i] = nil;
+    }
+    
+    [maOrderedIds release];
+    maOrderedIds = nil;
+    
+    [maOrderedMessages release];
+    maOrderedMessages = nil;
+    
+    [self discardSnapshotsWithoutLock];
+    
+    [super dealloc];
+}
+
+/*
+ *  Return the message with the given id.
+ */
+-(CS_cacheMessage *) messageForId:(NSString *) mid
+{
+    if (!mid) {
+        return nil;
+    }
+    
+    NSMutableDictionary *mdStripe = [self stripeForId:mid];
+    @synchronized (mdStripe) {
+        return [[[mdStripe objectForKey:mid] retain] autorelease];
+    }
+}
+
+/*
+ *  Add the message or replace the one with the same id.
+ */
+-(void) cacheMessage:(CS_cacheMessage *) cm
+{
+    NSString *mid = [cm messageId];
+    if (!mid) {
+        return;
+    }
+    
+    NSMutableDictionary *mdStripe = [self stripeForId:mid];
+    @synchronized (maOrderedIds) {
+        CS_cacheMessage *cmPrior = nil;
+        @synchronized (mdStripe) {
+            cmPrior = [[[mdStripe objectForKey:mid] retain] autorelease];
+            [mdStripe setObject:cm forKey:mid];
+        }
+        if (cmPrior) {
+            [self removeFromOrderWithoutLock:cmPrior];
+        }
+        [self insertIntoOrderWithoutLock:cm];
+        [self discardSnapshotsWithoutLock];
+    }
+}
+
+/*
+ *  Remove the message with the given id.
+ */
+-(void) removeMessageForId:(NSString *) mid
+{
+    if (!mid) {
+        return;
+    }
+    
+    NSMutableDictionary *mdStripe = [self stripeForId:mid];
+    @synchronized (maOrderedIds) {
+        CS_cacheMessage *cmPrior = nil;
+        @synchronized (mdStripe) {
+            cmPrior = [[[mdStripe objectForKey:mid] retain] autorelease];
+            [mdStripe removeObjectForKey:mid];
+        }
+        if (cmPrior) {
+            [self removeFromOrderWithoutLock:cmPrior];
+            [self discardSnapshotsWithoutLock];
+        }
+    }
+}
+
+/*
+ *  Remove every message.
+ */
+-(void) removeAllMessages
+{
+    @synchronized (maOrderedIds) {
+        for (NSUInteger i = 0; i < CMT_NUM_STRIPES; i++) {
+            @synchronized (mdStripes[i]) {
+                [mdStripes[i] removeAllObjects];
+            }
+        }
+        [maOrderedIds removeAllObjects];
+        [maOrderedMessages removeAllObjects];
+        [self discardSnapshotsWithoutLock];
+    }
+}
+
+/*
+ *  Replace the contents of the table, which is done when it is loaded from disk.
+ *  - the ids are only used to order messages with the same date.
+ *  - the messages are sorted once instead of being inserted one at a time, which would be quadratic.
+ */
+-(void) replaceAllWithMessages:(NSDictionary *) dictMessages inOrder:(NSArray *) arrIds
+{
+    @synchronized (maOrderedIds) {
+        [self removeAllMessages];
+        NSMutableArray *maMessages = [NSMutableArray arrayWithCapacity:[arrIds count]];
+        for (NSString *mid in arrIds) {
+            CS_cacheMessage *cm = [dictMessages objectForKey:mid];
+            NSString *cmId      = [cm isKindOfClass:[CS_cacheMessage class]] ? [cm messageId] : nil;
+            if (!cmId) {
+                continue;
+            }
+            
+            NSMutableDictionary *mdStripe = [self stripeForId:cmId];
+            @synchronized (mdStripe) {
+                if ([mdStripe objectForKey:cmId]) {
+                    continue;
+                }
+                [mdStripe setObject:cm forKey:cmId];
+            }
+            [maMessages addObject:cm];
+        }
+        
+        // - a stable sort keeps the saved order for messages with the same date.
+        [maMessages sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(id obj1, id obj2) {
+            return [[CS_cacheMessageTable sortDateForMessage:obj1] compare:[CS_cacheMessageTable sortDateForMessage:obj2]];
+        }];
+        [maOrderedMessages setArray:maMessages];
+        for (CS_cacheMessage *cm in maMessages) {
+            [maOrderedIds addObject:[cm messageId]];
+        }
+        [self discardSnapshotsWithoutLock];
+    }
+}
+
+/*
+ *  Change the date of a message, moving it to its new place in the order if it is in the table.
+ *  - the message is found by its old date, so the change must happen while it is out of the order.
+ */
+-(void) reorderMessage:(CS_cacheMessage *) cm whileChangingDate:(void (^)(void)) changeBlock
+{
+    @synchronized (maOrderedIds) {
+        BOOL isCached = ([self messageForId:[cm messageId]] == cm) ? YES : NO;
+        if (isCached) {
+            [self removeFromOrderWithoutLock:cm];
+        }
+        changeBlock();
+        if (isCached) {
+            [self insertIntoOrderWithoutLock:cm];
+            [self discardSnapshotsWithoutLock];
+        }
+    }
+}
+
+/*
+ *  Return the ids of all the messages in creation date order.
+ *  - the array is shared with every other caller until the table changes, so it costs nothing to return.
+ */
+-(NSArray *) sortedMessageIds
+{
+    @synchronized (maOrderedIds) {
+        if (!arrIdSnapshot) {
+            arrIdSnapshot = [maOrderedIds copy];
+        }
+        return [[arrIdSnapshot retain] autorelease];
+    }
+}
+
+/*
+ *  Return all the messages in creation date order.
+ */
+-(NSArray *) sortedMessages
+{
+    @synchronized (maOrderedIds) {
+        if (!arrMessageSnapshot) {
+            arrMessageSnapshot = [maOrderedMessages copy];
+        }
+        return [[arrMessageSnapshot retain] autorelease];
+    }
+}
+
+/*
+ *  Return every message keyed by its id, which is the format used to save the table.
+ */
+-(NSDictionary *) messagesById
+{
+    @synchronized (maOrderedIds) {
+        return [NSDictionary dictionaryWithObjects:maOrderedMessages forKeys:maOrderedIds];
+    }
+}
+
+/*
+ *  Return the number of messages.
+ */
+-(NSUInteger) count
+{
+    @synchronized (maOrderedIds) {
+        return [maOrderedIds count];
+    }
+}
+@end
+
+/**********************************
+ CS_cacheMessageTable (internal)
+ **********************************/
+@implementation CS_cacheMessageTable (internal)
+/*
+ *  Return the stripe that holds the id.
+ */
+-(NSMutableDictionary *) stripeForId:(NSString *) mid
+{
+    return mdStripes[[mid hash] & (CMT_NUM_STRIPES - 1)];
+}
+
+/*
+ *  Return the date used to order the message, which places messages without one at the beginning.
+ */
++(NSDate *) sortDateForMessage:(CS_cacheMessage *) cm
+{
+    NSDate *dt = [cm dateCreated];
+    return dt ? dt : [NSDate distantPast];
+}
+
+/*
+ *  Find the position after every message with the same or an earlier date.
+ */
+-(NSUInteger) insertionIndexForDate:(NSDate *) dt
+{
+    NSUInteger low  = 0;
+    NSUInteger high = [maOrderedMessages count];
+    while (low < high) {
+        NSUInteger mid = low + ((high - low) >> 1);
+        if ([[CS_cacheMessageTable sortDateForMessage:[maOrderedMessages objectAtIndex:mid]] compare:dt] == NSOrderedDescending) {
+            high = mid;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/*
+ *  Remove the message from the ordered lists.
+ *  - the date is used to find it quickly, but because a message's date can be changed after it is cached, the
+ *    whole list is searched if it isn't where it is expected to be.
+ */
+-(void) removeFromOrderWithoutLock:(CS_cacheMessage *) cm
+{
+    NSDate *dt    = [CS_cacheMessageTable sortDateForMessage:cm];
+    NSUInteger i  = [self insertionIndexForDate:dt];
+    NSUInteger at = NSNotFound;
+    while (i > 0) {
+        i--;
+        CS_cacheMessage *cmCur = [maOrderedMessages objectAtIndex:i];
+        if (cmCur == cm) {
+            at = i;
+            break;
+        }
+        if (![[CS_cacheMessageTable sortDateForMessage:cmCur] isEqualToDate:dt]) {
+            break;
+        }
+    }
+    if (at == NSNotFound) {
+        at = [maOrderedMessages indexOfObjectIdenticalTo:cm];
+    }
+    if (at != NSNotFound) {
+        [maOrderedMessages removeObjectAtIndex:at];
+        [maOrderedIds removeObjectAtIndex:at];
+    }
+}
+
+/*
+ *  Add the message to the ordered lists after any with the same date.
+ */
+-(void) insertIntoOrderWithoutLock:(CS_cacheMessage *) cm
+{
+    NSUInteger at = [self insertionIndexForDate:[CS_cacheMessageTable sortDateForMessage:cm]];
+    [maOrderedMessages insertObject:cm atIndex:at];
+    [maOrderedIds insertObject:[cm messageId] atIndex:at];
+    [self assertOrderAroundIndex:at];
+}
+
+/*
+ *  Confirm that the message at the index is in date order with its neighbors.
+ *  - the binary searches depend on the order, so a message whose date changed without the table knowing
+ *    will show up here as soon as something is placed next to it.
+ */
+-(void) assertOrderAroundIndex:(NSUInteger) idx
+{
+#ifndef NS_BLOCK_ASSERTIONS
+    NSDate *dt = [CS_cacheMessageTable sortDateForMessage:[maOrderedMessages objectAtIndex:idx]];
+    NSAssert(idx == 0 || [[CS_cacheMessageTable sortDateForMessage:[maOrderedMessages objectAtIndex:idx - 1]] compare:dt] != NSOrderedDescending,
+             @"The message table is out of order before index %lu.", (unsigned long) idx);
+    NSAssert(idx + 1 == [maOrderedMessages count] || [dt compare:[CS_cacheMessageTable sortDateForMessage:[maOrderedMessages objectAtIndex:idx + 1]]] != NSOrderedDescending,
+             @"The message table is out of order after index %lu.", (unsigned long) idx);
+#endif
+}
+
+/*
+ *  Discard the published lists so that they are regenerated on the next request.
+ *  - callers that already have them keep them because they are immutable.
+ */
+-(void) discardSnapshotsWithoutLock
+{
+    [arrIdSnapshot release];
+    arrIdSnapshot = nil;
+    
+    [arrMessageSnapshot release];
+    arrMessageSnapshot = nil;
+}
+@end
@@ -12,6 +12,7 @@
 #import "UINewSealCell.h"
 #import "ChatSealVaultPlaceholder.h"
 #import "UIImageGeneration.h"
+#import "CS_image.h"
 
 // - constants
 static NSString *CS_SEALCACHE_CATEGORY = @"seals";
@@ -1014,10 +1015,22 @@ static UIImage             *imgSealMissing      = nil;
             // ...finally, fall back to the vault and scale it.
             img = [self safeImageUsingSecureSeal:ss];
             if (img.size.width) {
-                CGFloat target  = [ChatSeal standardSealImageSideForVaultDisplay];
-                CGFloat svScale = [UIScreen mainScreen].scale;
-                CGFloat iScale  = (target * svScale) / (img.size.width * img.scale);
-                img = [UIImageGeneration image:img scaledTo:iScale asOpaque:YES];
+                // - the resampler only shrinks images, so a seal smaller than the display is still enlarged the
+                //   original way.  In both cases, the width is matched to the display and the result is opaque.
+                CGFloat target     = [ChatSeal standardSealImageSideForVaultDisplay];
+                CGFloat svScale    = [UIScreen mainScreen].scale;
+                CGFloat iScale     = (target * svScale) / (img.size.width * img.scale);
+                UIImage *imgScaled = nil;
+                if (iScale < 1.0f) {
+                    CGFloat maxSide = MAX(img.size.width, img.size.height) * img.scale * iScale;
+                    imgScaled       = [CS_image imageResampled:img toMaximumPixels:(NSUInteger) ceil(maxSide) usingLanczos:YES asOpaque:YES withError:nil];
+                }
+                if (imgScaled) {
+                    img = imgScaled;
+                }
+                else {
+                    img = [UIImageGeneration image:img scaledTo:iScale asOpaque:YES];
+                }
                 if (img) {
                     [CS_diskCache saveSecureImage:img withBaseName:sName andCategory:CS_SEALCACHE_CATEGORY];
                 }
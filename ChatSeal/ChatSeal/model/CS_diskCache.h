@@ -16,6 +16,7 @@
 +(NSSet *) secureCachedBaseNamesInCategory:(NSString *) category;
 +(NSObject *) secureCachedDataWithBaseName:(NSString *) baseName andCategory:(NSString *) category;
 +(BOOL) saveSecureCachedData:(NSObject *) obj withBaseName:(NSString *) baseName andCategory:(NSString *) category;
++(BOOL) saveSecureCachedData:(NSObject *) obj withBaseName:(NSString *) baseName andCategory:(NSString *) category andWaitForWrite:(BOOL) waitForWrite;
 +(UIImage *) cachedLossyImageWithBaseName:(NSString *) baseName andCategory:(NSString *) category;
 +(BOOL) saveLossyImage:(UIImage *) img withBaseName:(NSString *) baseName andCategory:(NSString *) category;
 +(void) invalidateLossyImageWithBaseName:(NSString *) baseName andCategory:(NSString *) category;
@@ -26,4 +27,10 @@
 +(UIImage *) cachedSecureImageWithBaseName:(NSString *) baseName andCategory:(NSString *) category;
 +(BOOL) saveSecureImage:(UIImage *) img withBaseName:(NSString *) baseName andCategory:(NSString *) category;
 +(void) invalidateSecureImageWithBaseName:(NSString *) baseName andCategory:(NSString *) category;
++(void) waitForPendingWrites;
++(void) releaseMemoryTier;
++(void) discardMemoryTier;
++(void) setMemoryTierByteLimit:(NSUInteger) limit;
++(NSString *) memoryTierStatistics;
++(void) resetMemoryTierStatistics;
 @end
@@ -7,8 +7,14 @@
 //
 
 #import "CS_diskCache.h"
+#import "CS_diskCacheMemoryTier.h"
 #import "ChatSeal.h"
 
+//  THREADING-NOTES:
+//  - saves and item removals are applied to the memory tier immediately and written to disk afterwards on a
+//    single I/O queue so that the disk sees them in the order they were requested.
+//  - anything that inspects the disk as a whole (category removal, enumeration) first waits for the I/O queue.
+
 // - constants
 static const NSUInteger CS_DC_VERSION            = 1;             // increment this to automatically invalidate old content.
 static NSString *CS_DC_LOSSY_EXT                 = @"jpg";
@@ -20,7 +26,10 @@ static NSString *CS_DC_ID_KEY                    = @"cacheId";
 static NSString *CS_DC_ID_NAME                   = @"RealCacheItem";
 static NSString *CS_DC_NOLOSSY_EXT               = @"png";
 static NSString *CS_DC_DOUBLE_RES                = @"@2x";
+static const NSUInteger CS_DC_MEMORY_LIMIT       = (8 * 1024 * 1024);
 static NSMutableDictionary *mdKnownCategoryPaths = nil;
+static CS_diskCacheMemoryTier *memTier           = nil;
+static NSOperationQueue *opqWriteBehind          = nil;
 
 // - forward declarations
 @interface CS_diskCache (internal)
@@ -38,6 +47,9 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 +(UIImage *) cachedImageWithBaseName:(NSString *)baseName andCategory:(NSString *)category andExtension:(NSString *) ext;
 +(void) invalidateAllImageVariantsWithBaseName:(NSString *)baseName andCategory:(NSString *)category andExtension:(NSString *) ext;
 +(NSSet *) cachedBaseNamesInCategory:(NSString *) category withExtension:(NSString *) ext;
++(NSData *) cachedDataAtURL:(NSURL *) u;
++(BOOL) writeBehindData:(NSData *) d toURL:(NSURL *) u asSecure:(BOOL) isSecure andWait:(BOOL) waitForWrite;
++(void) removeBehindItemAtURL:(NSURL *) u;
 @end
 
 
@@ -51,6 +63,9 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 +(void) initialize
 {
     mdKnownCategoryPaths = [[NSMutableDictionary alloc] init];
+    memTier              = [[CS_diskCacheMemoryTier alloc] initWithByteLimit:CS_DC_MEMORY_LIMIT];
+    opqWriteBehind       = [[NSOperationQueue alloc] init];
+    [opqWriteBehind setMaxConcurrentOperationCount:1];
 }
 
 /*
@@ -60,7 +75,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 {
     NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName];
     if (u) {
-        return [NSData dataWithContentsOfURL:u options:NSDataReadingUncached error:nil];
+        return [CS_diskCache cachedDataAtURL:u];
     }
     return nil;
 }
@@ -93,8 +108,10 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
         return;
     }
     
+    [CS_diskCache waitForPendingWrites];
     NSURL *u = [CS_diskCache cacheURLForCategory:category];
     if (u) {
+        [memTier removeDataWithKeyPrefix:[[u path] stringByAppendingString:@"/"]];
         [CS_diskCache invalidateCacheItem:u];
         @synchronized (mdKnownCategoryPaths) {
             [mdKnownCategoryPaths removeObjectForKey:category];
@@ -118,16 +135,27 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 {
     NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName];
     if (u) {
-        RSISecureData *secD = nil;
-        if ([RealSecureImage readVaultURL:u intoData:&secD withError:nil]) {
-            NSObject *obj = [CS_diskCache standardArchiveToCacheItem:secD.rawData];
+        // - the memory tier holds the decrypted archive, which is discarded when the vault is closed.
+        BOOL isKnown     = NO;
+        NSUInteger gen   = 0;
+        NSData *dArchive = [memTier dataForKey:[u path] isKnown:&isKnown andGeneration:&gen];
+        if (!isKnown) {
+            RSISecureData *secD = nil;
+            if ([RealSecureImage readVaultURL:u intoData:&secD withError:nil]) {
+                dArchive = [NSData dataWithData:secD.rawData];
+                [memTier setData:dArchive forKey:[u path] readAtGeneration:gen];
+            }
+        }
+        
+        if (dArchive) {
+            NSObject *obj = [CS_diskCache standardArchiveToCacheItem:dArchive];
             if (obj) {
                 return obj;
             }
             
             //  - when the item is invalid or old, we're going to just delete it.
             NSLog(@"CS: The archive data at %@ is invalid.", [u path]);
-            [[NSFileManager defaultManager] removeItemAtURL:u error:nil];
+            [CS_diskCache removeBehindItemAtURL:u];
         }
     }
     return nil;
@@ -135,8 +163,18 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 
 /*
  *  Cache a data item securely at the given base and category.
+ *  - the write happens afterwards, so a failure is only seen by readers, which find nothing.
  */
 +(BOOL) saveSecureCachedData:(NSObject *) obj withBaseName:(NSString *) baseName andCategory:(NSString *) category
+{
+    return [CS_diskCache saveSecureCachedData:obj withBaseName:baseName andCategory:category andWaitForWrite:NO];
+}
+
+/*
+ *  Cache a data item securely at the given base and category.
+ *  - when waiting, the result describes whether the item was written to disk.
+ */
++(BOOL) saveSecureCachedData:(NSObject *) obj withBaseName:(NSString *) baseName andCategory:(NSString *) category andWaitForWrite:(BOOL) waitForWrite
 {
     if (!obj) {
         return NO;
@@ -146,10 +184,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
     if (d) {
         NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName];
         if (u) {
-            if ([RealSecureImage writeVaultData:d toURL:u withError:nil]) {
-                return YES;
-            }
-            [CS_diskCache handleCacheFailureToURL:u];
+            return [CS_diskCache writeBehindData:d toURL:u asSecure:YES andWait:waitForWrite];
         }
     }
     return NO;
@@ -178,7 +213,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
             baseName = [baseName stringByAppendingString:CS_DC_DOUBLE_RES];
         }
         NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName andExtension:CS_DC_LOSSY_EXT];
-        return [CS_diskCache cacheWriteData:d toURL:u];
+        return [CS_diskCache writeBehindData:d toURL:u asSecure:NO andWait:NO];
     }
     return NO;
 }
@@ -215,7 +250,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
             baseName = [baseName stringByAppendingString:CS_DC_DOUBLE_RES];
         }
         NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName andExtension:CS_DC_NOLOSSY_EXT];
-        return [CS_diskCache cacheWriteData:d toURL:u];
+        return [CS_diskCache writeBehindData:d toURL:u asSecure:NO andWait:NO];
     }
     return NO;
 }
@@ -233,6 +268,12 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
  */
 +(BOOL) invalidateEntireCache
 {
+    [CS_diskCache waitForPendingWrites];
+    [memTier removeAllData];
+    @synchronized (mdKnownCategoryPaths) {
+        [mdKnownCategoryPaths removeAllObjects];
+    }
+    
     NSURL *u = [CS_diskCache rootCacheDirectory];
     if (u) {
         NSError *err = nil;
@@ -278,6 +319,57 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
     [CS_diskCache invalidateCacheItemWithBaseName:baseName andCategory:category];
 }
 
+/*
+ *  Block until every save and removal has been applied to the disk.
+ */
++(void) waitForPendingWrites
+{
+    [opqWriteBehind waitUntilAllOperationsAreFinished];
+}
+
+/*
+ *  Free the memory used by content that can be reloaded from disk.
+ */
++(void) releaseMemoryTier
+{
+    [memTier discardUnpinnedData];
+}
+
+/*
+ *  Write all pending content and then discard everything in memory.
+ *  - this must be called before the vault is closed because secure content is written with the vault and
+ *    held in memory without its encryption.
+ */
++(void) discardMemoryTier
+{
+    [CS_diskCache waitForPendingWrites];
+    [memTier removeAllData];
+}
+
+/*
+ *  Change the amount of content that may be held in memory.
+ */
++(void) setMemoryTierByteLimit:(NSUInteger) limit
+{
+    [memTier setByteLimit:limit];
+}
+
+/*
+ *  Return a description of the memory tier's effectiveness.
+ */
++(NSString *) memoryTierStatistics
+{
+    return [memTier statisticsDescription];
+}
+
+/*
+ *  Reset the memory tier counters.
+ */
++(void) resetMemoryTierStatistics
+{
+    [memTier resetStatistics];
+}
+
 @end
 
 /***********************
@@ -382,7 +474,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
 {
     NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName andExtension:ext];
     if (u) {
-        [CS_diskCache invalidateCacheItem:u];
+        [CS_diskCache removeBehindItemAtURL:u];
     }
 }
 
@@ -499,9 +591,20 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
  */
 +(UIImage *) cachedImageWithBaseName:(NSString *)baseName andCategory:(NSString *)category andExtension:(NSString *) ext
 {
-    NSURL *u = [CS_diskCache cacheURLForCategory:category andBaseName:baseName andExtension:ext];
-    if (u) {
-        return [UIImage imageWithContentsOfFile:[u path]];
+    // - the high resolution variant is preferred on devices that can use it, just like imageWithContentsOfFile.
+    CGFloat scale = [UIScreen mainScreen].scale;
+    if (scale > 1.0f) {
+        NSURL *u  = [CS_diskCache cacheURLForCategory:category andBaseName:[baseName stringByAppendingString:CS_DC_DOUBLE_RES] andExtension:ext];
+        NSData *d = u ? [CS_diskCache cachedDataAtURL:u] : nil;
+        if (d) {
+            return [UIImage imageWithData:d scale:2.0f];
+        }
+    }
+    
+    NSURL *u  = [CS_diskCache cacheURLForCategory:category andBaseName:baseName andExtension:ext];
+    NSData *d = u ? [CS_diskCache cachedDataAtURL:u] : nil;
+    if (d) {
+        return [UIImage imageWithData:d scale:1.0f];
     }
     return nil;
 }
@@ -521,6 +624,7 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
  */
 +(NSSet *) cachedBaseNamesInCategory:(NSString *) category withExtension:(NSString *) ext
 {
+    [CS_diskCache waitForPendingWrites];
     NSMutableSet *msCurrent = [NSMutableSet set];
     NSURL *u                = [CS_diskCache cacheURLForCategory:category];
     NSArray *arrItems       = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:u includingPropertiesForKeys:[NSArray arrayWithObjects:NSURLIsDirectoryKey, NSURLPathKey, nil] options:NSDirectoryEnumerationSkipsSubdirectoryDescendants error:nil];
@@ -548,4 +652,74 @@ static NSMutableDictionary *mdKnownCategoryPaths = nil;
     return msCurrent;
 }
 
+/*
+ *  Return the content at the given location, preferring the memory tier.
+ */
++(NSData *) cachedDataAtURL:(NSURL *) u
+{
+    BOOL isKnown   = NO;
+    NSUInteger gen = 0;
+    NSData *d      = [memTier dataForKey:[u path] isKnown:&isKnown andGeneration:&gen];
+    if (isKnown) {
+        return d;
+    }
+    
+    d = [NSData dataWithContentsOfURL:u options:NSDataReadingUncached error:nil];
+    if (d) {
+        [memTier setData:d forKey:[u path] readAtGeneration:gen];
+    }
+    return d;
+}
+
+/*
+ *  Make the content available immediately and write it to disk on the I/O queue.
+ *  - when the write fails, the item is removed from both tiers, which preserves the rule that a failed save
+ *    leaves nothing behind.
+ *  - without waiting, the result only describes whether the write was queued.
+ */
++(BOOL) writeBehindData:(NSData *) d toURL:(NSURL *) u asSecure:(BOOL) isSecure andWait:(BOOL) waitForWrite
+{
+    if (!d || !u) {
+        return NO;
+    }
+    
+    NSString *sKey = [u path];
+    [memTier setData:d forKey:sKey asPendingWrite:YES];
+    
+    __block BOOL ret     = NO;
+    NSBlockOperation *bo = [NSBlockOperation blockOperationWithBlock:^(void) {
+        if (isSecure) {
+            ret = [RealSecureImage writeVaultData:d toURL:u withError:nil];
+            if (!ret) {
+                [CS_diskCache handleCacheFailureToURL:u];
+            }
+        }
+        else {
+            ret = [CS_diskCache cacheWriteData:d toURL:u];
+        }
+        [memTier completePendingWriteForKey:sKey withSuccess:ret];
+    }];
+    [opqWriteBehind addOperation:bo];
+    
+    // - the queue is serial, so this also waits for every save that came before it.
+    if (waitForWrite) {
+        [bo waitUntilFinished];
+        return ret;
+    }
+    return YES;
+}
+
+/*
+ *  Remove the item immediately from the point of view of readers and delete it on the I/O queue.
+ */
++(void) removeBehindItemAtURL:(NSURL *) u
+{
+    NSString *sKey = [u path];
+    [memTier setPendingRemovalForKey:sKey];
+    [opqWriteBehind addOperationWithBlock:^(void) {
+        [CS_diskCache invalidateCacheItem:u];
+        [memTier completePendingWriteForKey:sKey withSuccess:YES];
+    }];
+}
+
 @end
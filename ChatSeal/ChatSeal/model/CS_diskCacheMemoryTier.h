@@ -0,0 +1,37 @@
+//
+//  CS_diskCacheMemoryTier.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/25/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - the memory tier keeps the most recently used disk cache content in a size-bounded LRU.
+// - content is stored by its hash so that items with identical bytes share a single buffer.
+// - items that are still being written to disk are pinned and never evicted, which allows the
+//   disk cache to return from a save before the file exists.
+// - content read from disk is only added when nothing changed the key since the read began, which is
+//   tracked with a generation that is shared by the keys that hash to the same stripe.
+@interface CS_diskCacheMemoryTier : NSObject
+-(id) initWithByteLimit:(NSUInteger) limit;
+-(void) setByteLimit:(NSUInteger) limit;
+-(NSUInteger) byteLimit;
+-(NSData *) dataForKey:(NSString *) key isKnown:(BOOL *) isKnown;
+-(NSData *) dataForKey:(NSString *) key isKnown:(BOOL *) isKnown andGeneration:(NSUInteger *) generation;
+-(void) setData:(NSData *) d forKey:(NSString *) key asPendingWrite:(BOOL) isPending;
+-(void) setData:(NSData *) d forKey:(NSString *) key readAtGeneration:(NSUInteger) generation;
+-(void) setPendingRemovalForKey:(NSString *) key;
+-(void) completePendingWriteForKey:(NSString *) key withSuccess:(BOOL) success;
+-(void) removeDataForKey:(NSString *) key;
+-(void) removeDataWithKeyPrefix:(NSString *) prefix;
+-(void) discardUnpinnedData;
+-(void) removeAllData;
+-(NSUInteger) numberOfResidentBytes;
+-(NSUInteger) numberOfHits;
+-(NSUInteger) numberOfMisses;
+-(NSUInteger) numberOfEvictions;
+-(NSString *) statisticsDescription;
+-(void) resetStatistics;
+@end
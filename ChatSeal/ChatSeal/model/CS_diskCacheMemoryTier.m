@@ -0,0 +1,597 @@
+//
+//  CS_diskCacheMemoryTier.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/25/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_diskCacheMemoryTier.h"
+#import "CS_sha.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - the recency list is intrusive and its links are not retained.  The key dictionary owns every entry.
+
+// - constants
+#define CS_DCT_NUM_GENERATIONS 64                   //  must be a power of two.
+
+// - a unique buffer, shared by every key with the same content.
+@interface _S_dct_blob : NSObject
+@property (nonatomic, retain) NSData *data;
+@property (nonatomic, retain) NSData *dHash;
+@property (nonatomic, assign) NSUInteger refCount;
+@end
+
+// - a single key in the tier.
+// - an entry without a blob records that the item is being removed from disk and is known to not exist.
+@interface _S_dct_entry : NSObject
+@property (nonatomic, retain) NSString *key;
+@property (nonatomic, retain) _S_dct_blob *blob;
+@property (nonatomic, assign) NSUInteger numPending;
+@property (nonatomic, assign) _S_dct_entry *prev;
+@property (nonatomic, assign) _S_dct_entry *next;
+@end
+
+// - forward declarations
+@interface CS_diskCacheMemoryTier (internal)
+-(void) linkEntryAtHeadWithoutLock:(_S_dct_entry *) entry;
+-(void) unlinkEntryWithoutLock:(_S_dct_entry *) entry;
+-(void) setBlob:(_S_dct_blob *) blob forEntryWithoutLock:(_S_dct_entry *) entry;
+-(void) discardEntryWithoutLock:(_S_dct_entry *) entry;
+-(void) enforceLimitWithoutLock;
+-(void) setData:(NSData *) d forKey:(NSString *) key asPendingWrite:(BOOL) isPending atGeneration:(const NSUInteger *) generation;
+-(NSUInteger) generationIndexForKey:(NSString *) key;
+-(void) advanceGenerationForKeyWithoutLock:(NSString *) key;
+-(void) advanceAllGenerationsWithoutLock;
+@end
+
+/*************************
+ CS_diskCacheMemoryTier
+ *************************/
+@implementation CS_diskCacheMemoryTier
+/*
+ *  Object attributes.
+ */
+{
+    NSUInteger          byteLimit;
+    NSUInteger          numResident;
+    NSMutableDictionary *mdEntries;                 //  key --> entry
+    NSMutableDictionary *mdBlobs;                   //  content hash --> blob
+    _S_dct_entry        *head;                      //  most recently used
+    _S_dct_entry        *tail;                      //  least recently used
+    NSUInteger          numHits;
+    NSUInteger          numMisses;
+    NSUInteger          numEvictions;
+    NSUInteger          numShared;
+    NSUInteger          numSharedBytes;
+    NSUInteger          numWriteFailures;
+    NSUInteger          keyGenerations[CS_DCT_NUM_GENERATIONS];
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithByteLimit:(NSUInteger) limit
+{
+    self = [super init];
+    if (self) {
+        byteLimit   = limit;
+        numResident = 0;
+        mdEntries   = [[NSMutableDictionary alloc] init];
+        mdBlobs     = [[NSMutableDictionary alloc] init];
+        head        = nil;
+        tail        = nil;
+        memset(keyGenerations, 0, sizeof(keyGenerations));
+        [self resetStatistics];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    head = tail = nil;
+    
+    [mdEntries release];
+    mdEntries = nil;
+    
+    [mdBlobs release];
+    mdBlobs = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Change the amount of content that may be resident.
+ */
+-(void) setByteLimit:(NSUInteger) limit
+{
+    @synchronized (self) {
+        byteLimit = limit;
+        [self enforceLimitWithoutLock];
+    }
+}
+
+/*
+ *  Return the amount of content that may be resident.
+ */
+-(NSUInteger) byteLimit
+{
+    @synchronized (self) {
+        return byteLimit;
+    }
+}
+
+/*
+ *  Return the content for the key if it is resident.
+ *  - isKnown is set when the tier is authoritative for the key, which includes items that are pending
+ *    removal and therefore return nil.
+ */
+-(NSData *) dataForKey:(NSString *) key isKnown:(BOOL *) isKnown
+{
+    return [self dataForKey:key isKnown:isKnown andGeneration:NULL];
+}
+
+/*
+ *  Return the content for the key if it is resident, along with the generation to pass back when the
+ *  content must be read from disk.
+ */
+-(NSData *) dataForKey:(NSString *) key isKnown:(BOOL *) isKnown andGeneration:(NSUInteger *) generation
+{
+    @synchronized (self) {
+        if (generation) {
+            *generation = keyGenerations[[self generationIndexForKey:key]];
+        }
+        
+        _S_dct_entry *entry = [mdEntries objectForKey:key];
+        if (isKnown) {
+            *isKnown = (entry != nil);
+        }
+        if (!entry) {
+            numMisses++;
+            return nil;
+        }
+        
+        numHits++;
+        if (entry != head) {
+            [self unlinkEntryWithoutLock:entry];
+            [self linkEntryAtHeadWithoutLock:entry];
+        }
+        return [[entry.blob.data retain] autorelease];
+    }
+}
+
+/*
+ *  Save content for the key.
+ *  - when the content is pending a write, it will remain resident until completePendingWriteForKey is called.
+ *  - content that was just read from disk never replaces an existing entry because a save or removal may have
+ *    started after the read.
+ */
+-(void) setData:(NSData *) d forKey:(NSString *) key asPendingWrite:(BOOL) isPending
+{
+    [self setData:d forKey:key asPendingWrite:isPending atGeneration:NULL];
+}
+
+/*
+ *  Save content that was read from disk for the key.
+ *  - a removal that finished while the read was in progress no longer has an entry to block it, so the
+ *    generation from the lookup is used to detect it.
+ */
+-(void) setData:(NSData *) d forKey:(NSString *) key readAtGeneration:(NSUInteger) generation
+{
+    [self setData:d forKey:key asPendingWrite:NO atGeneration:&generation];
+}
+
+/*
+ *  Save content for the key, optionally only when it hasn't changed since the given generation.
+ */
+-(void) setData:(NSData *) d forKey:(NSString *) key asPendingWrite:(BOOL) isPending atGeneration:(const NSUInteger *) generation
+{
+    if (!d || !key) {
+        return;
+    }
+    
+    // - hashing is done outside the lock because it is proportional to the size of the content.
+    CS_sha *sha = [CS_sha shaHash];
+    [sha updateWithData:d];
+    NSData *dHash = [sha hashResult];
+    
+    @synchronized (self) {
+        if (generation && keyGenerations[[self generationIndexForKey:key]] != *generation) {
+            return;
+        }
+        
+        _S_dct_entry *entry = [mdEntries objectForKey:key];
+        if (entry && !isPending) {
+            return;
+        }
+        if (isPending) {
+            [self advanceGenerationForKeyWithoutLock:key];
+        }
+        
+        _S_dct_blob *blob = [mdBlobs objectForKey:dHash];
+        if (blob) {
+            numShared++;
+            numSharedBytes += [d length];
+        }
+        else {
+            blob       = [[[_S_dct_blob alloc] init] autorelease];
+            blob.data  = d;
+            blob.dHash = dHash;
+            [mdBlobs setObject:blob forKey:dHash];
+            numResident += [d length];
+        }
+        
+        if (entry) {
+            [self unlinkEntryWithoutLock:entry];
+        }
+        else {
+            entry     = [[[_S_dct_entry alloc] init] autorelease];
+            entry.key = key;
+            [mdEntries setObject:entry forKey:key];
+        }
+        [self setBlob:blob forEntryWithoutLock:entry];
+        if (isPending) {
+            entry.numPending++;
+        }
+        [self linkEntryAtHeadWithoutLock:entry];
+        [self enforceLimitWithoutLock];
+    }
+}
+
+/*
+ *  Record that the item is being removed from disk so that a concurrent read doesn't find the old file.
+ */
+-(void) setPendingRemovalForKey:(NSString *) key
+{
+    if (!key) {
+        return;
+    }
+    
+    @synchronized (self) {
+        [self advanceGenerationForKeyWithoutLock:key];
+        _S_dct_entry *entry = [mdEntries objectForKey:key];
+        if (entry) {
+            [self unlinkEntryWithoutLock:entry];
+        }
+        else {
+            entry     = [[[_S_dct_entry alloc] init] autorelease];
+            entry.key = key;
+            [mdEntries setObject:entry forKey:key];
+        }
+        [self setBlob:nil forEntryWithoutLock:entry];
+        entry.numPending++;
+        [self linkEntryAtHeadWithoutLock:entry];
+        [self enforceLimitWithoutLock];
+    }
+}
+
+/*
+ *  A write or removal that was started with this tier has finished.
+ *  - a failed write means the disk no longer has the item, so the content must not outlive its last pending write.
+ */
+-(void) completePendingWriteForKey:(NSString *) key withSuccess:(BOOL) success
+{
+    @synchronized (self) {
+        _S_dct_entry *entry = [mdEntries objectForKey:key];
+        if (!entry || !entry.numPending) {
+            return;
+        }
+        entry.numPending--;
+        if (!success) {
+            numWriteFailures++;
+        }
+        
+        // - once the disk is up to date, a removal has nothing more to say about the item.
+        if (!entry.numPending && (!success || !entry.blob)) {
+            [self advanceGenerationForKeyWithoutLock:key];
+            [self discardEntryWithoutLock:entry];
+        }
+        else {
+            [self enforceLimitWithoutLock];
+        }
+    }
+}
+
+/*
+ *  Discard the key from the tier.
+ */
+-(void) removeDataForKey:(NSString *) key
+{
+    @synchronized (self) {
+        [self advanceGenerationForKeyWithoutLock:key];
+        _S_dct_entry *entry = [mdEntries objectForKey:key];
+        if (entry) {
+            [self discardEntryWithoutLock:entry];
+        }
+    }
+}
+
+/*
+ *  Discard every key with the given prefix.
+ */
+-(void) removeDataWithKeyPrefix:(NSString *) prefix
+{
+    @synchronized (self) {
+        [self advanceAllGenerationsWithoutLock];
+        NSArray *arrKeys = [mdEntries allKeys];
+        for (NSString *key in arrKeys) {
+            if ([key hasPrefix:prefix]) {
+                [self discardEntryWithoutLock:[mdEntries objectForKey:key]];
+            }
+        }
+    }
+}
+
+/*
+ *  Discard everything that can be reloaded from disk.
+ */
+-(void) discardUnpinnedData
+{
+    @synchronized (self) {
+        _S_dct_entry *entry = tail;
+        while (entry) {
+            _S_dct_entry *prior = entry.prev;
+            if (!entry.numPending) {
+                [self discardEntryWithoutLock:entry];
+            }
+            entry = prior;
+        }
+    }
+}
+
+/*
+ *  Discard all content, including items that are pending.
+ */
+-(void) removeAllData
+{
+    @synchronized (self) {
+        [self advanceAllGenerationsWithoutLock];
+        head        = nil;
+        tail        = nil;
+        numResident = 0;
+        [mdEntries removeAllObjects];
+        [mdBlobs removeAllObjects];
+    }
+}
+
+/*
+ *  Return the number of unique content bytes held by the tier.
+ */
+-(NSUInteger) numberOfResidentBytes
+{
+    @synchronized (self) {
+        return numResident;
+    }
+}
+
+/*
+ *  Return the number of reads satisfied by the tier.
+ */
+-(NSUInteger) numberOfHits
+{
+    @synchronized (self) {
+        return numHits;
+    }
+}
+
+/*
+ *  Return the number of reads that must go to disk.
+ */
+-(NSUInteger) numberOfMisses
+{
+    @synchronized (self) {
+        return numMisses;
+    }
+}
+
+/*
+ *  Return the number of items that were discarded to stay within the limit.
+ */
+-(NSUInteger) numberOfEvictions
+{
+    @synchronized (self) {
+        return numEvictions;
+    }
+}
+
+/*
+ *  Return a summary of the tier's effectiveness.
+ */
+-(NSString *) statisticsDescription
+{
+    @synchronized (self) {
+        NSUInteger numReads = numHits + numMisses;
+        return [NSString stringWithFormat:@"%u hits, %u misses (%4.1f%% hit rate), %u evictions, %u keys in %u blobs using %u of %u bytes, %u shared saves (%u bytes), %u write failures",
+                (unsigned) numHits, (unsigned) numMisses, numReads ? ((double) numHits * 100.0) / (double) numReads : 0.0, (unsigned) numEvictions,
+                (unsigned) [mdEntries count], (unsigned) [mdBlobs count], (unsigned) numResident, (unsigned) byteLimit,
+                (unsigned) numShared, (unsigned) numSharedBytes, (unsigned) numWriteFailures];
+    }
+}
+
+/*
+ *  Reset the counters.
+ */
+-(void) resetStatistics
+{
+    @synchronized (self) {
+        numHits          = 0;
+        numMisses        = 0;
+        numEvictions     = 0;
+        numShared        = 0;
+        numSharedBytes   = 0;
+        numWriteFailures = 0;
+    }
+}
+@end
+
+/**********************************
+ CS_diskCacheMemoryTier (internal)
+ **********************************/
+@implementation CS_diskCacheMemoryTier (internal)
+/*
+ *  Make the entry the most recently used.
+ */
+-(void) linkEntryAtHeadWithoutLock:(_S_dct_entry *) entry
+{
+    entry.prev = nil;
+    entry.next = head;
+    if (head) {
+        head.prev = entry;
+    }
+    head = entry;
+    if (!tail) {
+        tail = entry;
+    }
+}
+
+/*
+ *  Remove the entry from the recency list.
+ */
+-(void) unlinkEntryWithoutLock:(_S_dct_entry *) entry
+{
+    if (entry.prev) {
+        entry.prev.next = entry.next;
+    }
+    else if (head == entry) {
+        head = entry.next;
+    }
+    
+    if (entry.next) {
+        entry.next.prev = entry.prev;
+    }
+    else if (tail == entry) {
+        tail = entry.prev;
+    }
+    entry.prev = nil;
+    entry.next = nil;
+}
+
+/*
+ *  Assign content to the entry, releasing its prior blob when no other key uses it.
+ */
+-(void) setBlob:(_S_dct_blob *) blob forEntryWithoutLock:(_S_dct_entry *) entry
+{
+    _S_dct_blob *old = entry.blob;
+    if (old == blob) {
+        return;
+    }
+    
+    if (blob) {
+        blob.refCount++;
+    }
+    if (old) {
+        old.refCount--;
+        if (!old.refCount) {
+            numResident -= [old.data length];
+            [mdBlobs removeObjectForKey:old.dHash];
+        }
+    }
+    entry.blob = blob;
+}
+
+/*
+ *  Remove the entry from the tier.
+ */
+-(void) discardEntryWithoutLock:(_S_dct_entry *) entry
+{
+    [[entry retain] autorelease];
+    [self unlinkEntryWithoutLock:entry];
+    [self setBlob:nil forEntryWithoutLock:entry];
+    [mdEntries removeObjectForKey:entry.key];
+}
+
+/*
+ *  Evict the least recently used content until the tier is within its limit.
+ *  - pending items cannot be evicted because the disk doesn't have them yet.
+ */
+-(void) enforceLimitWithoutLock
+{
+    _S_dct_entry *entry = tail;
+    while (entry && numResident > byteLimit) {
+        _S_dct_entry *prior = entry.prev;
+        if (!entry.numPending) {
+            [self discardEntryWithoutLock:entry];
+            numEvictions++;
+        }
+        entry = prior;
+    }
+}
+
+/*
+ *  Return the generation shared by the key.
+ */
+-(NSUInteger) generationIndexForKey:(NSString *) key
+{
+    return [key hash] & (CS_DCT_NUM_GENERATIONS - 1);
+}
+
+/*
+ *  Record that the key was changed, which invalidates any read of it that is in progress.
+ */
+-(void) advanceGenerationForKeyWithoutLock:(NSString *) key
+{
+    keyGenerations[[self generationIndexForKey:key]]++;
+}
+
+/*
+ *  Record that every key was changed.
+ */
+-(void) advanceAllGenerationsWithoutLock
+{
+    for (NSUInteger i = 0; i < CS_DCT_NUM_GENERATIONS; i++) {
+        keyGenerations[i]++;
+    }
+}
+@end
+
+/*************************
+ _S_dct_blob
+ *************************/
+@implementation _S_dct_blob
+@synthesize data;
+@synthesize dHash;
+@synthesize refCount;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [data release];
+    data = nil;
+    
+    [dHash release];
+    dHash = nil;
+    
+    [super dealloc];
+}
+@end
+
+/*************************
+ _S_dct_entry
+ *************************/
+@implementation _S_dct_entry
+@synthesize key;
+@synthesize blob;
+@synthesize numPending;
+@synthesize prev;
+@synthesize next;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [key release];
+    key = nil;
+    
+    [blob release];
+    blob = nil;
+    
+    [super dealloc];
+}
+@end
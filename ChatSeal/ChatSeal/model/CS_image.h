@@ -20,4 +20,14 @@
 +(UIImage *) threadSafeImageScaledToMaximumPoints:(CGFloat) maxDimension forSourcePath:(NSString *) imgPath;
 +(UIImage *) tableReadyUIScaledImage:(UIImage *) img;
 +(UIImage *) collectionReadyUIScaledImage:(UIImage *) img;
+
++(UIImage *) imageResampled:(UIImage *) img toMaximumPixels:(NSUInteger) maxPixels usingLanczos:(BOOL) useLanczos asOpaque:(BOOL) isOpaque withError:(NSError **) err;
++(UIImage *) imageDecodedFromData:(NSData *) d toMaximumPixels:(NSUInteger) maxPixels withError:(NSError **) err;
+
++(UIImage *) cachedImageForKey:(NSString *) key;
++(void) cacheImage:(UIImage *) img forKey:(NSString *) key;
++(UIImage *) cachedImageScaledToMaximumPixels:(NSUInteger) maxPixels forSource:(UIImage *) img withKey:(NSString *) key;
++(void) discardCachedImagesWithKeyPrefix:(NSString *) prefix;
++(void) releaseCachedImages;
++(NSString *) cachedImageStatistics;
 @end
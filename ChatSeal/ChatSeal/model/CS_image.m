@@ -6,26 +6,43 @@
 //  Copyright (c) 2013 RealProven, LLC. All rights reserved.
 //
 
+#import <ImageIO/ImageIO.h>
 #import "CS_image.h"
 #import "CS_error.h"
+#import "CS_imageCache.h"
+#import "CS_imageResample.h"
 
 //  - constants
 static const char *PHSIMG_RAW_ID               = "RPrawimg";              //  must be a multiple of uint16_t
 static const int PHSIMG_LEN_RAW_ID             = 8;
 static NSUInteger PHSC_MAX_TABLE_IMAGE_SIDE    = 64;        //  in points
 static NSUInteger PHSC_MAX_COLL_IMAGE_SIDE     = 64;        //  in points
+static const NSUInteger PHSC_CACHE_LIMIT       = (12 * 1024 * 1024);
+static const NSUInteger PHSC_DECODE_OVERSAMPLE = 2;         //  decoded size relative to the target, which leaves room for filtering.
+static CS_imageCache *icScaled                 = nil;
 
 // - forward declarations.
 @interface CS_image (internal)
 +(UIImage *) forceLoadImage:(CGImageRef) image withError:(NSError **) err;
 +(UIImage *) loadJPGImmediatelyWithProvider:(CGDataProviderRef) provider andError:(NSError **) err;
 +(UIImage *) imageScaledToMaximumPoints:(CGFloat) maxDimension forSource:(UIImage *) img andAlwaysRedraw:(BOOL) alwaysRedraw;
++(NSMutableData *) newBitmapFromImage:(CGImageRef) image withError:(NSError **) err;
++(UIImage *) imageFromBitmap:(NSMutableData *) mdBitmap ofWidth:(size_t) width andHeight:(size_t) height withScale:(CGFloat) scale
+              andOrientation:(UIImageOrientation) orient asOpaque:(BOOL) isOpaque andError:(NSError **) err;
 @end
 
 /***********************
  CS_image
  ***********************/
 @implementation CS_image
+/*
+ *  Initialize the module.
+ */
++(void) initialize
+{
+    icScaled = [[CS_imageCache alloc] initWithByteLimit:PHSC_CACHE_LIMIT];
+}
+
 /*
  *  There are times where files must be completely pulled into memory to
  *  produce a fluid UI.  This method will accomplish that.
@@ -254,6 +271,140 @@ static NSUInteger PHSC_MAX_COLL_IMAGE_SIDE     = 64;        //  in points
     return [CS_image threadSafeImageScaledToMaximumPoints:maxDimension forSource:img];
 }
 
+/*
+ *  Resample the image so that its longest side is no more than the given number of pixels.
+ *  - the orientation and scale of the source are kept, so only the bitmap changes.
+ *  - the result is fully decoded and may be used from any thread.
+ *  - images are never enlarged and an opaque result discards the alpha channel.
+ */
++(UIImage *) imageResampled:(UIImage *) img toMaximumPixels:(NSUInteger) maxPixels usingLanczos:(BOOL) useLanczos asOpaque:(BOOL) isOpaque withError:(NSError **) err
+{
+    CGImageRef cgSource = [img CGImage];
+    if (!cgSource || !maxPixels) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument];
+        return nil;
+    }
+    
+    size_t srcWidth  = CGImageGetWidth(cgSource);
+    size_t srcHeight = CGImageGetHeight(cgSource);
+    size_t dstWidth  = 0;
+    size_t dstHeight = 0;
+    CS_ir_fitToMaximumSide(srcWidth, srcHeight, maxPixels, &dstWidth, &dstHeight);
+    
+    // - the source bitmap is released explicitly because it is very large for a camera image.
+    NSMutableData *mdSource = [CS_image newBitmapFromImage:cgSource withError:err];
+    if (!mdSource) {
+        return nil;
+    }
+    
+    UIImage *ret            = nil;
+    NSMutableData *mdTarget = [NSMutableData dataWithLength:dstWidth * dstHeight * 4];
+    if (CS_ir_resampleRGBA((const uint8_t *) [mdSource bytes], srcWidth, srcHeight, srcWidth * 4, (uint8_t *) [mdTarget mutableBytes],
+                           dstWidth, dstHeight, dstWidth * 4, useLanczos ? CS_IR_FILTER_LANCZOS3 : CS_IR_FILTER_BILINEAR, 1) == 0) {
+        ret = [CS_image imageFromBitmap:mdTarget ofWidth:dstWidth andHeight:dstHeight withScale:img.scale andOrientation:img.imageOrientation
+                               asOpaque:isOpaque andError:err];
+    }
+    else {
+        [CS_error fillError:err withCode:CSErrorAborted andFailureReason:@"Failed to resample the image."];
+    }
+    [mdSource release];
+    return ret;
+}
+
+/*
+ *  Decode the encoded image, producing a bitmap no larger than the given number of pixels on its longest side.
+ *  - ImageIO is able to decode a JPEG at a fraction of its full size, which means a camera image is never expanded
+ *    completely only to throw most of it away.  The result is decoded a little larger than the target to give the
+ *    resampler something to work with.
+ *  - any orientation recorded in the image is applied to the bitmap.
+ */
++(UIImage *) imageDecodedFromData:(NSData *) d toMaximumPixels:(NSUInteger) maxPixels withError:(NSError **) err
+{
+    if (!d || !maxPixels) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument];
+        return nil;
+    }
+    
+    CGImageSourceRef isSource = CGImageSourceCreateWithData((CFDataRef) d, NULL);
+    if (!isSource) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument andFailureReason:@"The image data is not in a recognized format."];
+        return nil;
+    }
+    
+    NSDictionary *dictOptions = [NSDictionary dictionaryWithObjectsAndKeys:(id) kCFBooleanTrue, (id) kCGImageSourceCreateThumbnailFromImageAlways,
+                                 (id) kCFBooleanTrue, (id) kCGImageSourceCreateThumbnailWithTransform,
+                                 [NSNumber numberWithUnsignedInteger:maxPixels * PHSC_DECODE_OVERSAMPLE], (id) kCGImageSourceThumbnailMaxPixelSize, nil];
+    CGImageRef cgDecoded = CGImageSourceCreateThumbnailAtIndex(isSource, 0, (CFDictionaryRef) dictOptions);
+    CFRelease(isSource);
+    if (!cgDecoded) {
+        [CS_error fillError:err withCode:CSErrorAborted andFailureReason:@"Failed to decode the image data."];
+        return nil;
+    }
+    
+    UIImage *imgDecoded = [UIImage imageWithCGImage:cgDecoded];
+    CGImageRelease(cgDecoded);
+    return [CS_image imageResampled:imgDecoded toMaximumPixels:maxPixels usingLanczos:YES asOpaque:NO withError:err];
+}
+
+/*
+ *  Return a previously cached image.
+ */
++(UIImage *) cachedImageForKey:(NSString *) key
+{
+    return [icScaled imageForKey:key];
+}
+
+/*
+ *  Save an image in memory so that it doesn't need to be decoded or scaled again.
+ *  - keys should begin with a prefix that identifies their owner, which allows them to be discarded together.
+ */
++(void) cacheImage:(UIImage *) img forKey:(NSString *) key
+{
+    [icScaled setImage:img forKey:key];
+}
+
+/*
+ *  Return a scaled version of the source, reusing the last one created for the same key and size.
+ */
++(UIImage *) cachedImageScaledToMaximumPixels:(NSUInteger) maxPixels forSource:(UIImage *) img withKey:(NSString *) key
+{
+    if (!key) {
+        return [CS_image imageResampled:img toMaximumPixels:maxPixels usingLanczos:YES asOpaque:NO withError:nil];
+    }
+    
+    NSString *sScaledKey = [NSString stringWithFormat:@"%@@%lu", key, (unsigned long) maxPixels];
+    UIImage *ret         = [icScaled imageForKey:sScaledKey];
+    if (!ret) {
+        ret = [CS_image imageResampled:img toMaximumPixels:maxPixels usingLanczos:YES asOpaque:NO withError:nil];
+        [icScaled setImage:ret forKey:sScaledKey];
+    }
+    return ret;
+}
+
+/*
+ *  Discard every cached image with a key that begins with the prefix.
+ */
++(void) discardCachedImagesWithKeyPrefix:(NSString *) prefix
+{
+    [icScaled removeImagesWithKeyPrefix:prefix];
+}
+
+/*
+ *  Discard all the cached images.
+ *  - some of these are decrypted content, so this must be done whenever the vault is closed.
+ */
++(void) releaseCachedImages
+{
+    [icScaled removeAllImages];
+}
+
+/*
+ *  Return a description of the image cache's effectiveness.
+ */
++(NSString *) cachedImageStatistics
+{
+    return [icScaled statisticsDescription];
+}
 @end
 
 /***********************
@@ -345,5 +496,57 @@ static NSUInteger PHSC_MAX_COLL_IMAGE_SIDE     = 64;        //  in points
     CGImageRelease(imgInFile);
     return ret;
 }
-@end
 
+/*
+ *  Draw the image into a new four channel bitmap at its full size.
+ *  - the bitmap is returned retained.
+ */
++(NSMutableData *) newBitmapFromImage:(CGImageRef) image withError:(NSError **) err
+{
+    size_t w                   = CGImageGetWidth(image);
+    size_t h                   = CGImageGetHeight(image);
+    NSMutableData *mdRet       = [[NSMutableData alloc] initWithLength:w * h * 4];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef targetContext = CGBitmapContextCreate([mdRet mutableBytes], w, h, 8, w * 4, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(colorSpace);
+    if (!targetContext) {
+        [mdRet release];
+        [CS_error fillError:err withCode:CSErrorAborted andFailureReason:@"Unexpected Quartz failure to create a new bitmap context."];
+        return nil;
+    }
+    CGContextSetBlendMode(targetContext, kCGBlendModeCopy);
+    CGContextDrawImage(targetContext, CGRectMake(0.0f, 0.0f, w, h), image);
+    CGContextRelease(targetContext);
+    return mdRet;
+}
+
+/*
+ *  Create an image from a four channel bitmap.
+ *  - an opaque image ignores the alpha channel, which leaves transparent areas black just as when an image
+ *    is drawn into an opaque context.
+ */
++(UIImage *) imageFromBitmap:(NSMutableData *) mdBitmap ofWidth:(size_t) width andHeight:(size_t) height withScale:(CGFloat) scale
+              andOrientation:(UIImageOrientation) orient asOpaque:(BOOL) isOpaque andError:(NSError **) err
+{
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo    = (isOpaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst) | kCGBitmapByteOrder32Little;
+    CGContextRef targetContext = CGBitmapContextCreate([mdBitmap mutableBytes], width, height, 8, width * 4, colorSpace, bitmapInfo);
+    CGColorSpaceRelease(colorSpace);
+    if (!targetContext) {
+        [CS_error fillError:err withCode:CSErrorAborted andFailureReason:@"Unexpected Quartz failure to create a new bitmap context."];
+        return nil;
+    }
+    
+    UIImage *retImg        = nil;
+    CGImageRef outputImage = CGBitmapContextCreateImage(targetContext);
+    if (outputImage) {
+        retImg = [UIImage imageWithCGImage:outputImage scale:scale orientation:orient];
+        CGImageRelease(outputImage);
+    }
+    else {
+        [CS_error fillError:err withCode:CSErrorAborted andFailureReason:@"Unexpected Quartz failure to create an image from a bitmap context."];
+    }
+    CGContextRelease(targetContext);
+    return retImg;
+}
+@end
@@ -0,0 +1,23 @@
+//
+//  CS_imageCache.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+// - a size-bounded LRU of decoded images, charged by the memory their bitmaps occupy.
+// - keys are arbitrary strings, which allows related variants of one source to be discarded together by prefix.
+@interface CS_imageCache : NSObject
+-(id) initWithByteLimit:(NSUInteger) limit;
+-(UIImage *) imageForKey:(NSString *) key;
+-(void) setImage:(UIImage *) img forKey:(NSString *) key;
+-(void) removeImageForKey:(NSString *) key;
+-(void) removeImagesWithKeyPrefix:(NSString *) prefix;
+-(void) removeAllImages;
+-(NSUInteger) numberOfResidentBytes;
+-(NSString *) statisticsDescription;
+-(void) resetStatistics;
+@end
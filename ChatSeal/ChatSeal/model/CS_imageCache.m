@@ -0,0 +1,322 @@
+//
+//  CS_imageCache.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_imageCache.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - the recency list is intrusive and its links are not retained.  The key dictionary owns every entry.
+
+// - a single image in the cache.
+@interface _S_ic_entry : NSObject
+@property (nonatomic, retain) NSString *key;
+@property (nonatomic, retain) UIImage *image;
+@property (nonatomic, assign) NSUInteger cost;
+@property (nonatomic, assign) _S_ic_entry *prev;
+@property (nonatomic, assign) _S_ic_entry *next;
+@end
+
+// - forward declarations
+@interface CS_imageCache (internal)
++(NSUInteger) costOfImage:(UIImage *) img;
+-(void) linkEntryAtHeadWithoutLock:(_S_ic_entry *) entry;
+-(void) unlinkEntryWithoutLock:(_S_ic_entry *) entry;
+-(void) discardEntryWithoutLock:(_S_ic_entry *) entry;
+-(void) enforceLimitWithoutLock;
+@end
+
+/*************************
+ CS_imageCache
+ *************************/
+@implementation CS_imageCache
+/*
+ *  Object attributes.
+ */
+{
+    NSUInteger          byteLimit;
+    NSUInteger          numResident;
+    NSMutableDictionary *mdEntries;                 //  key --> entry
+    _S_ic_entry         *head;                      //  most recently used
+    _S_ic_entry         *tail;                      //  least recently used
+    NSUInteger          numHits;
+    NSUInteger          numMisses;
+    NSUInteger          numEvictions;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithByteLimit:(NSUInteger) limit
+{
+    self = [super init];
+    if (self) {
+        byteLimit   = limit;
+        numResident = 0;
+        mdEntries   = [[NSMutableDictionary alloc] init];
+        head        = nil;
+        tail        = nil;
+        [self resetStatistics];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    head = tail = nil;
+    
+    [mdEntries release];
+    mdEntries = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Return the image for the key if it is resident.
+ */
+-(UIImage *) imageForKey:(NSString *) key
+{
+    if (!key) {
+        return nil;
+    }
+    
+    @synchronized (self) {
+        _S_ic_entry *entry = [mdEntries objectForKey:key];
+        if (!entry) {
+            numMisses++;
+            return nil;
+        }
+        
+        numHits++;
+        if (entry != head) {
+            [self unlinkEntryWithoutLock:entry];
+            [self linkEntryAtHeadWithoutLock:entry];
+        }
+        return [[entry.image retain] autorelease];
+    }
+}
+
+/*
+ *  Save an image for the key, replacing any prior image.
+ *  - an image larger than the entire cache is not kept.
+ */
+-(void) setImage:(UIImage *) img forKey:(NSString *) key
+{
+    if (!img || !key) {
+        return;
+    }
+    
+    NSUInteger cost = [CS_imageCache costOfImage:img];
+    @synchronized (self) {
+        _S_ic_entry *entry = [mdEntries objectForKey:key];
+        if (entry) {
+            [self discardEntryWithoutLock:entry];
+        }
+        if (cost > byteLimit) {
+            return;
+        }
+        
+        entry       = [[[_S_ic_entry alloc] init] autorelease];
+        entry.key   = key;
+        entry.image = img;
+        entry.cost  = cost;
+        [mdEntries setObject:entry forKey:key];
+        numResident += cost;
+        [self linkEntryAtHeadWithoutLock:entry];
+        [self enforceLimitWithoutLock];
+    }
+}
+
+/*
+ *  Discard the image for the key.
+ */
+-(void) removeImageForKey:(NSString *) key
+{
+    if (!key) {
+        return;
+    }
+    
+    @synchronized (self) {
+        _S_ic_entry *entry = [mdEntries objectForKey:key];
+        if (entry) {
+            [self discardEntryWithoutLock:entry];
+        }
+    }
+}
+
+/*
+ *  Discard every image with a key that begins with the prefix.
+ */
+-(void) removeImagesWithKeyPrefix:(NSString *) prefix
+{
+    if (!prefix) {
+        return;
+    }
+    
+    @synchronized (self) {
+        NSArray *arrKeys = [mdEntries allKeys];
+        for (NSString *key in arrKeys) {
+            if ([key hasPrefix:prefix]) {
+                [self discardEntryWithoutLock:[mdEntries objectForKey:key]];
+            }
+        }
+    }
+}
+
+/*
+ *  Discard every image.
+ */
+-(void) removeAllImages
+{
+    @synchronized (self) {
+        head        = nil;
+        tail        = nil;
+        numResident = 0;
+        [mdEntries removeAllObjects];
+    }
+}
+
+/*
+ *  Return the number of bitmap bytes held by the cache.
+ */
+-(NSUInteger) numberOfResidentBytes
+{
+    @synchronized (self) {
+        return numResident;
+    }
+}
+
+/*
+ *  Return a summary of the cache's effectiveness.
+ */
+-(NSString *) statisticsDescription
+{
+    @synchronized (self) {
+        NSUInteger numReads = numHits + numMisses;
+        return [NSString stringWithFormat:@"%u hits, %u misses (%4.1f%% hit rate), %u evictions, %u images using %u of %u bytes",
+                (unsigned) numHits, (unsigned) numMisses, numReads ? ((double) numHits * 100.0) / (double) numReads : 0.0, (unsigned) numEvictions,
+                (unsigned) [mdEntries count], (unsigned) numResident, (unsigned) byteLimit];
+    }
+}
+
+/*
+ *  Reset the counters.
+ */
+-(void) resetStatistics
+{
+    @synchronized (self) {
+        numHits      = 0;
+        numMisses    = 0;
+        numEvictions = 0;
+    }
+}
+@end
+
+/*************************
+ CS_imageCache (internal)
+ *************************/
+@implementation CS_imageCache (internal)
+/*
+ *  Return the amount of memory used by the image's bitmap.
+ */
++(NSUInteger) costOfImage:(UIImage *) img
+{
+    CGImageRef cgImage = [img CGImage];
+    if (!cgImage) {
+        return 0;
+    }
+    return (NSUInteger) (CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage));
+}
+
+/*
+ *  Make the entry the most recently used.
+ */
+-(void) linkEntryAtHeadWithoutLock:(_S_ic_entry *) entry
+{
+    entry.prev = nil;
+    entry.next = head;
+    if (head) {
+        head.prev = entry;
+    }
+    head = entry;
+    if (!tail) {
+        tail = entry;
+    }
+}
+
+/*
+ *  Remove the entry from the recency list.
+ */
+-(void) unlinkEntryWithoutLock:(_S_ic_entry *) entry
+{
+    if (entry.prev) {
+        entry.prev.next = entry.next;
+    }
+    else if (head == entry) {
+        head = entry.next;
+    }
+    
+    if (entry.next) {
+        entry.next.prev = entry.prev;
+    }
+    else if (tail == entry) {
+        tail = entry.prev;
+    }
+    entry.prev = nil;
+    entry.next = nil;
+}
+
+/*
+ *  Remove the entry from the cache entirely.
+ */
+-(void) discardEntryWithoutLock:(_S_ic_entry *) entry
+{
+    [[entry retain] autorelease];
+    [self unlinkEntryWithoutLock:entry];
+    numResident -= entry.cost;
+    [mdEntries removeObjectForKey:entry.key];
+}
+
+/*
+ *  Discard the least recently used images until the cache fits within its limit.
+ */
+-(void) enforceLimitWithoutLock
+{
+    while (numResident > byteLimit && tail) {
+        [self discardEntryWithoutLock:tail];
+        numEvictions++;
+    }
+}
+@end
+
+/*************************
+ _S_ic_entry
+ *************************/
+@implementation _S_ic_entry
+@synthesize key;
+@synthesize image;
+@synthesize cost;
+@synthesize prev;
+@synthesize next;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [key release];
+    key = nil;
+    
+    [image release];
+    image = nil;
+    
+    [super dealloc];
+}
+@end
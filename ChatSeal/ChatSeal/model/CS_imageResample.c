@@ -0,0 +1,459 @@
+//
+//  CS_imageResample.c
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "CS_imageResample.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CS_IR_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CS_IR_SSE2 1
+#endif
+
+//  NOTES:
+//  - the resampling is separable, so the rows are first filtered horizontally into an intermediate buffer that
+//    has the target width and the source height, which is then filtered vertically into the target.
+//  - when reducing, the filter is widened by the scale factor so that every source pixel contributes to the
+//    result.  This is what prevents the aliasing that a simple point or two-tap sample produces.
+//  - the weights are fixed point so that the vector and scalar versions produce identical output.  Each
+//    vector multiply-add handles two taps at once.
+//  - a standalone benchmark is included at the bottom of this file and may be built on any host with:
+//        cc -O2 -DCS_IR_STANDALONE_BENCHMARK CS_imageResample.c -lm
+
+// - constants
+#define CS_IR_PRECISION    14
+#define CS_IR_ONE          (1 << CS_IR_PRECISION)
+#define CS_IR_ROUND        (1 << (CS_IR_PRECISION - 1))
+#define CS_IR_CHANNELS     4
+
+// - the weights for every output position along one axis.
+typedef struct {
+    size_t  *first;                     //  first source position for each output.
+    int     *count;                     //  number of source positions for each output.
+    int16_t *weights;                   //  count weights for each output, at a stride of maxTaps.
+    int     maxTaps;
+} cs_ir_kernel_t;
+
+/*
+ *  Triangle filter.
+ */
+static double CS_ir_bilinear(double x)
+{
+    x = fabs(x);
+    return (x < 1.0) ? 1.0 - x : 0.0;
+}
+
+/*
+ *  Normalized sinc.
+ */
+static double CS_ir_sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+/*
+ *  Lanczos filter with three lobes.
+ */
+static double CS_ir_lanczos3(double x)
+{
+    if (x <= -3.0 || x >= 3.0) {
+        return 0.0;
+    }
+    return CS_ir_sinc(x) * CS_ir_sinc(x / 3.0);
+}
+
+/*
+ *  Free the weights for one axis.
+ */
+static void CS_ir_freeKernel(cs_ir_kernel_t *kernel)
+{
+    free(kernel->first);
+    free(kernel->count);
+    free(kernel->weights);
+    memset(kernel, 0, sizeof(cs_ir_kernel_t));
+}
+
+/*
+ *  Compute the weights for resampling one axis.
+ */
+static int CS_ir_buildKernel(size_t inLen, size_t outLen, cs_ir_filter_t filter, cs_ir_kernel_t *kernel)
+{
+    double (*fn)(double) = (filter == CS_IR_FILTER_LANCZOS3) ? CS_ir_lanczos3 : CS_ir_bilinear;
+    double radius        = (filter == CS_IR_FILTER_LANCZOS3) ? 3.0 : 1.0;
+    double scale         = (double) inLen / (double) outLen;
+    double filterScale   = (scale > 1.0) ? scale : 1.0;
+    double support       = radius * filterScale;
+    
+    memset(kernel, 0, sizeof(cs_ir_kernel_t));
+    kernel->maxTaps = (int) ceil(support) * 2 + 1;
+    kernel->first   = (size_t *) malloc(outLen * sizeof(size_t));
+    kernel->count   = (int *) malloc(outLen * sizeof(int));
+    kernel->weights = (int16_t *) calloc(outLen * (size_t) kernel->maxTaps, sizeof(int16_t));
+    double *wTmp    = (double *) malloc((size_t) kernel->maxTaps * sizeof(double));
+    if (!kernel->first || !kernel->count || !kernel->weights || !wTmp) {
+        free(wTmp);
+        CS_ir_freeKernel(kernel);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < outLen; i++) {
+        double center = ((double) i + 0.5) * scale;
+        long   lo     = (long) floor(center - support + 0.5);
+        long   hi     = (long) floor(center + support + 0.5);
+        if (lo < 0) {
+            lo = 0;
+        }
+        if (hi > (long) inLen) {
+            hi = (long) inLen;
+        }
+        int count = (int) (hi - lo);
+        if (count > kernel->maxTaps) {
+            count = kernel->maxTaps;
+        }
+        
+        double total = 0.0;
+        for (int k = 0; k < count; k++) {
+            wTmp[k] = fn(((double) (lo + k) - center + 0.5) / filterScale);
+            total  += wTmp[k];
+        }
+        
+        // - the rounding error is given to the largest weight so that a flat image stays flat.
+        int16_t *w   = kernel->weights + (i * (size_t) kernel->maxTaps);
+        int sum      = 0;
+        int largest  = 0;
+        for (int k = 0; k < count; k++) {
+            w[k] = (int16_t) lround(total != 0.0 ? (wTmp[k] / total) * (double) CS_IR_ONE : 0.0);
+            sum += w[k];
+            if (w[k] > w[largest]) {
+                largest = k;
+            }
+        }
+        if (count) {
+            w[largest] = (int16_t) (w[largest] + (CS_IR_ONE - sum));
+        }
+        kernel->first[i] = (size_t) lo;
+        kernel->count[i] = count;
+    }
+    free(wTmp);
+    return 0;
+}
+
+/*
+ *  Convert an accumulated channel to a byte.
+ */
+static inline uint8_t CS_ir_clamp(int32_t acc)
+{
+    acc >>= CS_IR_PRECISION;
+    return (uint8_t) (acc < 0 ? 0 : (acc > 255 ? 255 : acc));
+}
+
+/*
+ *  Filter one row horizontally.
+ */
+static void CS_ir_horizontalRow(const uint8_t *src, uint8_t *dst, size_t dstWidth, const cs_ir_kernel_t *kernel, int allowVector)
+{
+    for (size_t x = 0; x < dstWidth; x++) {
+        const uint8_t *p = src + (kernel->first[x] * CS_IR_CHANNELS);
+        const int16_t *w = kernel->weights + (x * (size_t) kernel->maxTaps);
+        int count        = kernel->count[x];
+        uint8_t *out     = dst + (x * CS_IR_CHANNELS);
+
+#if defined(CS_IR_SSE2)
+        if (allowVector) {
+            // - interleaving two pixels lets each multiply-add combine the same channel from both taps.
+            __m128i vZero = _mm_setzero_si128();
+            __m128i vAcc  = _mm_set1_epi32(CS_IR_ROUND);
+            int k         = 0;
+            for (; k + 1 < count; k += 2) {
+                int32_t p0, p1;
+                memcpy(&p0, p + (k * CS_IR_CHANNELS), sizeof(p0));
+                memcpy(&p1, p + ((k + 1) * CS_IR_CHANNELS), sizeof(p1));
+                __m128i vPix = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p0), _mm_cvtsi32_si128(p1)), vZero);
+                __m128i vW   = _mm_set1_epi32((int32_t) (((uint32_t) (uint16_t) w[k + 1] << 16) | (uint16_t) w[k]));
+                vAcc         = _mm_add_epi32(vAcc, _mm_madd_epi16(vPix, vW));
+            }
+            if (k < count) {
+                int32_t p0;
+                memcpy(&p0, p + (k * CS_IR_CHANNELS), sizeof(p0));
+                __m128i vPix = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p0), vZero), vZero);
+                __m128i vW   = _mm_set1_epi32((int32_t) (uint16_t) w[k]);
+                vAcc         = _mm_add_epi32(vAcc, _mm_madd_epi16(vPix, vW));
+            }
+            vAcc           = _mm_srai_epi32(vAcc, CS_IR_PRECISION);
+            vAcc           = _mm_packs_epi32(vAcc, vAcc);
+            int32_t result = _mm_cvtsi128_si32(_mm_packus_epi16(vAcc, vAcc));
+            memcpy(out, &result, sizeof(result));
+            continue;
+        }
+#elif defined(CS_IR_NEON)
+        if (allowVector) {
+            int32x4_t vAcc = vdupq_n_s32(CS_IR_ROUND);
+            int k          = 0;
+            for (; k + 1 < count; k += 2) {
+                int16x8_t vPix = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p + (k * CS_IR_CHANNELS))));
+                vAcc           = vmlal_n_s16(vAcc, vget_low_s16(vPix), w[k]);
+                vAcc           = vmlal_n_s16(vAcc, vget_high_s16(vPix), w[k + 1]);
+            }
+            if (k < count) {
+                uint32_t p0;
+                memcpy(&p0, p + (k * CS_IR_CHANNELS), sizeof(p0));
+                int16x8_t vPix = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(p0))));
+                vAcc           = vmlal_n_s16(vAcc, vget_low_s16(vPix), w[k]);
+            }
+            int16x4_t vNarrow = vqmovn_s32(vshrq_n_s32(vAcc, CS_IR_PRECISION));
+            uint8x8_t vBytes  = vqmovun_s16(vcombine_s16(vNarrow, vNarrow));
+            vst1_lane_u32((uint32_t *) (void *) out, vreinterpret_u32_u8(vBytes), 0);
+            continue;
+        }
+#endif
+        int32_t acc[CS_IR_CHANNELS] = {CS_IR_ROUND, CS_IR_ROUND, CS_IR_ROUND, CS_IR_ROUND};
+        for (int k = 0; k < count; k++) {
+            const uint8_t *px = p + (k * CS_IR_CHANNELS);
+            for (int c = 0; c < CS_IR_CHANNELS; c++) {
+                acc[c] += (int32_t) px[c] * w[k];
+            }
+        }
+        for (int c = 0; c < CS_IR_CHANNELS; c++) {
+            out[c] = CS_ir_clamp(acc[c]);
+        }
+    }
+}
+
+/*
+ *  Filter one output row vertically from the intermediate rows.
+ */
+static void CS_ir_verticalRow(const uint8_t *tmp, size_t tmpBytesPerRow, size_t rowLen, uint8_t *dst, size_t first, int count,
+                              const int16_t *w, int allowVector)
+{
+    const uint8_t *base = tmp + (first * tmpBytesPerRow);
+    size_t i            = 0;
+
+#if defined(CS_IR_SSE2)
+    if (allowVector) {
+        __m128i vZero = _mm_setzero_si128();
+        for (; i + 8 <= rowLen; i += 8) {
+            __m128i vAccLo = _mm_set1_epi32(CS_IR_ROUND);
+            __m128i vAccHi = vAccLo;
+            int k          = 0;
+            for (; k + 1 < count; k += 2) {
+                __m128i vA  = _mm_loadl_epi64((const __m128i *) (const void *) (base + ((size_t) k * tmpBytesPerRow) + i));
+                __m128i vB  = _mm_loadl_epi64((const __m128i *) (const void *) (base + ((size_t) (k + 1) * tmpBytesPerRow) + i));
+                __m128i vAB = _mm_unpacklo_epi8(vA, vB);
+                __m128i vW  = _mm_set1_epi32((int32_t) (((uint32_t) (uint16_t) w[k + 1] << 16) | (uint16_t) w[k]));
+                vAccLo      = _mm_add_epi32(vAccLo, _mm_madd_epi16(_mm_unpacklo_epi8(vAB, vZero), vW));
+                vAccHi      = _mm_add_epi32(vAccHi, _mm_madd_epi16(_mm_unpackhi_epi8(vAB, vZero), vW));
+            }
+            if (k < count) {
+                __m128i vA  = _mm_loadl_epi64((const __m128i *) (const void *) (base + ((size_t) k * tmpBytesPerRow) + i));
+                __m128i vAB = _mm_unpacklo_epi8(vA, vZero);
+                __m128i vW  = _mm_set1_epi32((int32_t) (uint16_t) w[k]);
+                vAccLo      = _mm_add_epi32(vAccLo, _mm_madd_epi16(_mm_unpacklo_epi8(vAB, vZero), vW));
+                vAccHi      = _mm_add_epi32(vAccHi, _mm_madd_epi16(_mm_unpackhi_epi8(vAB, vZero), vW));
+            }
+            __m128i vPacked = _mm_packs_epi32(_mm_srai_epi32(vAccLo, CS_IR_PRECISION), _mm_srai_epi32(vAccHi, CS_IR_PRECISION));
+            _mm_storel_epi64((__m128i *) (void *) (dst + i), _mm_packus_epi16(vPacked, vPacked));
+        }
+    }
+#elif defined(CS_IR_NEON)
+    if (allowVector) {
+        for (; i + 8 <= rowLen; i += 8) {
+            int32x4_t vAccLo = vdupq_n_s32(CS_IR_ROUND);
+            int32x4_t vAccHi = vAccLo;
+            for (int k = 0; k < count; k++) {
+                int16x8_t vRow = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(base + ((size_t) k * tmpBytesPerRow) + i)));
+                vAccLo         = vmlal_n_s16(vAccLo, vget_low_s16(vRow), w[k]);
+                vAccHi         = vmlal_n_s16(vAccHi, vget_high_s16(vRow), w[k]);
+            }
+            int16x8_t vNarrow = vcombine_s16(vqmovn_s32(vshrq_n_s32(vAccLo, CS_IR_PRECISION)), vqmovn_s32(vshrq_n_s32(vAccHi, CS_IR_PRECISION)));
+            vst1_u8(dst + i, vqmovun_s16(vNarrow));
+        }
+    }
+#endif
+    
+    for (; i < rowLen; i++) {
+        int32_t acc = CS_IR_ROUND;
+        for (int k = 0; k < count; k++) {
+            acc += (int32_t) base[((size_t) k * tmpBytesPerRow) + i] * w[k];
+        }
+        dst[i] = CS_ir_clamp(acc);
+    }
+}
+
+/*
+ *  Resample a four channel image into the target buffer.
+ *  - returns zero on success.
+ */
+int CS_ir_resampleRGBA(const uint8_t *src, size_t srcWidth, size_t srcHeight, size_t srcBytesPerRow,
+                       uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstBytesPerRow,
+                       cs_ir_filter_t filter, int allowVector)
+{
+    if (!src || !dst || !srcWidth || !srcHeight || !dstWidth || !dstHeight ||
+        srcBytesPerRow < srcWidth * CS_IR_CHANNELS || dstBytesPerRow < dstWidth * CS_IR_CHANNELS) {
+        return -1;
+    }
+    
+    // - an axis that isn't changing is passed through unfiltered.
+    const uint8_t *tmp    = src;
+    uint8_t *tmpAlloc     = NULL;
+    size_t tmpBytesPerRow = srcBytesPerRow;
+    if (srcWidth != dstWidth) {
+        cs_ir_kernel_t kh;
+        if (CS_ir_buildKernel(srcWidth, dstWidth, filter, &kh) != 0) {
+            return -1;
+        }
+        tmpBytesPerRow = dstWidth * CS_IR_CHANNELS;
+        tmpAlloc       = (uint8_t *) malloc(tmpBytesPerRow * srcHeight);
+        if (!tmpAlloc) {
+            CS_ir_freeKernel(&kh);
+            return -1;
+        }
+        for (size_t y = 0; y < srcHeight; y++) {
+            CS_ir_horizontalRow(src + (y * srcBytesPerRow), tmpAlloc + (y * tmpBytesPerRow), dstWidth, &kh, allowVector);
+        }
+        CS_ir_freeKernel(&kh);
+        tmp = tmpAlloc;
+    }
+    
+    int ret = 0;
+    if (srcHeight != dstHeight) {
+        cs_ir_kernel_t kv;
+        if (CS_ir_buildKernel(srcHeight, dstHeight, filter, &kv) == 0) {
+            for (size_t y = 0; y < dstHeight; y++) {
+                CS_ir_verticalRow(tmp, tmpBytesPerRow, dstWidth * CS_IR_CHANNELS, dst + (y * dstBytesPerRow), kv.first[y], kv.count[y],
+                                  kv.weights + (y * (size_t) kv.maxTaps), allowVector);
+            }
+            CS_ir_freeKernel(&kv);
+        }
+        else {
+            ret = -1;
+        }
+    }
+    else {
+        for (size_t y = 0; y < dstHeight; y++) {
+            memcpy(dst + (y * dstBytesPerRow), tmp + (y * tmpBytesPerRow), dstWidth * CS_IR_CHANNELS);
+        }
+    }
+    
+    free(tmpAlloc);
+    return ret;
+}
+
+/*
+ *  Compute the dimensions that fit within the maximum side while preserving the aspect ratio.
+ *  - images are never enlarged.
+ */
+void CS_ir_fitToMaximumSide(size_t srcWidth, size_t srcHeight, size_t maxSide, size_t *dstWidth, size_t *dstHeight)
+{
+    size_t w = srcWidth;
+    size_t h = srcHeight;
+    if (maxSide && (w > maxSide || h > maxSide)) {
+        if (w >= h) {
+            h = (size_t) lround(((double) h * (double) maxSide) / (double) w);
+            w = maxSide;
+        }
+        else {
+            w = (size_t) lround(((double) w * (double) maxSide) / (double) h);
+            h = maxSide;
+        }
+    }
+    *dstWidth  = w ? w : 1;
+    *dstHeight = h ? h : 1;
+}
+
+/*
+ *  Returns non-zero when the resampler has a vector implementation on this processor.
+ */
+int CS_ir_isVectorized(void)
+{
+#if defined(CS_IR_SSE2) || defined(CS_IR_NEON)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+#ifdef CS_IR_STANDALONE_BENCHMARK
+#include <stdio.h>
+#include <sys/time.h>
+
+/*
+ *  Return the current time in seconds.
+ */
+static double CS_ir_now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + ((double) tv.tv_usec / 1000000.0);
+}
+
+/*
+ *  Scale a 12 megapixel image to the common thumbnail sizes with both filters.
+ */
+int main(void)
+{
+    static const size_t sides[] = {64, 128, 256, 512, 1024};
+    const size_t srcWidth       = 4032;
+    const size_t srcHeight      = 3024;
+    uint8_t *src                = (uint8_t *) malloc(srcWidth * srcHeight * CS_IR_CHANNELS);
+    uint8_t *dstVec             = (uint8_t *) malloc(1024 * 1024 * CS_IR_CHANNELS);
+    uint8_t *dstScalar          = (uint8_t *) malloc(1024 * 1024 * CS_IR_CHANNELS);
+    if (!src || !dstVec || !dstScalar) {
+        return 1;
+    }
+    
+    // - smooth gradients with some noise look enough like a photo to exercise the filters.
+    uint32_t seed = 1;
+    for (size_t y = 0; y < srcHeight; y++) {
+        for (size_t x = 0; x < srcWidth; x++) {
+            uint8_t *p = src + (((y * srcWidth) + x) * CS_IR_CHANNELS);
+            seed       = (seed * 1103515245) + 12345;
+            p[0]       = (uint8_t) ((x * 255) / srcWidth);
+            p[1]       = (uint8_t) ((y * 255) / srcHeight);
+            p[2]       = (uint8_t) (seed >> 24);
+            p[3]       = 255;
+        }
+    }
+    
+    printf("12 MP (%zux%zu) source, vector support: %s\n", srcWidth, srcHeight, CS_ir_isVectorized() ? "yes" : "no");
+    for (int f = 0; f < 2; f++) {
+        cs_ir_filter_t filter = f ? CS_IR_FILTER_LANCZOS3 : CS_IR_FILTER_BILINEAR;
+        for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++) {
+            size_t dstWidth, dstHeight;
+            CS_ir_fitToMaximumSide(srcWidth, srcHeight, sides[s], &dstWidth, &dstHeight);
+            
+            double times[2];
+            for (int v = 0; v < 2; v++) {
+                double tStart = CS_ir_now();
+                if (CS_ir_resampleRGBA(src, srcWidth, srcHeight, srcWidth * CS_IR_CHANNELS, v ? dstScalar : dstVec, dstWidth, dstHeight,
+                                       dstWidth * CS_IR_CHANNELS, filter, !v) != 0) {
+                    printf("resampling failed\n");
+                    return 1;
+                }
+                times[v] = CS_ir_now() - tStart;
+            }
+            
+            int isSame = !memcmp(dstVec, dstScalar, dstWidth * dstHeight * CS_IR_CHANNELS);
+            printf("%-8s %4zux%-4zu  vector %7.1f ms  scalar %7.1f ms  (%.1fx)%s\n", f ? "lanczos3" : "bilinear", dstWidth, dstHeight,
+                   times[0] * 1000.0, times[1] * 1000.0, times[0] > 0.0 ? times[1] / times[0] : 0.0, isSame ? "" : "  MISMATCH");
+        }
+    }
+    
+    free(src);
+    free(dstVec);
+    free(dstScalar);
+    return 0;
+}
+#endif
@@ -0,0 +1,30 @@
+//
+//  CS_imageResample.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#ifndef ChatSeal_CS_imageResample_h
+#define ChatSeal_CS_imageResample_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+//  - this is plain C with no platform dependencies so that it can be measured and verified on any host.
+//  - buffers are four interleaved 8-bit channels per pixel.  The channel order doesn't matter, but alpha should
+//    be premultiplied, which is how Quartz draws them.
+
+typedef enum {
+    CS_IR_FILTER_BILINEAR = 0,          //  triangle filter, widened by the scale factor when reducing.
+    CS_IR_FILTER_LANCZOS3 = 1           //  three-lobed windowed sinc, also widened when reducing.
+} cs_ir_filter_t;
+
+int CS_ir_resampleRGBA(const uint8_t *src, size_t srcWidth, size_t srcHeight, size_t srcBytesPerRow,
+                       uint8_t *dst, size_t dstWidth, size_t dstHeight, size_t dstBytesPerRow,
+                       cs_ir_filter_t filter, int allowVector);
+void CS_ir_fitToMaximumSide(size_t srcWidth, size_t srcHeight, size_t maxSide, size_t *dstWidth, size_t *dstHeight);
+int CS_ir_isVectorized(void);
+
+#endif
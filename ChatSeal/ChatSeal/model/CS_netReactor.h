@@ -0,0 +1,30 @@
+//
+//  CS_netReactor.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/26/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CS_netReactor;
+@protocol CS_netReactorTarget <NSObject>
+-(void) reactor:(CS_netReactor *) reactor descriptorIsReadable:(int) fd withAvailable:(NSUInteger) numAvail atEnd:(BOOL) isAtEnd;
+@optional
+-(void) reactor:(CS_netReactor *) reactor descriptorIsWritable:(int) fd;
+@end
+
+// - the reactor delivers socket readiness from a single kqueue through the run loop of the thread
+//   that created it so that its targets are called with the same serialization as timers and streams.
+// - readiness is edge-triggered, which means that a target must consume everything it is told about
+//   or it won't be notified again until more arrives.
+@interface CS_netReactor : NSObject
++(CS_netReactor *) reactorForCurrentRunLoop;
+-(BOOL) watchDescriptor:(int) fd forTarget:(id<CS_netReactorTarget>) target withError:(NSError **) err;
+-(void) setWriteInterest:(BOOL) isInterested forDescriptor:(int) fd;
+-(void) unwatchDescriptor:(int) fd;
+-(ssize_t) readFromDescriptor:(int) fd intoBuffer:(void *) buf ofLength:(size_t) len withOverflow:(NSMutableData *) mdOverflow;
+-(NSUInteger) numberOfWakeups;
+-(NSUInteger) numberOfEvents;
+@end
@@ -0,0 +1,309 @@
+//
+//  CS_netReactor.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/26/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#include <sys/event.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#import "CS_netReactor.h"
+#import "ChatSeal.h"
+
+//  THREADING-NOTES:
+//  - there is one reactor per thread and it must only be used from the thread that created it, which is why
+//    there is no locking.
+//  - the kqueue is itself a descriptor, which allows it to be watched by the run loop like any other.  The run
+//    loop wakes us when at least one event is pending and then we drain them in batches.
+
+// - constants
+static NSString         *CS_NR_THREAD_KEY  = @"CS_netReactor";
+static const int        CS_NR_MAX_EVENTS   = 64;
+static const NSUInteger CS_NR_OVERFLOW_LEN = (64 * 1024);
+
+// - forward declarations
+@interface CS_netReactor (internal)
+-(BOOL) attachToCurrentRunLoop;
+-(void) processEvents;
+@end
+
+/*
+ *  The run loop has detected activity on the kqueue.
+ */
+static void CS_nr_kqueueCallback(CFFileDescriptorRef fdref, CFOptionFlags callBackTypes, void *info)
+{
+    CS_netReactor *reactor = (CS_netReactor *) info;
+    [reactor processEvents];
+}
+
+/*************************
+ CS_netReactor
+ *************************/
+@implementation CS_netReactor
+/*
+ *  Object attributes.
+ */
+{
+    int                 kq;
+    CFFileDescriptorRef cffdQueue;
+    CFRunLoopSourceRef  rlsQueue;
+    NSMutableDictionary *mdTargets;                 //  descriptor --> non-retained target
+    uint8_t             *overflowBuf;               //  shared by every read because they happen one at a time.
+    NSUInteger          numWakeups;
+    NSUInteger          numEvents;
+}
+
+/*
+ *  Return the reactor for the current thread, creating it if necessary.
+ */
++(CS_netReactor *) reactorForCurrentRunLoop
+{
+    NSMutableDictionary *mdThread = [[NSThread currentThread] threadDictionary];
+    CS_netReactor *reactor        = [mdThread objectForKey:CS_NR_THREAD_KEY];
+    if (!reactor) {
+        reactor = [[[CS_netReactor alloc] init] autorelease];
+        if (![reactor attachToCurrentRunLoop]) {
+            return nil;
+        }
+        [mdThread setObject:reactor forKey:CS_NR_THREAD_KEY];
+    }
+    return [[reactor retain] autorelease];
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    self = [super init];
+    if (self) {
+        kq          = -1;
+        cffdQueue   = NULL;
+        rlsQueue    = NULL;
+        mdTargets   = [[NSMutableDictionary alloc] init];
+        overflowBuf = (uint8_t *) malloc(CS_NR_OVERFLOW_LEN);
+        numWakeups  = 0;
+        numEvents   = 0;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    if (rlsQueue) {
+        CFRunLoopSourceInvalidate(rlsQueue);
+        CFRelease(rlsQueue);
+        rlsQueue = NULL;
+    }
+    
+    // - the kqueue is closed when its descriptor object is invalidated.
+    if (cffdQueue) {
+        CFFileDescriptorInvalidate(cffdQueue);
+        CFRelease(cffdQueue);
+        cffdQueue = NULL;
+    }
+    else if (kq != -1) {
+        close(kq);
+    }
+    kq = -1;
+    
+    [mdTargets release];
+    mdTargets = nil;
+    
+    if (overflowBuf) {
+        free(overflowBuf);
+        overflowBuf = NULL;
+    }
+    
+    [super dealloc];
+}
+
+/*
+ *  Begin delivering events for the descriptor to the target.
+ *  - the target is not retained and must unwatch the descriptor before it is freed.
+ *  - write readiness is not reported until it is requested with setWriteInterest.
+ */
+-(BOOL) watchDescriptor:(int) fd forTarget:(id<CS_netReactorTarget>) target withError:(NSError **) err
+{
+    if (fd == -1 || !target) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument];
+        return NO;
+    }
+    
+    struct kevent kev[2];
+    EV_SET(&(kev[0]), fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, NULL);
+    EV_SET(&(kev[1]), fd, EVFILT_WRITE, EV_ADD | EV_CLEAR | EV_DISABLE, 0, 0, NULL);
+    if (kevent(kq, kev, 2, NULL, 0, NULL) == -1) {
+        NSString *failReason = [NSString stringWithFormat:@"Failed to watch the descriptor (%d).", errno];
+        [CS_error fillError:err withCode:CSErrorConnectionFailure andFailureReason:failReason];
+        return NO;
+    }
+    
+    [mdTargets setObject:[NSValue valueWithNonretainedObject:target] forKey:[NSNumber numberWithInt:fd]];
+    return YES;
+}
+
+/*
+ *  Enable or disable write readiness events.
+ *  - these are only useful while output is blocked, otherwise they would be delivered constantly.
+ */
+-(void) setWriteInterest:(BOOL) isInterested forDescriptor:(int) fd
+{
+    struct kevent kev;
+    EV_SET(&kev, fd, EVFILT_WRITE, isInterested ? EV_ENABLE : EV_DISABLE, 0, 0, NULL);
+    kevent(kq, &kev, 1, NULL, 0, NULL);
+}
+
+/*
+ *  Stop delivering events for the descriptor.
+ *  - this must be done before the descriptor is closed so that a recycled descriptor isn't confused with it.
+ */
+-(void) unwatchDescriptor:(int) fd
+{
+    struct kevent kev[2];
+    EV_SET(&(kev[0]), fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    EV_SET(&(kev[1]), fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(kq, kev, 2, NULL, 0, NULL);
+    [mdTargets removeObjectForKey:[NSNumber numberWithInt:fd]];
+}
+
+/*
+ *  Read from the descriptor into the caller's buffer and append anything that didn't fit to the overflow.
+ *  - a single vectored read pulls in more than the caller expected when it is available, which saves
+ *    a system call for every extra block.
+ */
+-(ssize_t) readFromDescriptor:(int) fd intoBuffer:(void *) buf ofLength:(size_t) len withOverflow:(NSMutableData *) mdOverflow
+{
+    struct iovec iov[2];
+    int numVec = 0;
+    if (buf && len) {
+        iov[numVec].iov_base = buf;
+        iov[numVec].iov_len  = len;
+        numVec++;
+    }
+    if (mdOverflow) {
+        iov[numVec].iov_base = overflowBuf;
+        iov[numVec].iov_len  = CS_NR_OVERFLOW_LEN;
+        numVec++;
+    }
+    if (!numVec) {
+        return 0;
+    }
+    
+    ssize_t numRead = readv(fd, iov, numVec);
+    if (numRead > 0 && (size_t) numRead > len && mdOverflow) {
+        [mdOverflow appendBytes:overflowBuf length:(NSUInteger) numRead - len];
+    }
+    return numRead;
+}
+
+/*
+ *  Return the number of times the run loop woke the reactor.
+ */
+-(NSUInteger) numberOfWakeups
+{
+    return numWakeups;
+}
+
+/*
+ *  Return the number of events that have been delivered.
+ */
+-(NSUInteger) numberOfEvents
+{
+    return numEvents;
+}
+@end
+
+/*************************
+ CS_netReactor (internal)
+ *************************/
+@implementation CS_netReactor (internal)
+/*
+ *  Create the kqueue and schedule it with the current run loop.
+ */
+-(BOOL) attachToCurrentRunLoop
+{
+    kq = kqueue();
+    if (kq == -1) {
+        NSLog(@"CS:  Failed to create a network reactor queue (%d).", errno);
+        return NO;
+    }
+    
+    // - the reactor is owned by the thread and outlives the run loop source, so the context doesn't retain it.
+    CFFileDescriptorContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.info  = self;
+    cffdQueue = CFFileDescriptorCreate(kCFAllocatorDefault, kq, true, CS_nr_kqueueCallback, &ctx);
+    if (!cffdQueue) {
+        NSLog(@"CS:  Failed to wrap the network reactor queue.");
+        return NO;
+    }
+    
+    rlsQueue = CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, cffdQueue, 0);
+    if (!rlsQueue) {
+        NSLog(@"CS:  Failed to schedule the network reactor queue.");
+        return NO;
+    }
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), rlsQueue, kCFRunLoopCommonModes);
+    CFFileDescriptorEnableCallBacks(cffdQueue, kCFFileDescriptorReadCallBack);
+    return YES;
+}
+
+/*
+ *  Deliver all pending events to their targets.
+ */
+-(void) processEvents
+{
+    numWakeups++;
+    
+    // - the targets may free themselves while handling an event so the reactor is retained until this is done.
+    [[self retain] autorelease];
+    
+    struct kevent events[CS_NR_MAX_EVENTS];
+    struct timespec tsNoWait = {0, 0};
+    for (;;) {
+        int numFound = kevent(kq, NULL, 0, events, CS_NR_MAX_EVENTS, &tsNoWait);
+        if (numFound <= 0) {
+            break;
+        }
+        numEvents += (NSUInteger) numFound;
+        
+        @autoreleasepool {
+            for (int i = 0; i < numFound; i++) {
+                // - a prior event in the batch may have caused this one to be unwatched.
+                int fd     = (int) events[i].ident;
+                NSValue *v = [mdTargets objectForKey:[NSNumber numberWithInt:fd]];
+                if (!v) {
+                    continue;
+                }
+                
+                id<CS_netReactorTarget> target = [[[v nonretainedObjectValue] retain] autorelease];
+                if (events[i].filter == EVFILT_WRITE) {
+                    if ([target respondsToSelector:@selector(reactor:descriptorIsWritable:)]) {
+                        [target reactor:self descriptorIsWritable:fd];
+                    }
+                }
+                else {
+                    // - errors are reported as readability so that the target discovers them when it reads.
+                    BOOL isAtEnd = (events[i].flags & (EV_EOF | EV_ERROR)) ? YES : NO;
+                    [target reactor:self descriptorIsReadable:fd withAvailable:(events[i].flags & EV_ERROR) ? 0 : (NSUInteger) events[i].data atEnd:isAtEnd];
+                }
+            }
+        }
+        
+        if (numFound < CS_NR_MAX_EVENTS) {
+            break;
+        }
+    }
+    
+    // - descriptor callbacks are one-shot, so they must be re-armed every time.
+    if (cffdQueue) {
+        CFFileDescriptorEnableCallBacks(cffdQueue, kCFFileDescriptorReadCallBack);
+    }
+}
+@end
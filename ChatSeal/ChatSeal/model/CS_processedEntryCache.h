@@ -0,0 +1,28 @@
+//
+//  CS_processedEntryCache.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - the processed entry cache remembers which feed entries produced which message hashes so that import can
+//   skip them quickly.  It is persisted in the vault one change at a time instead of being rewritten as a whole.
+// - only keyed digests of the hashes and entry ids are stored in the clear.  The entry ids themselves are
+//   encrypted with a key that is saved in the vault.
+@interface CS_processedEntryCache : NSObject
+-(id) initWithBaseName:(NSString *) baseName;
+-(BOOL) isOpen;
+-(BOOL) openWithError:(NSError **) err;
+-(void) close;
+-(BOOL) setEntry:(NSString *) entryId forHash:(NSString *) msgHash withError:(NSError **) err;
+-(NSString *) entryForHash:(NSString *) msgHash;
+-(BOOL) hasEntry:(NSString *) entryId;
+-(BOOL) discardEntry:(NSString *) entryId withError:(NSError **) err;
+-(NSUInteger) count;
+-(BOOL) compactWithError:(NSError **) err;
+-(BOOL) verifyWithError:(NSError **) err;
+-(BOOL) destroyWithError:(NSError **) err;
+@end
@@ -0,0 +1,421 @@
+//
+//  CS_processedEntryCache.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <CommonCrypto/CommonCryptor.h>
+#import <CommonCrypto/CommonHMAC.h>
+#import <Security/Security.h>
+#import "CS_processedEntryCache.h"
+#import "CS_processedEntryStore.h"
+#import "CS_error.h"
+#import "ChatSeal.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+
+// - constants
+static NSString *PEC_TABLE_EXT   = @"tbl";
+static NSString *PEC_LOG_EXT     = @"log";
+static NSString *PEC_KEY_EXT     = @"key";
+#define PEC_DIGEST_KEY_LEN        32
+#define PEC_CIPHER_KEY_LEN        kCCKeySizeAES256
+#define PEC_KEY_LEN               (PEC_DIGEST_KEY_LEN + PEC_CIPHER_KEY_LEN)
+static const uint8_t PEC_HASH_TAG  = 'h';
+static const uint8_t PEC_ENTRY_TAG = 'e';
+
+// - forward declarations
+@interface CS_processedEntryCache (internal)
+-(NSURL *) vaultURLWithExtension:(NSString *) ext andError:(NSError **) err;
+-(BOOL) loadKeyWithError:(NSError **) err;
+-(void) digestOfString:(NSString *) s withTag:(uint8_t) tag intoBuffer:(uint8_t *) digest;
+-(NSData *) encryptedEntry:(NSString *) entryId;
+-(NSString *) decryptedEntry:(const void *) payload ofLength:(size_t) len;
+@end
+
+/***************************
+ CS_processedEntryCache
+ ***************************/
+@implementation CS_processedEntryCache
+/*
+ *  Object attributes.
+ */
+{
+    NSString *baseName;
+    cs_pes_t *pes;
+    uint8_t  key[PEC_KEY_LEN];
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithBaseName:(NSString *) name
+{
+    self = [super init];
+    if (self) {
+        baseName = [name retain];
+        pes      = NULL;
+        memset(key, 0, sizeof(key));
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self close];
+    
+    [baseName release];
+    baseName = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Determine if the cache is ready to use.
+ */
+-(BOOL) isOpen
+{
+    @synchronized (self) {
+        return (pes ? YES : NO);
+    }
+}
+
+/*
+ *  Open the cache from the vault, which must be open itself.
+ */
+-(BOOL) openWithError:(NSError **) err
+{
+    @synchronized (self) {
+        if (pes) {
+            return YES;
+        }
+        
+        if (![self loadKeyWithError:err]) {
+            return NO;
+        }
+        
+        NSURL *uTable = [self vaultURLWithExtension:PEC_TABLE_EXT andError:err];
+        NSURL *uLog   = [self vaultURLWithExtension:PEC_LOG_EXT andError:err];
+        if (!uTable || !uLog) {
+            return NO;
+        }
+        
+        pes = CS_pes_open([[uTable path] fileSystemRepresentation], [[uLog path] fileSystemRepresentation]);
+        if (!pes) {
+            memset(key, 0, sizeof(key));
+            [CS_error fillError:err withCode:CSErrorFilesystemAccessError andFailureReason:@"Failed to open the processed entry store."];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+/*
+ *  Close the cache and forget its key.
+ */
+-(void) close
+{
+    @synchronized (self) {
+        CS_pes_close(pes);
+        pes = NULL;
+        memset(key, 0, sizeof(key));
+    }
+}
+
+/*
+ *  Record that the entry produced the message hash.
+ */
+-(BOOL) setEntry:(NSString *) entryId forHash:(NSString *) msgHash withError:(NSError **) err
+{
+    if (!entryId || !msgHash) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument];
+        return NO;
+    }
+    
+    @synchronized (self) {
+        if (!pes) {
+            [CS_error fillError:err withCode:CSErrorVaultRequired];
+            return NO;
+        }
+        
+        uint8_t hashDigest[CS_PES_DIGEST_LEN];
+        uint8_t entryDigest[CS_PES_DIGEST_LEN];
+        [self digestOfString:msgHash withTag:PEC_HASH_TAG intoBuffer:hashDigest];
+        [self digestOfString:entryId withTag:PEC_ENTRY_TAG intoBuffer:entryDigest];
+        NSData *dEncrypted = [self encryptedEntry:entryId];
+        if (!dEncrypted) {
+            [CS_error fillError:err withCode:CSErrorInvalidArgument andFailureReason:@"The entry could not be encrypted."];
+            return NO;
+        }
+        if (CS_pes_insert(pes, hashDigest, entryDigest, [dEncrypted bytes], [dEncrypted length]) != 0) {
+            [CS_error fillError:err withCode:CSErrorFilesystemAccessError andFailureReason:@"Failed to save the processed entry."];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+/*
+ *  Return the entry that produced the message hash.
+ */
+-(NSString *) entryForHash:(NSString *) msgHash
+{
+    if (!msgHash) {
+        return nil;
+    }
+    
+    @synchronized (self) {
+        if (!pes) {
+            return nil;
+        }
+        
+        uint8_t hashDigest[CS_PES_DIGEST_LEN];
+        const void *payload = NULL;
+        size_t len          = 0;
+        [self digestOfString:msgHash withTag:PEC_HASH_TAG intoBuffer:hashDigest];
+        if (!CS_pes_lookup(pes, hashDigest, &payload, &len)) {
+            return nil;
+        }
+        return [self decryptedEntry:payload ofLength:len];
+    }
+}
+
+/*
+ *  Determine if the entry has produced any message hash.
+ *  - this is a scan of the whole cache.
+ */
+-(BOOL) hasEntry:(NSString *) entryId
+{
+    if (!entryId) {
+        return NO;
+    }
+    
+    @synchronized (self) {
+        if (!pes) {
+            return NO;
+        }
+        
+        uint8_t entryDigest[CS_PES_DIGEST_LEN];
+        [self digestOfString:entryId withTag:PEC_ENTRY_TAG intoBuffer:entryDigest];
+        return (CS_pes_hasValue(pes, entryDigest) ? YES : NO);
+    }
+}
+
+/*
+ *  Forget every message hash produced by the entry.
+ */
+-(BOOL) discardEntry:(NSString *) entryId withError:(NSError **) err
+{
+    if (!entryId) {
+        [CS_error fillError:err withCode:CSErrorInvalidArgument];
+        return NO;
+    }
+    
+    @synchronized (self) {
+        if (!pes) {
+            [CS_error fillError:err withCode:CSErrorVaultRequired];
+            return NO;
+        }
+        
+        uint8_t entryDigest[CS_PES_DIGEST_LEN];
+        [self digestOfString:entryId withTag:PEC_ENTRY_TAG intoBuffer:entryDigest];
+        if (CS_pes_removeValue(pes, entryDigest) < 0) {
+            [CS_error fillError:err withCode:CSErrorFilesystemAccessError andFailureReason:@"Failed to discard the processed entry."];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+/*
+ *  Return the number of message hashes in the cache.
+ */
+-(NSUInteger) count
+{
+    @synchronized (self) {
+        return (NSUInteger) CS_pes_count(pes);
+    }
+}
+
+/*
+ *  Merge all outstanding changes into the table.
+ *  - this happens automatically as the cache grows, so it is only necessary when preparing for a quick startup.
+ */
+-(BOOL) compactWithError:(NSError **) err
+{
+    @synchronized (self) {
+        if (!pes) {
+            [CS_error fillError:err withCode:CSErrorVaultRequired];
+            return NO;
+        }
+        if (CS_pes_compact(pes) != 0) {
+            [CS_error fillError:err withCode:CSErrorFilesystemAccessError andFailureReason:@"Failed to compact the processed entry store."];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+/*
+ *  Confirm that the table is intact.
+ */
+-(BOOL) verifyWithError:(NSError **) err
+{
+    @synchronized (self) {
+        if (!pes) {
+            [CS_error fillError:err withCode:CSErrorVaultRequired];
+            return NO;
+        }
+        if (CS_pes_verify(pes) != 0) {
+            [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"The processed entry table is damaged."];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+/*
+ *  Close the cache and remove its files.
+ */
+-(BOOL) destroyWithError:(NSError **) err
+{
+    @synchronized (self) {
+        [self close];
+        for (NSString *ext in [NSArray arrayWithObjects:PEC_TABLE_EXT, PEC_LOG_EXT, PEC_KEY_EXT, nil]) {
+            NSURL *u = [self vaultURLWithExtension:ext andError:err];
+            if (!u) {
+                return NO;
+            }
+            if ([[NSFileManager defaultManager] fileExistsAtPath:[u path]] && ![[NSFileManager defaultManager] removeItemAtURL:u error:err]) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+}
+@end
+
+/***********************************
+ CS_processedEntryCache (internal)
+ ***********************************/
+@implementation CS_processedEntryCache (internal)
+/*
+ *  Return the location of one of the cache's files.
+ */
+-(NSURL *) vaultURLWithExtension:(NSString *) ext andError:(NSError **) err
+{
+    return [RealSecureImage absoluteURLForVaultFile:[baseName stringByAppendingPathExtension:ext] withError:err];
+}
+
+/*
+ *  Load the cache key from the vault, generating it the first time.
+ */
+-(BOOL) loadKeyWithError:(NSError **) err
+{
+    NSURL *u = [self vaultURLWithExtension:PEC_KEY_EXT andError:err];
+    if (!u) {
+        return NO;
+    }
+    
+    if ([[NSFileManager defaultManager] fileExistsAtPath:[u path]]) {
+        RSISecureData *secD = nil;
+        if (![RealSecureImage readVaultURL:u intoData:&secD withError:err]) {
+            return NO;
+        }
+        if ([secD.rawData length] != PEC_KEY_LEN) {
+            [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"The processed entry key is invalid."];
+            return NO;
+        }
+        memcpy(key, [secD.rawData bytes], PEC_KEY_LEN);
+        return YES;
+    }
+    
+    // - a new key means that anything left over from a prior one is unreadable.
+    NSError *tmp = nil;
+    for (NSString *ext in [NSArray arrayWithObjects:PEC_TABLE_EXT, PEC_LOG_EXT, nil]) {
+        NSURL *uOld = [self vaultURLWithExtension:ext andError:nil];
+        if (uOld && [[NSFileManager defaultManager] fileExistsAtPath:[uOld path]] && ![[NSFileManager defaultManager] removeItemAtURL:uOld error:&tmp]) {
+            NSLog(@"CS:  Failed to discard an orphaned processed entry file.  %@", [tmp localizedDescription]);
+        }
+    }
+    
+    if (SecRandomCopyBytes(kSecRandomDefault, PEC_KEY_LEN, key) != 0) {
+        [CS_error fillError:err withCode:CSErrorSecurityFailure andFailureReason:@"Failed to generate a processed entry key."];
+        return NO;
+    }
+    NSData *dKey = [NSData dataWithBytes:key length:PEC_KEY_LEN];
+    if (![RealSecureImage writeVaultData:dKey toURL:u withError:err]) {
+        memset(key, 0, sizeof(key));
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Compute a keyed digest of the string.
+ *  - the tag ensures that a hash and an entry id with the same text don't produce the same digest.
+ */
+-(void) digestOfString:(NSString *) s withTag:(uint8_t) tag intoBuffer:(uint8_t *) digest
+{
+    uint8_t fullDigest[CC_SHA256_DIGEST_LENGTH];
+    const char *utf8 = [s UTF8String];
+    CCHmacContext ctx;
+    CCHmacInit(&ctx, kCCHmacAlgSHA256, key, PEC_DIGEST_KEY_LEN);
+    CCHmacUpdate(&ctx, &tag, sizeof(tag));
+    CCHmacUpdate(&ctx, utf8, strlen(utf8));
+    CCHmacFinal(&ctx, fullDigest);
+    memcpy(digest, fullDigest, CS_PES_DIGEST_LEN);
+}
+
+/*
+ *  Encrypt the entry id for storage, prefixed by its random initialization vector.
+ */
+-(NSData *) encryptedEntry:(NSString *) entryId
+{
+    NSData *dClear = [entryId dataUsingEncoding:NSUTF8StringEncoding];
+    size_t maxLen  = kCCBlockSizeAES128 + [dClear length] + kCCBlockSizeAES128;
+    if (maxLen > CS_PES_MAX_PAYLOAD) {
+        return nil;
+    }
+    
+    NSMutableData *mdRet = [NSMutableData dataWithLength:maxLen];
+    uint8_t *iv          = (uint8_t *) [mdRet mutableBytes];
+    if (SecRandomCopyBytes(kSecRandomDefault, kCCBlockSizeAES128, iv) != 0) {
+        return nil;
+    }
+    
+    size_t numEncrypted = 0;
+    if (CCCrypt(kCCEncrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, key + PEC_DIGEST_KEY_LEN, PEC_CIPHER_KEY_LEN, iv, [dClear bytes], [dClear length],
+                iv + kCCBlockSizeAES128, maxLen - kCCBlockSizeAES128, &numEncrypted) != kCCSuccess) {
+        return nil;
+    }
+    [mdRet setLength:kCCBlockSizeAES128 + numEncrypted];
+    return mdRet;
+}
+
+/*
+ *  Decrypt a stored entry id.
+ */
+-(NSString *) decryptedEntry:(const void *) payload ofLength:(size_t) len
+{
+    if (len <= kCCBlockSizeAES128) {
+        return nil;
+    }
+    
+    uint8_t clear[CS_PES_MAX_PAYLOAD];
+    size_t numDecrypted = 0;
+    if (CCCrypt(kCCDecrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, key + PEC_DIGEST_KEY_LEN, PEC_CIPHER_KEY_LEN, payload,
+                (const uint8_t *) payload + kCCBlockSizeAES128, len - kCCBlockSizeAES128, clear, sizeof(clear), &numDecrypted) != kCCSuccess) {
+        return nil;
+    }
+    NSString *ret = [[[NSString alloc] initWithBytes:clear length:numDecrypted encoding:NSUTF8StringEncoding] autorelease];
+    memset(clear, 0, sizeof(clear));
+    return ret;
+}
+@end
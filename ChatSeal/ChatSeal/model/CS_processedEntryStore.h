@@ -0,0 +1,38 @@
+//
+//  CS_processedEntryStore.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#ifndef ChatSeal_CS_processedEntryStore_h
+#define ChatSeal_CS_processedEntryStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+//  - this is plain C with no platform dependencies so that it can be measured and verified on any host.
+//  - the store maps a fixed-size key digest to a value digest and an opaque payload.  It never sees the
+//    original strings, so the caller is responsible for producing digests that don't reveal them and for
+//    protecting the payloads.
+//  - every entry points in one direction only, from key to value, but many keys may share a value.
+//  - the store is not thread safe.
+
+#define CS_PES_DIGEST_LEN  16
+#define CS_PES_MAX_PAYLOAD 1024
+
+typedef struct cs_pes cs_pes_t;
+
+cs_pes_t *CS_pes_open(const char *tablePath, const char *logPath);
+void CS_pes_close(cs_pes_t *pes);
+int CS_pes_insert(cs_pes_t *pes, const uint8_t *key, const uint8_t *value, const void *payload, size_t payloadLen);
+int CS_pes_lookup(cs_pes_t *pes, const uint8_t *key, const void **payload, size_t *payloadLen);
+int CS_pes_hasValue(cs_pes_t *pes, const uint8_t *value);
+int CS_pes_removeValue(cs_pes_t *pes, const uint8_t *value);
+int CS_pes_compact(cs_pes_t *pes);
+int CS_pes_verify(cs_pes_t *pes);
+size_t CS_pes_count(cs_pes_t *pes);
+size_t CS_pes_pendingRecords(cs_pes_t *pes);
+
+#endif
@@ -0,0 +1,20 @@
+//
+//  CS_qrReedSolomon.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - computes the Reed-Solomon error correction codewords for QR symbols.
+// - one encoder exists for each generator polynomial and they are shared because they are immutable.
+@interface CS_qrReedSolomon : NSObject
++(CS_qrReedSolomon *) encoderForParityLength:(int) numParity;
++(BOOL) isVectorized;
+-(int) parityLength;
+-(void) encodeData:(const unsigned char *) data ofLength:(int) len intoParity:(unsigned char *) parity;
+-(void) encodeBlocksFromData:(const unsigned char *) data withShortBlocks:(int) numShort ofLength:(int) lenShort
+               andLongBlocks:(int) numLong ofLength:(int) lenLong intoInterleavedParity:(unsigned char *) parity;
+@end
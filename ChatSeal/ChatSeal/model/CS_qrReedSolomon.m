@@ -0,0 +1,273 @@
+//
+//  CS_qrReedSolomon.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_qrReedSolomon.h"
+#import "CS_qr_encode_defs.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CS_QRRS_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define CS_QRRS_SSSE3 1
+#endif
+
+//  THREADING-NOTES:
+//  - the encoders are immutable after they are created, so they are shared between threads without locking.  Only
+//    the cache that holds them is synchronized.
+//  - every encoding keeps its remainder registers on the stack for the same reason.
+//  - a symbol's blocks all use the same generator, so they are encoded together with the block number as the
+//    vector lane.  Each step multiplies a column of feedback bytes by one generator coefficient, which is a pair
+//    of 16-entry nibble table lookups that map to a single TBL (arm64) or PSHUFB (simulator) instruction each.
+
+// - constants
+#define CS_QRRS_LANES      16
+#define CS_QRRS_MAX_STRIDE (((CS_QRE_MAX_RSBLOCK + CS_QRRS_LANES - 1) / CS_QRRS_LANES) * CS_QRRS_LANES)
+static NSMutableDictionary *mdEncoders = nil;
+
+// - forward declarations
+@interface CS_qrReedSolomon (internal)
+-(id) initWithParityLength:(int) numParity;
+@end
+
+/*
+ *  Multiply two field elements using the log tables.
+ */
+static unsigned char CS_qrrs_mul(unsigned char a, unsigned char b)
+{
+    if (!a || !b) {
+        return 0;
+    }
+    return CS_QRE_byExpToInt[((int) CS_QRE_byIntToExp[a] + (int) CS_QRE_byIntToExp[b]) % 255];
+}
+
+/*
+ *  Compute the parity for a single block.
+ *  - the remainder is a shift register where each input byte is combined with the leading remainder byte and
+ *    the result selects one precomputed row of products for every generator coefficient.
+ */
+static void CS_qrrs_encodeBlock(const unsigned char *mulTable, int numParity, const unsigned char *data, int len, unsigned char *parity)
+{
+    memset(parity, 0, (size_t) numParity);
+    for (int i = 0; i < len; i++) {
+        const unsigned char *row = mulTable + ((data[i] ^ parity[0]) * numParity);
+        for (int j = 0; j < numParity - 1; j++) {
+            parity[j] = parity[j + 1] ^ row[j];
+        }
+        parity[numParity - 1] = row[numParity - 1];
+    }
+}
+
+/*
+ *  Compute the parity for every block in a symbol at the same time.
+ *  - the blocks are stored back to back in the data and the result is interleaved the way the symbol stores it.
+ *  - shorter blocks are aligned at the end of the longest one because leading zeroes leave the remainder unchanged,
+ *    which means every lane consumes one byte on every step.
+ */
+static void CS_qrrs_encodeLanes(const unsigned char *mulTable, const unsigned char *nibLo, const unsigned char *nibHi, int numParity,
+                                const unsigned char *data, int numShort, int lenShort, int numLong, int lenLong, unsigned char *parity)
+{
+    unsigned char reg[CS_QRE_MAX_RSCODEWORD][CS_QRRS_MAX_STRIDE];
+    unsigned char column[CS_QRRS_MAX_STRIDE];
+    int numBlocks = numShort + numLong;
+    int stride    = ((numBlocks + CS_QRRS_LANES - 1) / CS_QRRS_LANES) * CS_QRRS_LANES;
+    int maxLen    = (numLong && lenLong > lenShort) ? lenLong : lenShort;
+    int offShort  = maxLen - lenShort;
+    int offLong   = maxLen - lenLong;
+    
+    for (int j = 0; j < numParity; j++) {
+        memset(reg[j], 0, (size_t) stride);
+    }
+    memset(column, 0, sizeof(column));
+    
+    for (int t = 0; t < maxLen; t++) {
+        // - gather this step's input byte from each block.
+        const unsigned char *src = data;
+        for (int b = 0; b < numShort; b++, src += lenShort) {
+            column[b] = (t >= offShort) ? src[t - offShort] : 0;
+        }
+        for (int b = numShort; b < numBlocks; b++, src += lenLong) {
+            column[b] = (t >= offLong) ? src[t - offLong] : 0;
+        }
+        
+        for (int c = 0; c < stride; c += CS_QRRS_LANES) {
+#if defined(CS_QRRS_NEON)
+            uint8x16_t vF  = veorq_u8(vld1q_u8(column + c), vld1q_u8(reg[0] + c));
+            uint8x16_t vLo = vandq_u8(vF, vdupq_n_u8(0x0F));
+            uint8x16_t vHi = vshrq_n_u8(vF, 4);
+            for (int j = 0; j < numParity; j++) {
+                uint8x16_t vProd = veorq_u8(vqtbl1q_u8(vld1q_u8(nibLo + (j * 16)), vLo), vqtbl1q_u8(vld1q_u8(nibHi + (j * 16)), vHi));
+                if (j < numParity - 1) {
+                    vProd = veorq_u8(vProd, vld1q_u8(reg[j + 1] + c));
+                }
+                vst1q_u8(reg[j] + c, vProd);
+            }
+#elif defined(CS_QRRS_SSSE3)
+            __m128i vMask = _mm_set1_epi8(0x0F);
+            __m128i vF    = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (column + c)), _mm_loadu_si128((const __m128i *) (reg[0] + c)));
+            __m128i vLo   = _mm_and_si128(vF, vMask);
+            __m128i vHi   = _mm_and_si128(_mm_srli_epi64(vF, 4), vMask);
+            for (int j = 0; j < numParity; j++) {
+                __m128i vProd = _mm_xor_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (nibLo + (j * 16))), vLo),
+                                              _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (nibHi + (j * 16))), vHi));
+                if (j < numParity - 1) {
+                    vProd = _mm_xor_si128(vProd, _mm_loadu_si128((const __m128i *) (reg[j + 1] + c)));
+                }
+                _mm_storeu_si128((__m128i *) (reg[j] + c), vProd);
+            }
+#else
+            for (int b = c; b < c + CS_QRRS_LANES; b++) {
+                const unsigned char *row = mulTable + ((column[b] ^ reg[0][b]) * numParity);
+                for (int j = 0; j < numParity - 1; j++) {
+                    reg[j][b] = reg[j + 1][b] ^ row[j];
+                }
+                reg[numParity - 1][b] = row[numParity - 1];
+            }
+#endif
+        }
+    }
+    
+    for (int j = 0; j < numParity; j++) {
+        memcpy(parity + (j * numBlocks), reg[j], (size_t) numBlocks);
+    }
+}
+
+/***********************
+ CS_qrReedSolomon
+ ***********************/
+@implementation CS_qrReedSolomon
+/*
+ *  Object attributes.
+ */
+{
+    int           numParity;
+    unsigned char *mulTable;            //  [feedback][coefficient] products, one row per feedback byte.
+    unsigned char *nibLo;               //  [coefficient][16] products with the low nibble of the feedback.
+    unsigned char *nibHi;               //  [coefficient][16] products with the high nibble of the feedback.
+}
+
+/*
+ *  Initialize the module.
+ */
++(void) initialize
+{
+    mdEncoders = [[NSMutableDictionary alloc] init];
+}
+
+/*
+ *  Return the shared encoder for the given number of error correction codewords.
+ */
++(CS_qrReedSolomon *) encoderForParityLength:(int) numParity
+{
+    if (numParity < 1 || numParity > CS_QRE_MAX_RSCODEWORD || !CS_QRE_byRSExp[numParity]) {
+        return nil;
+    }
+    
+    NSNumber *nKey = [NSNumber numberWithInt:numParity];
+    @synchronized (mdEncoders) {
+        CS_qrReedSolomon *rs = [mdEncoders objectForKey:nKey];
+        if (!rs) {
+            rs = [[[CS_qrReedSolomon alloc] initWithParityLength:numParity] autorelease];
+            [mdEncoders setObject:rs forKey:nKey];
+        }
+        return [[rs retain] autorelease];
+    }
+}
+
+/*
+ *  Returns whether the interleaved encoding uses vector instructions on this processor.
+ */
++(BOOL) isVectorized
+{
+#if defined(CS_QRRS_NEON) || defined(CS_QRRS_SSSE3)
+    return YES;
+#else
+    return NO;
+#endif
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    free(mulTable);
+    mulTable = NULL;
+    
+    free(nibLo);
+    nibLo = NULL;
+    
+    free(nibHi);
+    nibHi = NULL;
+    
+    [super dealloc];
+}
+
+/*
+ *  Return the number of error correction codewords produced for each block.
+ */
+-(int) parityLength
+{
+    return numParity;
+}
+
+/*
+ *  Compute the error correction codewords for one block.
+ */
+-(void) encodeData:(const unsigned char *) data ofLength:(int) len intoParity:(unsigned char *) parity
+{
+    CS_qrrs_encodeBlock(mulTable, numParity, data, len, parity);
+}
+
+/*
+ *  Compute the error correction codewords for all the blocks of a symbol.
+ *  - the data holds the short blocks followed by the long blocks, which is how the symbol lays them out before
+ *    interleaving.
+ *  - the parity is written with the first codeword of every block, followed by the second and so on.
+ */
+-(void) encodeBlocksFromData:(const unsigned char *) data withShortBlocks:(int) numShort ofLength:(int) lenShort
+               andLongBlocks:(int) numLong ofLength:(int) lenLong intoInterleavedParity:(unsigned char *) parity
+{
+    if (numShort < 0 || numLong < 0 || numShort + numLong < 1 || numShort + numLong > CS_QRE_MAX_RSBLOCK) {
+        return;
+    }
+    CS_qrrs_encodeLanes(mulTable, nibLo, nibHi, numParity, data, numShort, lenShort, numLong, lenLong, parity);
+}
+@end
+
+/******************************
+ CS_qrReedSolomon (internal)
+ ******************************/
+@implementation CS_qrReedSolomon (internal)
+/*
+ *  Initialize the object.
+ */
+-(id) initWithParityLength:(int) n
+{
+    self = [super init];
+    if (self) {
+        numParity = n;
+        mulTable  = (unsigned char *) malloc(256 * (size_t) n);
+        nibLo     = (unsigned char *) malloc(16 * (size_t) n);
+        nibHi     = (unsigned char *) malloc(16 * (size_t) n);
+        
+        // - the generator table stores each coefficient as its logarithm.
+        for (int j = 0; j < n; j++) {
+            unsigned char g = CS_QRE_byExpToInt[CS_QRE_byRSExp[n][j]];
+            for (int f = 0; f < 256; f++) {
+                mulTable[(f * n) + j] = CS_qrrs_mul((unsigned char) f, g);
+            }
+            for (int k = 0; k < 16; k++) {
+                nibLo[(j * 16) + k] = mulTable[(k * n) + j];
+                nibHi[(j * 16) + k] = mulTable[((k << 4) * n) + j];
+            }
+        }
+    }
+    return self;
+}
+@end
@@ -59,4 +59,9 @@ extern int CS_QRE_nIndicatorLenKanji[];
 #define CS_QRE_MAX_ALLCODEWORD	 3706   // Maximum total number of codewords
 #define CS_QRE_MAX_DATACODEWORD  2956   // Maximum data code word (version 40-L)
 #define CS_QRE_MAX_CODEBLOCK	 153    // (Including the RS code word) maximum number of block data codewords
+#define CS_QRE_MAX_RSCODEWORD    68     // Largest generator polynomial degree in the RS table
+#define CS_QRE_MAX_RSBLOCK       81     // Maximum number of RS blocks in one symbol (version 40-H)
 #define CS_QRE_MAX_MODULESIZE	 177    // Maximum number of modules one side
+#define CS_QRE_BB_WORDS          ((CS_QRE_MAX_MODULESIZE + 63) / 64)    // 64-bit words in one packed line of modules
+#define CS_QRE_NUM_MASKS         8      // Number of masking patterns
+#define CS_QRE_MASK_PERIOD       12     // Every masking pattern repeats after this many modules in both directions
@@ -11,19 +11,65 @@
 #import "CS_serviceRadar.h"
 #import "CS_basicIOConnection.h"
 
+//  CHUNKED-TRANSFER-NOTES:
+//  - every message is sent as a header chunk with its length followed by its content in fixed-size chunks, each
+//    of which is encrypted and authenticated separately and travels as its own payload in the basic connection.
+//  - only a couple of chunks are sealed ahead of the network at any time, so a sender never holds more than
+//    that in encrypted form and the next chunk is encrypted while the prior one is being written.
+//  - a receiver decrypts each chunk as it arrives directly into the message it is assembling instead of
+//    accumulating the entire encrypted message first.
+//  - chunking is never assumed because older peers only understand single payloads.  A client offers it by sending
+//    an unencrypted connection header before its first message and the server only switches when that header is
+//    the first thing it receives, answering with its own.  Everything else stays in the single-payload format.
+//  - a server may send single payloads before it has seen an offer, so it only decides the format when it first
+//    receives and the client accepts single payloads while it waits for the answer to its offer.
+//  - each header carries a random nonce and the chunk keys are derived from both of them, so chunks recorded
+//    from an earlier connection never authenticate on a new one even though their sequence numbers match.
+//  - clients and servers both use chunking by default.  A server from an earlier release rejects the header as a
+//    bad request, so chunking can be turned off for a connection before anything is exchanged.
+
 // - constants
-static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
+static const uint16_t   CS_SCONN_CRYPTO_VERSION = 1;
+static const uint16_t   CS_SCONN_CHUNK_VERSION  = 2;
+static const NSUInteger CS_SCONN_CHUNK_LEN      = (64 * 1024);
+static const NSUInteger CS_SCONN_CHUNKS_QUEUED  = 2;
+static const uint64_t   CS_SCONN_MAX_MESSAGE    = (64 * 1024 * 1024);
+static const uint8_t    CS_SCONN_FLAG_HEADER    = 0x01;
+static const uint8_t    CS_SCONN_FLAG_FINAL     = 0x02;
+static const uint8_t    CS_SCONN_FLAG_SERVER    = 0x04;           //  prevents chunks from being reflected back to their sender.
+static const char       *CS_SCONN_HEADER_MAGIC  = "CSCH";
+static const NSUInteger CS_SCONN_NONCE_LEN      = 32;
+static const NSUInteger CS_SCONN_HEADER_LEN     = 4 + sizeof(uint16_t) + CS_SCONN_NONCE_LEN;
+
+typedef enum {
+    CS_SCONN_FMT_UNKNOWN = 0,                                       //  nothing has been exchanged yet.
+    CS_SCONN_FMT_OFFERED,                                           //  the client sent its header and is waiting for the server's.
+    CS_SCONN_FMT_SINGLE,                                            //  every message is a single encrypted payload.
+    CS_SCONN_FMT_CHUNKED
+} cs_sconn_format_t;
 
 // - forward declarations
 @interface CS_secureConnection (internal) <CS_basicIOConnectionDelegate>
 -(BOOL) sendUnlimitedUnencryptedData:(NSData *) d withError:(NSError **) err;
+-(BOOL) prepareChunkCiphersWithNonce:(NSData *) nonce andError:(NSError **) err;
+-(BOOL) sendConnectionHeaderWithError:(NSError **) err;
+-(BOOL) isConnectionHeader:(NSData *) d;
+-(BOOL) acceptConnectionHeader:(NSData *) d withError:(NSError **) err;
+-(BOOL) sealOutgoingChunksWithError:(NSError **) err;
+-(void) scheduleOutgoingChunks;
+-(void) sealScheduledChunks;
+-(BOOL) openIncomingChunk:(NSData *) dChunk returningComplete:(BOOL *) isComplete withError:(NSError **) err;
+-(NSData *) openSinglePayload:(NSData *) dEncrypted withError:(NSError **) err;
+-(void) discardChunkState;
 @end
 
 // - shared interfaces with the consumers of this data.
 @interface CS_secureConnection (shared)
 -(id) initWithConnectionToService:(CS_service *) svc usingPassword:(NSString *) pwd;
 -(id) initWithConnectionToClient:(CS_basicIOConnection *) clientConn usingPassword:(NSString *) pwd;
+-(id) initLocalConnectionWithPort:(uint16_t) port usingPassword:(NSString *) pwd;
 -(BOOL) fillStandardBadObjectError:(NSError **) err;
+-(void) setChunkedTransferEnabled:(BOOL) enabled;
 @end
 
 // - for testing.
@@ -47,6 +93,22 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
     CS_basicIOConnection *netConnection;
     BOOL                  isServerSide;
     NSString              *password;
+    BOOL                  isChunkEnabled;
+    cs_sconn_format_t     format;
+    NSData                *dFirstSingle;
+    NSData                *dLocalNonce;
+    RSISecureChunkCipher  *sccSend;
+    RSISecureChunkCipher  *sccRecv;
+    NSMutableArray        *maOutgoing;
+    BOOL                  isOutgoingStarted;
+    NSUInteger            outgoingOffset;
+    BOOL                  isSealScheduled;
+    NSUInteger            sendTotal;
+    NSUInteger            sendSealed;
+    NSMutableData         *mdIncoming;
+    uint64_t              incomingExpected;
+    NSMutableArray        *maIncoming;
+    NSError               *incomingError;
 }
 @synthesize delegate;
 
@@ -57,10 +119,26 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
 {
     self = [super init];
     if (self) {
-        netConnection = nil;
-        isServerSide  = YES;
-        password      = nil;
-        delegate      = nil;
+        netConnection     = nil;
+        isServerSide      = YES;
+        password          = nil;
+        delegate          = nil;
+        isChunkEnabled    = YES;
+        format            = CS_SCONN_FMT_UNKNOWN;
+        dFirstSingle      = nil;
+        dLocalNonce       = nil;
+        sccSend           = nil;
+        sccRecv           = nil;
+        maOutgoing        = [[NSMutableArray alloc] init];
+        isOutgoingStarted = NO;
+        outgoingOffset    = 0;
+        isSealScheduled   = NO;
+        sendTotal         = 0;
+        sendSealed        = 0;
+        mdIncoming        = nil;
+        incomingExpected  = 0;
+        maIncoming        = [[NSMutableArray alloc] init];
+        incomingError     = nil;
     }
     return self;
 }
@@ -79,6 +157,19 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
     [password release];
     password = nil;
     
+    [dFirstSingle release];
+    dFirstSingle = nil;
+    
+    [dLocalNonce release];
+    dLocalNonce = nil;
+    
+    [self discardChunkState];
+    [maOutgoing release];
+    maOutgoing = nil;
+    
+    [maIncoming release];
+    maIncoming = nil;
+    
     [super dealloc];
 }
 
@@ -127,6 +218,35 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
             return NO;
         }
         
+        // - only a client may offer chunking and only before anything else is sent.
+        // - a server that speaks first sends single payloads, but still decides the format from what it receives.
+        if (format == CS_SCONN_FMT_UNKNOWN && !isServerSide) {
+            if (isChunkEnabled) {
+                if (![self sendConnectionHeaderWithError:err]) {
+                    return NO;
+                }
+                format = CS_SCONN_FMT_OFFERED;
+            }
+            else {
+                format = CS_SCONN_FMT_SINGLE;
+            }
+        }
+        
+        // - chunked messages are only sealed as the network is ready for them, which
+        //   also means they wait while an offer is outstanding.
+        if (format == CS_SCONN_FMT_OFFERED || format == CS_SCONN_FMT_CHUNKED) {
+            if ([d length] > CS_SCONN_MAX_MESSAGE) {
+                [CS_error fillError:err withCode:CSErrorInvalidArgument andFailureReason:@"The message is too large."];
+                return NO;
+            }
+            
+            // - the copy is free for immutable data and protects us from changes to mutable data while it is sent.
+            NSUInteger numChunks = ([d length] + CS_SCONN_CHUNK_LEN - 1) / CS_SCONN_CHUNK_LEN;
+            sendTotal            += [d length] + sizeof(uint64_t) + ((numChunks + 1) * ([RSISecureChunkCipher chunkOverhead] + sizeof(uint32_t)));
+            [maOutgoing addObject:[[d copy] autorelease]];
+            return [self sealOutgoingChunksWithError:err];
+        }
+        
         NSError *tmp       = nil;
         NSData *dEncrypted = [RealSecureImage encryptArray:[NSArray arrayWithObject:d] forVersion:CS_SCONN_CRYPTO_VERSION usingPassword:password withError:&tmp];
         if (!dEncrypted) {
@@ -146,6 +266,14 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(BOOL) hasDataForRead
 {
+    if (format == CS_SCONN_FMT_OFFERED || format == CS_SCONN_FMT_CHUNKED) {
+        return ([maIncoming count] || incomingError) ? YES : NO;
+    }
+    
+    if (dFirstSingle) {
+        return YES;
+    }
+    
     if (netConnection) {
         return [netConnection hasDataForRead];
     }
@@ -157,6 +285,10 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(BOOL) hasPendingIO
 {
+    if ([maOutgoing count]) {
+        return YES;
+    }
+    
     if (netConnection) {
         return [netConnection hasPendingIO];
     }
@@ -168,21 +300,39 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(NSData *) checkForDataWithError:(NSError **) err
 {
+    // - chunked messages are already decrypted by the time they are complete.
+    if (format == CS_SCONN_FMT_OFFERED || format == CS_SCONN_FMT_CHUNKED) {
+        if ([maIncoming count]) {
+            NSData *dRet = [[[maIncoming objectAtIndex:0] retain] autorelease];
+            [maIncoming removeObjectAtIndex:0];
+            return dRet;
+        }
+        
+        if (incomingError) {
+            [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[incomingError localizedDescription]];
+        }
+        else {
+            [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:@"No data available."];
+        }
+        return nil;
+    }
+    
     if (netConnection) {
-        NSError *tmp = nil;
-        NSData *dEncrypted = [netConnection checkForDataWithError:&tmp];
-        if (!dEncrypted) {
-            [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
-            return nil;
+        // - the first payload may have already been read while deciding the format.
+        NSError *tmp       = nil;
+        NSData *dEncrypted = nil;
+        if (dFirstSingle) {
+            dEncrypted   = [dFirstSingle autorelease];
+            dFirstSingle = nil;
         }
-
-        NSArray *arr = [RealSecureImage decryptIntoArray:dEncrypted forVersion:CS_SCONN_CRYPTO_VERSION usingPassword:password withError:&tmp];
-        if (!arr || [arr count] != 1 || ![[arr objectAtIndex:0] isKindOfClass:[NSData class]]) {
+        else {
+            dEncrypted = [netConnection checkForDataWithError:&tmp];
+        }
+        if (!dEncrypted) {
             [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
             return nil;
         }
-        
-        return (NSData *) [arr objectAtIndex:0];
+        return [self openSinglePayload:dEncrypted withError:err];
     }
     
     // - this should not happen when we initialize the right way.
@@ -261,6 +411,8 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(void) disconnect
 {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(sealScheduledChunks) object:nil];
+    isSealScheduled = NO;
     [netConnection disconnect];
 }
 
@@ -294,6 +446,15 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(void) basicConnectionDataRecvProgress:(CS_basicIOConnection *)ioConn ofPct:(NSNumber *)pctComplete
 {
+    // - the connection only knows about the current chunk, so it is scaled to the size of the message.
+    if (format == CS_SCONN_FMT_CHUNKED) {
+        if (!mdIncoming || !incomingExpected) {
+            return;
+        }
+        NSUInteger numDone = [mdIncoming length];
+        NSUInteger inChunk = (NSUInteger) MIN((uint64_t) CS_SCONN_CHUNK_LEN, incomingExpected - numDone);
+        pctComplete        = [NSNumber numberWithFloat:MIN((float) ((double) numDone + ((double) inChunk * pctComplete.doubleValue)) / (float) incomingExpected, 1.0f)];
+    }
     [self secureConnectionDataRecvProgress:self ofPct:pctComplete];
 }
 
@@ -302,6 +463,19 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(void) basicConnectionDataSendProgress:(CS_basicIOConnection *)ioConn ofPct:(NSNumber *)pctComplete
 {
+    // - the connection only knows about the chunks it was given, so the progress is computed from
+    //   the size of the messages.
+    if (format == CS_SCONN_FMT_OFFERED || format == CS_SCONN_FMT_CHUNKED) {
+        NSUInteger numPending = [netConnection pendingOutputLength];
+        NSUInteger numSent    = sendSealed > numPending ? sendSealed - numPending : 0;
+        pctComplete           = [NSNumber numberWithFloat:sendTotal ? MIN((float) numSent / (float) sendTotal, 1.0f) : 1.0f];
+        if (![maOutgoing count] && !numPending) {
+            sendTotal = sendSealed = 0;
+        }
+        else {
+            [self scheduleOutgoingChunks];
+        }
+    }
     [self secureConnectionDataSendProgress:self ofPct:pctComplete];
 }
 
@@ -311,7 +485,89 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
  */
 -(void) basicConnectionHasData:(CS_basicIOConnection *)ioConn
 {
-    [self secureConnectionHasData:self];
+    // - a server decides the format from the first thing it receives, which must be
+    //   kept when it is an ordinary single payload.
+    if (format == CS_SCONN_FMT_UNKNOWN) {
+        if (!isServerSide || !isChunkEnabled) {
+            format = CS_SCONN_FMT_SINGLE;
+        }
+        else if (![netConnection hasDataForRead]) {
+            return;
+        }
+        else {
+            NSData *dFirst = [netConnection checkForDataWithError:nil];
+            if ([self isConnectionHeader:dFirst]) {
+                NSError *tmp = nil;
+                if (![self sendConnectionHeaderWithError:&tmp] || ![self acceptConnectionHeader:dFirst withError:&tmp]) {
+                    NSLog(@"CS: Failed to accept the chunked transfer offer.  %@", [tmp localizedDescription]);
+                    [self secureConnectionFailed:self];
+                    return;
+                }
+                format = CS_SCONN_FMT_CHUNKED;
+            }
+            else {
+                format       = CS_SCONN_FMT_SINGLE;
+                dFirstSingle = [dFirst retain];
+            }
+        }
+    }
+    
+    if (format == CS_SCONN_FMT_SINGLE) {
+        [self secureConnectionHasData:self];
+        return;
+    }
+    
+    // - chunks are decrypted as soon as they arrive and the delegate only hears about complete messages.
+    [[self retain] autorelease];
+    BOOL hasNew = NO;
+    while ([netConnection hasDataForRead]) {
+        NSData *dChunk = [netConnection checkForDataWithError:nil];
+        
+        // - once a chunk is rejected, every one after it is out of sequence and must be discarded.
+        if (incomingError) {
+            continue;
+        }
+        
+        // - an offer is only complete when the server answers with its own header, but anything it sent before
+        //   it saw the offer is in the single-payload format.
+        NSError *tmp    = nil;
+        BOOL isComplete = NO;
+        if (format == CS_SCONN_FMT_OFFERED) {
+            if (![self isConnectionHeader:dChunk]) {
+                NSData *dSingle = [self openSinglePayload:dChunk withError:&tmp];
+                if (dSingle) {
+                    [maIncoming addObject:dSingle];
+                }
+                else {
+                    incomingError = [tmp retain];
+                }
+                hasNew = YES;
+            }
+            else if (![self acceptConnectionHeader:dChunk withError:&tmp]) {
+                incomingError = [tmp retain];
+                hasNew        = YES;
+            }
+            else {
+                format = CS_SCONN_FMT_CHUNKED;
+                [self scheduleOutgoingChunks];
+            }
+            continue;
+        }
+        
+        if (![self openIncomingChunk:dChunk returningComplete:&isComplete withError:&tmp]) {
+            incomingError = [tmp retain];
+            [mdIncoming release];
+            mdIncoming    = nil;
+            hasNew        = YES;
+        }
+        else if (isComplete) {
+            hasNew = YES;
+        }
+    }
+    
+    if (hasNew) {
+        [self secureConnectionHasData:self];
+    }
 }
 
 /*
@@ -338,6 +594,283 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
     return [netConnection sendUnlimitedData:d withError:err];
 }
 
+/*
+ *  Decrypt a message that was sent as a single payload.
+ */
+-(NSData *) openSinglePayload:(NSData *) dEncrypted withError:(NSError **) err
+{
+    NSError *tmp = nil;
+    NSArray *arr = [RealSecureImage decryptIntoArray:dEncrypted forVersion:CS_SCONN_CRYPTO_VERSION usingPassword:password withError:&tmp];
+    if (!arr || [arr count] != 1 || ![[arr objectAtIndex:0] isKindOfClass:[NSData class]]) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
+        return nil;
+    }
+    return (NSData *) [arr objectAtIndex:0];
+}
+
+/*
+ *  Create the ciphers for chunked messages.
+ *  - this is deferred until chunking is agreed because hashing the password is expensive.
+ */
+-(BOOL) prepareChunkCiphersWithNonce:(NSData *) nonce andError:(NSError **) err
+{
+    if (sccSend && sccRecv) {
+        return YES;
+    }
+    
+    NSError *tmp = nil;
+    sccSend      = [[RealSecureImage chunkCipherForVersion:CS_SCONN_CHUNK_VERSION usingPassword:password andSessionNonce:nonce withError:&tmp] retain];
+    sccRecv      = [[RealSecureImage chunkCipherForVersion:CS_SCONN_CHUNK_VERSION usingPassword:password andSessionNonce:nonce withError:&tmp] retain];
+    if (!sccSend || !sccRecv) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
+        [sccSend release];
+        sccSend = nil;
+        [sccRecv release];
+        sccRecv = nil;
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Send the unencrypted header that offers or accepts chunked transfer.
+ */
+-(BOOL) sendConnectionHeaderWithError:(NSError **) err
+{
+    uint8_t hdr[CS_SCONN_HEADER_LEN];
+    memcpy(hdr, CS_SCONN_HEADER_MAGIC, 4);
+    hdr[4] = (uint8_t) (CS_SCONN_CHUNK_VERSION >> 8);
+    hdr[5] = (uint8_t) (CS_SCONN_CHUNK_VERSION & 0xFF);
+    if (SecRandomCopyBytes(kSecRandomDefault, CS_SCONN_NONCE_LEN, hdr + 6) != 0) {
+        [CS_error fillError:err withCode:CSErrorSecurityFailure andFailureReason:@"Unable to generate secure random data."];
+        return NO;
+    }
+    
+    [dLocalNonce release];
+    dLocalNonce = [[NSData alloc] initWithBytes:hdr + 6 length:CS_SCONN_NONCE_LEN];
+    return [netConnection sendData:[NSData dataWithBytes:hdr length:sizeof(hdr)] withError:err];
+}
+
+/*
+ *  Determine if the payload is a connection header.
+ *  - a single encrypted payload is never this short, so the two cannot be confused.
+ */
+-(BOOL) isConnectionHeader:(NSData *) d
+{
+    if ([d length] != CS_SCONN_HEADER_LEN || memcmp([d bytes], CS_SCONN_HEADER_MAGIC, 4)) {
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Switch to chunked transfer using the header from the other side.
+ *  - our own header must already be sent so that both nonces are known.
+ */
+-(BOOL) acceptConnectionHeader:(NSData *) d withError:(NSError **) err
+{
+    const uint8_t *hdr = (const uint8_t *) [d bytes];
+    uint16_t version   = (uint16_t) (((uint16_t) hdr[4] << 8) | hdr[5]);
+    if (version != CS_SCONN_CHUNK_VERSION) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:@"Unsupported secure chunk version."];
+        return NO;
+    }
+    
+    if (!dLocalNonce) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:@"Secure chunk protocol failure (4)."];
+        return NO;
+    }
+    
+    // - the session nonce is always the client's followed by the server's so that both sides agree on it.
+    NSMutableData *mdNonce = [NSMutableData dataWithCapacity:CS_SCONN_NONCE_LEN * 2];
+    if (isServerSide) {
+        [mdNonce appendBytes:hdr + 6 length:CS_SCONN_NONCE_LEN];
+        [mdNonce appendData:dLocalNonce];
+    }
+    else {
+        [mdNonce appendData:dLocalNonce];
+        [mdNonce appendBytes:hdr + 6 length:CS_SCONN_NONCE_LEN];
+    }
+    return [self prepareChunkCiphersWithNonce:mdNonce andError:err];
+}
+
+/*
+ *  Seal as many chunks as the network can use right now.
+ */
+-(BOOL) sealOutgoingChunksWithError:(NSError **) err
+{
+    // - nothing can be sealed until the offer is accepted.
+    if (format != CS_SCONN_FMT_CHUNKED) {
+        return YES;
+    }
+    
+    uint8_t roleFlag = isServerSide ? CS_SCONN_FLAG_SERVER : 0;
+    while ([maOutgoing count] && [netConnection pendingOutputLength] < CS_SCONN_CHUNKS_QUEUED * CS_SCONN_CHUNK_LEN) {
+        NSData *dMessage = [maOutgoing objectAtIndex:0];
+        NSUInteger len   = [dMessage length];
+        uint8_t flags    = roleFlag;
+        NSData *dChunk   = nil;
+        NSError *tmp     = nil;
+        if (!isOutgoingStarted) {
+            // - the header lets the receiver allocate the message once and report accurate progress.
+            uint8_t hdr[sizeof(uint64_t)];
+            for (NSUInteger i = 0; i < sizeof(hdr); i++) {
+                hdr[i] = (uint8_t) ((uint64_t) len >> (56 - (i * 8)));
+            }
+            flags             |= CS_SCONN_FLAG_HEADER | (len ? 0 : CS_SCONN_FLAG_FINAL);
+            dChunk             = [sccSend sealBytes:hdr ofLength:sizeof(hdr) withFlags:flags andError:&tmp];
+            isOutgoingStarted  = YES;
+            outgoingOffset     = 0;
+        }
+        else {
+            // - the chunk is encrypted straight out of the message without copying it first.
+            NSUInteger toSeal = MIN(CS_SCONN_CHUNK_LEN, len - outgoingOffset);
+            if (outgoingOffset + toSeal == len) {
+                flags |= CS_SCONN_FLAG_FINAL;
+            }
+            dChunk          = [sccSend sealBytes:(const uint8_t *) [dMessage bytes] + outgoingOffset ofLength:toSeal withFlags:flags andError:&tmp];
+            outgoingOffset += toSeal;
+        }
+        
+        if (!dChunk) {
+            [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
+            return NO;
+        }
+        
+        if (flags & CS_SCONN_FLAG_FINAL) {
+            [maOutgoing removeObjectAtIndex:0];
+            isOutgoingStarted = NO;
+            outgoingOffset    = 0;
+        }
+        
+        sendSealed += [dChunk length] + sizeof(uint32_t);
+        if (![netConnection sendData:dChunk withError:err]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/*
+ *  Seal more chunks after the connection has finished what it is doing.
+ *  - this is deferred because it is triggered while the connection is in the middle of writing.
+ */
+-(void) scheduleOutgoingChunks
+{
+    if (isSealScheduled || ![maOutgoing count]) {
+        return;
+    }
+    isSealScheduled = YES;
+    [self performSelector:@selector(sealScheduledChunks) withObject:nil afterDelay:0.0f];
+}
+
+/*
+ *  Seal the next group of chunks.
+ */
+-(void) sealScheduledChunks
+{
+    isSealScheduled = NO;
+    NSError *tmp    = nil;
+    if (![self sealOutgoingChunksWithError:&tmp]) {
+        NSLog(@"CS: Failed to send the next secure chunk.  %@", [tmp localizedDescription]);
+        [self secureConnectionFailed:self];
+    }
+}
+
+/*
+ *  Decrypt the next chunk into the message that is being assembled.
+ */
+-(BOOL) openIncomingChunk:(NSData *) dChunk returningComplete:(BOOL *) isComplete withError:(NSError **) err
+{
+    *isComplete = NO;
+    if (!dChunk || !sccSend || !sccRecv) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:@"Invalid secure chunk."];
+        return NO;
+    }
+    
+    // - the chunks must come from the other side of the connection.
+    uint8_t flags    = 0;
+    uint8_t roleFlag = isServerSide ? 0 : CS_SCONN_FLAG_SERVER;
+    NSError *tmp     = nil;
+    if (!mdIncoming) {
+        NSMutableData *mdHeader = [NSMutableData dataWithCapacity:sizeof(uint64_t)];
+        if (![sccRecv openChunk:dChunk appendingTo:mdHeader returningFlags:&flags withError:&tmp]) {
+            [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
+            return NO;
+        }
+        
+        if (!(flags & CS_SCONN_FLAG_HEADER) || (flags & CS_SCONN_FLAG_SERVER) != roleFlag || [mdHeader length] != sizeof(uint64_t)) {
+            [CS_error fillError:err withCode:CSErrorMaliciousActivity andFailureReason:@"Secure chunk protocol failure (1)."];
+            return NO;
+        }
+        
+        const uint8_t *hdr = (const uint8_t *) [mdHeader bytes];
+        incomingExpected   = 0;
+        for (NSUInteger i = 0; i < sizeof(uint64_t); i++) {
+            incomingExpected = (incomingExpected << 8) | hdr[i];
+        }
+        if (incomingExpected > CS_SCONN_MAX_MESSAGE || ((flags & CS_SCONN_FLAG_FINAL) && incomingExpected)) {
+            [CS_error fillError:err withCode:CSErrorMaliciousActivity andFailureReason:@"Secure chunk protocol failure (2)."];
+            return NO;
+        }
+        
+        if (flags & CS_SCONN_FLAG_FINAL) {
+            [maIncoming addObject:[NSData data]];
+            *isComplete = YES;
+        }
+        else {
+            mdIncoming = [[NSMutableData alloc] initWithCapacity:(NSUInteger) incomingExpected];
+        }
+        return YES;
+    }
+    
+    if (![sccRecv openChunk:dChunk appendingTo:mdIncoming returningFlags:&flags withError:&tmp]) {
+        [CS_error fillError:err withCode:CSErrorInvalidSecureRequest andFailureReason:[tmp localizedDescription]];
+        return NO;
+    }
+    
+    // - the final chunk must land exactly on the expected length.
+    uint64_t numReceived = [mdIncoming length];
+    BOOL isFinal         = (flags & CS_SCONN_FLAG_FINAL) ? YES : NO;
+    if ((flags & CS_SCONN_FLAG_HEADER) || (flags & CS_SCONN_FLAG_SERVER) != roleFlag ||
+        numReceived > incomingExpected || isFinal != (numReceived == incomingExpected)) {
+        [CS_error fillError:err withCode:CSErrorMaliciousActivity andFailureReason:@"Secure chunk protocol failure (3)."];
+        return NO;
+    }
+    
+    if (isFinal) {
+        [maIncoming addObject:mdIncoming];
+        [mdIncoming release];
+        mdIncoming  = nil;
+        *isComplete = YES;
+    }
+    return YES;
+}
+
+/*
+ *  Release all the chunk processing state.
+ */
+-(void) discardChunkState
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(sealScheduledChunks) object:nil];
+    isSealScheduled = NO;
+    
+    [sccSend release];
+    sccSend = nil;
+    
+    [sccRecv release];
+    sccRecv = nil;
+    
+    [maOutgoing removeAllObjects];
+    [maIncoming removeAllObjects];
+    
+    [mdIncoming release];
+    mdIncoming = nil;
+    
+    [incomingError release];
+    incomingError = nil;
+}
+
 @end
 
 /*************************************
@@ -375,6 +908,32 @@ static const uint16_t CS_SCONN_CRYPTO_VERSION = 1;
     return self;
 }
 
+/*
+ *  Initialize the object.
+ *  - this is the client side of a connection to a server on this device and is only used for testing.
+ */
+-(id) initLocalConnectionWithPort:(uint16_t) port usingPassword:(NSString *) pwd
+{
+    self = [self init];
+    if (self) {
+        netConnection          = [[CS_basicIOConnection alloc] initLocalConnectionWithPort:port];
+        netConnection.delegate = self;
+        password               = [pwd retain];
+        isServerSide           = NO;
+    }
+    return self;
+}
+
+/*
+ *  Turn chunked transfer on or off.
+ *  - a client only offers it when enabled and a server only accepts offers when enabled.
+ *  - this must be set before anything is exchanged.
+ */
+-(void) setChunkedTransferEnabled:(BOOL) enabled
+{
+    isChunkEnabled = enabled;
+}
+
 /*
  *  Populate the error to use for a bad object.
  */
@@ -269,6 +269,7 @@ extern NSString *kChatSealNotifyInitialStylingCompleted;
 +(NSArray *) messageListForSearchCriteria:(NSString *) searchString withItemIdentification:(BOOL(^)(ChatSealMessage *)) itemIdentified andError:(NSError **) err;
 +(ChatSealMessage *) importMessageIntoVault:(NSData *) dMessage andSetDefaultFeed:(NSString *) feedId withError:(NSError **) err;
 +(ChatSealMessage *) importMessageIntoVault:(NSData *) dMessage andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err;
++(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err;
 +(BOOL) isPackedMessageCurrentlyKnown:(NSData *) dMesage;
 +(BOOL) isPackedMessageHashCurrentlyKnown:(NSString *) sHash;
 +(ChatSealMessage *) bestMessageForSeal:(NSString *) sid andAuthor:(NSString *) author;
@@ -19,6 +19,7 @@
 #import "CS_cacheMessage.h"
 #import "UIImageGeneration.h"
 #import "CS_diskCache.h"
+#import "CS_image.h"
 #import "ChatSealIdentity.h"
 #import "ChatSealVaultPlaceholder.h"
 #import "ChatSealBaseStation.h"
@@ -124,6 +125,7 @@ static NSMutableArray *maDebugLog                   = nil;
                            onCreationDate:(NSDate *) dtCreated andError:(NSError **) err;
 +(NSArray *) messageListForSearchCriteria:(NSString *) searchString withItemIdentification:(BOOL(^)(ChatSealMessage *)) itemIdentified andError:(NSError **) err;
 +(ChatSealMessage *) importMessageIntoVault:(NSData *) dMessage andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err;
++(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err;
 +(BOOL) isPackedMessageCurrentlyKnown:(NSData *) dMessage;
 +(BOOL) isPackedMessageHashCurrentlyKnown:(NSString *) sHash;
 +(ChatSealMessage *) bestMessageForSeal:(NSString *) sid andAuthor:(NSString *) author;
@@ -642,6 +644,8 @@ static NSMutableArray *maDebugLog                   = nil;
     [UIAddPhotoSignView releaseGeneratedResources];
     [CS_cacheSeal releaseAllCachedContent];
     [CS_cacheMessage releaseAllCachedContent];
+    [CS_diskCache releaseMemoryTier];
+    [CS_image releaseCachedImages];
 }
 
 /*
@@ -1696,6 +1700,9 @@ static NSMutableArray *maDebugLog                   = nil;
 {
     @synchronized (psGlobal) {
         [[ChatSeal applicationFeedCollector] close];
+        [CS_diskCache discardMemoryTier];
+        [CS_image releaseCachedImages];
+        [CS_cacheMessage closeProcessedMessageEntries];
         [RealSecureImage closeVault];
     }
 }
@@ -1718,6 +1725,7 @@ static NSMutableArray *maDebugLog                   = nil;
         }
         
         NSLog(@"CS: Destroying the seal vault.");
+        [CS_cacheMessage closeProcessedMessageEntries];
         if (![RealSecureImage destroyVaultWithError:err]) {
             return NO;
         }
@@ -2482,6 +2490,14 @@ static NSMutableArray *maDebugLog                   = nil;
     return [ChatSealMessage importMessageIntoVault:dMessage andSetDefaultFeed:feedId andReturnUserData:userData withError:err];
 }
 
+/*
+ *  Import a message that was already identified and decrypted into the vault.
+ */
++(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err
+{
+    return [ChatSealMessage importSecureMessageIntoVault:sm andSetDefaultFeed:feedId andReturnUserData:userData withError:err];
+}
+
 /*
  *  Determine if the given packed message is known to the vault.
  */
@@ -33,5 +33,14 @@
 +(void) beginTweetTrackingTesting;
 +(void) beginTwitterMiningHistoryTesting;
 +(void) beginTweetTextTesting;
++(void) beginFeedMiningReplayBenchmark;
++(void) beginTweetParsingTesting;
++(void) beginImagePipelineBenchmark;
++(void) beginDiskCacheTesting;
++(void) beginNetReactorTesting;
++(void) beginSecureTransferTesting;
++(void) beginQREncodeTesting;
++(void) beginImageTesting;
++(void) beginMessageCacheTesting;
 +(void) buildScreenshotScenario;
 @end
@@ -16,6 +16,14 @@
 #import "ChatSealDebug_tweetTrackingDB.h"
 #import "ChatSealDebug_twitter_mining_history.h"
 #import "ChatSealDebug_tweetText.h"
+#import "ChatSealDebug_twitter_simulator.h"
+#import "ChatSealDebug_tweetParsing.h"
+#import "ChatSealDebug_diskCache.h"
+#import "ChatSealDebug_netReactor.h"
+#import "ChatSealDebug_secureTransfer.h"
+#import "ChatSealDebug_qrEncode.h"
+#import "ChatSealDebug_image.h"
+#import "ChatSealDebug_messageCache.h"
 #import "ChatSealDebug_contrivedScenario.h"
 
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
@@ -166,6 +174,78 @@
     [ChatSealDebug_tweetText beginTweetTextTesting];
 }
 
+/*
+ *  Measure the throughput of the feed collector against a local stand-in for the Twitter service.
+ */
++(void) beginFeedMiningReplayBenchmark
+{
+    [ChatSealDebug_twitter_simulator beginFeedMiningReplayBenchmark];
+}
+
+/*
+ *  Verify the streaming timeline parser and compare it to the Foundation-based parsing.
+ */
++(void) beginTweetParsingTesting
+{
+    [ChatSealDebug_tweetParsing beginTweetParsingTesting];
+}
+
+/*
+ *  Compare serial decoding of downloaded images with the staged image pipeline.
+ */
++(void) beginImagePipelineBenchmark
+{
+    [ChatSealDebug_twitter_simulator beginImagePipelineBenchmark];
+}
+
+/*
+ *  Verify the memory tier of the disk cache and compare it with reading from disk.
+ */
++(void) beginDiskCacheTesting
+{
+    [ChatSealDebug_diskCache beginDiskCacheTesting];
+}
+
+/*
+ *  Verify the reactor-driven server and compare it with the polling server over loopback.
+ */
++(void) beginNetReactorTesting
+{
+    [ChatSealDebug_netReactor beginNetReactorTesting];
+}
+
+/*
+ *  Verify chunked secure transfers and compare them with the single-payload format.
+ */
++(void) beginSecureTransferTesting
+{
+    [ChatSealDebug_secureTransfer beginSecureTransferTesting];
+}
+
+/*
+ *  Verify the QR mask evaluation and measure encoding performance.
+ */
++(void) beginQREncodeTesting
+{
+    [ChatSealDebug_qrEncode beginQREncodeTesting];
+}
+
+/*
+ *  Verify the image resampling and caching and measure thumbnail creation.
+ */
++(void) beginImageTesting
+{
+    [ChatSealDebug_image beginImageTesting];
+}
+
+/*
+ *  Verify the message cache and measure its performance.
+ */
++(void) beginMessageCacheTesting
+{
+    [ChatSealDebug_messageCache beginMessageCacheTesting];
+}
+
 /*
  *  Begin building the scenario for taking screen shots.
  */
@@ -0,0 +1,13 @@
+//
+//  ChatSealDebug_diskCache.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/25/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface ChatSealDebug_diskCache : NSObject
++(void) beginDiskCacheTesting;
+@end
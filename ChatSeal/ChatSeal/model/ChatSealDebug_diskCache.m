@@ -0,0 +1,277 @@
+//
+//  ChatSealDebug_diskCache.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/25/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_diskCache.h"
+#import "ChatSeal.h"
+#import "CS_diskCache.h"
+#import "CS_diskCacheMemoryTier.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static NSString         *PSD_DC_CATEGORY      = @"debug-disk-cache";
+static const NSUInteger PSD_DC_NUM_ITEMS      = 400;
+static const NSUInteger PSD_DC_MIN_SIZE       = (2 * 1024);
+static const NSUInteger PSD_DC_MAX_SIZE       = (64 * 1024);
+static const NSUInteger PSD_DC_SHARED_CONTENT = 8;          //  one in every N items has the same content as another.
+static const NSUInteger PSD_DC_TRACE_LEN      = 20000;
+static const NSUInteger PSD_DC_SAVE_PCT       = 10;
+#endif
+
+/**************************
+ ChatSealDebug_diskCache
+ **************************/
+@implementation ChatSealDebug_diskCache
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+
+/*
+ *  Return a deterministic pseudo-random value.
+ */
++(uint32_t) nextRandom:(uint32_t *) seed
+{
+    *seed = (*seed * 1103515245) + 12345;
+    return (*seed >> 8);
+}
+
+/*
+ *  Generate content for the given item.
+ */
++(NSData *) contentForItem:(NSUInteger) item withVersion:(NSUInteger) version
+{
+    uint32_t seed     = (uint32_t) ((item * 7919) + (version * 104729) + 1);
+    NSUInteger len    = PSD_DC_MIN_SIZE + ([self nextRandom:&seed] % (PSD_DC_MAX_SIZE - PSD_DC_MIN_SIZE));
+    NSMutableData *md = [NSMutableData dataWithLength:len];
+    uint32_t *pBuf    = (uint32_t *) [md mutableBytes];
+    for (NSUInteger i = 0; i < len / sizeof(uint32_t); i++) {
+        pBuf[i] = [self nextRandom:&seed];
+    }
+    return md;
+}
+
+/*
+ *  Verify that the memory tier always agrees with the disk.
+ */
++(BOOL) runTest_1Consistency
+{
+    NSLog(@"DISK-CACHE:  TEST-01:  Starting memory tier consistency testing.");
+    [CS_diskCache invalidateCacheCategory:PSD_DC_CATEGORY];
+    
+    NSData *dA = [self contentForItem:1 withVersion:0];
+    NSData *dB = [self contentForItem:2 withVersion:0];
+    if (![CS_diskCache saveCachedData:dA withBaseName:@"a" andCategory:PSD_DC_CATEGORY] ||
+        ![CS_diskCache saveCachedData:dA withBaseName:@"a-copy" andCategory:PSD_DC_CATEGORY] ||
+        ![CS_diskCache saveCachedData:dB withBaseName:@"b" andCategory:PSD_DC_CATEGORY]) {
+        NSLog(@"ERROR: failed to save the test items.");
+        return NO;
+    }
+    
+    // - everything must be visible before it has been written.
+    if (![[CS_diskCache cachedDataWithBaseName:@"a" andCategory:PSD_DC_CATEGORY] isEqualToData:dA] ||
+        ![[CS_diskCache cachedDataWithBaseName:@"a-copy" andCategory:PSD_DC_CATEGORY] isEqualToData:dA] ||
+        ![[CS_diskCache cachedDataWithBaseName:@"b" andCategory:PSD_DC_CATEGORY] isEqualToData:dB]) {
+        NSLog(@"ERROR: the saved items are not immediately readable.");
+        return NO;
+    }
+    
+    // - removals and replacements must be ordered with the writes.
+    [CS_diskCache invalidateCacheItemWithBaseName:@"a" andCategory:PSD_DC_CATEGORY];
+    if ([CS_diskCache cachedDataWithBaseName:@"a" andCategory:PSD_DC_CATEGORY]) {
+        NSLog(@"ERROR: the removed item is still readable.");
+        return NO;
+    }
+    NSData *dB2 = [self contentForItem:2 withVersion:1];
+    [CS_diskCache saveCachedData:dB2 withBaseName:@"b" andCategory:PSD_DC_CATEGORY];
+    
+    BOOL hasVault = [RealSecureImage isVaultOpen];
+    if (hasVault) {
+        NSArray *arrSecure = [NSArray arrayWithObjects:@"secure", dB, nil];
+        if (![CS_diskCache saveSecureCachedData:arrSecure withBaseName:@"s" andCategory:PSD_DC_CATEGORY] ||
+            ![[CS_diskCache secureCachedDataWithBaseName:@"s" andCategory:PSD_DC_CATEGORY] isEqual:arrSecure]) {
+            NSLog(@"ERROR: the secure item was not readable after it was saved.");
+            return NO;
+        }
+        if (![CS_diskCache saveSecureCachedData:arrSecure withBaseName:@"s-sync" andCategory:PSD_DC_CATEGORY andWaitForWrite:YES]) {
+            NSLog(@"ERROR: the secure item was not written when waiting for it.");
+            return NO;
+        }
+    }
+    else {
+        NSLog(@"DISK-CACHE:  TEST-01:  WARNING: The vault is not open, so secure items will not be tested.");
+    }
+    
+    // - once the memory is released, the disk must have precisely the same content.
+    [CS_diskCache waitForPendingWrites];
+    [CS_diskCache releaseMemoryTier];
+    if ([CS_diskCache cachedDataWithBaseName:@"a" andCategory:PSD_DC_CATEGORY] ||
+        ![[CS_diskCache cachedDataWithBaseName:@"a-copy" andCategory:PSD_DC_CATEGORY] isEqualToData:dA] ||
+        ![[CS_diskCache cachedDataWithBaseName:@"b" andCategory:PSD_DC_CATEGORY] isEqualToData:dB2]) {
+        NSLog(@"ERROR: the disk does not match the memory tier.");
+        return NO;
+    }
+    
+    NSSet *setExpected = hasVault ? [NSSet setWithObjects:@"a-copy", @"b", @"s", @"s-sync", nil] : [NSSet setWithObjects:@"a-copy", @"b", nil];
+    if (![[CS_diskCache secureCachedBaseNamesInCategory:PSD_DC_CATEGORY] isEqualToSet:setExpected]) {
+        NSLog(@"ERROR: the category does not contain the expected items.");
+        return NO;
+    }
+    
+    [CS_diskCache invalidateCacheCategory:PSD_DC_CATEGORY];
+    if ([CS_diskCache cachedDataWithBaseName:@"b" andCategory:PSD_DC_CATEGORY]) {
+        NSLog(@"ERROR: the category was not fully invalidated.");
+        return NO;
+    }
+    
+    // - a read from disk that finishes after a removal must not put the item back in memory.
+    CS_diskCacheMemoryTier *mt = [[[CS_diskCacheMemoryTier alloc] initWithByteLimit:PSD_DC_MAX_SIZE * 4] autorelease];
+    BOOL isKnown               = NO;
+    NSUInteger gen             = 0;
+    [mt dataForKey:@"r" isKnown:&isKnown andGeneration:&gen];
+    [mt setPendingRemovalForKey:@"r"];
+    [mt completePendingWriteForKey:@"r" withSuccess:YES];
+    [mt setData:dA forKey:@"r" readAtGeneration:gen];
+    if ([mt dataForKey:@"r" isKnown:&isKnown] || isKnown) {
+        NSLog(@"ERROR: a stale read restored a removed item.");
+        return NO;
+    }
+    [mt dataForKey:@"r" isKnown:&isKnown andGeneration:&gen];
+    [mt setData:dA forKey:@"r" readAtGeneration:gen];
+    if (![[mt dataForKey:@"r" isKnown:&isKnown] isEqualToData:dA]) {
+        NSLog(@"ERROR: a current read was not kept in memory.");
+        return NO;
+    }
+    
+    NSLog(@"DISK-CACHE:  TEST-01:  All consistency tests passed.");
+    return YES;
+}
+
+/*
+ *  Generate an access trace that is skewed towards a small number of popular items like the message and
+ *  seal lists are in the real application.
+ *  - each entry is the item index, with the high bit set for saves.
+ */
++(NSData *) accessTrace
+{
+    NSMutableData *md = [NSMutableData dataWithLength:PSD_DC_TRACE_LEN * sizeof(uint32_t)];
+    uint32_t *pTrace  = (uint32_t *) [md mutableBytes];
+    uint32_t seed     = 31;
+    for (NSUInteger i = 0; i < PSD_DC_TRACE_LEN; i++) {
+        double r     = (double) ([self nextRandom:&seed] % 10000) / 10000.0;
+        uint32_t idx = (uint32_t) ((double) PSD_DC_NUM_ITEMS * r * r * r);
+        if (([self nextRandom:&seed] % 100) < PSD_DC_SAVE_PCT) {
+            idx |= 0x80000000;
+        }
+        pTrace[i] = idx;
+    }
+    return md;
+}
+
+/*
+ *  Replay the trace against the cache and report the results.
+ */
++(BOOL) replayTrace:(NSData *) dTrace withContent:(NSArray *) arrContent andLimit:(NSUInteger) limit named:(NSString *) name
+{
+    // - every replay starts with the same content on disk and nothing in memory.
+    [CS_diskCache invalidateCacheCategory:PSD_DC_CATEGORY];
+    [CS_diskCache setMemoryTierByteLimit:limit];
+    for (NSUInteger i = 0; i < PSD_DC_NUM_ITEMS; i++) {
+        [CS_diskCache saveCachedData:[arrContent objectAtIndex:i] withBaseName:[NSString stringWithFormat:@"item-%u", (unsigned) i] andCategory:PSD_DC_CATEGORY];
+    }
+    [CS_diskCache waitForPendingWrites];
+    [CS_diskCache releaseMemoryTier];
+    [CS_diskCache resetMemoryTierStatistics];
+    
+    const uint32_t *pTrace = (const uint32_t *) [dTrace bytes];
+    NSUInteger numOps      = [dTrace length] / sizeof(uint32_t);
+    NSUInteger numReads    = 0;
+    NSUInteger numSaves    = 0;
+    NSTimeInterval tiRead  = 0.0;
+    NSTimeInterval tiSave  = 0.0;
+    for (NSUInteger i = 0; i < numOps; i++) {
+        @autoreleasepool {
+            BOOL isSave     = (pTrace[i] & 0x80000000) ? YES : NO;
+            NSUInteger idx  = pTrace[i] & 0x7FFFFFFF;
+            NSString *sBase = [NSString stringWithFormat:@"item-%u", (unsigned) idx];
+            NSData *dItem   = [arrContent objectAtIndex:idx];
+            
+            NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+            if (isSave) {
+                [CS_diskCache saveCachedData:dItem withBaseName:sBase andCategory:PSD_DC_CATEGORY];
+                tiSave += [NSDate timeIntervalSinceReferenceDate] - tStart;
+                numSaves++;
+            }
+            else {
+                NSData *d = [CS_diskCache cachedDataWithBaseName:sBase andCategory:PSD_DC_CATEGORY];
+                tiRead   += [NSDate timeIntervalSinceReferenceDate] - tStart;
+                numReads++;
+                if (![d isEqualToData:dItem]) {
+                    NSLog(@"ERROR: the %@ replay returned the wrong content for %@.", name, sBase);
+                    return NO;
+                }
+            }
+        }
+    }
+    
+    NSTimeInterval tFlush = [NSDate timeIntervalSinceReferenceDate];
+    [CS_diskCache waitForPendingWrites];
+    tFlush = [NSDate timeIntervalSinceReferenceDate] - tFlush;
+    
+    NSLog(@"DISK-CACHE:  TEST-02:  - %@: %u reads at %4.3f ms, %u saves at %4.3f ms, %4.1f ms to finish writing.", name, (unsigned) numReads, numReads ? (tiRead * 1000.0) / (double) numReads : 0.0,
+          (unsigned) numSaves, numSaves ? (tiSave * 1000.0) / (double) numSaves : 0.0, tFlush * 1000.0);
+    NSLog(@"DISK-CACHE:  TEST-02:    %@", [CS_diskCache memoryTierStatistics]);
+    return YES;
+}
+
+/*
+ *  Compare the cache with and without the memory tier over the same access trace.
+ */
++(BOOL) runTest_2TraceBenchmark
+{
+    NSLog(@"DISK-CACHE:  TEST-02:  Starting the access trace benchmark.");
+    NSMutableArray *maContent = [NSMutableArray array];
+    for (NSUInteger i = 0; i < PSD_DC_NUM_ITEMS; i++) {
+        // - some items share content, like the same seal image saved for multiple purposes.
+        if (i && (i % PSD_DC_SHARED_CONTENT) == 0) {
+            [maContent addObject:[maContent objectAtIndex:i - 1]];
+        }
+        else {
+            [maContent addObject:[self contentForItem:i withVersion:0]];
+        }
+    }
+    
+    NSData *dTrace    = [self accessTrace];
+    BOOL ret          = [self replayTrace:dTrace withContent:maContent andLimit:0 named:@"disk only"] &&
+                        [self replayTrace:dTrace withContent:maContent andLimit:(2 * 1024 * 1024) named:@"2MB tier"] &&
+                        [self replayTrace:dTrace withContent:maContent andLimit:(8 * 1024 * 1024) named:@"8MB tier"];
+    
+    // - the standard limit is restored regardless of the outcome.
+    [CS_diskCache setMemoryTierByteLimit:(8 * 1024 * 1024)];
+    [CS_diskCache invalidateCacheCategory:PSD_DC_CATEGORY];
+    if (!ret) {
+        return NO;
+    }
+    
+    NSLog(@"DISK-CACHE:  TEST-02:  The access trace benchmark completed successfully.");
+    return YES;
+}
+
+#endif
+
+/*
+ *  Verify the memory tier of the disk cache and measure its benefit.
+ */
++(void) beginDiskCacheTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    if ([ChatSealDebug_diskCache runTest_1Consistency] &&
+        [ChatSealDebug_diskCache runTest_2TraceBenchmark]) {
+        NSLog(@"DISK-CACHE:  All disk cache tests completed successfully.");
+    }
+    else {
+        NSLog(@"DISK-CACHE: ERROR: Test failure.");
+    }
+#endif
+}
+@end
@@ -11,6 +11,7 @@
 #import "CS_centralNetworkThrottle.h"
 #import "CS_netThrottledAPIFactory.h"
 #import "CS_netFeedAPI.h"
+#import "CS_netTokenScheduler.h"
 
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
 // - these are copied from the central throttle source so that we can accurately test overall limits.
@@ -24,6 +25,9 @@ static const NSTimeInterval PSD_FT_FORCED_INT   = 10;
 static const NSUInteger PSD_FT_MAX_FORCED       = 100;
 static const NSTimeInterval PSD_FT_EVEN_INT     = 10;
 static const NSUInteger PSD_FT_EVEN             = 10;       //  1 per second.
+static const NSTimeInterval PSD_FT_SIM_WINDOW   = (15.0 * 60.0);
+static const NSUInteger PSD_FT_SIM_LIMIT        = 180;
+static const NSTimeInterval PSD_FT_SIM_DURATION = (4.0 * 60.0 * 60.0);
 #endif
 
 // - forward declarations
@@ -46,6 +50,11 @@ static const NSUInteger PSD_FT_EVEN             = 10;       //  1 per second.
 @interface PSD_API_D : CS_netFeedAPI
 @end
 
+// - the scheduler tests are driven by a simulated clock so that hours of traffic can be evaluated instantly.
+@interface PSD_simClock : NSObject <CS_netTokenSchedulerClock>
+@property (nonatomic, assign) NSTimeInterval now;
+@end
+
 /****************************
  ChatSealDebug_feed_throttle
  ****************************/
@@ -539,6 +548,166 @@ static const NSUInteger PSD_FT_EVEN             = 10;       //  1 per second.
 }
 
 
+/*
+ *  Verify that no window of the given size ever contains more than the limit of dispatch times.
+ */
++(BOOL) dispatchTimes:(NSArray *) arrTimes areWithinLimit:(NSUInteger) limit forWindow:(NSTimeInterval) window
+{
+    NSUInteger first = 0;
+    for (NSUInteger i = 0; i < [arrTimes count]; i++) {
+        NSTimeInterval tCur = [(NSNumber *) [arrTimes objectAtIndex:i] doubleValue];
+        while ([(NSNumber *) [arrTimes objectAtIndex:first] doubleValue] <= tCur - window) {
+            first++;
+        }
+        if (i - first + 1 > limit) {
+            NSLog(@"ERROR: The scheduler issued %u requests inside a %4.0f second window, which exceeds %u.", (unsigned) (i - first + 1), window, (unsigned) limit);
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/*
+ *  Run the simulated clock forward until the given time, stopping at every wakeup.
+ */
++(void) runScheduler:(CS_netTokenScheduler *) nts withClock:(PSD_simClock *) clock untilTime:(NSTimeInterval) tEnd
+{
+    for (;;) {
+        NSTimeInterval tNext = [nts nextWakeupTime];
+        if (tNext < 0.0 || tNext > tEnd) {
+            break;
+        }
+        clock.now = MAX(clock.now, tNext);
+        [nts advanceToTime:clock.now];
+    }
+    clock.now = MAX(clock.now, tEnd);
+    [nts advanceToTime:clock.now];
+}
+
+/*
+ *  Exercise the hierarchical token scheduler with synthetic load on a simulated clock, measuring the
+ *  achieved rate and latency.
+ */
++(BOOL) runTest_4HierarchicalScheduler
+{
+    NSLog(@"FEED-THR:  TEST-04:  Beginning hierarchical scheduler testing.");
+    PSD_simClock *clock        = [[[PSD_simClock alloc] init] autorelease];
+    CS_netTokenScheduler *nts  = [[[CS_netTokenScheduler alloc] initWithClock:clock] autorelease];
+    [nts setMaximumQueueDepth:100000];
+    
+    NSLog(@"FEED-THR:  TEST-04:  - verifying saturated endpoint pacing.");
+    [nts setLimit:PSD_FT_SIM_LIMIT perInterval:PSD_FT_SIM_WINDOW withBurst:PSD_FT_SIM_LIMIT/20 forEndpoint:@"timeline" inAccount:@"acct-a" andCategory:CS_CNT_THROTTLE_TRANSIENT];
+    NSMutableArray *maDispatched = [NSMutableArray array];
+    
+    // - offer twice what the endpoint can handle, one request every 2.5 seconds.
+    NSTimeInterval tArrival = 0.0;
+    while (tArrival < PSD_FT_SIM_DURATION) {
+        [ChatSealDebug_feed_throttle runScheduler:nts withClock:clock untilTime:tArrival];
+        id req = [nts scheduleRequestForEndpoint:@"timeline" inAccount:@"acct-a" withPriority:CS_NTS_PRIORITY_NORMAL andAdmission:nil andDispatch:^BOOL(void) {
+            [maDispatched addObject:[NSNumber numberWithDouble:clock.now]];
+            return YES;
+        }];
+        if (!req) {
+            NSLog(@"ERROR: Failed to schedule a synthetic request at %4.2f.", tArrival);
+            return NO;
+        }
+        tArrival += (PSD_FT_SIM_WINDOW / (NSTimeInterval) (PSD_FT_SIM_LIMIT * 2));
+    }
+    [ChatSealDebug_feed_throttle runScheduler:nts withClock:clock untilTime:PSD_FT_SIM_DURATION];
+    
+    if (![ChatSealDebug_feed_throttle dispatchTimes:maDispatched areWithinLimit:PSD_FT_SIM_LIMIT forWindow:PSD_FT_SIM_WINDOW]) {
+        return NO;
+    }
+    
+    double achieved = (double) [maDispatched count] / (PSD_FT_SIM_DURATION / PSD_FT_SIM_WINDOW);
+    CS_netTokenSchedulerStats *stats = [nts statistics];
+    NSLog(@"FEED-THR:  TEST-04:  ...achieved %4.1f requests per window (limit %u), avg latency %4.1fs, max latency %4.1fs, %u wakeups.",
+          achieved, (unsigned) PSD_FT_SIM_LIMIT, stats.avgLatency, stats.maxLatency, (unsigned) stats.numWakeups);
+    if (achieved < (double) PSD_FT_SIM_LIMIT * 0.9) {
+        NSLog(@"ERROR: The scheduler is not keeping the endpoint busy enough.");
+        return NO;
+    }
+    
+    NSLog(@"FEED-THR:  TEST-04:  - verifying that priority is respected.");
+    [nts removeAccount:@"acct-a"];
+    [nts resetStatistics];
+    [nts setLimit:10 perInterval:100.0 withBurst:1 forEndpoint:@"lookup" inAccount:@"acct-b" andCategory:CS_CNT_THROTTLE_TRANSIENT];
+    [nts drainEndpoint:@"lookup" inAccount:@"acct-b"];
+    NSMutableArray *maOrder = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 5; i++) {
+        [nts scheduleRequestForEndpoint:@"lookup" inAccount:@"acct-b" withPriority:CS_NTS_PRIORITY_BACKGROUND andAdmission:nil andDispatch:^BOOL(void) {
+            [maOrder addObject:[NSNumber numberWithInt:CS_NTS_PRIORITY_BACKGROUND]];
+            return YES;
+        }];
+    }
+    [nts scheduleRequestForEndpoint:@"lookup" inAccount:@"acct-b" withPriority:CS_NTS_PRIORITY_HIGH andAdmission:nil andDispatch:^BOOL(void) {
+        [maOrder addObject:[NSNumber numberWithInt:CS_NTS_PRIORITY_HIGH]];
+        return YES;
+    }];
+    [ChatSealDebug_feed_throttle runScheduler:nts withClock:clock untilTime:clock.now + 200.0];
+    if ([maOrder count] != 6 || [(NSNumber *) [maOrder objectAtIndex:0] intValue] != CS_NTS_PRIORITY_HIGH) {
+        NSLog(@"ERROR: The high priority request was not dispatched first.");
+        return NO;
+    }
+    
+    // - the requests were all held by the same bucket, so they should share a single wakeup each time it refills.
+    if ([nts statistics].numWakeups > [maOrder count] + 1) {
+        NSLog(@"ERROR: The scheduler armed redundant wakeups (%u wakeups for %u requests).", (unsigned) [nts statistics].numWakeups, (unsigned) [maOrder count]);
+        return NO;
+    }
+    
+    NSLog(@"FEED-THR:  TEST-04:  - verifying the account and category levels of the hierarchy.");
+    [nts removeAccount:@"acct-b"];
+    [nts setLimit:30 perInterval:60.0 withBurst:1 forAccount:@"acct-c"];
+    [nts setLimit:100 perInterval:60.0 withBurst:1 forEndpoint:@"one" inAccount:@"acct-c" andCategory:CS_CNT_THROTTLE_TRANSIENT];
+    [nts setLimit:100 perInterval:60.0 withBurst:1 forEndpoint:@"two" inAccount:@"acct-c" andCategory:CS_CNT_THROTTLE_TRANSIENT];
+    [nts setLimit:100 perInterval:60.0 withBurst:1 forEndpoint:@"three" inAccount:@"acct-d" andCategory:CS_CNT_THROTTLE_REALTIME];
+    [nts setLimit:20 perInterval:60.0 withBurst:1 forCategory:CS_CNT_THROTTLE_REALTIME];
+    NSMutableArray *maAccount  = [NSMutableArray array];
+    NSMutableArray *maCategory = [NSMutableArray array];
+    NSTimeInterval tBegin      = clock.now;
+    for (NSUInteger i = 0; i < 200; i++) {
+        [nts scheduleRequestForEndpoint:(i % 2) ? @"one" : @"two" inAccount:@"acct-c" withPriority:CS_NTS_PRIORITY_NORMAL andAdmission:nil andDispatch:^BOOL(void) {
+            [maAccount addObject:[NSNumber numberWithDouble:clock.now]];
+            return YES;
+        }];
+        [nts scheduleRequestForEndpoint:@"three" inAccount:@"acct-d" withPriority:CS_NTS_PRIORITY_NORMAL andAdmission:nil andDispatch:^BOOL(void) {
+            [maCategory addObject:[NSNumber numberWithDouble:clock.now]];
+            return YES;
+        }];
+    }
+    [ChatSealDebug_feed_throttle runScheduler:nts withClock:clock untilTime:tBegin + 600.0];
+    if (![ChatSealDebug_feed_throttle dispatchTimes:maAccount areWithinLimit:30 forWindow:60.0] ||
+        ![ChatSealDebug_feed_throttle dispatchTimes:maCategory areWithinLimit:20 forWindow:60.0]) {
+        return NO;
+    }
+    if ([maAccount count] != 200 || [maCategory count] < 175) {
+        NSLog(@"ERROR: The hierarchy is under-utilized (%u account requests, %u category requests).", (unsigned) [maAccount count], (unsigned) [maCategory count]);
+        return NO;
+    }
+    
+    NSLog(@"FEED-THR:  TEST-04:  - verifying that refused requests are retried.");
+    [nts removeAccount:@"acct-c"];
+    [nts removeAccount:@"acct-d"];
+    [nts setLimit:100 perInterval:60.0 withBurst:10 forEndpoint:@"retry" inAccount:@"acct-e" andCategory:CS_CNT_THROTTLE_TRANSIENT];
+    __block NSUInteger numAttempts = 0;
+    __block BOOL isDispatched      = NO;
+    [nts scheduleRequestForEndpoint:@"retry" inAccount:@"acct-e" withPriority:CS_NTS_PRIORITY_NORMAL andAdmission:^BOOL(void) {
+        return (++numAttempts > 3) ? YES : NO;
+    } andDispatch:^BOOL(void) {
+        isDispatched = YES;
+        return YES;
+    }];
+    [ChatSealDebug_feed_throttle runScheduler:nts withClock:clock untilTime:clock.now + 30.0];
+    if (!isDispatched || numAttempts != 4 || [nts numberOfQueuedRequests]) {
+        NSLog(@"ERROR: The refused request was not retried as expected.");
+        return NO;
+    }
+    
+    NSLog(@"FEED-THR:  TEST-04:  Hierarchical scheduler testing completed successfully.");
+    return YES;
+}
+
 #endif
 /*
  *  Test all aspects of feed throttling.
@@ -548,7 +717,8 @@ static const NSUInteger PSD_FT_EVEN             = 10;       //  1 per second.
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
     if(![ChatSealDebug_feed_throttle runTest_1CentralThrottle] ||
        ![ChatSealDebug_feed_throttle runTest_2GenericAPIThrottle] ||
-       ![ChatSealDebug_feed_throttle runTest_3IntegratedThrottleWithLimits]) {
+       ![ChatSealDebug_feed_throttle runTest_3IntegratedThrottleWithLimits] ||
+       ![ChatSealDebug_feed_throttle runTest_4HierarchicalScheduler]) {
         return NO;
     }
 #endif
@@ -587,3 +757,17 @@ static const NSUInteger PSD_FT_EVEN             = 10;       //  1 per second.
 @implementation PSD_API_D
 @end
 
+/******************
+ PSD_simClock
+ ******************/
+@implementation PSD_simClock
+@synthesize now;
+
+/*
+ *  Return the simulated time.
+ */
+-(NSTimeInterval) currentTime
+{
+    return now;
+}
+@end
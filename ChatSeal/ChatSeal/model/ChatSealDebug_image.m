@@ -0,0 +1,280 @@
+//
+//  ChatSealDebug_image.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_image.h"
+#import "ChatSeal.h"
+#import "CS_image.h"
+#import "CS_imageCache.h"
+#import "CS_imageResample.h"
+#import "UIImageGeneration.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static const NSUInteger PSD_IMG_RESAMPLE_TRIALS = 250;
+static const NSUInteger PSD_IMG_MAX_SIDE        = 300;
+static const size_t     PSD_IMG_BENCH_WIDTH     = 4032;
+static const size_t     PSD_IMG_BENCH_HEIGHT    = 3024;
+
+// - forward declarations
+@interface ChatSealDebug_image (internal)
++(uint8_t *) newRandomBitmapOfWidth:(size_t) width andHeight:(size_t) height;
++(UIImage *) solidImageOfWidth:(size_t) width andHeight:(size_t) height;
++(BOOL) runTest_1ResamplerAccuracy;
++(BOOL) runTest_2KeyedCache;
++(BOOL) runTest_3ThumbnailBenchmark;
+@end
+#endif
+
+/**************************
+ ChatSealDebug_image
+ **************************/
+@implementation ChatSealDebug_image
+/*
+ *  Verify the image resampling and caching and measure how quickly thumbnails are created.
+ */
++(void) beginImageTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    NSLog(@"IMAGE:  Starting image processing testing.");
+    if ([ChatSealDebug_image runTest_1ResamplerAccuracy] &&
+        [ChatSealDebug_image runTest_2KeyedCache] &&
+        [ChatSealDebug_image runTest_3ThumbnailBenchmark]) {
+        NSLog(@"IMAGE:  All tests completed successfully.");
+    }
+    else {
+        NSLog(@"IMAGE: ERROR: Test failure.");
+    }
+#endif
+}
+@end
+
+/*********************************
+ ChatSealDebug_image (internal)
+ *********************************/
+@implementation ChatSealDebug_image (internal)
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*
+ *  Allocate a bitmap filled with noise, which is the worst case for the filters.
+ *  - the caller must free the result.
+ */
++(uint8_t *) newRandomBitmapOfWidth:(size_t) width andHeight:(size_t) height
+{
+    uint8_t *ret = (uint8_t *) malloc(width * height * 4);
+    if (ret) {
+        arc4random_buf(ret, width * height * 4);
+    }
+    return ret;
+}
+
+/*
+ *  Build an opaque image of a single color.
+ */
++(UIImage *) solidImageOfWidth:(size_t) width andHeight:(size_t) height
+{
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(width, height), YES, 1.0f);
+    [[UIColor colorWithRed:0.25f green:0.5f blue:0.75f alpha:1.0f] setFill];
+    UIRectFill(CGRectMake(0.0f, 0.0f, width, height));
+    UIImage *ret = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    return ret;
+}
+
+/*
+ *  Verify that the vector filters produce exactly what the scalar ones do, that flat images stay
+ *  flat and that images are fit to the requested size.
+ */
++(BOOL) runTest_1ResamplerAccuracy
+{
+    NSLog(@"IMAGE:  TEST-01:  Starting resampler verification (%s).", CS_ir_isVectorized() ? "vectorized" : "scalar only");
+    
+    for (NSUInteger i = 0; i < PSD_IMG_RESAMPLE_TRIALS; i++) {
+        size_t srcW         = 1 + arc4random_uniform((u_int32_t) PSD_IMG_MAX_SIDE);
+        size_t srcH         = 1 + arc4random_uniform((u_int32_t) PSD_IMG_MAX_SIDE);
+        size_t dstW         = 1 + arc4random_uniform((u_int32_t) srcW);
+        size_t dstH         = 1 + arc4random_uniform((u_int32_t) srcH);
+        cs_ir_filter_t filt = (i & 1) ? CS_IR_FILTER_LANCZOS3 : CS_IR_FILTER_BILINEAR;
+        uint8_t *src        = [ChatSealDebug_image newRandomBitmapOfWidth:srcW andHeight:srcH];
+        uint8_t *dstVec     = (uint8_t *) malloc(dstW * dstH * 4);
+        uint8_t *dstScalar  = (uint8_t *) malloc(dstW * dstH * 4);
+        BOOL ok             = NO;
+        if (src && dstVec && dstScalar &&
+            CS_ir_resampleRGBA(src, srcW, srcH, srcW * 4, dstVec, dstW, dstH, dstW * 4, filt, 1) == 0 &&
+            CS_ir_resampleRGBA(src, srcW, srcH, srcW * 4, dstScalar, dstW, dstH, dstW * 4, filt, 0) == 0 &&
+            !memcmp(dstVec, dstScalar, dstW * dstH * 4)) {
+            ok = YES;
+        }
+        free(src);
+        free(dstVec);
+        free(dstScalar);
+        if (!ok) {
+            NSLog(@"IMAGE:  ERROR:  The vector and scalar results differ for %lux%lu --> %lux%lu.", (unsigned long) srcW, (unsigned long) srcH,
+                  (unsigned long) dstW, (unsigned long) dstH);
+            return NO;
+        }
+    }
+    NSLog(@"IMAGE:  TEST-01:  - %lu random scalings were identical.", (unsigned long) PSD_IMG_RESAMPLE_TRIALS);
+    
+    // - a flat image must not pick up ringing from the negative lobes.
+    size_t srcW  = 640;
+    size_t srcH  = 480;
+    size_t dstW  = 0;
+    size_t dstH  = 0;
+    CS_ir_fitToMaximumSide(srcW, srcH, 100, &dstW, &dstH);
+    if (dstW != 100 || dstH != 75) {
+        NSLog(@"IMAGE:  ERROR:  The fitted size is %lux%lu.", (unsigned long) dstW, (unsigned long) dstH);
+        return NO;
+    }
+    uint8_t *src = (uint8_t *) malloc(srcW * srcH * 4);
+    uint8_t *dst = (uint8_t *) malloc(dstW * dstH * 4);
+    for (size_t i = 0; i < srcW * srcH; i++) {
+        src[i * 4]     = 0x40;
+        src[i * 4 + 1] = 0x80;
+        src[i * 4 + 2] = 0xC0;
+        src[i * 4 + 3] = 0xFF;
+    }
+    BOOL ok = (CS_ir_resampleRGBA(src, srcW, srcH, srcW * 4, dst, dstW, dstH, dstW * 4, CS_IR_FILTER_LANCZOS3, 1) == 0) ? YES : NO;
+    for (size_t i = 0; ok && i < dstW * dstH; i++) {
+        if (memcmp(&(dst[i * 4]), src, 4)) {
+            ok = NO;
+        }
+    }
+    free(src);
+    free(dst);
+    if (!ok) {
+        NSLog(@"IMAGE:  ERROR:  A flat image was not preserved.");
+        return NO;
+    }
+    
+    // - and the UIKit wrapper must honor the requested size.
+    NSError *err   = nil;
+    UIImage *img   = [ChatSealDebug_image solidImageOfWidth:srcW andHeight:srcH];
+    UIImage *small = [CS_image imageResampled:img toMaximumPixels:100 usingLanczos:YES asOpaque:NO withError:&err];
+    if (!small || CGImageGetWidth(small.CGImage) != 100 || CGImageGetHeight(small.CGImage) != 75) {
+        NSLog(@"IMAGE:  ERROR:  Failed to resample the image.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    NSLog(@"IMAGE:  TEST-01:  Resampler verification completed.");
+    return YES;
+}
+
+/*
+ *  Verify that the keyed cache returns what it was given, discards by prefix and stays within its limit.
+ */
++(BOOL) runTest_2KeyedCache
+{
+    NSLog(@"IMAGE:  TEST-02:  Starting keyed cache verification.");
+    
+    UIImage *img          = [ChatSealDebug_image solidImageOfWidth:64 andHeight:64];
+    NSUInteger cost       = CGImageGetBytesPerRow(img.CGImage) * CGImageGetHeight(img.CGImage);
+    CS_imageCache *icTest = [[[CS_imageCache alloc] initWithByteLimit:cost * 4] autorelease];
+    
+    [icTest setImage:img forKey:@"a/1"];
+    [icTest setImage:img forKey:@"a/2"];
+    [icTest setImage:img forKey:@"b/1"];
+    if ([icTest imageForKey:@"a/1"] != img || [icTest imageForKey:@"c/1"] || [icTest numberOfResidentBytes] != cost * 3) {
+        NSLog(@"IMAGE:  ERROR:  The cache did not return what it was given.");
+        return NO;
+    }
+    
+    [icTest removeImagesWithKeyPrefix:@"a/"];
+    if ([icTest imageForKey:@"a/1"] || [icTest imageForKey:@"a/2"] || ![icTest imageForKey:@"b/1"]) {
+        NSLog(@"IMAGE:  ERROR:  The prefix was not discarded correctly.");
+        return NO;
+    }
+    
+    // - the least recently used must be the first to go.
+    for (NSUInteger i = 0; i < 4; i++) {
+        [icTest setImage:img forKey:[NSString stringWithFormat:@"c/%lu", (unsigned long) i]];
+        [icTest imageForKey:@"b/1"];
+    }
+    if (![icTest imageForKey:@"b/1"] || [icTest imageForKey:@"c/0"] || ![icTest imageForKey:@"c/3"] || [icTest numberOfResidentBytes] > cost * 4) {
+        NSLog(@"IMAGE:  ERROR:  The cache did not evict in recency order.");
+        return NO;
+    }
+    NSLog(@"IMAGE:  TEST-02:  - %@", [icTest statisticsDescription]);
+    
+    // - the shared scaled cache must hand back the same object for the same request.
+    UIImage *imgLarge = [ChatSealDebug_image solidImageOfWidth:800 andHeight:600];
+    UIImage *imgOne   = [CS_image cachedImageScaledToMaximumPixels:120 forSource:imgLarge withKey:@"debug-image/large"];
+    UIImage *imgTwo   = [CS_image cachedImageScaledToMaximumPixels:120 forSource:imgLarge withKey:@"debug-image/large"];
+    [CS_image discardCachedImagesWithKeyPrefix:@"debug-image/"];
+    if (!imgOne || imgOne != imgTwo) {
+        NSLog(@"IMAGE:  ERROR:  The scaled image was not reused.");
+        return NO;
+    }
+    
+    NSLog(@"IMAGE:  TEST-02:  Keyed cache verification completed.");
+    return YES;
+}
+
+/*
+ *  Measure how long it takes to create the common thumbnail sizes from a 12 MP photo.
+ */
++(BOOL) runTest_3ThumbnailBenchmark
+{
+    NSLog(@"IMAGE:  TEST-03:  Starting thumbnail benchmark with a %lux%lu image.", (unsigned long) PSD_IMG_BENCH_WIDTH, (unsigned long) PSD_IMG_BENCH_HEIGHT);
+    
+    static const size_t sides[] = {64, 128, 256, 512, 1024};
+    uint8_t *src                = [ChatSealDebug_image newRandomBitmapOfWidth:PSD_IMG_BENCH_WIDTH andHeight:PSD_IMG_BENCH_HEIGHT];
+    uint8_t *dst                = (uint8_t *) malloc(1024 * 1024 * 4);
+    if (!src || !dst) {
+        free(src);
+        free(dst);
+        NSLog(@"IMAGE:  ERROR:  Failed to allocate the benchmark buffers.");
+        return NO;
+    }
+    
+    UIImage *imgSource = nil;
+    CGColorSpaceRef cs = CGColorSpaceCreateDeviceRGB();
+    CGContextRef ctx   = CGBitmapContextCreate(src, PSD_IMG_BENCH_WIDTH, PSD_IMG_BENCH_HEIGHT, 8, PSD_IMG_BENCH_WIDTH * 4, cs,
+                                               kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little);
+    if (ctx) {
+        CGImageRef cgImage = CGBitmapContextCreateImage(ctx);
+        if (cgImage) {
+            imgSource = [UIImage imageWithCGImage:cgImage];
+            CGImageRelease(cgImage);
+        }
+        CGContextRelease(ctx);
+    }
+    CGColorSpaceRelease(cs);
+    
+    for (NSUInteger i = 0; i < sizeof(sides) / sizeof(sides[0]); i++) {
+        size_t dstW = 0;
+        size_t dstH = 0;
+        CS_ir_fitToMaximumSide(PSD_IMG_BENCH_WIDTH, PSD_IMG_BENCH_HEIGHT, sides[i], &dstW, &dstH);
+        
+        NSTimeInterval tiFilters[4];
+        for (NSUInteger f = 0; f < 4; f++) {
+            NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+            CS_ir_resampleRGBA(src, PSD_IMG_BENCH_WIDTH, PSD_IMG_BENCH_HEIGHT, PSD_IMG_BENCH_WIDTH * 4, dst, dstW, dstH, dstW * 4,
+                               (f < 2) ? CS_IR_FILTER_BILINEAR : CS_IR_FILTER_LANCZOS3, (f & 1) ? 0 : 1);
+            tiFilters[f] = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        }
+        
+        // - the prior approach was to let Quartz draw into a smaller context.
+        NSTimeInterval tiDraw = 0.0;
+        if (imgSource) {
+            @autoreleasepool {
+                NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+                [UIImageGeneration image:imgSource scaledTo:(CGFloat) dstW / (CGFloat) PSD_IMG_BENCH_WIDTH asOpaque:YES];
+                tiDraw = [NSDate timeIntervalSinceReferenceDate] - tStart;
+            }
+        }
+        
+        NSLog(@"IMAGE:  TEST-03:  - %4lux%-4lu bilinear %6.1f ms (scalar %6.1f ms), lanczos3 %6.1f ms (scalar %6.1f ms), quartz draw %6.1f ms",
+              (unsigned long) dstW, (unsigned long) dstH, tiFilters[0] * 1000.0, tiFilters[1] * 1000.0, tiFilters[2] * 1000.0, tiFilters[3] * 1000.0,
+              tiDraw * 1000.0);
+    }
+    free(src);
+    free(dst);
+    
+    NSLog(@"IMAGE:  TEST-03:  Thumbnail benchmark completed.");
+    return YES;
+}
+#endif
+@end
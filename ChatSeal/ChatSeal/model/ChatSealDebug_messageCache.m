@@ -0,0 +1,437 @@
+//
+//  ChatSealDebug_messageCache.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_messageCache.h"
+#import "ChatSeal.h"
+#import "CS_processedEntryCache.h"
+#import "CS_cacheMessage.h"
+#import "CS_cacheMessageTable.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static NSString         *PSD_MC_STORE_NAME     = @"debug-mproc";
+static const NSUInteger PSD_MC_NUM_CORRECTNESS = 5000;
+static const NSUInteger PSD_MC_BENCH_ENTRIES   = 1000000;
+static const NSUInteger PSD_MC_LEGACY_ENTRIES  = 100000;
+static const NSUInteger PSD_MC_BENCH_LOOKUPS   = 10000;
+static const NSUInteger PSD_MC_TABLE_MESSAGES  = 2000;
+static const NSUInteger PSD_MC_TABLE_THREADS   = 8;
+static const NSUInteger PSD_MC_TABLE_OPS       = 50000;        //  per thread
+
+// - shared declarations
+@interface CS_cacheMessage (shared)
+-(id) initWithMessage:(NSString *) messageId andSeal:(CS_cacheSeal *) seal;
+-(void) setDateCreated:(NSDate *)dateCreated;
+@end
+
+// - the message table as it was before it was striped, with one lock around everything and a list that is
+//   rebuilt on every request.
+@interface _PSD_mc_legacyTable : NSObject
+-(CS_cacheMessage *) messageForId:(NSString *) mid;
+-(void) cacheMessage:(CS_cacheMessage *) cm;
+-(NSArray *) sortedMessages;
+@end
+
+// - forward declarations
+@interface ChatSealDebug_messageCache (internal)
++(NSString *) hashForIndex:(NSUInteger) idx;
++(NSString *) entryForIndex:(NSUInteger) idx;
++(BOOL) runTest_1ProcessedEntryCorrectness;
++(BOOL) runTest_2ProcessedEntryBenchmark;
++(CS_cacheMessage *) messageForIndex:(NSUInteger) idx;
++(NSTimeInterval) contendOnTable:(id) table;
++(BOOL) runTest_3MessageTableContention;
+@end
+#endif
+
+/******************************
+ ChatSealDebug_messageCache
+ ******************************/
+@implementation ChatSealDebug_messageCache
+/*
+ *  Verify the message cache infrastructure and measure its performance.
+ */
++(void) beginMessageCacheTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    NSLog(@"MSG-CACHE:  Starting message cache testing.");
+    if (![ChatSeal isVaultOpen]) {
+        NSLog(@"MSG-CACHE: ERROR: The vault must be open to run these tests.");
+        return;
+    }
+    
+    if ([ChatSealDebug_messageCache runTest_1ProcessedEntryCorrectness] &&
+        [ChatSealDebug_messageCache runTest_2ProcessedEntryBenchmark] &&
+        [ChatSealDebug_messageCache runTest_3MessageTableContention]) {
+        NSLog(@"MSG-CACHE:  All tests completed successfully.");
+    }
+    else {
+        NSLog(@"MSG-CACHE: ERROR: Test failure.");
+    }
+#endif
+}
+@end
+
+/*************************************
+ ChatSealDebug_messageCache (internal)
+ *************************************/
+@implementation ChatSealDebug_messageCache (internal)
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*
+ *  Return a message hash for the index.
+ */
++(NSString *) hashForIndex:(NSUInteger) idx
+{
+    return [NSString stringWithFormat:@"%08lx-%08lx-hash", (unsigned long) idx, (unsigned long) (idx * 2654435761u)];
+}
+
+/*
+ *  Return an entry id for the index, which is shared by pairs of hashes like a tweet with two images.
+ */
++(NSString *) entryForIndex:(NSUInteger) idx
+{
+    return [NSString stringWithFormat:@"%lu", (unsigned long) (500000000000000000ULL + (idx / 2))];
+}
+
+/*
+ *  Verify that the processed entry store saves, finds and discards entries and that they survive being
+ *  reopened.
+ */
++(BOOL) runTest_1ProcessedEntryCorrectness
+{
+    NSLog(@"MSG-CACHE:  TEST-01:  Starting processed entry verification.");
+    
+    NSError *err                 = nil;
+    CS_processedEntryCache *pec  = [[[CS_processedEntryCache alloc] initWithBaseName:PSD_MC_STORE_NAME] autorelease];
+    if (![pec destroyWithError:&err] || ![pec openWithError:&err]) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to open the store.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    for (NSUInteger i = 0; i < PSD_MC_NUM_CORRECTNESS; i++) {
+        if (![pec setEntry:[ChatSealDebug_messageCache entryForIndex:i] forHash:[ChatSealDebug_messageCache hashForIndex:i] withError:&err]) {
+            NSLog(@"MSG-CACHE:  ERROR:  Failed to save entry %lu.  %@", (unsigned long) i, [err localizedDescription]);
+            return NO;
+        }
+    }
+    
+    // - discard the first few, which removes both hashes for each of them.
+    for (NSUInteger i = 0; i < 10; i += 2) {
+        if (![pec discardEntry:[ChatSealDebug_messageCache entryForIndex:i] withError:&err]) {
+            NSLog(@"MSG-CACHE:  ERROR:  Failed to discard entry %lu.  %@", (unsigned long) i, [err localizedDescription]);
+            return NO;
+        }
+    }
+    
+    // - and check the result both before and after it is reopened.
+    for (NSUInteger pass = 0; pass < 2; pass++) {
+        if ([pec count] != PSD_MC_NUM_CORRECTNESS - 10) {
+            NSLog(@"MSG-CACHE:  ERROR:  The store has %lu entries.", (unsigned long) [pec count]);
+            return NO;
+        }
+        for (NSUInteger i = 0; i < PSD_MC_NUM_CORRECTNESS; i++) {
+            NSString *sEntry = [pec entryForHash:[ChatSealDebug_messageCache hashForIndex:i]];
+            NSString *sWant  = (i < 10) ? nil : [ChatSealDebug_messageCache entryForIndex:i];
+            if (sEntry != sWant && ![sEntry isEqualToString:sWant]) {
+                NSLog(@"MSG-CACHE:  ERROR:  Hash %lu returned %@ instead of %@.", (unsigned long) i, sEntry, sWant);
+                return NO;
+            }
+        }
+        if ([pec hasEntry:[ChatSealDebug_messageCache entryForIndex:0]] || ![pec hasEntry:[ChatSealDebug_messageCache entryForIndex:PSD_MC_NUM_CORRECTNESS - 1]]) {
+            NSLog(@"MSG-CACHE:  ERROR:  The reverse lookup is incorrect.");
+            return NO;
+        }
+        
+        [pec close];
+        if (![pec openWithError:&err]) {
+            NSLog(@"MSG-CACHE:  ERROR:  Failed to reopen the store.  %@", [err localizedDescription]);
+            return NO;
+        }
+    }
+    
+    if (![pec compactWithError:&err] || ![pec verifyWithError:&err] || [pec count] != PSD_MC_NUM_CORRECTNESS - 10) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to compact the store.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    [pec destroyWithError:nil];
+    NSLog(@"MSG-CACHE:  TEST-01:  Processed entry verification completed.");
+    return YES;
+}
+
+/*
+ *  Measure the cost of saving and loading a large number of processed entries, compared with the keyed archive
+ *  that used to be rewritten after every change.
+ */
++(BOOL) runTest_2ProcessedEntryBenchmark
+{
+    NSLog(@"MSG-CACHE:  TEST-02:  Starting processed entry benchmark with %lu entries.", (unsigned long) PSD_MC_BENCH_ENTRIES);
+    
+    NSError *err                = nil;
+    CS_processedEntryCache *pec = [[[CS_processedEntryCache alloc] initWithBaseName:PSD_MC_STORE_NAME] autorelease];
+    if (![pec destroyWithError:&err] || ![pec openWithError:&err]) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to open the store.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+    for (NSUInteger i = 0; i < PSD_MC_BENCH_ENTRIES; i++) {
+        @autoreleasepool {
+            if (![pec setEntry:[ChatSealDebug_messageCache entryForIndex:i] forHash:[ChatSealDebug_messageCache hashForIndex:i] withError:&err]) {
+                NSLog(@"MSG-CACHE:  ERROR:  Failed to save entry %lu.  %@", (unsigned long) i, [err localizedDescription]);
+                return NO;
+            }
+        }
+    }
+    NSTimeInterval tiInsert = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    NSLog(@"MSG-CACHE:  TEST-02:  - store insert:  %6.1f us per entry, including compaction", (tiInsert * 1000000.0) / (double) PSD_MC_BENCH_ENTRIES);
+    
+    [pec close];
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    if (![pec openWithError:&err]) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to reopen the store.  %@", [err localizedDescription]);
+        return NO;
+    }
+    NSTimeInterval tiOpen = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    NSLog(@"MSG-CACHE:  TEST-02:  - store open:    %6.1f ms for %lu entries", tiOpen * 1000.0, (unsigned long) [pec count]);
+    
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    for (NSUInteger i = 0; i < PSD_MC_BENCH_LOOKUPS; i++) {
+        NSUInteger idx = arc4random_uniform((u_int32_t) PSD_MC_BENCH_ENTRIES);
+        if (![[pec entryForHash:[ChatSealDebug_messageCache hashForIndex:idx]] isEqualToString:[ChatSealDebug_messageCache entryForIndex:idx]]) {
+            NSLog(@"MSG-CACHE:  ERROR:  Entry %lu is missing.", (unsigned long) idx);
+            return NO;
+        }
+    }
+    NSTimeInterval tiLookup = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    NSLog(@"MSG-CACHE:  TEST-02:  - store lookup:  %6.1f us per entry", (tiLookup * 1000000.0) / (double) PSD_MC_BENCH_LOOKUPS);
+    [pec destroyWithError:nil];
+    
+    // - the original approach, at a tenth of the size because it is so much slower.
+    NSMutableDictionary *mdLegacy = [NSMutableDictionary dictionaryWithCapacity:PSD_MC_LEGACY_ENTRIES];
+    for (NSUInteger i = 0; i < PSD_MC_LEGACY_ENTRIES; i++) {
+        [mdLegacy setObject:[ChatSealDebug_messageCache entryForIndex:i] forKey:[ChatSealDebug_messageCache hashForIndex:i]];
+    }
+    NSURL *u = [RealSecureImage absoluteURLForVaultFile:PSD_MC_STORE_NAME withError:&err];
+    if (!u) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to build a vault URL.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    NSData *dArchive = [NSKeyedArchiver archivedDataWithRootObject:mdLegacy];
+    if (![RealSecureImage writeVaultData:dArchive toURL:u withError:&err]) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to save the archive.  %@", [err localizedDescription]);
+        return NO;
+    }
+    NSTimeInterval tiLegacySave = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    RSISecureData *secD = nil;
+    NSObject *obj       = nil;
+    if ([RealSecureImage readVaultURL:u intoData:&secD withError:&err]) {
+        obj = [NSKeyedUnarchiver unarchiveObjectWithData:secD.rawData];
+    }
+    NSTimeInterval tiLegacyLoad = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    [[NSFileManager defaultManager] removeItemAtURL:u error:nil];
+    if (![obj isKindOfClass:[NSDictionary class]] || [(NSDictionary *) obj count] != PSD_MC_LEGACY_ENTRIES) {
+        NSLog(@"MSG-CACHE:  ERROR:  Failed to load the archive.  %@", [err localizedDescription]);
+        return NO;
+    }
+    NSLog(@"MSG-CACHE:  TEST-02:  - archive save:  %6.1f ms per entry for %lu entries", tiLegacySave * 1000.0, (unsigned long) PSD_MC_LEGACY_ENTRIES);
+    NSLog(@"MSG-CACHE:  TEST-02:  - archive load:  %6.1f ms for %lu entries", tiLegacyLoad * 1000.0, (unsigned long) PSD_MC_LEGACY_ENTRIES);
+    
+    NSLog(@"MSG-CACHE:  TEST-02:  Processed entry benchmark completed.");
+    return YES;
+}
+
+/*
+ *  Return a cached message for the index, with dates that deliberately arrive out of order.
+ */
++(CS_cacheMessage *) messageForIndex:(NSUInteger) idx
+{
+    CS_cacheMessage *cm = [[[CS_cacheMessage alloc] initWithMessage:[NSString stringWithFormat:@"debug-msg-%lu", (unsigned long) idx] andSeal:nil] autorelease];
+    [cm setDateCreated:[NSDate dateWithTimeIntervalSinceReferenceDate:(NSTimeInterval) ((idx * 7919) % PSD_MC_TABLE_MESSAGES)]];
+    return cm;
+}
+
+/*
+ *  Run the same mix of requests the message list produces against the table from several threads at once
+ *  and return how long it took.
+ *  - most requests are lookups, some fetch the whole list and a few update a message.
+ */
++(NSTimeInterval) contendOnTable:(id) table
+{
+    NSOperationQueue *oq = [[[NSOperationQueue alloc] init] autorelease];
+    [oq setMaxConcurrentOperationCount:(NSInteger) PSD_MC_TABLE_THREADS];
+    
+    NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+    for (NSUInteger t = 0; t < PSD_MC_TABLE_THREADS; t++) {
+        [oq addOperationWithBlock:^(void) {
+            for (NSUInteger i = 0; i < PSD_MC_TABLE_OPS; i++) {
+                @autoreleasepool {
+                    NSUInteger idx = arc4random_uniform((u_int32_t) PSD_MC_TABLE_MESSAGES);
+                    NSUInteger op  = arc4random_uniform(100);
+                    if (op == 0) {
+                        [table cacheMessage:[ChatSealDebug_messageCache messageForIndex:idx]];
+                    }
+                    else if (op < 10) {
+                        [[table sortedMessages] count];
+                    }
+                    else {
+                        [table messageForId:[NSString stringWithFormat:@"debug-msg-%lu", (unsigned long) idx]];
+                    }
+                }
+            }
+        }];
+    }
+    [oq waitUntilAllOperationsAreFinished];
+    return [NSDate timeIntervalSinceReferenceDate] - tStart;
+}
+
+/*
+ *  Verify that the striped message table stays ordered under concurrent changes and compare it to the single
+ *  lock it replaced.
+ */
++(BOOL) runTest_3MessageTableContention
+{
+    NSLog(@"MSG-CACHE:  TEST-03:  Starting message table contention testing with %lu threads.", (unsigned long) PSD_MC_TABLE_THREADS);
+    
+    CS_cacheMessageTable *cmt   = [[[CS_cacheMessageTable alloc] init] autorelease];
+    _PSD_mc_legacyTable *legacy = [[[_PSD_mc_legacyTable alloc] init] autorelease];
+    for (NSUInteger i = 0; i < PSD_MC_TABLE_MESSAGES; i++) {
+        CS_cacheMessage *cm = [ChatSealDebug_messageCache messageForIndex:i];
+        [cmt cacheMessage:cm];
+        [legacy cacheMessage:cm];
+    }
+    
+    NSTimeInterval tiLegacy = [ChatSealDebug_messageCache contendOnTable:legacy];
+    NSTimeInterval tiTable  = [ChatSealDebug_messageCache contendOnTable:cmt];
+    
+    // - the updates only ever replace messages, so the table must have the same content, still in order.
+    NSArray *arrIds  = [cmt sortedMessageIds];
+    NSArray *arrMsgs = [cmt sortedMessages];
+    if ([cmt count] != PSD_MC_TABLE_MESSAGES || [arrIds count] != PSD_MC_TABLE_MESSAGES || [arrMsgs count] != PSD_MC_TABLE_MESSAGES) {
+        NSLog(@"MSG-CACHE:  ERROR:  The table has %lu messages instead of %lu.", (unsigned long) [cmt count], (unsigned long) PSD_MC_TABLE_MESSAGES);
+        return NO;
+    }
+    
+    for (NSUInteger i = 0; i < PSD_MC_TABLE_MESSAGES; i++) {
+        CS_cacheMessage *cm = [arrMsgs objectAtIndex:i];
+        if (![[cm messageId] isEqualToString:[arrIds objectAtIndex:i]] || [cmt messageForId:[cm messageId]] != cm) {
+            NSLog(@"MSG-CACHE:  ERROR:  The ordered lists disagree at index %lu.", (unsigned long) i);
+            return NO;
+        }
+        if (i && [[[arrMsgs objectAtIndex:i - 1] dateCreated] compare:[cm dateCreated]] == NSOrderedDescending) {
+            NSLog(@"MSG-CACHE:  ERROR:  The table is out of order at index %lu.", (unsigned long) i);
+            return NO;
+        }
+    }
+    
+    if ([cmt sortedMessages] != arrMsgs) {
+        NSLog(@"MSG-CACHE:  ERROR:  The message list was not shared between requests.");
+        return NO;
+    }
+    
+    [cmt removeMessageForId:[[arrMsgs objectAtIndex:0] messageId]];
+    if ([cmt count] != PSD_MC_TABLE_MESSAGES - 1 || [cmt messageForId:[[arrMsgs objectAtIndex:0] messageId]] ||
+        [[cmt sortedMessages] count] != PSD_MC_TABLE_MESSAGES - 1 || [arrMsgs count] != PSD_MC_TABLE_MESSAGES) {
+        NSLog(@"MSG-CACHE:  ERROR:  The message was not removed correctly.");
+        return NO;
+    }
+    
+    NSUInteger numOps = PSD_MC_TABLE_THREADS * PSD_MC_TABLE_OPS;
+    NSLog(@"MSG-CACHE:  TEST-03:  - single lock:   %6.2f us per request", (tiLegacy * 1000000.0) / (double) numOps);
+    NSLog(@"MSG-CACHE:  TEST-03:  - striped table: %6.2f us per request", (tiTable * 1000000.0) / (double) numOps);
+    NSLog(@"MSG-CACHE:  TEST-03:  Message table contention testing completed.");
+    return YES;
+}
+#endif
+@end
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/******************************
+ _PSD_mc_legacyTable
+ ******************************/
+@implementation _PSD_mc_legacyTable
+/*
+ *  Object attributes.
+ */
+{
+    NSMutableArray      *maMessageIds;
+    NSMutableDictionary *mdMessages;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    self = [super init];
+    if (self) {
+        maMessageIds = [[NSMutableArray alloc] init];
+        mdMessages   = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [maMessageIds release];
+    maMessageIds = nil;
+    
+    [mdMessages release];
+    mdMessages = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Return the message with the given id.
+ */
+-(CS_cacheMessage *) messageForId:(NSString *) mid
+{
+    @synchronized (maMessageIds) {
+        return [[[mdMessages objectForKey:mid] retain] autorelease];
+    }
+}
+
+/*
+ *  Add the message or replace the one with the same id.
+ */
+-(void) cacheMessage:(CS_cacheMessage *) cm
+{
+    @synchronized (maMessageIds) {
+        NSString *mid = [cm messageId];
+        if ([maMessageIds indexOfObject:mid] == NSNotFound) {
+            [maMessageIds addObject:mid];
+        }
+        [mdMessages setObject:cm forKey:mid];
+    }
+}
+
+/*
+ *  Return the messages in order.
+ */
+-(NSArray *) sortedMessages
+{
+    @synchronized (maMessageIds) {
+        NSMutableArray *maRet = [NSMutableArray array];
+        for (NSString *mid in maMessageIds) {
+            CS_cacheMessage *cm = [mdMessages objectForKey:mid];
+            if (cm) {
+                [maRet addObject:cm];
+            }
+        }
+        return maRet;
+    }
+}
+@end
+#endif
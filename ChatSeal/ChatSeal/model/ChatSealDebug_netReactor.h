@@ -0,0 +1,13 @@
+//
+//  ChatSealDebug_netReactor.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/26/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface ChatSealDebug_netReactor : NSObject
++(void) beginNetReactorTesting;
+@end
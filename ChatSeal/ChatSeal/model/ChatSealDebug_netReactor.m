@@ -0,0 +1,652 @@
+//
+//  ChatSealDebug_netReactor.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/26/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#import "ChatSealDebug_netReactor.h"
+#import "ChatSeal.h"
+#import "CS_basicServer.h"
+#import "CS_basicIOConnection.h"
+#import "CS_netReactor.h"
+
+//  THREADING-NOTES:
+//  - the server and its connections run on the run loop of the test thread, exactly like they would in the app.
+//  - the clients are plain sockets that are driven from a second thread with poll() so that they never
+//    compete with the server for its run loop.
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static const NSUInteger     PSD_NR_PAYLOAD_LEN     = (16 * 1024);
+static const NSUInteger     PSD_NR_TOTAL_BYTES     = (16 * 1024 * 1024);
+static const NSUInteger     PSD_NR_READ_LEN        = (64 * 1024);
+static const NSTimeInterval PSD_NR_TIMEOUT         = 60.0f;
+static const rlim_t         PSD_NR_MAX_DESCRIPTORS = 4096;
+
+// - the server side of the benchmark returns every payload to its sender.
+@interface PSD_nr_echoServer : NSObject <CS_basicServerDelegate, CS_basicIOConnectionDelegate>
+-(id) initAsEventDriven:(BOOL) eventDriven;
+-(BOOL) startWithError:(NSError **) err;
+-(void) stop;
+-(uint16_t) port;
+-(NSUInteger) numberOfConnections;
+-(NSUInteger) numberOfEchoedBytes;
+-(BOOL) hasFailed;
+@end
+
+// - a group of simultaneous clients that each send the same stream of payloads and verify that it comes back intact.
+@interface PSD_nr_clientSwarm : NSObject
+-(id) initWithPort:(uint16_t) port andCount:(NSUInteger) count andStream:(NSData *) d;
+-(BOOL) connectAll;
+-(BOOL) exchangeStream;
+-(void) closeAll;
+-(NSTimeInterval) exchangeTime;
+@end
+
+// - forward declarations
+@interface ChatSealDebug_netReactor (internal)
++(BOOL) runTest_1EchoIntegrity;
++(BOOL) runTest_2LoopbackBenchmark;
+@end
+#endif
+
+/***************************
+ ChatSealDebug_netReactor
+ ***************************/
+@implementation ChatSealDebug_netReactor
+/*
+ *  Verify the reactor-driven server and compare it with the polling server it replaced.
+ *  - this runs on its own thread so that the test owns the run loop that services the server.
+ */
++(void) beginNetReactorTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    NSLog(@"NET-REACTOR:  Starting network reactor testing.");
+    
+    // - a thousand clients on both ends of a connection need more descriptors than the default.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < PSD_NR_MAX_DESCRIPTORS) {
+        rl.rlim_cur = MIN(rl.rlim_max, PSD_NR_MAX_DESCRIPTORS);
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    
+    NSOperationQueue *opQ = [[NSOperationQueue alloc] init];
+    NSBlockOperation *bo  = [NSBlockOperation blockOperationWithBlock:^(void) {
+        if ([ChatSealDebug_netReactor runTest_1EchoIntegrity] &&
+            [ChatSealDebug_netReactor runTest_2LoopbackBenchmark]) {
+            NSLog(@"NET-REACTOR:  All tests completed successfully.");
+        }
+        else {
+            NSLog(@"NET-REACTOR: ERROR: Test failure.");
+        }
+    }];
+    [opQ addOperation:bo];
+    [bo waitUntilFinished];
+    [opQ release];
+#endif
+}
+@end
+
+/**************************************
+ ChatSealDebug_netReactor (internal)
+ **************************************/
+@implementation ChatSealDebug_netReactor (internal)
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*
+ *  Build a stream of framed payloads with the given lengths.
+ */
++(NSData *) streamWithPayloadLengths:(NSArray *) arrLengths
+{
+    NSMutableData *mdStream = [NSMutableData data];
+    for (NSNumber *n in arrLengths) {
+        uint32_t len = (uint32_t) [n unsignedIntegerValue];
+        uint8_t  lenBuf[4];
+        lenBuf[0] = (len >> 24) & 0xFF;
+        lenBuf[1] = (len >> 16) & 0xFF;
+        lenBuf[2] = (len >> 8)  & 0xFF;
+        lenBuf[3] = (len & 0xFF);
+        [mdStream appendBytes:lenBuf length:sizeof(lenBuf)];
+        
+        NSUInteger start = [mdStream length];
+        [mdStream setLength:start + len];
+        uint8_t *buf = (uint8_t *) [mdStream mutableBytes] + start;
+        for (NSUInteger i = 0; i < len; i++) {
+            buf[i] = (uint8_t) ((i * 31) + (start & 0xFF));
+        }
+    }
+    return mdStream;
+}
+
+/*
+ *  Pump the run loop until the condition is satisfied or we run out of time.
+ */
++(BOOL) runUntil:(BOOL (^)(void)) condition
+{
+    NSDate *dtLimit = [NSDate dateWithTimeIntervalSinceNow:PSD_NR_TIMEOUT];
+    while (!condition()) {
+        if ([dtLimit timeIntervalSinceNow] < 0.0f) {
+            return NO;
+        }
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01f]];
+    }
+    return YES;
+}
+
+/*
+ *  Run a swarm against a server on this thread.
+ *  - the two time intervals are optional and return the connection and exchange times.
+ */
++(BOOL) runSwarmWithCount:(NSUInteger) count andStream:(NSData *) dStream againstServer:(PSD_nr_echoServer *) server
+         withConnectTime:(NSTimeInterval *) tiConnect andExchangeTime:(NSTimeInterval *) tiExchange
+{
+    PSD_nr_clientSwarm *swarm = [[[PSD_nr_clientSwarm alloc] initWithPort:[server port] andCount:count andStream:dStream] autorelease];
+    NSOperationQueue *opQ     = [[[NSOperationQueue alloc] init] autorelease];
+    __block BOOL isConnected  = NO;
+    __block BOOL isExchanged  = NO;
+    
+    // - the connection rate is measured from the server's perspective because the clients are done as soon as
+    //   the kernel has queued them.
+    NSTimeInterval tStart    = [NSDate timeIntervalSinceReferenceDate];
+    NSBlockOperation *boConn = [NSBlockOperation blockOperationWithBlock:^(void) {
+        isConnected = [swarm connectAll];
+    }];
+    [opQ addOperation:boConn];
+    if (![self runUntil:^BOOL(void) {return [server numberOfConnections] >= count || [server hasFailed];}] ||
+        [server hasFailed]) {
+        NSLog(@"ERROR: The server only accepted %lu of %lu connections.", (unsigned long) [server numberOfConnections], (unsigned long) count);
+        [boConn waitUntilFinished];
+        [swarm closeAll];
+        return NO;
+    }
+    if (tiConnect) {
+        *tiConnect = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    }
+    [boConn waitUntilFinished];
+    if (!isConnected) {
+        NSLog(@"ERROR: The clients failed to connect.");
+        [swarm closeAll];
+        return NO;
+    }
+    
+    // - the server must keep running while the clients exchange their data.
+    NSBlockOperation *boExchange = [NSBlockOperation blockOperationWithBlock:^(void) {
+        isExchanged = [swarm exchangeStream];
+    }];
+    [opQ addOperation:boExchange];
+    [self runUntil:^BOOL(void) {return [boExchange isFinished];}];
+    [boExchange waitUntilFinished];
+    [swarm closeAll];
+    if (!isExchanged || [server hasFailed]) {
+        NSLog(@"ERROR: The clients failed to exchange their data with the server.");
+        return NO;
+    }
+    if (tiExchange) {
+        *tiExchange = [swarm exchangeTime];
+    }
+    return YES;
+}
+
+/*
+ *  Verify that payloads of every size survive the trip through a reactor connection.
+ */
++(BOOL) runTest_1EchoIntegrity
+{
+    NSLog(@"NET-REACTOR:  TEST-01:  Starting echo integrity testing.");
+    
+    // - the sizes are chosen to straddle the read block and the reactor's overflow buffer.
+    NSArray *arrLengths = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedInteger:0],
+                                                    [NSNumber numberWithUnsignedInteger:1],
+                                                    [NSNumber numberWithUnsignedInteger:[CS_basicIOConnection ioBlockSize] - 4],
+                                                    [NSNumber numberWithUnsignedInteger:[CS_basicIOConnection ioBlockSize] + 1],
+                                                    [NSNumber numberWithUnsignedInteger:70000],
+                                                    [NSNumber numberWithUnsignedInteger:[CS_basicIOConnection maximumPayload]],
+                                                    [NSNumber numberWithUnsignedInteger:3], nil];
+    NSData *dStream = [self streamWithPayloadLengths:arrLengths];
+    
+    NSError *err              = nil;
+    PSD_nr_echoServer *server = [[[PSD_nr_echoServer alloc] initAsEventDriven:YES] autorelease];
+    if (![server startWithError:&err]) {
+        NSLog(@"ERROR: Failed to start the server.  %@", [err localizedDescription]);
+        return NO;
+    }
+    
+    CS_netReactor *reactor = [CS_netReactor reactorForCurrentRunLoop];
+    NSUInteger numWakeups  = [reactor numberOfWakeups];
+    BOOL ret               = [self runSwarmWithCount:8 andStream:dStream againstServer:server withConnectTime:NULL andExchangeTime:NULL];
+    [server stop];
+    if (!ret) {
+        return NO;
+    }
+    
+    if ([server numberOfEchoedBytes] != ([dStream length] - (sizeof(uint32_t) * [arrLengths count])) * 8) {
+        NSLog(@"ERROR: The server echoed an unexpected number of bytes.");
+        return NO;
+    }
+    
+    if ([reactor numberOfWakeups] == numWakeups) {
+        NSLog(@"ERROR: The reactor was never used.");
+        return NO;
+    }
+    
+    NSLog(@"NET-REACTOR:  TEST-01:  All tests completed successfully.");
+    return YES;
+}
+
+/*
+ *  Compare the reactor with the polling server over loopback.
+ */
++(BOOL) runTest_2LoopbackBenchmark
+{
+    NSLog(@"NET-REACTOR:  TEST-02:  Starting loopback benchmark.");
+    
+    CS_netReactor *reactor = [CS_netReactor reactorForCurrentRunLoop];
+    NSUInteger counts[]    = {1, 10, 100, 1000};
+    for (NSUInteger i = 0; i < sizeof(counts)/sizeof(counts[0]); i++) {
+        NSUInteger numClients = counts[i];
+        NSUInteger perClient  = MAX(PSD_NR_TOTAL_BYTES / (numClients * PSD_NR_PAYLOAD_LEN), 1);
+        NSMutableArray *maLen = [NSMutableArray array];
+        for (NSUInteger j = 0; j < perClient; j++) {
+            [maLen addObject:[NSNumber numberWithUnsignedInteger:PSD_NR_PAYLOAD_LEN]];
+        }
+        NSData *dStream       = [self streamWithPayloadLengths:maLen];
+        
+        for (int mode = 0; mode < 2; mode++) {
+            @autoreleasepool {
+                BOOL isEventDriven        = (mode == 0) ? YES : NO;
+                NSError *err              = nil;
+                PSD_nr_echoServer *server = [[[PSD_nr_echoServer alloc] initAsEventDriven:isEventDriven] autorelease];
+                if (![server startWithError:&err]) {
+                    NSLog(@"ERROR: Failed to start the server.  %@", [err localizedDescription]);
+                    return NO;
+                }
+                
+                NSUInteger numWakeups     = [reactor numberOfWakeups];
+                NSUInteger numEvents      = [reactor numberOfEvents];
+                NSTimeInterval tiConnect  = 0.0f;
+                NSTimeInterval tiExchange = 0.0f;
+                BOOL ret                  = [self runSwarmWithCount:numClients andStream:dStream againstServer:server
+                                                    withConnectTime:&tiConnect andExchangeTime:&tiExchange];
+                [server stop];
+                if (!ret) {
+                    return NO;
+                }
+                
+                // - every byte is sent once in each direction.
+                double connPerSec = tiConnect > 0.0f ? (double) numClients / tiConnect : 0.0;
+                double mbPerSec   = tiExchange > 0.0f ? ((double) ([dStream length] * numClients * 2) / (1024.0 * 1024.0)) / tiExchange : 0.0;
+                NSLog(@"NET-REACTOR:  TEST-02:  %-8s %4lu clients --> %9.1f conn/s, %8.2f MB/s, %lu wakeups, %lu events",
+                      isEventDriven ? "reactor" : "polling", (unsigned long) numClients, connPerSec, mbPerSec,
+                      (unsigned long) ([reactor numberOfWakeups] - numWakeups), (unsigned long) ([reactor numberOfEvents] - numEvents));
+            }
+        }
+    }
+    
+    NSLog(@"NET-REACTOR:  TEST-02:  All tests completed successfully.");
+    return YES;
+}
+#endif
+@end
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/**************************
+ PSD_nr_echoServer
+ **************************/
+@implementation PSD_nr_echoServer
+/*
+ *  Object attributes.
+ */
+{
+    BOOL           isEventDriven;
+    CS_basicServer *server;
+    NSMutableArray *maConnections;
+    NSUInteger     numEchoed;
+    BOOL           hasFailed;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initAsEventDriven:(BOOL) eventDriven
+{
+    self = [super init];
+    if (self) {
+        isEventDriven = eventDriven;
+        server        = nil;
+        maConnections = [[NSMutableArray alloc] init];
+        numEchoed     = 0;
+        hasFailed     = NO;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self stop];
+    
+    [maConnections release];
+    maConnections = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Start listening on a local port.
+ */
+-(BOOL) startWithError:(NSError **) err
+{
+    server          = [[CS_basicServer alloc] initWithPort:0 asEventDriven:isEventDriven];
+    server.delegate = self;
+    return [server startServerWithError:err];
+}
+
+/*
+ *  Stop the server and all of its connections.
+ */
+-(void) stop
+{
+    server.delegate = nil;
+    [server stopServer];
+    [server release];
+    server = nil;
+    
+    for (CS_basicIOConnection *bio in maConnections) {
+        bio.delegate = nil;
+        [bio disconnect];
+    }
+    [maConnections removeAllObjects];
+}
+
+/*
+ *  Return the port the server is listening on.
+ */
+-(uint16_t) port
+{
+    return [server serverPort];
+}
+
+/*
+ *  Return the number of connections that have been accepted.
+ */
+-(NSUInteger) numberOfConnections
+{
+    return [maConnections count];
+}
+
+/*
+ *  Return the number of payload bytes that were sent back to the clients.
+ */
+-(NSUInteger) numberOfEchoedBytes
+{
+    return numEchoed;
+}
+
+/*
+ *  Return whether any of the connections failed.
+ */
+-(BOOL) hasFailed
+{
+    return hasFailed;
+}
+
+/*
+ *  A new client connected.
+ */
+-(void) connectionReceived:(CS_basicIOConnection *) conn inServer:(CS_basicServer *) s
+{
+    [maConnections addObject:conn];
+    conn.delegate = self;
+    
+    NSError *err = nil;
+    if (![conn connectWithError:&err]) {
+        NSLog(@"ERROR: Failed to open the server connection.  %@", [err localizedDescription]);
+        hasFailed = YES;
+    }
+}
+
+/*
+ *  Return everything the client sent.
+ */
+-(void) basicConnectionHasData:(CS_basicIOConnection *) ioConn
+{
+    while ([ioConn hasDataForRead]) {
+        NSError *err = nil;
+        NSData *d    = [ioConn checkForDataWithError:&err];
+        if (!d || ![ioConn sendData:d withError:&err]) {
+            NSLog(@"ERROR: Failed to echo the client data.  %@", [err localizedDescription]);
+            hasFailed = YES;
+            return;
+        }
+        numEchoed += [d length];
+    }
+}
+
+/*
+ *  A connection failed.
+ */
+-(void) basicConnectionFailed:(CS_basicIOConnection *) ioConn
+{
+    hasFailed = YES;
+}
+@end
+
+/**************************
+ PSD_nr_clientSwarm
+ **************************/
+@implementation PSD_nr_clientSwarm
+/*
+ *  Object attributes.
+ */
+{
+    uint16_t       port;
+    NSUInteger     count;
+    NSData         *dStream;
+    NSMutableData  *mdSockets;
+    NSMutableData  *mdSent;
+    NSMutableData  *mdRecv;
+    NSTimeInterval tiExchange;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithPort:(uint16_t) p andCount:(NSUInteger) c andStream:(NSData *) d
+{
+    self = [super init];
+    if (self) {
+        port       = p;
+        count      = c;
+        dStream    = [d retain];
+        mdSockets  = [[NSMutableData alloc] initWithLength:sizeof(int) * c];
+        mdSent     = [[NSMutableData alloc] initWithLength:sizeof(NSUInteger) * c];
+        mdRecv     = [[NSMutableData alloc] initWithLength:sizeof(NSUInteger) * c];
+        tiExchange = 0.0f;
+        int *socks = (int *) [mdSockets mutableBytes];
+        for (NSUInteger i = 0; i < c; i++) {
+            socks[i] = -1;
+        }
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self closeAll];
+    
+    [dStream release];
+    dStream = nil;
+    
+    [mdSockets release];
+    mdSockets = nil;
+    
+    [mdSent release];
+    mdSent = nil;
+    
+    [mdRecv release];
+    mdRecv = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Open every client at once and wait for all of them to complete.
+ */
+-(BOOL) connectAll
+{
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_len         = sizeof(sin);
+    sin.sin_family      = AF_INET;
+    sin.sin_port        = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    int *socks = (int *) [mdSockets mutableBytes];
+    int on     = 1;
+    for (NSUInteger i = 0; i < count; i++) {
+        socks[i] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (socks[i] == -1) {
+            NSLog(@"ERROR: Failed to create client socket %lu (%d).", (unsigned long) i, errno);
+            return NO;
+        }
+        setsockopt(socks[i], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        fcntl(socks[i], F_SETFL, fcntl(socks[i], F_GETFL, 0) | O_NONBLOCK);
+        if (connect(socks[i], (struct sockaddr *) &sin, sizeof(sin)) == -1 && errno != EINPROGRESS) {
+            NSLog(@"ERROR: Failed to connect client socket %lu (%d).", (unsigned long) i, errno);
+            return NO;
+        }
+    }
+    
+    // - a connection is complete when it becomes writable.
+    NSMutableData *mdPoll  = [NSMutableData dataWithLength:sizeof(struct pollfd) * count];
+    struct pollfd *pfd     = (struct pollfd *) [mdPoll mutableBytes];
+    NSUInteger numPending  = count;
+    NSTimeInterval tiLimit = [NSDate timeIntervalSinceReferenceDate] + PSD_NR_TIMEOUT;
+    for (NSUInteger i = 0; i < count; i++) {
+        pfd[i].fd     = socks[i];
+        pfd[i].events = POLLOUT;
+    }
+    while (numPending && [NSDate timeIntervalSinceReferenceDate] < tiLimit) {
+        if (poll(pfd, (nfds_t) count, 100) == -1 && errno != EINTR) {
+            return NO;
+        }
+        for (NSUInteger i = 0; i < count; i++) {
+            if (pfd[i].fd == -1 || !pfd[i].revents) {
+                continue;
+            }
+            if (pfd[i].revents & (POLLERR | POLLHUP)) {
+                NSLog(@"ERROR: Client socket %lu failed to connect.", (unsigned long) i);
+                return NO;
+            }
+            pfd[i].fd = -1;
+            numPending--;
+        }
+    }
+    return numPending ? NO : YES;
+}
+
+/*
+ *  Send the stream from every client and verify that it is returned intact.
+ */
+-(BOOL) exchangeStream
+{
+    int *socks             = (int *) [mdSockets mutableBytes];
+    NSUInteger *sent       = (NSUInteger *) [mdSent mutableBytes];
+    NSUInteger *recvd      = (NSUInteger *) [mdRecv mutableBytes];
+    NSUInteger total       = [dStream length];
+    const uint8_t *pStream = (const uint8_t *) [dStream bytes];
+    NSMutableData *mdPoll  = [NSMutableData dataWithLength:sizeof(struct pollfd) * count];
+    struct pollfd *pfd     = (struct pollfd *) [mdPoll mutableBytes];
+    uint8_t *readBuf       = (uint8_t *) malloc(PSD_NR_READ_LEN);
+    NSUInteger numPending  = count;
+    BOOL ret               = YES;
+    
+    NSTimeInterval tStart  = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval tiLimit = tStart + PSD_NR_TIMEOUT;
+    while (ret && numPending && [NSDate timeIntervalSinceReferenceDate] < tiLimit) {
+        for (NSUInteger i = 0; i < count; i++) {
+            pfd[i].fd      = (recvd[i] < total) ? socks[i] : -1;
+            pfd[i].events  = POLLIN | ((sent[i] < total) ? POLLOUT : 0);
+            pfd[i].revents = 0;
+        }
+        if (poll(pfd, (nfds_t) count, 100) == -1 && errno != EINTR) {
+            ret = NO;
+            break;
+        }
+        
+        for (NSUInteger i = 0; i < count && ret; i++) {
+            if (pfd[i].revents & POLLOUT) {
+                ssize_t numWritten = write(socks[i], pStream + sent[i], total - sent[i]);
+                if (numWritten > 0) {
+                    sent[i] += (NSUInteger) numWritten;
+                }
+                else if (numWritten == -1 && errno != EAGAIN && errno != EINTR) {
+                    NSLog(@"ERROR: Client %lu failed to write (%d).", (unsigned long) i, errno);
+                    ret = NO;
+                }
+            }
+            
+            if (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t numRead = read(socks[i], readBuf, MIN(PSD_NR_READ_LEN, total - recvd[i]));
+                if (numRead > 0) {
+                    if (memcmp(readBuf, pStream + recvd[i], (size_t) numRead)) {
+                        NSLog(@"ERROR: Client %lu received corrupted data at offset %lu.", (unsigned long) i, (unsigned long) recvd[i]);
+                        ret = NO;
+                    }
+                    recvd[i] += (NSUInteger) numRead;
+                    if (recvd[i] == total) {
+                        numPending--;
+                    }
+                }
+                else if (numRead == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    NSLog(@"ERROR: Client %lu was disconnected early.", (unsigned long) i);
+                    ret = NO;
+                }
+            }
+        }
+    }
+    tiExchange = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    free(readBuf);
+    
+    if (ret && numPending) {
+        NSLog(@"ERROR: %lu clients timed out waiting for their data.", (unsigned long) numPending);
+        ret = NO;
+    }
+    return ret;
+}
+
+/*
+ *  Close all the client sockets.
+ */
+-(void) closeAll
+{
+    int *socks = (int *) [mdSockets mutableBytes];
+    for (NSUInteger i = 0; i < count; i++) {
+        if (socks[i] != -1) {
+            close(socks[i]);
+            socks[i] = -1;
+        }
+    }
+}
+
+/*
+ *  Return the time it took to complete the last exchange.
+ */
+-(NSTimeInterval) exchangeTime
+{
+    return tiExchange;
+}
+@end
+#endif
@@ -0,0 +1,360 @@
+//
+//  ChatSealDebug_qrEncode.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_qrEncode.h"
+#import "ChatSeal.h"
+#import "ChatSealQREncode.h"
+#import "CS_qrReedSolomon.h"
+#import "CS_qr_encode_defs.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static const NSUInteger PSD_QE_CORPUS_SIZE   = 400;
+static const NSUInteger PSD_QE_MAX_PAYLOAD   = 1200;
+static const NSUInteger PSD_QE_BENCH_ENCODES = 40;
+static const NSUInteger PSD_QE_RS_TRIALS      = 25;
+static const NSUInteger PSD_QE_RS_BENCH       = 2000;
+
+// - testing APIs.
+@interface ChatSealQREncode (internal)
+-(BOOL) encodeQRString:(NSString *) toEncode asVersion:(NSUInteger) version andLevel:(ps_qre_error_correction_t) level andMask:(ps_qre_masking_pattern_t) mask
+             withError:(NSError **) err;
+-(void) setLegacyMaskEvaluation:(BOOL) isLegacy;
+-(int) maskingPatternNumber;
+-(int) symbolSize;
+-(BOOL) isModuleDarkAtX:(int) x andY:(int) y;
+-(void) getRSCodeWord:(unsigned char *) lpbyRSWork withNumData:(int) ncDataCodeWord andNumCode:(int) ncRSCodeWord;
+@end
+
+// - forward declarations
+@interface ChatSealDebug_qrEncode (internal)
++(NSString *) payloadForIndex:(NSUInteger) idx;
++(ChatSealQREncode *) encoderForString:(NSString *) s asVersion:(NSUInteger) version andLevel:(ps_qre_error_correction_t) level
+                       usingLegacyMasks:(BOOL) isLegacy withError:(NSError **) err;
++(BOOL) runTest_1IdenticalSymbols;
++(BOOL) runTest_2EncodeBenchmark;
++(void) legacyParityForData:(const unsigned char *) data withShortBlocks:(int) numShort ofLength:(int) lenShort andLongBlocks:(int) numLong
+                   ofLength:(int) lenLong andParityLength:(int) numParity intoInterleavedParity:(unsigned char *) parity;
++(BOOL) runTest_3ReedSolomonVectors;
++(BOOL) runTest_4ReedSolomonBenchmark;
+@end
+#endif
+
+/**************************
+ ChatSealDebug_qrEncode
+ **************************/
+@implementation ChatSealDebug_qrEncode
+/*
+ *  Verify that mask selection and error correction are unchanged and measure how quickly symbols are encoded.
+ */
++(void) beginQREncodeTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    NSLog(@"QR-ENCODE:  Starting QR encoding testing.");
+    if ([ChatSealDebug_qrEncode runTest_1IdenticalSymbols] &&
+        [ChatSealDebug_qrEncode runTest_2EncodeBenchmark] &&
+        [ChatSealDebug_qrEncode runTest_3ReedSolomonVectors] &&
+        [ChatSealDebug_qrEncode runTest_4ReedSolomonBenchmark]) {
+        NSLog(@"QR-ENCODE:  All tests completed successfully.");
+    }
+    else {
+        NSLog(@"QR-ENCODE: ERROR: Test failure.");
+    }
+#endif
+}
+@end
+
+/*********************************
+ ChatSealDebug_qrEncode (internal)
+ *********************************/
+@implementation ChatSealDebug_qrEncode (internal)
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*
+ *  Build a payload that exercises each of the encoding modes at a variety of lengths.
+ */
++(NSString *) payloadForIndex:(NSUInteger) idx
+{
+    static const char *numeric  = "0123456789";
+    static const char *alphabet = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    static const char *text     = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~:/?#[]@!$&'()*+,;=";
+    
+    // - the seal share URLs are the most common content, so they get a quarter of the corpus.
+    NSUInteger len = 1 + arc4random_uniform((u_int32_t) PSD_QE_MAX_PAYLOAD);
+    if (idx % 4 == 0) {
+        NSMutableString *ms = [NSMutableString stringWithString:@"https://chatseal.example.com/seal?id="];
+        for (NSUInteger i = 0; i < len / 4; i++) {
+            [ms appendFormat:@"%c", text[arc4random_uniform(52)]];
+        }
+        return ms;
+    }
+    
+    const char *chars   = (idx % 4 == 1) ? numeric : ((idx % 4 == 2) ? alphabet : text);
+    u_int32_t numChars  = (u_int32_t) strlen(chars);
+    NSMutableString *ms = [NSMutableString stringWithCapacity:len];
+    for (NSUInteger i = 0; i < len; i++) {
+        [ms appendFormat:@"%c", chars[arc4random_uniform(numChars)]];
+    }
+    return ms;
+}
+
+/*
+ *  Encode the string into a symbol using the requested form of mask evaluation.
+ */
++(ChatSealQREncode *) encoderForString:(NSString *) s asVersion:(NSUInteger) version andLevel:(ps_qre_error_correction_t) level
+                       usingLegacyMasks:(BOOL) isLegacy withError:(NSError **) err
+{
+    ChatSealQREncode *qre = [[[ChatSealQREncode alloc] init] autorelease];
+    [qre setLegacyMaskEvaluation:isLegacy];
+    if (![qre encodeQRString:s asVersion:version andLevel:level andMask:CS_QRE_MP_COMPUTE withError:err]) {
+        return nil;
+    }
+    return qre;
+}
+
+/*
+ *  Verify that the bitboard mask evaluation chooses the same mask and produces the same symbol as
+ *  the original penalty count.
+ */
++(BOOL) runTest_1IdenticalSymbols
+{
+    NSLog(@"QR-ENCODE:  TEST-01:  Starting symbol comparison with %lu payloads.", (unsigned long) PSD_QE_CORPUS_SIZE);
+    
+    NSUInteger numEncoded = 0;
+    NSUInteger maskCounts[8];
+    memset(maskCounts, 0, sizeof(maskCounts));
+    for (NSUInteger i = 0; i < PSD_QE_CORPUS_SIZE; i++) {
+        @autoreleasepool {
+            NSString *payload               = [ChatSealDebug_qrEncode payloadForIndex:i];
+            ps_qre_error_correction_t level = (ps_qre_error_correction_t) (i % 4);
+            NSError *err                    = nil;
+            ChatSealQREncode *qreBits       = [ChatSealDebug_qrEncode encoderForString:payload asVersion:CS_QRE_VERSION_AUTO andLevel:level
+                                                                      usingLegacyMasks:NO withError:&err];
+            ChatSealQREncode *qreLegacy     = [ChatSealDebug_qrEncode encoderForString:payload asVersion:CS_QRE_VERSION_AUTO andLevel:level
+                                                                      usingLegacyMasks:YES withError:nil];
+            
+            // - the largest payloads won't fit at the higher correction levels, but that must be true of both.
+            if (!qreBits || !qreLegacy) {
+                if (qreBits || qreLegacy) {
+                    NSLog(@"ERROR: only one of the encoders accepted payload %lu.  %@", (unsigned long) i, [err localizedDescription]);
+                    return NO;
+                }
+                continue;
+            }
+            
+            if ([qreBits maskingPatternNumber] != [qreLegacy maskingPatternNumber] || [qreBits symbolSize] != [qreLegacy symbolSize]) {
+                NSLog(@"ERROR: the mask for payload %lu is %d, but should be %d.", (unsigned long) i, [qreBits maskingPatternNumber], [qreLegacy maskingPatternNumber]);
+                return NO;
+            }
+            
+            int size = [qreBits symbolSize];
+            for (int x = 0; x < size; x++) {
+                for (int y = 0; y < size; y++) {
+                    if ([qreBits isModuleDarkAtX:x andY:y] != [qreLegacy isModuleDarkAtX:x andY:y]) {
+                        NSLog(@"ERROR: the symbols for payload %lu differ at %d, %d.", (unsigned long) i, x, y);
+                        return NO;
+                    }
+                }
+            }
+            
+            maskCounts[[qreBits maskingPatternNumber] & 7]++;
+            numEncoded++;
+        }
+    }
+    
+    if (numEncoded < PSD_QE_CORPUS_SIZE / 2) {
+        NSLog(@"ERROR: too few of the payloads could be encoded (%lu).", (unsigned long) numEncoded);
+        return NO;
+    }
+    
+    NSLog(@"QR-ENCODE:  TEST-01:  - %lu symbols matched, masks chosen: %lu %lu %lu %lu %lu %lu %lu %lu", (unsigned long) numEncoded,
+          (unsigned long) maskCounts[0], (unsigned long) maskCounts[1], (unsigned long) maskCounts[2], (unsigned long) maskCounts[3],
+          (unsigned long) maskCounts[4], (unsigned long) maskCounts[5], (unsigned long) maskCounts[6], (unsigned long) maskCounts[7]);
+    NSLog(@"QR-ENCODE:  TEST-01:  Symbol comparison completed.");
+    return YES;
+}
+
+/*
+ *  Measure the symbols encoded per second at each version with both forms of mask evaluation.
+ *  - this excludes rendering the image, which depends only on the target dimension.
+ */
++(BOOL) runTest_2EncodeBenchmark
+{
+    NSLog(@"QR-ENCODE:  TEST-02:  Starting encoding benchmark.");
+    
+    static const NSUInteger versions[] = {1, 5, 10, 15, 20, 25, 30, 35, 40};
+    NSString *payload                  = @"https://chatseal.example.com/seal?id=0123456789abcdef";
+    for (NSUInteger v = 0; v < sizeof(versions) / sizeof(versions[0]); v++) {
+        NSTimeInterval tiElapsed[2] = {0.0f, 0.0f};
+        for (NSUInteger pass = 0; pass < 2; pass++) {
+            BOOL isLegacy         = (pass == 1);
+            NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+            for (NSUInteger i = 0; i < PSD_QE_BENCH_ENCODES; i++) {
+                @autoreleasepool {
+                    NSError *err = nil;
+                    if (![ChatSealDebug_qrEncode encoderForString:payload asVersion:versions[v] andLevel:CS_QRE_EC_LOW usingLegacyMasks:isLegacy withError:&err]) {
+                        NSLog(@"ERROR: failed to encode version %lu.  %@", (unsigned long) versions[v], [err localizedDescription]);
+                        return NO;
+                    }
+                }
+            }
+            tiElapsed[pass] = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        }
+        
+        double bitsRate   = tiElapsed[0] > 0.0f ? (double) PSD_QE_BENCH_ENCODES / tiElapsed[0] : 0.0f;
+        double legacyRate = tiElapsed[1] > 0.0f ? (double) PSD_QE_BENCH_ENCODES / tiElapsed[1] : 0.0f;
+        NSLog(@"QR-ENCODE:  TEST-02:  - version %2lu: bitboard %8.1f/s, legacy %8.1f/s (%.1fx)", (unsigned long) versions[v], bitsRate, legacyRate,
+              legacyRate > 0.0f ? bitsRate / legacyRate : 0.0f);
+    }
+    
+    NSLog(@"QR-ENCODE:  TEST-02:  Encoding benchmark completed.");
+    return YES;
+}
+
+/*
+ *  Compute the interleaved parity for a symbol one block at a time with the original long division.
+ */
++(void) legacyParityForData:(const unsigned char *) data withShortBlocks:(int) numShort ofLength:(int) lenShort andLongBlocks:(int) numLong
+                   ofLength:(int) lenLong andParityLength:(int) numParity intoInterleavedParity:(unsigned char *) parity
+{
+    static ChatSealQREncode *qre = nil;
+    if (!qre) {
+        qre = [[ChatSealQREncode alloc] init];
+    }
+    
+    unsigned char work[CS_QRE_MAX_CODEBLOCK];
+    int numBlocks = numShort + numLong;
+    for (int b = 0; b < numBlocks; b++) {
+        int len = (b < numShort) ? lenShort : lenLong;
+        memset(work, 0, sizeof(work));
+        memcpy(work, data, (size_t) len);
+        data += len;
+        [qre getRSCodeWord:work withNumData:len andNumCode:numParity];
+        for (int j = 0; j < numParity; j++) {
+            parity[(j * numBlocks) + b] = work[j];
+        }
+    }
+}
+
+/*
+ *  Verify the Reed-Solomon encoder against the worked examples in the QR specification and then against
+ *  the original long division for every version and level.
+ */
++(BOOL) runTest_3ReedSolomonVectors
+{
+    NSLog(@"QR-ENCODE:  TEST-03:  Starting Reed-Solomon verification (%s).", [CS_qrReedSolomon isVectorized] ? "vectorized" : "scalar");
+    
+    // - the numeric example '01234567' and the alphanumeric example 'HELLO WORLD', both at 1-M.
+    static const unsigned char specData[2][16]  = {{0x10, 0x20, 0x0C, 0x56, 0x61, 0x80, 0xEC, 0x11, 0xEC, 0x11, 0xEC, 0x11, 0xEC, 0x11, 0xEC, 0x11},
+                                                   {0x20, 0x5B, 0x0B, 0x78, 0xD1, 0x72, 0xDC, 0x4D, 0x43, 0x40, 0xEC, 0x11, 0xEC, 0x11, 0xEC, 0x11}};
+    static const unsigned char specParity[2][10] = {{0xA5, 0x24, 0xD4, 0xC1, 0xED, 0x36, 0xC7, 0x87, 0x2C, 0x55},
+                                                    {0xC4, 0x23, 0x27, 0x77, 0xEB, 0xD7, 0xE7, 0xE2, 0x5D, 0x17}};
+    CS_qrReedSolomon *rs = [CS_qrReedSolomon encoderForParityLength:10];
+    for (int i = 0; i < 2; i++) {
+        unsigned char parity[10];
+        [rs encodeData:specData[i] ofLength:16 intoParity:parity];
+        if (memcmp(parity, specParity[i], sizeof(parity))) {
+            NSLog(@"ERROR: the single block parity for specification example %d is incorrect.", i + 1);
+            return NO;
+        }
+        
+        memset(parity, 0, sizeof(parity));
+        [rs encodeBlocksFromData:specData[i] withShortBlocks:1 ofLength:16 andLongBlocks:0 ofLength:0 intoInterleavedParity:parity];
+        if (memcmp(parity, specParity[i], sizeof(parity))) {
+            NSLog(@"ERROR: the interleaved parity for specification example %d is incorrect.", i + 1);
+            return NO;
+        }
+    }
+    NSLog(@"QR-ENCODE:  TEST-03:  - the specification examples are correct.");
+    
+    unsigned char *data      = (unsigned char *) malloc(CS_QRE_MAX_DATACODEWORD);
+    unsigned char *parity    = (unsigned char *) malloc(CS_QRE_MAX_ALLCODEWORD);
+    unsigned char *parityRef = (unsigned char *) malloc(CS_QRE_MAX_ALLCODEWORD);
+    BOOL ret                 = YES;
+    for (int v = 1; v <= 40 && ret; v++) {
+        for (int l = 0; l < 4 && ret; l++) {
+            CS_QRE_RS_BLOCKINFO *bi1 = &(CS_QRE_VersionInfo[v].RS_BlockInfo1[l]);
+            CS_QRE_RS_BLOCKINFO *bi2 = &(CS_QRE_VersionInfo[v].RS_BlockInfo2[l]);
+            int numParity            = bi1->ncAllCodeWord - bi1->ncDataCodeWord;
+            int numBlocks            = bi1->ncRSBlock + bi2->ncRSBlock;
+            rs                       = [CS_qrReedSolomon encoderForParityLength:numParity];
+            if (!rs) {
+                NSLog(@"ERROR: there is no encoder for %d-%d.", v, l);
+                ret = NO;
+                break;
+            }
+            
+            for (NSUInteger t = 0; t < PSD_QE_RS_TRIALS; t++) {
+                arc4random_buf(data, CS_QRE_VersionInfo[v].ncDataCodeWord[l]);
+                [rs encodeBlocksFromData:data withShortBlocks:bi1->ncRSBlock ofLength:bi1->ncDataCodeWord andLongBlocks:bi2->ncRSBlock
+                                ofLength:bi2->ncDataCodeWord intoInterleavedParity:parity];
+                [ChatSealDebug_qrEncode legacyParityForData:data withShortBlocks:bi1->ncRSBlock ofLength:bi1->ncDataCodeWord andLongBlocks:bi2->ncRSBlock
+                                                   ofLength:bi2->ncDataCodeWord andParityLength:numParity intoInterleavedParity:parityRef];
+                if (memcmp(parity, parityRef, (size_t) (numParity * numBlocks))) {
+                    NSLog(@"ERROR: the parity for %d-%d differs from the original encoding.", v, l);
+                    ret = NO;
+                    break;
+                }
+            }
+        }
+    }
+    free(data);
+    free(parity);
+    free(parityRef);
+    if (!ret) {
+        return NO;
+    }
+    
+    NSLog(@"QR-ENCODE:  TEST-03:  - every version and level matched the original encoding.");
+    NSLog(@"QR-ENCODE:  TEST-03:  Reed-Solomon verification completed.");
+    return YES;
+}
+
+/*
+ *  Measure the Reed-Solomon throughput at the highest correction level, which has the most blocks.
+ */
++(BOOL) runTest_4ReedSolomonBenchmark
+{
+    NSLog(@"QR-ENCODE:  TEST-04:  Starting Reed-Solomon benchmark.");
+    
+    static const int versions[] = {1, 10, 20, 30, 40};
+    unsigned char *data         = (unsigned char *) malloc(CS_QRE_MAX_DATACODEWORD);
+    unsigned char *parity       = (unsigned char *) malloc(CS_QRE_MAX_ALLCODEWORD);
+    arc4random_buf(data, CS_QRE_MAX_DATACODEWORD);
+    for (NSUInteger v = 0; v < sizeof(versions) / sizeof(versions[0]); v++) {
+        CS_QRE_RS_BLOCKINFO *bi1 = &(CS_QRE_VersionInfo[versions[v]].RS_BlockInfo1[CS_QRE_EC_HI]);
+        CS_QRE_RS_BLOCKINFO *bi2 = &(CS_QRE_VersionInfo[versions[v]].RS_BlockInfo2[CS_QRE_EC_HI]);
+        int numParity            = bi1->ncAllCodeWord - bi1->ncDataCodeWord;
+        CS_qrReedSolomon *rs     = [CS_qrReedSolomon encoderForParityLength:numParity];
+        
+        NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+        for (NSUInteger i = 0; i < PSD_QE_RS_BENCH; i++) {
+            [rs encodeBlocksFromData:data withShortBlocks:bi1->ncRSBlock ofLength:bi1->ncDataCodeWord andLongBlocks:bi2->ncRSBlock
+                            ofLength:bi2->ncDataCodeWord intoInterleavedParity:parity];
+        }
+        NSTimeInterval tiNew = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        
+        tStart = [NSDate timeIntervalSinceReferenceDate];
+        for (NSUInteger i = 0; i < PSD_QE_RS_BENCH; i++) {
+            [ChatSealDebug_qrEncode legacyParityForData:data withShortBlocks:bi1->ncRSBlock ofLength:bi1->ncDataCodeWord andLongBlocks:bi2->ncRSBlock
+                                               ofLength:bi2->ncDataCodeWord andParityLength:numParity intoInterleavedParity:parity];
+        }
+        NSTimeInterval tiLegacy = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        
+        double numMB      = (double) (CS_QRE_VersionInfo[versions[v]].ncDataCodeWord[CS_QRE_EC_HI] * PSD_QE_RS_BENCH) / (1024.0 * 1024.0);
+        double newRate    = tiNew > 0.0f ? numMB / tiNew : 0.0f;
+        double legacyRate = tiLegacy > 0.0f ? numMB / tiLegacy : 0.0f;
+        NSLog(@"QR-ENCODE:  TEST-04:  - version %2d-H (%2d blocks): table %8.2f MB/s, legacy %8.2f MB/s (%.1fx)", versions[v], bi1->ncRSBlock + bi2->ncRSBlock,
+              newRate, legacyRate, legacyRate > 0.0f ? newRate / legacyRate : 0.0f);
+    }
+    free(data);
+    free(parity);
+    
+    NSLog(@"QR-ENCODE:  TEST-04:  Reed-Solomon benchmark completed.");
+    return YES;
+}
+#endif
+@end
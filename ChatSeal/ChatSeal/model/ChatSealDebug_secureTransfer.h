@@ -0,0 +1,13 @@
+//
+//  ChatSealDebug_secureTransfer.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface ChatSealDebug_secureTransfer : NSObject
++(void) beginSecureTransferTesting;
+@end
@@ -0,0 +1,552 @@
+//
+//  ChatSealDebug_secureTransfer.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_secureTransfer.h"
+#import "ChatSeal.h"
+#import "CS_basicServer.h"
+#import "CS_basicIOConnection.h"
+#import "CS_secureConnection.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static NSString             *PSD_ST_PASSWORD = @"debug-secure-transfer";
+static const NSTimeInterval PSD_ST_TIMEOUT   = 120.0f;
+static const NSUInteger     PSD_ST_BENCH_MB  = 16;
+
+// - a client and server connected over loopback with secure connections.
+@interface PSD_st_pair : NSObject <CS_basicServerDelegate, CS_secureConnectionDelegate>
+-(id) initAsChunked:(BOOL) chunked;
+-(BOOL) connectWithError:(NSError **) err;
+-(void) disconnect;
+-(BOOL) sendData:(NSData *) d toServer:(BOOL) toServer withError:(NSError **) err;
+-(BOOL) sendUnencryptedData:(NSData *) d toServer:(BOOL) toServer withError:(NSError **) err;
+-(NSData *) waitForDataAtServer:(BOOL) atServer;
+-(BOOL) hasFailed;
+@end
+
+// - testing APIs.
+@interface CS_secureConnection (shared)
+-(id) initWithConnectionToClient:(CS_basicIOConnection *) clientConn usingPassword:(NSString *) pwd;
+-(id) initLocalConnectionWithPort:(uint16_t) port usingPassword:(NSString *) pwd;
+-(void) setChunkedTransferEnabled:(BOOL) enabled;
+@end
+
+// - testing APIs.
+@interface CS_secureConnection (internal)
+-(BOOL) sendUnlimitedUnencryptedData:(NSData *) d withError:(NSError **) err;
+@end
+
+// - forward declarations
+@interface ChatSealDebug_secureTransfer (internal)
++(BOOL) runTest_1LargePayloads;
++(BOOL) runTest_2RejectTampering;
++(BOOL) runTest_3ThroughputBenchmark;
++(BOOL) runTest_4SinglePayloadClient;
++(BOOL) runTest_5ServerSpeaksFirst;
+@end
+#endif
+
+/*******************************
+ ChatSealDebug_secureTransfer
+ *******************************/
+@implementation ChatSealDebug_secureTransfer
+/*
+ *  Verify chunked transfer over secure connections and compare it with the single-payload format.
+ *  - this runs on its own thread so that the test owns the run loop that services both connections.
+ */
++(void) beginSecureTransferTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    NSLog(@"SECURE-XFER:  Starting secure transfer testing.");
+    NSOperationQueue *opQ = [[NSOperationQueue alloc] init];
+    NSBlockOperation *bo  = [NSBlockOperation blockOperationWithBlock:^(void) {
+        if ([ChatSealDebug_secureTransfer runTest_1LargePayloads] &&
+            [ChatSealDebug_secureTransfer runTest_2RejectTampering] &&
+            [ChatSealDebug_secureTransfer runTest_3ThroughputBenchmark] &&
+            [ChatSealDebug_secureTransfer runTest_4SinglePayloadClient] &&
+            [ChatSealDebug_secureTransfer runTest_5ServerSpeaksFirst]) {
+            NSLog(@"SECURE-XFER:  All tests completed successfully.");
+        }
+        else {
+            NSLog(@"SECURE-XFER: ERROR: Test failure.");
+        }
+    }];
+    [opQ addOperation:bo];
+    [bo waitUntilFinished];
+    [opQ release];
+#endif
+}
+@end
+
+/*****************************************
+ ChatSealDebug_secureTransfer (internal)
+ *****************************************/
+@implementation ChatSealDebug_secureTransfer (internal)
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*
+ *  Return a payload of the given length that is unique to the seed.
+ */
++(NSData *) payloadOfLength:(NSUInteger) len withSeed:(uint32_t) seed
+{
+    NSMutableData *md = [NSMutableData dataWithLength:len];
+    uint8_t *buf      = (uint8_t *) [md mutableBytes];
+    for (NSUInteger i = 0; i < len; i++) {
+        seed   = (seed * 1103515245) + 12345;
+        buf[i] = (uint8_t) (seed >> 16);
+    }
+    return md;
+}
+
+/*
+ *  Create a connected pair.
+ */
++(PSD_st_pair *) connectedPairAsChunked:(BOOL) chunked
+{
+    NSError *err      = nil;
+    PSD_st_pair *pair = [[[PSD_st_pair alloc] initAsChunked:chunked] autorelease];
+    if (![pair connectWithError:&err]) {
+        NSLog(@"ERROR: Failed to connect the secure pair.  %@", [err localizedDescription]);
+        return nil;
+    }
+    return pair;
+}
+
+/*
+ *  Send a payload in one direction and verify that it arrives intact.
+ */
++(BOOL) transfer:(NSData *) d toServer:(BOOL) toServer withPair:(PSD_st_pair *) pair
+{
+    NSError *err = nil;
+    if (![pair sendData:d toServer:toServer withError:&err]) {
+        NSLog(@"ERROR: Failed to send %lu bytes.  %@", (unsigned long) [d length], [err localizedDescription]);
+        return NO;
+    }
+    
+    NSData *dRecv = [pair waitForDataAtServer:toServer];
+    if (!dRecv || ![dRecv isEqualToData:d]) {
+        NSLog(@"ERROR: The %lu byte payload was not received intact.", (unsigned long) [d length]);
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Verify that payloads far beyond the limit of a single connection payload can be transferred.
+ */
++(BOOL) runTest_1LargePayloads
+{
+    NSLog(@"SECURE-XFER:  TEST-01:  Starting large payload testing.");
+    PSD_st_pair *pair = [self connectedPairAsChunked:YES];
+    if (!pair) {
+        return NO;
+    }
+    
+    // - the sizes are chosen to fall on and around the chunk boundaries.
+    NSUInteger sizes[] = {0, 1, 65535, 65536, 65537, [CS_basicIOConnection maximumPayload] + 1, (3 * 1024 * 1024) + 7, (9 * 1024 * 1024)};
+    for (NSUInteger i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+        @autoreleasepool {
+            NSData *d = [self payloadOfLength:sizes[i] withSeed:(uint32_t) i + 1];
+            if (![self transfer:d toServer:YES withPair:pair] ||
+                ![self transfer:d toServer:NO withPair:pair]) {
+                [pair disconnect];
+                return NO;
+            }
+        }
+    }
+    
+    // - several messages queued at once must arrive separately and in order.
+    NSMutableArray *maSent = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 4; i++) {
+        NSData *d    = [self payloadOfLength:(i + 1) * 300000 withSeed:(uint32_t) (100 + i)];
+        NSError *err = nil;
+        if (![pair sendData:d toServer:YES withError:&err]) {
+            NSLog(@"ERROR: Failed to queue message %lu.  %@", (unsigned long) i, [err localizedDescription]);
+            [pair disconnect];
+            return NO;
+        }
+        [maSent addObject:d];
+    }
+    for (NSData *d in maSent) {
+        NSData *dRecv = [pair waitForDataAtServer:YES];
+        if (![dRecv isEqualToData:d]) {
+            NSLog(@"ERROR: A queued message was not received in order.");
+            [pair disconnect];
+            return NO;
+        }
+    }
+    
+    [pair disconnect];
+    NSLog(@"SECURE-XFER:  TEST-01:  All tests completed successfully.");
+    return YES;
+}
+
+/*
+ *  Verify that content that wasn't sealed by the other side is rejected.
+ */
++(BOOL) runTest_2RejectTampering
+{
+    NSLog(@"SECURE-XFER:  TEST-02:  Starting tamper rejection testing.");
+    PSD_st_pair *pair = [self connectedPairAsChunked:YES];
+    if (!pair) {
+        return NO;
+    }
+    
+    // - the offer must be accepted first or the server will treat this as a single payload.
+    if (![self transfer:[self payloadOfLength:16 withSeed:3] toServer:YES withPair:pair]) {
+        [pair disconnect];
+        return NO;
+    }
+    
+    NSError *err = nil;
+    if (![pair sendUnencryptedData:[self payloadOfLength:2048 withSeed:7] toServer:YES withError:&err]) {
+        NSLog(@"ERROR: Failed to send the unencrypted payload.  %@", [err localizedDescription]);
+        [pair disconnect];
+        return NO;
+    }
+    
+    NSData *dRecv = [pair waitForDataAtServer:YES];
+    BOOL ret      = [pair hasFailed];
+    [pair disconnect];
+    if (dRecv || !ret) {
+        NSLog(@"ERROR: The server accepted an unencrypted chunk.");
+        return NO;
+    }
+    
+    // - a chunk recorded from one session must not open in another with the same password.
+    NSData *dNonceA              = [self payloadOfLength:64 withSeed:21];
+    NSData *dNonceB              = [self payloadOfLength:64 withSeed:22];
+    RSISecureChunkCipher *sccOld = [RealSecureImage chunkCipherForVersion:2 usingPassword:PSD_ST_PASSWORD andSessionNonce:dNonceA withError:&err];
+    RSISecureChunkCipher *sccNew = [RealSecureImage chunkCipherForVersion:2 usingPassword:PSD_ST_PASSWORD andSessionNonce:dNonceB withError:&err];
+    RSISecureChunkCipher *sccDup = [RealSecureImage chunkCipherForVersion:2 usingPassword:PSD_ST_PASSWORD andSessionNonce:dNonceA withError:&err];
+    NSData *dChunk               = [sccOld sealBytes:"replayed" ofLength:8 withFlags:0 andError:&err];
+    if (!sccOld || !sccNew || !sccDup || !dChunk) {
+        NSLog(@"ERROR: Failed to create the replay ciphers.  %@", [err localizedDescription]);
+        return NO;
+    }
+    if ([sccNew openChunk:dChunk appendingTo:[NSMutableData data] returningFlags:NULL withError:&err] ||
+        ![sccDup openChunk:dChunk appendingTo:[NSMutableData data] returningFlags:NULL withError:&err]) {
+        NSLog(@"ERROR: The session nonce did not determine whether the chunk was accepted.");
+        return NO;
+    }
+    
+    NSLog(@"SECURE-XFER:  TEST-02:  All tests completed successfully.");
+    return YES;
+}
+
+/*
+ *  Compare the throughput of the two formats.
+ *  - the single-payload format can't exceed the connection limit, so it is only measured up to there.
+ */
++(BOOL) runTest_3ThroughputBenchmark
+{
+    NSLog(@"SECURE-XFER:  TEST-03:  Starting throughput benchmark.");
+    NSUInteger sizes[] = {16 * 1024, 128 * 1024, 448 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024};
+    for (int mode = 0; mode < 2; mode++) {
+        BOOL isChunked    = (mode == 0) ? YES : NO;
+        PSD_st_pair *pair = [self connectedPairAsChunked:isChunked];
+        if (!pair) {
+            return NO;
+        }
+        
+        for (NSUInteger i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+            if (!isChunked && sizes[i] >= [CS_basicIOConnection maximumPayload]) {
+                continue;
+            }
+            
+            @autoreleasepool {
+                NSData *d             = [self payloadOfLength:sizes[i] withSeed:(uint32_t) i];
+                NSUInteger numIter    = MAX((PSD_ST_BENCH_MB * 1024 * 1024) / sizes[i], 1);
+                NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+                for (NSUInteger j = 0; j < numIter; j++) {
+                    if (![self transfer:d toServer:YES withPair:pair]) {
+                        [pair disconnect];
+                        return NO;
+                    }
+                }
+                NSTimeInterval tiElapsed = [NSDate timeIntervalSinceReferenceDate] - tStart;
+                double mbPerSec          = ((double) (sizes[i] * numIter) / (1024.0 * 1024.0)) / tiElapsed;
+                NSLog(@"SECURE-XFER:  TEST-03:  %-7s %8lu bytes x %4lu --> %8.2f MB/s", isChunked ? "chunked" : "single",
+                      (unsigned long) sizes[i], (unsigned long) numIter, mbPerSec);
+            }
+        }
+        [pair disconnect];
+    }
+    
+    NSLog(@"SECURE-XFER:  TEST-03:  All tests completed successfully.");
+    return YES;
+}
+
+/*
+ *  Verify that a client that doesn't offer chunking, like one from an earlier release, is still
+ *  understood by the server and is only ever sent single payloads.
+ */
++(BOOL) runTest_4SinglePayloadClient
+{
+    NSLog(@"SECURE-XFER:  TEST-04:  Starting single-payload client testing.");
+    PSD_st_pair *pair = [self connectedPairAsChunked:NO];
+    if (!pair) {
+        return NO;
+    }
+    
+    NSData *d = [self payloadOfLength:100000 withSeed:11];
+    if (![self transfer:d toServer:YES withPair:pair] ||
+        ![self transfer:d toServer:NO withPair:pair]) {
+        [pair disconnect];
+        return NO;
+    }
+    
+    // - a server that chunked its replies would be able to send this.
+    NSError *err = nil;
+    if ([pair sendData:[self payloadOfLength:[CS_basicIOConnection maximumPayload] + 1 withSeed:12] toServer:NO withError:&err]) {
+        NSLog(@"ERROR: The server sent an oversized payload to a single-payload client.");
+        [pair disconnect];
+        return NO;
+    }
+    
+    [pair disconnect];
+    NSLog(@"SECURE-XFER:  TEST-04:  All tests completed successfully.");
+    return YES;
+}
+
+/*
+ *  Verify that a server that sends before it has seen the client's offer still agrees to chunking.
+ */
++(BOOL) runTest_5ServerSpeaksFirst
+{
+    NSLog(@"SECURE-XFER:  TEST-05:  Starting server-first testing.");
+    PSD_st_pair *pair = [self connectedPairAsChunked:YES];
+    if (!pair) {
+        return NO;
+    }
+    
+    // - both are sent before either side runs, so the server's message crosses the offer.
+    NSError *err   = nil;
+    NSData *dLarge = [self payloadOfLength:[CS_basicIOConnection maximumPayload] + 1 withSeed:13];
+    NSData *dSmall = [self payloadOfLength:1000 withSeed:14];
+    if (![pair sendData:dLarge toServer:YES withError:&err] || ![pair sendData:dSmall toServer:NO withError:&err]) {
+        NSLog(@"ERROR: Failed to send the crossing payloads.  %@", [err localizedDescription]);
+        [pair disconnect];
+        return NO;
+    }
+    
+    if (![[pair waitForDataAtServer:NO] isEqualToData:dSmall] || ![[pair waitForDataAtServer:YES] isEqualToData:dLarge]) {
+        NSLog(@"ERROR: The crossing payloads were not received intact.");
+        [pair disconnect];
+        return NO;
+    }
+    
+    // - the server only chunks once it has accepted the offer.
+    if (![self transfer:dLarge toServer:NO withPair:pair]) {
+        [pair disconnect];
+        return NO;
+    }
+    
+    [pair disconnect];
+    NSLog(@"SECURE-XFER:  TEST-05:  All tests completed successfully.");
+    return YES;
+}
+#endif
+@end
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/**************************
+ PSD_st_pair
+ **************************/
+@implementation PSD_st_pair
+/*
+ *  Object attributes.
+ */
+{
+    BOOL                isChunked;
+    CS_basicServer      *server;
+    CS_secureConnection *scServer;
+    CS_secureConnection *scClient;
+    NSMutableArray      *maAtServer;
+    NSMutableArray      *maAtClient;
+    BOOL                hasFailed;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initAsChunked:(BOOL) chunked
+{
+    self = [super init];
+    if (self) {
+        isChunked  = chunked;
+        server     = nil;
+        scServer   = nil;
+        scClient   = nil;
+        maAtServer = [[NSMutableArray alloc] init];
+        maAtClient = [[NSMutableArray alloc] init];
+        hasFailed  = NO;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self disconnect];
+    
+    [maAtServer release];
+    maAtServer = nil;
+    
+    [maAtClient release];
+    maAtClient = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Pump the run loop until the condition is satisfied or we run out of time.
+ */
+-(BOOL) runUntil:(BOOL (^)(void)) condition
+{
+    NSDate *dtLimit = [NSDate dateWithTimeIntervalSinceNow:PSD_ST_TIMEOUT];
+    while (!condition()) {
+        if ([dtLimit timeIntervalSinceNow] < 0.0f) {
+            return NO;
+        }
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01f]];
+    }
+    return YES;
+}
+
+/*
+ *  Start a server and connect to it.
+ */
+-(BOOL) connectWithError:(NSError **) err
+{
+    server          = [[CS_basicServer alloc] initWithPort:0];
+    server.delegate = self;
+    if (![server startServerWithError:err]) {
+        return NO;
+    }
+    
+    scClient          = [[CS_secureConnection alloc] initLocalConnectionWithPort:[server serverPort] usingPassword:PSD_ST_PASSWORD];
+    scClient.delegate = self;
+    [scClient setChunkedTransferEnabled:isChunked];
+    if (![scClient connectWithError:err]) {
+        return NO;
+    }
+    
+    if (![self runUntil:^BOOL(void) {return (scServer && [scServer isConnected] && [scClient isConnected]) || hasFailed;}] || hasFailed) {
+        [CS_error fillError:err withCode:CSErrorConnectionFailure andFailureReason:@"The pair failed to connect."];
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Disconnect both sides and stop the server.
+ */
+-(void) disconnect
+{
+    scClient.delegate = nil;
+    [scClient disconnect];
+    [scClient release];
+    scClient = nil;
+    
+    scServer.delegate = nil;
+    [scServer disconnect];
+    [scServer release];
+    scServer = nil;
+    
+    server.delegate = nil;
+    [server stopServer];
+    [server release];
+    server = nil;
+}
+
+/*
+ *  Send data in one direction.
+ */
+-(BOOL) sendData:(NSData *) d toServer:(BOOL) toServer withError:(NSError **) err
+{
+    return [(toServer ? scClient : scServer) sendData:d withError:err];
+}
+
+/*
+ *  Send data in one direction without encrypting it.
+ */
+-(BOOL) sendUnencryptedData:(NSData *) d toServer:(BOOL) toServer withError:(NSError **) err
+{
+    return [(toServer ? scClient : scServer) sendUnlimitedUnencryptedData:d withError:err];
+}
+
+/*
+ *  Wait for the next message to arrive on one side.
+ */
+-(NSData *) waitForDataAtServer:(BOOL) atServer
+{
+    NSMutableArray *ma = atServer ? maAtServer : maAtClient;
+    if (![self runUntil:^BOOL(void) {return [ma count] || hasFailed;}] || ![ma count]) {
+        return nil;
+    }
+    NSData *dRet = [[[ma objectAtIndex:0] retain] autorelease];
+    [ma removeObjectAtIndex:0];
+    return dRet;
+}
+
+/*
+ *  Return whether either side reported a failure.
+ */
+-(BOOL) hasFailed
+{
+    return hasFailed;
+}
+
+/*
+ *  The client has connected to the server.
+ */
+-(void) connectionReceived:(CS_basicIOConnection *) conn inServer:(CS_basicServer *) s
+{
+    if (scServer) {
+        NSLog(@"ERROR: An existing server connection already exists.");
+        hasFailed = YES;
+        return;
+    }
+    
+    scServer          = [[CS_secureConnection alloc] initWithConnectionToClient:conn usingPassword:PSD_ST_PASSWORD];
+    scServer.delegate = self;
+    
+    NSError *err = nil;
+    if (![scServer connectWithError:&err]) {
+        NSLog(@"ERROR: Failed to open the server connection.  %@", [err localizedDescription]);
+        hasFailed = YES;
+    }
+}
+
+/*
+ *  Save the data that arrived on a connection.
+ */
+-(void) secureConnectionHasData:(CS_secureConnection *) ioConn
+{
+    NSMutableArray *ma = (ioConn == scServer) ? maAtServer : maAtClient;
+    while ([ioConn hasDataForRead]) {
+        NSError *err = nil;
+        NSData *d    = [ioConn checkForDataWithError:&err];
+        if (!d) {
+            hasFailed = YES;
+            break;
+        }
+        [ma addObject:d];
+    }
+}
+
+/*
+ *  A connection failed.
+ */
+-(void) secureConnectionFailed:(CS_secureConnection *) ioConn
+{
+    hasFailed = YES;
+}
+@end
+#endif
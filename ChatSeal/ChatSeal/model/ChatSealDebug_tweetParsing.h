@@ -0,0 +1,13 @@
+//
+//  ChatSealDebug_tweetParsing.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/21/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface ChatSealDebug_tweetParsing : NSObject
++(void) beginTweetParsingTesting;
+@end
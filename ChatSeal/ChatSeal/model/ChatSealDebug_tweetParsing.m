@@ -0,0 +1,363 @@
+//
+//  ChatSealDebug_tweetParsing.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/21/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "ChatSealDebug_tweetParsing.h"
+#import "ChatSeal.h"
+#import "ChatSealDebug_twitter_simulator.h"
+#import "CS_twitterFeed_tweetText.h"
+#import "CS_tapi_parse_tweet_response.h"
+#import "CS_tapi_parse_tweet_stream.h"
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+static const NSUInteger PSD_TP_PAGE_SIZE  = 200;
+static const NSUInteger PSD_TP_NUM_PAGES  = 25;
+static const NSUInteger PSD_TP_ITERATIONS = 4;
+#endif
+
+/****************************
+ ChatSealDebug_tweetParsing
+ ****************************/
+@implementation ChatSealDebug_tweetParsing
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+
+/*
+ *  Build a status that resembles what the service returns, including the many fields we never use.
+ */
++(NSMutableDictionary *) tweetWithId:(uint64_t) tweetId andText:(NSString *) text fromUser:(NSString *) userId withMediaURL:(NSString *) mediaURL
+{
+    NSMutableDictionary *mdUser = [NSMutableDictionary dictionary];
+    [mdUser setObject:userId forKey:@"id_str"];
+    [mdUser setObject:[NSNumber numberWithLongLong:[userId longLongValue]] forKey:@"id"];
+    [mdUser setObject:[NSString stringWithFormat:@"user_%@", userId] forKey:@"screen_name"];
+    [mdUser setObject:@"A \"quoted\" name with a slash/and \u00e9" forKey:@"name"];
+    [mdUser setObject:@"Saint Paul, MN" forKey:@"location"];
+    [mdUser setObject:@"A description that is long enough to be representative of what people write about themselves." forKey:@"description"];
+    [mdUser setObject:[NSNumber numberWithInt:1234] forKey:@"followers_count"];
+    [mdUser setObject:[NSNumber numberWithInt:321] forKey:@"friends_count"];
+    [mdUser setObject:[NSNumber numberWithBool:NO] forKey:@"protected"];
+    [mdUser setObject:[NSNull null] forKey:@"url"];
+    [mdUser setObject:@"https://pbs.twimg.com/profile_images/1234/abcd_normal.png" forKey:@"profile_image_url_https"];
+    
+    NSMutableDictionary *mdEntities = [NSMutableDictionary dictionary];
+    NSDictionary *dHash = [NSDictionary dictionaryWithObjectsAndKeys:@"BePersonal", @"text", [NSArray arrayWithObjects:[NSNumber numberWithInt:0], [NSNumber numberWithInt:11], nil], @"indices", nil];
+    [mdEntities setObject:[NSArray arrayWithObject:dHash] forKey:@"hashtags"];
+    [mdEntities setObject:[NSArray array] forKey:@"urls"];
+    [mdEntities setObject:[NSArray array] forKey:@"user_mentions"];
+    if (mediaURL) {
+        NSDictionary *dMedia = [NSDictionary dictionaryWithObjectsAndKeys:@"photo", @"type",
+                                                                          mediaURL, @"media_url",
+                                                                          mediaURL, @"media_url_https",
+                                                                          [NSString stringWithFormat:@"%llu", tweetId], @"id_str",
+                                                                          [NSDictionary dictionaryWithObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithInt:1024], @"w",
+                                                                                                                                                          [NSNumber numberWithInt:768], @"h", nil]
+                                                                                                      forKey:@"large"], @"sizes", nil];
+        [mdEntities setObject:[NSArray arrayWithObject:dMedia] forKey:@"media"];
+    }
+    
+    NSMutableDictionary *mdTweet = [NSMutableDictionary dictionary];
+    [mdTweet setObject:[NSString stringWithFormat:@"%llu", tweetId] forKey:@"id_str"];
+    [mdTweet setObject:[NSNumber numberWithUnsignedLongLong:tweetId] forKey:@"id"];
+    [mdTweet setObject:text forKey:@"text"];
+    [mdTweet setObject:@"Wed Aug 20 13:08:45 +0000 2014" forKey:@"created_at"];
+    [mdTweet setObject:@"<a href=\"http://twitter.com\" rel=\"nofollow\">Twitter Web Client</a>" forKey:@"source"];
+    [mdTweet setObject:@"en" forKey:@"lang"];
+    [mdTweet setObject:[NSNumber numberWithInt:3] forKey:@"retweet_count"];
+    [mdTweet setObject:[NSNumber numberWithDouble:1.5e2] forKey:@"favorite_count"];
+    [mdTweet setObject:[NSNumber numberWithBool:NO] forKey:@"truncated"];
+    [mdTweet setObject:[NSNull null] forKey:@"in_reply_to_status_id_str"];
+    [mdTweet setObject:mdUser forKey:@"user"];
+    [mdTweet setObject:mdEntities forKey:@"entities"];
+    return mdTweet;
+}
+
+/*
+ *  Generate a page of synthetic statuses.
+ *  - some have seal-compatible text, some are retweets and some have media that will be rejected.
+ */
++(NSData *) syntheticPage:(NSUInteger) page withSeal:(NSString *) sealId
+{
+    NSMutableArray *maPage = [NSMutableArray arrayWithCapacity:PSD_TP_PAGE_SIZE];
+    for (NSUInteger i = 0; i < PSD_TP_PAGE_SIZE; i++) {
+        uint64_t tweetId   = 500000000000000000ULL - (uint64_t) ((page * PSD_TP_PAGE_SIZE) + i);
+        NSString *userId   = [NSString stringWithFormat:@"%u", (unsigned) (2000000000 + (i % 17))];
+        NSString *text     = [NSString stringWithFormat:@"Status %u with \"quotes\", a tab\tand an emoji \U0001F600.", (unsigned) i];
+        NSString *mediaURL = nil;
+        switch (i % 8) {
+            case 0:
+            case 1:
+                mediaURL = [NSString stringWithFormat:@"http://pbs.twimg.com/media/%llu.png", tweetId];
+                if (sealId) {
+                    text = [CS_twitterFeed_tweetText tweetTextForSealId:sealId andNumericUserId:userId];
+                }
+                break;
+            
+            case 2:
+                mediaURL = [NSString stringWithFormat:@"http://pbs.twimg.com/media/%llu.jpg", tweetId];
+                break;
+            
+            default:
+                break;
+        }
+        
+        NSMutableDictionary *mdTweet = [self tweetWithId:tweetId andText:text fromUser:userId withMediaURL:mediaURL];
+        if (i % 11 == 5) {
+            // - the nested status has all the right fields, but must never be considered.
+            NSMutableDictionary *mdInner = [self tweetWithId:tweetId - 1 andText:text fromUser:userId withMediaURL:@"http://pbs.twimg.com/media/inner.png"];
+            [mdTweet setObject:mdInner forKey:@"retweeted_status"];
+            [(NSMutableDictionary *) [mdTweet objectForKey:@"entities"] removeObjectForKey:@"media"];
+        }
+        [maPage addObject:mdTweet];
+    }
+    return [NSJSONSerialization dataWithJSONObject:maPage options:0 error:nil];
+}
+
+/*
+ *  Load the pages for the benchmark, preferring the recorded corpus used by the service simulator.
+ */
++(NSArray *) benchmarkPagesWithSeal:(NSString *) sealId
+{
+    NSURL *u = [[NSFileManager defaultManager] URLForDirectory:NSDocumentDirectory inDomain:NSUserDomainMask appropriateForURL:nil create:NO error:nil];
+    u        = [[u URLByAppendingPathComponent:PSD_TWSIM_RECORDING_DIR] URLByAppendingPathComponent:@"tweets.json"];
+    NSData *d = [NSData dataWithContentsOfURL:u];
+    NSObject *obj = d ? [NSJSONSerialization JSONObjectWithData:d options:0 error:nil] : nil;
+    
+    NSMutableArray *maRet = [NSMutableArray array];
+    if ([obj isKindOfClass:[NSArray class]] && [(NSArray *) obj count]) {
+        NSArray *arr = (NSArray *) obj;
+        for (NSUInteger i = 0; i < [arr count]; i += PSD_TP_PAGE_SIZE) {
+            NSArray *arrPage = [arr subarrayWithRange:NSMakeRange(i, MIN(PSD_TP_PAGE_SIZE, [arr count] - i))];
+            d                = [NSJSONSerialization dataWithJSONObject:arrPage options:0 error:nil];
+            if (d) {
+                [maRet addObject:d];
+            }
+        }
+        NSLog(@"TWEET-PARSE:  - using %u pages from the recorded corpus.", (unsigned) [maRet count]);
+    }
+    else {
+        for (NSUInteger i = 0; i < PSD_TP_NUM_PAGES; i++) {
+            [maRet addObject:[self syntheticPage:i withSeal:sealId]];
+        }
+        NSLog(@"TWEET-PARSE:  - using %u synthetic pages.", (unsigned) [maRet count]);
+    }
+    return maRet;
+}
+
+/*
+ *  Describe the outcome of a single parse so that the two approaches can be compared.
+ */
++(NSString *) resultFromParse:(CS_tapi_parse_tweet_response *) ptr withReturn:(BOOL) ret
+{
+    return [NSString stringWithFormat:@"%d|%@|%@|%@|%@", ret, ptr.tweetId, ptr.tweetText, ptr.screenName, [ptr.imageURL absoluteString]];
+}
+
+/*
+ *  Count the objects in a Foundation graph.
+ */
++(NSUInteger) numberOfObjectsInGraph:(NSObject *) obj
+{
+    NSUInteger ret = 1;
+    if ([obj isKindOfClass:[NSArray class]]) {
+        for (NSObject *item in (NSArray *) obj) {
+            ret += [self numberOfObjectsInGraph:item];
+        }
+    }
+    else if ([obj isKindOfClass:[NSDictionary class]]) {
+        for (NSObject *key in (NSDictionary *) obj) {
+            ret += 1 + [self numberOfObjectsInGraph:[(NSDictionary *) obj objectForKey:key]];
+        }
+    }
+    return ret;
+}
+
+/*
+ *  Parse a page with the Foundation objects, returning nil if it isn't a timeline.
+ */
++(NSArray *) resultsFromObjectsInData:(NSData *) d withObjectCount:(NSUInteger *) numObjects
+{
+    NSObject *obj = d ? [NSJSONSerialization JSONObjectWithData:d options:NSJSONReadingAllowFragments error:nil] : nil;
+    if (![obj isKindOfClass:[NSArray class]]) {
+        return nil;
+    }
+    
+    NSMutableArray *maRet            = [NSMutableArray array];
+    CS_tapi_parse_tweet_response *ptr = [[[CS_tapi_parse_tweet_response alloc] init] autorelease];
+    NSUInteger count                 = [self numberOfObjectsInGraph:obj] + 1;
+    for (obj in (NSArray *) obj) {
+        if (![obj isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        BOOL ret = [ptr fillImageTweetFromObject:obj];
+        if (ptr.imageURL) {
+            count++;
+        }
+        [maRet addObject:[self resultFromParse:ptr withReturn:ret]];
+    }
+    
+    if (numObjects) {
+        *numObjects = count;
+    }
+    return maRet;
+}
+
+/*
+ *  Parse a page with the stream parser, returning nil if it isn't a timeline.
+ */
++(NSArray *) resultsFromStreamInData:(NSData *) d withObjectCount:(NSUInteger *) numObjects
+{
+    CS_tapi_parse_tweet_stream *pts = [[[CS_tapi_parse_tweet_stream alloc] initWithData:d] autorelease];
+    if (![pts parse]) {
+        return nil;
+    }
+    
+    NSMutableArray *maRet             = [NSMutableArray array];
+    CS_tapi_parse_tweet_response *ptr = [[[CS_tapi_parse_tweet_response alloc] init] autorelease];
+    NSUInteger count                  = 2;
+    for (NSUInteger i = 0; i < [pts count]; i++) {
+        BOOL ret                     = [ptr fillImageTweetFromStream:pts atIndex:i];
+        const cs_tpts_tweet_t *tweet = [pts tweetAtIndex:i];
+        
+        // - the id and text are always created, the URL string, user id and screen name only for photos.
+        count += (ptr.tweetId ? 1 : 0) + (ptr.tweetText ? 1 : 0) + (ptr.imageURL ? 1 : 0);
+        if (ptr.tweetId && tweet->isLastMediaObject && tweet->mediaURL.isPresent && [pts span:tweet->mediaType isEqualToCString:"photo"]) {
+            count += 1 + (tweet->hasUser ? 2 : 0);
+        }
+        [maRet addObject:[self resultFromParse:ptr withReturn:ret]];
+    }
+    
+    if (numObjects) {
+        *numObjects = count;
+    }
+    return maRet;
+}
+
+/*
+ *  Verify the stream parser produces exactly what we got from the Foundation objects.
+ */
++(BOOL) runTest_1EquivalenceWithSeal:(NSString *) sealId
+{
+    NSLog(@"TWEET-PARSE:  TEST-01:  Starting parser equivalence testing.");
+    
+    NSMutableArray *maPages = [NSMutableArray array];
+    [maPages addObject:[self syntheticPage:0 withSeal:sealId]];
+    
+    // - these are hand-written so that we can cover the less common encodings and shapes.
+    NSArray *arrRaw = [NSArray arrayWithObjects:@"[]",
+                       @" [ 12, \"x\", null, {\"id_str\":\"1\",\"text\":\"a\",\"entities\":{}} ] ",
+                       @"[{\"id_str\":\"2\",\"text\":\"\\u0041\\ud83d\\ude00\\/\\\\\",\"entities\":{\"media\":[{\"type\":\"photo\",\"media_url\":\"http:\\/\\/pbs.twimg.com\\/media\\/x.png\"}]},\"user\":{\"id_str\":\"99\",\"screen_name\":\"s\\u00e9\"}}]",
+                       @"[{\"id_str\":\"3\",\"text\":\"t\",\"entities\":{\"media\":[{\"type\":\"photo\",\"media_url\":\"http://a/x.png\"},7]},\"user\":{\"id_str\":\"99\"}}]",
+                       @"[{\"id_str\":\"4\",\"text\":\"t\",\"entities\":{\"media\":[]},\"user\":null}]",
+                       @"[{\"id_str\":5,\"text\":\"t\",\"entities\":{}}, {\"id_str\":\"6\",\"text\":null,\"entities\":{}}, {\"id_str\":\"7\",\"text\":\"t\",\"entities\":[]}]",
+                       @"[{\"user\":{\"screen_name\":\"n\",\"id_str\":\"1\"},\"entities\":{\"media\":[{\"media_url\":\"http://a/x.png\",\"type\":\"photo\"}]},\"text\":\"t\",\"id_str\":\"8\"}]",
+                       @"[{\"id_str\":\"10\",\"text\":\"t\",\"entities\":{\"hashtags\":[{\"indices\":[0,-1.5e+3]}]},\"deep\":[[[[{}]]]],\"flag\":true,\"other\":false}]",
+                       nil];
+    for (NSString *s in arrRaw) {
+        [maPages addObject:[s dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    
+    for (NSData *d in maPages) {
+        NSArray *arrObjects = [self resultsFromObjectsInData:d withObjectCount:NULL];
+        NSArray *arrStream  = [self resultsFromStreamInData:d withObjectCount:NULL];
+        if (!arrObjects || !arrStream || ![arrObjects isEqualToArray:arrStream]) {
+            NSLog(@"ERROR: the stream parser results differ for %@.", [d length] < 512 ? [[[NSString alloc] initWithData:d encoding:NSUTF8StringEncoding] autorelease] : @"the synthetic page");
+            NSLog(@"ERROR: objects --> %@", arrObjects);
+            NSLog(@"ERROR: stream  --> %@", arrStream);
+            return NO;
+        }
+    }
+    
+    NSLog(@"TWEET-PARSE:  TEST-01:  - verifying that malformed content is rejected.");
+    NSArray *arrBad = [NSArray arrayWithObjects:@"", @"{}", @"[", @"[1,]", @"[{\"a\":1,}]", @"[\"\\x\"]", @"[01]", @"[1.]", @"[tru]", @"[] []", @"[\"\\ud83d\"]", nil];
+    for (NSString *s in arrBad) {
+        if ([self resultsFromStreamInData:[s dataUsingEncoding:NSUTF8StringEncoding] withObjectCount:NULL]) {
+            NSLog(@"ERROR: the stream parser accepted '%@'.", s);
+            return NO;
+        }
+    }
+    
+    NSLog(@"TWEET-PARSE:  TEST-01:  Parser equivalence testing completed successfully.");
+    return YES;
+}
+
+/*
+ *  Compare the cost of the two parsing approaches over a corpus of pages.
+ */
++(BOOL) runTest_2PageBenchmarkWithSeal:(NSString *) sealId
+{
+    NSLog(@"TWEET-PARSE:  TEST-02:  Starting the page parsing benchmark.");
+    NSArray *arrPages = [self benchmarkPagesWithSeal:sealId];
+    
+    NSUInteger numObjectsFoundation = 0;
+    NSUInteger numObjectsStream     = 0;
+    NSTimeInterval tiFoundation     = 0.0;
+    NSTimeInterval tiStream         = 0.0;
+    for (NSUInteger iter = 0; iter < PSD_TP_ITERATIONS; iter++) {
+        for (NSData *d in arrPages) {
+            NSArray *arrObjects = nil;
+            NSArray *arrStream  = nil;
+            NSUInteger numObj   = 0;
+            
+            @autoreleasepool {
+                NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+                arrObjects            = [[self resultsFromObjectsInData:d withObjectCount:&numObj] retain];
+                tiFoundation         += [NSDate timeIntervalSinceReferenceDate] - tStart;
+            }
+            numObjectsFoundation += numObj;
+            
+            @autoreleasepool {
+                NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+                arrStream             = [[self resultsFromStreamInData:d withObjectCount:&numObj] retain];
+                tiStream             += [NSDate timeIntervalSinceReferenceDate] - tStart;
+            }
+            numObjectsStream += numObj;
+            
+            BOOL isSame = (arrObjects && arrStream && [arrObjects isEqualToArray:arrStream]);
+            [arrObjects release];
+            [arrStream release];
+            if (!isSame) {
+                NSLog(@"ERROR: the two parsers disagree about a page in the corpus.");
+                return NO;
+            }
+        }
+    }
+    
+    // - the benchmark reports rather than fails on timing because devices vary so much.
+    double numPages = (double) ([arrPages count] * PSD_TP_ITERATIONS);
+    NSLog(@"TWEET-PARSE:  TEST-02:  - Foundation objects: %4.3f ms and ~%u objects per page.", (tiFoundation * 1000.0) / numPages, (unsigned) ((double) numObjectsFoundation / numPages));
+    NSLog(@"TWEET-PARSE:  TEST-02:  - stream parser:      %4.3f ms and ~%u objects per page.", (tiStream * 1000.0) / numPages, (unsigned) ((double) numObjectsStream / numPages));
+    if (tiStream > 0.0) {
+        NSLog(@"TWEET-PARSE:  TEST-02:  - the stream parser is %3.1fx faster.", tiFoundation / tiStream);
+    }
+    
+    NSLog(@"TWEET-PARSE:  TEST-02:  The page parsing benchmark completed successfully.");
+    return YES;
+}
+
+#endif
+
+/*
+ *  Verify the stream parser for timelines and measure its benefit.
+ */
++(void) beginTweetParsingTesting
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    // - without a seal, the photo tweets are never accepted, which still verifies the parser, but not as thoroughly.
+    NSString *sealId = [[RealSecureImage availableSealsWithError:nil] firstObject];
+    if (!sealId) {
+        NSLog(@"TWEET-PARSE:  WARNING: There are no seals in the vault, so no tweets will be accepted.");
+    }
+    
+    if ([ChatSealDebug_tweetParsing runTest_1EquivalenceWithSeal:sealId] &&
+        [ChatSealDebug_tweetParsing runTest_2PageBenchmarkWithSeal:sealId]) {
+        NSLog(@"TWEET-PARSE:  All parsing tests completed successfully.");
+    }
+    else {
+        NSLog(@"TWEET-PARSE: ERROR: Test failure.");
+    }
+#endif
+}
+@end
@@ -11,8 +11,16 @@
 #import "CS_twmMiningStatsHistory.h"
 #import "CS_tapi_tweetRange.h"
 #import "CS_tapi_statuses_timeline_base.h"
+#import "CS_twmTweetIntervalSet.h"
 
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
+// - constants
+static const NSUInteger PSD_MH_BENCH_RANGES      = 100000;
+static const NSUInteger PSD_MH_BENCH_SPACING     = 100;
+static const NSUInteger PSD_MH_BENCH_BACKFILL    = 500;
+static const NSUInteger PSD_MH_BENCH_SET_QUERIES = 100000;
+static const NSUInteger PSD_MH_BENCH_OBJ_QUERIES = 200;
+
 @interface CS_tapi_auto_good_timeline_call : CS_tapi_statuses_timeline_base
 @end
 #endif
@@ -23,6 +31,308 @@
 @implementation ChatSealDebug_twitter_mining_history
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
 
+/*
+ *  Merge a range into a list of range objects, most recent first, the way the mining history
+ *  did before it tracked numeric intervals.
+ */
++(void) mergeObjectRange:(CS_tapi_tweetRange *) range intoList:(NSMutableArray *) maList
+{
+    NSUInteger insertIndex     = 0;
+    CS_tapi_tweetRange *trLast = nil;
+    for (insertIndex = 0; insertIndex < [maList count]; insertIndex++) {
+        CS_tapi_tweetRange *trCur = [maList objectAtIndex:insertIndex];
+        if ([range isAfter:trCur]) {
+            break;
+        }
+        trLast = trCur;
+    }
+    
+    if (trLast && ([trLast isIntersectedBy:range] || [trLast isAdjacentToAndPreceding:range])) {
+        insertIndex--;
+        [trLast unionWith:range];
+        range = trLast;
+    }
+    else {
+        [maList insertObject:range atIndex:insertIndex];
+    }
+    
+    NSMutableIndexSet *mis = nil;
+    for (NSUInteger i = insertIndex + 1; i < [maList count]; i++) {
+        CS_tapi_tweetRange *trCur = [maList objectAtIndex:i];
+        if (![range isIntersectedBy:trCur] && ![range isAdjacentToAndPreceding:trCur]) {
+            break;
+        }
+        if (!mis) {
+            mis = [NSMutableIndexSet indexSet];
+        }
+        [range unionWith:trCur];
+        [mis addIndex:i];
+    }
+    
+    if (mis) {
+        [maList removeObjectsAtIndexes:mis];
+    }
+}
+
+/*
+ *  Find the most recent gap at or below the value in a list of range objects, most recent first.
+ */
++(BOOL) findObjectGapAtOrBelow:(NSString *) value inList:(NSArray *) arrList returningLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh
+{
+    uint64_t gapHigh = [CS_tapi_tweetRange tweetValueFromId:value];
+    uint64_t gapLow  = [CS_tapi_tweetRange absoluteMinimumValue];
+    for (CS_tapi_tweetRange *tr in arrList) {
+        if ([CS_tapi_tweetRange rangeValueCompare:tr.minTweetId withValue:value] == NSOrderedDescending) {
+            continue;
+        }
+        
+        // - a range that covers the value ends the gap just before it.
+        if ([CS_tapi_tweetRange rangeValueCompare:tr.maxTweetId withValue:value] != NSOrderedAscending) {
+            uint64_t minValue = [CS_tapi_tweetRange tweetValueFromId:tr.minTweetId];
+            if (minValue <= gapLow) {
+                return NO;
+            }
+            gapHigh = minValue - 1;
+            value   = [NSString stringWithFormat:@"%llu", gapHigh];
+            continue;
+        }
+        
+        gapLow = [CS_tapi_tweetRange tweetValueFromId:tr.maxTweetId] + 1;
+        break;
+    }
+    *pLow  = gapLow;
+    *pHigh = gapHigh;
+    return YES;
+}
+
+/*
+ *  Compare the interval set against the object-based ranges it replaced.
+ */
++(BOOL) runTest_4IntervalBenchmark
+{
+    NSLog(@"MINING-HIST:  TEST-04:  Starting interval benchmark with %lu ranges.", (unsigned long) PSD_MH_BENCH_RANGES);
+    
+    // - the ranges are disjoint and mostly arrive in order because that is how timelines are mined, but every so
+    //   often an old one is backfilled.
+    uint64_t *lows  = (uint64_t *) malloc(sizeof(uint64_t) * PSD_MH_BENCH_RANGES);
+    uint64_t *highs = (uint64_t *) malloc(sizeof(uint64_t) * PSD_MH_BENCH_RANGES);
+    for (NSUInteger i = 0; i < PSD_MH_BENCH_RANGES; i++) {
+        lows[i]  = 1000 + (i * PSD_MH_BENCH_SPACING) + arc4random_uniform(20);
+        highs[i] = lows[i] + arc4random_uniform(50);
+    }
+    for (NSUInteger i = 0; i < PSD_MH_BENCH_RANGES; i += PSD_MH_BENCH_BACKFILL) {
+        NSUInteger other = i + arc4random_uniform((u_int32_t) (PSD_MH_BENCH_RANGES - i));
+        uint64_t tmp     = lows[i];
+        lows[i]          = lows[other];
+        lows[other]      = tmp;
+        tmp              = highs[i];
+        highs[i]         = highs[other];
+        highs[other]     = tmp;
+    }
+    uint64_t maxValue = 1000 + (PSD_MH_BENCH_RANGES * PSD_MH_BENCH_SPACING);
+    
+    BOOL ret = YES;
+    @autoreleasepool {
+        // - merge into both representations.
+        CS_twmTweetIntervalSet *tis = [CS_twmTweetIntervalSet intervalSet];
+        NSTimeInterval tStart       = [NSDate timeIntervalSinceReferenceDate];
+        for (NSUInteger i = 0; i < PSD_MH_BENCH_RANGES; i++) {
+            [tis addIntervalWithLow:lows[i] andHigh:highs[i]];
+        }
+        NSTimeInterval tiSetMerge = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        
+        NSMutableArray *maList = [NSMutableArray array];
+        tStart                 = [NSDate timeIntervalSinceReferenceDate];
+        for (NSUInteger i = 0; i < PSD_MH_BENCH_RANGES; i++) {
+            @autoreleasepool {
+                [ChatSealDebug_twitter_mining_history mergeObjectRange:[CS_tapi_tweetRange rangeForMinValue:lows[i] andMaxValue:highs[i]] intoList:maList];
+            }
+        }
+        NSTimeInterval tiObjMerge = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        
+        if ([tis count] != PSD_MH_BENCH_RANGES || [maList count] != PSD_MH_BENCH_RANGES) {
+            NSLog(@"ERROR: the merged ranges are the wrong length (%lu, %lu).", (unsigned long) [tis count], (unsigned long) [maList count]);
+            ret = NO;
+        }
+        
+        for (NSUInteger i = 0; ret && i < PSD_MH_BENCH_RANGES; i += PSD_MH_BENCH_SPACING) {
+            uint64_t low                = 0;
+            uint64_t high               = 0;
+            CS_tapi_tweetRange *tr      = [maList objectAtIndex:PSD_MH_BENCH_RANGES - i - 1];
+            CS_tapi_tweetRange *trCheck = nil;
+            [tis getIntervalAtIndex:i withLow:&low andHigh:&high];
+            trCheck = [CS_tapi_tweetRange rangeForMinValue:low andMaxValue:high];
+            if (![tr isEqualToRange:trCheck]) {
+                NSLog(@"ERROR: the representations disagree at %lu (%@ vs %@).", (unsigned long) i, tr, trCheck);
+                ret = NO;
+            }
+        }
+        
+        // - the object lists are searched linearly, so they get far fewer queries and we compare the per-query cost.
+        NSUInteger numFound = 0;
+        tStart              = [NSDate timeIntervalSinceReferenceDate];
+        for (NSUInteger i = 0; i < PSD_MH_BENCH_SET_QUERIES; i++) {
+            uint64_t value = arc4random_uniform((u_int32_t) maxValue);
+            uint64_t low   = 0;
+            uint64_t high  = 0;
+            if ([tis findGapAtOrBelowValue:value withFloor:[CS_tapi_tweetRange absoluteMinimumValue] returningLow:&low andHigh:&high]) {
+                numFound++;
+            }
+        }
+        NSTimeInterval tiSetQuery = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        
+        NSTimeInterval tiObjQuery = 0.0f;
+        for (NSUInteger i = 0; ret && i < PSD_MH_BENCH_OBJ_QUERIES; i++) {
+            @autoreleasepool {
+                uint64_t value   = 1 + arc4random_uniform((u_int32_t) maxValue);
+                uint64_t low     = 0;
+                uint64_t high    = 0;
+                uint64_t lowChk  = 0;
+                uint64_t highChk = 0;
+                NSString *sValue = [NSString stringWithFormat:@"%llu", value];
+                tStart           = [NSDate timeIntervalSinceReferenceDate];
+                BOOL objFound    = [ChatSealDebug_twitter_mining_history findObjectGapAtOrBelow:sValue inList:maList returningLow:&low andHigh:&high];
+                tiObjQuery      += [NSDate timeIntervalSinceReferenceDate] - tStart;
+                BOOL setFound    = [tis findGapAtOrBelowValue:value withFloor:[CS_tapi_tweetRange absoluteMinimumValue] returningLow:&lowChk andHigh:&highChk];
+                if (objFound != setFound || (objFound && (low != lowChk || high != highChk))) {
+                    NSLog(@"ERROR: the gap queries disagree for %llu.", value);
+                    ret = NO;
+                }
+            }
+        }
+        
+        NSData *dArchive = [tis archiveData];
+        NSData *dObjects = [NSKeyedArchiver archivedDataWithRootObject:maList];
+        
+        NSLog(@"MINING-HIST:  TEST-04:  - merge: intervals %.3fs, objects %.3fs", tiSetMerge, tiObjMerge);
+        NSLog(@"MINING-HIST:  TEST-04:  - gap query: intervals %.3fus (%lu found), objects %.3fus", (tiSetQuery * 1000000.0f) / PSD_MH_BENCH_SET_QUERIES,
+              (unsigned long) numFound, (tiObjQuery * 1000000.0f) / PSD_MH_BENCH_OBJ_QUERIES);
+        NSLog(@"MINING-HIST:  TEST-04:  - archive: intervals %lu bytes, objects %lu bytes", (unsigned long) [dArchive length], (unsigned long) [dObjects length]);
+    }
+    
+    free(lows);
+    free(highs);
+    
+    if (ret) {
+        NSLog(@"MINING-HIST:  TEST-04:  Interval benchmark completed.");
+    }
+    return ret;
+}
+
+/*
+ *  Verify the numeric interval set and its use by the history.
+ */
++(BOOL) runTest_3IntervalSet
+{
+    NSLog(@"MINING-HIST:  TEST-03:  Starting interval set testing.");
+    
+    @autoreleasepool {
+        NSLog(@"MINING-HIST:  TEST-03:  - checking that adjacent and overlapping intervals are coalesced.");
+        CS_twmTweetIntervalSet *tis = [CS_twmTweetIntervalSet intervalSet];
+        [tis addIntervalWithLow:50 andHigh:60];
+        [tis addIntervalWithLow:1 andHigh:5];
+        [tis addIntervalWithLow:7 andHigh:9];
+        [tis addIntervalWithLow:30 andHigh:40];
+        if ([tis count] != 4) {
+            NSLog(@"ERROR: the disjoint intervals were merged.");
+            return NO;
+        }
+        
+        [tis addIntervalWithLow:6 andHigh:6];
+        [tis addIntervalWithLow:35 andHigh:55];
+        uint64_t low  = 0;
+        uint64_t high = 0;
+        if ([tis count] != 2 ||
+            ![tis getIntervalAtIndex:0 withLow:&low andHigh:&high] || low != 1 || high != 9 ||
+            ![tis getIntervalAtIndex:1 withLow:&low andHigh:&high] || low != 30 || high != 60) {
+            NSLog(@"ERROR: the intervals were not coalesced correctly.  %@", tis);
+            return NO;
+        }
+        
+        if (![tis containsValue:1] || ![tis containsValue:60] || [tis containsValue:10] || [tis containsValue:61] || [tis containsValue:0]) {
+            NSLog(@"ERROR: the containment checks are wrong.");
+            return NO;
+        }
+        
+        NSLog(@"MINING-HIST:  TEST-03:  - checking gap queries.");
+        if (![tis findGapAtOrBelowValue:45 withFloor:1 returningLow:&low andHigh:&high] || low != 10 || high != 29) {
+            NSLog(@"ERROR: the gap below a covered value is wrong.");
+            return NO;
+        }
+        if (![tis findGapAtOrBelowValue:20 withFloor:1 returningLow:&low andHigh:&high] || low != 10 || high != 20) {
+            NSLog(@"ERROR: the gap at an uncovered value is wrong.");
+            return NO;
+        }
+        if ([tis findGapAtOrBelowValue:9 withFloor:1 returningLow:&low andHigh:&high]) {
+            NSLog(@"ERROR: a gap was found below the floor.");
+            return NO;
+        }
+        
+        NSLog(@"MINING-HIST:  TEST-03:  - checking the binary archive.");
+        [tis addIntervalWithLow:ULLONG_MAX - 10 andHigh:ULLONG_MAX];
+        NSData *d                       = [tis archiveData];
+        CS_twmTweetIntervalSet *tisCopy = [CS_twmTweetIntervalSet intervalSetFromData:d withError:nil];
+        if (!tisCopy || ![[tisCopy description] isEqualToString:[tis description]]) {
+            NSLog(@"ERROR: the archive did not round-trip.");
+            return NO;
+        }
+        
+        NSError *err = nil;
+        if ([CS_twmTweetIntervalSet intervalSetFromData:[d subdataWithRange:NSMakeRange(0, [d length] - 1)] withError:&err]) {
+            NSLog(@"ERROR: a truncated archive was accepted.");
+            return NO;
+        }
+        
+        NSMutableData *mdBad = [NSMutableData dataWithData:d];
+        ((uint8_t *) [mdBad mutableBytes])[0] = 0xFF;
+        if ([CS_twmTweetIntervalSet intervalSetFromData:mdBad withError:&err]) {
+            NSLog(@"ERROR: an archive with the wrong version was accepted.");
+            return NO;
+        }
+    }
+    
+    @autoreleasepool {
+        NSLog(@"MINING-HIST:  TEST-03:  - checking that gap requests are built from the intervals.");
+        CS_tapi_statuses_timeline_base *api = [[[CS_tapi_statuses_timeline_base alloc] initWithCreatorHandle:nil inCategory:CS_CNT_THROTTLE_TRANSIENT] autorelease];
+        CS_twmMiningStatsHistory *hist      = [[[CS_twmMiningStatsHistory alloc] init] autorelease];
+        [hist updateHistoryWithRange:[CS_tapi_tweetRange rangeForMin:@"1234" andMax:@"2345"] fromAPI:api];
+        [hist updateHistoryWithRange:[CS_tapi_tweetRange rangeForMin:@"3456" andMax:@"4567"] fromAPI:api];
+        
+        CS_tapi_statuses_timeline_base *apiReq = [[[CS_tapi_statuses_timeline_base alloc] initWithCreatorHandle:nil inCategory:CS_CNT_THROTTLE_TRANSIENT] autorelease];
+        if (![hist hasPriorGapsInHistory] || ![hist populateAPIForPastGapsOrMostRecentRequest:apiReq] ||
+            ![apiReq.maxTweetId isEqualToString:@"3455"] || ![apiReq.sinceTweetId isEqualToString:@"2345"]) {
+            NSLog(@"ERROR: the gap request is wrong.");
+            return NO;
+        }
+        
+        NSLog(@"MINING-HIST:  TEST-03:  - checking that older archives are converted.");
+        NSMutableData *md         = [NSMutableData data];
+        NSKeyedArchiver *archiver = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:md] autorelease];
+        [archiver encodeObject:[NSArray arrayWithObjects:[CS_tapi_tweetRange rangeForMin:@"3456" andMax:@"4567"],
+                                [CS_tapi_tweetRange rangeForMin:@"1234" andMax:@"2345"], nil] forKey:@"h"];
+        [archiver finishEncoding];
+        
+        NSKeyedUnarchiver *unarchiver  = [[[NSKeyedUnarchiver alloc] initForReadingWithData:md] autorelease];
+        CS_twmMiningStatsHistory *hOld = [[[CS_twmMiningStatsHistory alloc] initWithCoder:unarchiver] autorelease];
+        [unarchiver finishDecoding];
+        NSArray *a = [hOld processedHistory];
+        if ([a count] != 2 || ![[a objectAtIndex:0] isEqualToRange:[CS_tapi_tweetRange rangeForMin:@"3456" andMax:@"4567"]] ||
+            ![[a objectAtIndex:1] isEqualToRange:[CS_tapi_tweetRange rangeForMin:@"1234" andMax:@"2345"]]) {
+            NSLog(@"ERROR: the older archive was not converted.");
+            return NO;
+        }
+        
+        CS_twmMiningStatsHistory *hCopy = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:hOld]];
+        if ([[hCopy processedHistory] count] != 2) {
+            NSLog(@"ERROR: the history did not round-trip.");
+            return NO;
+        }
+    }
+    
+    NSLog(@"MINING-HIST:  TEST-03:  Interval set testing completed.");
+    return YES;
+}
+
 /*
  *  Verify the range-expansion behavior when passing an API that has content.
  */
@@ -395,7 +705,9 @@
 {
 #ifdef CHATSEAL_DEBUGGING_ROUTINES
     if ([ChatSealDebug_twitter_mining_history runTest_1SimpleTracking] &&
-        [ChatSealDebug_twitter_mining_history runTest_2RangeExpansion]) {
+        [ChatSealDebug_twitter_mining_history runTest_2RangeExpansion] &&
+        [ChatSealDebug_twitter_mining_history runTest_3IntervalSet] &&
+        [ChatSealDebug_twitter_mining_history runTest_4IntervalBenchmark]) {
         NSLog(@"MINING-HIST:  All tracking tests completed successfully.");
     }
     else {
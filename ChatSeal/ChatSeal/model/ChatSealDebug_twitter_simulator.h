@@ -0,0 +1,20 @@
+//
+//  ChatSealDebug_twitter_simulator.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/20/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - the replay benchmark runs the feed collector against a local stand-in for the Twitter service.
+// - when the directory below exists in the app's documents, its 'tweets.json' (an array of recorded
+//   statuses) and 'media' sub-directory are served instead of the synthetic corpus.
+extern NSString *PSD_TWSIM_RECORDING_DIR;
+
+@interface ChatSealDebug_twitter_simulator : NSObject
++(void) beginFeedMiningReplayBenchmark;
++(void) beginFeedMiningReplayBenchmarkForDuration:(NSTimeInterval) duration withLatency:(NSTimeInterval) latency;
++(void) beginImagePipelineBenchmark;
+@end
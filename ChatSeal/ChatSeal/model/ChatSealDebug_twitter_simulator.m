@@ -0,0 +1,1705 @@
+//
+//  ChatSealDebug_twitter_simulator.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/20/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#import <Security/Security.h>
+#import "ChatSealDebug_twitter_simulator.h"
+#import "ChatSeal.h"
+#import "ChatSealFeedCollector.h"
+#import "CS_twitterFeedAPI.h"
+#import "CS_twitterFeed_tweetText.h"
+#import "CS_feedShared.h"
+
+//  THREADING-NOTES:
+//  - the simulator accepts connections on its own thread and services each one in an operation queue so that
+//    the collector sees realistic concurrency and latency.
+//  - all shared simulator state (statistics, rate limits, the media cache) is protected by locking the simulator.
+//  - the corpus is built before the server starts and is never modified afterwards, so it is read without the lock.
+
+NSString *PSD_TWSIM_RECORDING_DIR = @"twitter-simulator";
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+// - constants
+static const NSTimeInterval PSD_TWSIM_STD_DURATION   = 120.0;
+static const NSTimeInterval PSD_TWSIM_STD_LATENCY    = 0.05;
+static const NSTimeInterval PSD_TWSIM_STD_WINDOW     = (15.0 * 60.0);
+static const NSTimeInterval PSD_TWSIM_REFRESH_INT    = 1.0;
+static const NSTimeInterval PSD_TWSIM_ACCEPT_WAIT    = 0.5;
+static const NSUInteger     PSD_TWSIM_RECV_TIMEOUT   = 10;
+static const NSUInteger     PSD_TWSIM_MAX_CONNS      = 16;
+static const NSUInteger     PSD_TWSIM_MAX_HEADER     = (64 * 1024);
+static const NSUInteger     PSD_TWSIM_NUM_TWEETS     = 4000;
+static const NSUInteger     PSD_TWSIM_NUM_USERS      = 32;
+static const NSUInteger     PSD_TWSIM_IMAGE_PCT      = 25;          //  percentage of tweets with media
+static const NSUInteger     PSD_TWSIM_SEALED_PCT     = 50;          //  percentage of media tweets with seal-compatible text
+static const NSUInteger     PSD_TWSIM_MEDIA_VARIANTS = 8;
+static const NSUInteger     PSD_TWSIM_MEDIA_SIDE     = 512;
+static const NSUInteger     PSD_TWSIM_STD_COUNT      = 20;
+static const NSUInteger     PSD_TWSIM_MAX_COUNT      = 200;
+static const uint64_t       PSD_TWSIM_BASE_TWEET_ID  = 500000000000000000ULL;
+static const uint64_t       PSD_TWSIM_BASE_USER_ID   = 2000000000ULL;
+static NSString             *PSD_TWSIM_JSON_TYPE     = @"application/json;charset=utf-8";
+static NSString             *PSD_TWSIM_MEDIA_KEY     = @"media";
+static const NSUInteger     PSD_TWSIM_PIPE_IMAGES    = 64;
+static const NSUInteger     PSD_TWSIM_PIPE_PACKED    = 4;           //  one in every N benchmark images is a packed message
+static const NSUInteger     PSD_TWSIM_PIPE_PAYLOAD   = (16 * 1024);
+
+// - forward declarations
+// - a single status in the simulated corpus, pre-serialized so that responses are cheap to assemble.
+@interface PSD_twsimTweet : NSObject
+@property (nonatomic, assign) uint64_t tweetId;
+@property (nonatomic, assign) NSUInteger userSlot;
+@property (nonatomic, retain) NSData *json;
+@end
+
+// - the fixed-window rate limit state for a single endpoint, modeled after the service's documented behavior.
+@interface PSD_twsimLimit : NSObject
+@property (nonatomic, assign) NSUInteger limit;
+@property (nonatomic, assign) NSTimeInterval interval;
+@property (nonatomic, assign) NSTimeInterval tWindowStart;
+@property (nonatomic, assign) NSUInteger numInWindow;
+@property (nonatomic, assign) NSUInteger numServed;
+@property (nonatomic, assign) NSUInteger numRefused;
+@end
+
+// - the local stand-in for the service.
+@interface PSD_twitterSimulator : NSObject
+-(id) initWithRecordingsAtURL:(NSURL *) uRecordings;
+-(void) setAPILatency:(NSTimeInterval) apiLatency andMediaLatency:(NSTimeInterval) mediaLatency withJitter:(NSTimeInterval) jitter;
+-(void) setRateLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval forEndpoint:(NSString *) endpoint;
+-(BOOL) start;
+-(void) stop;
+-(NSURL *) serviceURL;
+-(void) setMedia:(NSData *) d forName:(NSString *) name;
+-(void) reportStatisticsForInterval:(NSTimeInterval) elapsed;
+@end
+
+@interface PSD_twitterSimulator (internal)
+-(BOOL) isRunning;
+-(void) buildSyntheticCorpus;
+-(BOOL) loadRecordedCorpus;
+-(void) indexCorpus;
+-(NSMutableDictionary *) userForSlot:(NSUInteger) slot;
+-(NSString *) mediaURLStringForName:(NSString *) name;
+-(void) acceptThread;
+-(void) serviceConnectionOnSocket:(int) sock;
+-(BOOL) readRequestFromSocket:(int) sock withBuffer:(NSMutableData *) mdBuf returningMethod:(NSString **) method andTarget:(NSString **) target;
+-(BOOL) sendData:(NSData *) d toSocket:(int) sock;
+-(BOOL) respondToTarget:(NSString *) target onSocket:(int) sock;
+-(NSDictionary *) queryFromString:(NSString *) sQuery;
+-(NSString *) endpointForPath:(NSString *) path returningMediaName:(NSString **) mediaName;
+-(NSTimeInterval) nextLatencyForMedia:(BOOL) isMedia;
+-(BOOL) consumeRateLimitForEndpoint:(NSString *) endpoint withHeaders:(NSMutableDictionary *) mdHeaders;
+-(NSData *) responseForEndpoint:(NSString *) endpoint withQuery:(NSDictionary *) dQuery returningStatus:(NSUInteger *) status andNumberOfTweets:(NSUInteger *) numTweets;
+-(NSArray *) tweetsForQuery:(NSDictionary *) dQuery inUserSlot:(NSInteger) slot;
+-(NSInteger) userSlotForQuery:(NSDictionary *) dQuery;
+-(NSData *) jsonArrayFromTweets:(NSArray *) arr;
+-(NSData *) mediaWithName:(NSString *) name;
+-(NSData *) syntheticImageForVariant:(NSUInteger) variant;
++(NSData *) errorWithCode:(NSUInteger) code andMessage:(NSString *) msg;
++(NSString *) reasonForStatus:(NSUInteger) status;
+@end
+
+// - the replay harness drives the collector while the simulator is active.
+@interface PSD_twsimReplay : NSObject
+-(id) initWithSimulator:(PSD_twitterSimulator *) sim andDuration:(NSTimeInterval) duration;
+-(void) begin;
+@end
+
+// - compares the old serial decoding of downloaded images with the collector's image pipeline.
+@interface PSD_twsimPipelineBench : NSObject
+-(id) initWithSimulator:(PSD_twitterSimulator *) sim;
+-(void) begin;
+@end
+
+@interface PSD_twsimPipelineBench (internal)
+-(void) buildImages;
+-(NSURL *) URLForItem:(NSUInteger) idx;
+-(void) fetchNextSerialItem;
+-(BOOL) decodeSerially:(NSData *) dPacked;
+-(void) beginPipelinedPass;
+-(void) pumpPipeline;
+-(void) completePipelinedItemAsDecoded:(BOOL) isDecoded;
+-(void) reportAndFinish;
+@end
+
+static PSD_twsimReplay *activeReplay       = nil;
+static PSD_twsimPipelineBench *activeBench = nil;
+#endif
+
+/*********************************
+ ChatSealDebug_twitter_simulator
+ *********************************/
+@implementation ChatSealDebug_twitter_simulator
+/*
+ *  Run the feed collector against the simulated service with the standard settings.
+ */
++(void) beginFeedMiningReplayBenchmark
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    [ChatSealDebug_twitter_simulator beginFeedMiningReplayBenchmarkForDuration:PSD_TWSIM_STD_DURATION withLatency:PSD_TWSIM_STD_LATENCY];
+#endif
+}
+
+/*
+ *  Run the feed collector against the simulated service, reporting its throughput when the duration elapses.
+ *  - the feed collector must be open with at least one Twitter feed because its credentials are still used to
+ *    sign the requests, although the simulator ignores them.
+ */
++(void) beginFeedMiningReplayBenchmarkForDuration:(NSTimeInterval) duration withLatency:(NSTimeInterval) latency
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    if (activeReplay) {
+        NSLog(@"TW-SIM:  ERROR: A replay benchmark is already running.");
+        return;
+    }
+    
+    ChatSealFeedCollector *collector = [ChatSeal applicationFeedCollector];
+    if (![collector isOpen] || ![collector hasAnyFeeds]) {
+        NSLog(@"TW-SIM:  ERROR: The replay benchmark requires an open feed collector with at least one feed.");
+        return;
+    }
+    
+    // - recordings take precedence over the synthetic corpus when they exist.
+    NSURL *uRecordings = [[NSFileManager defaultManager] URLForDirectory:NSDocumentDirectory inDomain:NSUserDomainMask appropriateForURL:nil create:NO error:nil];
+    uRecordings        = [uRecordings URLByAppendingPathComponent:PSD_TWSIM_RECORDING_DIR];
+    if (![[NSFileManager defaultManager] fileExistsAtPath:[uRecordings path]]) {
+        uRecordings = nil;
+    }
+    
+    PSD_twitterSimulator *sim = [[[PSD_twitterSimulator alloc] initWithRecordingsAtURL:uRecordings] autorelease];
+    [sim setAPILatency:latency andMediaLatency:latency * 2.0 withJitter:latency / 2.0];
+    if (![sim start]) {
+        NSLog(@"TW-SIM:  ERROR: Failed to start the simulated service.");
+        return;
+    }
+    
+    NSLog(@"TW-SIM:  Starting the %u second replay benchmark against %@ using %@.", (unsigned) duration, [sim serviceURL], uRecordings ? @"recorded content" : @"a synthetic corpus");
+    [CS_twitterFeedAPI setSimulatedServiceURL:[sim serviceURL]];
+    activeReplay = [[PSD_twsimReplay alloc] initWithSimulator:sim andDuration:duration];
+    [activeReplay begin];
+#endif
+}
+
+/*
+ *  Download and decode a fixed set of images from the simulated service, first one at a time the way the
+ *  feeds used to and then through an image pipeline, and report the difference.
+ *  - an active seal is required to produce images that survive all the stages.
+ */
++(void) beginImagePipelineBenchmark
+{
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    if (activeReplay || activeBench) {
+        NSLog(@"TW-SIM:  ERROR: A simulator benchmark is already running.");
+        return;
+    }
+    
+    PSD_twitterSimulator *sim = [[[PSD_twitterSimulator alloc] initWithRecordingsAtURL:nil] autorelease];
+    [sim setAPILatency:PSD_TWSIM_STD_LATENCY andMediaLatency:PSD_TWSIM_STD_LATENCY * 2.0 withJitter:PSD_TWSIM_STD_LATENCY / 2.0];
+    if (![sim start]) {
+        NSLog(@"TW-SIM:  ERROR: Failed to start the simulated service.");
+        return;
+    }
+    
+    if (![ChatSeal activeSeal]) {
+        NSLog(@"TW-SIM:  WARNING: There is no active seal so every image will be rejected by the first decoding stage.");
+    }
+    NSLog(@"TW-SIM:  Starting the image pipeline benchmark with %u images against %@.", (unsigned) PSD_TWSIM_PIPE_IMAGES, [sim serviceURL]);
+    activeBench = [[PSD_twsimPipelineBench alloc] initWithSimulator:sim];
+    [activeBench begin];
+#endif
+}
+@end
+
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+/*****************
+ PSD_twsimTweet
+ *****************/
+@implementation PSD_twsimTweet
+@synthesize tweetId;
+@synthesize userSlot;
+@synthesize json;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [json release];
+    json = nil;
+    
+    [super dealloc];
+}
+@end
+
+/*****************
+ PSD_twsimLimit
+ *****************/
+@implementation PSD_twsimLimit
+@synthesize limit;
+@synthesize interval;
+@synthesize tWindowStart;
+@synthesize numInWindow;
+@synthesize numServed;
+@synthesize numRefused;
+@end
+
+/***********************
+ PSD_twitterSimulator
+ ***********************/
+@implementation PSD_twitterSimulator
+/*
+ *  Object attributes.
+ */
+{
+    NSURL               *uRecordings;
+    int                 sockListen;
+    uint16_t            serverPort;
+    BOOL                isRunning;
+    NSOperationQueue    *opQueue;
+    NSArray             *arrTweets;                 //  sorted in descending id order, like the service returns them.
+    NSDictionary        *dTweetsById;
+    NSMutableArray      *maUsers;
+    NSMutableDictionary *mdUserSlots;
+    NSMutableDictionary *mdMediaCache;
+    NSMutableDictionary *mdLimits;
+    NSTimeInterval      apiLatency;
+    NSTimeInterval      mediaLatency;
+    NSTimeInterval      latencyJitter;
+    uint32_t            prngState;
+    NSUInteger          numRequests;
+    NSUInteger          numTimelineResponses;
+    NSUInteger          numTweetsServed;
+    NSUInteger          numMediaServed;
+    NSUInteger          numMediaAbandoned;
+    NSUInteger          numThrottled;
+    NSUInteger          numUnsupported;
+    uint64_t            numBytesSent;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithRecordingsAtURL:(NSURL *) u
+{
+    self = [super init];
+    if (self) {
+        uRecordings   = [u retain];
+        sockListen    = -1;
+        serverPort    = 0;
+        isRunning     = NO;
+        opQueue       = [[NSOperationQueue alloc] init];
+        [opQueue setMaxConcurrentOperationCount:(NSInteger) PSD_TWSIM_MAX_CONNS];
+        arrTweets     = nil;
+        dTweetsById   = nil;
+        maUsers       = [[NSMutableArray alloc] init];
+        mdUserSlots   = [[NSMutableDictionary alloc] init];
+        mdMediaCache  = [[NSMutableDictionary alloc] init];
+        mdLimits      = [[NSMutableDictionary alloc] init];
+        apiLatency    = 0.0;
+        mediaLatency  = 0.0;
+        latencyJitter = 0.0;
+        prngState     = 0x5EA1u;                    //  fixed so that every run sees the same latency sequence.
+        
+        // - the default limits are the ones documented by the service for the endpoints we use.
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"statuses/user_timeline"];
+        [self setRateLimit:15 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"statuses/home_timeline"];
+        [self setRateLimit:15 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"statuses/mentions_timeline"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"statuses/lookup"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"statuses/show"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"search/tweets"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"users/show"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"users/lookup"];
+        [self setRateLimit:15 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"friendships/lookup"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"friendships/show"];
+        [self setRateLimit:15 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"account/verify_credentials"];
+        [self setRateLimit:180 perInterval:PSD_TWSIM_STD_WINDOW forEndpoint:@"application/rate_limit_status"];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self stop];
+    
+    [uRecordings release];
+    uRecordings = nil;
+    
+    [opQueue release];
+    opQueue = nil;
+    
+    [arrTweets release];
+    arrTweets = nil;
+    
+    [dTweetsById release];
+    dTweetsById = nil;
+    
+    [maUsers release];
+    maUsers = nil;
+    
+    [mdUserSlots release];
+    mdUserSlots = nil;
+    
+    [mdMediaCache release];
+    mdMediaCache = nil;
+    
+    [mdLimits release];
+    mdLimits = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Assign the simulated latency for responses.
+ */
+-(void) setAPILatency:(NSTimeInterval) apiLat andMediaLatency:(NSTimeInterval) mediaLat withJitter:(NSTimeInterval) jitter
+{
+    @synchronized (self) {
+        apiLatency    = apiLat;
+        mediaLatency  = mediaLat;
+        latencyJitter = jitter;
+    }
+}
+
+/*
+ *  Assign a rate limit to an endpoint, which is named by its path below the API version (ie. 'statuses/user_timeline').
+ *  - a limit of zero removes the limit.
+ */
+-(void) setRateLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval forEndpoint:(NSString *) endpoint
+{
+    @synchronized (self) {
+        if (!limit || interval <= 0.0) {
+            [mdLimits removeObjectForKey:endpoint];
+            return;
+        }
+        
+        PSD_twsimLimit *lim = [[[PSD_twsimLimit alloc] init] autorelease];
+        lim.limit           = limit;
+        lim.interval        = interval;
+        [mdLimits setObject:lim forKey:endpoint];
+    }
+}
+
+/*
+ *  Start accepting requests on the loopback interface.
+ */
+-(BOOL) start
+{
+    if (sockListen != -1) {
+        return YES;
+    }
+    
+    int sock = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == -1) {
+        NSLog(@"TW-SIM:  ERROR: Failed to create the listening socket.");
+        return NO;
+    }
+    
+    int oneValue = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &oneValue, sizeof(oneValue));
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &oneValue, sizeof(oneValue));
+    
+    struct sockaddr_in sai;
+    memset(&sai, 0, sizeof(sai));
+    sai.sin_len         = sizeof(sai);
+    sai.sin_family      = AF_INET;
+    sai.sin_port        = 0;
+    sai.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t lenAddr   = sizeof(sai);
+    if (bind(sock, (const struct sockaddr *) &sai, sizeof(sai)) != 0 ||
+        listen(sock, (int) PSD_TWSIM_MAX_CONNS) != 0 ||
+        getsockname(sock, (struct sockaddr *) &sai, &lenAddr) != 0) {
+        NSLog(@"TW-SIM:  ERROR: Failed to configure the listening socket.");
+        close(sock);
+        return NO;
+    }
+    serverPort = ntohs(sai.sin_port);
+    
+    // - the corpus references the media URLs, so it can only be built once the port is known.
+    if (!uRecordings || ![self loadRecordedCorpus]) {
+        [self buildSyntheticCorpus];
+    }
+    [self indexCorpus];
+    
+    @synchronized (self) {
+        sockListen = sock;
+        isRunning  = YES;
+    }
+    [NSThread detachNewThreadSelector:@selector(acceptThread) toTarget:self withObject:nil];
+    return YES;
+}
+
+/*
+ *  Stop accepting requests.
+ *  - the accept thread owns the listening socket and closes it once it notices the server is stopped.
+ */
+-(void) stop
+{
+    @synchronized (self) {
+        isRunning = NO;
+    }
+    [opQueue cancelAllOperations];
+}
+
+/*
+ *  Return the base URL for the simulated service.
+ */
+-(NSURL *) serviceURL
+{
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u/", (unsigned) serverPort]];
+}
+
+/*
+ *  Serve the given content for a media item instead of the synthetic images.
+ */
+-(void) setMedia:(NSData *) d forName:(NSString *) name
+{
+    @synchronized (self) {
+        if (d) {
+            [mdMediaCache setObject:d forKey:name];
+        }
+        else {
+            [mdMediaCache removeObjectForKey:name];
+        }
+    }
+}
+
+/*
+ *  Report the throughput of the collector as seen by the simulator.
+ */
+-(void) reportStatisticsForInterval:(NSTimeInterval) elapsed
+{
+    @synchronized (self) {
+        if (elapsed <= 0.0) {
+            elapsed = 1.0;
+        }
+        
+        // - media that is abandoned by the client was still identified because the collector only stops downloading
+        //   once its quick identification has rejected the image.
+        NSUInteger numIdentified = numMediaServed + numMediaAbandoned;
+        NSLog(@"TW-SIM:  RESULTS over %4.1f seconds:", elapsed);
+        NSLog(@"TW-SIM:  - %u requests, %u throttled, %u unsupported, %llu bytes sent.", (unsigned) numRequests, (unsigned) numThrottled, (unsigned) numUnsupported, numBytesSent);
+        NSLog(@"TW-SIM:  - %u tweets in %u timeline/search responses (%4.2f tweets/s).", (unsigned) numTweetsServed, (unsigned) numTimelineResponses, (double) numTweetsServed / elapsed);
+        NSLog(@"TW-SIM:  - %u images identified, %u of them abandoned early (%4.2f images/s).", (unsigned) numIdentified, (unsigned) numMediaAbandoned, (double) numIdentified / elapsed);
+        
+        // - utilization is measured against the full capacity of every window the benchmark touched.
+        NSArray *arrEndpoints = [[mdLimits allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        for (NSString *endpoint in arrEndpoints) {
+            PSD_twsimLimit *lim = [mdLimits objectForKey:endpoint];
+            if (!lim.numServed && !lim.numRefused) {
+                continue;
+            }
+            double numWindows = ceil(elapsed / lim.interval);
+            double capacity   = (double) lim.limit * MAX(numWindows, 1.0);
+            NSLog(@"TW-SIM:  - %@: %u of %u allowed (%4.1f%% utilization), %u refused.", endpoint, (unsigned) lim.numServed, (unsigned) capacity,
+                  ((double) lim.numServed * 100.0) / capacity, (unsigned) lim.numRefused);
+        }
+    }
+}
+@end
+
+/**********************************
+ PSD_twitterSimulator (internal)
+ **********************************/
+@implementation PSD_twitterSimulator (internal)
+/*
+ *  Returns whether the server is still accepting requests.
+ */
+-(BOOL) isRunning
+{
+    @synchronized (self) {
+        return isRunning;
+    }
+}
+
+/*
+ *  Return the user dictionary for the given slot, creating it if necessary.
+ */
+-(NSMutableDictionary *) userForSlot:(NSUInteger) slot
+{
+    while ([maUsers count] <= slot) {
+        NSUInteger idx           = [maUsers count];
+        NSString *sUserId        = [NSString stringWithFormat:@"%llu", PSD_TWSIM_BASE_USER_ID + (uint64_t) idx];
+        NSMutableDictionary *mdU = [NSMutableDictionary dictionary];
+        [mdU setObject:sUserId forKey:@"id_str"];
+        [mdU setObject:[NSNumber numberWithUnsignedLongLong:PSD_TWSIM_BASE_USER_ID + (uint64_t) idx] forKey:@"id"];
+        [mdU setObject:[NSString stringWithFormat:@"cs_sim_%02u", (unsigned) idx] forKey:@"screen_name"];
+        [mdU setObject:[NSString stringWithFormat:@"Simulated User %u", (unsigned) idx] forKey:@"name"];
+        [mdU setObject:[NSNumber numberWithBool:NO] forKey:@"protected"];
+        [mdU setObject:[NSNumber numberWithUnsignedInteger:PSD_TWSIM_NUM_TWEETS / PSD_TWSIM_NUM_USERS] forKey:@"statuses_count"];
+        [maUsers addObject:mdU];
+        [mdUserSlots setObject:[NSNumber numberWithUnsignedInteger:idx] forKey:sUserId];
+        [mdUserSlots setObject:[NSNumber numberWithUnsignedInteger:idx] forKey:[[mdU objectForKey:@"screen_name"] lowercaseString]];
+    }
+    return [maUsers objectAtIndex:slot];
+}
+
+/*
+ *  Return the simulator URL for a named media item.
+ */
+-(NSString *) mediaURLStringForName:(NSString *) name
+{
+    return [NSString stringWithFormat:@"http://127.0.0.1:%u/%@/%@", (unsigned) serverPort, PSD_TWSIM_MEDIA_KEY, name];
+}
+
+/*
+ *  Generate a deterministic corpus of statuses spread over a fixed set of users.
+ *  - when a seal is active, a portion of the media tweets use its hint text so that they are downloaded for verification
+ *    just like they would be from a friend.
+ */
+-(void) buildSyntheticCorpus
+{
+    NSString *sealId           = [ChatSeal activeSeal];
+    NSDateFormatter *df        = [[[NSDateFormatter alloc] init] autorelease];
+    [df setLocale:[[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"] autorelease]];
+    [df setDateFormat:@"EEE MMM dd HH:mm:ss Z yyyy"];
+    NSDate *dtNow              = [NSDate date];
+    NSMutableArray *maCorpus   = [NSMutableArray arrayWithCapacity:PSD_TWSIM_NUM_TWEETS];
+    
+    for (NSUInteger i = 0; i < PSD_TWSIM_NUM_TWEETS; i++) {
+        @autoreleasepool {
+            NSUInteger slot          = (i * 7) % PSD_TWSIM_NUM_USERS;
+            NSMutableDictionary *mdU = [self userForSlot:slot];
+            uint64_t tweetId         = PSD_TWSIM_BASE_TWEET_ID + ((uint64_t) (PSD_TWSIM_NUM_TWEETS - i) * 1013ULL);
+            NSString *sTweetId       = [NSString stringWithFormat:@"%llu", tweetId];
+            BOOL hasMedia            = ((i * 37) % 100) < PSD_TWSIM_IMAGE_PCT;
+            BOOL isSealed            = hasMedia && sealId && ((i * 53) % 100) < PSD_TWSIM_SEALED_PCT;
+            
+            NSString *sText = nil;
+            if (isSealed) {
+                sText = [CS_twitterFeed_tweetText tweetTextForSealId:sealId andNumericUserId:[mdU objectForKey:@"id_str"]];
+            }
+            if (!sText) {
+                sText = [NSString stringWithFormat:@"Simulated status %u from the replay benchmark.", (unsigned) i];
+            }
+            
+            NSMutableDictionary *mdEntities = [NSMutableDictionary dictionary];
+            [mdEntities setObject:[NSArray array] forKey:@"hashtags"];
+            [mdEntities setObject:[NSArray array] forKey:@"urls"];
+            [mdEntities setObject:[NSArray array] forKey:@"user_mentions"];
+            if (hasMedia) {
+                NSString *sMedia = [self mediaURLStringForName:[NSString stringWithFormat:@"%@.png", sTweetId]];
+                NSDictionary *dMedia = [NSDictionary dictionaryWithObjectsAndKeys:@"photo", @"type",
+                                                                                  sTweetId, @"id_str",
+                                                                                  sMedia, @"media_url",
+                                                                                  sMedia, @"media_url_https", nil];
+                [mdEntities setObject:[NSArray arrayWithObject:dMedia] forKey:@"media"];
+            }
+            
+            NSMutableDictionary *mdTweet = [NSMutableDictionary dictionary];
+            [mdTweet setObject:sTweetId forKey:@"id_str"];
+            [mdTweet setObject:[NSNumber numberWithUnsignedLongLong:tweetId] forKey:@"id"];
+            [mdTweet setObject:sText forKey:@"text"];
+            [mdTweet setObject:[df stringFromDate:[dtNow dateByAddingTimeInterval:-(60.0 * (double) i)]] forKey:@"created_at"];
+            [mdTweet setObject:mdU forKey:@"user"];
+            [mdTweet setObject:mdEntities forKey:@"entities"];
+            
+            PSD_twsimTweet *tw = [[[PSD_twsimTweet alloc] init] autorelease];
+            tw.tweetId         = tweetId;
+            tw.userSlot        = slot;
+            tw.json            = [NSJSONSerialization dataWithJSONObject:mdTweet options:0 error:nil];
+            if (tw.json) {
+                [maCorpus addObject:tw];
+            }
+        }
+    }
+    
+    [arrTweets release];
+    arrTweets = [maCorpus retain];
+}
+
+/*
+ *  Load a recorded set of statuses, pointing their media at the simulator.
+ */
+-(BOOL) loadRecordedCorpus
+{
+    NSData *d = [NSData dataWithContentsOfURL:[uRecordings URLByAppendingPathComponent:@"tweets.json"]];
+    if (!d) {
+        NSLog(@"TW-SIM:  ERROR: The recording directory does not include a tweets.json file.");
+        return NO;
+    }
+    
+    NSObject *obj = [NSJSONSerialization JSONObjectWithData:d options:NSJSONReadingMutableContainers error:nil];
+    if (![obj isKindOfClass:[NSArray class]]) {
+        NSLog(@"TW-SIM:  ERROR: The recorded tweets must be a JSON array.");
+        return NO;
+    }
+    
+    NSMutableArray *maCorpus = [NSMutableArray array];
+    for (NSObject *oTweet in (NSArray *) obj) {
+        @autoreleasepool {
+            if (![oTweet isKindOfClass:[NSMutableDictionary class]]) {
+                continue;
+            }
+            NSMutableDictionary *mdTweet = (NSMutableDictionary *) oTweet;
+            NSString *sTweetId           = [mdTweet objectForKey:@"id_str"];
+            NSDictionary *dUser          = [mdTweet objectForKey:@"user"];
+            if (![sTweetId isKindOfClass:[NSString class]] || ![dUser isKindOfClass:[NSDictionary class]] || ![[dUser objectForKey:@"id_str"] isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            
+            // - each distinct recorded user gets its own slot.
+            NSString *sUserId = [dUser objectForKey:@"id_str"];
+            NSNumber *nSlot   = [mdUserSlots objectForKey:sUserId];
+            if (!nSlot) {
+                nSlot = [NSNumber numberWithUnsignedInteger:[maUsers count]];
+                [maUsers addObject:dUser];
+                [mdUserSlots setObject:nSlot forKey:sUserId];
+                NSString *sScreenName = [dUser objectForKey:@"screen_name"];
+                if ([sScreenName isKindOfClass:[NSString class]]) {
+                    [mdUserSlots setObject:nSlot forKey:[sScreenName lowercaseString]];
+                }
+            }
+            
+            // - all media is served from the recording directory, or synthesized when it is missing.
+            NSArray *arrMedia = [[mdTweet objectForKey:@"entities"] objectForKey:PSD_TWSIM_MEDIA_KEY];
+            if ([arrMedia isKindOfClass:[NSArray class]]) {
+                for (NSMutableDictionary *mdMedia in arrMedia) {
+                    NSString *sMedia = [mdMedia objectForKey:@"media_url"];
+                    if ([mdMedia isKindOfClass:[NSMutableDictionary class]] && [sMedia isKindOfClass:[NSString class]]) {
+                        sMedia = [self mediaURLStringForName:[sMedia lastPathComponent]];
+                        [mdMedia setObject:sMedia forKey:@"media_url"];
+                        [mdMedia setObject:sMedia forKey:@"media_url_https"];
+                    }
+                }
+            }
+            
+            PSD_twsimTweet *tw = [[[PSD_twsimTweet alloc] init] autorelease];
+            tw.tweetId         = strtoull([sTweetId UTF8String], NULL, 10);
+            tw.userSlot        = [nSlot unsignedIntegerValue];
+            tw.json            = [NSJSONSerialization dataWithJSONObject:mdTweet options:0 error:nil];
+            if (tw.json) {
+                [maCorpus addObject:tw];
+            }
+        }
+    }
+    
+    if (![maCorpus count]) {
+        NSLog(@"TW-SIM:  ERROR: The recording does not include any usable tweets.");
+        return NO;
+    }
+    
+    [maCorpus sortUsingComparator:^NSComparisonResult(PSD_twsimTweet *tw1, PSD_twsimTweet *tw2) {
+        if (tw1.tweetId > tw2.tweetId) {
+            return NSOrderedAscending;
+        }
+        else if (tw1.tweetId < tw2.tweetId) {
+            return NSOrderedDescending;
+        }
+        return NSOrderedSame;
+    }];
+    
+    [arrTweets release];
+    arrTweets = [maCorpus retain];
+    return YES;
+}
+
+/*
+ *  Build the id lookup for the corpus.
+ */
+-(void) indexCorpus
+{
+    NSMutableDictionary *mdById = [NSMutableDictionary dictionaryWithCapacity:[arrTweets count]];
+    for (PSD_twsimTweet *tw in arrTweets) {
+        [mdById setObject:tw forKey:[NSString stringWithFormat:@"%llu", tw.tweetId]];
+    }
+    [dTweetsById release];
+    dTweetsById = [mdById retain];
+}
+
+/*
+ *  Accept new connections until the server is stopped.
+ */
+-(void) acceptThread
+{
+    @autoreleasepool {
+        int sock = -1;
+        @synchronized (self) {
+            sock = sockListen;
+        }
+        
+        while ([self isRunning]) {
+            // - waiting with a timeout allows us to notice when we've been stopped.
+            fd_set fdsRead;
+            FD_ZERO(&fdsRead);
+            FD_SET(sock, &fdsRead);
+            struct timeval tv;
+            tv.tv_sec  = 0;
+            tv.tv_usec = (int) (PSD_TWSIM_ACCEPT_WAIT * 1000000.0);
+            if (select(sock + 1, &fdsRead, NULL, NULL, &tv) <= 0) {
+                continue;
+            }
+            
+            int sockConn = accept(sock, NULL, NULL);
+            if (sockConn == -1) {
+                continue;
+            }
+            
+            int oneValue = 1;
+            setsockopt(sockConn, SOL_SOCKET, SO_NOSIGPIPE, &oneValue, sizeof(oneValue));
+            struct timeval tvRecv;
+            tvRecv.tv_sec  = (int) PSD_TWSIM_RECV_TIMEOUT;
+            tvRecv.tv_usec = 0;
+            setsockopt(sockConn, SOL_SOCKET, SO_RCVTIMEO, &tvRecv, sizeof(tvRecv));
+            
+            [opQueue addOperationWithBlock:^(void) {
+                [self serviceConnectionOnSocket:sockConn];
+            }];
+        }
+        
+        @synchronized (self) {
+            close(sockListen);
+            sockListen = -1;
+        }
+    }
+}
+
+/*
+ *  Process requests on a single connection until the client closes it.
+ */
+-(void) serviceConnectionOnSocket:(int) sock
+{
+    NSMutableData *mdBuf = [NSMutableData data];
+    while ([self isRunning]) {
+        @autoreleasepool {
+            NSString *method = nil;
+            NSString *target = nil;
+            if (![self readRequestFromSocket:sock withBuffer:mdBuf returningMethod:&method andTarget:&target] ||
+                ![self respondToTarget:target onSocket:sock]) {
+                break;
+            }
+        }
+    }
+    close(sock);
+}
+
+/*
+ *  Read a single HTTP request from the socket.
+ *  - the method is returned for completeness, but the simulated endpoints are identified by their path alone.
+ */
+-(BOOL) readRequestFromSocket:(int) sock withBuffer:(NSMutableData *) mdBuf returningMethod:(NSString **) method andTarget:(NSString **) target
+{
+    static const char *PSD_TWSIM_HDR_END = "\r\n\r\n";
+    NSData *dTerm                        = [NSData dataWithBytes:PSD_TWSIM_HDR_END length:strlen(PSD_TWSIM_HDR_END)];
+    unsigned char buf[4096];
+    
+    // - first find the end of the header.
+    NSRange r;
+    for (;;) {
+        r = [mdBuf rangeOfData:dTerm options:0 range:NSMakeRange(0, [mdBuf length])];
+        if (r.location != NSNotFound) {
+            break;
+        }
+        if ([mdBuf length] > PSD_TWSIM_MAX_HEADER) {
+            return NO;
+        }
+        ssize_t numRead = recv(sock, buf, sizeof(buf), 0);
+        if (numRead <= 0) {
+            return NO;
+        }
+        [mdBuf appendBytes:buf length:(NSUInteger) numRead];
+    }
+    
+    NSString *sHeader = [[[NSString alloc] initWithBytes:[mdBuf bytes] length:r.location encoding:NSISOLatin1StringEncoding] autorelease];
+    NSArray *arrLines = [sHeader componentsSeparatedByString:@"\r\n"];
+    NSArray *arrReq   = [[arrLines firstObject] componentsSeparatedByString:@" "];
+    if ([arrReq count] < 2) {
+        return NO;
+    }
+    *method = [arrReq objectAtIndex:0];
+    *target = [arrReq objectAtIndex:1];
+    
+    // - then discard any body.
+    NSUInteger lenBody = 0;
+    for (NSString *sLine in arrLines) {
+        if ([[sLine lowercaseString] hasPrefix:@"content-length:"]) {
+            lenBody = (NSUInteger) [[sLine substringFromIndex:15] integerValue];
+        }
+    }
+    
+    NSUInteger lenRequest = r.location + r.length + lenBody;
+    while ([mdBuf length] < lenRequest) {
+        ssize_t numRead = recv(sock, buf, sizeof(buf), 0);
+        if (numRead <= 0) {
+            return NO;
+        }
+        [mdBuf appendBytes:buf length:(NSUInteger) numRead];
+    }
+    [mdBuf replaceBytesInRange:NSMakeRange(0, lenRequest) withBytes:NULL length:0];
+    return YES;
+}
+
+/*
+ *  Send the complete buffer to the socket.
+ */
+-(BOOL) sendData:(NSData *) d toSocket:(int) sock
+{
+    const unsigned char *ptr = (const unsigned char *) [d bytes];
+    NSUInteger toSend        = [d length];
+    while (toSend) {
+        ssize_t numSent = send(sock, ptr, toSend, 0);
+        if (numSent <= 0) {
+            if (numSent == -1 && errno == EINTR) {
+                continue;
+            }
+            return NO;
+        }
+        ptr    += numSent;
+        toSend -= (NSUInteger) numSent;
+    }
+    return YES;
+}
+
+/*
+ *  Generate and send the response for a single request.
+ */
+-(BOOL) respondToTarget:(NSString *) target onSocket:(int) sock
+{
+    NSRange rQuery        = [target rangeOfString:@"?"];
+    NSString *sPath       = (rQuery.location == NSNotFound) ? target : [target substringToIndex:rQuery.location];
+    NSDictionary *dQuery  = [self queryFromString:(rQuery.location == NSNotFound) ? nil : [target substringFromIndex:rQuery.location + 1]];
+    NSString *mediaName   = nil;
+    NSString *endpoint    = [self endpointForPath:sPath returningMediaName:&mediaName];
+    
+    NSMutableDictionary *mdHeaders = [NSMutableDictionary dictionary];
+    NSUInteger status              = 200;
+    NSUInteger numTweets           = 0;
+    NSString *sContentType         = PSD_TWSIM_JSON_TYPE;
+    NSData *dBody                  = nil;
+    NSTimeInterval latency         = [self nextLatencyForMedia:mediaName ? YES : NO];
+    if (mediaName) {
+        dBody        = [self mediaWithName:mediaName];
+        sContentType = @"image/png";
+        if (!dBody) {
+            status       = 404;
+            sContentType = PSD_TWSIM_JSON_TYPE;
+            dBody        = [PSD_twitterSimulator errorWithCode:34 andMessage:@"Sorry, that page does not exist"];
+        }
+    }
+    else if (![self consumeRateLimitForEndpoint:endpoint withHeaders:mdHeaders]) {
+        status = 429;
+        dBody  = [PSD_twitterSimulator errorWithCode:88 andMessage:@"Rate limit exceeded"];
+    }
+    else {
+        dBody = [self responseForEndpoint:endpoint withQuery:dQuery returningStatus:&status andNumberOfTweets:&numTweets];
+    }
+    
+    if (latency > 0.0) {
+        [NSThread sleepForTimeInterval:latency];
+    }
+    
+    NSMutableString *msHeader = [NSMutableString stringWithFormat:@"HTTP/1.1 %u %@\r\n", (unsigned) status, [PSD_twitterSimulator reasonForStatus:status]];
+    [msHeader appendFormat:@"Content-Type: %@\r\n", sContentType];
+    [msHeader appendFormat:@"Content-Length: %u\r\n", (unsigned) [dBody length]];
+    for (NSString *sKey in mdHeaders) {
+        [msHeader appendFormat:@"%@: %@\r\n", sKey, [mdHeaders objectForKey:sKey]];
+    }
+    [msHeader appendString:@"Connection: keep-alive\r\n\r\n"];
+    
+    NSData *dHeader = [msHeader dataUsingEncoding:NSISOLatin1StringEncoding];
+    BOOL ret        = [self sendData:dHeader toSocket:sock] && [self sendData:dBody toSocket:sock];
+    
+    @synchronized (self) {
+        numRequests++;
+        numBytesSent += [dHeader length] + [dBody length];
+        if (mediaName && status == 200) {
+            if (ret) {
+                numMediaServed++;
+            }
+            else {
+                numMediaAbandoned++;
+            }
+        }
+        else if (status == 429) {
+            numThrottled++;
+        }
+        else if (status == 404 && !mediaName) {
+            numUnsupported++;
+        }
+        
+        if (numTweets) {
+            numTimelineResponses++;
+            numTweetsServed += numTweets;
+        }
+    }
+    return ret;
+}
+
+/*
+ *  Convert a URL query into a dictionary of its parameters.
+ */
+-(NSDictionary *) queryFromString:(NSString *) sQuery
+{
+    NSMutableDictionary *mdRet = [NSMutableDictionary dictionary];
+    for (NSString *sParm in [sQuery componentsSeparatedByString:@"&"]) {
+        NSRange r = [sParm rangeOfString:@"="];
+        if (r.location == NSNotFound) {
+            continue;
+        }
+        NSString *sKey   = [[sParm substringToIndex:r.location] stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        NSString *sValue = [[[sParm substringFromIndex:r.location + 1] stringByReplacingOccurrencesOfString:@"+" withString:@" "] stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        if (sKey && sValue) {
+            [mdRet setObject:sValue forKey:sKey];
+        }
+    }
+    return mdRet;
+}
+
+/*
+ *  Identify the endpoint from a redirected path, which looks like '/<original host>/1.1/<endpoint>.json', or
+ *  the media name when it is one of the simulator's own image URLs.
+ */
+-(NSString *) endpointForPath:(NSString *) path returningMediaName:(NSString **) mediaName
+{
+    *mediaName        = nil;
+    NSArray *arrComps = [path pathComponents];
+    if ([arrComps count] < 3) {
+        return nil;
+    }
+    
+    // - media may be addressed directly or through a redirected media host.
+    if ([[arrComps objectAtIndex:1] isEqualToString:PSD_TWSIM_MEDIA_KEY] || [[arrComps objectAtIndex:2] isEqualToString:PSD_TWSIM_MEDIA_KEY]) {
+        NSString *sName = [arrComps lastObject];
+        NSRange r       = [sName rangeOfString:@":"];
+        if (r.location != NSNotFound) {
+            sName = [sName substringToIndex:r.location];            //  strip the size suffix
+        }
+        *mediaName = sName;
+        return nil;
+    }
+    
+    if ([arrComps count] < 4) {
+        return nil;
+    }
+    NSString *sEndpoint = [[arrComps subarrayWithRange:NSMakeRange(3, [arrComps count] - 3)] componentsJoinedByString:@"/"];
+    return [sEndpoint stringByDeletingPathExtension];
+}
+
+/*
+ *  Compute the next simulated latency.
+ *  - the jitter uses a fixed linear congruential sequence so that runs are repeatable.
+ */
+-(NSTimeInterval) nextLatencyForMedia:(BOOL) isMedia
+{
+    @synchronized (self) {
+        prngState       = (prngState * 1103515245u) + 12345u;
+        double fraction = (double) ((prngState >> 16) & 0x7FFF) / (double) 0x7FFF;
+        return (isMedia ? mediaLatency : apiLatency) + (latencyJitter * fraction);
+    }
+}
+
+/*
+ *  Consume one request from the endpoint's rate limit, returning NO if it has been exhausted.
+ */
+-(BOOL) consumeRateLimitForEndpoint:(NSString *) endpoint withHeaders:(NSMutableDictionary *) mdHeaders
+{
+    @synchronized (self) {
+        PSD_twsimLimit *lim = endpoint ? [mdLimits objectForKey:endpoint] : nil;
+        if (!lim) {
+            return YES;
+        }
+        
+        NSTimeInterval tNow = [NSDate timeIntervalSinceReferenceDate];
+        if (lim.tWindowStart <= 0.0 || tNow - lim.tWindowStart >= lim.interval) {
+            lim.tWindowStart = tNow;
+            lim.numInWindow  = 0;
+        }
+        
+        BOOL ret = NO;
+        if (lim.numInWindow < lim.limit) {
+            lim.numInWindow++;
+            lim.numServed++;
+            ret = YES;
+        }
+        else {
+            lim.numRefused++;
+        }
+        
+        NSDate *dtReset = [NSDate dateWithTimeIntervalSinceReferenceDate:lim.tWindowStart + lim.interval];
+        [mdHeaders setObject:[NSString stringWithFormat:@"%u", (unsigned) lim.limit] forKey:@"x-rate-limit-limit"];
+        [mdHeaders setObject:[NSString stringWithFormat:@"%u", (unsigned) (lim.limit - lim.numInWindow)] forKey:@"x-rate-limit-remaining"];
+        [mdHeaders setObject:[NSString stringWithFormat:@"%llu", (unsigned long long) [dtReset timeIntervalSince1970]] forKey:@"x-rate-limit-reset"];
+        return ret;
+    }
+}
+
+/*
+ *  Build the response body for an API endpoint.
+ *  - anything that is not simulated (uploads, the user stream) returns a 404 so that it is counted as unsupported.
+ */
+-(NSData *) responseForEndpoint:(NSString *) endpoint withQuery:(NSDictionary *) dQuery returningStatus:(NSUInteger *) status andNumberOfTweets:(NSUInteger *) numTweets
+{
+    *status    = 200;
+    *numTweets = 0;
+    
+    if ([endpoint isEqualToString:@"statuses/user_timeline"] ||
+        [endpoint isEqualToString:@"statuses/home_timeline"] ||
+        [endpoint isEqualToString:@"statuses/mentions_timeline"]) {
+        NSInteger slot = [endpoint isEqualToString:@"statuses/user_timeline"] ? [self userSlotForQuery:dQuery] : -1;
+        NSArray *arr   = [self tweetsForQuery:dQuery inUserSlot:slot];
+        *numTweets     = [arr count];
+        return [self jsonArrayFromTweets:arr];
+    }
+    else if ([endpoint isEqualToString:@"search/tweets"]) {
+        NSArray *arr         = [self tweetsForQuery:dQuery inUserSlot:-1];
+        *numTweets           = [arr count];
+        NSMutableData *mdRet = [NSMutableData dataWithData:[@"{\"statuses\":" dataUsingEncoding:NSUTF8StringEncoding]];
+        [mdRet appendData:[self jsonArrayFromTweets:arr]];
+        [mdRet appendData:[[NSString stringWithFormat:@",\"search_metadata\":{\"count\":%u}}", (unsigned) [arr count]] dataUsingEncoding:NSUTF8StringEncoding]];
+        return mdRet;
+    }
+    else if ([endpoint isEqualToString:@"statuses/lookup"] || [endpoint isEqualToString:@"statuses/show"]) {
+        NSMutableArray *maFound = [NSMutableArray array];
+        for (NSString *sId in [[dQuery objectForKey:@"id"] componentsSeparatedByString:@","]) {
+            PSD_twsimTweet *tw = [dTweetsById objectForKey:sId];
+            if (tw) {
+                [maFound addObject:tw];
+            }
+        }
+        *numTweets = [maFound count];
+        if ([endpoint isEqualToString:@"statuses/lookup"]) {
+            return [self jsonArrayFromTweets:maFound];
+        }
+        else if ([maFound count]) {
+            return [(PSD_twsimTweet *) [maFound firstObject] json];
+        }
+        *status = 404;
+        return [PSD_twitterSimulator errorWithCode:144 andMessage:@"No status found with that ID."];
+    }
+    else if ([endpoint isEqualToString:@"users/show"] || [endpoint isEqualToString:@"account/verify_credentials"]) {
+        NSInteger slot = [self userSlotForQuery:dQuery];
+        return [NSJSONSerialization dataWithJSONObject:[maUsers objectAtIndex:(NSUInteger) MAX(slot, 0)] options:0 error:nil];
+    }
+    else if ([endpoint isEqualToString:@"users/lookup"]) {
+        NSMutableArray *maFound = [NSMutableArray array];
+        NSArray *arrIds         = [[dQuery objectForKey:@"user_id"] componentsSeparatedByString:@","];
+        NSArray *arrNames       = [[dQuery objectForKey:@"screen_name"] componentsSeparatedByString:@","];
+        for (NSString *sKey in [(arrIds ? arrIds : [NSArray array]) arrayByAddingObjectsFromArray:arrNames ? arrNames : [NSArray array]]) {
+            NSNumber *nSlot = [mdUserSlots objectForKey:[sKey lowercaseString]];
+            if (nSlot) {
+                [maFound addObject:[maUsers objectAtIndex:[nSlot unsignedIntegerValue]]];
+            }
+        }
+        return [NSJSONSerialization dataWithJSONObject:maFound options:0 error:nil];
+    }
+    else if ([endpoint isEqualToString:@"friendships/lookup"]) {
+        return [@"[]" dataUsingEncoding:NSUTF8StringEncoding];
+    }
+    else if ([endpoint isEqualToString:@"friendships/show"]) {
+        NSDictionary *dSide = [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithBool:NO], @"following",
+                                                                         [NSNumber numberWithBool:NO], @"followed_by",
+                                                                         [NSNumber numberWithBool:NO], @"blocking",
+                                                                         [NSNumber numberWithBool:NO], @"muting", nil];
+        NSDictionary *dRel  = [NSDictionary dictionaryWithObjectsAndKeys:dSide, @"source", dSide, @"target", nil];
+        return [NSJSONSerialization dataWithJSONObject:[NSDictionary dictionaryWithObject:dRel forKey:@"relationship"] options:0 error:nil];
+    }
+    else if ([endpoint isEqualToString:@"application/rate_limit_status"]) {
+        NSMutableDictionary *mdResources = [NSMutableDictionary dictionary];
+        @synchronized (self) {
+            for (NSString *sKey in mdLimits) {
+                PSD_twsimLimit *lim     = [mdLimits objectForKey:sKey];
+                NSString *sFamily       = [[sKey pathComponents] firstObject];
+                NSMutableDictionary *md = [mdResources objectForKey:sFamily];
+                if (!md) {
+                    md = [NSMutableDictionary dictionary];
+                    [mdResources setObject:md forKey:sFamily];
+                }
+                NSDate *dtReset = [NSDate dateWithTimeIntervalSinceReferenceDate:lim.tWindowStart + lim.interval];
+                [md setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:lim.limit], @"limit",
+                                                                         [NSNumber numberWithUnsignedInteger:lim.limit - lim.numInWindow], @"remaining",
+                                                                         [NSNumber numberWithUnsignedLongLong:(unsigned long long) [dtReset timeIntervalSince1970]], @"reset", nil]
+                       forKey:[NSString stringWithFormat:@"/%@", sKey]];
+            }
+        }
+        return [NSJSONSerialization dataWithJSONObject:[NSDictionary dictionaryWithObject:mdResources forKey:@"resources"] options:0 error:nil];
+    }
+    
+    *status = 404;
+    return [PSD_twitterSimulator errorWithCode:34 andMessage:@"Sorry, that page does not exist"];
+}
+
+/*
+ *  Return a page of the corpus, honoring the standard paging parameters.
+ *  - a negative slot returns tweets from every user.
+ */
+-(NSArray *) tweetsForQuery:(NSDictionary *) dQuery inUserSlot:(NSInteger) slot
+{
+    NSUInteger count = PSD_TWSIM_STD_COUNT;
+    NSString *sCount = [dQuery objectForKey:@"count"];
+    if (sCount) {
+        count = (NSUInteger) MAX([sCount integerValue], 1);
+        count = MIN(count, PSD_TWSIM_MAX_COUNT);
+    }
+    
+    uint64_t maxId   = UINT64_MAX;
+    uint64_t sinceId = 0;
+    NSString *sId    = [dQuery objectForKey:@"max_id"];
+    if (sId) {
+        maxId = strtoull([sId UTF8String], NULL, 10);
+    }
+    sId = [dQuery objectForKey:@"since_id"];
+    if (sId) {
+        sinceId = strtoull([sId UTF8String], NULL, 10);
+    }
+    
+    // - the corpus is sorted in descending order, so find the first item at or below the maximum.
+    NSUInteger low  = 0;
+    NSUInteger high = [arrTweets count];
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        if ([(PSD_twsimTweet *) [arrTweets objectAtIndex:mid] tweetId] > maxId) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    
+    NSMutableArray *maRet = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = low; i < [arrTweets count] && [maRet count] < count; i++) {
+        PSD_twsimTweet *tw = [arrTweets objectAtIndex:i];
+        if (tw.tweetId <= sinceId) {
+            break;
+        }
+        if (slot < 0 || tw.userSlot == (NSUInteger) slot) {
+            [maRet addObject:tw];
+        }
+    }
+    return maRet;
+}
+
+/*
+ *  Find the user addressed by a query.
+ *  - users that aren't in the corpus are mapped onto one that is so that every timeline has content.
+ */
+-(NSInteger) userSlotForQuery:(NSDictionary *) dQuery
+{
+    NSString *sKey = [dQuery objectForKey:@"user_id"];
+    if (!sKey) {
+        sKey = [[dQuery objectForKey:@"screen_name"] lowercaseString];
+    }
+    if (!sKey || ![maUsers count]) {
+        return 0;
+    }
+    
+    NSNumber *nSlot = [mdUserSlots objectForKey:sKey];
+    if (nSlot) {
+        return (NSInteger) [nSlot unsignedIntegerValue];
+    }
+    return (NSInteger) ([sKey hash] % [maUsers count]);
+}
+
+/*
+ *  Assemble the pre-serialized tweets into a JSON array.
+ */
+-(NSData *) jsonArrayFromTweets:(NSArray *) arr
+{
+    NSUInteger len = 2;
+    for (PSD_twsimTweet *tw in arr) {
+        len += [tw.json length] + 1;
+    }
+    
+    NSMutableData *mdRet = [NSMutableData dataWithCapacity:len];
+    [mdRet appendBytes:"[" length:1];
+    BOOL isFirst = YES;
+    for (PSD_twsimTweet *tw in arr) {
+        if (!isFirst) {
+            [mdRet appendBytes:"," length:1];
+        }
+        [mdRet appendData:tw.json];
+        isFirst = NO;
+    }
+    [mdRet appendBytes:"]" length:1];
+    return mdRet;
+}
+
+/*
+ *  Return the content for a media item.
+ *  - recorded media is preferred and anything else is mapped onto one of a small set of synthetic images.
+ */
+-(NSData *) mediaWithName:(NSString *) name
+{
+    if (![[name lowercaseString] hasSuffix:@".png"]) {
+        return nil;
+    }
+    
+    @synchronized (self) {
+        NSData *d = [mdMediaCache objectForKey:name];
+        if (d) {
+            return [[d retain] autorelease];
+        }
+    }
+    
+    NSData *d = nil;
+    if (uRecordings) {
+        d = [NSData dataWithContentsOfURL:[[uRecordings URLByAppendingPathComponent:PSD_TWSIM_MEDIA_KEY] URLByAppendingPathComponent:name]];
+    }
+    
+    NSString *sKey = name;
+    if (!d) {
+        NSUInteger variant = (NSUInteger) (strtoull([name UTF8String], NULL, 10) % PSD_TWSIM_MEDIA_VARIANTS);
+        sKey               = [NSString stringWithFormat:@"variant-%u", (unsigned) variant];
+        @synchronized (self) {
+            d = [[[mdMediaCache objectForKey:sKey] retain] autorelease];
+        }
+        if (!d) {
+            d = [self syntheticImageForVariant:variant];
+        }
+    }
+    
+    if (d) {
+        @synchronized (self) {
+            [mdMediaCache setObject:d forKey:sKey];
+        }
+    }
+    return d;
+}
+
+/*
+ *  Generate a noisy image that compresses about as poorly as a packed message would.
+ */
+-(NSData *) syntheticImageForVariant:(NSUInteger) variant
+{
+    NSUInteger side       = PSD_TWSIM_MEDIA_SIDE;
+    NSUInteger rowBytes   = side * 4;
+    unsigned char *pixels = (unsigned char *) malloc(rowBytes * side);
+    if (!pixels) {
+        return nil;
+    }
+    
+    uint32_t seed = (uint32_t) (variant + 1) * 2654435761u;
+    for (NSUInteger i = 0; i < rowBytes * side; i++) {
+        seed      = (seed * 1664525u) + 1013904223u;
+        pixels[i] = (i % 4) == 3 ? 0xFF : (unsigned char) (seed >> 24);
+    }
+    
+    NSData *dRet            = nil;
+    CGColorSpaceRef csRGB   = CGColorSpaceCreateDeviceRGB();
+    CGContextRef ctx        = CGBitmapContextCreate(pixels, side, side, 8, rowBytes, csRGB, (CGBitmapInfo) kCGImageAlphaNoneSkipLast);
+    if (ctx) {
+        CGImageRef img = CGBitmapContextCreateImage(ctx);
+        if (img) {
+            dRet = UIImagePNGRepresentation([UIImage imageWithCGImage:img]);
+            CGImageRelease(img);
+        }
+        CGContextRelease(ctx);
+    }
+    CGColorSpaceRelease(csRGB);
+    free(pixels);
+    return dRet;
+}
+
+/*
+ *  Return an error body in the same format as the service.
+ */
++(NSData *) errorWithCode:(NSUInteger) code andMessage:(NSString *) msg
+{
+    NSDictionary *dErr = [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:code], @"code", msg, @"message", nil];
+    return [NSJSONSerialization dataWithJSONObject:[NSDictionary dictionaryWithObject:[NSArray arrayWithObject:dErr] forKey:@"errors"] options:0 error:nil];
+}
+
+/*
+ *  Return the reason phrase for the status codes we generate.
+ */
++(NSString *) reasonForStatus:(NSUInteger) status
+{
+    switch (status) {
+        case 200:
+            return @"OK";
+        
+        case 429:
+            return @"Too Many Requests";
+        
+        case 404:
+        default:
+            return @"Not Found";
+    }
+}
+@end
+
+/*****************
+ PSD_twsimReplay
+ *****************/
+@implementation PSD_twsimReplay
+/*
+ *  Object attributes.
+ */
+{
+    PSD_twitterSimulator *sim;
+    NSTimeInterval       duration;
+    NSTimeInterval       tStart;
+    NSTimer              *tmRefresh;
+    NSUInteger           numRefreshes;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithSimulator:(PSD_twitterSimulator *) s andDuration:(NSTimeInterval) d
+{
+    self = [super init];
+    if (self) {
+        sim          = [s retain];
+        duration     = d;
+        tStart       = 0.0;
+        tmRefresh    = nil;
+        numRefreshes = 0;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [tmRefresh invalidate];
+    [tmRefresh release];
+    tmRefresh = nil;
+    
+    [sim release];
+    sim = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Start driving the collector.
+ */
+-(void) begin
+{
+    [[[ChatSeal applicationFeedCollector] imagePipeline] resetStatistics];
+    tStart    = [NSDate timeIntervalSinceReferenceDate];
+    tmRefresh = [[NSTimer timerWithTimeInterval:PSD_TWSIM_REFRESH_INT target:self selector:@selector(replayTimer) userInfo:nil repeats:YES] retain];
+    [[NSRunLoop mainRunLoop] addTimer:tmRefresh forMode:NSRunLoopCommonModes];
+    [self replayTimer];
+}
+
+/*
+ *  Keep the collector busy until the benchmark is complete.
+ *  - the collector is refreshed far more often than normal so that the simulated rate limits, not its own timers,
+ *    determine how much work is done.
+ */
+-(void) replayTimer
+{
+    NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    if (elapsed < duration) {
+        NSError *err = nil;
+        if (![[ChatSeal applicationFeedCollector] refreshActiveFeedsAndAdvancePendingOperationsWithError:&err]) {
+            NSLog(@"TW-SIM:  WARNING: The collector refresh failed.  %@", [err localizedDescription]);
+        }
+        numRefreshes++;
+        return;
+    }
+    
+    // - the report is generated before the service is restored so that any late requests are not included.
+    [tmRefresh invalidate];
+    [tmRefresh release];
+    tmRefresh = nil;
+    
+    [sim reportStatisticsForInterval:elapsed];
+    NSString *sPipeline = [[[ChatSeal applicationFeedCollector] imagePipeline] statisticsDescription];
+    for (NSString *sLine in [sPipeline componentsSeparatedByString:@"\n"]) {
+        if ([sLine length]) {
+            NSLog(@"TW-SIM:  - %@", sLine);
+        }
+    }
+    [CS_twitterFeedAPI setSimulatedServiceURL:nil];
+    [sim stop];
+    NSLog(@"TW-SIM:  The replay benchmark has completed after %u collector refreshes.", (unsigned) numRefreshes);
+    
+    if (activeReplay == self) {
+        [activeReplay autorelease];
+        activeReplay = nil;
+    }
+}
+@end
+
+/*************************
+ PSD_twsimPipelineBench
+ *************************/
+@implementation PSD_twsimPipelineBench
+/*
+ *  Object attributes.
+ */
+{
+    PSD_twitterSimulator *sim;
+    NSOperationQueue     *opQueue;
+    NSURLSession         *session;
+    CS_feedImagePipeline *pipeline;
+    NSArray              *arrNames;
+    NSUInteger           numPacked;
+    NSUInteger           nextItem;
+    NSUInteger           numCompleted;
+    NSUInteger           numDecoded;
+    NSTimeInterval       tStart;
+    NSTimeInterval       tSerial;
+    NSUInteger           numSerialDecoded;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithSimulator:(PSD_twitterSimulator *) s
+{
+    self = [super init];
+    if (self) {
+        sim              = [s retain];
+        opQueue          = [[NSOperationQueue alloc] init];
+        [opQueue setMaxConcurrentOperationCount:1];
+        session          = nil;
+        pipeline         = nil;
+        arrNames         = nil;
+        numPacked        = 0;
+        nextItem         = 0;
+        numCompleted     = 0;
+        numDecoded       = 0;
+        tStart           = 0.0;
+        tSerial          = 0.0;
+        numSerialDecoded = 0;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [session invalidateAndCancel];
+    [session release];
+    session = nil;
+    
+    [pipeline close];
+    [pipeline release];
+    pipeline = nil;
+    
+    [opQueue release];
+    opQueue = nil;
+    
+    [arrNames release];
+    arrNames = nil;
+    
+    [sim release];
+    sim = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Build the image set and start the serial pass.
+ */
+-(void) begin
+{
+    [opQueue addOperationWithBlock:^(void) {
+        [self buildImages];
+        
+        NSURLSessionConfiguration *config = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+        config.HTTPMaximumConnectionsPerHost = (NSInteger) PSD_TWSIM_PIPE_IMAGES;
+        session                              = [[NSURLSession sessionWithConfiguration:config delegate:nil delegateQueue:opQueue] retain];
+        
+        NSLog(@"TW-SIM:  Decoding %u images (%u packed) one at a time.", (unsigned) [arrNames count], (unsigned) numPacked);
+        tStart = [NSDate timeIntervalSinceReferenceDate];
+        [self fetchNextSerialItem];
+    }];
+}
+
+/*
+ *  Generate the names served by the simulator, registering packed messages for a portion of them.
+ */
+-(void) buildImages
+{
+    NSString *sid       = [ChatSeal activeSeal];
+    RSISecureSeal *seal = sid ? [RealSecureImage sealForId:sid andError:nil] : nil;
+    UIImage *imgDecoy   = seal ? [ChatSeal standardDecoyForSeal:sid] : nil;
+    
+    NSMutableArray *maNames = [NSMutableArray array];
+    for (NSUInteger i = 0; i < PSD_TWSIM_PIPE_IMAGES; i++) {
+        NSString *sName = [NSString stringWithFormat:@"%u.png", (unsigned) i];
+        if (seal && imgDecoy && (i % PSD_TWSIM_PIPE_PACKED) == 0) {
+            NSMutableData *mdPad = [NSMutableData dataWithLength:PSD_TWSIM_PIPE_PAYLOAD];
+            SecRandomCopyBytes(kSecRandomDefault, [mdPad length], [mdPad mutableBytes]);
+            NSDictionary *dict = [NSDictionary dictionaryWithObjectsAndKeys:[[NSUUID UUID] UUIDString], @"id", mdPad, @"pad", nil];
+            NSError *err       = nil;
+            NSData *dPacked    = [seal packRoleBasedMessage:dict intoImage:imgDecoy withError:&err];
+            if (dPacked) {
+                sName = [NSString stringWithFormat:@"packed-%u.png", (unsigned) i];
+                [sim setMedia:dPacked forName:sName];
+                numPacked++;
+            }
+            else {
+                NSLog(@"TW-SIM:  WARNING: Failed to pack a benchmark message.  %@", [err localizedDescription]);
+            }
+        }
+        [maNames addObject:sName];
+    }
+    arrNames = [maNames retain];
+}
+
+/*
+ *  Return the URL for the given benchmark image.
+ */
+-(NSURL *) URLForItem:(NSUInteger) idx
+{
+    return [[[sim serviceURL] URLByAppendingPathComponent:PSD_TWSIM_MEDIA_KEY] URLByAppendingPathComponent:[arrNames objectAtIndex:idx]];
+}
+
+/*
+ *  Download the next image in the serial pass, decoding it before the following one is requested.
+ */
+-(void) fetchNextSerialItem
+{
+    if (nextItem >= [arrNames count]) {
+        tSerial          = [NSDate timeIntervalSinceReferenceDate] - tStart;
+        numSerialDecoded = numDecoded;
+        [self beginPipelinedPass];
+        return;
+    }
+    
+    NSURLSessionDataTask *task = [session dataTaskWithURL:[self URLForItem:nextItem++] completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        if (data && [self decodeSerially:data]) {
+            numDecoded++;
+        }
+        [self fetchNextSerialItem];
+    }];
+    [task resume];
+}
+
+/*
+ *  Decode a single image with the same stages used by the pipeline, in line.
+ */
+-(BOOL) decodeSerially:(NSData *) dPacked
+{
+    RSISecureMessageIdentification *smi = [RealSecureImage quickPackedContentIdentification:dPacked];
+    if (smi.willNeverMatch || (smi.message && !smi.message.sealId)) {
+        return NO;
+    }
+    
+    NSData *dEncrypted = [RealSecureImage unpackData:dPacked withMaxLength:0 andError:nil];
+    if (!dEncrypted) {
+        return NO;
+    }
+    
+    RSISecureMessage *sm = [RealSecureImage identifyEncryptedContent:dEncrypted withFullDecryption:YES andError:nil];
+    return (sm && sm.sealId && sm.dMessage);
+}
+
+/*
+ *  Start the pipelined pass over the same images.
+ */
+-(void) beginPipelinedPass
+{
+    NSLog(@"TW-SIM:  Decoding the same images through the image pipeline.");
+    pipeline = [[CS_feedImagePipeline alloc] init];
+    @synchronized (self) {
+        nextItem     = 0;
+        numCompleted = 0;
+        numDecoded   = 0;
+        tStart       = [NSDate timeIntervalSinceReferenceDate];
+    }
+    [self pumpPipeline];
+}
+
+/*
+ *  Admit as many downloads as the pipeline will accept.
+ */
+-(void) pumpPipeline
+{
+    for (;;) {
+        NSUInteger idx = 0;
+        @synchronized (self) {
+            if (nextItem >= [arrNames count]) {
+                return;
+            }
+            idx            = nextItem;
+            NSString *sTag = [arrNames objectAtIndex:idx];
+            if (![pipeline beginFetchForTag:sTag]) {
+                return;
+            }
+            nextItem++;
+        }
+        
+        NSString *sTag             = [arrNames objectAtIndex:idx];
+        NSURLSessionDataTask *task = [session dataTaskWithURL:[self URLForItem:idx] completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            if (!data) {
+                [pipeline abortFetchForTag:sTag];
+                [self completePipelinedItemAsDecoded:NO];
+                return;
+            }
+            [pipeline processFetchedData:data forTag:sTag withCompletion:^(RSISecureMessage *sm, NSError *err) {
+                [self completePipelinedItemAsDecoded:(sm != nil)];
+            }];
+            
+            // - the fetch slot was released when the data was handed over.
+            [self pumpPipeline];
+        }];
+        [task resume];
+    }
+}
+
+/*
+ *  Account for a finished image and report when the pass is complete.
+ */
+-(void) completePipelinedItemAsDecoded:(BOOL) isDecoded
+{
+    BOOL isFinished = NO;
+    @synchronized (self) {
+        numCompleted++;
+        if (isDecoded) {
+            numDecoded++;
+        }
+        isFinished = (numCompleted == [arrNames count]);
+    }
+    
+    if (isFinished) {
+        [opQueue addOperationWithBlock:^(void) {
+            [self reportAndFinish];
+        }];
+    }
+    else {
+        [self pumpPipeline];
+    }
+}
+
+/*
+ *  Report the results of both passes and release the benchmark.
+ */
+-(void) reportAndFinish
+{
+    NSTimeInterval tPipelined = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    NSUInteger numImages      = [arrNames count];
+    NSLog(@"TW-SIM:  RESULTS for %u images (%u packed):", (unsigned) numImages, (unsigned) numPacked);
+    NSLog(@"TW-SIM:  - serial:    %5.2f seconds (%5.2f images/s), %u decoded.", tSerial, (double) numImages / MAX(tSerial, 0.001), (unsigned) numSerialDecoded);
+    NSLog(@"TW-SIM:  - pipelined: %5.2f seconds (%5.2f images/s), %u decoded.", tPipelined, (double) numImages / MAX(tPipelined, 0.001), (unsigned) numDecoded);
+    NSLog(@"TW-SIM:  - speedup:   %4.2fx", tSerial / MAX(tPipelined, 0.001));
+    for (NSString *sLine in [[pipeline statisticsDescription] componentsSeparatedByString:@"\n"]) {
+        if ([sLine length]) {
+            NSLog(@"TW-SIM:  - %@", sLine);
+        }
+    }
+    if (numDecoded != numSerialDecoded) {
+        NSLog(@"TW-SIM:  ERROR: The pipeline decoded a different number of images than the serial pass.");
+    }
+    
+    [sim stop];
+    [session finishTasksAndInvalidate];
+    NSLog(@"TW-SIM:  The image pipeline benchmark has completed.");
+    
+    if (activeBench == self) {
+        [activeBench autorelease];
+        activeBench = nil;
+    }
+}
+@end
+#endif
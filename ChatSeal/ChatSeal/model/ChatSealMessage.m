@@ -278,6 +278,20 @@ static BOOL           cacheStartup       = YES;
     
     // - try to decrypt
     RSISecureMessage *sm = [RealSecureImage identifyPackedContent:dMessage withFullDecryption:YES andError:err];
+    return [ChatSealMessage importSecureMessageIntoVault:sm andSetDefaultFeed:feedId andReturnUserData:userData withError:err];
+}
+
+/*
+ *  Import a message that has already been identified and fully decrypted, which allows the feeds to perform
+ *  the expensive decoding in their own processing pipeline.
+ */
++(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andSetDefaultFeed:(NSString *) feedId andReturnUserData:(NSObject **) userData withError:(NSError **) err
+{
+    NSURL *uRoot = [ChatSealMessage messageRootWithError:err];
+    if (!uRoot) {
+        return nil;
+    }
+    
     if (!sm || !sm.sealId || !sm.dMessage || !sm.hash) {
         return nil;
     }
@@ -11,11 +11,32 @@
 #import <QuartzCore/QuartzCore.h>
 #import "ChatSealQREncode.h"
 #import "CS_qr_encode_defs.h"
+#import "CS_qrReedSolomon.h"
 #import "ChatSeal.h"
 
 //  - constants
 static const int CS_QR_QUIET_MULTIPLIER = 4;
 
+//  - the module matrix packed one bit per module in both orientations so that the penalty
+//    rules can be evaluated a word at a time.  Bits beyond the symbol size are always zero.
+typedef struct {
+    uint64_t byX[CS_QRE_MAX_MODULESIZE][CS_QRE_BB_WORDS];         //  lines of constant x, bit n is y = n
+    uint64_t byY[CS_QRE_MAX_MODULESIZE][CS_QRE_BB_WORDS];         //  lines of constant y, bit n is x = n
+} cs_qre_bitboard_t;
+
+//  - everything required to score the masks without touching the module matrix.
+typedef struct {
+    int               size;
+    cs_qre_bitboard_t function;                                   //  function modules, which are never masked
+    cs_qre_bitboard_t functionDark;
+    cs_qre_bitboard_t data;                                       //  the unmasked codeword bits
+    cs_qre_bitboard_t masked;                                     //  the symbol under the mask being scored
+    uint64_t          patternX[CS_QRE_NUM_MASKS][CS_QRE_MASK_PERIOD][CS_QRE_BB_WORDS];
+    uint64_t          patternY[CS_QRE_NUM_MASKS][CS_QRE_MASK_PERIOD][CS_QRE_BB_WORDS];
+    uint64_t          valid2[CS_QRE_BB_WORDS];                    //  positions that start a run of 2 inside the symbol
+    uint64_t          valid5[CS_QRE_BB_WORDS];                    //  positions that start a run of 5 inside the symbol
+} cs_qre_mask_eval_t;
+
 //  - forward declarations
 @interface ChatSealQREncode (internal)
 -(BOOL) encodeQRString:(NSString *) toEncode asVersion:(NSUInteger) version andLevel:(ps_qre_error_correction_t) level andMask:(ps_qre_masking_pattern_t) mask
@@ -38,8 +59,237 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
 -(void) setMaskingPatternWithNumber:(int) nPatternNo;
 -(void) setFormatInfoPatternWithNumber:(int) nPatternNo;
 -(int) countPenalty;
+-(int) bestMaskByPenaltyCount;
+-(int) bestMaskByBitboardPenalty;
+-(void) setLegacyMaskEvaluation:(BOOL) isLegacy;
+-(int) maskingPatternNumber;
+-(int) symbolSize;
+-(BOOL) isModuleDarkAtX:(int) x andY:(int) y;
 @end
 
+/*
+ *  Compute the format information bits for the error correction level and masking pattern.
+ */
+static int CS_qre_formatData(int nLevel, int nPatternNo)
+{
+	int nFormatInfo;
+	int i;
+
+	switch (nLevel)
+	{
+        case CS_QRE_EC_MED:
+            nFormatInfo = 0x00; // 00nnnb
+            break;
+        
+        case CS_QRE_EC_LOW:
+            nFormatInfo = 0x08; // 01nnnb
+            break;
+        
+        case CS_QRE_EC_QUT:
+            nFormatInfo = 0x18; // 11nnnb
+            break;
+        
+        default: // case RSI_QR_EC_HI:
+            nFormatInfo = 0x10; // 10nnnb
+            break;
+	}
+
+	nFormatInfo += nPatternNo;
+
+	int nFormatData = nFormatInfo << 10;
+
+	for (i = 0; i < 5; ++i)
+	{
+		if (nFormatData & (1 << (14 - i)))
+		{
+			nFormatData ^= (0x0537 << (4 - i)); // 10100110111b
+		}
+	}
+
+	nFormatData += nFormatInfo << 10;
+
+	nFormatData ^= 0x5412; // 101010000010010b
+
+	return nFormatData;
+}
+
+/*
+ *  Return 64 bits of the line starting at the given bit, which may be outside the symbol.
+ *  - modules outside the symbol are reported as light, which is how the penalty rules treat them.
+ */
+static inline uint64_t CS_qre_bb_window(const uint64_t *line, int bit)
+{
+    int idx      = (bit >= 0) ? (bit / 64) : -((63 - bit) / 64);
+    int off      = bit - (idx * 64);
+    uint64_t ret = (idx >= 0 && idx < CS_QRE_BB_WORDS) ? (line[idx] >> off) : 0;
+    if (off && idx + 1 >= 0 && idx + 1 < CS_QRE_BB_WORDS) {
+        ret |= line[idx + 1] << (64 - off);
+    }
+    return ret;
+}
+
+/*
+ *  Assign a single module in both orientations of the bitboard.
+ */
+static inline void CS_qre_bb_setModule(cs_qre_bitboard_t *bb, int x, int y, BOOL isDark)
+{
+    uint64_t bitY = ((uint64_t) 1) << (y & 63);
+    uint64_t bitX = ((uint64_t) 1) << (x & 63);
+    if (isDark) {
+        bb->byX[x][y >> 6] |= bitY;
+        bb->byY[y][x >> 6] |= bitX;
+    }
+    else {
+        bb->byX[x][y >> 6] &= ~bitY;
+        bb->byY[y][x >> 6] &= ~bitX;
+    }
+}
+
+/*
+ *  Set the format information in the bitboard.
+ *  - these are the same modules assigned by setFormatInfoPatternWithNumber.
+ */
+static void CS_qre_bb_setFormatInfo(cs_qre_bitboard_t *bb, int size, int nFormatData)
+{
+    int i;
+    for (i = 0; i <= 5; ++i) {
+        CS_qre_bb_setModule(bb, 8, i, (nFormatData & (1 << i)) ? YES : NO);
+    }
+    CS_qre_bb_setModule(bb, 8, 7, (nFormatData & (1 << 6)) ? YES : NO);
+    CS_qre_bb_setModule(bb, 8, 8, (nFormatData & (1 << 7)) ? YES : NO);
+    CS_qre_bb_setModule(bb, 7, 8, (nFormatData & (1 << 8)) ? YES : NO);
+    for (i = 9; i <= 14; ++i) {
+        CS_qre_bb_setModule(bb, 14 - i, 8, (nFormatData & (1 << i)) ? YES : NO);
+    }
+    for (i = 0; i <= 7; ++i) {
+        CS_qre_bb_setModule(bb, size - 1 - i, 8, (nFormatData & (1 << i)) ? YES : NO);
+    }
+    CS_qre_bb_setModule(bb, 8, size - 8, YES);
+    for (i = 8; i <= 14; ++i) {
+        CS_qre_bb_setModule(bb, 8, size - 15 + i, (nFormatData & (1 << i)) ? YES : NO);
+    }
+}
+
+/*
+ *  Compute the mask bit for a module, where i is the row (y) and j is the column (x).
+ */
+static inline BOOL CS_qre_maskBit(int nPatternNo, int i, int j)
+{
+    switch (nPatternNo)
+    {
+        case 0:
+            return ((i + j) % 2 == 0);
+        
+        case 1:
+            return (i % 2 == 0);
+        
+        case 2:
+            return (j % 3 == 0);
+        
+        case 3:
+            return ((i + j) % 3 == 0);
+        
+        case 4:
+            return (((i / 2) + (j / 3)) % 2 == 0);
+        
+        case 5:
+            return (((i * j) % 2) + ((i * j) % 3) == 0);
+        
+        case 6:
+            return ((((i * j) % 2) + ((i * j) % 3)) % 2 == 0);
+        
+        default: // case 7:
+            return ((((i * j) % 3) + ((i + j) % 2)) % 2 == 0);
+    }
+}
+
+/*
+ *  Score the rules that apply along a single line.
+ *  - N1: runs of five or more modules of the same color score 3 plus one for every module beyond five.
+ *  - N3: the 1:1:3:1:1 finder-like pattern with four light modules on either side scores 40.
+ */
+static int CS_qre_bb_linePenalty(const uint64_t *line, const cs_qre_mask_eval_t *eval)
+{
+    int nPenalty = 0;
+    for (int w = 0; w < CS_QRE_BB_WORDS; w++) {
+        int base = w * 64;
+        uint64_t dm4 = CS_qre_bb_window(line, base - 4);
+        uint64_t dm3 = CS_qre_bb_window(line, base - 3);
+        uint64_t dm2 = CS_qre_bb_window(line, base - 2);
+        uint64_t dm1 = CS_qre_bb_window(line, base - 1);
+        uint64_t d0  = CS_qre_bb_window(line, base);
+        uint64_t d1  = CS_qre_bb_window(line, base + 1);
+        uint64_t d2  = CS_qre_bb_window(line, base + 2);
+        uint64_t d3  = CS_qre_bb_window(line, base + 3);
+        uint64_t d4  = CS_qre_bb_window(line, base + 4);
+        uint64_t d5  = CS_qre_bb_window(line, base + 5);
+        uint64_t d6  = CS_qre_bb_window(line, base + 6);
+        uint64_t d7  = CS_qre_bb_window(line, base + 7);
+        uint64_t d8  = CS_qre_bb_window(line, base + 8);
+        uint64_t d9  = CS_qre_bb_window(line, base + 9);
+        uint64_t d10 = CS_qre_bb_window(line, base + 10);
+        
+        // - a run of five starts wherever the next four neighbors match, and every run is counted once at its
+        //   first such position to add the extra two points.
+        uint64_t s0      = ~(d0 ^ d1);
+        uint64_t s1      = ~(d1 ^ d2);
+        uint64_t s2      = ~(d2 ^ d3);
+        uint64_t s3      = ~(d3 ^ d4);
+        uint64_t run5    = s0 & s1 & s2 & s3 & eval->valid5[w];
+        uint64_t runPrev = ~(dm1 ^ d0) & s0 & s1 & s2 & CS_qre_bb_window(eval->valid5, base - 1);
+        nPenalty        += __builtin_popcountll(run5) + (2 * __builtin_popcountll(run5 & ~runPrev));
+        
+        // - the dark modules of the pattern can only fit inside the symbol, so no extra bounds are necessary.
+        uint64_t finder = ~dm1 & d0 & ~d1 & d2 & d3 & d4 & ~d5 & d6 & ~d7 &
+                          ((~dm2 & ~dm3 & ~dm4) | (~d8 & ~d9 & ~d10));
+        nPenalty       += 40 * __builtin_popcountll(finder);
+    }
+    return nPenalty;
+}
+
+/*
+ *  Score the 2x2 blocks of the same color between two adjacent lines (N2).
+ */
+static int CS_qre_bb_blockPenalty(const uint64_t *line, const uint64_t *next, const cs_qre_mask_eval_t *eval)
+{
+    int nPenalty = 0;
+    for (int w = 0; w < CS_QRE_BB_WORDS; w++) {
+        int base      = w * 64;
+        uint64_t a0   = line[w];
+        uint64_t a1   = CS_qre_bb_window(line, base + 1);
+        uint64_t b0   = next[w];
+        uint64_t b1   = CS_qre_bb_window(next, base + 1);
+        uint64_t blk  = ~(a0 ^ b0) & ~(a1 ^ b1) & ~(a0 ^ a1) & eval->valid2[w];
+        nPenalty     += 3 * __builtin_popcountll(blk);
+    }
+    return nPenalty;
+}
+
+/*
+ *  Compute the same penalty as countPenalty for the masked symbol in the bitboard.
+ */
+static int CS_qre_bb_penalty(const cs_qre_mask_eval_t *eval)
+{
+    int nPenalty = 0;
+    int nDark    = 0;
+    int size     = eval->size;
+    for (int n = 0; n < size; n++) {
+        nPenalty += CS_qre_bb_linePenalty(eval->masked.byX[n], eval);
+        nPenalty += CS_qre_bb_linePenalty(eval->masked.byY[n], eval);
+        if (n < size - 1) {
+            nPenalty += CS_qre_bb_blockPenalty(eval->masked.byX[n], eval->masked.byX[n + 1], eval);
+        }
+        for (int w = 0; w < CS_QRE_BB_WORDS; w++) {
+            nDark += __builtin_popcountll(eval->masked.byX[n][w]);
+        }
+    }
+    
+    // - N4: the balance of dark and light modules, computed as the original does from the light count.
+    int nCount = (size * size) - nDark;
+    nPenalty  += (abs(50 - ((nCount * 100) / (size * size))) / 5) * 10;
+    return nPenalty;
+}
+
 /*********************
  ChatSealQREncode
  *********************/
@@ -63,6 +313,8 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
 	int m_ncAllCodeWord;
 	unsigned char m_byAllCodeWord[CS_QRE_MAX_ALLCODEWORD];
 	unsigned char m_byRSWork[CS_QRE_MAX_CODEBLOCK];
+    
+    BOOL isLegacyMaskEvaluation;
 }
 
 
@@ -140,6 +392,7 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
         m_ncAllCodeWord = 0;
         memset(m_byAllCodeWord, 0, sizeof(m_byAllCodeWord));
         memset(m_byRSWork, 0, sizeof(m_byRSWork));
+        isLegacyMaskEvaluation = NO;
     }
     return self;
 }
@@ -808,40 +1061,14 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
 	int ncRSCw1 = CS_QRE_VersionInfo[m_nVersion].RS_BlockInfo1[level].ncAllCodeWord - ncDataCw1;
 	int ncRSCw2 = CS_QRE_VersionInfo[m_nVersion].RS_BlockInfo2[level].ncAllCodeWord - ncDataCw2;
     
-	nDataCwIndex = 0;
-	nBlockNo = 0;
-    
-	for (i = 0; i < ncBlock1; ++i)
-	{
-        memset(m_byRSWork, 0, sizeof(m_byRSWork));
-		memmove(m_byRSWork, m_byDataCodeWord + nDataCwIndex, ncDataCw1);
-        
-        [self getRSCodeWord:m_byRSWork withNumData:ncDataCw1 andNumCode:ncRSCw1];
-        
-		for (j = 0; j < ncRSCw1; ++j)
-		{
-			m_byAllCodeWord[ncDataCodeWord + (ncBlockSum * j) + nBlockNo] = m_byRSWork[j];
-		}
-        
-		nDataCwIndex += ncDataCw1;
-		++nBlockNo;
-	}
-    
-	for (i = 0; i < ncBlock2; ++i)
-	{
-        memset(m_byRSWork, 0, sizeof(m_byRSWork));
-		memmove(m_byRSWork, m_byDataCodeWord + nDataCwIndex, ncDataCw2);
-        
-        [self getRSCodeWord:m_byRSWork withNumData:ncDataCw2 andNumCode:ncRSCw2];
-        
-		for (j = 0; j < ncRSCw2; ++j)
-		{
-			m_byAllCodeWord[ncDataCodeWord + (ncBlockSum * j) + nBlockNo] = m_byRSWork[j];
-		}
-        
-		nDataCwIndex += ncDataCw2;
-		++nBlockNo;
-	}
+    //  - every block in a symbol shares one generator, so they are all encoded in a single pass.
+    CS_qrReedSolomon *rs = [CS_qrReedSolomon encoderForParityLength:ncRSCw1];
+    if (!rs || (ncBlock2 && ncRSCw2 != ncRSCw1)) {
+        [CS_error fillError:err withCode:CSErrorQREncodingFailure andFailureReason:@"The QR error correction level is not supported."];
+        return NO;
+    }
+    [rs encodeBlocksFromData:m_byDataCodeWord withShortBlocks:ncBlock1 ofLength:ncDataCw1 andLongBlocks:ncBlock2 ofLength:ncDataCw2
+       intoInterleavedParity:m_byAllCodeWord + ncDataCodeWord];
     
 	m_nSymbleSize = m_nVersion * 4 + 17;
     
@@ -1039,42 +1266,7 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
 		{
 			if (! (m_byModuleData[j][i] & 0x20))
 			{
-				unsigned char bMask;
-                
-				switch (nPatternNo)
-				{
-                    case 0:
-                        bMask = ((i + j) % 2 == 0);
-                        break;
-                        
-                    case 1:
-                        bMask = (i % 2 == 0);
-                        break;
-                        
-                    case 2:
-                        bMask = (j % 3 == 0);
-                        break;
-                        
-                    case 3:
-                        bMask = ((i + j) % 3 == 0);
-                        break;
-                        
-                    case 4:
-                        bMask = (((i / 2) + (j / 3)) % 2 == 0);
-                        break;
-                        
-                    case 5:
-                        bMask = (((i * j) % 2) + ((i * j) % 3) == 0);
-                        break;
-                        
-                    case 6:
-                        bMask = ((((i * j) % 2) + ((i * j) % 3)) % 2 == 0);
-                        break;
-                        
-                    default: // case 7:
-                        bMask = ((((i * j) % 3) + ((i + j) % 2)) % 2 == 0);
-                        break;
-				}
+				unsigned char bMask = CS_qre_maskBit(nPatternNo, i, j);
                 
 				m_byModuleData[j][i] = (unsigned char)((m_byModuleData[j][i] & 0xfe) | (((m_byModuleData[j][i] & 0x02) > 1) ^ bMask));
 			}
@@ -1087,43 +1279,9 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
  */
 -(void) setFormatInfoPatternWithNumber:(int) nPatternNo
 {
-	int nFormatInfo;
 	int i;
     
-	switch (m_nLevel)
-	{
-        case CS_QRE_EC_MED:
-            nFormatInfo = 0x00; // 00nnnb
-            break;
-            
-        case CS_QRE_EC_LOW:
-            nFormatInfo = 0x08; // 01nnnb
-            break;
-            
-        case CS_QRE_EC_QUT:
-            nFormatInfo = 0x18; // 11nnnb
-            break;
-            
-        default: // case RSI_QR_EC_HI:
-            nFormatInfo = 0x10; // 10nnnb
-            break;
-	}
-    
-	nFormatInfo += nPatternNo;
-    
-	int nFormatData = nFormatInfo << 10;
-    
-	for (i = 0; i < 5; ++i)
-	{
-		if (nFormatData & (1 << (14 - i)))
-		{
-			nFormatData ^= (0x0537 << (4 - i)); // 10100110111b
-		}
-	}
-    
-	nFormatData += nFormatInfo << 10;
-    
-	nFormatData ^= 0x5412; // 101010000010010b
+	int nFormatData = CS_qre_formatData(m_nLevel, nPatternNo);
     
 	for (i = 0; i <= 5; ++i)
 		m_byModuleData[8][i] = (nFormatData & (1 << i)) ? '\x30' : '\x20';
@@ -1298,27 +1456,12 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
     
 	if (m_nMaskingNo == -1)
 	{
-		m_nMaskingNo = 0;
-        
-        [self setMaskingPatternWithNumber:m_nMaskingNo];
-        
-        [self setFormatInfoPatternWithNumber:m_nMaskingNo];
-        
-		int nMinPenalty = [self countPenalty];
-        
-		for (i = 1; i <= 7; ++i)
-		{
-            [self setMaskingPatternWithNumber:i];
-            [self setFormatInfoPatternWithNumber:i];
-            
-			int nPenalty = [self countPenalty];
-            
-			if (nPenalty < nMinPenalty)
-			{
-				nMinPenalty = nPenalty;
-				m_nMaskingNo = i;
-			}
-		}
+        if (isLegacyMaskEvaluation) {
+            m_nMaskingNo = [self bestMaskByPenaltyCount];
+        }
+        else {
+            m_nMaskingNo = [self bestMaskByBitboardPenalty];
+        }
 	}
     
     [self setMaskingPatternWithNumber:m_nMaskingNo];
@@ -1333,4 +1476,145 @@ static const int CS_QR_QUIET_MULTIPLIER = 4;
 	}
 }
 
+/*
+ *  Choose the mask by applying each one to the module matrix and counting its penalty.
+ */
+-(int) bestMaskByPenaltyCount
+{
+	int i;
+	int nMaskingNo = 0;
+    
+    [self setMaskingPatternWithNumber:nMaskingNo];
+    
+    [self setFormatInfoPatternWithNumber:nMaskingNo];
+
+	int nMinPenalty = [self countPenalty];
+
+	for (i = 1; i <= 7; ++i)
+	{
+        [self setMaskingPatternWithNumber:i];
+        [self setFormatInfoPatternWithNumber:i];
+
+		int nPenalty = [self countPenalty];
+
+		if (nPenalty < nMinPenalty)
+		{
+			nMinPenalty = nPenalty;
+			nMaskingNo = i;
+		}
+	}
+	return nMaskingNo;
+}
+
+/*
+ *  Choose the mask by scoring every one of them from a packed copy of the unmasked symbol.
+ *  - this produces exactly the same penalties as countPenalty, but the module matrix is only
+ *    read once and the rules are evaluated 64 modules at a time.
+ */
+-(int) bestMaskByBitboardPenalty
+{
+    cs_qre_mask_eval_t *eval = (cs_qre_mask_eval_t *) calloc(1, sizeof(cs_qre_mask_eval_t));
+    if (!eval) {
+        return [self bestMaskByPenaltyCount];
+    }
+    
+    // - pack the function modules and the codewords, which are the same for every mask.
+    int size   = m_nSymbleSize;
+    eval->size = size;
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            unsigned char b = m_byModuleData[x][y];
+            if (b & 0x20) {
+                CS_qre_bb_setModule(&eval->function, x, y, YES);
+                if (b & 0x10) {
+                    CS_qre_bb_setModule(&eval->functionDark, x, y, YES);
+                }
+            }
+            else if (b & 0x02) {
+                CS_qre_bb_setModule(&eval->data, x, y, YES);
+            }
+        }
+    }
+    
+    // - the masking patterns are periodic, so only one period of lines is needed in each direction.
+    for (int k = 0; k < CS_QRE_NUM_MASKS; k++) {
+        for (int p = 0; p < CS_QRE_MASK_PERIOD; p++) {
+            for (int n = 0; n < size; n++) {
+                if (CS_qre_maskBit(k, n, p)) {
+                    eval->patternX[k][p][n >> 6] |= ((uint64_t) 1) << (n & 63);
+                }
+                if (CS_qre_maskBit(k, p, n)) {
+                    eval->patternY[k][p][n >> 6] |= ((uint64_t) 1) << (n & 63);
+                }
+            }
+        }
+    }
+    
+    for (int n = 0; n < size - 1; n++) {
+        eval->valid2[n >> 6] |= ((uint64_t) 1) << (n & 63);
+    }
+    for (int n = 0; n < size - 4; n++) {
+        eval->valid5[n >> 6] |= ((uint64_t) 1) << (n & 63);
+    }
+    
+    // - score each mask, keeping the first one with the lowest penalty just as the original did.
+    int nMaskingNo  = 0;
+    int nMinPenalty = 0;
+    for (int k = 0; k < CS_QRE_NUM_MASKS; k++) {
+        for (int n = 0; n < size; n++) {
+            const uint64_t *patX = eval->patternX[k][n % CS_QRE_MASK_PERIOD];
+            const uint64_t *patY = eval->patternY[k][n % CS_QRE_MASK_PERIOD];
+            for (int w = 0; w < CS_QRE_BB_WORDS; w++) {
+                eval->masked.byX[n][w] = eval->functionDark.byX[n][w] | ((eval->data.byX[n][w] ^ patX[w]) & ~eval->function.byX[n][w]);
+                eval->masked.byY[n][w] = eval->functionDark.byY[n][w] | ((eval->data.byY[n][w] ^ patY[w]) & ~eval->function.byY[n][w]);
+            }
+        }
+        CS_qre_bb_setFormatInfo(&eval->masked, size, CS_qre_formatData(m_nLevel, k));
+        
+        int nPenalty = CS_qre_bb_penalty(eval);
+        if (k == 0 || nPenalty < nMinPenalty) {
+            nMinPenalty = nPenalty;
+            nMaskingNo  = k;
+        }
+    }
+    
+    free(eval);
+    return nMaskingNo;
+}
+
+/*
+ *  Use the original mask evaluation, which is only useful for comparison.
+ */
+-(void) setLegacyMaskEvaluation:(BOOL) isLegacy
+{
+    isLegacyMaskEvaluation = isLegacy;
+}
+
+/*
+ *  Return the masking pattern used by the symbol.
+ */
+-(int) maskingPatternNumber
+{
+    return m_nMaskingNo;
+}
+
+/*
+ *  Return the number of modules along one side of the symbol.
+ */
+-(int) symbolSize
+{
+    return m_nSymbleSize;
+}
+
+/*
+ *  Determine if a module in the completed symbol is dark.
+ */
+-(BOOL) isModuleDarkAtX:(int) x andY:(int) y
+{
+    if (x < 0 || y < 0 || x >= m_nSymbleSize || y >= m_nSymbleSize) {
+        return NO;
+    }
+    return m_byModuleData[x][y] ? YES : NO;
+}
+
 @end
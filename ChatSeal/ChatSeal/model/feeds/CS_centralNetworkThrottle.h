@@ -20,6 +20,7 @@ typedef enum {
     CS_CNT_THROTTLE_COUNT
 } cs_cnt_throttle_category_t;
 
+@class CS_netTokenScheduler;
 @interface CS_centralNetworkThrottle : NSObject
 -(BOOL) openWithError:(NSError **) err;
 -(void) assignInitialStatePendingUploadURLs:(NSArray *) arr;
@@ -32,4 +33,5 @@ typedef enum {
 -(BOOL) startPendingURLRequest:(NSURL *) u inCategory:(cs_cnt_throttle_category_t) cat;
 -(BOOL) startPendingURLRequest:(NSURL *) u inCategory:(cs_cnt_throttle_category_t) cat andAllowNonActiveCategory:(BOOL) allowNonActive;
 -(void) completePendingURLRequest:(NSURL *) u inCategory:(cs_cnt_throttle_category_t) cat;
+-(CS_netTokenScheduler *) tokenScheduler;
 @end
@@ -7,6 +7,7 @@
 //
 
 #import "CS_centralNetworkThrottle.h"
+#import "CS_netTokenScheduler.h"
 
 //  THREADING-NOTES:
 //  - internal locking is provided.
@@ -18,6 +19,11 @@
 static const NSUInteger CS_CNT_MAX_UPLOAD_OR_DOWNLOAD = 1;           // bandwidth is very limited on a device so we only allow one of either at a time
 static const NSUInteger CS_CNT_MAX_TRANSIENT          = 15;
 static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime updates could bog down the device, keep these limited
+static const NSTimeInterval CS_CNT_RATE_INTERVAL      = 60.0;        // the category request rates below are per-minute across all feeds
+static const NSUInteger CS_CNT_RATE_UPLOAD            = 12;
+static const NSUInteger CS_CNT_RATE_TRANSIENT         = 180;
+static const NSUInteger CS_CNT_RATE_DOWNLOAD          = 60;
+static const NSUInteger CS_CNT_RATE_REALTIME          = 6;
 
 // - forward declarations
 @interface CS_centralNetworkThrottle (internal)
@@ -41,6 +47,7 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
     BOOL                       isOpen;
     cs_cnt_throttle_category_t activeCategory;
     NSMutableArray             *maPendingURLs[CS_CNT_THROTTLE_COUNT];
+    CS_netTokenScheduler       *tokenScheduler;
 }
 
 /*
@@ -54,6 +61,7 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
         for (NSUInteger i = 0; i  < CS_CNT_THROTTLE_COUNT; i++) {
             maPendingURLs[i] = nil;
         }
+        tokenScheduler = nil;
     }
     return self;
 }
@@ -84,6 +92,20 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
                 maPendingURLs[i] = [[NSMutableArray alloc] init];
             }
         }
+        
+        // - the token scheduler sits in front of the concurrency limits enforced here, pacing the rate-limited APIs
+        //   of all the feeds so that they can be queued instead of refused outright.
+        if (!tokenScheduler) {
+            tokenScheduler = [[CS_netTokenScheduler alloc] initWithClock:nil];
+            
+            // - the categories cap the combined rate of every feed on the device, which is what keeps a handful of
+            //   busy feeds from saturating the network even when each is inside its own service limits.
+            // - the bursts are kept to a fraction of each limit so that requests are paced across the interval.
+            [tokenScheduler setLimit:CS_CNT_RATE_UPLOAD perInterval:CS_CNT_RATE_INTERVAL withBurst:CS_CNT_RATE_UPLOAD / 4 forCategory:CS_CNT_THROTTLE_UPLOAD];
+            [tokenScheduler setLimit:CS_CNT_RATE_TRANSIENT perInterval:CS_CNT_RATE_INTERVAL withBurst:CS_CNT_RATE_TRANSIENT / 10 forCategory:CS_CNT_THROTTLE_TRANSIENT];
+            [tokenScheduler setLimit:CS_CNT_RATE_DOWNLOAD perInterval:CS_CNT_RATE_INTERVAL withBurst:CS_CNT_RATE_DOWNLOAD / 10 forCategory:CS_CNT_THROTTLE_DOWNLOAD];
+            [tokenScheduler setLimit:CS_CNT_RATE_REALTIME perInterval:CS_CNT_RATE_INTERVAL withBurst:CS_CNT_RATE_REALTIME / 3 forCategory:CS_CNT_THROTTLE_REALTIME];
+        }
         return  YES;
     }
 }
@@ -118,6 +140,9 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
             [maPendingURLs[i] release];
             maPendingURLs[i] = nil;
         }
+        [tokenScheduler close];
+        [tokenScheduler release];
+        tokenScheduler = nil;
         isOpen         = NO;
         activeCategory = CS_CNT_THROTTLE_COUNT;
     }
@@ -139,6 +164,9 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
         }
         activeCategory = cat;
     }
+    
+    // - anything queued in the new category may now be admitted.
+    [[self tokenScheduler] processPendingRequests];
 }
 
 /*
@@ -220,6 +248,19 @@ static const NSUInteger CS_CNT_MAX_REALTIME           = 2;           // Realtime
         }
         [maPendingURLs[cat] removeObject:u];
     }
+    
+    // - a completed request may be the only thing holding up queued work.
+    [[self tokenScheduler] processPendingRequests];
+}
+
+/*
+ *  Return the scheduler that paces requests across all the feeds.
+ */
+-(CS_netTokenScheduler *) tokenScheduler
+{
+    @synchronized (self) {
+        return [[tokenScheduler retain] autorelease];
+    }
 }
 @end
 
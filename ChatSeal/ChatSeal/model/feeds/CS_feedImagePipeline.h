@@ -0,0 +1,40 @@
+//
+//  CS_feedImagePipeline.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/22/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - downloaded message candidates are processed in stages so that the network and the CPU can work on
+//   different items at the same time instead of alternating between them.
+// - every stage has its own number of workers and a bounded capacity.  When a stage is full, the items that
+//   finished the prior stage wait there, which eventually prevents the fetch stage from admitting new downloads.
+typedef enum {
+    CS_FIP_STAGE_FETCH    = 0,      //  - the network download, admitted with beginFetchForTag:
+    CS_FIP_STAGE_SNIFF    = 1,      //  - header identification and early rejection
+    CS_FIP_STAGE_UNPACK   = 2,      //  - full extraction of the encrypted data from the image
+    CS_FIP_STAGE_IDENTIFY = 3,      //  - keyring identification and decryption
+    
+    CS_FIP_STAGE_COUNT
+} cs_fip_stage_t;
+
+// - the completion is issued on a worker thread with the decrypted message or nil when it was rejected.
+@class RSISecureMessage;
+typedef void (^cs_fip_completion_block_t)(RSISecureMessage *sm, NSError *err);
+
+@interface CS_feedImagePipeline : NSObject
++(NSString *) nameForStage:(cs_fip_stage_t) stage;
+-(void) setNumberOfWorkers:(NSUInteger) numWorkers andCapacity:(NSUInteger) capacity forStage:(cs_fip_stage_t) stage;
+-(BOOL) beginFetchForTag:(NSString *) tag;
+-(void) abortFetchForTag:(NSString *) tag;
+-(void) processFetchedData:(NSData *) dPacked forTag:(NSString *) tag withCompletion:(cs_fip_completion_block_t) completion;
+-(void) close;
+-(NSUInteger) numberOfItemsInStage:(cs_fip_stage_t) stage;
+-(NSArray *) latencyHistogramForStage:(cs_fip_stage_t) stage;
+-(NSTimeInterval) latencyPercentile:(double) pct forStage:(cs_fip_stage_t) stage;
+-(NSString *) statisticsDescription;
+-(void) resetStatistics;
+@end
@@ -0,0 +1,634 @@
+//
+//  CS_feedImagePipeline.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/22/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_feedImagePipeline.h"
+#import "ChatSeal.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - the work of each stage and the completion blocks are ALWAYS executed outside the lock on the stage's
+//    operation queue because the completions will call back into the feeds, which have their own locks.
+//  - a stage is 'occupied' by an item from the moment it enters the stage until the next stage accepts it, so
+//    items waiting for room downstream continue to count against the stage they just finished.
+
+// - constants
+static const NSUInteger     CS_FIP_NUM_BUCKETS                     = 20;                //  log2 milliseconds, the last is open-ended.
+static const NSTimeInterval CS_FIP_FETCH_TIMEOUT                   = (5.0 * 60.0);      //  downloads that never report back are assumed lost.
+static const NSUInteger     CS_FIP_STD_WORKERS[CS_FIP_STAGE_COUNT]  = {3, 1, 2, 1};
+static const NSUInteger     CS_FIP_STD_CAPACITY[CS_FIP_STAGE_COUNT] = {4, 8, 4, 4};
+
+// - a single candidate as it moves through the stages.
+@interface _S_fip_item : NSObject
+@property (nonatomic, retain) NSString *tag;
+@property (nonatomic, retain) NSData *dPacked;
+@property (nonatomic, retain) NSData *dEncrypted;
+@property (nonatomic, retain) RSISecureMessage *sm;
+@property (nonatomic, retain) NSError *err;
+@property (nonatomic, copy) cs_fip_completion_block_t completion;
+@property (nonatomic, assign) NSTimeInterval tEntered;
+@end
+
+// - forward declarations
+@interface CS_feedImagePipeline (internal)
+-(BOOL) isClosed;
+-(void) purgeLostFetchesWithoutLock;
+-(void) recordLatency:(NSTimeInterval) latency forStage:(cs_fip_stage_t) stage asRejected:(BOOL) isRejected;
+-(void) advanceWaitingItemsWithoutLock;
+-(void) scheduleItem:(_S_fip_item *) item inStage:(cs_fip_stage_t) stage;
+-(void) runStage:(cs_fip_stage_t) stage forItem:(_S_fip_item *) item;
+-(void) completeItem:(_S_fip_item *) item inStage:(cs_fip_stage_t) stage asRejected:(BOOL) isRejected;
+-(BOOL) sniffItem:(_S_fip_item *) item;
+-(BOOL) unpackItem:(_S_fip_item *) item;
+-(BOOL) identifyItem:(_S_fip_item *) item;
+@end
+
+/*************************
+ CS_feedImagePipeline
+ *************************/
+@implementation CS_feedImagePipeline
+/*
+ *  Object attributes.
+ */
+{
+    BOOL                isClosed;
+    NSOperationQueue    *opqStage[CS_FIP_STAGE_COUNT];          //  the fetch stage is performed by the network.
+    NSUInteger          numWorkers[CS_FIP_STAGE_COUNT];
+    NSUInteger          capacity[CS_FIP_STAGE_COUNT];
+    NSUInteger          numOccupied[CS_FIP_STAGE_COUNT];
+    NSMutableArray      *maWaiting[CS_FIP_STAGE_COUNT];         //  finished with the stage, but the next one is full.
+    NSMutableDictionary *mdFetches;                             //  tag --> start time
+    uint32_t            histogram[CS_FIP_STAGE_COUNT][CS_FIP_NUM_BUCKETS];
+    NSUInteger          numCompleted[CS_FIP_STAGE_COUNT];
+    NSUInteger          numRejected[CS_FIP_STAGE_COUNT];
+    NSTimeInterval      totalLatency[CS_FIP_STAGE_COUNT];
+}
+
+/*
+ *  Return a name for the stage that is suitable for reporting.
+ */
++(NSString *) nameForStage:(cs_fip_stage_t) stage
+{
+    switch (stage) {
+        case CS_FIP_STAGE_FETCH:
+            return @"fetch";
+        
+        case CS_FIP_STAGE_SNIFF:
+            return @"sniff";
+        
+        case CS_FIP_STAGE_UNPACK:
+            return @"unpack";
+        
+        case CS_FIP_STAGE_IDENTIFY:
+            return @"identify";
+        
+        default:
+            return @"unknown";
+    }
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    self = [super init];
+    if (self) {
+        isClosed  = NO;
+        mdFetches = [[NSMutableDictionary alloc] init];
+        for (cs_fip_stage_t stage = 0; stage < CS_FIP_STAGE_COUNT; stage++) {
+            numWorkers[stage]  = CS_FIP_STD_WORKERS[stage];
+            capacity[stage]    = CS_FIP_STD_CAPACITY[stage];
+            numOccupied[stage] = 0;
+            maWaiting[stage]   = [[NSMutableArray alloc] init];
+            opqStage[stage]    = nil;
+            if (stage != CS_FIP_STAGE_FETCH) {
+                opqStage[stage]                             = [[NSOperationQueue alloc] init];
+                opqStage[stage].maxConcurrentOperationCount = (NSInteger) numWorkers[stage];
+            }
+        }
+        [self resetStatistics];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self close];
+    
+    for (cs_fip_stage_t stage = 0; stage < CS_FIP_STAGE_COUNT; stage++) {
+        [opqStage[stage] release];
+        opqStage[stage] = nil;
+        
+        [maWaiting[stage] release];
+        maWaiting[stage] = nil;
+    }
+    
+    [mdFetches release];
+    mdFetches = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Configure the concurrency and capacity of one stage.
+ *  - for the fetch stage, the number of workers is the number of concurrent downloads that will be admitted.
+ */
+-(void) setNumberOfWorkers:(NSUInteger) nWorkers andCapacity:(NSUInteger) nCapacity forStage:(cs_fip_stage_t) stage
+{
+    if (stage >= CS_FIP_STAGE_COUNT) {
+        return;
+    }
+    
+    @synchronized (self) {
+        numWorkers[stage] = MAX(nWorkers, 1);
+        capacity[stage]   = MAX(nCapacity, numWorkers[stage]);
+        if (opqStage[stage]) {
+            opqStage[stage].maxConcurrentOperationCount = (NSInteger) numWorkers[stage];
+        }
+        
+        // - a larger capacity may allow waiting items to move forward.
+        [self advanceWaitingItemsWithoutLock];
+    }
+}
+
+/*
+ *  Reserve room for a new download in the fetch stage.
+ *  - returns NO when the pipeline is full, which should be treated like any other network throttling.
+ */
+-(BOOL) beginFetchForTag:(NSString *) tag
+{
+    if (!tag) {
+        return NO;
+    }
+    
+    @synchronized (self) {
+        if (isClosed) {
+            return NO;
+        }
+        
+        [self purgeLostFetchesWithoutLock];
+        if ([mdFetches objectForKey:tag]) {
+            return YES;
+        }
+        
+        if ([mdFetches count] >= numWorkers[CS_FIP_STAGE_FETCH] || numOccupied[CS_FIP_STAGE_FETCH] >= capacity[CS_FIP_STAGE_FETCH]) {
+            return NO;
+        }
+        
+        [mdFetches setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]] forKey:tag];
+        numOccupied[CS_FIP_STAGE_FETCH]++;
+        return YES;
+    }
+}
+
+/*
+ *  A download was cancelled or failed, so release its room in the fetch stage.
+ */
+-(void) abortFetchForTag:(NSString *) tag
+{
+    if (!tag) {
+        return;
+    }
+    
+    @synchronized (self) {
+        NSNumber *nStart = [mdFetches objectForKey:tag];
+        if (!nStart) {
+            return;
+        }
+        [self recordLatency:[NSDate timeIntervalSinceReferenceDate] - [nStart doubleValue] forStage:CS_FIP_STAGE_FETCH asRejected:YES];
+        [mdFetches removeObjectForKey:tag];
+        numOccupied[CS_FIP_STAGE_FETCH]--;
+    }
+}
+
+/*
+ *  A download is complete and its content can be processed.
+ *  - downloads that were not started with beginFetchForTag: (like those restored after a restart) are accepted also.
+ */
+-(void) processFetchedData:(NSData *) dPacked forTag:(NSString *) tag withCompletion:(cs_fip_completion_block_t) completion
+{
+    _S_fip_item *item = [[[_S_fip_item alloc] init] autorelease];
+    item.tag          = tag;
+    item.dPacked      = dPacked;
+    item.completion   = completion;
+    
+    @synchronized (self) {
+        NSNumber *nStart = tag ? [mdFetches objectForKey:tag] : nil;
+        if (nStart) {
+            item.tEntered = [nStart doubleValue];
+            [mdFetches removeObjectForKey:tag];
+        }
+        else {
+            item.tEntered = [NSDate timeIntervalSinceReferenceDate];
+            numOccupied[CS_FIP_STAGE_FETCH]++;
+        }
+    }
+    [self completeItem:item inStage:CS_FIP_STAGE_FETCH asRejected:(dPacked ? NO : YES)];
+}
+
+/*
+ *  Stop accepting new work.
+ *  - anything still in the pipeline is completed as aborted because the feeds rely on a completion for every item.
+ */
+-(void) close
+{
+    NSMutableArray *maAborted = [NSMutableArray array];
+    @synchronized (self) {
+        if (isClosed) {
+            return;
+        }
+        isClosed = YES;
+        
+        for (cs_fip_stage_t stage = 0; stage < CS_FIP_STAGE_COUNT; stage++) {
+            [maAborted addObjectsFromArray:maWaiting[stage]];
+            numOccupied[stage] -= [maWaiting[stage] count];
+            [maWaiting[stage] removeAllObjects];
+        }
+        numOccupied[CS_FIP_STAGE_FETCH] -= [mdFetches count];
+        [mdFetches removeAllObjects];
+    }
+    
+    // - the items that are already scheduled will see the closed state when they run.
+    NSError *err = nil;
+    [CS_error fillError:&err withCode:CSErrorAborted];
+    for (_S_fip_item *item in maAborted) {
+        if (item.completion) {
+            item.completion(nil, err);
+        }
+    }
+}
+
+/*
+ *  Return the number of items currently occupying a stage.
+ */
+-(NSUInteger) numberOfItemsInStage:(cs_fip_stage_t) stage
+{
+    if (stage >= CS_FIP_STAGE_COUNT) {
+        return 0;
+    }
+    @synchronized (self) {
+        return numOccupied[stage];
+    }
+}
+
+/*
+ *  Return the latency counts for a stage, where the first bucket is less than 1ms and each
+ *  subsequent bucket doubles the upper bound.
+ */
+-(NSArray *) latencyHistogramForStage:(cs_fip_stage_t) stage
+{
+    if (stage >= CS_FIP_STAGE_COUNT) {
+        return nil;
+    }
+    
+    NSMutableArray *maRet = [NSMutableArray arrayWithCapacity:CS_FIP_NUM_BUCKETS];
+    @synchronized (self) {
+        for (NSUInteger i = 0; i < CS_FIP_NUM_BUCKETS; i++) {
+            [maRet addObject:[NSNumber numberWithUnsignedInt:histogram[stage][i]]];
+        }
+    }
+    return maRet;
+}
+
+/*
+ *  Return the upper bound of the bucket that contains the given percentile (0.0 - 1.0) of the stage latencies.
+ */
+-(NSTimeInterval) latencyPercentile:(double) pct forStage:(cs_fip_stage_t) stage
+{
+    if (stage >= CS_FIP_STAGE_COUNT) {
+        return 0.0;
+    }
+    
+    @synchronized (self) {
+        uint64_t total = 0;
+        for (NSUInteger i = 0; i < CS_FIP_NUM_BUCKETS; i++) {
+            total += histogram[stage][i];
+        }
+        if (!total) {
+            return 0.0;
+        }
+        
+        uint64_t target = (uint64_t) ceil((double) total * MIN(MAX(pct, 0.0), 1.0));
+        uint64_t cur    = 0;
+        for (NSUInteger i = 0; i < CS_FIP_NUM_BUCKETS; i++) {
+            cur += histogram[stage][i];
+            if (cur >= target) {
+                return ((double) (1ULL << i)) / 1000.0;
+            }
+        }
+        return ((double) (1ULL << (CS_FIP_NUM_BUCKETS - 1))) / 1000.0;
+    }
+}
+
+/*
+ *  Return a summary of the pipeline's behavior that is suitable for logging.
+ */
+-(NSString *) statisticsDescription
+{
+    NSMutableString *msRet = [NSMutableString string];
+    for (cs_fip_stage_t stage = 0; stage < CS_FIP_STAGE_COUNT; stage++) {
+        NSUInteger nDone     = 0;
+        NSUInteger nRejected = 0;
+        NSUInteger nOccupied = 0;
+        NSUInteger nCapacity = 0;
+        NSUInteger nWorkers  = 0;
+        double avgMS         = 0.0;
+        @synchronized (self) {
+            nDone     = numCompleted[stage];
+            nRejected = numRejected[stage];
+            nOccupied = numOccupied[stage];
+            nCapacity = capacity[stage];
+            nWorkers  = numWorkers[stage];
+            if (nDone + nRejected) {
+                avgMS = (totalLatency[stage] * 1000.0) / (double) (nDone + nRejected);
+            }
+        }
+        [msRet appendFormat:@"%@%@: %u passed, %u rejected, avg %4.1f ms, p50 <%u ms, p95 <%u ms, %u of %u occupied with %u workers", [msRet length] ? @"\n" : @"",
+                            [CS_feedImagePipeline nameForStage:stage], (unsigned) nDone, (unsigned) nRejected, avgMS,
+                            (unsigned) ([self latencyPercentile:0.5 forStage:stage] * 1000.0), (unsigned) ([self latencyPercentile:0.95 forStage:stage] * 1000.0),
+                            (unsigned) nOccupied, (unsigned) nCapacity, (unsigned) nWorkers];
+    }
+    return msRet;
+}
+
+/*
+ *  Discard the accumulated statistics.
+ */
+-(void) resetStatistics
+{
+    @synchronized (self) {
+        memset(histogram, 0, sizeof(histogram));
+        for (cs_fip_stage_t stage = 0; stage < CS_FIP_STAGE_COUNT; stage++) {
+            numCompleted[stage] = 0;
+            numRejected[stage]  = 0;
+            totalLatency[stage] = 0.0;
+        }
+    }
+}
+@end
+
+/********************************
+ CS_feedImagePipeline (internal)
+ ********************************/
+@implementation CS_feedImagePipeline (internal)
+/*
+ *  Returns whether the pipeline was closed.
+ */
+-(BOOL) isClosed
+{
+    @synchronized (self) {
+        return isClosed;
+    }
+}
+
+/*
+ *  Downloads are tracked by tag and if one is never reported, it would hold its room forever.
+ *  - ASSUMES the lock is held.
+ */
+-(void) purgeLostFetchesWithoutLock
+{
+    NSTimeInterval tNow  = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableArray *maLost = nil;
+    for (NSString *tag in mdFetches) {
+        if (tNow - [(NSNumber *) [mdFetches objectForKey:tag] doubleValue] > CS_FIP_FETCH_TIMEOUT) {
+            if (!maLost) {
+                maLost = [NSMutableArray array];
+            }
+            [maLost addObject:tag];
+        }
+    }
+    
+    if (maLost) {
+        NSLog(@"CS-ALERT: The image pipeline is discarding %u lost downloads.", (unsigned) [maLost count]);
+        [mdFetches removeObjectsForKeys:maLost];
+        numOccupied[CS_FIP_STAGE_FETCH] -= [maLost count];
+    }
+}
+
+/*
+ *  Add a sample to the stage statistics.
+ *  - ASSUMES the lock is held.
+ */
+-(void) recordLatency:(NSTimeInterval) latency forStage:(cs_fip_stage_t) stage asRejected:(BOOL) isRejected
+{
+    latency           = MAX(latency, 0.0);
+    double ms         = latency * 1000.0;
+    NSUInteger bucket = 0;
+    if (ms >= 1.0) {
+        bucket = MIN((NSUInteger) floor(log2(ms)) + 1, CS_FIP_NUM_BUCKETS - 1);
+    }
+    histogram[stage][bucket]++;
+    totalLatency[stage] += latency;
+    if (isRejected) {
+        numRejected[stage]++;
+    }
+    else {
+        numCompleted[stage]++;
+    }
+}
+
+/*
+ *  Move items that are waiting into the next stage when there is room for them.
+ *  - this works from the end of the pipeline to the start so that room made in one pass propagates all the way back.
+ *  - ASSUMES the lock is held.
+ */
+-(void) advanceWaitingItemsWithoutLock
+{
+    for (NSInteger stage = CS_FIP_STAGE_COUNT - 2; stage >= CS_FIP_STAGE_FETCH; stage--) {
+        cs_fip_stage_t next = (cs_fip_stage_t) (stage + 1);
+        while ([maWaiting[stage] count] && numOccupied[next] < capacity[next]) {
+            _S_fip_item *item = [[[maWaiting[stage] objectAtIndex:0] retain] autorelease];
+            [maWaiting[stage] removeObjectAtIndex:0];
+            numOccupied[stage]--;
+            numOccupied[next]++;
+            [self scheduleItem:item inStage:next];
+        }
+    }
+}
+
+/*
+ *  Queue an item for processing in a stage.
+ *  - ASSUMES the lock is held and room was already reserved.
+ */
+-(void) scheduleItem:(_S_fip_item *) item inStage:(cs_fip_stage_t) stage
+{
+    item.tEntered = [NSDate timeIntervalSinceReferenceDate];
+    [opqStage[stage] addOperationWithBlock:^(void) {
+        [self runStage:stage forItem:item];
+    }];
+}
+
+/*
+ *  Perform the work for one stage.
+ */
+-(void) runStage:(cs_fip_stage_t) stage forItem:(_S_fip_item *) item
+{
+    BOOL isRejected = NO;
+    @autoreleasepool {
+        if ([self isClosed]) {
+            NSError *err = nil;
+            [CS_error fillError:&err withCode:CSErrorAborted];
+            item.err   = err;
+            isRejected = YES;
+        }
+        else {
+            switch (stage) {
+                case CS_FIP_STAGE_SNIFF:
+                    isRejected = ![self sniffItem:item];
+                    break;
+                
+                case CS_FIP_STAGE_UNPACK:
+                    isRejected = ![self unpackItem:item];
+                    break;
+                
+                case CS_FIP_STAGE_IDENTIFY:
+                    isRejected = ![self identifyItem:item];
+                    break;
+                
+                default:
+                    break;
+            }
+        }
+    }
+    [self completeItem:item inStage:stage asRejected:isRejected];
+}
+
+/*
+ *  An item has finished a stage, so either pass it along, hold it until there is room or complete it.
+ */
+-(void) completeItem:(_S_fip_item *) item inStage:(cs_fip_stage_t) stage asRejected:(BOOL) isRejected
+{
+    BOOL isDone    = NO;
+    BOOL isAborted = NO;
+    @synchronized (self) {
+        [self recordLatency:[NSDate timeIntervalSinceReferenceDate] - item.tEntered forStage:stage asRejected:isRejected];
+        if (isRejected || stage + 1 >= CS_FIP_STAGE_COUNT) {
+            numOccupied[stage]--;
+            isDone = YES;
+        }
+        else if (isClosed) {
+            numOccupied[stage]--;
+            isDone    = YES;
+            isAborted = YES;
+        }
+        else {
+            [maWaiting[stage] addObject:item];
+        }
+        [self advanceWaitingItemsWithoutLock];
+    }
+    
+    if (!isDone || !item.completion) {
+        return;
+    }
+    
+    if (isAborted) {
+        NSError *err = nil;
+        [CS_error fillError:&err withCode:CSErrorAborted];
+        item.completion(nil, err);
+    }
+    else {
+        item.completion(isRejected ? nil : item.sm, item.err);
+    }
+}
+
+/*
+ *  Use the header of the message to discard it before doing any expensive work.
+ *  - returns NO if the item should be rejected.
+ */
+-(BOOL) sniffItem:(_S_fip_item *) item
+{
+    RSISecureMessageIdentification *smi = [RealSecureImage quickPackedContentIdentification:item.dPacked];
+    if (smi.willNeverMatch || (smi.message && !smi.message.sealId)) {
+        return NO;
+    }
+    
+    if (smi.message.hash && [ChatSeal isPackedMessageHashCurrentlyKnown:smi.message.hash]) {
+        NSError *err = nil;
+        [CS_error fillError:&err withCode:CSErrorMessageExists];
+        item.err = err;
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ *  Extract all the encrypted content from the image.
+ *  - returns NO if the item should be rejected.
+ */
+-(BOOL) unpackItem:(_S_fip_item *) item
+{
+    NSError *err       = nil;
+    NSData *dEncrypted = [RealSecureImage unpackData:item.dPacked withMaxLength:0 andError:&err];
+    item.dPacked       = nil;
+    if (!dEncrypted) {
+        item.err = err;
+        return NO;
+    }
+    item.dEncrypted = dEncrypted;
+    return YES;
+}
+
+/*
+ *  Identify the seal for the message and decrypt it.
+ *  - returns NO if the item should be rejected.
+ */
+-(BOOL) identifyItem:(_S_fip_item *) item
+{
+    NSError *err         = nil;
+    RSISecureMessage *sm = [RealSecureImage identifyEncryptedContent:item.dEncrypted withFullDecryption:YES andError:&err];
+    item.dEncrypted      = nil;
+    if (!sm || !sm.sealId || !sm.dMessage || !sm.hash) {
+        item.err = err;
+        return NO;
+    }
+    item.sm = sm;
+    return YES;
+}
+@end
+
+/*************************
+ _S_fip_item
+ *************************/
+@implementation _S_fip_item
+@synthesize tag;
+@synthesize dPacked;
+@synthesize dEncrypted;
+@synthesize sm;
+@synthesize err;
+@synthesize completion;
+@synthesize tEntered;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [tag release];
+    tag = nil;
+    
+    [dPacked release];
+    dPacked = nil;
+    
+    [dEncrypted release];
+    dEncrypted = nil;
+    
+    [sm release];
+    sm = nil;
+    
+    [err release];
+    err = nil;
+    
+    [completion release];
+    completion = nil;
+    
+    [super dealloc];
+}
+@end
@@ -12,6 +12,7 @@
 #import "CS_feedTypeTwitter.h"
 #import "CS_twitterFeed.h"
 #import "CS_centralNetworkThrottle.h"
+#import "CS_feedImagePipeline.h"
 #import "CS_feedCollectorUtil.h"
 #import "CS_netFeedAPI.h"
 #import "CS_netThrottledAPIFactory.h"
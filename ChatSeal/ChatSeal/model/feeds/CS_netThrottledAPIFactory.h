@@ -8,11 +8,14 @@
 
 #import <Foundation/Foundation.h>
 #import "CS_centralNetworkThrottle.h"
+#import "CS_netTokenScheduler.h"
 
 // NOTE:  The intent is that custom types generate one of these on request, but the feeds
 //        never have to explicitly manage them.  The base class for the feed will take
 //        care of the lifetime of this factory.
 @class CS_netFeedAPI;
+typedef CS_netFeedAPI *(^CS_netThrottledAPIGeneratorBlock)(BOOL *wasThrottled);
+typedef void (^CS_netThrottledAPIScheduledBlock)(CS_netFeedAPI *api);
 @interface CS_netThrottledAPIFactory : NSObject
 -(id) initWithNetworkThrottle:(CS_centralNetworkThrottle *) throttle;
 -(BOOL) hasStatsFileDefined;
@@ -25,9 +28,13 @@
 -(BOOL) hasCapacityForAPIByName:(NSString *) name withEvenDistribution:(BOOL) evenlyDistributed andAllowAnyCategory:(BOOL) allowAny;
 -(void) throttleAPIForOneCycle:(CS_netFeedAPI *) api;
 -(void) reconfigureThrottleForAPIByName:(NSString *) name toLimit:(NSUInteger) limit andRemaining:(NSUInteger) numRemaining;
+-(id) scheduleAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio usingGenerator:(CS_netThrottledAPIGeneratorBlock) generator
+           andCompletion:(CS_netThrottledAPIScheduledBlock) completion;
+-(void) cancelScheduledAPI:(id) scheduled;
 
 // - feed types will use this API to define all their throttle limits.
 -(void) setThrottleLimitAdjustmentPercentage:(float) pct;
+-(void) setSchedulerAccount:(NSString *) account;
 -(void) addAPIThrottleDefinitionForClass:(Class) c inCategory:(cs_cnt_throttle_category_t) category withLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval;
 -(void) addAPIThrottleDefinitionForClass:(Class) c inCategory:(cs_cnt_throttle_category_t) category withConcurrentLimit:(NSUInteger) limit;
 @end
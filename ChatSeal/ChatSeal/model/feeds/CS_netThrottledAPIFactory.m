@@ -26,6 +26,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
 @interface CS_netThrottledAPIFactory (internal) <CS_netFeedCreatorDelegateAPI>
 -(BOOL) checkIfOpenWithError:(NSError **) err;
 -(BOOL) saveThrottleStatsWithError:(NSError **) err;
+-(void) registerSchedulerEndpoints;
 @end
 
 // - for storing a single definition
@@ -38,6 +39,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
 -(void) accountForAPIDestruction;
 -(void) artificiallyThrottleForOneCycle;
 -(void) reconfigureThrottleToLimit:(NSUInteger) limit andRemaining:(NSUInteger) numRemaining;
+-(NSUInteger) numberOfRequestsInInterval;
 @property (nonatomic, retain) NSString *className;
 @property (nonatomic, assign) cs_cnt_throttle_category_t throttleCategory;
 @property (nonatomic, assign) cs_cnt_throttle_category_t centralThrottleCategory;
@@ -60,6 +62,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
     CS_centralNetworkThrottle       *netThrottle;
     float                           fLimitAdjustmentPct;
     CS_netFeedCreatorDelegateHandle *creatorHandle;
+    NSString                        *sSchedulerAccount;
 }
 
 /*
@@ -79,6 +82,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
         netThrottle         = [throttle retain];
         fLimitAdjustmentPct = 1.0f;
         creatorHandle       = [[CS_netFeedCreatorDelegateHandle alloc] initWithCreatorDelegate:self];
+        sSchedulerAccount   = [[NSString alloc] initWithFormat:@"ntaf-%p", self];
     }
     return self;
 }
@@ -101,6 +105,10 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
     [uThrottleFile release];
     uThrottleFile = nil;
     
+    [[netThrottle tokenScheduler] removeAccount:sSchedulerAccount];
+    [sSchedulerAccount release];
+    sSchedulerAccount = nil;
+    
     [netThrottle release];
     netThrottle = nil;
     
@@ -179,6 +187,23 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
     fLimitAdjustmentPct = pct;
 }
 
+/*
+ *  The factory represents a single account in the central token scheduler, which should be assigned a stable
+ *  name so that the scheduler's per-account buckets survive re-creation of the factory.
+ */
+-(void) setSchedulerAccount:(NSString *) account
+{
+    // - this should only be done before the object has been opened for the first time.
+    @synchronized (self) {
+        if (isOpen || !account) {
+            return;
+        }
+        
+        [sSchedulerAccount release];
+        sSchedulerAccount = [account retain];
+    }
+}
+
 /*
  *  Creators of the factory will define limits for each type of class that is managed.
  */
@@ -403,6 +428,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
      
         // - and force it to throttle itself.
         [def artificiallyThrottleForOneCycle];
+        [[netThrottle tokenScheduler] drainEndpoint:sName inAccount:sSchedulerAccount];
         [self saveThrottleStatsWithError:nil];
     }
 }
@@ -426,7 +452,67 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
         
         // - I'm not saving anything here because these limits will be re-retrieved later.
         [def reconfigureThrottleToLimit:limit andRemaining:numRemaining];
+        
+        // - the scheduler should see the same picture.
+        if (![def isConcurrentThrottled]) {
+            NSUInteger adjustedLimit = MAX((NSUInteger) ((float) def.throttleLimit * fLimitAdjustmentPct), 1);
+            NSUInteger numUsed       = [def numberOfRequestsInInterval];
+            [[netThrottle tokenScheduler] setAvailableTokens:(numUsed < adjustedLimit) ? (double) (adjustedLimit - numUsed) : 0.0
+                                                 forEndpoint:name inAccount:sSchedulerAccount];
+        }
+    }
+}
+
+/*
+ *  Queue a request for an API instead of failing when it is throttled.
+ *  - the completion block is executed once the central scheduler finds tokens for the API, its account and its category, which may
+ *    be immediately, on an arbitrary thread.
+ *  - when a generator is provided, it is used to create the API, which allows the feed to apply its own checks.
+ *  - the returned handle can be used to cancel the request while it is queued.
+ */
+-(id) scheduleAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio usingGenerator:(CS_netThrottledAPIGeneratorBlock) generator
+           andCompletion:(CS_netThrottledAPIScheduledBlock) completion
+{
+    CS_netTokenScheduler *nts = [netThrottle tokenScheduler];
+    NSString *sAccount        = nil;
+    @synchronized (self) {
+        if (!nts || ![self checkIfOpenWithError:nil] || ![mdDefinitions objectForKey:name]) {
+            return nil;
+        }
+        sAccount = [[sSchedulerAccount retain] autorelease];
     }
+    
+    // - the admission check keeps the request queued while the central throttle's concurrency limits or the
+    //   persisted history disagree with the scheduler.
+    return [nts scheduleRequestForEndpoint:name inAccount:sAccount withPriority:prio andAdmission:^BOOL(void) {
+        return [self hasCapacityForAPIByName:name withEvenDistribution:NO andAllowAnyCategory:NO];
+    } andDispatch:^BOOL(void) {
+        BOOL wasThrottled  = NO;
+        CS_netFeedAPI *api = nil;
+        if (generator) {
+            api = generator(&wasThrottled);
+        }
+        else {
+            api = [self apiForName:name andReturnWasThrottled:&wasThrottled withError:nil];
+        }
+        
+        // - a throttled result is retried later, but a failure is final.
+        if (!api && wasThrottled) {
+            return NO;
+        }
+        if (completion) {
+            completion(api);
+        }
+        return YES;
+    }];
+}
+
+/*
+ *  Cancel a request created with scheduleAPIForName.
+ */
+-(void) cancelScheduledAPI:(id) scheduled
+{
+    [[netThrottle tokenScheduler] cancelRequest:scheduled];
 }
 
 @end
@@ -468,6 +554,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
             if (![ChatSeal isLowStorageAConcern]) {
                 NSLog(@"CS: Throttle stats access interrupted, allowing overwrite.  (%@)", (err && *err) ? [*err localizedDescription] : @"");
                 isOpen = YES;
+                [self registerSchedulerEndpoints];
                 return YES;
             }
             
@@ -501,6 +588,7 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
         }
     }
     isOpen = YES;
+    [self registerSchedulerEndpoints];
     return YES;
 }
 
@@ -519,6 +607,39 @@ static NSString *CS_NTAF_STATS_REQUEST_DATES           = @"reqd";
     return [CS_feedCollectorUtil secureSaveConfiguration:mdThrottleData asFile:uThrottleFile withError:err];
 }
 
+/*
+ *  Describe every rate-limited API to the central scheduler as an endpoint in this factory's account, seeded with
+ *  the capacity left over from the persisted history.
+ *  - ASSUMES the lock is held.
+ *  - concurrently-limited APIs are not rate-limited so they rely only on the admission check when scheduled.
+ */
+-(void) registerSchedulerEndpoints
+{
+    CS_netTokenScheduler *nts = [netThrottle tokenScheduler];
+    if (!nts) {
+        return;
+    }
+    
+    for (NSString *sName in mdDefinitions.allKeys) {
+        _S_throttle_definition *def = [mdDefinitions objectForKey:sName];
+        if ([def isConcurrentThrottled]) {
+            [nts setLimit:0 perInterval:0.0 withBurst:0 forEndpoint:sName inAccount:sSchedulerAccount andCategory:def.centralThrottleCategory];
+            continue;
+        }
+        
+        // - the burst is kept small so that the scheduler paces requests across the interval instead of spending the entire
+        //   allotment up front and starving later.
+        NSUInteger adjustedLimit = MAX((NSUInteger) ((float) def.throttleLimit * fLimitAdjustmentPct), 1);
+        NSUInteger burst         = MAX(adjustedLimit / 10, 1);
+        [nts setLimit:adjustedLimit perInterval:def.throttleInterval withBurst:burst forEndpoint:sName inAccount:sSchedulerAccount andCategory:def.centralThrottleCategory];
+        
+        NSUInteger numUsed = [def numberOfRequestsInInterval];
+        if (numUsed) {
+            [nts setAvailableTokens:(numUsed < adjustedLimit) ? (double) (adjustedLimit - numUsed) : 0.0 forEndpoint:sName inAccount:sSchedulerAccount];
+        }
+    }
+}
+
 /*
  *  The creator handle that accompanies every API object will execute this delegate method implicitly
  *  whenever an API is about to be deallocated so that we can unaccount for it.
@@ -820,6 +941,25 @@ static NSString *PSNT_THRDEF_STATS_KEY    = @"throttleStats";
     }
 }
 
+/*
+ *  Return the number of requests that have been issued inside the current interval.
+ */
+-(NSUInteger) numberOfRequestsInInterval
+{
+    if ([self isConcurrentThrottled]) {
+        return numConcurrentAPIs;
+    }
+    
+    int32_t tOldest = [self currentTimeAsInterval] - (int32_t) throttleInterval;
+    NSUInteger ret  = 0;
+    for (NSNumber *n in maRateLimitedAPIs) {
+        if (n.intValue >= (int) tOldest) {
+            ret++;
+        }
+    }
+    return ret;
+}
+
 /*
  *  Reconfigure this definition to new limits.
  */
@@ -0,0 +1,66 @@
+//
+//  CS_netTokenScheduler.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 7/14/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "CS_centralNetworkThrottle.h"
+
+// - the token scheduler is a hierarchy of token buckets organized as category -> account -> endpoint where
+//   a request may only be dispatched when every bucket along its path has a token available.
+// - requests that cannot be started immediately are not refused, but queued by priority and re-examined when the
+//   hashed timer wheel indicates that one of their buckets will have refilled.
+typedef enum {
+    CS_NTS_PRIORITY_HIGH       = 0,     //  - user-visible work
+    CS_NTS_PRIORITY_NORMAL     = 1,
+    CS_NTS_PRIORITY_BACKGROUND = 2,     //  - mining and other speculative activity
+
+    CS_NTS_PRIORITY_COUNT
+} cs_nts_priority_t;
+
+// - the clock is abstracted so that the scheduler can be driven deterministically when testing.
+@protocol CS_netTokenSchedulerClock <NSObject>
+-(NSTimeInterval) currentTime;
+@end
+
+// - the admission block is consulted before tokens are consumed to allow external limits (like the
+//   central throttle's concurrency) to hold the request in the queue.
+// - the dispatch block returns NO when the request could not be issued after all, which refunds its tokens
+//   and keeps it queued for a later attempt.
+typedef BOOL (^cs_nts_admission_block_t)(void);
+typedef BOOL (^cs_nts_dispatch_block_t)(void);
+
+@interface CS_netTokenSchedulerStats : NSObject
+@property (nonatomic, assign) NSUInteger numDispatched;
+@property (nonatomic, assign) NSUInteger numQueued;
+@property (nonatomic, assign) NSUInteger numRetried;
+@property (nonatomic, assign) NSUInteger numWakeups;
+@property (nonatomic, assign) NSTimeInterval avgLatency;
+@property (nonatomic, assign) NSTimeInterval maxLatency;
+@end
+
+@interface CS_netTokenScheduler : NSObject
+-(id) initWithClock:(id<CS_netTokenSchedulerClock>) clock;
+-(void) close;
+-(void) setMaximumQueueDepth:(NSUInteger) maxDepth;
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forCategory:(cs_cnt_throttle_category_t) cat;
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forAccount:(NSString *) account;
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forEndpoint:(NSString *) endpoint
+       inAccount:(NSString *) account andCategory:(cs_cnt_throttle_category_t) cat;
+-(void) setAvailableTokens:(double) tokens forEndpoint:(NSString *) endpoint inAccount:(NSString *) account;
+-(void) drainEndpoint:(NSString *) endpoint inAccount:(NSString *) account;
+-(void) removeAccount:(NSString *) account;
+-(BOOL) hasTokenForEndpoint:(NSString *) endpoint inAccount:(NSString *) account;
+-(id) scheduleRequestForEndpoint:(NSString *) endpoint inAccount:(NSString *) account withPriority:(cs_nts_priority_t) prio
+                    andAdmission:(cs_nts_admission_block_t) admission andDispatch:(cs_nts_dispatch_block_t) dispatch;
+-(void) cancelRequest:(id) request;
+-(NSUInteger) processPendingRequests;
+-(NSUInteger) advanceToTime:(NSTimeInterval) tNow;
+-(NSTimeInterval) nextWakeupTime;
+-(NSUInteger) numberOfQueuedRequests;
+-(CS_netTokenSchedulerStats *) statistics;
+-(void) resetStatistics;
+@end
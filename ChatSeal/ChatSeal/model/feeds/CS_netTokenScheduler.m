@@ -0,0 +1,1076 @@
+//
+//  CS_netTokenScheduler.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 7/14/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_netTokenScheduler.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - the admission and dispatch blocks are ALWAYS executed outside the lock because they will generally call back
+//    into the API factory and the central throttle, which have their own locks that may call into this object.
+//  - when the system clock is used, wakeups are driven by a timer on the main run loop that only exists while
+//    there is something in the timer wheel.
+
+// - constants
+static const NSTimeInterval CS_NTS_WHEEL_TICK     = 0.1f;
+static const NSUInteger     CS_NTS_WHEEL_SLOTS    = 512;            //  ~51 seconds per revolution, longer waits use multiple rounds.
+static const double         CS_NTS_WHEEL_EPSILON  = 0.000001;       //  to keep tick boundaries stable in floating point.
+static const NSTimeInterval CS_NTS_RETRY_DELAY    = 1.0f;           //  when an external constraint holds a request.
+static const NSUInteger     CS_NTS_STD_QUEUE_MAX  = 1024;
+
+// - forward declarations
+@interface CS_netTokenScheduler (internal)
+-(NSTimeInterval) currentTime;
+-(NSArray *) bucketPathForRequestWithoutLock:(id) req;
+-(void) armWakeupAtTime:(NSTimeInterval) t;
+-(void) armWakeupAtTime:(NSTimeInterval) t forBucket:(id) bucket;
+-(void) requeueRequestWithoutLock:(id) req;
+-(void) timerFired;
+-(void) installTimerIfNecessary;
+@end
+
+// - a single token bucket, which may be shared by many requests.
+@interface _S_nts_bucket : NSObject
++(_S_nts_bucket *) bucketWithLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval andBurst:(NSUInteger) burst atTime:(NSTimeInterval) t;
+-(void) reconfigureWithLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval andBurst:(NSUInteger) burst atTime:(NSTimeInterval) t;
+-(BOOL) hasTokenAtTime:(NSTimeInterval) t;
+-(NSTimeInterval) timeUntilTokenAtTime:(NSTimeInterval) t;
+-(void) consumeToken;
+-(void) refundToken;
+-(void) setAvailableTokens:(double) tokens atTime:(NSTimeInterval) t;
+@property (nonatomic, assign) NSTimeInterval tArmedWakeup;
+@end
+
+// - endpoints are buckets that remember where they fit in the hierarchy.
+@interface _S_nts_endpoint : NSObject
+@property (nonatomic, retain) _S_nts_bucket *bucket;
+@property (nonatomic, retain) NSString *account;
+@property (nonatomic, assign) cs_cnt_throttle_category_t category;
+@end
+
+// - a request waiting for its chance to run.
+@interface _S_nts_request : NSObject
+@property (nonatomic, retain) NSString *endpointKey;
+@property (nonatomic, retain) NSString *account;
+@property (nonatomic, assign) cs_nts_priority_t priority;
+@property (nonatomic, copy) cs_nts_admission_block_t admissionBlock;
+@property (nonatomic, copy) cs_nts_dispatch_block_t dispatchBlock;
+@property (nonatomic, assign) NSTimeInterval tSubmitted;
+@property (nonatomic, assign) uint64_t sequence;
+@property (nonatomic, retain) NSArray *reservedPath;
+@end
+
+// - the hashed timer wheel stores only wakeup ticks because the scheduler re-evaluates its queues
+//   on every wakeup anyway.
+@interface _S_nts_timer_wheel : NSObject
+-(id) initWithTick:(NSTimeInterval) tick andSlots:(NSUInteger) slots startingAtTime:(NSTimeInterval) t;
+-(void) addDeadline:(NSTimeInterval) t;
+-(NSUInteger) expireThroughTime:(NSTimeInterval) t;
+-(NSTimeInterval) earliestDeadline;
+-(NSUInteger) count;
+@end
+
+// - when no clock is provided, we use the system.
+@interface _S_nts_system_clock : NSObject <CS_netTokenSchedulerClock>
+@end
+
+/******************************
+ CS_netTokenSchedulerStats
+ ******************************/
+@implementation CS_netTokenSchedulerStats
+@synthesize numDispatched;
+@synthesize numQueued;
+@synthesize numRetried;
+@synthesize numWakeups;
+@synthesize avgLatency;
+@synthesize maxLatency;
+@end
+
+/******************************
+ CS_netTokenScheduler
+ ******************************/
+@implementation CS_netTokenScheduler
+/*
+ *  Object attributes.
+ */
+{
+    id<CS_netTokenSchedulerClock> clock;
+    BOOL                          isSystemClock;
+    BOOL                          isClosed;
+    _S_nts_bucket                 *categoryBuckets[CS_CNT_THROTTLE_COUNT];
+    NSMutableDictionary           *mdAccounts;
+    NSMutableDictionary           *mdEndpoints;
+    NSMutableArray                *maQueues[CS_NTS_PRIORITY_COUNT];
+    NSUInteger                    maxQueueDepth;
+    uint64_t                      nextSequence;
+    _S_nts_timer_wheel            *timerWheel;
+    NSTimer                       *tmWakeup;
+    BOOL                          isTimerPending;
+    NSUInteger                    numDispatched;
+    NSUInteger                    numRetried;
+    NSUInteger                    numWakeups;
+    NSTimeInterval                totalLatency;
+    NSTimeInterval                maxLatency;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    return [self initWithClock:nil];
+}
+
+/*
+ *  Initialize the object.
+ *  - when the clock is nil, the system time is used.
+ */
+-(id) initWithClock:(id<CS_netTokenSchedulerClock>) c
+{
+    self = [super init];
+    if (self) {
+        if (c) {
+            clock         = [c retain];
+            isSystemClock = NO;
+        }
+        else {
+            clock         = [[_S_nts_system_clock alloc] init];
+            isSystemClock = YES;
+        }
+        isClosed = NO;
+        for (NSUInteger i = 0; i < CS_CNT_THROTTLE_COUNT; i++) {
+            categoryBuckets[i] = nil;
+        }
+        mdAccounts  = [[NSMutableDictionary alloc] init];
+        mdEndpoints = [[NSMutableDictionary alloc] init];
+        for (NSUInteger i = 0; i < CS_NTS_PRIORITY_COUNT; i++) {
+            maQueues[i] = [[NSMutableArray alloc] init];
+        }
+        maxQueueDepth  = CS_NTS_STD_QUEUE_MAX;
+        nextSequence   = 0;
+        timerWheel     = [[_S_nts_timer_wheel alloc] initWithTick:CS_NTS_WHEEL_TICK andSlots:CS_NTS_WHEEL_SLOTS startingAtTime:[clock currentTime]];
+        tmWakeup       = nil;
+        isTimerPending = NO;
+        [self resetStatistics];
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [self close];
+    
+    for (NSUInteger i = 0; i < CS_CNT_THROTTLE_COUNT; i++) {
+        [categoryBuckets[i] release];
+        categoryBuckets[i] = nil;
+    }
+    
+    [mdAccounts release];
+    mdAccounts = nil;
+    
+    [mdEndpoints release];
+    mdEndpoints = nil;
+    
+    for (NSUInteger i = 0; i < CS_NTS_PRIORITY_COUNT; i++) {
+        [maQueues[i] release];
+        maQueues[i] = nil;
+    }
+    
+    [timerWheel release];
+    timerWheel = nil;
+    
+    [clock release];
+    clock = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Stop the scheduler and discard anything that is still queued.
+ *  - this must be called when using the system clock because the wakeup timer retains this object.
+ */
+-(void) close
+{
+    NSTimer *tmToInvalidate = nil;
+    @synchronized (self) {
+        isClosed = YES;
+        for (NSUInteger i = 0; i < CS_NTS_PRIORITY_COUNT; i++) {
+            [maQueues[i] removeAllObjects];
+        }
+        tmToInvalidate = tmWakeup;
+        tmWakeup       = nil;
+    }
+    
+    // - timers must be invalidated on the thread that installed them.
+    if (tmToInvalidate) {
+        if ([NSThread isMainThread]) {
+            [tmToInvalidate invalidate];
+            [tmToInvalidate release];
+        }
+        else {
+            [[NSOperationQueue mainQueue] addOperationWithBlock:^(void) {
+                [tmToInvalidate invalidate];
+                [tmToInvalidate release];
+            }];
+        }
+    }
+}
+
+/*
+ *  Limit the number of requests we'll hold before we begin refusing them, which should
+ *  be very rare but is intended to keep a misbehaving feed from accumulating work forever.
+ */
+-(void) setMaximumQueueDepth:(NSUInteger) maxDepth
+{
+    @synchronized (self) {
+        maxQueueDepth = maxDepth;
+    }
+}
+
+/*
+ *  Assign limits to an entire category, which is at the top of the hierarchy.
+ *  - a limit of zero means that the category is not rate-limited.
+ */
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forCategory:(cs_cnt_throttle_category_t) cat
+{
+    if (cat >= CS_CNT_THROTTLE_COUNT) {
+        return;
+    }
+    
+    @synchronized (self) {
+        if (!limit) {
+            [categoryBuckets[cat] release];
+            categoryBuckets[cat] = nil;
+            return;
+        }
+        
+        if (categoryBuckets[cat]) {
+            [categoryBuckets[cat] reconfigureWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]];
+        }
+        else {
+            categoryBuckets[cat] = [[_S_nts_bucket bucketWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]] retain];
+        }
+    }
+}
+
+/*
+ *  Assign limits to a single account.
+ *  - a limit of zero means that the account is not rate-limited.
+ */
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forAccount:(NSString *) account
+{
+    if (!account) {
+        return;
+    }
+    
+    @synchronized (self) {
+        if (!limit) {
+            [mdAccounts setObject:[NSNull null] forKey:account];
+            return;
+        }
+        
+        _S_nts_bucket *bucket = [mdAccounts objectForKey:account];
+        if ([bucket isKindOfClass:[_S_nts_bucket class]]) {
+            [bucket reconfigureWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]];
+        }
+        else {
+            [mdAccounts setObject:[_S_nts_bucket bucketWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]] forKey:account];
+        }
+    }
+}
+
+/*
+ *  Assign limits to a single endpoint inside an account.
+ *  - NOTE: the bucket is sized so that no more than 'limit' requests can ever be issued inside any
+ *          window of 'interval' seconds, which is the way the services define their limits.
+ */
+-(void) setLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval withBurst:(NSUInteger) burst forEndpoint:(NSString *) endpoint
+       inAccount:(NSString *) account andCategory:(cs_cnt_throttle_category_t) cat
+{
+    if (!endpoint || !account || cat >= CS_CNT_THROTTLE_COUNT) {
+        return;
+    }
+    
+    @synchronized (self) {
+        // - the account is implicitly created without limits if it doesn't exist yet.
+        if (![mdAccounts objectForKey:account]) {
+            [mdAccounts setObject:[NSNull null] forKey:account];
+        }
+        
+        NSString *sKey          = [NSString stringWithFormat:@"%@/%@", account, endpoint];
+        _S_nts_endpoint *ep     = [mdEndpoints objectForKey:sKey];
+        if (!ep) {
+            ep         = [[[_S_nts_endpoint alloc] init] autorelease];
+            ep.account = account;
+            [mdEndpoints setObject:ep forKey:sKey];
+        }
+        ep.category = cat;
+        if (limit) {
+            if (ep.bucket) {
+                [ep.bucket reconfigureWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]];
+            }
+            else {
+                ep.bucket = [_S_nts_bucket bucketWithLimit:limit perInterval:interval andBurst:burst atTime:[self currentTime]];
+            }
+        }
+        else {
+            ep.bucket = nil;
+        }
+    }
+}
+
+/*
+ *  When there is better data about what is left in an endpoint (persisted history or a response from
+ *  the service), this will adjust its bucket.
+ */
+-(void) setAvailableTokens:(double) tokens forEndpoint:(NSString *) endpoint inAccount:(NSString *) account
+{
+    @synchronized (self) {
+        _S_nts_endpoint *ep = [mdEndpoints objectForKey:[NSString stringWithFormat:@"%@/%@", account, endpoint]];
+        [ep.bucket setAvailableTokens:tokens atTime:[self currentTime]];
+    }
+}
+
+/*
+ *  Empty the endpoint's bucket, usually because the service pushed back.
+ */
+-(void) drainEndpoint:(NSString *) endpoint inAccount:(NSString *) account
+{
+    [self setAvailableTokens:0.0 forEndpoint:endpoint inAccount:account];
+}
+
+/*
+ *  Discard an account and everything queued against it.
+ */
+-(void) removeAccount:(NSString *) account
+{
+    if (!account) {
+        return;
+    }
+    
+    @synchronized (self) {
+        [mdAccounts removeObjectForKey:account];
+        for (NSString *sKey in mdEndpoints.allKeys) {
+            _S_nts_endpoint *ep = [mdEndpoints objectForKey:sKey];
+            if ([ep.account isEqualToString:account]) {
+                [mdEndpoints removeObjectForKey:sKey];
+            }
+        }
+        
+        for (NSUInteger i = 0; i < CS_NTS_PRIORITY_COUNT; i++) {
+            NSMutableIndexSet *mis = [NSMutableIndexSet indexSet];
+            for (NSUInteger j = 0; j < [maQueues[i] count]; j++) {
+                _S_nts_request *req = [maQueues[i] objectAtIndex:j];
+                if ([req.account isEqualToString:account]) {
+                    [mis addIndex:j];
+                }
+            }
+            [maQueues[i] removeObjectsAtIndexes:mis];
+        }
+    }
+}
+
+/*
+ *  A quick check of whether a request to the endpoint could be dispatched right now.
+ */
+-(BOOL) hasTokenForEndpoint:(NSString *) endpoint inAccount:(NSString *) account
+{
+    @synchronized (self) {
+        _S_nts_request *req = [[[_S_nts_request alloc] init] autorelease];
+        req.endpointKey     = [NSString stringWithFormat:@"%@/%@", account, endpoint];
+        req.account         = account;
+        NSArray *arrPath    = [self bucketPathForRequestWithoutLock:req];
+        if (!arrPath) {
+            return NO;
+        }
+        
+        NSTimeInterval tNow = [self currentTime];
+        for (_S_nts_bucket *bucket in arrPath) {
+            if (![bucket hasTokenAtTime:tNow]) {
+                return NO;
+            }
+        }
+    }
+    return YES;
+}
+
+/*
+ *  Queue a request for the given endpoint and try to start it right away.
+ *  - the returned handle can be used to cancel the request before it is dispatched.
+ *  - this only returns nil when the endpoint is unknown or the queue is full.
+ */
+-(id) scheduleRequestForEndpoint:(NSString *) endpoint inAccount:(NSString *) account withPriority:(cs_nts_priority_t) prio
+                    andAdmission:(cs_nts_admission_block_t) admission andDispatch:(cs_nts_dispatch_block_t) dispatch
+{
+    if (!endpoint || !account || !dispatch) {
+        return nil;
+    }
+    
+    if (prio >= CS_NTS_PRIORITY_COUNT) {
+        prio = CS_NTS_PRIORITY_BACKGROUND;
+    }
+    
+    _S_nts_request *req = nil;
+    @synchronized (self) {
+        if (isClosed) {
+            return nil;
+        }
+        
+        if ([self numberOfQueuedRequests] >= maxQueueDepth) {
+            NSLog(@"CS-ALERT: The network token scheduler queue is full.");
+            return nil;
+        }
+        
+        req                = [[[_S_nts_request alloc] init] autorelease];
+        req.endpointKey    = [NSString stringWithFormat:@"%@/%@", account, endpoint];
+        req.account        = account;
+        req.priority       = prio;
+        req.admissionBlock = admission;
+        req.dispatchBlock  = dispatch;
+        req.tSubmitted     = [self currentTime];
+        req.sequence       = nextSequence++;
+        if (![self bucketPathForRequestWithoutLock:req]) {
+            NSLog(@"CS-ALERT: Unknown scheduler endpoint %@.", req.endpointKey);
+            return nil;
+        }
+        [maQueues[prio] addObject:req];
+    }
+    
+    [self processPendingRequests];
+    return req;
+}
+
+/*
+ *  Remove a request from the queue if it hasn't started yet.
+ */
+-(void) cancelRequest:(id) request
+{
+    if (![request isKindOfClass:[_S_nts_request class]]) {
+        return;
+    }
+    
+    @synchronized (self) {
+        _S_nts_request *req = (_S_nts_request *) request;
+        [maQueues[req.priority] removeObjectIdenticalTo:req];
+    }
+}
+
+/*
+ *  Walk the queues in priority order and dispatch everything that has tokens along its path.
+ *  - a blocked request never blocks those behind it that use different buckets.
+ *  - returns the number of requests dispatched.
+ */
+-(NSUInteger) processPendingRequests
+{
+    NSMutableArray *maCandidates = [NSMutableArray array];
+    @synchronized (self) {
+        if (isClosed) {
+            return 0;
+        }
+        
+        NSTimeInterval tNow = [self currentTime];
+        for (NSUInteger prio = 0; prio < CS_NTS_PRIORITY_COUNT; prio++) {
+            NSMutableIndexSet *misReserved = [NSMutableIndexSet indexSet];
+            for (NSUInteger i = 0; i < [maQueues[prio] count]; i++) {
+                _S_nts_request *req = [maQueues[prio] objectAtIndex:i];
+                NSArray *arrPath    = [self bucketPathForRequestWithoutLock:req];
+                if (!arrPath) {
+                    // - the endpoint was removed out from under the request.
+                    [misReserved addIndex:i];
+                    continue;
+                }
+                
+                // - every bucket along the path must have a token, but if one doesn't, we know exactly
+                //   how long to wait for the request to become viable.
+                NSTimeInterval tWait         = 0.0;
+                _S_nts_bucket *bucketBlocked = nil;
+                for (_S_nts_bucket *bucket in arrPath) {
+                    NSTimeInterval tBucket = [bucket timeUntilTokenAtTime:tNow];
+                    if (tBucket > tWait) {
+                        tWait         = tBucket;
+                        bucketBlocked = bucket;
+                    }
+                }
+                
+                // - all the requests held by the same bucket share its refill deadline, so only one wakeup is needed for them.
+                if (tWait > 0.0) {
+                    [self armWakeupAtTime:tNow + tWait forBucket:bucketBlocked];
+                    continue;
+                }
+                
+                // - reserve the tokens now so that the requests behind this one see an accurate picture.
+                for (_S_nts_bucket *bucket in arrPath) {
+                    [bucket consumeToken];
+                }
+                req.reservedPath = arrPath;
+                [maCandidates addObject:req];
+                [misReserved addIndex:i];
+            }
+            [maQueues[prio] removeObjectsAtIndexes:misReserved];
+        }
+    }
+    
+    // - the admission and dispatch checks must happen outside the lock.
+    NSUInteger numStarted = 0;
+    for (_S_nts_request *req in maCandidates) {
+        if (!req.reservedPath) {
+            continue;
+        }
+        
+        BOOL started = NO;
+        if (!req.admissionBlock || req.admissionBlock()) {
+            started = req.dispatchBlock();
+        }
+        
+        @synchronized (self) {
+            if (started) {
+                NSTimeInterval tLatency = [self currentTime] - req.tSubmitted;
+                totalLatency           += tLatency;
+                maxLatency              = MAX(maxLatency, tLatency);
+                numDispatched++;
+                numStarted++;
+                req.reservedPath        = nil;
+            }
+            else {
+                // - give the tokens back and try again a bit later because something outside
+                //   the scheduler is holding the request.
+                for (_S_nts_bucket *bucket in req.reservedPath) {
+                    [bucket refundToken];
+                }
+                req.reservedPath = nil;
+                numRetried++;
+                if (!isClosed) {
+                    [self requeueRequestWithoutLock:req];
+                    [self armWakeupAtTime:[self currentTime] + CS_NTS_RETRY_DELAY];
+                }
+            }
+        }
+    }
+    return numStarted;
+}
+
+/*
+ *  Move the timer wheel forward and re-evaluate the queues if any wakeups expired.
+ *  - this is called implicitly when using the system clock, but must be called explicitly with a simulated clock.
+ */
+-(NSUInteger) advanceToTime:(NSTimeInterval) tNow
+{
+    NSUInteger numExpired = 0;
+    @synchronized (self) {
+        numExpired  = [timerWheel expireThroughTime:tNow];
+        numWakeups += numExpired;
+    }
+    
+    if (numExpired) {
+        return [self processPendingRequests];
+    }
+    return 0;
+}
+
+/*
+ *  Return the time of the next wakeup or a negative value if nothing is waiting.
+ */
+-(NSTimeInterval) nextWakeupTime
+{
+    @synchronized (self) {
+        return [timerWheel earliestDeadline];
+    }
+}
+
+/*
+ *  Return the number of requests that haven't been dispatched.
+ */
+-(NSUInteger) numberOfQueuedRequests
+{
+    @synchronized (self) {
+        NSUInteger ret = 0;
+        for (NSUInteger i = 0; i < CS_NTS_PRIORITY_COUNT; i++) {
+            ret += [maQueues[i] count];
+        }
+        return ret;
+    }
+}
+
+/*
+ *  Return the statistics about the scheduler's behavior since the last reset.
+ */
+-(CS_netTokenSchedulerStats *) statistics
+{
+    CS_netTokenSchedulerStats *stats = [[[CS_netTokenSchedulerStats alloc] init] autorelease];
+    @synchronized (self) {
+        stats.numDispatched = numDispatched;
+        stats.numQueued     = [self numberOfQueuedRequests];
+        stats.numRetried    = numRetried;
+        stats.numWakeups    = numWakeups;
+        stats.avgLatency    = numDispatched ? (totalLatency / (NSTimeInterval) numDispatched) : 0.0;
+        stats.maxLatency    = maxLatency;
+    }
+    return stats;
+}
+
+/*
+ *  Clear the statistics.
+ */
+-(void) resetStatistics
+{
+    @synchronized (self) {
+        numDispatched = 0;
+        numRetried    = 0;
+        numWakeups    = 0;
+        totalLatency  = 0.0;
+        maxLatency    = 0.0;
+    }
+}
+@end
+
+/*********************************
+ CS_netTokenScheduler (internal)
+ *********************************/
+@implementation CS_netTokenScheduler (internal)
+/*
+ *  Return the current time from our clock.
+ */
+-(NSTimeInterval) currentTime
+{
+    return [clock currentTime];
+}
+
+/*
+ *  Return the buckets that must each supply a token before the request can proceed, in order from
+ *  the endpoint up to the category.
+ *  - ASSUMES the lock is held.
+ */
+-(NSArray *) bucketPathForRequestWithoutLock:(id) req
+{
+    _S_nts_endpoint *ep = [mdEndpoints objectForKey:((_S_nts_request *) req).endpointKey];
+    if (!ep) {
+        return nil;
+    }
+    
+    NSMutableArray *maPath = [NSMutableArray arrayWithCapacity:3];
+    if (ep.bucket) {
+        [maPath addObject:ep.bucket];
+    }
+    
+    NSObject *objAccount = [mdAccounts objectForKey:ep.account];
+    if ([objAccount isKindOfClass:[_S_nts_bucket class]]) {
+        [maPath addObject:objAccount];
+    }
+    
+    if (categoryBuckets[ep.category]) {
+        [maPath addObject:categoryBuckets[ep.category]];
+    }
+    return maPath;
+}
+
+/*
+ *  Make sure the queues are re-examined at the given time.
+ *  - ASSUMES the lock is held.
+ */
+-(void) armWakeupAtTime:(NSTimeInterval) t
+{
+    [timerWheel addDeadline:t];
+    if (isSystemClock) {
+        [self installTimerIfNecessary];
+    }
+}
+
+/*
+ *  Make sure the queues are re-examined when a bucket will have refilled.
+ *  - ASSUMES the lock is held.
+ *  - a bucket only ever has one outstanding wakeup, which is replaced only when the new deadline is earlier
+ *    or the prior one has already passed.
+ */
+-(void) armWakeupAtTime:(NSTimeInterval) t forBucket:(id) bucket
+{
+    _S_nts_bucket *b = (_S_nts_bucket *) bucket;
+    if (b.tArmedWakeup > [self currentTime] && b.tArmedWakeup <= t) {
+        return;
+    }
+    b.tArmedWakeup = t;
+    [self armWakeupAtTime:t];
+}
+
+/*
+ *  Put a request back into its queue in the position it would have occupied originally.
+ *  - ASSUMES the lock is held.
+ */
+-(void) requeueRequestWithoutLock:(id) req
+{
+    _S_nts_request *request = (_S_nts_request *) req;
+    NSMutableArray *maQueue = maQueues[request.priority];
+    NSUInteger pos          = 0;
+    for (; pos < [maQueue count]; pos++) {
+        if (((_S_nts_request *) [maQueue objectAtIndex:pos]).sequence > request.sequence) {
+            break;
+        }
+    }
+    [maQueue insertObject:request atIndex:pos];
+}
+
+/*
+ *  The system timer fired, so advance the wheel.
+ */
+-(void) timerFired
+{
+    [self advanceToTime:[self currentTime]];
+    
+    // - the timer only lives as long as it is useful.
+    @synchronized (self) {
+        if (![timerWheel count] && tmWakeup) {
+            [tmWakeup invalidate];
+            [tmWakeup release];
+            tmWakeup = nil;
+        }
+    }
+}
+
+/*
+ *  When using the system clock, make sure the wheel is being turned.
+ *  - ASSUMES the lock is held.
+ */
+-(void) installTimerIfNecessary
+{
+    if (tmWakeup || isTimerPending || isClosed) {
+        return;
+    }
+    
+    isTimerPending = YES;
+    [[NSOperationQueue mainQueue] addOperationWithBlock:^(void) {
+        @synchronized (self) {
+            isTimerPending = NO;
+            if (tmWakeup || isClosed) {
+                return;
+            }
+            tmWakeup = [[NSTimer timerWithTimeInterval:CS_NTS_WHEEL_TICK target:self selector:@selector(timerFired) userInfo:nil repeats:YES] retain];
+            [[NSRunLoop mainRunLoop] addTimer:tmWakeup forMode:NSRunLoopCommonModes];
+        }
+    }];
+}
+@end
+
+/**************************
+ _S_nts_bucket
+ **************************/
+@implementation _S_nts_bucket
+@synthesize tArmedWakeup;
+
+/*
+ *  Object attributes.
+ */
+{
+    double         capacity;
+    double         refillRate;
+    double         tokens;
+    NSTimeInterval tLastRefill;
+}
+
+/*
+ *  Create a new bucket.
+ */
++(_S_nts_bucket *) bucketWithLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval andBurst:(NSUInteger) burst atTime:(NSTimeInterval) t
+{
+    _S_nts_bucket *bucket = [[[_S_nts_bucket alloc] init] autorelease];
+    [bucket reconfigureWithLimit:limit perInterval:interval andBurst:burst atTime:t];
+    [bucket setAvailableTokens:-1.0 atTime:t];
+    bucket.tArmedWakeup = -1.0;
+    return bucket;
+}
+
+/*
+ *  Change the bucket's limits.
+ *  - the capacity is the burst and the refill rate is what remains of the limit after that burst is accounted-for,
+ *    which guarantees that a full burst followed by steady refill never exceeds the limit inside a single interval.
+ */
+-(void) reconfigureWithLimit:(NSUInteger) limit perInterval:(NSTimeInterval) interval andBurst:(NSUInteger) burst atTime:(NSTimeInterval) t
+{
+    [self hasTokenAtTime:t];
+    if (interval <= 0.0f) {
+        interval = 1.0f;
+    }
+    
+    if (limit > 1) {
+        burst      = MIN(MAX(burst, (NSUInteger) 1), limit - 1);
+        refillRate = (double) (limit - burst) / interval;
+    }
+    else {
+        burst      = 1;
+        refillRate = 1.0 / interval;
+    }
+    capacity = (double) burst;
+    tokens   = MIN(tokens, capacity);
+}
+
+/*
+ *  Bring the bucket up to date.
+ */
+-(void) refillAtTime:(NSTimeInterval) t
+{
+    if (t > tLastRefill) {
+        tokens      = MIN(capacity, tokens + ((t - tLastRefill) * refillRate));
+        tLastRefill = t;
+    }
+}
+
+/*
+ *  Determine if a token is available right now.
+ */
+-(BOOL) hasTokenAtTime:(NSTimeInterval) t
+{
+    [self refillAtTime:t];
+    return (tokens >= 1.0) ? YES : NO;
+}
+
+/*
+ *  Return the number of seconds until the next token will be available.
+ */
+-(NSTimeInterval) timeUntilTokenAtTime:(NSTimeInterval) t
+{
+    if ([self hasTokenAtTime:t]) {
+        return 0.0;
+    }
+    if (refillRate <= 0.0) {
+        return 1.0;
+    }
+    return (1.0 - tokens) / refillRate;
+}
+
+/*
+ *  Take a token from the bucket.
+ */
+-(void) consumeToken
+{
+    tokens -= 1.0;
+}
+
+/*
+ *  Return a token that wasn't used.
+ */
+-(void) refundToken
+{
+    tokens = MIN(capacity, tokens + 1.0);
+}
+
+/*
+ *  Change the number of tokens in the bucket, where a negative value implies a full bucket.
+ */
+-(void) setAvailableTokens:(double) numTokens atTime:(NSTimeInterval) t
+{
+    tLastRefill = t;
+    if (numTokens < 0.0) {
+        tokens = capacity;
+    }
+    else {
+        tokens = MIN(numTokens, capacity);
+    }
+}
+@end
+
+/**************************
+ _S_nts_endpoint
+ **************************/
+@implementation _S_nts_endpoint
+@synthesize bucket;
+@synthesize account;
+@synthesize category;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [bucket release];
+    bucket = nil;
+    
+    [account release];
+    account = nil;
+    
+    [super dealloc];
+}
+@end
+
+/**************************
+ _S_nts_request
+ **************************/
+@implementation _S_nts_request
+@synthesize endpointKey;
+@synthesize account;
+@synthesize priority;
+@synthesize admissionBlock;
+@synthesize dispatchBlock;
+@synthesize tSubmitted;
+@synthesize sequence;
+@synthesize reservedPath;
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [endpointKey release];
+    endpointKey = nil;
+    
+    [account release];
+    account = nil;
+    
+    [admissionBlock release];
+    admissionBlock = nil;
+    
+    [dispatchBlock release];
+    dispatchBlock = nil;
+    
+    [reservedPath release];
+    reservedPath = nil;
+    
+    [super dealloc];
+}
+@end
+
+/**************************
+ _S_nts_timer_wheel
+ **************************/
+@implementation _S_nts_timer_wheel
+/*
+ *  Object attributes.
+ */
+{
+    NSTimeInterval tickInterval;
+    NSUInteger     numSlots;
+    int64_t        curTick;
+    NSMutableArray *maSlots;
+    NSUInteger     numEntries;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithTick:(NSTimeInterval) tick andSlots:(NSUInteger) slots startingAtTime:(NSTimeInterval) t
+{
+    self = [super init];
+    if (self) {
+        tickInterval = tick;
+        numSlots     = MAX(slots, (NSUInteger) 1);
+        curTick      = (int64_t) floor(t / tickInterval);
+        numEntries   = 0;
+        maSlots      = [[NSMutableArray alloc] initWithCapacity:numSlots];
+        for (NSUInteger i = 0; i < numSlots; i++) {
+            [maSlots addObject:[NSMutableArray array]];
+        }
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [maSlots release];
+    maSlots = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Add a new deadline to the wheel.
+ *  - deadlines are rounded up to the next tick and duplicates in the same tick are collapsed
+ *    because a single wakeup re-evaluates everything.
+ */
+-(void) addDeadline:(NSTimeInterval) t
+{
+    int64_t tick = (int64_t) ceil((t / tickInterval) - CS_NTS_WHEEL_EPSILON);
+    if (tick <= curTick) {
+        tick = curTick + 1;
+    }
+    
+    NSMutableArray *maSlot = [maSlots objectAtIndex:(NSUInteger) (tick % (int64_t) numSlots)];
+    for (NSNumber *n in maSlot) {
+        if (n.longLongValue == tick) {
+            return;
+        }
+    }
+    [maSlot addObject:[NSNumber numberWithLongLong:tick]];
+    numEntries++;
+}
+
+/*
+ *  Turn the wheel up to the given time and return the number of deadlines that expired.
+ *  - when more than one revolution has passed, each slot is only examined once.
+ */
+-(NSUInteger) expireThroughTime:(NSTimeInterval) t
+{
+    int64_t target = (int64_t) floor((t / tickInterval) + CS_NTS_WHEEL_EPSILON);
+    if (target <= curTick) {
+        return 0;
+    }
+    
+    NSUInteger ret = 0;
+    if (numEntries) {
+        int64_t numSteps = MIN(target - curTick, (int64_t) numSlots);
+        for (int64_t i = 1; i <= numSteps; i++) {
+            NSMutableArray *maSlot = [maSlots objectAtIndex:(NSUInteger) ((curTick + i) % (int64_t) numSlots)];
+            if (![maSlot count]) {
+                continue;
+            }
+            
+            NSMutableIndexSet *mis = [NSMutableIndexSet indexSet];
+            for (NSUInteger j = 0; j < [maSlot count]; j++) {
+                if (((NSNumber *) [maSlot objectAtIndex:j]).longLongValue <= target) {
+                    [mis addIndex:j];
+                }
+            }
+            [maSlot removeObjectsAtIndexes:mis];
+            ret += [mis count];
+        }
+        numEntries -= ret;
+    }
+    curTick = target;
+    return ret;
+}
+
+/*
+ *  Return the earliest deadline in the wheel or a negative number if it is empty.
+ */
+-(NSTimeInterval) earliestDeadline
+{
+    if (!numEntries) {
+        return -1.0;
+    }
+    
+    int64_t minTick = INT64_MAX;
+    for (NSMutableArray *maSlot in maSlots) {
+        for (NSNumber *n in maSlot) {
+            minTick = MIN(minTick, n.longLongValue);
+        }
+    }
+    return (NSTimeInterval) minTick * tickInterval;
+}
+
+/*
+ *  Return the number of pending deadlines.
+ */
+-(NSUInteger) count
+{
+    return numEntries;
+}
+@end
+
+/**************************
+ _S_nts_system_clock
+ **************************/
+@implementation _S_nts_system_clock
+/*
+ *  Return the system time.
+ */
+-(NSTimeInterval) currentTime
+{
+    return [NSDate timeIntervalSinceReferenceDate];
+}
+@end
@@ -65,6 +65,8 @@
 -(BOOL) hasCapacityForAPIByName:(NSString *) name withEvenDistribution:(BOOL) evenlyDistributed andAllowAnyCategory:(BOOL) allowAny;
 -(CS_netFeedAPI *) apiForName:(NSString *) name andReturnWasThrottled:(BOOL *) wasThrottled withError:(NSError **) err;
 -(CS_netFeedAPI *) evenlyDistributedApiForName:(NSString *) name andReturnWasThrottled:(BOOL *) wasThrottled withError:(NSError **) err;
+-(id) scheduleAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio andCompletion:(CS_netThrottledAPIScheduledBlock) completion;
+-(void) cancelScheduledAPI:(id) scheduled;
 -(CS_netFeedAPI *) apiForExistingRequest:(NSURLRequest *) req;
 -(void) throttleAPIForOneCycle:(CS_netFeedAPI *) api;
 -(void) reconfigureThrottleForAPIByName:(NSString *) name toLimit:(NSUInteger) limit andRemaining:(NSUInteger) numRemaining;
@@ -82,4 +84,5 @@
 -(void) requestHighPriorityAttention;
 -(void) notifyMajorFeedUpdateHasOccurredAndShouldUpdateBadge:(BOOL) updateBadge;
 -(ChatSealMessage *) importMessageIntoVault:(NSData *) dMessage andReturnOriginFeed:(ChatSealFeedLocation **) originFeed withError:(NSError **) err;
+-(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andReturnOriginFeed:(ChatSealFeedLocation **) originFeed withError:(NSError **) err;
 @end
\ No newline at end of file
@@ -13,6 +13,7 @@
 @interface ChatSealFeedCollector (shared)
 +(void) issueUpdateNotificationForFeed:(ChatSealFeed *) feed;
 -(CS_centralNetworkThrottle *) centralThrottle;
+-(CS_feedImagePipeline *) imagePipeline;
 -(ACAccountStore *) accountStore;
 -(BOOL) addRequestAPI:(CS_netFeedAPI *) api forFeed:(ChatSealFeed<ChatSealFeedImplementation> *) feed inCategory:(cs_cnt_throttle_category_t) category
 andReturnWasThrottled:(BOOL *) wasThrottled withError:(NSError **) err;
@@ -54,6 +54,7 @@ static NSString *PSF_STD_SEND_FEED_KEY = @"sendFeed";
 -(void) setUploadStatsForSafeEntry:(NSString *) safeEntryId withNumSent:(int64_t) numSent andTotalToSend:(int64_t) toSend;
 -(void) notifyObserversOfPostedMesageProgress:(ChatSealPostedMessageProgress *) pmp;
 -(CS_netFeedAPI *) apiForName:(NSString *) name withEvenDistribution:(BOOL) evenlyDistributed andReturnWasThrottled:(BOOL *) wasThrottled withError:(NSError **) err;
+-(void) processImportedMessage:(ChatSealMessage *) csm withUserData:(NSObject *) objUserData andReturnOriginFeed:(ChatSealFeedLocation **) originFeed;
 @end
 
 /*********************
@@ -1155,6 +1156,55 @@ static NSString *PSF_STD_SEND_FEED_KEY = @"sendFeed";
     return ret;
 }
 
+/*
+ *  After a message is imported, pull the feed-related data that was passed to us with the message.
+ */
+-(void) processImportedMessage:(ChatSealMessage *) csm withUserData:(NSObject *) objUserData andReturnOriginFeed:(ChatSealFeedLocation **) originFeed
+{
+    if (csm) {
+        // - now see if we can use the user data.
+        NSArray *arrLocs           = nil;
+        ChatSealFeedLocation *csfl = nil;
+        if (objUserData && [objUserData isKindOfClass:[NSDictionary class]]) {
+            arrLocs = [(NSDictionary *) objUserData objectForKey:PSF_STD_POST_HIST_KEY];
+            csfl    = [(NSDictionary *) objUserData objectForKey:PSF_STD_SEND_FEED_KEY];
+            if (originFeed) {
+                *originFeed = [[csfl retain] autorelease];
+            }
+            
+            // - if there is other user data, give the derived class a chance to see it.
+            if ([self respondsToSelector:@selector(processCustomUserContentReceivedFromMessage:packedWithSeal:)]) {
+                [self performSelector:@selector(processCustomUserContentReceivedFromMessage:packedWithSeal:) withObject:objUserData withObject:csm.sealId];
+            }
+            
+            // - if we got locations, give the type a chance to process them.
+            if ([arrLocs count]) {
+                if ([[self typeForFeed:self] respondsToSelector:@selector(processReceivedFeedLocations:)]) {
+                    [[self typeForFeed:self] performSelector:@selector(processReceivedFeedLocations:) withObject:arrLocs];
+                }
+            }
+        }
+        
+        // ...update the remote feed locations, if possible.
+        // NOTE: YOU DO NOT want to ever pass in the feed location to this method to add it to the list (I tried that)
+        //       because it is not objective.  If the feed finds a message and posts something where the message was found, it will
+        //       not prevent reposts of the same image from identifying bogus friends.   The only safe place to derive that information is
+        //       from the message content.
+        if ([arrLocs count] || csfl) {
+            if (csfl) {
+                NSMutableArray *maLocs = [NSMutableArray arrayWithObject:csfl];
+                if (arrLocs) {
+                    [maLocs addObjectsFromArray:arrLocs];
+                }
+                arrLocs = maLocs;
+            }
+            [[csm identityWithError:nil] updateFriendFeedLocations:arrLocs];
+        }
+        
+        // - notify the collector so that can track that this occurred.
+        [[self collector] trackMessageImportEvent];
+    }
+}
 @end
 
 /*********************
@@ -1217,6 +1267,7 @@ static NSString *PSF_STD_SEND_FEED_KEY = @"sendFeed";
             [mdFeedData setObject:[NSNumber numberWithBool:YES] forKey:PSF_STD_ENABLED_KEY];
         }
         apiFactory = [[self apiFactoryForFeed:self] retain];
+        [apiFactory setSchedulerAccount:sFeedId];
     }
     return self;
 }
@@ -1394,6 +1445,39 @@ static NSString *PSF_STD_SEND_FEED_KEY = @"sendFeed";
     return [self apiForName:name withEvenDistribution:YES andReturnWasThrottled:wasThrottled withError:err];
 }
 
+/*
+ *  Queue a request for an API that is delivered when the central scheduler has capacity for it instead of 
+ *  refusing it outright when the feed is throttled.
+ *  - the completion block may be executed on any thread and receives nil if the API could not be generated.
+ */
+-(id) scheduleAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio andCompletion:(CS_netThrottledAPIScheduledBlock) completion
+{
+    CS_netThrottledAPIFactory *factory = nil;
+    @synchronized (self) {
+        if (![self verifyStatsAreValidWithError:nil]) {
+            return nil;
+        }
+        factory = [[apiFactory retain] autorelease];
+    }
+    
+    // - the generator routes through the feed so that its own gating and authentication are applied.
+    return [factory scheduleAPIForName:name withPriority:prio usingGenerator:^CS_netFeedAPI *(BOOL *wasThrottled) {
+        return [self apiForName:name andReturnWasThrottled:wasThrottled withError:nil];
+    } andCompletion:completion];
+}
+
+/*
+ *  Cancel a request created with scheduleAPIForName before it is delivered.
+ */
+-(void) cancelScheduledAPI:(id) scheduled
+{
+    CS_netThrottledAPIFactory *factory = nil;
+    @synchronized (self) {
+        factory = [[apiFactory retain] autorelease];
+    }
+    [factory cancelScheduledAPI:scheduled];
+}
+
 /*
  *  Try to determine if one of our existing APIs was the source for this request.
  */
@@ -2166,49 +2250,19 @@ static NSString *PSF_STD_SEND_FEED_KEY = @"sendFeed";
     NSObject *objUserData = nil;
     ChatSealMessage *csm  = nil;
     csm                   = [ChatSeal importMessageIntoVault:dMessage andSetDefaultFeed:[self feedId] andReturnUserData:&objUserData withError:err];
-    if (csm) {
-        // - now see if we can use the user data.
-        NSArray *arrLocs           = nil;
-        ChatSealFeedLocation *csfl = nil;
-        if (objUserData && [objUserData isKindOfClass:[NSDictionary class]]) {
-            arrLocs = [(NSDictionary *) objUserData objectForKey:PSF_STD_POST_HIST_KEY];
-            csfl    = [(NSDictionary *) objUserData objectForKey:PSF_STD_SEND_FEED_KEY];
-            if (originFeed) {
-                *originFeed = [[csfl retain] autorelease];
-            }
-            
-            // - if there is other user data, give the derived class a chance to see it.
-            if ([self respondsToSelector:@selector(processCustomUserContentReceivedFromMessage:packedWithSeal:)]) {
-                [self performSelector:@selector(processCustomUserContentReceivedFromMessage:packedWithSeal:) withObject:objUserData withObject:csm.sealId];
-            }
-            
-            // - if we got locations, give the type a chance to process them.
-            if ([arrLocs count]) {
-                if ([[self typeForFeed:self] respondsToSelector:@selector(processReceivedFeedLocations:)]) {
-                    [[self typeForFeed:self] performSelector:@selector(processReceivedFeedLocations:) withObject:arrLocs];
-                }
-            }
-        }
+    [self processImportedMessage:csm withUserData:objUserData andReturnOriginFeed:originFeed];
+    return csm;
+}
 
-        // ...update the remote feed locations, if possible.
-        // NOTE: YOU DO NOT want to ever pass in the feed location to this method to add it to the list (I tried that)
-        //       because it is not objective.  If the feed finds a message and posts something where the message was found, it will
-        //       not prevent reposts of the same image from identifying bogus friends.   The only safe place to derive that information is
-        //       from the message content.
-        if ([arrLocs count] || csfl) {
-            if (csfl) {
-                NSMutableArray *maLocs = [NSMutableArray arrayWithObject:csfl];
-                if (arrLocs) {
-                    [maLocs addObjectsFromArray:arrLocs];
-                }
-                arrLocs = maLocs;
-            }
-            [[csm identityWithError:nil] updateFriendFeedLocations:arrLocs];
-        }
-        
-        // - notify the collector so that can track that this occurred.
-        [[self collector] trackMessageImportEvent];
-    }
+/*
+ *  Import a message that was already identified and decrypted by the feed's image processing.
+ */
+-(ChatSealMessage *) importSecureMessageIntoVault:(RSISecureMessage *) sm andReturnOriginFeed:(ChatSealFeedLocation **) originFeed withError:(NSError **) err
+{
+    NSObject *objUserData = nil;
+    ChatSealMessage *csm  = nil;
+    csm                   = [ChatSeal importSecureMessageIntoVault:sm andSetDefaultFeed:[self feedId] andReturnUserData:&objUserData withError:err];
+    [self processImportedMessage:csm withUserData:objUserData andReturnOriginFeed:originFeed];
     return csm;
 }
 @end
@@ -64,6 +64,7 @@ static const NSUInteger PSFC_STD_HIGHPRIO_DELAY = PSFC_STD_TIMER_DELAY;
     BOOL                       isOpen;
     BOOL                       hasBeenQueriedAtLeastOnce;
     CS_centralNetworkThrottle *cntNetThrottle;
+    CS_feedImagePipeline      *imagePipeline;
     ACAccountStore             *asFeedAccounts;
     NSMutableArray             *maFeedTypes;
     NSMutableArray             *maPendingFeedTypes;
@@ -311,6 +312,11 @@ static const NSUInteger PSFC_STD_HIGHPRIO_DELAY = PSFC_STD_TIMER_DELAY;
             }
         }
         
+        // - downloaded messages are decoded in a pipeline that is shared by all the feeds.
+        if (!imagePipeline) {
+            imagePipeline = [[CS_feedImagePipeline alloc] init];
+        }
+        
         // - load the configuration that exists before continuing.
         if (![self loadCollectorDataWithError:&tmp]) {
             if (completionBlock) {
@@ -547,8 +553,9 @@ static const NSUInteger PSFC_STD_HIGHPRIO_DELAY = PSFC_STD_TIMER_DELAY;
  */
 -(void) close
 {
-    NSMutableArray *maTmpTypes = [NSMutableArray array];
-    NSMutableArray *maTmpMgrs  = [NSMutableArray array];
+    NSMutableArray *maTmpTypes        = [NSMutableArray array];
+    NSMutableArray *maTmpMgrs         = [NSMutableArray array];
+    CS_feedImagePipeline *pipelineTmp = nil;
     @synchronized (self) {
         isOpen = NO;
         
@@ -589,12 +596,21 @@ static const NSUInteger PSFC_STD_HIGHPRIO_DELAY = PSFC_STD_TIMER_DELAY;
         [cntNetThrottle release];
         cntNetThrottle = nil;
         
+        // - the pipeline will complete its remaining items as aborted, which calls into the feeds, so
+        //   it must be closed outside the lock.
+        [imagePipeline autorelease];
+        pipelineTmp   = imagePipeline;
+        imagePipeline = nil;
+        
         // - make sure the account store is discarded last because
         //   there may be outstanding references associated with it.
         [asFeedAccounts release];
         asFeedAccounts = nil;
     }
     
+    // - the image pipeline is closed first because its remaining items must be returned to their feeds.
+    [pipelineTmp close];
+    
     // - explicitly close these types, but outside our lock.
     for (ChatSealFeedType *ft in maTmpTypes) {
         ft.delegate = nil;
@@ -1557,6 +1573,16 @@ static const NSUInteger PSFC_STD_HIGHPRIO_DELAY = PSFC_STD_TIMER_DELAY;
     }
 }
 
+/*
+ *  Return the pipeline used to decode downloaded messages.
+ */
+-(CS_feedImagePipeline *) imagePipeline
+{
+    @synchronized (self) {
+        return [[imagePipeline retain] autorelease];
+    }
+}
+
 /*
  *  This method is used to start processing a new API inside the collector.
  */
@@ -65,10 +65,11 @@
  */
 -(cs_cnt_throttle_category_t) centralThrottleCategory
 {
-    // - we want to compete for the same resources in the central throttle as
-    //   any standard upload or download with these because this will
-    //   take some time and bandwidth to complete.
-    return CS_CNT_THROTTLE_DOWNLOAD;
+    // - these used to compete for the single upload/download slot in the central throttle, but
+    //   that meant the network sat idle while each one was decoded.  Since most are cancelled as soon as
+    //   their header is rejected, their concurrency is now bounded by the fetch stage of the collector's
+    //   image pipeline instead.
+    return CS_CNT_THROTTLE_TRANSIENT;
 }
 
 /*
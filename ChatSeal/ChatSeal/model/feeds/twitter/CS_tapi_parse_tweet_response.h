@@ -8,9 +8,11 @@
 
 #import <Foundation/Foundation.h>
 
+@class CS_tapi_parse_tweet_stream;
 @interface CS_tapi_parse_tweet_response : NSObject
 +(BOOL) isStandardStatusResponse:(NSObject *) obj;
 -(BOOL) fillImageTweetFromObject:(NSObject *) obj;
+-(BOOL) fillImageTweetFromStream:(CS_tapi_parse_tweet_stream *) pts atIndex:(NSUInteger) idx;
 @property (nonatomic, readonly) NSString *tweetId;
 @property (nonatomic, readonly) NSURL    *imageURL;
 @property (nonatomic, readonly) NSString *screenName;
@@ -9,6 +9,7 @@
 #import "CS_tapi_parse_tweet_response.h"
 #import "CS_twitterFeedAPI.h"
 #import "CS_twitterFeed_tweetText.h"
+#import "CS_tapi_parse_tweet_stream.h"
 
 @implementation CS_tapi_parse_tweet_response
 /*
@@ -131,4 +132,43 @@
     return NO;
 }
 
+/*
+ *  This method performs the same checks as the object-based variant, but using the fields extracted by the
+ *  stream parser so that strings are only created for the values we actually keep.
+ */
+-(BOOL) fillImageTweetFromStream:(CS_tapi_parse_tweet_stream *) pts atIndex:(NSUInteger) idx
+{
+    [self reset];
+    
+    const cs_tpts_tweet_t *tweet = [pts tweetAtIndex:idx];
+    if (!tweet || !tweet->tweetId.isPresent || !tweet->hasEntities || !tweet->text.isPresent) {
+        return NO;
+    }
+    
+    tweetId   = [[pts stringForSpan:tweet->tweetId] retain];
+    tweetText = [[pts stringForSpan:tweet->text] retain];
+    if (!tweet->hasMedia || !tweet->isLastMediaObject ||
+        ![pts span:tweet->mediaType isEqualToCString:"photo"] || !tweet->mediaURL.isPresent) {
+        return NO;
+    }
+    
+    // - try to pull the id of the user who issued the tweet.
+    NSString *id_str = nil;
+    if (tweet->hasUser) {
+        id_str     = [pts stringForSpan:tweet->userId];
+        screenName = [[pts stringForSpan:tweet->screenName] retain];
+    }
+    
+    // - if we see text in the tweet that suggests it could have been composed by this person with a seal we have
+    //   in common and the image appears valid, continue.
+    NSString *sURL = [pts stringForSpan:tweet->mediaURL];
+    if (id_str &&
+        [CS_twitterFeed_tweetText isTweetWithText:tweetText possibilyUsefulFromNumericUserId:id_str] &&
+        [CS_twitterFeedAPI isChatSealValidImageURLString:sURL]) {
+        imageURL = [[NSURL URLWithString:sURL] retain];
+        return YES;
+    }
+    return NO;
+}
+
 @end
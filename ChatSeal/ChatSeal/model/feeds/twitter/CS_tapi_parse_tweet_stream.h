@@ -0,0 +1,44 @@
+//
+//  CS_tapi_parse_tweet_stream.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/21/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - a span identifies a string value either in the original response or, when the
+//   value included escapes, in the parser's decoded scratch buffer.
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint8_t  isDecoded;
+    uint8_t  isPresent;
+} cs_tpts_span_t;
+
+// - only the fields needed by the feed pipeline are retained from each status.
+// - a field is only present when it had the type the pipeline expects (strings, objects).
+typedef struct {
+    cs_tpts_span_t tweetId;
+    cs_tpts_span_t text;
+    cs_tpts_span_t userId;
+    cs_tpts_span_t screenName;
+    cs_tpts_span_t mediaType;           //  from the last item in entities.media
+    cs_tpts_span_t mediaURL;
+    uint8_t        hasEntities;
+    uint8_t        hasUser;
+    uint8_t        hasMedia;            //  entities.media was a non-empty array
+    uint8_t        isLastMediaObject;   //  the last item in entities.media was an object
+} cs_tpts_tweet_t;
+
+// - the stream parser is a single-pass reader over a timeline response (a JSON array of
+//   statuses) that avoids building the intermediate Foundation object graph.
+@interface CS_tapi_parse_tweet_stream : NSObject
+-(id) initWithData:(NSData *) d;
+-(BOOL) parse;
+-(NSUInteger) count;
+-(const cs_tpts_tweet_t *) tweetAtIndex:(NSUInteger) idx;
+-(NSString *) stringForSpan:(cs_tpts_span_t) span;
+-(BOOL) span:(cs_tpts_span_t) span isEqualToCString:(const char *) str;
+@end
@@ -0,0 +1,822 @@
+//
+//  CS_tapi_parse_tweet_stream.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/21/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_tapi_parse_tweet_stream.h"
+
+//  THREADING-NOTES:
+//  - this object is intended to be used from a single thread, like the APIs that create it.
+//  - the parser is written as a set of plain C routines that walk the response once, retaining only the
+//    offsets of the interesting strings.  Nothing is allocated per-value unless the value includes escapes,
+//    and even then it is copied into a single shared scratch buffer.
+
+// - constants
+static const NSUInteger CS_TPTS_MAX_DEPTH    = 256;
+static const NSUInteger CS_TPTS_STD_CAPACITY = 64;
+static const size_t     CS_TPTS_STD_SCRATCH  = 1024;
+
+// - the state of a single pass over the response.
+typedef struct {
+    const unsigned char *buf;
+    size_t              len;
+    size_t              pos;
+    unsigned char       *scratch;
+    size_t              scratchLen;
+    size_t              scratchCap;
+    NSUInteger          depth;
+} cs_tpts_reader_t;
+
+// - member callbacks must consume the value that follows the key and element callbacks the element itself.
+typedef BOOL (*cs_tpts_member_fn)(cs_tpts_reader_t *r, cs_tpts_span_t key, void *ctx);
+typedef BOOL (*cs_tpts_element_fn)(cs_tpts_reader_t *r, void *ctx);
+
+// - forward declarations
+static BOOL cs_tpts_skip_value(cs_tpts_reader_t *r);
+static BOOL cs_tpts_parse_object(cs_tpts_reader_t *r, cs_tpts_member_fn fn, void *ctx);
+static BOOL cs_tpts_parse_array(cs_tpts_reader_t *r, cs_tpts_element_fn fn, void *ctx);
+
+/*
+ *  Advance past any whitespace.
+ */
+static void cs_tpts_skip_ws(cs_tpts_reader_t *r)
+{
+    while (r->pos < r->len) {
+        unsigned char c = r->buf[r->pos];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            break;
+        }
+        r->pos++;
+    }
+}
+
+/*
+ *  Return the next significant character without consuming it.
+ */
+static BOOL cs_tpts_peek(cs_tpts_reader_t *r, unsigned char *c)
+{
+    cs_tpts_skip_ws(r);
+    if (r->pos >= r->len) {
+        return NO;
+    }
+    *c = r->buf[r->pos];
+    return YES;
+}
+
+/*
+ *  Append decoded bytes to the scratch buffer.
+ */
+static BOOL cs_tpts_scratch_append(cs_tpts_reader_t *r, const unsigned char *bytes, size_t numBytes)
+{
+    if (r->scratchLen + numBytes > r->scratchCap) {
+        size_t newCap    = MAX(r->scratchCap * 2, r->scratchLen + numBytes + CS_TPTS_STD_SCRATCH);
+        unsigned char *p = (unsigned char *) realloc(r->scratch, newCap);
+        if (!p) {
+            return NO;
+        }
+        r->scratch    = p;
+        r->scratchCap = newCap;
+    }
+    memcpy(r->scratch + r->scratchLen, bytes, numBytes);
+    r->scratchLen += numBytes;
+    return YES;
+}
+
+/*
+ *  Read the four hex digits of a unicode escape.
+ */
+static BOOL cs_tpts_read_hex4(cs_tpts_reader_t *r, uint32_t *val)
+{
+    if (r->pos + 4 > r->len) {
+        return NO;
+    }
+    
+    uint32_t ret = 0;
+    for (NSUInteger i = 0; i < 4; i++) {
+        unsigned char c = r->buf[r->pos++];
+        ret <<= 4;
+        if (c >= '0' && c <= '9') {
+            ret |= (uint32_t) (c - '0');
+        }
+        else if (c >= 'a' && c <= 'f') {
+            ret |= (uint32_t) (c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F') {
+            ret |= (uint32_t) (c - 'A' + 10);
+        }
+        else {
+            return NO;
+        }
+    }
+    *val = ret;
+    return YES;
+}
+
+/*
+ *  Encode a code point as UTF-8, returning the number of bytes used.
+ */
+static size_t cs_tpts_encode_utf8(uint32_t cp, unsigned char *out)
+{
+    if (cp < 0x80) {
+        out[0] = (unsigned char) cp;
+        return 1;
+    }
+    else if (cp < 0x800) {
+        out[0] = (unsigned char) (0xC0 | (cp >> 6));
+        out[1] = (unsigned char) (0x80 | (cp & 0x3F));
+        return 2;
+    }
+    else if (cp < 0x10000) {
+        out[0] = (unsigned char) (0xE0 | (cp >> 12));
+        out[1] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char) (0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char) (0xF0 | (cp >> 18));
+    out[1] = (unsigned char) (0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (unsigned char) (0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/*
+ *  Parse a string, which assumes the reader is positioned on the opening quote.
+ *  - when a span is provided, it will reference the value in the response when there are no escapes
+ *    or the decoded value in the scratch buffer otherwise.
+ *  - when no span is provided, the string is only validated.
+ */
+static BOOL cs_tpts_parse_string(cs_tpts_reader_t *r, cs_tpts_span_t *span)
+{
+    size_t start = ++r->pos;
+    
+    // - the common case is a string without escapes, which can be referenced in place.
+    while (r->pos < r->len) {
+        unsigned char c = r->buf[r->pos];
+        if (c == '"') {
+            if (span) {
+                span->offset    = (uint32_t) start;
+                span->length    = (uint32_t) (r->pos - start);
+                span->isDecoded = 0;
+                span->isPresent = 1;
+            }
+            r->pos++;
+            return YES;
+        }
+        else if (c == '\\') {
+            break;
+        }
+        else if (c < 0x20) {
+            return NO;
+        }
+        r->pos++;
+    }
+    if (r->pos >= r->len) {
+        return NO;
+    }
+    
+    // - with escapes, the value must be decoded.
+    size_t scratchStart = r->scratchLen;
+    if (span && !cs_tpts_scratch_append(r, r->buf + start, r->pos - start)) {
+        return NO;
+    }
+    
+    while (r->pos < r->len) {
+        unsigned char c = r->buf[r->pos];
+        if (c == '"') {
+            if (span) {
+                span->offset    = (uint32_t) scratchStart;
+                span->length    = (uint32_t) (r->scratchLen - scratchStart);
+                span->isDecoded = 1;
+                span->isPresent = 1;
+            }
+            r->pos++;
+            return YES;
+        }
+        else if (c < 0x20) {
+            return NO;
+        }
+        else if (c != '\\') {
+            if (span && !cs_tpts_scratch_append(r, &c, 1)) {
+                return NO;
+            }
+            r->pos++;
+            continue;
+        }
+        
+        r->pos++;
+        if (r->pos >= r->len) {
+            return NO;
+        }
+        
+        unsigned char out[4];
+        size_t numOut     = 1;
+        unsigned char esc = r->buf[r->pos++];
+        switch (esc) {
+            case '"':
+            case '\\':
+            case '/':
+                out[0] = esc;
+                break;
+            
+            case 'b':
+                out[0] = '\b';
+                break;
+            
+            case 'f':
+                out[0] = '\f';
+                break;
+            
+            case 'n':
+                out[0] = '\n';
+                break;
+            
+            case 'r':
+                out[0] = '\r';
+                break;
+            
+            case 't':
+                out[0] = '\t';
+                break;
+            
+            case 'u':
+            {
+                uint32_t cp = 0;
+                if (!cs_tpts_read_hex4(r, &cp)) {
+                    return NO;
+                }
+                
+                // - characters outside the basic plane are sent as surrogate pairs.
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low = 0;
+                    if (r->pos + 2 > r->len || r->buf[r->pos] != '\\' || r->buf[r->pos + 1] != 'u') {
+                        return NO;
+                    }
+                    r->pos += 2;
+                    if (!cs_tpts_read_hex4(r, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        return NO;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return NO;
+                }
+                numOut = cs_tpts_encode_utf8(cp, out);
+            }
+                break;
+            
+            default:
+                return NO;
+        }
+        
+        if (span && !cs_tpts_scratch_append(r, out, numOut)) {
+            return NO;
+        }
+    }
+    return NO;
+}
+
+/*
+ *  Skip a number, validating its format.
+ */
+static BOOL cs_tpts_skip_number(cs_tpts_reader_t *r)
+{
+    if (r->pos < r->len && r->buf[r->pos] == '-') {
+        r->pos++;
+    }
+    if (r->pos >= r->len) {
+        return NO;
+    }
+    
+    if (r->buf[r->pos] == '0') {
+        r->pos++;
+    }
+    else if (r->buf[r->pos] >= '1' && r->buf[r->pos] <= '9') {
+        while (r->pos < r->len && isdigit(r->buf[r->pos])) {
+            r->pos++;
+        }
+    }
+    else {
+        return NO;
+    }
+    
+    if (r->pos < r->len && r->buf[r->pos] == '.') {
+        r->pos++;
+        size_t start = r->pos;
+        while (r->pos < r->len && isdigit(r->buf[r->pos])) {
+            r->pos++;
+        }
+        if (r->pos == start) {
+            return NO;
+        }
+    }
+    
+    if (r->pos < r->len && (r->buf[r->pos] == 'e' || r->buf[r->pos] == 'E')) {
+        r->pos++;
+        if (r->pos < r->len && (r->buf[r->pos] == '+' || r->buf[r->pos] == '-')) {
+            r->pos++;
+        }
+        size_t start = r->pos;
+        while (r->pos < r->len && isdigit(r->buf[r->pos])) {
+            r->pos++;
+        }
+        if (r->pos == start) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/*
+ *  Skip a literal value.
+ */
+static BOOL cs_tpts_skip_literal(cs_tpts_reader_t *r, const char *literal)
+{
+    size_t len = strlen(literal);
+    if (r->pos + len > r->len || memcmp(r->buf + r->pos, literal, len)) {
+        return NO;
+    }
+    r->pos += len;
+    return YES;
+}
+
+/*
+ *  Skip any value, validating it along the way.
+ */
+static BOOL cs_tpts_skip_value(cs_tpts_reader_t *r)
+{
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    
+    switch (c) {
+        case '"':
+            return cs_tpts_parse_string(r, NULL);
+        
+        case '{':
+            return cs_tpts_parse_object(r, NULL, NULL);
+        
+        case '[':
+            return cs_tpts_parse_array(r, NULL, NULL);
+        
+        case 't':
+            return cs_tpts_skip_literal(r, "true");
+        
+        case 'f':
+            return cs_tpts_skip_literal(r, "false");
+        
+        case 'n':
+            return cs_tpts_skip_literal(r, "null");
+        
+        default:
+            return cs_tpts_skip_number(r);
+    }
+}
+
+/*
+ *  Parse an object, which assumes the reader is positioned on the opening brace.
+ *  - without a callback, all members are skipped.
+ */
+static BOOL cs_tpts_parse_object(cs_tpts_reader_t *r, cs_tpts_member_fn fn, void *ctx)
+{
+    if (++r->depth > CS_TPTS_MAX_DEPTH) {
+        return NO;
+    }
+    r->pos++;
+    
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    if (c == '}') {
+        r->pos++;
+        r->depth--;
+        return YES;
+    }
+    
+    for (;;) {
+        cs_tpts_span_t key;
+        if (!cs_tpts_peek(r, &c) || c != '"' || !cs_tpts_parse_string(r, fn ? &key : NULL)) {
+            return NO;
+        }
+        
+        if (!cs_tpts_peek(r, &c) || c != ':') {
+            return NO;
+        }
+        r->pos++;
+        
+        if (!(fn ? fn(r, key, ctx) : cs_tpts_skip_value(r))) {
+            return NO;
+        }
+        
+        if (!cs_tpts_peek(r, &c)) {
+            return NO;
+        }
+        r->pos++;
+        if (c == '}') {
+            r->depth--;
+            return YES;
+        }
+        else if (c != ',') {
+            return NO;
+        }
+    }
+}
+
+/*
+ *  Parse an array, which assumes the reader is positioned on the opening bracket.
+ *  - without a callback, all elements are skipped.
+ */
+static BOOL cs_tpts_parse_array(cs_tpts_reader_t *r, cs_tpts_element_fn fn, void *ctx)
+{
+    if (++r->depth > CS_TPTS_MAX_DEPTH) {
+        return NO;
+    }
+    r->pos++;
+    
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    if (c == ']') {
+        r->pos++;
+        r->depth--;
+        return YES;
+    }
+    
+    for (;;) {
+        if (!(fn ? fn(r, ctx) : cs_tpts_skip_value(r))) {
+            return NO;
+        }
+        
+        if (!cs_tpts_peek(r, &c)) {
+            return NO;
+        }
+        r->pos++;
+        if (c == ']') {
+            r->depth--;
+            return YES;
+        }
+        else if (c != ',') {
+            return NO;
+        }
+    }
+}
+
+/*
+ *  Return a pointer to the bytes of a span.
+ */
+static const unsigned char *cs_tpts_span_bytes(const unsigned char *buf, const unsigned char *scratch, cs_tpts_span_t span)
+{
+    return span.isDecoded ? scratch + span.offset : buf + span.offset;
+}
+
+/*
+ *  Compare a key to a constant string.
+ */
+static BOOL cs_tpts_key_equals(cs_tpts_reader_t *r, cs_tpts_span_t key, const char *str)
+{
+    size_t len = strlen(str);
+    if (key.length != len) {
+        return NO;
+    }
+    return memcmp(cs_tpts_span_bytes(r->buf, r->scratch, key), str, len) ? NO : YES;
+}
+
+/*
+ *  Capture a string value, but only when it is actually a string.
+ *  - like the dictionaries we used to parse, the last occurrence of a key wins.
+ */
+static BOOL cs_tpts_capture_string(cs_tpts_reader_t *r, cs_tpts_span_t *span)
+{
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    if (c == '"') {
+        return cs_tpts_parse_string(r, span);
+    }
+    memset(span, 0, sizeof(*span));
+    return cs_tpts_skip_value(r);
+}
+
+/*
+ *  Returns whether the next value is an object.
+ */
+static BOOL cs_tpts_next_is_object(cs_tpts_reader_t *r, BOOL *isObject)
+{
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    *isObject = (c == '{') ? YES : NO;
+    return YES;
+}
+
+/*
+ *  Process the members of a media item.
+ */
+static BOOL cs_tpts_media_member(cs_tpts_reader_t *r, cs_tpts_span_t key, void *ctx)
+{
+    cs_tpts_tweet_t *tweet = (cs_tpts_tweet_t *) ctx;
+    if (cs_tpts_key_equals(r, key, "type")) {
+        return cs_tpts_capture_string(r, &tweet->mediaType);
+    }
+    else if (cs_tpts_key_equals(r, key, "media_url")) {
+        return cs_tpts_capture_string(r, &tweet->mediaURL);
+    }
+    return cs_tpts_skip_value(r);
+}
+
+/*
+ *  Process a single item in the media array.
+ *  - only the last one is important, so every item replaces the one before it.
+ */
+static BOOL cs_tpts_media_element(cs_tpts_reader_t *r, void *ctx)
+{
+    cs_tpts_tweet_t *tweet = (cs_tpts_tweet_t *) ctx;
+    BOOL isObject          = NO;
+    if (!cs_tpts_next_is_object(r, &isObject)) {
+        return NO;
+    }
+    
+    tweet->hasMedia          = 1;
+    tweet->isLastMediaObject = isObject ? 1 : 0;
+    memset(&tweet->mediaType, 0, sizeof(tweet->mediaType));
+    memset(&tweet->mediaURL, 0, sizeof(tweet->mediaURL));
+    if (isObject) {
+        return cs_tpts_parse_object(r, cs_tpts_media_member, tweet);
+    }
+    return cs_tpts_skip_value(r);
+}
+
+/*
+ *  Process the members of the entities.
+ */
+static BOOL cs_tpts_entities_member(cs_tpts_reader_t *r, cs_tpts_span_t key, void *ctx)
+{
+    cs_tpts_tweet_t *tweet = (cs_tpts_tweet_t *) ctx;
+    if (!cs_tpts_key_equals(r, key, "media")) {
+        return cs_tpts_skip_value(r);
+    }
+    
+    unsigned char c;
+    if (!cs_tpts_peek(r, &c)) {
+        return NO;
+    }
+    tweet->hasMedia          = 0;
+    tweet->isLastMediaObject = 0;
+    memset(&tweet->mediaType, 0, sizeof(tweet->mediaType));
+    memset(&tweet->mediaURL, 0, sizeof(tweet->mediaURL));
+    if (c == '[') {
+        return cs_tpts_parse_array(r, cs_tpts_media_element, tweet);
+    }
+    return cs_tpts_skip_value(r);
+}
+
+/*
+ *  Process the members of the user.
+ */
+static BOOL cs_tpts_user_member(cs_tpts_reader_t *r, cs_tpts_span_t key, void *ctx)
+{
+    cs_tpts_tweet_t *tweet = (cs_tpts_tweet_t *) ctx;
+    if (cs_tpts_key_equals(r, key, "id_str")) {
+        return cs_tpts_capture_string(r, &tweet->userId);
+    }
+    else if (cs_tpts_key_equals(r, key, "screen_name")) {
+        return cs_tpts_capture_string(r, &tweet->screenName);
+    }
+    return cs_tpts_skip_value(r);
+}
+
+/*
+ *  Process the top-level members of a status.
+ *  - nested statuses (retweets, quotes) are skipped entirely because only the outer status is used.
+ */
+static BOOL cs_tpts_tweet_member(cs_tpts_reader_t *r, cs_tpts_span_t key, void *ctx)
+{
+    cs_tpts_tweet_t *tweet = (cs_tpts_tweet_t *) ctx;
+    BOOL isObject          = NO;
+    if (cs_tpts_key_equals(r, key, "id_str")) {
+        return cs_tpts_capture_string(r, &tweet->tweetId);
+    }
+    else if (cs_tpts_key_equals(r, key, "text")) {
+        return cs_tpts_capture_string(r, &tweet->text);
+    }
+    else if (cs_tpts_key_equals(r, key, "user")) {
+        if (!cs_tpts_next_is_object(r, &isObject)) {
+            return NO;
+        }
+        tweet->hasUser = isObject ? 1 : 0;
+        memset(&tweet->userId, 0, sizeof(tweet->userId));
+        memset(&tweet->screenName, 0, sizeof(tweet->screenName));
+        return isObject ? cs_tpts_parse_object(r, cs_tpts_user_member, tweet) : cs_tpts_skip_value(r);
+    }
+    else if (cs_tpts_key_equals(r, key, "entities")) {
+        if (!cs_tpts_next_is_object(r, &isObject)) {
+            return NO;
+        }
+        tweet->hasEntities       = isObject ? 1 : 0;
+        tweet->hasMedia          = 0;
+        tweet->isLastMediaObject = 0;
+        memset(&tweet->mediaType, 0, sizeof(tweet->mediaType));
+        memset(&tweet->mediaURL, 0, sizeof(tweet->mediaURL));
+        return isObject ? cs_tpts_parse_object(r, cs_tpts_entities_member, tweet) : cs_tpts_skip_value(r);
+    }
+    return cs_tpts_skip_value(r);
+}
+
+/*****************************
+ CS_tapi_parse_tweet_stream
+ *****************************/
+@implementation CS_tapi_parse_tweet_stream
+/*
+ *  Object attributes
+ */
+{
+    NSData          *dSource;
+    BOOL            isParsed;
+    BOOL            isValid;
+    cs_tpts_tweet_t *tweets;
+    NSUInteger      numTweets;
+    NSUInteger      capTweets;
+    unsigned char   *scratch;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithData:(NSData *) d
+{
+    self = [super init];
+    if (self) {
+        dSource   = [d retain];
+        isParsed  = NO;
+        isValid   = NO;
+        tweets    = NULL;
+        numTweets = 0;
+        capTweets = 0;
+        scratch   = NULL;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [dSource release];
+    dSource = nil;
+    
+    if (tweets) {
+        free(tweets);
+        tweets = NULL;
+    }
+    
+    if (scratch) {
+        free(scratch);
+        scratch = NULL;
+    }
+    
+    [super dealloc];
+}
+
+/*
+ *  Parse the response, which must be an array of statuses.
+ *  - returns NO if the response is not a well-formed array, in which case the caller should fall back to
+ *    a general-purpose parser if it needs to accept anything else.
+ */
+-(BOOL) parse
+{
+    if (isParsed) {
+        return isValid;
+    }
+    isParsed = YES;
+    
+    // - offsets are 32-bit to keep the spans compact, which is far beyond any response we'll accept.
+    if (![dSource length] || [dSource length] >= UINT32_MAX) {
+        return NO;
+    }
+    
+    cs_tpts_reader_t r;
+    memset(&r, 0, sizeof(r));
+    r.buf = (const unsigned char *) [dSource bytes];
+    r.len = [dSource length];
+    
+    unsigned char c;
+    BOOL ret = NO;
+    if (cs_tpts_peek(&r, &c) && c == '[') {
+        r.depth++;
+        r.pos++;
+        if (cs_tpts_peek(&r, &c) && c == ']') {
+            r.pos++;
+            ret = YES;
+        }
+        else {
+            for (;;) {
+                if (!cs_tpts_peek(&r, &c)) {
+                    break;
+                }
+                
+                // - only objects are considered statuses.
+                if (c == '{') {
+                    if (numTweets == capTweets) {
+                        NSUInteger newCap   = capTweets ? capTweets * 2 : CS_TPTS_STD_CAPACITY;
+                        cs_tpts_tweet_t *pt = (cs_tpts_tweet_t *) realloc(tweets, newCap * sizeof(cs_tpts_tweet_t));
+                        if (!pt) {
+                            break;
+                        }
+                        tweets    = pt;
+                        capTweets = newCap;
+                    }
+                    cs_tpts_tweet_t *tweet = &(tweets[numTweets]);
+                    memset(tweet, 0, sizeof(*tweet));
+                    if (!cs_tpts_parse_object(&r, cs_tpts_tweet_member, tweet)) {
+                        break;
+                    }
+                    numTweets++;
+                }
+                else if (!cs_tpts_skip_value(&r)) {
+                    break;
+                }
+                
+                if (!cs_tpts_peek(&r, &c)) {
+                    break;
+                }
+                r.pos++;
+                if (c == ']') {
+                    ret = YES;
+                    break;
+                }
+                else if (c != ',') {
+                    break;
+                }
+            }
+        }
+    }
+    
+    // - nothing may follow the array.
+    if (ret) {
+        cs_tpts_skip_ws(&r);
+        ret = (r.pos == r.len) ? YES : NO;
+    }
+    
+    scratch = r.scratch;
+    isValid = ret;
+    if (!isValid) {
+        numTweets = 0;
+    }
+    return isValid;
+}
+
+/*
+ *  Return the number of statuses in the response.
+ */
+-(NSUInteger) count
+{
+    return numTweets;
+}
+
+/*
+ *  Return the fields for a single status.
+ */
+-(const cs_tpts_tweet_t *) tweetAtIndex:(NSUInteger) idx
+{
+    if (idx >= numTweets) {
+        return NULL;
+    }
+    return &(tweets[idx]);
+}
+
+/*
+ *  Convert a span into a string.
+ */
+-(NSString *) stringForSpan:(cs_tpts_span_t) span
+{
+    if (!span.isPresent) {
+        return nil;
+    }
+    const unsigned char *ptr = cs_tpts_span_bytes((const unsigned char *) [dSource bytes], scratch, span);
+    return [[[NSString alloc] initWithBytes:ptr length:span.length encoding:NSUTF8StringEncoding] autorelease];
+}
+
+/*
+ *  Compare a span to a constant string without allocating.
+ */
+-(BOOL) span:(cs_tpts_span_t) span isEqualToCString:(const char *) str
+{
+    if (!span.isPresent || !str) {
+        return NO;
+    }
+    size_t len = strlen(str);
+    if (span.length != len) {
+        return NO;
+    }
+    const unsigned char *ptr = cs_tpts_span_bytes((const unsigned char *) [dSource bytes], scratch, span);
+    return memcmp(ptr, str, len) ? NO : YES;
+}
+@end
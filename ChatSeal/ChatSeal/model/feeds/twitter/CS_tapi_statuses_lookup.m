@@ -9,6 +9,7 @@
 #import "CS_tapi_statuses_lookup.h"
 #import "ChatSeal.h"
 #import "CS_tapi_parse_tweet_response.h"
+#import "CS_tapi_parse_tweet_stream.h"
 
 //  THREADING-NOTES:
 //  - These API object instances are consistent with the threading rules defined for CS_netFeedAPI and as such
@@ -119,7 +120,29 @@
     }
     
     // - parse through the tweets in this payload, returning the tweet and the image URL if it exists.
+    // - the unmapped array is handled by the stream parser, which avoids building the full object graph.
     CS_tapi_parse_tweet_response *ptr   = nil;
+    CS_tapi_parse_tweet_stream *pts     = [[[CS_tapi_parse_tweet_stream alloc] initWithData:[self resultData]] autorelease];
+    if ([pts parse]) {
+        NSUInteger count = [pts count];
+        for (NSUInteger i = 0; i < count; i++) {
+            if (!ptr) {
+                ptr = [[[CS_tapi_parse_tweet_response alloc] init] autorelease];
+            }
+            
+            [ptr fillImageTweetFromStream:pts atIndex:i];
+            if (ptr.tweetId) {
+                [parmToRetrieve removeObject:ptr.tweetId];
+                enumerationBlock(ptr.tweetId, ptr.screenName, ptr.imageURL);
+            }
+        }
+        
+        for (NSString *remain in parmToRetrieve) {
+            enumerationBlock(remain, nil, nil);
+        }
+        return;
+    }
+    
     NSArray *arrTweets                  = nil;
     NSObject *obj = [self resultDataConvertedFromJSON];
     if ([obj isKindOfClass:[NSArray class]]) {
@@ -8,11 +8,17 @@
 
 #import "CS_tapi_statuses_timeline_base.h"
 #import "CS_tapi_parse_tweet_response.h"
+#import "CS_tapi_parse_tweet_stream.h"
 
 //  THREADING-NOTES:
 //  - These API object instances are consistent with the threading rules defined for CS_netFeedAPI and as such
 //    do not require custom internal locking.
 
+// - forward declarations
+@interface CS_tapi_statuses_timeline_base (internal)
+-(CS_tapi_tweetRange *) enumerateResultObjectsWithBlock:(CS_tapi_timeline_enumerationBlock) enumerationBlock;
+@end
+
 /***********************************
  CS_tapi_statuses_timeline_base
  REF: https://api.twitter.com/1.1/statuses/home_timeline.json
@@ -152,6 +158,48 @@
         return nil;
     }
     
+    // - the stream parser handles the standard timeline array without building the full object
+    //   graph, but anything it doesn't understand is still given to the general-purpose parser.
+    CS_tapi_parse_tweet_stream *pts = [[[CS_tapi_parse_tweet_stream alloc] initWithData:[self resultData]] autorelease];
+    if (![pts parse]) {
+        return [self enumerateResultObjectsWithBlock:enumerationBlock];
+    }
+    
+    CS_tapi_parse_tweet_response *ptr = nil;
+    CS_tapi_tweetRange           *ret = [CS_tapi_tweetRange emptyRange];
+    NSUInteger count                  = [pts count];
+    for (NSUInteger i = 0; i < count; i++) {
+        if (!ptr) {
+            ptr = [[[CS_tapi_parse_tweet_response alloc] init] autorelease];
+        }
+        
+        if ([ptr fillImageTweetFromStream:pts atIndex:i]) {
+            if (enumerationBlock) {
+                enumerationBlock(ptr.tweetId, ptr.imageURL);
+            }
+        }
+        
+        // - see the notes in the object-based variant.
+        if (ptr.tweetId && !ret.maxTweetId) {
+            ret.maxTweetId = ptr.tweetId;
+        }
+        ret.minTweetId = ptr.tweetId;
+    }
+    
+    return ret;
+}
+
+@end
+
+/*****************************************
+ CS_tapi_statuses_timeline_base (internal)
+ *****************************************/
+@implementation CS_tapi_statuses_timeline_base (internal)
+/*
+ *  Enumerate the entities after converting the result data into Foundation objects.
+ */
+-(CS_tapi_tweetRange *) enumerateResultObjectsWithBlock:(CS_tapi_timeline_enumerationBlock) enumerationBlock
+{
     NSObject *obj = [self resultDataConvertedFromJSON];
     if (!obj || ![obj isKindOfClass:[NSArray class]]) {
         return nil;
@@ -193,5 +241,4 @@
     
     return ret;
 }
-
 @end
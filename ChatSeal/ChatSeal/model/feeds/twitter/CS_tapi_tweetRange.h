@@ -11,9 +11,12 @@
 @interface CS_tapi_tweetRange : NSObject <NSCoding>
 +(CS_tapi_tweetRange *) emptyRange;
 +(CS_tapi_tweetRange *) rangeForMin:(NSString *) minTweetId andMax:(NSString *) maxTweetId;
++(CS_tapi_tweetRange *) rangeForMinValue:(uint64_t) minValue andMaxValue:(uint64_t) maxValue;
 +(NSString *) absoluteMinimum;
++(uint64_t) absoluteMinimumValue;
 +(NSComparisonResult) rangeValueCompare:(NSString *) v1 withValue:(NSString *) v2;
 +(unsigned long long) tweetValueFromId:(NSString *) tweetId;
+-(BOOL) getMinValue:(uint64_t *) pMin andMaxValue:(uint64_t *) pMax;
 -(BOOL) isAfter:(CS_tapi_tweetRange *) trOther;
 -(BOOL) isIntersectedBy:(CS_tapi_tweetRange *) trOther;
 -(BOOL) isAdjacentToAndPreceding:(CS_tapi_tweetRange *) trOther;
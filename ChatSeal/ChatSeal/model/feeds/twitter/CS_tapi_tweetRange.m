@@ -40,6 +40,14 @@
     return tr;
 }
 
+/*
+ *  Return a filled-in range object from numeric tweet ids.
+ */
++(CS_tapi_tweetRange *) rangeForMinValue:(uint64_t) minValue andMaxValue:(uint64_t) maxValue
+{
+    return [CS_tapi_tweetRange rangeForMin:[NSString stringWithFormat:@"%llu", minValue] andMax:[NSString stringWithFormat:@"%llu", maxValue]];
+}
+
 /*
  *  Standardized comparison for these values.
  */
@@ -67,6 +75,14 @@
     return @"1";
 }
 
+/*
+ *  The numeric equivalent of the absolute minimum.
+ */
++(uint64_t) absoluteMinimumValue
+{
+    return 1;
+}
+
 /*
  *  Convert the tweet id to a value.
  */
@@ -139,6 +155,26 @@
     return [NSString stringWithFormat:@"range:%@ --> %@", self.maxTweetId, self.minTweetId];
 }
 
+/*
+ *  Convert both ends of the range to numeric values.
+ *  - returns NO when either is missing or isn't a valid tweet id.
+ */
+-(BOOL) getMinValue:(uint64_t *) pMin andMaxValue:(uint64_t *) pMax
+{
+    unsigned long long lMin = [CS_tapi_tweetRange tweetValueFromId:self.minTweetId];
+    unsigned long long lMax = [CS_tapi_tweetRange tweetValueFromId:self.maxTweetId];
+    if (lMin == ULLONG_MAX || lMax == ULLONG_MAX || lMin > lMax) {
+        return NO;
+    }
+    if (pMin) {
+        *pMin = lMin;
+    }
+    if (pMax) {
+        *pMax = lMax;
+    }
+    return YES;
+}
+
 /*
  *  Determines if this range occurs after the other one, which is only
  *  when the maximum tweet is after the other maximum.
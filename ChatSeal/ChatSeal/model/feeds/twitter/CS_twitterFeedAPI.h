@@ -43,6 +43,8 @@ extern NSString *CS_TWITTERAPI_COMMON_FALSE;
 -(BOOL) shouldNotAuthorizedBeInterpretedAsPasswordFailure;
 
 +(BOOL) isChatSealValidImageURLString:(NSString *) sURL;
++(void) setSimulatedServiceURL:(NSURL *) uService;          //  only honored with debugging routines enabled.
++(NSURL *) simulatedServiceURL;
 
 // - override these
 -(NSURL *) resourceURL;
@@ -19,8 +19,12 @@
 NSString *CS_TWITTERAPI_COMMON_TRUE  = @"true";
 NSString *CS_TWITTERAPI_COMMON_FALSE = @"false";
 
+// - the simulated service is a local stand-in used for benchmarking the feed stack.
+static NSURL *uSimulatedService = nil;
+
 // - forward declarations
 @interface CS_twitterFeedAPI (internal)
++(NSURLRequest *) requestRedirectedToSimulatedService:(NSURLRequest *) req;
 @end
 
 /********************
@@ -138,7 +142,11 @@ NSString *CS_TWITTERAPI_COMMON_FALSE = @"false";
     [self customizeRequest:req];
     
     httpStatusCode   = CS_TWIT_RC_UNSET;
+#ifdef CHATSEAL_DEBUGGING_ROUTINES
+    return [CS_twitterFeedAPI requestRedirectedToSimulatedService:[req preparedURLRequest]];
+#else
     return [req preparedURLRequest];
+#endif
 }
 
 /*
@@ -221,6 +229,30 @@ NSString *CS_TWITTERAPI_COMMON_FALSE = @"false";
     return YES;
 }
 
+/*
+ *  Assign a local stand-in for the Twitter service that all subsequent requests will be sent to.
+ *  - pass nil to return to the live service.
+ */
++(void) setSimulatedServiceURL:(NSURL *) uService
+{
+    @synchronized (self) {
+        if (uSimulatedService != uService) {
+            [uSimulatedService release];
+            uSimulatedService = [uService retain];
+        }
+    }
+}
+
+/*
+ *  Return the local stand-in for the Twitter service, if one is assigned.
+ */
++(NSURL *) simulatedServiceURL
+{
+    @synchronized (self) {
+        return [[uSimulatedService retain] autorelease];
+    }
+}
+
 /*
  *  Add more customization to the request.
  */
@@ -256,5 +288,35 @@ NSString *CS_TWITTERAPI_COMMON_FALSE = @"false";
  CS_twitterFeedAPI (internal)
  ****************************/
 @implementation CS_twitterFeedAPI (internal)
-
+/*
+ *  When a simulated service is assigned, rewrite the request so that the original host becomes the
+ *  first path component under the simulator, which allows it to distinguish between the API and media hosts.
+ *  - requests that already target the simulator (like its media URLs) are left alone.
+ */
++(NSURLRequest *) requestRedirectedToSimulatedService:(NSURLRequest *) req
+{
+    NSURL *uSim = [CS_twitterFeedAPI simulatedServiceURL];
+    NSURL *uReq = req.URL;
+    if (!uSim || !uReq || !uReq.host ||
+        ([uReq.host isEqualToString:uSim.host] && [uReq.port isEqual:uSim.port])) {
+        return req;
+    }
+    
+    NSString *sBase = [uSim absoluteString];
+    if ([sBase hasSuffix:@"/"]) {
+        sBase = [sBase substringToIndex:[sBase length] - 1];
+    }
+    
+    NSString *sQuery = [uReq query];
+    NSString *sURL   = [NSString stringWithFormat:@"%@/%@%@%@%@", sBase, uReq.host, [uReq path], sQuery ? @"?" : @"", sQuery ? sQuery : @""];
+    NSURL *uRedirect = [NSURL URLWithString:sURL];
+    if (!uRedirect) {
+        NSLog(@"CS-ALERT: Failed to redirect %@ to the simulated service.", [uReq absoluteString]);
+        return req;
+    }
+    
+    NSMutableURLRequest *mur = (NSMutableURLRequest *) [[req mutableCopy] autorelease];
+    mur.URL                  = uRedirect;
+    return mur;
+}
 @end
@@ -171,6 +171,13 @@
         return YES;
     }
     
+    // - the image pipeline limits the number of downloads in flight so that the decoding of completed
+    //   downloads can keep up with the network.
+    CS_feedImagePipeline *pipeline = [[self collector] imagePipeline];
+    if (![pipeline beginFetchForTag:tpNext.tweetId]) {
+        return NO;
+    }
+    
     // - now allocate the appropriate kind of API.
     CS_tapi_download_image *tdi         = nil;
     BOOL wasThrottled                    = NO;
@@ -183,6 +190,7 @@
     }
     
     if (!tdi) {
+        [pipeline abortFetchForTag:tpNext.tweetId];
         if (!wasThrottled) {
             NSLog(@"CS: Failed to allocate a new pending message download.  %@", [err localizedDescription]);
         }
@@ -191,6 +199,7 @@
     
     [tdi setImageURL:tpNext.photoURL forTweetId:tpNext.tweetId];
     if (![self addCollectorRequestWithAPI:tdi andReturnWasThrottled:&wasThrottled withError:&err]) {
+        [pipeline abortFetchForTag:tpNext.tweetId];
         if (!wasThrottled) {
             NSLog(@"CS: Failed to request a new pending message download.  %@", [err localizedDescription]);
         }
@@ -222,7 +231,8 @@
     if (![api isKindOfClass:[CS_tapi_download_image class]]) {
         return NO;
     }
-    CS_tapi_download_image *tdi = (CS_tapi_download_image *) api;
+    CS_tapi_download_image *tdi    = (CS_tapi_download_image *) api;
+    CS_feedImagePipeline *pipeline = [[self collector] imagePipeline];
     
     // - now import the content.
     NSData *dPhoto = nil;
@@ -230,6 +240,7 @@
         dPhoto = [NSData dataWithContentsOfURL:[tdi downloadResultURL]];
         if (!dPhoto) {
             NSLog(@"CS: Unexpected failure to open downloaded message item.");
+            [pipeline abortFetchForTag:tdi.tweetId];
             return YES;
         }
     }
@@ -242,10 +253,18 @@
     BOOL isVaultOpen     = [ChatSeal isVaultOpen];
     BOOL updateCentral   = NO;
     BOOL notFoundError   = (tdi.HTTPStatusCode == CS_TWIT_NOT_FOUND) ? YES : NO;
+    BOOL isDecoding      = NO;
     @synchronized (self) {
         CS_twitterFeed_pending_db *pdb = [self verifyOpenPendingDB];
         if (isVaultOpen && (api.isAPISuccessful || tdi.isCancelledForLackingSeal || notFoundError)) {
-            [pdb discardPendingTweet:tdi.tweetId];
+            // - content that is decoded in the pipeline keeps its pending entry until the outcome is known because
+            //   the pipeline may be closed before it gets to it.
+            if (dPhoto && pipeline) {
+                isDecoding = YES;
+            }
+            else {
+                [pdb discardPendingTweet:tdi.tweetId];
+            }
             updateCentral = YES;
         }
         else {
@@ -268,38 +287,82 @@
         [pdb save];
     }
     
-    // - import the item, but there's not much that can be done with the error
-    //   since there are so many different ways this can fail.
-    BOOL goodImport = NO;
-    if (dPhoto) {
+    // - when there is nothing to import, the outcome is already known.
+    NSString *tweetId = tdi.tweetId;
+    if (!dPhoto) {
+        [pipeline abortFetchForTag:tweetId];
+        [self completeImportOfTweet:tweetId withMessage:nil fromOrigin:nil andUpdateCentral:updateCentral asNotFound:notFoundError];
+        return YES;
+    }
+    
+    // - without the collector's pipeline (it is closing), the import is done in the old way.
+    if (!isDecoding) {
         ChatSealFeedLocation *csfl = nil;
         ChatSealMessage *csm       = [self importMessageIntoVault:dPhoto andReturnOriginFeed:&csfl withError:nil];
-        if (csm) {
-            // - when we pull-in a producer message as a consumer, we need to update the history with
-            //   the information so that this consumer can reply to the producer when necessary.
-            if (!csm.isAuthorMe && csfl.feedAccount) {
-                // ...incrementing the message count in a moment will save
-                [self addConsumerHistoryForSeal:csm.sealId withTweet:tdi.tweetId andOwnerScreenName:csfl.feedAccount];
+        [self completeImportOfTweet:tweetId withMessage:csm fromOrigin:csfl andUpdateCentral:updateCentral asNotFound:notFoundError];
+        return YES;
+    }
+    
+    // - the decoding is done in the pipeline so that the next download is never waiting on it.
+    // - import the item, but there's not much that can be done with the error
+    //   since there are so many different ways this can fail.
+    [pipeline processFetchedData:dPhoto forTag:tweetId withCompletion:^(RSISecureMessage *sm, NSError *err) {
+        // - when the pipeline was closed first, the download is returned to the pending database to be tried again.
+        BOOL isAborted = (!sm && [err code] == CSErrorAborted) ? YES : NO;
+        @synchronized (self) {
+            CS_twitterFeed_pending_db *pdb = [self verifyOpenPendingDB];
+            if (isAborted) {
+                [pdb markPendingTweetFailedAndAllowProcessing:tweetId];
+            }
+            else {
+                [pdb discardPendingTweet:tweetId];
             }
-            [self incrementMessageCountReceived];
-            goodImport = YES;
+            [pdb save];
+        }
+        if (isAborted) {
+            return;
         }
+        
+        ChatSealFeedLocation *csfl = nil;
+        ChatSealMessage *csm       = nil;
+        if (sm) {
+            csm = [self importSecureMessageIntoVault:sm andReturnOriginFeed:&csfl withError:nil];
+        }
+        [self completeImportOfTweet:tweetId withMessage:csm fromOrigin:csfl andUpdateCentral:updateCentral asNotFound:notFoundError];
+    }];
+    return YES;
+}
+
+/*
+ *  When a downloaded tweet has been imported, or has failed to be, update our accounting for it.
+ */
+-(void) completeImportOfTweet:(NSString *) tweetId withMessage:(ChatSealMessage *) csm fromOrigin:(ChatSealFeedLocation *) csfl
+             andUpdateCentral:(BOOL) updateCentral asNotFound:(BOOL) notFoundError
+{
+    BOOL goodImport = NO;
+    if (csm) {
+        // - when we pull-in a producer message as a consumer, we need to update the history with
+        //   the information so that this consumer can reply to the producer when necessary.
+        if (!csm.isAuthorMe && csfl.feedAccount) {
+            // ...incrementing the message count in a moment will save
+            [self addConsumerHistoryForSeal:csm.sealId withTweet:tweetId andOwnerScreenName:csfl.feedAccount];
+        }
+        [self incrementMessageCountReceived];
+        goodImport = YES;
     }
     
     // - when we're done make sure that we track what we've finished or allow this to be processed again later.
     if (updateCentral) {
         if (goodImport || notFoundError) {
             // - when the tweet has been imported or it doesn't exist any more, we can really just say it is done and never try again.
-            [[self twitterType] setTweetIdAsCompleted:tdi.tweetId withError:nil];
+            [[self twitterType] setTweetIdAsCompleted:tweetId withError:nil];
         }
         else {
             // - if the tweet is discovered again through a different feed or channel like tweet history when we finally
             //   have a seal, we can give it another shot.
-            [[self twitterType] untrackTweetId:tdi.tweetId withError:nil];
+            [[self twitterType] untrackTweetId:tweetId withError:nil];
         }
     }
-    
-    return YES;
 }
 
 /*
@@ -87,6 +87,8 @@
 -(BOOL) schedulePendingTweetLookupIfPossibleWithItems:(NSArray *) arrTweetIds;
 -(BOOL) tryToProcessPendingInCategory:(cs_cnt_throttle_category_t) cat;
 -(BOOL) tryToCompletePendingWithAPI:(CS_twitterFeedAPI *) api;
+-(void) completeImportOfTweet:(NSString *) tweetId withMessage:(ChatSealMessage *) csm fromOrigin:(ChatSealFeedLocation *) csfl
+             andUpdateCentral:(BOOL) updateCentral asNotFound:(BOOL) notFoundError;
 -(void) updateProgressForPendingItemAPI:(CS_tapi_download_image *) api;
 -(void) updateMessageStateIfPossibleForVerifyAPI:(CS_tapi_download_image_toverify *) api;
 -(void) completePendingTweetLookupsWithAPI:(CS_tapi_statuses_lookup *) api;
@@ -15,6 +15,7 @@
 // - forward declarations
 @interface CS_twmFeedMentions_miningStats (internal)
 -(void) commonConfiguration;
+-(BOOL) issueMentionsTimelineAPI:(CS_tapi_statuses_mentions_timeline *) mt usingFeed:(CS_twitterFeed *) feed;
 @end
 
 /*******************************
@@ -69,7 +70,8 @@
 {
     // - REMEMBER: this is an OVERRIDE of the base because a feed owner has special requirements.
     [[self statsLock] lock];
-    if (inRequest) {
+    if (inRequest || [self hasScheduledTimelineAPI]) {
+        [[self statsLock] unlock];
         return YES;
     }
     [[self statsLock] unlock];
@@ -83,29 +85,16 @@
     BOOL wasThrottled                  = NO;
     CS_tapi_statuses_mentions_timeline *mt = (CS_tapi_statuses_mentions_timeline *) [feed evenlyDistributedApiForName:@"CS_tapi_statuses_mentions_timeline" andReturnWasThrottled:&wasThrottled withError:nil];
     if (!mt) {
-        return !wasThrottled;
-    }
-
-    //  - the forward/backward flag is very important because it could end up wasting a lot of resources to scan backwards if we're not sure.
-    if (doForward || ![self hasPriorGapsInHistory]) {
-        [self populateAPIForMostRecentRequest:mt];
-    }
-    else {
-        [self populateAPIForPastGapsOrMostRecentRequest:mt];
-    }
-    
-    // - try to schedule it
-    if (![feed addCollectorRequestWithAPI:mt andReturnWasThrottled:&wasThrottled withError:nil]) {
-        return !wasThrottled;
+        if (!wasThrottled) {
+            return YES;
+        }
+        
+        // - when throttled, wait in line for the mentions instead of skipping them until the next refresh.
+        return [self scheduleTimelineAPIForName:@"CS_tapi_statuses_mentions_timeline" withPriority:CS_NTS_PRIORITY_NORMAL usingFeed:feed andCompletion:^(CS_tapi_statuses_timeline_base *api) {
+            [self issueMentionsTimelineAPI:(CS_tapi_statuses_mentions_timeline *) api usingFeed:feed];
+        }];
     }
-    
-    // - only permit one at a time.
-    [[self statsLock] lock];
-    inRequest = YES;
-    doForward = !doForward;         //  just alternate in the mentions to try to get everything.
-    [[self statsLock] unlock];
-    
-    return YES;
+    return [self issueMentionsTimelineAPI:mt usingFeed:feed];
 }
 
 /*
@@ -146,5 +135,34 @@
     inRequest = NO;
     doForward = YES;
 }
+
+/*
+ *  Fill in the mentions timeline request and issue it.
+ *  - return NO when it is throttled.
+ */
+-(BOOL) issueMentionsTimelineAPI:(CS_tapi_statuses_mentions_timeline *) mt usingFeed:(CS_twitterFeed *) feed
+{
+    //  - the forward/backward flag is very important because it could end up wasting a lot of resources to scan backwards if we're not sure.
+    if (doForward || ![self hasPriorGapsInHistory]) {
+        [self populateAPIForMostRecentRequest:mt];
+    }
+    else {
+        [self populateAPIForPastGapsOrMostRecentRequest:mt];
+    }
+    
+    // - try to schedule it
+    BOOL wasThrottled = NO;
+    if (![feed addCollectorRequestWithAPI:mt andReturnWasThrottled:&wasThrottled withError:nil]) {
+        return !wasThrottled;
+    }
+    
+    // - only permit one at a time.
+    [[self statsLock] lock];
+    inRequest = YES;
+    doForward = !doForward;         //  just alternate in the mentions to try to get everything.
+    [[self statsLock] unlock];
+    
+    return YES;
+}
 @end
 
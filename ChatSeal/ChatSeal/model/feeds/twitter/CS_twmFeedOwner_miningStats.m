@@ -18,6 +18,7 @@ static const NSUInteger CS_TWM_FO_MAX_BACK_QUERIES = 3;
 // - forward declarations
 @interface CS_twmFeedOwner_miningStats (internal)
 -(void) commonConfiguration;
+-(BOOL) issueHomeTimelineAPI:(CS_tapi_statuses_home_timeline *) ht asForwardRequest:(BOOL) isForward usingFeed:(CS_twitterFeed *) feed;
 @end
 
 /*******************************
@@ -74,7 +75,8 @@ static const NSUInteger CS_TWM_FO_MAX_BACK_QUERIES = 3;
 {
     // - REMEMBER: this is an OVERRIDE of the base because a feed owner has special requirements.
     [[self statsLock] lock];
-        if (inRequest) {
+        if (inRequest || [self hasScheduledTimelineAPI]) {
+            [[self statsLock] unlock];
             return YES;
         }
     
@@ -90,39 +92,16 @@ static const NSUInteger CS_TWM_FO_MAX_BACK_QUERIES = 3;
     BOOL wasThrottled                  = NO;
     CS_tapi_statuses_home_timeline *ht = (CS_tapi_statuses_home_timeline *) [feed evenlyDistributedApiForName:@"CS_tapi_statuses_home_timeline" andReturnWasThrottled:&wasThrottled withError:nil];
     if (!ht) {
-        return !wasThrottled;
-    }
-    
-    //  - the forward/backward flag is very important because it could end up wasting a lot of resources to scan backwards if we're not sure..
-    if (isForward) {
-        [self populateAPIForMostRecentRequest:ht];
-    }
-    else {
-        [self populateAPIForPastGapsOrMostRecentRequest:ht];
-    }
-    
-    // - the back-query count is used to ensure that we don't perform them at the expense of the current home timeline and recent content.
-    [[self statsLock] lock];
-    if (isForward) {
-        numBackQueries = 0;
-    }
-    else {
-        numBackQueries++;
-    }
-    [[self statsLock] unlock];
-
-    
-    // - try to schedule it
-    if (![feed addCollectorRequestWithAPI:ht andReturnWasThrottled:&wasThrottled withError:nil]) {
-        return !wasThrottled;
+        if (!wasThrottled) {
+            return YES;
+        }
+        
+        // - the home timeline is our primary view of content, so when it is throttled, wait in line for it.
+        return [self scheduleTimelineAPIForName:@"CS_tapi_statuses_home_timeline" withPriority:CS_NTS_PRIORITY_NORMAL usingFeed:feed andCompletion:^(CS_tapi_statuses_timeline_base *api) {
+            [self issueHomeTimelineAPI:(CS_tapi_statuses_home_timeline *) api asForwardRequest:isForward usingFeed:feed];
+        }];
     }
-    
-    // - only permit one at a time.
-    [[self statsLock] lock];
-        inRequest = YES;
-    [[self statsLock] unlock];
-    
-    return YES;
+    return [self issueHomeTimelineAPI:ht asForwardRequest:isForward usingFeed:feed];
 }
 
 /*
@@ -161,4 +140,42 @@ static const NSUInteger CS_TWM_FO_MAX_BACK_QUERIES = 3;
     inRequest      = NO;
     numBackQueries = 0;
 }
+
+/*
+ *  Fill in the home timeline request and issue it.
+ *  - return NO when it is throttled.
+ */
+-(BOOL) issueHomeTimelineAPI:(CS_tapi_statuses_home_timeline *) ht asForwardRequest:(BOOL) isForward usingFeed:(CS_twitterFeed *) feed
+{
+    //  - the forward/backward flag is very important because it could end up wasting a lot of resources to scan backwards if we're not sure..
+    if (isForward) {
+        [self populateAPIForMostRecentRequest:ht];
+    }
+    else {
+        [self populateAPIForPastGapsOrMostRecentRequest:ht];
+    }
+    
+    // - the back-query count is used to ensure that we don't perform them at the expense of the current home timeline and recent content.
+    [[self statsLock] lock];
+    if (isForward) {
+        numBackQueries = 0;
+    }
+    else {
+        numBackQueries++;
+    }
+    [[self statsLock] unlock];
+    
+    // - try to schedule it
+    BOOL wasThrottled = NO;
+    if (![feed addCollectorRequestWithAPI:ht andReturnWasThrottled:&wasThrottled withError:nil]) {
+        return !wasThrottled;
+    }
+    
+    // - only permit one at a time.
+    [[self statsLock] lock];
+        inRequest = YES;
+    [[self statsLock] unlock];
+    
+    return YES;
+}
 @end
@@ -13,6 +13,7 @@
 @interface CS_twmFriend_miningStats (internal)
 -(void) commonConfiguration;
 -(BOOL) attemptToScheduleQueryAsForward:(BOOL) isForward withFeed:(CS_twitterFeed *) feed;
+-(BOOL) issueUserTimelineAPI:(CS_tapi_statuses_user_timeline *) ut asForward:(BOOL) isForward withFeed:(CS_twitterFeed *) feed;
 @end
 
 /*********************************
@@ -138,7 +139,8 @@
     }
     
     [[self statsLock] lock];
-    if (numOutstanding == 2 || ![self screenName]) {
+    if (numOutstanding == 2 || ![self screenName] || [self hasScheduledTimelineAPI]) {
+        [[self statsLock] unlock];
         return YES;
     }
     [[self statsLock] unlock];
@@ -148,9 +150,24 @@
     BOOL wasThrottled                  = NO;
     CS_tapi_statuses_user_timeline *ut = (CS_tapi_statuses_user_timeline *) [feed evenlyDistributedApiForName:@"CS_tapi_statuses_user_timeline" andReturnWasThrottled:&wasThrottled withError:nil];
     if (!ut) {
-        return !wasThrottled;
+        if (!wasThrottled) {
+            return YES;
+        }
+        
+        // - these are speculative, so they wait behind everything else for capacity.
+        return [self scheduleTimelineAPIForName:@"CS_tapi_statuses_user_timeline" withPriority:CS_NTS_PRIORITY_BACKGROUND usingFeed:feed andCompletion:^(CS_tapi_statuses_timeline_base *api) {
+            [self issueUserTimelineAPI:(CS_tapi_statuses_user_timeline *) api asForward:isForward withFeed:feed];
+        }];
     }
-    
+    return [self issueUserTimelineAPI:ut asForward:isForward withFeed:feed];
+}
+
+/*
+ *  Fill in the user timeline request for this friend and issue it.
+ *  - return NO when it is throttled.
+ */
+-(BOOL) issueUserTimelineAPI:(CS_tapi_statuses_user_timeline *) ut asForward:(BOOL) isForward withFeed:(CS_twitterFeed *) feed
+{
     // - figure out which direction to query.
     if (isForward) {
         [self populateAPIForMostRecentRequest:ut];
@@ -172,6 +189,7 @@
     }
     
     // - try to schedule it
+    BOOL wasThrottled = NO;
     if (![feed addCollectorRequestWithAPI:ut andReturnWasThrottled:&wasThrottled withError:nil]) {
         // - make sure we complete the timeline request when we can't schedule others for the same range!
         [feed completeUserTimelineRequest:ut];
@@ -7,10 +7,12 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "CS_netTokenScheduler.h"
 
 @class CS_twitterFeed;
 @class CS_tapi_friendship_state;
 @class CS_tapi_statuses_timeline_base;
+typedef void (^CS_twmTimelineScheduledBlock)(CS_tapi_statuses_timeline_base *api);
 @interface CS_twmGenericUser_miningStats : NSObject <NSCoding>
 -(id) initWithScreenName:(NSString *) screenName;
 -(id) initWithMiningStats:(CS_twmGenericUser_miningStats *) stats;
@@ -27,4 +29,7 @@
 -(BOOL) populateAPIForPastGapsOrMostRecentRequest:(CS_tapi_statuses_timeline_base *) api;
 -(BOOL) hasPriorGapsInHistory;
 -(void) updateOnlyHistoryWithAPI:(CS_tapi_statuses_timeline_base *) api;
+-(BOOL) hasScheduledTimelineAPI;
+-(BOOL) scheduleTimelineAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio usingFeed:(CS_twitterFeed *) feed
+                     andCompletion:(CS_twmTimelineScheduledBlock) completion;
 @end
@@ -18,6 +18,7 @@ static const uint32_t       CS_TWM_PRIO_NOFOLLOW        = 10;
 static const uint32_t       CS_TWM_PRIO_SEALOWNER       = 5;
 static const uint32_t       CS_TWM_PRIO_TRUSTED         = 10;
 static const NSUInteger     CS_TWM_PRIO_TIME_BALANCE    = 5;       // every 5 seconds, we increase priority by 1 unit.
+static const NSTimeInterval CS_TWM_SCHEDULED_TIMEOUT    = 600.0;   // a queued request that hasn't been delivered in this time is assumed lost.
 static NSString            *CS_TWM_HIST_KEY             = @"h";
 static NSString            *CS_TWM_FOUND_KEY            = @"f";
 
@@ -41,6 +42,10 @@ static NSString            *CS_TWM_FOUND_KEY            = @"f";
     uint32_t                    computedPriority;
     CS_twmMiningStatsHistory    *statsHistory;
     NSInteger                   foundCount;
+    
+    BOOL                        isScheduled;
+    id                          scheduledRequest;
+    NSTimeInterval              tScheduled;
 }
 
 /*
@@ -102,6 +107,9 @@ static NSString            *CS_TWM_FOUND_KEY            = @"f";
     [lckStats release];
     lckStats = nil;
     
+    [scheduledRequest release];
+    scheduledRequest = nil;
+    
     [super dealloc];
 }
 
@@ -269,6 +277,74 @@ static NSString            *CS_TWM_FOUND_KEY            = @"f";
     return YES;
 }
 
+/*
+ *  Determine if a timeline request is queued in the central scheduler for this object.
+ */
+-(BOOL) hasScheduledTimelineAPI
+{
+    BOOL ret = NO;
+    [lckStats lock];
+    ret = isScheduled && ([NSDate timeIntervalSinceReferenceDate] - tScheduled) < CS_TWM_SCHEDULED_TIMEOUT;
+    [lckStats unlock];
+    return ret;
+}
+
+/*
+ *  When a timeline API is throttled, queue it in the central scheduler so that it is issued when there
+ *  is capacity instead of being skipped until the next refresh.
+ *  - only one request is ever queued for each object.
+ *  - the completion block may be executed on any thread, possibly before this returns, and is not
+ *    called if the API could not be generated.
+ *  - returns NO when the request could not be queued.
+ */
+-(BOOL) scheduleTimelineAPIForName:(NSString *) name withPriority:(cs_nts_priority_t) prio usingFeed:(CS_twitterFeed *) feed
+                     andCompletion:(CS_twmTimelineScheduledBlock) completion
+{
+    NSTimeInterval tNow = [NSDate timeIntervalSinceReferenceDate];
+    id staleRequest     = nil;
+    [lckStats lock];
+    if (isScheduled) {
+        if (tNow - tScheduled < CS_TWM_SCHEDULED_TIMEOUT) {
+            [lckStats unlock];
+            return YES;
+        }
+        
+        // - the request was likely discarded with the feed's account, so don't let it hold up the mining forever.
+        staleRequest     = [scheduledRequest autorelease];
+        scheduledRequest = nil;
+    }
+    isScheduled = YES;
+    tScheduled  = tNow;
+    [lckStats unlock];
+    
+    if (staleRequest) {
+        [feed cancelScheduledAPI:staleRequest];
+    }
+    
+    id request = [feed scheduleAPIForName:name withPriority:prio andCompletion:^(CS_netFeedAPI *api) {
+        [lckStats lock];
+        isScheduled = NO;
+        [scheduledRequest release];
+        scheduledRequest = nil;
+        [lckStats unlock];
+        
+        if ([api isKindOfClass:[CS_tapi_statuses_timeline_base class]] && completion) {
+            completion((CS_tapi_statuses_timeline_base *) api);
+        }
+    }];
+    
+    // - the request may have been delivered already, in which case there is nothing to track.
+    [lckStats lock];
+    if (!request) {
+        isScheduled = NO;
+    }
+    else if (isScheduled && !scheduledRequest) {
+        scheduledRequest = [request retain];
+    }
+    [lckStats unlock];
+    return request ? YES : NO;
+}
+
 /*
  *  Return a handle to the internal lock.
  */
@@ -343,8 +419,11 @@ static NSString            *CS_TWM_FOUND_KEY            = @"f";
 {
     // - I'm using a bare lock here to keep the critical sections as small as possible since this is accessed
     //   quite a lot for sorts and updates.
-    lckStats   = [[NSRecursiveLock alloc] init];
-    foundCount = 0;
+    lckStats         = [[NSRecursiveLock alloc] init];
+    foundCount       = 0;
+    isScheduled      = NO;
+    scheduledRequest = nil;
+    tScheduled       = 0.0;
 }
 
 /*
@@ -8,13 +8,22 @@
 
 #import "CS_twmMiningStatsHistory.h"
 #import "CS_tapi_statuses_timeline_base.h"
+#import "CS_twmTweetIntervalSet.h"
 
 //  THREADING-NOTES:
 //  - no locking is provided.
+//  - the history is tracked as numeric intervals and only converted to range objects when
+//    they are requested, so merging never compares tweet id strings.
 
 // - constants
 static const NSUInteger CS_TWM_MH_MAX_HISTORY = 5;
-static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
+static NSString        *CS_TWM_MH_KEY_HIST    = @"h";           //  legacy array of range objects.
+static NSString        *CS_TWM_MH_KEY_SPANS   = @"s";
+
+// - forward declarations
+@interface CS_twmMiningStatsHistory (internal)
+-(BOOL) getNewestLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh;
+@end
 
 /*******************************
  CS_twmMiningStatsHistory
@@ -24,8 +33,8 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  *  Object attributes.
  */
 {
-    NSMutableArray *maHistory;
-    NSTimeInterval tLastUpdate;         //  persistence is probably unnecessary for now.
+    CS_twmTweetIntervalSet *tisHistory;
+    NSTimeInterval         tLastUpdate;         //  persistence is probably unnecessary for now.
 }
 
 /*
@@ -43,7 +52,7 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
 {
     self = [super init];
     if (self) {
-        maHistory   = nil;
+        tisHistory  = [[CS_twmTweetIntervalSet alloc] init];
         tLastUpdate = 0;
     }
     return self;
@@ -54,10 +63,27 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  */
 -(id) initWithCoder:(NSCoder *)aDecoder
 {
-    self = [super init];
+    self = [self init];
     if (self) {
-        maHistory   = [[aDecoder decodeObjectForKey:CS_TWM_MH_KEY_HIST] retain];
-        tLastUpdate = 0;
+        NSData *dSpans = [aDecoder decodeObjectForKey:CS_TWM_MH_KEY_SPANS];
+        if (dSpans) {
+            CS_twmTweetIntervalSet *tis = [CS_twmTweetIntervalSet intervalSetFromData:dSpans withError:nil];
+            if (tis) {
+                [tisHistory release];
+                tisHistory = [tis retain];
+            }
+        }
+        else {
+            // - older archives saved the range objects themselves.
+            NSArray *arr = [aDecoder decodeObjectForKey:CS_TWM_MH_KEY_HIST];
+            for (CS_tapi_tweetRange *tr in arr) {
+                uint64_t minValue = 0;
+                uint64_t maxValue = 0;
+                if ([tr getMinValue:&minValue andMaxValue:&maxValue]) {
+                    [tisHistory addIntervalWithLow:minValue andHigh:maxValue];
+                }
+            }
+        }
     }
     return self;
 }
@@ -67,8 +93,8 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  */
 -(void) dealloc
 {
-    [maHistory release];
-    maHistory = nil;
+    [tisHistory release];
+    tisHistory = nil;
     [super dealloc];
 }
 
@@ -77,7 +103,7 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  */
 -(void) encodeWithCoder:(NSCoder *)aCoder
 {
-    [aCoder encodeObject:maHistory forKey:CS_TWM_MH_KEY_HIST];
+    [aCoder encodeObject:[tisHistory archiveData] forKey:CS_TWM_MH_KEY_SPANS];
 }
 
 /*
@@ -86,21 +112,27 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
 -(id) copyWithZone:(NSZone *)zone
 {
     CS_twmMiningStatsHistory *msCopy = [[CS_twmMiningStatsHistory allocWithZone:zone] init];
-    if (maHistory && msCopy) {
-        msCopy->maHistory = [[NSMutableArray alloc] init];
-        for (CS_tapi_tweetRange *tr in maHistory) {
-            [msCopy->maHistory addObject:[CS_tapi_tweetRange rangeForMin:tr.minTweetId andMax:tr.maxTweetId]];
-        }
+    if (msCopy) {
+        [msCopy->tisHistory release];
+        msCopy->tisHistory = [tisHistory copy];
     }
     return msCopy;
 }
 
 /*
- *  Return an array of all the processed items.
+ *  Return an array of all the processed items, most recent first.
  */
 -(NSArray *) processedHistory
 {
-    return [NSArray arrayWithArray:maHistory];
+    NSUInteger count   = [tisHistory count];
+    NSMutableArray *ma = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = count; i > 0; i--) {
+        uint64_t low  = 0;
+        uint64_t high = 0;
+        [tisHistory getIntervalAtIndex:i - 1 withLow:&low andHigh:&high];
+        [ma addObject:[CS_tapi_tweetRange rangeForMinValue:low andMaxValue:high]];
+    }
+    return ma;
 }
 
 /*
@@ -112,10 +144,6 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
         return;
     }
     
-    if (!maHistory) {
-        maHistory = [[NSMutableArray alloc] init];
-    }
-    
     // - by tracking the last update, we can use it to determine mining priority.  This does not
     //   need to be persisted!
     tLastUpdate = [[NSDate date] timeIntervalSinceReferenceDate];
@@ -151,7 +179,9 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
     }
     
     // - no range, then don't record anything.
-    if (!range.minTweetId || !range.maxTweetId) {
+    uint64_t minValue = 0;
+    uint64_t maxValue = 0;
+    if (![range getMinValue:&minValue andMaxValue:&maxValue]) {
         return;
     }
     
@@ -159,55 +189,12 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
     //   how much was returned.  That information will allow us to merge content accordingly.
     // - the goal is to keep a complete range of history that describes what has been retrieved so that if we have an opportunity
     //   to look at prior stuff, we can do so at some point.
-    NSUInteger insertIndex     = 0;
-    CS_tapi_tweetRange *trLast = nil;
-    for (insertIndex = 0; insertIndex < [maHistory count]; insertIndex++) {
-        CS_tapi_tweetRange *trCur = [maHistory objectAtIndex:insertIndex];
-        if ([range isAfter:trCur]) {
-            break;
-        }
-        trLast = trCur;
-    }
-    
-    // - when the new item is not first, ensure it shouldn't be merged with
-    //   the one that comes before it.
-    if (trLast && ([trLast isIntersectedBy:range] || [trLast isAdjacentToAndPreceding:range])) {
-        insertIndex--;
-        [trLast unionWith:range];
-        range = trLast;
-    }
-    else {
-        [maHistory insertObject:range atIndex:insertIndex];
-    }
-    
-    // - now merge the item with the rest.
-    NSMutableIndexSet *mis = nil;
-    for (NSUInteger i = insertIndex + 1; i < [maHistory count]; i++) {
-        CS_tapi_tweetRange *trCur = [maHistory objectAtIndex:i];
-        if (![range isIntersectedBy:trCur] && ![range isAdjacentToAndPreceding:trCur]) {
-            break;
-        }
-        
-        if (!mis) {
-            mis = [NSMutableIndexSet indexSet];
-        }
-        
-        [range unionWith:trCur];
-        [mis addIndex:i];
-    }
-    
-    // - delete anything we don't need any longer.
-    if (mis) {
-        [maHistory removeObjectsAtIndexes:mis];
-    }
+    [tisHistory addIntervalWithLow:minValue andHigh:maxValue];
     
     // - now make sure that we don't track anything beyond the maximum.   The notion here is that the maximum history
     //   accounts for content we may have seen many minutes ago and is probably not available on Twitter any more anyway since
-    //   we can only go back so far.  
-    NSUInteger count = [maHistory count];
-    if (count > CS_TWM_MH_MAX_HISTORY) {
-        [maHistory removeObjectsInRange:NSMakeRange(CS_TWM_MH_MAX_HISTORY, count - CS_TWM_MH_MAX_HISTORY)];
-    }
+    //   we can only go back so far.
+    [tisHistory trimToMostRecent:CS_TWM_MH_MAX_HISTORY];
 }
 
 /*
@@ -215,9 +202,9 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  */
 -(void) populateAPIForMostRecentRequest:(CS_tapi_statuses_timeline_base *) api
 {
-    if ([maHistory count]) {
-        CS_tapi_tweetRange *tr = [maHistory firstObject];
-        api.sinceTweetId       = tr.maxTweetId;
+    uint64_t newestHigh = 0;
+    if ([self getNewestLow:NULL andHigh:&newestHigh]) {
+        api.sinceTweetId = [NSString stringWithFormat:@"%llu", newestHigh];
     }
 }
 
@@ -229,31 +216,28 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
 -(BOOL) populateAPIForPastGapsOrMostRecentRequest:(CS_tapi_statuses_timeline_base *) api
 {
     // - if there is no history, then just do a standard forward request.
-    NSUInteger count = [maHistory count];
-    if (count) {
-        CS_tapi_tweetRange *trFirst = [maHistory firstObject];
-        unsigned long long lMinFirst = [CS_tapi_tweetRange tweetValueFromId:trFirst.minTweetId];
-        if (count == 1) {
-            // - when there is only one, we may default to moving forward or grabbing
-            //   everything up to the minimum we previously retrieved.
-            if ([trFirst.minTweetId isEqualToString:[CS_tapi_tweetRange absoluteMinimum]]) {
-                api.sinceTweetId = trFirst.maxTweetId;
-            }
-            else {
-                // - return less than the full range because the query is inclusive of the last item and that
-                //   will give us a false positive about the range's quality when we go to merge into history.
-                api.maxTweetId = [NSString stringWithFormat:@"%llu", lMinFirst ? lMinFirst - 1 : 0];
-                return YES;
-            }
-        }
-        else {
-            // - when there are two, we're shooting to fill the gap between the two items.
-            CS_tapi_tweetRange *trSecond = [maHistory objectAtIndex:1];
-            api.maxTweetId               = [NSString stringWithFormat:@"%llu", lMinFirst ? lMinFirst - 1 : 0];
-            api.sinceTweetId             = trSecond.maxTweetId;
-            return YES;
+    uint64_t newestHigh = 0;
+    if (![self getNewestLow:NULL andHigh:&newestHigh]) {
+        return NO;
+    }
+    
+    // - we're shooting to fill the most recent gap, which is either between the two newest intervals or everything
+    //   before the only one we have.
+    uint64_t absMin  = [CS_tapi_tweetRange absoluteMinimumValue];
+    uint64_t gapLow  = 0;
+    uint64_t gapHigh = 0;
+    if ([tisHistory findGapAtOrBelowValue:newestHigh withFloor:absMin returningLow:&gapLow andHigh:&gapHigh]) {
+        // - the max_id is inclusive, so it is the last item in the gap, but the since_id is exclusive and
+        //   must name the item before it.
+        api.maxTweetId = [NSString stringWithFormat:@"%llu", gapHigh];
+        if (gapLow > absMin) {
+            api.sinceTweetId = [NSString stringWithFormat:@"%llu", gapLow - 1];
         }
+        return YES;
     }
+    
+    // - when everything before the newest has been seen, just move forward.
+    api.sinceTweetId = [NSString stringWithFormat:@"%llu", newestHigh];
     return NO;
 }
 
@@ -262,11 +246,10 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
  */
 -(BOOL) hasPriorGapsInHistory
 {
-    if ([maHistory count]) {
-        CS_tapi_tweetRange *tr = [maHistory firstObject];
-        if (![tr.minTweetId isEqualToString:[CS_tapi_tweetRange absoluteMinimum]]) {
-            return YES;
-        }
+    uint64_t newestHigh = 0;
+    if ([self getNewestLow:NULL andHigh:&newestHigh] &&
+        [tisHistory findGapAtOrBelowValue:newestHigh withFloor:[CS_tapi_tweetRange absoluteMinimumValue] returningLow:NULL andHigh:NULL]) {
+        return YES;
     }
     return NO;
 }
@@ -279,3 +262,20 @@ static NSString        *CS_TWM_MH_KEY_HIST    = @"h";
     return [[NSDate date] timeIntervalSinceReferenceDate] - tLastUpdate;
 }
 @end
+
+/*********************************
+ CS_twmMiningStatsHistory (internal)
+ *********************************/
+@implementation CS_twmMiningStatsHistory (internal)
+/*
+ *  Return the most recent interval in the history.
+ */
+-(BOOL) getNewestLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh
+{
+    NSUInteger count = [tisHistory count];
+    if (!count) {
+        return NO;
+    }
+    return [tisHistory getIntervalAtIndex:count - 1 withLow:pLow andHigh:pHigh];
+}
+@end
@@ -0,0 +1,25 @@
+//
+//  CS_twmTweetIntervalSet.h
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// - a set of inclusive tweet id intervals kept sorted in ascending order and always disjoint, so
+//   that adjacent or overlapping spans are coalesced as they are added.
+// - index zero is the oldest interval, which is the opposite of how the mining history reports them.
+@interface CS_twmTweetIntervalSet : NSObject <NSCoding, NSCopying>
++(CS_twmTweetIntervalSet *) intervalSet;
++(CS_twmTweetIntervalSet *) intervalSetFromData:(NSData *) d withError:(NSError **) err;
+-(NSData *) archiveData;
+-(NSUInteger) count;
+-(BOOL) getIntervalAtIndex:(NSUInteger) idx withLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh;
+-(NSUInteger) addIntervalWithLow:(uint64_t) low andHigh:(uint64_t) high;
+-(BOOL) containsValue:(uint64_t) value;
+-(BOOL) findGapAtOrBelowValue:(uint64_t) value withFloor:(uint64_t) floor returningLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh;
+-(void) trimToMostRecent:(NSUInteger) numIntervals;
+-(void) removeAllIntervals;
+@end
@@ -0,0 +1,459 @@
+//
+//  CS_twmTweetIntervalSet.m
+//  ChatSeal
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "CS_twmTweetIntervalSet.h"
+#import "ChatSeal.h"
+
+//  THREADING-NOTES:
+//  - no locking is provided.
+//  - the intervals are kept in a flat C array so that every search is a binary search over
+//    plain integers.  Insertions and merges shift the tail with a single memmove.
+
+// - constants
+static const NSUInteger CS_TWM_TIS_STD_CAPACITY = 8;
+static const uint8_t    CS_TWM_TIS_VERSION      = 1;
+static const NSUInteger CS_TWM_TIS_MAX_VARINT   = 10;
+static NSString        *CS_TWM_TIS_KEY_DATA     = @"d";
+
+// - a single inclusive interval.
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} cs_twm_interval_t;
+
+// - forward declarations
+@interface CS_twmTweetIntervalSet (internal)
+-(NSUInteger) firstIndexWithHighAtLeast:(uint64_t) value;
+-(NSUInteger) firstIndexWithLowAbove:(uint64_t) value;
+-(void) ensureCapacity:(NSUInteger) numRequired;
+-(BOOL) loadFromData:(NSData *) d withError:(NSError **) err;
+@end
+
+/*
+ *  Append a variable-length integer to the buffer.
+ */
+static void CS_twm_tis_appendVarint(NSMutableData *md, uint64_t value)
+{
+    uint8_t buf[CS_TWM_TIS_MAX_VARINT];
+    NSUInteger len = 0;
+    do {
+        uint8_t b = (uint8_t) (value & 0x7F);
+        value   >>= 7;
+        if (value) {
+            b |= 0x80;
+        }
+        buf[len++] = b;
+    } while (value);
+    [md appendBytes:buf length:len];
+}
+
+/*
+ *  Read a variable-length integer from the buffer.
+ */
+static BOOL CS_twm_tis_readVarint(const uint8_t *buf, NSUInteger len, NSUInteger *pos, uint64_t *value)
+{
+    uint64_t ret = 0;
+    for (NSUInteger i = 0; i < CS_TWM_TIS_MAX_VARINT && *pos < len; i++) {
+        uint8_t b = buf[(*pos)++];
+        ret      |= ((uint64_t) (b & 0x7F)) << (7 * i);
+        if (!(b & 0x80)) {
+            *value = ret;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+/***************************
+ CS_twmTweetIntervalSet
+ ***************************/
+@implementation CS_twmTweetIntervalSet
+/*
+ *  Object attributes.
+ */
+{
+    cs_twm_interval_t *intervals;
+    NSUInteger        numIntervals;
+    NSUInteger        capIntervals;
+}
+
+/*
+ *  Return an empty set.
+ */
++(CS_twmTweetIntervalSet *) intervalSet
+{
+    return [[[CS_twmTweetIntervalSet alloc] init] autorelease];
+}
+
+/*
+ *  Return a set decoded from its archived data.
+ */
++(CS_twmTweetIntervalSet *) intervalSetFromData:(NSData *) d withError:(NSError **) err
+{
+    CS_twmTweetIntervalSet *tis = [CS_twmTweetIntervalSet intervalSet];
+    if (![tis loadFromData:d withError:err]) {
+        return nil;
+    }
+    return tis;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) init
+{
+    self = [super init];
+    if (self) {
+        intervals    = NULL;
+        numIntervals = 0;
+        capIntervals = 0;
+    }
+    return self;
+}
+
+/*
+ *  Initialize from an archive.
+ */
+-(id) initWithCoder:(NSCoder *)aDecoder
+{
+    self = [self init];
+    if (self) {
+        NSData *d = [aDecoder decodeObjectForKey:CS_TWM_TIS_KEY_DATA];
+        if (d && ![self loadFromData:d withError:nil]) {
+            NSLog(@"CS:  Discarding an invalid tweet interval archive.");
+        }
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    if (intervals) {
+        free(intervals);
+        intervals = NULL;
+    }
+    numIntervals = 0;
+    capIntervals = 0;
+    [super dealloc];
+}
+
+/*
+ *  Encode to an archive.
+ */
+-(void) encodeWithCoder:(NSCoder *)aCoder
+{
+    [aCoder encodeObject:[self archiveData] forKey:CS_TWM_TIS_KEY_DATA];
+}
+
+/*
+ *  Create a copy.
+ */
+-(id) copyWithZone:(NSZone *)zone
+{
+    CS_twmTweetIntervalSet *tisCopy = [[CS_twmTweetIntervalSet allocWithZone:zone] init];
+    if (tisCopy && numIntervals) {
+        [tisCopy ensureCapacity:numIntervals];
+        memcpy(tisCopy->intervals, intervals, sizeof(cs_twm_interval_t) * numIntervals);
+        tisCopy->numIntervals = numIntervals;
+    }
+    return tisCopy;
+}
+
+/*
+ *  Return a description.
+ */
+-(NSString *) description
+{
+    NSMutableString *ms = [NSMutableString stringWithFormat:@"intervals(%lu):", (unsigned long) numIntervals];
+    for (NSUInteger i = 0; i < numIntervals; i++) {
+        [ms appendFormat:@" [%llu-%llu]", intervals[i].low, intervals[i].high];
+    }
+    return ms;
+}
+
+/*
+ *  Produce a compact binary representation of the set.
+ *  - each interval is stored as its distance from the end of the prior one followed by its width,
+ *    which keeps dense tweet ids to a handful of bytes apiece.
+ */
+-(NSData *) archiveData
+{
+    NSMutableData *md = [NSMutableData dataWithCapacity:1 + CS_TWM_TIS_MAX_VARINT + (numIntervals * 8)];
+    [md appendBytes:&CS_TWM_TIS_VERSION length:sizeof(CS_TWM_TIS_VERSION)];
+    CS_twm_tis_appendVarint(md, numIntervals);
+    uint64_t prevNext = 0;
+    for (NSUInteger i = 0; i < numIntervals; i++) {
+        CS_twm_tis_appendVarint(md, intervals[i].low - prevNext);
+        CS_twm_tis_appendVarint(md, intervals[i].high - intervals[i].low);
+        prevNext = intervals[i].high + 1;
+    }
+    return md;
+}
+
+/*
+ *  Return the number of disjoint intervals.
+ */
+-(NSUInteger) count
+{
+    return numIntervals;
+}
+
+/*
+ *  Retrieve the interval at the given index, in ascending order.
+ */
+-(BOOL) getIntervalAtIndex:(NSUInteger) idx withLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh
+{
+    if (idx >= numIntervals) {
+        return NO;
+    }
+    if (pLow) {
+        *pLow = intervals[idx].low;
+    }
+    if (pHigh) {
+        *pHigh = intervals[idx].high;
+    }
+    return YES;
+}
+
+/*
+ *  Add the inclusive interval to the set, merging it with any that it overlaps or touches.
+ *  - returns the index of the interval that now contains it.
+ */
+-(NSUInteger) addIntervalWithLow:(uint64_t) low andHigh:(uint64_t) high
+{
+    if (low > high) {
+        return NSNotFound;
+    }
+    
+    // - the merge window starts with the first interval that ends no earlier than the value just
+    //   before this one and stops before the first that begins after the value just beyond it.
+    NSUInteger idxStart = [self firstIndexWithHighAtLeast:low ? low - 1 : 0];
+    NSUInteger idxEnd   = (high == UINT64_MAX) ? numIntervals : [self firstIndexWithLowAbove:high + 1];
+    
+    // - nothing to merge with, so it is inserted in order.
+    if (idxStart >= idxEnd) {
+        [self ensureCapacity:numIntervals + 1];
+        if (idxStart < numIntervals) {
+            memmove(&(intervals[idxStart + 1]), &(intervals[idxStart]), sizeof(cs_twm_interval_t) * (numIntervals - idxStart));
+        }
+        intervals[idxStart].low  = low;
+        intervals[idxStart].high = high;
+        numIntervals++;
+        return idxStart;
+    }
+    
+    // - collapse the whole window into its first slot.
+    if (intervals[idxStart].low < low) {
+        low = intervals[idxStart].low;
+    }
+    if (intervals[idxEnd - 1].high > high) {
+        high = intervals[idxEnd - 1].high;
+    }
+    intervals[idxStart].low  = low;
+    intervals[idxStart].high = high;
+    
+    NSUInteger numMerged = idxEnd - idxStart - 1;
+    if (numMerged) {
+        if (idxEnd < numIntervals) {
+            memmove(&(intervals[idxStart + 1]), &(intervals[idxEnd]), sizeof(cs_twm_interval_t) * (numIntervals - idxEnd));
+        }
+        numIntervals -= numMerged;
+    }
+    return idxStart;
+}
+
+/*
+ *  Determine if the value is covered by an interval.
+ */
+-(BOOL) containsValue:(uint64_t) value
+{
+    NSUInteger idx = [self firstIndexWithHighAtLeast:value];
+    if (idx < numIntervals && intervals[idx].low <= value) {
+        return YES;
+    }
+    return NO;
+}
+
+/*
+ *  Find the most recent span of uncovered values that is no larger than the given value and no smaller
+ *  than the floor.
+ *  - the span is inclusive and is bounded by the neighboring intervals or the floor.
+ */
+-(BOOL) findGapAtOrBelowValue:(uint64_t) value withFloor:(uint64_t) floor returningLow:(uint64_t *) pLow andHigh:(uint64_t *) pHigh
+{
+    if (value < floor) {
+        return NO;
+    }
+    
+    // - when the value is covered, the gap ends just before the interval that covers it.
+    uint64_t gapHigh = value;
+    NSUInteger idx   = [self firstIndexWithHighAtLeast:value];
+    if (idx < numIntervals && intervals[idx].low <= value) {
+        if (intervals[idx].low == 0 || intervals[idx].low - 1 < floor) {
+            return NO;
+        }
+        gapHigh = intervals[idx].low - 1;
+    }
+    
+    // - the prior interval always ends before the gap because the set is coalesced.
+    uint64_t gapLow = idx ? intervals[idx - 1].high + 1 : 0;
+    if (gapLow < floor) {
+        gapLow = floor;
+    }
+    if (gapLow > gapHigh) {
+        return NO;
+    }
+    
+    if (pLow) {
+        *pLow = gapLow;
+    }
+    if (pHigh) {
+        *pHigh = gapHigh;
+    }
+    return YES;
+}
+
+/*
+ *  Discard all but the given number of most recent intervals.
+ */
+-(void) trimToMostRecent:(NSUInteger) numToKeep
+{
+    if (numIntervals <= numToKeep) {
+        return;
+    }
+    NSUInteger numToDrop = numIntervals - numToKeep;
+    if (numToKeep) {
+        memmove(intervals, &(intervals[numToDrop]), sizeof(cs_twm_interval_t) * numToKeep);
+    }
+    numIntervals = numToKeep;
+}
+
+/*
+ *  Empty the set.
+ */
+-(void) removeAllIntervals
+{
+    numIntervals = 0;
+}
+@end
+
+/***************************************
+ CS_twmTweetIntervalSet (internal)
+ ***************************************/
+@implementation CS_twmTweetIntervalSet (internal)
+/*
+ *  Return the index of the first interval whose high end is at least the value, which is the
+ *  count when there is none.
+ */
+-(NSUInteger) firstIndexWithHighAtLeast:(uint64_t) value
+{
+    NSUInteger lo = 0;
+    NSUInteger hi = numIntervals;
+    while (lo < hi) {
+        NSUInteger mid = lo + ((hi - lo) >> 1);
+        if (intervals[mid].high < value) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ *  Return the index of the first interval whose low end is greater than the value, which is the
+ *  count when there is none.
+ */
+-(NSUInteger) firstIndexWithLowAbove:(uint64_t) value
+{
+    NSUInteger lo = 0;
+    NSUInteger hi = numIntervals;
+    while (lo < hi) {
+        NSUInteger mid = lo + ((hi - lo) >> 1);
+        if (intervals[mid].low <= value) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ *  Make sure the interval array can hold the given number of items.
+ */
+-(void) ensureCapacity:(NSUInteger) numRequired
+{
+    if (numRequired <= capIntervals) {
+        return;
+    }
+    NSUInteger newCap = capIntervals ? capIntervals : CS_TWM_TIS_STD_CAPACITY;
+    while (newCap < numRequired) {
+        newCap <<= 1;
+    }
+    intervals    = (cs_twm_interval_t *) realloc(intervals, sizeof(cs_twm_interval_t) * newCap);
+    capIntervals = newCap;
+}
+
+/*
+ *  Replace the contents of the set with the archived data.
+ */
+-(BOOL) loadFromData:(NSData *) d withError:(NSError **) err
+{
+    const uint8_t *buf = (const uint8_t *) [d bytes];
+    NSUInteger len     = [d length];
+    NSUInteger pos     = 0;
+    uint64_t count     = 0;
+    if (len < sizeof(CS_TWM_TIS_VERSION) || buf[0] != CS_TWM_TIS_VERSION) {
+        [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"Unsupported tweet interval format."];
+        return NO;
+    }
+    pos++;
+    
+    // - every interval needs at least two bytes, which protects the allocation from a bad count.
+    if (!CS_twm_tis_readVarint(buf, len, &pos, &count) || count > (len - pos) / 2) {
+        [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"Invalid tweet interval count."];
+        return NO;
+    }
+    
+    numIntervals = 0;
+    [self ensureCapacity:(NSUInteger) count];
+    uint64_t prevNext = 0;
+    for (NSUInteger i = 0; i < (NSUInteger) count; i++) {
+        uint64_t delta = 0;
+        uint64_t width = 0;
+        if (!CS_twm_tis_readVarint(buf, len, &pos, &delta) ||
+            !CS_twm_tis_readVarint(buf, len, &pos, &width)) {
+            numIntervals = 0;
+            [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"Truncated tweet interval data."];
+            return NO;
+        }
+        
+        // - after the first, intervals must be separated by at least one value or they would
+        //   have been coalesced, and nothing may follow one that ends at the maximum.
+        if ((i && (!delta || prevNext == 0)) ||
+            delta > UINT64_MAX - prevNext ||
+            width > UINT64_MAX - (prevNext + delta)) {
+            numIntervals = 0;
+            [CS_error fillError:err withCode:CSErrorArchivalError andFailureReason:@"Invalid tweet interval sequence."];
+            return NO;
+        }
+        
+        intervals[i].low  = prevNext + delta;
+        intervals[i].high = intervals[i].low + width;
+        numIntervals++;
+        prevNext          = intervals[i].high + 1;
+    }
+    return YES;
+}
+@end
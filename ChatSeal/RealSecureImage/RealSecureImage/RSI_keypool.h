@@ -0,0 +1,25 @@
+//
+//  RSI_keypool.h
+//  RealSecureImage
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "RealSecureImage.h"
+
+//  - the key pool keeps spare public/private keypairs in the keychain so that seal creation doesn't
+//    have to wait for RSA generation.
+//  - the pool is refilled in the background by several workers at once and grows towards its maximum
+//    when keys are consumed more quickly than a single round of generation can replace them.
+//  - spare keys are never held anywhere but the keychain.  The pool only tracks their tags.
+@interface RSI_keypool : NSObject
++(void) setMinimumSpares:(NSUInteger) minSpares andMaximumSpares:(NSUInteger) maxSpares;
++(void) setMaximumConcurrentGenerators:(NSUInteger) maxGenerators;
++(void) startRefill;
++(void) stopRefill;
++(NSString *) takeSpareKeyTag;
++(void) recordSynchronousGeneration:(NSTimeInterval) tiGeneration;
++(RSIKeyPoolMetrics *) metrics;
+@end
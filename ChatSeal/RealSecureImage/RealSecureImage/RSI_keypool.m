@@ -0,0 +1,334 @@
+//
+//  RSI_keypool.m
+//  RealSecureImage
+//
+//  Created by Francis Grolemund on 8/27/14.
+//  Copyright (c) 2014 RealProven, LLC. All rights reserved.
+//
+
+#import "RSI_keypool.h"
+#import "RSI_pubcrypt.h"
+
+//  THREADING-NOTES:
+//  - internal locking is provided.
+//  - the pool state is only ever modified under the lock, but key generation happens outside of it so that
+//    callers taking keys never wait on RSA computation.
+
+//  - constants
+static NSString *RSI_KP_SPARE_PREFIX          = @"cachedKey";
+static const NSUInteger RSI_KP_DEFAULT_MIN    = 1;
+static const NSUInteger RSI_KP_DEFAULT_MAX    = 4;
+static const NSUInteger RSI_KP_MAX_GENERATORS = 4;
+static const double     RSI_KP_AVG_WEIGHT     = 0.25;                 //  weight of each new sample in the running averages.
+
+//  - local data
+static NSObject         *synchPool          = nil;
+static NSMutableArray   *maSpareTags        = nil;
+static dispatch_queue_t genQueue            = NULL;
+static BOOL             isRunning           = NO;
+static BOOL             hasScanned          = NO;
+static BOOL             isScanning          = NO;
+static NSUInteger       minSpares           = RSI_KP_DEFAULT_MIN;
+static NSUInteger       maxSpares           = RSI_KP_DEFAULT_MAX;
+static NSUInteger       maxGenerators       = 1;
+static NSUInteger       numInFlight         = 0;
+static NSUInteger       tagSequence         = 0;
+static NSUInteger       totalHits           = 0;
+static NSUInteger       totalMisses         = 0;
+static NSUInteger       totalGenerated      = 0;
+static NSUInteger       totalFailures       = 0;
+static NSTimeInterval   tiAvgGeneration     = 0.0;
+static NSTimeInterval   tiAvgConsumption    = 0.0;
+static NSTimeInterval   tiLastConsumption   = 0.0;
+
+//  - the metrics are a simple snapshot of the pool.
+@interface RSIKeyPoolMetrics (internal)
+-(id) initWithAvailable:(NSUInteger) available andGenerating:(NSUInteger) generating andTarget:(NSUInteger) target;
+@end
+
+//  - forward declarations
+@interface RSI_keypool (internal)
++(NSTimeInterval) averageWithPrior:(NSTimeInterval) tiPrior andSample:(NSTimeInterval) tiSample;
++(NSUInteger) targetSparesWithoutLock;
++(void) refillWithoutLock;
++(void) scanForExistingSpares;
++(void) generateSpare;
+@end
+
+/**************************
+ RSI_keypool
+ **************************/
+@implementation RSI_keypool
+/*
+ *  Initialize the module.
+ */
++(void) initialize
+{
+    synchPool     = [[NSObject alloc] init];
+    maSpareTags   = [[NSMutableArray alloc] init];
+    maxGenerators = MAX(1, MIN([[NSProcessInfo processInfo] activeProcessorCount], RSI_KP_MAX_GENERATORS));
+}
+
+/*
+ *  Assign the range the pool will keep filled.
+ *  - the pool always tries to keep the minimum available and will grow to the maximum while keys are
+ *    being consumed quickly.
+ */
++(void) setMinimumSpares:(NSUInteger) newMin andMaximumSpares:(NSUInteger) newMax
+{
+    @synchronized (synchPool) {
+        minSpares = newMin;
+        maxSpares = MAX(newMin, newMax);
+        [RSI_keypool refillWithoutLock];
+    }
+}
+
+/*
+ *  Assign the number of keys that may be generated at the same time.
+ */
++(void) setMaximumConcurrentGenerators:(NSUInteger) newMax
+{
+    @synchronized (synchPool) {
+        maxGenerators = MAX(1, newMax);
+        [RSI_keypool refillWithoutLock];
+    }
+}
+
+/*
+ *  Begin keeping the pool filled.
+ */
++(void) startRefill
+{
+    @synchronized (synchPool) {
+        if (!genQueue) {
+            genQueue = dispatch_queue_create("kp_async_gen", DISPATCH_QUEUE_CONCURRENT);
+        }
+        isRunning = YES;
+        [RSI_keypool refillWithoutLock];
+    }
+}
+
+/*
+ *  Stop generating new keys.
+ *  - any generation in progress will still complete and its keys are kept for later.
+ */
++(void) stopRefill
+{
+    @synchronized (synchPool) {
+        isRunning = NO;
+        if (genQueue) {
+            dispatch_release(genQueue);
+            genQueue = NULL;
+        }
+    }
+}
+
+/*
+ *  Remove a spare key from the pool and return its tag, or nil if none are available.
+ *  - the caller owns the key from this point forward.
+ */
++(NSString *) takeSpareKeyTag
+{
+    @synchronized (synchPool) {
+        NSTimeInterval tiNow = [NSDate timeIntervalSinceReferenceDate];
+        if (tiLastConsumption > 0.0) {
+            tiAvgConsumption = [RSI_keypool averageWithPrior:tiAvgConsumption andSample:tiNow - tiLastConsumption];
+        }
+        tiLastConsumption = tiNow;
+        
+        NSString *ret = nil;
+        if ([maSpareTags count]) {
+            ret = [[[maSpareTags objectAtIndex:0] retain] autorelease];
+            [maSpareTags removeObjectAtIndex:0];
+            totalHits++;
+        }
+        else {
+            totalMisses++;
+        }
+        [RSI_keypool refillWithoutLock];
+        return ret;
+    }
+}
+
+/*
+ *  When the pool is empty, the caller generates its own key and this records how long that took so
+ *  that the pool can better estimate how many it needs.
+ */
++(void) recordSynchronousGeneration:(NSTimeInterval) tiGeneration
+{
+    @synchronized (synchPool) {
+        tiAvgGeneration = [RSI_keypool averageWithPrior:tiAvgGeneration andSample:tiGeneration];
+    }
+}
+
+/*
+ *  Return the current state of the pool.
+ */
++(RSIKeyPoolMetrics *) metrics
+{
+    @synchronized (synchPool) {
+        RSIKeyPoolMetrics *kpm = [[RSIKeyPoolMetrics alloc] initWithAvailable:[maSpareTags count] andGenerating:numInFlight
+                                                                     andTarget:[RSI_keypool targetSparesWithoutLock]];
+        return [kpm autorelease];
+    }
+}
+@end
+
+/**************************
+ RSI_keypool (internal)
+ **************************/
+@implementation RSI_keypool (internal)
+/*
+ *  Fold a new sample into a running average.
+ */
++(NSTimeInterval) averageWithPrior:(NSTimeInterval) tiPrior andSample:(NSTimeInterval) tiSample
+{
+    if (tiPrior <= 0.0) {
+        return tiSample;
+    }
+    return (tiPrior * (1.0 - RSI_KP_AVG_WEIGHT)) + (tiSample * RSI_KP_AVG_WEIGHT);
+}
+
+/*
+ *  Figure out how many spares should be available right now.
+ *  - the goal is to have enough on hand to cover what will be consumed during the time it takes to
+ *    generate a replacement.
+ *  - the time since the last key was taken counts towards the consumption interval so that the pool
+ *    shrinks back to its minimum when the burst is over.
+ */
++(NSUInteger) targetSparesWithoutLock
+{
+    NSUInteger ret = minSpares;
+    if (tiAvgGeneration > 0.0 && tiAvgConsumption > 0.0) {
+        NSTimeInterval tiInterval = MAX(tiAvgConsumption, [NSDate timeIntervalSinceReferenceDate] - tiLastConsumption);
+        ret += (NSUInteger) ceil(tiAvgGeneration / MAX(tiInterval, 0.001));
+    }
+    return MIN(ret, maxSpares);
+}
+
+/*
+ *  Start as many generators as are needed to reach the target.
+ *  - the first refill looks for spares that were left in the keychain by an earlier session.
+ */
++(void) refillWithoutLock
+{
+    if (!isRunning || !genQueue || isScanning) {
+        return;
+    }
+    
+    if (!hasScanned) {
+        isScanning = YES;
+        dispatch_async(genQueue, ^(void) {
+            [RSI_keypool scanForExistingSpares];
+        });
+        return;
+    }
+    
+    NSUInteger target = [RSI_keypool targetSparesWithoutLock];
+    while ([maSpareTags count] + numInFlight < target && numInFlight < maxGenerators) {
+        numInFlight++;
+        dispatch_async(genQueue, ^(void) {
+            [RSI_keypool generateSpare];
+        });
+    }
+}
+
+/*
+ *  Find any spare keys already in the keychain.
+ */
++(void) scanForExistingSpares
+{
+    NSError *tmp = nil;
+    NSArray *arrAllKeys = [RSI_pubcrypt findAllKeyTagsForPublic:NO withError:&tmp];
+    if (!arrAllKeys) {
+        NSLog(@"RSI: Async key generation failed to find all private keys.  %@", [tmp localizedDescription]);
+    }
+    
+    @synchronized (synchPool) {
+        for (NSString *keyTag in arrAllKeys) {
+            NSRange r = [keyTag rangeOfString:RSI_KP_SPARE_PREFIX];
+            if (r.location == 0 && [maSpareTags indexOfObject:keyTag] == NSNotFound) {
+                [maSpareTags addObject:keyTag];
+            }
+        }
+        
+        // - a failed scan is not retried because generating new spares is always safe.
+        hasScanned = YES;
+        isScanning = NO;
+        [RSI_keypool refillWithoutLock];
+    }
+}
+
+/*
+ *  Generate one new spare key and add it to the pool.
+ */
++(void) generateSpare
+{
+    NSString *keyTag = nil;
+    @synchronized (synchPool) {
+        keyTag = [NSString stringWithFormat:@"%@.%ld.%lu", RSI_KP_SPARE_PREFIX, time(NULL), (unsigned long) ++tagSequence];
+    }
+    
+    NSError *tmp          = nil;
+    NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+    RSI_pubcrypt *pk      = [RSI_pubcrypt allocNewUniqueKeyForTag:keyTag withError:&tmp];
+    NSTimeInterval tiGen  = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    @synchronized (synchPool) {
+        numInFlight--;
+        if (pk) {
+            [maSpareTags addObject:keyTag];
+            totalGenerated++;
+            tiAvgGeneration = [RSI_keypool averageWithPrior:tiAvgGeneration andSample:tiGen];
+            [RSI_keypool refillWithoutLock];
+        }
+        else {
+            // - don't immediately retry because whatever caused this is likely to cause it again.
+            NSLog(@"RSI: Async key generation failed.  %@", [tmp localizedDescription]);
+            totalFailures++;
+        }
+    }
+    [pk release];
+}
+@end
+
+/**************************
+ RSIKeyPoolMetrics
+ **************************/
+@implementation RSIKeyPoolMetrics
+@synthesize numAvailable;
+@synthesize numGenerating;
+@synthesize targetSpares;
+@synthesize numHits;
+@synthesize numMisses;
+@synthesize numGenerated;
+@synthesize numFailures;
+@synthesize averageGenerationTime;
+@synthesize averageConsumptionInterval;
+@end
+
+/*****************************
+ RSIKeyPoolMetrics (internal)
+ *****************************/
+@implementation RSIKeyPoolMetrics (internal)
+/*
+ *  Initialize the object.
+ *  - ASSUMES the pool lock is held.
+ */
+-(id) initWithAvailable:(NSUInteger) available andGenerating:(NSUInteger) generating andTarget:(NSUInteger) target
+{
+    self = [super init];
+    if (self) {
+        numAvailable               = available;
+        numGenerating              = generating;
+        targetSpares               = target;
+        numHits                    = totalHits;
+        numMisses                  = totalMisses;
+        numGenerated               = totalGenerated;
+        numFailures                = totalFailures;
+        averageGenerationTime      = tiAvgGeneration;
+        averageConsumptionInterval = tiAvgConsumption;
+    }
+    return self;
+}
+@end
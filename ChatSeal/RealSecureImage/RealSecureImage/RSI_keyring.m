@@ -15,10 +15,10 @@
 #import "RSI_pack.h"
 #import "RSI_unpack.h"
 #import "RSI_secure_props.h"
+#import "RSI_keypool.h"
 
 //  - local data
 static NSString *RSI_SR_TMP_KEY            = @"tmpkey";
-static NSString *RSI_SR_CACHED_KEY         = @"cachedKey";
 static NSString *RSI_SR_PROP_ID            = @"id";
 static NSString *RSI_SR_PROP_SYMKEY        = @"symk";
 static NSString *RSI_SR_PROP_PUBKEY        = @"pubk";
@@ -32,10 +32,7 @@ static NSString *RSI_SCRAMI_CODER_FLAG     = @"isuiimage";
 static NSObject       *synchKeyring        = nil;
 static NSMutableArray *maKeyringCache      = nil;
 
-static NSMutableArray   *sparePubKeys      = nil;
-static dispatch_queue_t asyncGenQueue      = NULL;
-static NSObject         *genLock           = nil;
-static BOOL             isAsyncGenerating  = NO;
+static NSObject       *synchCreate         = nil;
 
 //  - a simple container for caching keyring attributes
 @interface RSI_cached_keyring : NSObject
@@ -86,7 +83,6 @@ typedef enum
 -(RSI_scrambled_image *) scrambleImage:(UIImage *) img withScrambler:(RSI_scrambler *) scram andError:(NSError **) err;
 -(RSI_scrambled_image *) scrambleJPEG:(NSData *) jpeg withScrambler:(RSI_scrambler *) scram andError:(NSError **) err;
 -(NSDictionary *) decryptMessageProperties:(NSArray *) props forType:(rsi_keyring_msg_t) msgType withError:(NSError **) err;
-+(void) generateSparePublicKey;
 +(NSMutableDictionary *) buildExportForExternal:(BOOL) forExternal andSeal:(NSString *) sealId andSymKey:(RSI_symcrypt *) symk andPubKey:(RSI_pubcrypt *) pubk
                                   andAttributes:(RSI_securememory *) attribs andScramblerData:(RSI_securememory *) scramData withError:(NSError **) err;
 +(BOOL) isSealInCache:(NSString *) sealId;
@@ -115,9 +111,8 @@ typedef enum
  */
 +(void) initialize
 {
-    // - the pub keys array will be used for synchronization also.
-    sparePubKeys = [[NSMutableArray alloc] init];
-    genLock      = [[NSObject alloc] init];
+    // - seal creation uses temporary keys with fixed names, so only one can occur at a time.
+    synchCreate  = [[NSObject alloc] init];
     
     // - accesses to the common keyring cache use this object.
     synchKeyring = [[NSObject alloc] init];
@@ -180,27 +175,15 @@ typedef enum
         NSString     *newSid = nil;
         
         //  - create temporary versions that we can export.        
-        @synchronized (sparePubKeys) {
+        @synchronized (synchCreate) {
             //  - first attempt to pull a cached key
-            NSString *pubKeyLabel = nil;
-            if ([sparePubKeys count]) {
-               pubKeyLabel = [sparePubKeys objectAtIndex:0];
-                NSRange r = [pubKeyLabel rangeOfString:RSI_SR_CACHED_KEY];
-                if (r.location == 0) {
-                    [[pubKeyLabel retain] autorelease];
-                    [sparePubKeys removeObjectAtIndex:0];
-                    pubPrv = [RSI_pubcrypt allocExistingKeyForTag:pubKeyLabel withError:&tmp];
-                    if (!pubPrv) {
-                        //  - delete it in case it was some sort of corruption that caused the failure.                        
-                        NSLog(@"RSI: Failed to allocate the existing cached key.  %@", [tmp localizedDescription]);
-                        [RSI_pubcrypt deleteKeyWithTag:pubKeyLabel withError:nil];
-                        pubKeyLabel = nil;
-                    }
-                }
-                else {
-                    // - this shouldn't happen but could mean a serious issue is wrong with the caching and
-                    //   we would never want to accidentally delete it.
-                    NSLog(@"RSI: Invalid cached seal identified --> %@", pubKeyLabel);
+            NSString *pubKeyLabel = [RSI_keypool takeSpareKeyTag];
+            if (pubKeyLabel) {
+                pubPrv = [RSI_pubcrypt allocExistingKeyForTag:pubKeyLabel withError:&tmp];
+                if (!pubPrv) {
+                    //  - delete it in case it was some sort of corruption that caused the failure.                        
+                    NSLog(@"RSI: Failed to allocate the existing cached key.  %@", [tmp localizedDescription]);
+                    [RSI_pubcrypt deleteKeyWithTag:pubKeyLabel withError:nil];
                     pubKeyLabel = nil;
                 }
             }
@@ -209,7 +192,11 @@ typedef enum
             if (!pubPrv) {
                 pubKeyLabel = RSI_SR_TMP_KEY;
                 [RSI_pubcrypt deleteKeyWithTag:RSI_SR_TMP_KEY withError:nil];                
+                NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
                 pubPrv = [RSI_pubcrypt allocNewKeyForPublicLabel:pubKeyLabel andPrivateLabel:pubKeyLabel andTag:pubKeyLabel withError:&tmp];
+                if (pubPrv) {
+                    [RSI_keypool recordSynchronousGeneration:[NSDate timeIntervalSinceReferenceDate] - tStart];
+                }
             }
             
             if (pubPrv) {
@@ -770,23 +757,15 @@ typedef enum
 }
 
 /*
- *  Nearly all the cost associated with seal creation is tied up in the public key generation.  Keep a
- *  spare lying around at all times in order to guarantee that seals can be created quickly.
+ *  Nearly all the cost associated with seal creation is tied up in the public key generation.  Keep
+ *  spares lying around at all times in order to guarantee that seals can be created quickly.
  *  - I initially did this automatically after keyring construction but found that the needs of the app
  *    required more precise control over when this was performed.
+ *  - once started, the pool refills itself as keys are consumed.
  */
 +(void) prepareForSealGeneration
 {
-    @synchronized (genLock)
-    {
-        if (!asyncGenQueue) {
-            asyncGenQueue = dispatch_queue_create("kr_async_gen", NULL);
-        }
-        if (isAsyncGenerating) {
-            return;
-        }
-    }
-    [RSI_keyring generateSparePublicKey];
+    [RSI_keypool startRefill];
 }
 
 /*
@@ -794,12 +773,7 @@ typedef enum
  */
 +(void) stopAsyncCompute
 {
-    @synchronized (genLock) {
-        if (asyncGenQueue) {
-            dispatch_release(asyncGenQueue);
-            asyncGenQueue = NULL;
-        }
-    }
+    [RSI_keypool stopRefill];
 }
 
 /*
@@ -1307,7 +1281,7 @@ typedef enum
     //  - the public key is used for producer/consumer communication
     RSI_pubcrypt *pubk = nil;
     if (msgType != RSI_SECPROP_MSG_LOCAL) {
-        pubk = [[RSI_pubcrypt allocExistingKeyForTag:sealId withError:&tmp] autorelease];
+        pubk = [RSI_pubcrypt cachedKeyForTag:sealId withError:&tmp];
         if (!pubk) {
             [RSI_error fillError:err withCode:RSIErrorInvalidSeal andFailureReason:[tmp localizedDescription]];
             return nil;
@@ -1390,73 +1364,6 @@ typedef enum
     return (NSDictionary *) [self modifyCollection:ret withScrambler:scram andDoScramble:NO andError:err];
 }
 
-/*
- *  During seal creation, the generation of the public/private keypair takes the longest amount of time
- *  so we're going to create them asynchronously in order to ensure they are available quickly
- *  when they are needed.
- */
-+(void) generateSparePublicKey
-{
-    @synchronized (genLock) {
-        if (!asyncGenQueue || isAsyncGenerating) {
-            return;
-        }
-        
-        // - don't bother with the async call if we already have spare keys.
-        @synchronized (sparePubKeys) {
-            if ([sparePubKeys count]) {
-                return;
-            }
-        }
-        
-        isAsyncGenerating = YES;
-        dispatch_async(asyncGenQueue, ^(void) {
-            //  - hold onto the container so that the thread creating seals is synchronized.
-            //  - btw, we do need a container instead of just a string because the object address must
-            //    remain constant between seal creations/destructions
-            @synchronized (sparePubKeys) {
-                NSError *tmp = nil;
-                NSArray *arrAllKeys = [RSI_pubcrypt findAllKeyTagsForPublic:NO withError:&tmp];
-                if (arrAllKeys) {
-                    //  - figure out if any of these keys are spares.
-                    for (NSUInteger i = 0; i < [arrAllKeys count]; i++) {
-                        NSString *keyTag = [arrAllKeys objectAtIndex:i];
-                        NSRange r = [keyTag rangeOfString:RSI_SR_CACHED_KEY];
-                        if (r.location == 0) {
-                            if ([sparePubKeys indexOfObject:keyTag] == NSNotFound) {
-                                [sparePubKeys addObject:keyTag];
-                            }
-                        }
-                    }
-                    
-                    // - if there are no spares in the array, we'll need to create one, otherwise, just use what is there.
-                    if ([sparePubKeys count] == 0) {
-                        //  - no keys in the array, so let's generate one.
-                        NSString *keyTag = [NSString stringWithFormat:@"%@.%ld", RSI_SR_CACHED_KEY, time(NULL)];
-                        RSI_pubcrypt *pk = [RSI_pubcrypt allocNewKeyForPublicLabel:keyTag andPrivateLabel:keyTag andTag:keyTag withError:&tmp];
-                        if (pk) {
-                            [sparePubKeys addObject:keyTag];
-                            [pk release];
-                        }
-                        else {
-                            NSLog(@"RSI: Async key generation failed.  %@", [tmp localizedDescription]);
-                        }
-                    }
-                }
-                else {
-                    NSLog(@"RSI: Async key generation failed to find all private keys.  %@", [tmp localizedDescription]);
-
-                }
-                
-                // - make sure the async generation flag is reset!
-                @synchronized (genLock) {
-                    isAsyncGenerating = NO;
-                }
-            }
-        });
-    }
-}
-
 /*
  *  Create a dictionary that can be used for exporting the keyring contents.
  */
@@ -11,11 +11,16 @@
 #import "RSI_securememory.h"
 
 //  - this class is used to manage all aspects of public key encryption.
+@class RSI_pubcrypt_op;
 @interface RSI_pubcrypt : NSObject
 +(NSUInteger) keySize;
 
 +(RSI_pubcrypt *) allocNewKeyForPublicLabel:(NSString *) publ andPrivateLabel:(NSString *) prvl andTag:(NSString *) tag withError:(NSError **) err;
++(RSI_pubcrypt *) allocNewUniqueKeyForTag:(NSString *) tag withError:(NSError **) err;
 +(RSI_pubcrypt *) allocExistingKeyForTag:(NSString *) tag withError:(NSError **) err;
++(RSI_pubcrypt *) cachedKeyForTag:(NSString *) tag withError:(NSError **) err;
++(void) releaseCachedKeys;
++(NSUInteger) performBatch:(NSArray *) arrOps;
 +(NSArray *) findAllKeyTagsForPublic:(BOOL) pubKeys withError:(NSError **) err;
 +(BOOL) deleteKeyAsPublic:(BOOL) pubKey andTag:(NSString *) tag withError:(NSError **) err;
 +(BOOL) deleteKeyWithTag:(NSString *) tag withError:(NSError **) err;
@@ -35,3 +40,13 @@
 -(BOOL) verify:(NSData *) dataBuffer withBuffer:(NSData *) signature withError:(NSError **) err;
 
 @end
+
+//  - a single verification or decryption that is performed as part of a batch.
+@interface RSI_pubcrypt_op : NSObject
++(RSI_pubcrypt_op *) verifyOperationForTag:(NSString *) tag withData:(NSData *) dataBuffer andSignature:(NSData *) signature;
++(RSI_pubcrypt_op *) decryptOperationForTag:(NSString *) tag withData:(NSData *) encryptedBuf;
+-(NSString *) tag;
+-(BOOL) succeeded;
+-(RSI_securememory *) clearData;
+-(NSError *) error;
+@end
@@ -12,13 +12,28 @@
 #import <CommonCrypto/CommonDigest.h>
 
 #define PUB_PRV_BITSIZE 2048
+#define PUB_MAX_CACHED  64
+
+//  - local data
+static NSObject            *synchCache   = nil;
+static NSMutableDictionary *mdCachedKeys = nil;
+static NSUInteger          cacheGen     = 0;
 
 //  - forward declarations
 @interface RSI_pubcrypt (internal)
 +(NSMutableDictionary *) dictionaryForPublic:(BOOL) pubKey andLabel:(NSString *) label andTag:(NSString *) tag andBeBrief:(BOOL) brief;
 -(id) initWithTag:(NSString *) t andPublic:(SecKeyRef) pubK andPrivate:(SecKeyRef) prvK;
++(RSI_pubcrypt *) allocNewKeyForPublicLabel:(NSString *) publ andPrivateLabel:(NSString *) prvl andTag:(NSString *) tag withExclusiveAccess:(BOOL) isExclusive
+                                   andError:(NSError **) err;
 +(BOOL) importKeyWithLabel:(NSString *) label andTag:(NSString *) tag andValue:(NSData *) keyData asPublic:(BOOL) ispub withError:(NSError **) err;
 +(BOOL) renameKeyWithLabel:(NSString *) oldLabel andTag:(NSString *) oldTag asPublic:(BOOL) ispub toNewLabel:(NSString *) newLabel andNewTag:(NSString *) newTag withError:(NSError **) err;
++(void) discardCachedKeyForTag:(NSString *) tag;
+@end
+
+@interface RSI_pubcrypt_op (internal)
+-(id) initWithTag:(NSString *) t andData:(NSData *) d andSignature:(NSData *) sig;
+-(void) performWithKey:(RSI_pubcrypt *) pk;
+-(void) setError:(NSError *) err;
 @end
 
 /***************************
@@ -34,6 +49,15 @@
     SecKeyRef privateKey;
 }
 
+/*
+ *  Initialize the module.
+ */
++(void) initialize
+{
+    synchCache   = [[NSObject alloc] init];
+    mdCachedKeys = [[NSMutableDictionary alloc] init];
+}
+
 /*
  *  Return the size (in bytes) of the key
  */
@@ -47,67 +71,18 @@
  */
 +(RSI_pubcrypt *) allocNewKeyForPublicLabel:(NSString *) publ andPrivateLabel:(NSString *) prvl andTag:(NSString *) tag withError:(NSError **) err;
 {
-    if (!tag || ![tag length]) {
-        [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
-        return nil;
-    }
-    
-    NSArray *arr = nil;
-    NSMutableDictionary *publicAttr = [RSI_pubcrypt dictionaryForPublic:YES andLabel:publ andTag:tag andBeBrief:NO];
-    NSMutableDictionary *privAttr = [RSI_pubcrypt dictionaryForPublic:NO andLabel:publ andTag:tag andBeBrief:NO];
-    
-    [publicAttr setObject:kSecMatchLimitAll forKey:kSecMatchLimit];
-    [privAttr setObject:kSecMatchLimitAll forKey:kSecMatchLimit];
-    
-    //  - first determine if either the public or private keys already exist
-    [RSI_common RDLOCK_KEYCHAIN];
-    OSStatus status = SecItemCopyMatching((CFDictionaryRef) publicAttr, (CFTypeRef *) &arr);
-    [RSI_common UNLOCK_KEYCHAIN];
-    if (arr) {
-        CFRelease((CFTypeRef *) arr);
-    }
-    if (status != errSecItemNotFound) {
-        [RSI_error fillError:err withCode:RSIErrorKeyExists];
-        return nil;
-    }
-    [RSI_common RDLOCK_KEYCHAIN];
-    status = SecItemCopyMatching((CFDictionaryRef) privAttr, (CFTypeRef *) &arr);
-    [RSI_common UNLOCK_KEYCHAIN];
-    if (arr) {
-        CFRelease((CFTypeRef *) arr);
-    }
-    if (status != errSecItemNotFound) {
-        [RSI_error fillError:err withCode:RSIErrorKeyExists];
-        return nil;
-    }
-    
-    //  - now start the process of constructing the key definition
-    NSMutableDictionary *keyAttr = [NSMutableDictionary dictionary];
-    [keyAttr setObject:kSecAttrKeyTypeRSA forKey:kSecAttrKeyType];
-    [keyAttr setObject:[NSNumber numberWithUnsignedInteger:PUB_PRV_BITSIZE] forKey:kSecAttrKeySizeInBits];
-    
-    [publicAttr removeObjectForKey:kSecMatchLimit];
-    [keyAttr setObject:publicAttr forKey:kSecPublicKeyAttrs];
-    
-    [privAttr removeObjectForKey:kSecMatchLimit];
-    [keyAttr setObject:privAttr forKey:kSecPrivateKeyAttrs];
-    
-    SecKeyRef pubK = 0;
-    SecKeyRef prvK = 0;
-    
-    [RSI_common WRLOCK_KEYCHAIN];
-    status = SecKeyGeneratePair((CFDictionaryRef) keyAttr, &pubK, &prvK);
-    [RSI_common UNLOCK_KEYCHAIN];
-    if (status != errSecSuccess) {
-        [RSI_error fillError:err withCode:RSIErrorKeychainFailure andKeychainStatus:status];
-        return nil;
-    }
-    
-    RSI_pubcrypt *pk = [[RSI_pubcrypt alloc] initWithTag:tag andPublic:pubK andPrivate:prvK];
-    CFRelease(pubK);
-    CFRelease(prvK);
-    
-    return pk;
+    return [RSI_pubcrypt allocNewKeyForPublicLabel:publ andPrivateLabel:prvl andTag:tag withExclusiveAccess:YES andError:err];
+}
+
+/*
+ *  Create a new public/private keypair with a tag that no other thread will ever use.
+ *  - because nobody else can be searching for or modifying this key while it is created, the generation
+ *    only needs to exclude changes to the keychain as a whole and can proceed alongside other
+ *    generators and readers.
+ */
++(RSI_pubcrypt *) allocNewUniqueKeyForTag:(NSString *) tag withError:(NSError **) err
+{
+    return [RSI_pubcrypt allocNewKeyForPublicLabel:tag andPrivateLabel:tag andTag:tag withExclusiveAccess:NO andError:err];
 }
 
 /*
@@ -163,6 +138,126 @@
     return pk;
 }
 
+/*
+ *  Return a shared key for the tag, which is loaded from the keychain only the first time it is requested.
+ *  - a seal's keys are consulted for every message it opens, so this avoids repeating the keychain
+ *    searches for each one.
+ *  - the cached keys are references only and never hold the key material itself.
+ *  - the keychain is searched outside the cache lock, so when a key is discarded during that search the
+ *    result is returned without being cached because it may describe a key that no longer exists.
+ */
++(RSI_pubcrypt *) cachedKeyForTag:(NSString *) tag withError:(NSError **) err
+{
+    if (!tag) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
+        return nil;
+    }
+    
+    NSUInteger genAtLoad = 0;
+    @synchronized (synchCache) {
+        RSI_pubcrypt *pk = [mdCachedKeys objectForKey:tag];
+        if (pk) {
+            return [[pk retain] autorelease];
+        }
+        genAtLoad = cacheGen;
+    }
+    
+    RSI_pubcrypt *pk = [RSI_pubcrypt allocExistingKeyForTag:tag withError:err];
+    if (!pk) {
+        return nil;
+    }
+    
+    @synchronized (synchCache) {
+        if (genAtLoad == cacheGen) {
+            if ([mdCachedKeys count] >= PUB_MAX_CACHED) {
+                [mdCachedKeys removeAllObjects];
+            }
+            [mdCachedKeys setObject:pk forKey:tag];
+        }
+    }
+    return [pk autorelease];
+}
+
+/*
+ *  Discard all the cached keys, which should occur whenever the keys should no longer be accessible.
+ */
++(void) releaseCachedKeys
+{
+    @synchronized (synchCache) {
+        [mdCachedKeys removeAllObjects];
+        cacheGen++;
+    }
+}
+
+/*
+ *  Perform a collection of operations, each of which records its own result.
+ *  - the keys are all loaded up front, once for each tag, and then the operations are distributed over
+ *    all of the available processors.
+ *  - an operation without a tag fails without being performed.
+ *  - returns the number of operations that succeeded.
+ */
++(NSUInteger) performBatch:(NSArray *) arrOps
+{
+    NSUInteger numOps = [arrOps count];
+    if (!numOps) {
+        return 0;
+    }
+    
+    NSMutableDictionary *mdKeys = [NSMutableDictionary dictionary];
+    RSI_pubcrypt **keys         = (RSI_pubcrypt **) malloc(sizeof(RSI_pubcrypt *) * numOps);
+    if (!keys) {
+        return 0;
+    }
+    
+    for (NSUInteger i = 0; i < numOps; i++) {
+        RSI_pubcrypt_op *op = [arrOps objectAtIndex:i];
+        if (!op.tag) {
+            NSError *tmp = nil;
+            [RSI_error fillError:&tmp withCode:RSIErrorInvalidArgument];
+            [op setError:tmp];
+            keys[i] = nil;
+            continue;
+        }
+        
+        NSObject *obj       = [mdKeys objectForKey:op.tag];
+        if (!obj) {
+            NSError *tmp = nil;
+            obj = [RSI_pubcrypt cachedKeyForTag:op.tag withError:&tmp];
+            if (!obj) {
+                obj = tmp ? tmp : [NSNull null];
+            }
+            [mdKeys setObject:obj forKey:op.tag];
+        }
+        
+        if ([obj isKindOfClass:[RSI_pubcrypt class]]) {
+            keys[i] = (RSI_pubcrypt *) obj;
+        }
+        else {
+            keys[i] = nil;
+            [op setError:[obj isKindOfClass:[NSError class]] ? (NSError *) obj : nil];
+        }
+    }
+    
+    // - the key objects are safe to share between threads because they are never modified after they
+    //   are created.
+    dispatch_apply(numOps, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (keys[i]) {
+            @autoreleasepool {
+                [(RSI_pubcrypt_op *) [arrOps objectAtIndex:i] performWithKey:keys[i]];
+            }
+        }
+    });
+    free(keys);
+    
+    NSUInteger ret = 0;
+    for (RSI_pubcrypt_op *op in arrOps) {
+        if (op.succeeded) {
+            ret++;
+        }
+    }
+    return ret;
+}
+
 /*
  *  A full key has both a public and private keypair.
  */
@@ -355,11 +450,13 @@
  */
 +(BOOL) deleteKeyAsPublic:(BOOL) pubKey andTag:(NSString *) tag withError:(NSError **) err
 {
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
     NSMutableDictionary *mdQuery = [RSI_pubcrypt dictionaryForPublic:pubKey andLabel:nil andTag:tag andBeBrief:YES];
     
     [RSI_common WRLOCK_KEYCHAIN];
     OSStatus status = SecItemDelete((CFDictionaryRef) mdQuery);
     [RSI_common UNLOCK_KEYCHAIN];
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
     if (status != errSecSuccess) {
         if (status == errSecItemNotFound) {
             [RSI_error fillError:err withCode:RSIErrorKeyNotFound];
@@ -555,6 +652,83 @@
     return mdRet;
 }
 
+/*
+ *  Create a new public/private keypair, optionally excluding every other keychain user while it
+ *  is generated.
+ */
++(RSI_pubcrypt *) allocNewKeyForPublicLabel:(NSString *) publ andPrivateLabel:(NSString *) prvl andTag:(NSString *) tag withExclusiveAccess:(BOOL) isExclusive
+                                   andError:(NSError **) err
+{
+    if (!tag || ![tag length]) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
+        return nil;
+    }
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
+    
+    NSArray *arr = nil;
+    NSMutableDictionary *publicAttr = [RSI_pubcrypt dictionaryForPublic:YES andLabel:publ andTag:tag andBeBrief:NO];
+    NSMutableDictionary *privAttr = [RSI_pubcrypt dictionaryForPublic:NO andLabel:publ andTag:tag andBeBrief:NO];
+    
+    [publicAttr setObject:kSecMatchLimitAll forKey:kSecMatchLimit];
+    [privAttr setObject:kSecMatchLimitAll forKey:kSecMatchLimit];
+    
+    //  - first determine if either the public or private keys already exist
+    [RSI_common RDLOCK_KEYCHAIN];
+    OSStatus status = SecItemCopyMatching((CFDictionaryRef) publicAttr, (CFTypeRef *) &arr);
+    [RSI_common UNLOCK_KEYCHAIN];
+    if (arr) {
+        CFRelease((CFTypeRef *) arr);
+    }
+    if (status != errSecItemNotFound) {
+        [RSI_error fillError:err withCode:RSIErrorKeyExists];
+        return nil;
+    }
+    [RSI_common RDLOCK_KEYCHAIN];
+    status = SecItemCopyMatching((CFDictionaryRef) privAttr, (CFTypeRef *) &arr);
+    [RSI_common UNLOCK_KEYCHAIN];
+    if (arr) {
+        CFRelease((CFTypeRef *) arr);
+    }
+    if (status != errSecItemNotFound) {
+        [RSI_error fillError:err withCode:RSIErrorKeyExists];
+        return nil;
+    }
+    
+    //  - now start the process of constructing the key definition
+    NSMutableDictionary *keyAttr = [NSMutableDictionary dictionary];
+    [keyAttr setObject:kSecAttrKeyTypeRSA forKey:kSecAttrKeyType];
+    [keyAttr setObject:[NSNumber numberWithUnsignedInteger:PUB_PRV_BITSIZE] forKey:kSecAttrKeySizeInBits];
+    
+    [publicAttr removeObjectForKey:kSecMatchLimit];
+    [keyAttr setObject:publicAttr forKey:kSecPublicKeyAttrs];
+    
+    [privAttr removeObjectForKey:kSecMatchLimit];
+    [keyAttr setObject:privAttr forKey:kSecPrivateKeyAttrs];
+    
+    SecKeyRef pubK = 0;
+    SecKeyRef prvK = 0;
+    
+    if (isExclusive) {
+        [RSI_common WRLOCK_KEYCHAIN];
+    }
+    else {
+        [RSI_common RDLOCK_KEYCHAIN];
+    }
+    status = SecKeyGeneratePair((CFDictionaryRef) keyAttr, &pubK, &prvK);
+    [RSI_common UNLOCK_KEYCHAIN];
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
+    if (status != errSecSuccess) {
+        [RSI_error fillError:err withCode:RSIErrorKeychainFailure andKeychainStatus:status];
+        return nil;
+    }
+    
+    RSI_pubcrypt *pk = [[RSI_pubcrypt alloc] initWithTag:tag andPublic:pubK andPrivate:prvK];
+    CFRelease(pubK);
+    CFRelease(prvK);
+    
+    return pk;
+}
+
 /*
  *  Initialize the object with a public and (an optional) private key
  */
@@ -607,6 +781,7 @@
         [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
         return NO;
     }
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
     
     NSMutableDictionary *dKeyDef = [RSI_pubcrypt dictionaryForPublic:ispub andLabel:label andTag:tag andBeBrief:NO];
     [dKeyDef setObject:[NSNumber numberWithUnsignedInteger:PUB_PRV_BITSIZE] forKey:kSecAttrKeySizeInBits];
@@ -615,6 +790,7 @@
     [RSI_common WRLOCK_KEYCHAIN];
     OSStatus status = SecItemAdd((CFDictionaryRef) dKeyDef, NULL);
     [RSI_common UNLOCK_KEYCHAIN];
+    [RSI_pubcrypt discardCachedKeyForTag:tag];
     if (status == errSecDuplicateItem) {
         [RSI_error fillError:err withCode:RSIErrorKeyExists];
         return NO;
@@ -636,6 +812,8 @@
         [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
         return NO;
     }
+    [RSI_pubcrypt discardCachedKeyForTag:oldTag];
+    [RSI_pubcrypt discardCachedKeyForTag:newTag];
     
     NSMutableDictionary *mdQuery = [RSI_pubcrypt dictionaryForPublic:ispub andLabel:oldLabel andTag:oldTag andBeBrief:YES];
     
@@ -647,6 +825,8 @@
     [RSI_common WRLOCK_KEYCHAIN];
     OSStatus status = SecItemUpdate((CFDictionaryRef) mdQuery, (CFDictionaryRef) mdToModify);
     [RSI_common UNLOCK_KEYCHAIN];
+    [RSI_pubcrypt discardCachedKeyForTag:oldTag];
+    [RSI_pubcrypt discardCachedKeyForTag:newTag];
     if (status == errSecItemNotFound) {
         [RSI_error fillError:err withCode:RSIErrorKeyNotFound andKeychainStatus:status];
         return NO;
@@ -657,6 +837,168 @@
     return YES;
 }
 
+/*
+ *  Remove a key from the cache because it is about to be changed or just was.
+ *  - this is done both before and after the keychain is modified so that a search that overlaps the change
+ *    is never cached.
+ */
++(void) discardCachedKeyForTag:(NSString *) tag
+{
+    if (!tag) {
+        return;
+    }
+    
+    @synchronized (synchCache) {
+        [mdCachedKeys removeObjectForKey:tag];
+        cacheGen++;
+    }
+}
+
+@end
+
+/***************************
+ RSI_pubcrypt_op
+ ***************************/
+@implementation RSI_pubcrypt_op
+/*
+ *  Object attributes.
+ */
+{
+    NSString         *tag;
+    NSData           *dData;
+    NSData           *dSignature;           //  only for verification.
+    BOOL             succeeded;
+    RSI_securememory *clearData;
+    NSError          *error;
+}
+
+/*
+ *  Return an operation that verifies a signature with the public key.
+ */
++(RSI_pubcrypt_op *) verifyOperationForTag:(NSString *) t withData:(NSData *) dataBuffer andSignature:(NSData *) signature
+{
+    return [[[RSI_pubcrypt_op alloc] initWithTag:t andData:dataBuffer andSignature:signature ? signature : [NSData data]] autorelease];
+}
+
+/*
+ *  Return an operation that decrypts a buffer with the private key.
+ */
++(RSI_pubcrypt_op *) decryptOperationForTag:(NSString *) t withData:(NSData *) encryptedBuf
+{
+    return [[[RSI_pubcrypt_op alloc] initWithTag:t andData:encryptedBuf andSignature:nil] autorelease];
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [tag release];
+    tag = nil;
+    
+    [dData release];
+    dData = nil;
+    
+    [dSignature release];
+    dSignature = nil;
+    
+    [clearData release];
+    clearData = nil;
+    
+    [error release];
+    error = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  The tag of the key used by the operation.
+ */
+-(NSString *) tag
+{
+    return [[tag retain] autorelease];
+}
+
+/*
+ *  Returns whether the operation completed successfully.
+ */
+-(BOOL) succeeded
+{
+    return succeeded;
+}
+
+/*
+ *  The result of a successful decryption.
+ */
+-(RSI_securememory *) clearData
+{
+    return [[clearData retain] autorelease];
+}
+
+/*
+ *  The reason the operation failed.
+ */
+-(NSError *) error
+{
+    return [[error retain] autorelease];
+}
+
+@end
+
+/***************************
+ RSI_pubcrypt_op (internal)
+ ***************************/
+@implementation RSI_pubcrypt_op (internal)
+/*
+ *  Initialize the object.
+ */
+-(id) initWithTag:(NSString *) t andData:(NSData *) d andSignature:(NSData *) sig
+{
+    self = [super init];
+    if (self) {
+        tag        = [t retain];
+        dData      = [d retain];
+        dSignature = [sig retain];
+        succeeded  = NO;
+        clearData  = nil;
+        error      = nil;
+    }
+    return self;
+}
+
+/*
+ *  Perform the operation with the given key.
+ *  - each operation is only ever performed by one thread.
+ */
+-(void) performWithKey:(RSI_pubcrypt *) pk
+{
+    NSError *tmp = nil;
+    if (dSignature) {
+        succeeded = [pk verify:dData withBuffer:dSignature withError:&tmp];
+    }
+    else {
+        RSI_securememory *secClear = [RSI_securememory data];
+        succeeded = [pk decrypt:dData intoBuffer:secClear withError:&tmp];
+        if (succeeded) {
+            clearData = [secClear retain];
+        }
+    }
+    
+    if (!succeeded) {
+        [self setError:tmp];
+    }
+}
+
+/*
+ *  Assign the reason for the failure.
+ */
+-(void) setError:(NSError *) err
+{
+    if (err != error) {
+        [error release];
+        error = [err retain];
+    }
+}
 @end
 
 
@@ -43,3 +43,9 @@
 -(BOOL) updateKeyWithData:(RSI_securememory *) newKeyData andError:(NSError **) err;
 
 @end
+
+// - shared with the library so that it can construct the public chunk cipher.
+@interface RSISecureChunkCipher (shared)
++(NSUInteger) minimumNonceLength;
+-(id) initWithKey:(RSI_securememory *) smKey andVersion:(uint16_t) v andSessionNonce:(NSData *) nonce;
+@end
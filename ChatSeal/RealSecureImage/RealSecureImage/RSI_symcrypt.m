@@ -8,6 +8,7 @@
 
 #import <CommonCrypto/CommonDigest.h>
 #import <CommonCrypto/CommonCryptor.h>
+#import <CommonCrypto/CommonHMAC.h>
 #import "RSI_symcrypt.h"
 #import "RSI_error.h"
 #import "RSI_common.h"
@@ -15,6 +16,13 @@
 //  - static data
 uint8_t blockInitVector[kCCBlockSizeAES128];      //  only used in the flawed ECB mode
 
+//  - constants
+static const char       *RSI_SC_CIPHER_LABEL = "RSI-chunk-cipher";
+static const char       *RSI_SC_AUTH_LABEL   = "RSI-chunk-auth";
+static const NSUInteger RSI_SC_IV_LEN        = kCCBlockSizeAES128;
+static const NSUInteger RSI_SC_MAC_LEN       = CC_SHA256_DIGEST_LENGTH;
+static const NSUInteger RSI_SC_MIN_NONCE_LEN = 16;
+
 //  - forward declarations
 @interface RSI_symcrypt (internal)
 
@@ -23,6 +31,11 @@ uint8_t blockInitVector[kCCBlockSizeAES128];      //  only used in the flawed EC
 +(NSMutableDictionary *) dictionaryForLabel:(NSString *) label andType:(NSUInteger) kt andTag:(NSString *) tag andBeBrief:(BOOL) brief;
 @end
 
+@interface RSISecureChunkCipher (internal)
++(RSI_securememory *) deriveKeyFromKey:(RSI_securememory *) smKey withLabel:(const char *) label andVersion:(uint16_t) v andNonce:(NSData *) nonce;
+-(void) authenticateBytes:(const uint8_t *) ptr ofLength:(NSUInteger) len atIndex:(uint64_t) idx intoCode:(uint8_t *) code;
+@end
+
 
 /***************************
  RSI_symcrypt
@@ -624,4 +637,189 @@ uint8_t blockInitVector[kCCBlockSizeAES128];      //  only used in the flawed EC
     return mdRet;
 }
 
-@end
\ No newline at end of file
+@end
+
+/************************
+ RSISecureChunkCipher
+ ************************/
+@implementation RSISecureChunkCipher
+/*
+ *  Object attributes.
+ */
+{
+    RSI_securememory *smCipherKey;
+    RSI_securememory *smAuthKey;
+    uint16_t         version;
+    uint64_t         numSealed;
+    uint64_t         numOpened;
+}
+
+/*
+ *  Return the most a chunk will grow when it is sealed.
+ *  - flags, the initialization vector, up to a full block of padding and the authentication code.
+ */
++(NSUInteger) chunkOverhead
+{
+    return 1 + RSI_SC_IV_LEN + kCCBlockSizeAES128 + RSI_SC_MAC_LEN;
+}
+
+/*
+ *  Return the shortest session nonce that is accepted.
+ */
++(NSUInteger) minimumNonceLength
+{
+    return RSI_SC_MIN_NONCE_LEN;
+}
+
+/*
+ *  Initialize the object.
+ */
+-(id) initWithKey:(RSI_securememory *) smKey andVersion:(uint16_t) v andSessionNonce:(NSData *) nonce
+{
+    self = [super init];
+    if (self) {
+        // - separate keys are used for encryption and authentication so that neither can weaken the other.
+        // - the sequence numbers restart with every session, so the nonce is what keeps a recorded session
+        //   from being replayed into a new one.
+        smCipherKey = [[RSISecureChunkCipher deriveKeyFromKey:smKey withLabel:RSI_SC_CIPHER_LABEL andVersion:v andNonce:nonce] retain];
+        smAuthKey   = [[RSISecureChunkCipher deriveKeyFromKey:smKey withLabel:RSI_SC_AUTH_LABEL andVersion:v andNonce:nonce] retain];
+        version     = v;
+        numSealed   = 0;
+        numOpened   = 0;
+    }
+    return self;
+}
+
+/*
+ *  Free the object.
+ */
+-(void) dealloc
+{
+    [smCipherKey release];
+    smCipherKey = nil;
+    
+    [smAuthKey release];
+    smAuthKey = nil;
+    
+    [super dealloc];
+}
+
+/*
+ *  Encrypt and authenticate the next chunk.
+ *  - the flags are not encrypted, but they are authenticated so the caller can use them to describe the chunk.
+ */
+-(NSData *) sealBytes:(const void *) ptr ofLength:(NSUInteger) len withFlags:(uint8_t) flags andError:(NSError **) err
+{
+    if (!ptr && len) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
+        return nil;
+    }
+    
+    NSUInteger maxLen    = len + [RSISecureChunkCipher chunkOverhead];
+    NSMutableData *mdRet = [NSMutableData dataWithLength:maxLen];
+    uint8_t *buf         = (uint8_t *) [mdRet mutableBytes];
+    buf[0]               = flags;
+    if (SecRandomCopyBytes(kSecRandomDefault, RSI_SC_IV_LEN, buf + 1) != 0) {
+        [RSI_error fillError:err withCode:RSIErrorCryptoFailure andFailureReason:@"Failed to get random memory."];
+        return nil;
+    }
+    
+    size_t lenMoved          = 0;
+    CCCryptorStatus ccStatus = CCCrypt(kCCEncrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, smCipherKey.bytes, [smCipherKey length], buf + 1,
+                                       ptr ? ptr : buf, len, buf + 1 + RSI_SC_IV_LEN, maxLen - (1 + RSI_SC_IV_LEN + RSI_SC_MAC_LEN), &lenMoved);
+    if (ccStatus != kCCSuccess) {
+        [RSI_error fillError:err withCode:RSIErrorCryptoFailure andCryptoStatus:ccStatus];
+        return nil;
+    }
+    
+    NSUInteger authLen = 1 + RSI_SC_IV_LEN + lenMoved;
+    [self authenticateBytes:buf ofLength:authLen atIndex:numSealed intoCode:buf + authLen];
+    [mdRet setLength:authLen + RSI_SC_MAC_LEN];
+    numSealed++;
+    return mdRet;
+}
+
+/*
+ *  Verify and decrypt the next chunk, appending its content to the buffer.
+ */
+-(BOOL) openChunk:(NSData *) dChunk appendingTo:(NSMutableData *) mdClear returningFlags:(uint8_t *) flags withError:(NSError **) err
+{
+    NSUInteger len = [dChunk length];
+    if (!mdClear || len < 1 + RSI_SC_IV_LEN + kCCBlockSizeAES128 + RSI_SC_MAC_LEN ||
+        (len - (1 + RSI_SC_IV_LEN + RSI_SC_MAC_LEN)) % kCCBlockSizeAES128) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidArgument andFailureReason:@"Invalid chunk length."];
+        return NO;
+    }
+    
+    // - nothing is decrypted until we know the chunk is authentic and in the right place.
+    const uint8_t *buf = (const uint8_t *) [dChunk bytes];
+    NSUInteger authLen = len - RSI_SC_MAC_LEN;
+    uint8_t code[RSI_SC_MAC_LEN];
+    [self authenticateBytes:buf ofLength:authLen atIndex:numOpened intoCode:code];
+    uint8_t diff = 0;
+    for (NSUInteger i = 0; i < RSI_SC_MAC_LEN; i++) {
+        diff |= (code[i] ^ buf[authLen + i]);
+    }
+    if (diff) {
+        [RSI_error fillError:err withCode:RSIErrorCryptoFailure andFailureReason:@"Chunk authentication failed."];
+        return NO;
+    }
+    
+    NSUInteger clearLen      = [mdClear length];
+    NSUInteger encryptedLen  = authLen - (1 + RSI_SC_IV_LEN);
+    [mdClear setLength:clearLen + encryptedLen];
+    size_t lenMoved          = 0;
+    CCCryptorStatus ccStatus = CCCrypt(kCCDecrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, smCipherKey.bytes, [smCipherKey length], buf + 1,
+                                       buf + 1 + RSI_SC_IV_LEN, encryptedLen, (uint8_t *) [mdClear mutableBytes] + clearLen, encryptedLen, &lenMoved);
+    if (ccStatus != kCCSuccess) {
+        [mdClear setLength:clearLen];
+        [RSI_error fillError:err withCode:RSIErrorCryptoFailure andCryptoStatus:ccStatus];
+        return NO;
+    }
+    [mdClear setLength:clearLen + lenMoved];
+    
+    numOpened++;
+    if (flags) {
+        *flags = buf[0];
+    }
+    return YES;
+}
+@end
+
+/*********************************
+ RSISecureChunkCipher (internal)
+ *********************************/
+@implementation RSISecureChunkCipher (internal)
+/*
+ *  Derive a purpose-specific key for one session from the master key.
+ */
++(RSI_securememory *) deriveKeyFromKey:(RSI_securememory *) smKey withLabel:(const char *) label andVersion:(uint16_t) v andNonce:(NSData *) nonce
+{
+    RSI_securememory *smRet = [RSI_securememory dataWithLength:CC_SHA256_DIGEST_LENGTH];
+    uint8_t verBuf[2]       = {(uint8_t) (v >> 8), (uint8_t) (v & 0xFF)};
+    CCHmacContext ctx;
+    CCHmacInit(&ctx, kCCHmacAlgSHA256, smKey.bytes, [smKey length]);
+    CCHmacUpdate(&ctx, label, strlen(label));
+    CCHmacUpdate(&ctx, verBuf, sizeof(verBuf));
+    CCHmacUpdate(&ctx, [nonce bytes], [nonce length]);
+    CCHmacFinal(&ctx, smRet.mutableBytes);
+    return smRet;
+}
+
+/*
+ *  Compute the authentication code for a chunk.
+ *  - the index is included so that chunks cannot be dropped, repeated or reordered without detection.
+ */
+-(void) authenticateBytes:(const uint8_t *) ptr ofLength:(NSUInteger) len atIndex:(uint64_t) idx intoCode:(uint8_t *) code
+{
+    uint8_t idxBuf[8];
+    for (int i = 0; i < 8; i++) {
+        idxBuf[i] = (uint8_t) (idx >> (56 - (i * 8)));
+    }
+    CCHmacContext ctx;
+    CCHmacInit(&ctx, kCCHmacAlgSHA256, smAuthKey.bytes, [smAuthKey length]);
+    CCHmacUpdate(&ctx, idxBuf, sizeof(idxBuf));
+    CCHmacUpdate(&ctx, ptr, len);
+    CCHmacFinal(&ctx, code);
+}
+@end
@@ -12,6 +12,7 @@
 #import "RSI_appkey.h"
 #import "RSI_secureseal.h"
 #import "RSI_common.h"
+#import "RSI_pubcrypt.h"
 
 //  - constants
 static NSString *RSI_VAULT_TEST_KEY = @"rsi-vver";
@@ -105,6 +106,9 @@ static NSMutableArray *maSealList     = nil;
         //    allow us to create seals.
         [RSI_seal stopAsyncCompute];
         
+        //  - the seal keys that were loaded for opening messages are discarded too.
+        [RSI_pubcrypt releaseCachedKeys];
+        
         //  - make sure that the credentials are invalidated
         //    in case there are outstanding references inside
         //    RSISecureSeal instances.
@@ -14,6 +14,8 @@
 @class RSISecureSeal;
 @class RSISecureData;
 @class RSISecureMessage;
+@class RSISecureChunkCipher;
+@class RSIKeyPoolMetrics;
 
 typedef enum
 {
@@ -49,6 +51,8 @@ typedef enum
 +(NSURL *) absoluteURLForVaultFile:(NSString *) fName withError:(NSError **) err;
 +(void) closeVault;
 +(void) prepareForSealGeneration;
++(void) setSealKeyPoolMinimum:(NSUInteger) minSpares andMaximum:(NSUInteger) maxSpares;
++(RSIKeyPoolMetrics *) sealKeyPoolMetrics;
 
 +(NSArray *) availableSealsWithError:(NSError **) err;
 +(NSDictionary *) safeSealIndexWithError:(NSError **) err;
@@ -63,6 +67,7 @@ typedef enum
 //  - generic encryption APIs
 +(NSData *) encryptArray:(NSArray *) arr forVersion:(uint16_t) v usingPassword:(NSString *) pwd withError:(NSError **) err;
 +(NSArray *) decryptIntoArray:(NSData *) dEncrypted forVersion:(uint16_t) v usingPassword:(NSString *) pwd withError:(NSError **) err;
++(RSISecureChunkCipher *) chunkCipherForVersion:(uint16_t) v usingPassword:(NSString *) pwd andSessionNonce:(NSData *) nonce withError:(NSError **) err;
 +(NSString *) secureHashForData:(NSData *) data;
 +(NSString *) safeSaltedStringAsHex:(NSString *) source withError:(NSError **) err;
 +(NSString *) safeSaltedStringAsBase64:(NSString *) source withError:(NSError **) err;
@@ -93,6 +98,7 @@ typedef enum
 +(BOOL) hasEnoughDataForSealIdentification:(NSData *) dPacked;
 +(RSISecureMessageIdentification *) quickPackedContentIdentification:(NSData *) dPacked;
 +(RSISecureMessage *) identifyPackedContent:(NSData *) dPacked withFullDecryption:(BOOL) fullDecryption andError:(NSError **) err;
++(RSISecureMessage *) identifyEncryptedContent:(NSData *) dEncrypted withFullDecryption:(BOOL) fullDecryption andError:(NSError **) err;
 @end
 
 /*****************************
@@ -139,6 +145,22 @@ typedef enum
 -(NSData *) rawData;
 @end
 
+/*****************************
+ RSISecureChunkCipher
+ *****************************/
+//  - a chunk cipher encrypts and authenticates a large payload one piece at a time so that neither
+//    side ever needs to hold all of it in encrypted form.
+//  - every chunk is numbered implicitly in the order it is sealed, which means that chunks must be
+//    opened in exactly that order or they will be rejected.   One object should be used for each
+//    direction of a conversation.
+//  - the keys depend on a session nonce as well as the password, so chunks recorded from one conversation
+//    are rejected in another as long as each side contributes fresh random data to the nonce.
+@interface RSISecureChunkCipher : NSObject
++(NSUInteger) chunkOverhead;
+-(NSData *) sealBytes:(const void *) ptr ofLength:(NSUInteger) len withFlags:(uint8_t) flags andError:(NSError **) err;
+-(BOOL) openChunk:(NSData *) dChunk appendingTo:(NSMutableData *) mdClear returningFlags:(uint8_t *) flags withError:(NSError **) err;
+@end
+
 /*****************************
  RSISecureMessage
  *****************************/
@@ -148,3 +170,20 @@ typedef enum
 @property (nonatomic, retain) NSString     *hash;
 @property (nonatomic, assign) BOOL         isProducerGenerated;
 @end
+
+/*****************************
+ RSIKeyPoolMetrics
+ *****************************/
+//  - a snapshot of the spare keys kept for seal creation.
+//  - a hit is a seal created with a spare and a miss is one that had to wait for its own key.
+@interface RSIKeyPoolMetrics : NSObject
+@property (nonatomic, readonly) NSUInteger     numAvailable;
+@property (nonatomic, readonly) NSUInteger     numGenerating;
+@property (nonatomic, readonly) NSUInteger     targetSpares;
+@property (nonatomic, readonly) NSUInteger     numHits;
+@property (nonatomic, readonly) NSUInteger     numMisses;
+@property (nonatomic, readonly) NSUInteger     numGenerated;
+@property (nonatomic, readonly) NSUInteger     numFailures;
+@property (nonatomic, readonly) NSTimeInterval averageGenerationTime;
+@property (nonatomic, readonly) NSTimeInterval averageConsumptionInterval;
+@end
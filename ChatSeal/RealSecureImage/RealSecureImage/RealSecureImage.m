@@ -17,6 +17,7 @@
 #import "RSI_secure_props.h"
 #import "RSI_seal.h"
 #import "RSI_jpeg.h"
+#import "RSI_keypool.h"
 
 // - forward declarations
 @interface RSISecureMessageIdentification (internal)
@@ -311,6 +312,23 @@
     [RSI_vault prepareForSealGeneration];
 }
 
+/*
+ *  Choose how many spare keypairs are kept ready for seal creation.  The pool stays at the minimum
+ *  normally and grows towards the maximum when seals are created in quick succession.
+ */
++(void) setSealKeyPoolMinimum:(NSUInteger) minSpares andMaximum:(NSUInteger) maxSpares
+{
+    [RSI_keypool setMinimumSpares:minSpares andMaximumSpares:maxSpares];
+}
+
+/*
+ *  Return a snapshot of the spare keypair pool.
+ */
++(RSIKeyPoolMetrics *) sealKeyPoolMetrics
+{
+    return [RSI_keypool metrics];
+}
+
 /*
  *  Get an enumeration of all the seals in the vault.
  */
@@ -458,6 +476,26 @@
     return arrRet;
 }
 
+/*
+ *  Create a cipher that encrypts a payload in individually-authenticated chunks using the supplied password.
+ *  - the password is hashed only once here, which is the expensive part.
+ *  - the nonce is unique to the session and ties the keys to it.
+ */
++(RSISecureChunkCipher *) chunkCipherForVersion:(uint16_t) v usingPassword:(NSString *) pwd andSessionNonce:(NSData *) nonce withError:(NSError **) err
+{
+    if (!pwd || [nonce length] < [RSISecureChunkCipher minimumNonceLength]) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidArgument];
+        return nil;
+    }
+    
+    RSI_securememory *smKey = [RSI_symcrypt symKeyFromPassword:pwd];
+    if (!smKey) {
+        [RSI_error fillError:err withCode:RSIErrorCryptoFailure andFailureReason:@"Failed to generate a password hash."];
+        return nil;
+    }
+    return [[[RSISecureChunkCipher alloc] initWithKey:smKey andVersion:v andSessionNonce:nonce] autorelease];
+}
+
 /*
  *  Return a string hash for the given data.
  */
@@ -619,6 +657,19 @@
         [RSI_error fillError:err withCode:tmp ? tmp.code : RSIErrorInvalidSecureImage];
         return nil;
     }
+    return [RealSecureImage identifyEncryptedContent:dEncrypted withFullDecryption:fullDecryption andError:err];
+}
+
+/*
+ *  Identify content that was previously unpacked from its image with unpackData, which allows the
+ *  (image-bound) unpacking and (keyring-bound) identification to be scheduled independently.
+ */
++(RSISecureMessage *) identifyEncryptedContent:(NSData *) dEncrypted withFullDecryption:(BOOL) fullDecryption andError:(NSError **) err
+{
+    if (!dEncrypted || [dEncrypted length] < [RSI_secure_props propertyHeaderLength]) {
+        [RSI_error fillError:err withCode:RSIErrorInvalidSecureImage];
+        return nil;
+    }
     return [RSI_seal identifyEncryptedMessage:dEncrypted withFullDecryption:fullDecryption andError:err];
 }
 
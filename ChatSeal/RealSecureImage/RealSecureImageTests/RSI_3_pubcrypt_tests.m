@@ -321,4 +321,116 @@ static const char *RSI_3_pubcrypt_TEST_TEXT = "Lorem ipsum dolor sit amet, conse
     NSLog(@"UT-PUBCRYPT: - key deletion returned the correct error code.");
 }
 
+/*
+ *  Verify batched verification and decryption and compare it with opening each message individually.
+ */
+-(void) testUTPUBCRYPT_7_Batch
+{
+    static const NSUInteger RSI_3_NUM_BATCH_KEYS = 10;
+    static const NSUInteger RSI_3_NUM_BATCH_MSGS = 1000;
+    
+    NSLog(@"UT-PUBCRYPT: - creating %u keys for batch testing.", RSI_3_NUM_BATCH_KEYS);
+    NSMutableArray *maTags = [NSMutableArray array];
+    NSMutableArray *maKeys = [NSMutableArray array];
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_KEYS; i++) {
+        NSString *sTag = [NSString stringWithFormat:@"batchTag-%u", i];
+        [RSI_pubcrypt deleteKeyWithTag:sTag withError:nil];
+        RSI_pubcrypt *pk = [RSI_pubcrypt allocNewKeyForPublicLabel:sTag andPrivateLabel:sTag andTag:sTag withError:&err];
+        XCTAssertNotNil(pk, @"Failed to create the key %@.  %@", sTag, [err localizedDescription]);
+        [maTags addObject:sTag];
+        [maKeys addObject:pk];
+        [pk release];
+    }
+    
+    NSLog(@"UT-PUBCRYPT: - building %u signed and encrypted messages.", RSI_3_NUM_BATCH_MSGS);
+    NSMutableArray *maMessages   = [NSMutableArray array];
+    NSMutableArray *maSignatures = [NSMutableArray array];
+    NSMutableArray *maEncrypted  = [NSMutableArray array];
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        RSI_pubcrypt *pk = [maKeys objectAtIndex:i % RSI_3_NUM_BATCH_KEYS];
+        NSData *dMsg     = [[NSString stringWithFormat:@"%s %u", RSI_3_pubcrypt_TEST_TEXT, i] dataUsingEncoding:NSUTF8StringEncoding];
+        
+        NSMutableData *mdSig = [NSMutableData data];
+        BOOL ret = [pk sign:dMsg intoBuffer:mdSig withError:&err];
+        XCTAssertTrue(ret, @"Failed to sign message %u.  %@", i, [err localizedDescription]);
+        
+        NSMutableData *mdEnc = [NSMutableData data];
+        ret = [pk encrypt:[NSData dataWithBytes:&i length:sizeof(i)] intoBuffer:mdEnc withError:&err];
+        XCTAssertTrue(ret, @"Failed to encrypt message %u.  %@", i, [err localizedDescription]);
+        
+        // - every tenth message is damaged to verify failures are reported individually.
+        if (i % 10 == 9) {
+            ((unsigned char *) mdSig.mutableBytes)[0] ^= 0xFF;
+        }
+        
+        [maMessages addObject:dMsg];
+        [maSignatures addObject:mdSig];
+        [maEncrypted addObject:mdEnc];
+    }
+    
+    NSLog(@"UT-PUBCRYPT: - verifying the messages individually.");
+    NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+    NSUInteger numIndividual = 0;
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        @autoreleasepool {
+            RSI_pubcrypt *pk = [RSI_pubcrypt allocExistingKeyForTag:[maTags objectAtIndex:i % RSI_3_NUM_BATCH_KEYS] withError:&err];
+            if ([pk verify:[maMessages objectAtIndex:i] withBuffer:[maSignatures objectAtIndex:i] withError:nil]) {
+                numIndividual++;
+            }
+            [pk release];
+        }
+    }
+    NSTimeInterval tiIndividual = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    NSLog(@"UT-PUBCRYPT: - verifying the messages as a batch.");
+    NSMutableArray *maVerify = [NSMutableArray array];
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        [maVerify addObject:[RSI_pubcrypt_op verifyOperationForTag:[maTags objectAtIndex:i % RSI_3_NUM_BATCH_KEYS] withData:[maMessages objectAtIndex:i]
+                                                      andSignature:[maSignatures objectAtIndex:i]]];
+    }
+    [RSI_pubcrypt releaseCachedKeys];
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    NSUInteger numBatch = [RSI_pubcrypt performBatch:maVerify];
+    NSTimeInterval tiBatch = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    XCTAssertEqual(numBatch, numIndividual, @"The batch and individual results differ.");
+    XCTAssertEqual(numBatch, RSI_3_NUM_BATCH_MSGS - (RSI_3_NUM_BATCH_MSGS / 10), @"The wrong number of signatures were verified.");
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        RSI_pubcrypt_op *op = [maVerify objectAtIndex:i];
+        XCTAssertTrue(op.succeeded == (i % 10 != 9), @"The verification result is incorrect for message %u.", i);
+        if (!op.succeeded) {
+            XCTAssertNotNil(op.error, @"No error was reported for message %u.", i);
+        }
+    }
+    
+    NSLog(@"UT-PUBCRYPT: - decrypting the messages as a batch.");
+    NSMutableArray *maDecrypt = [NSMutableArray array];
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        [maDecrypt addObject:[RSI_pubcrypt_op decryptOperationForTag:[maTags objectAtIndex:i % RSI_3_NUM_BATCH_KEYS] withData:[maEncrypted objectAtIndex:i]]];
+    }
+    [maDecrypt addObject:[RSI_pubcrypt_op decryptOperationForTag:@"badkey5678" withData:[maEncrypted objectAtIndex:0]]];
+    tStart = [NSDate timeIntervalSinceReferenceDate];
+    numBatch = [RSI_pubcrypt performBatch:maDecrypt];
+    NSTimeInterval tiDecrypt = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    XCTAssertEqual(numBatch, RSI_3_NUM_BATCH_MSGS, @"Failed to decrypt every message.");
+    for (NSUInteger i = 0; i < RSI_3_NUM_BATCH_MSGS; i++) {
+        RSI_pubcrypt_op *op = [maDecrypt objectAtIndex:i];
+        XCTAssertTrue(op.succeeded && [op.clearData length] == sizeof(i) && !memcmp(op.clearData.bytes, &i, sizeof(i)), @"Message %u was not decrypted correctly.", i);
+    }
+    RSI_pubcrypt_op *opBad = [maDecrypt lastObject];
+    XCTAssertFalse(opBad.succeeded, @"A missing key was used for decryption.");
+    XCTAssertTrue(opBad.error.code == RSIErrorKeyNotFound, @"The missing key was not reported.");
+    
+    NSLog(@"UT-PUBCRYPT: - individual verification:  %8.1f per second", (double) RSI_3_NUM_BATCH_MSGS / tiIndividual);
+    NSLog(@"UT-PUBCRYPT: - batch verification:       %8.1f per second", (double) RSI_3_NUM_BATCH_MSGS / tiBatch);
+    NSLog(@"UT-PUBCRYPT: - batch decryption:         %8.1f per second", (double) RSI_3_NUM_BATCH_MSGS / tiDecrypt);
+    
+    for (NSString *sTag in maTags) {
+        BOOL ret = [RSI_pubcrypt deleteKeyWithTag:sTag withError:&err];
+        XCTAssertTrue(ret, @"Failed to delete the key %@.  %@", sTag, [err localizedDescription]);
+    }
+    NSLog(@"UT-PUBCRYPT: - batch processing has been verified.");
+}
+
 @end
@@ -15,6 +15,8 @@
 #import "RSI_unpack.h"
 #import "bigtime.h"
 #import "RSI_secure_props.h"
+#import "RSI_keypool.h"
+#import "RSI_pubcrypt.h"
 
 static const char *RSI_8_SAMPLE_TEXT = "Is it so bad, then, to be misunderstood? Pythagoras was misunderstood, and Socrates, ...and Copernicus, and Galileo, and Newton, and every pure and wise spirit that ever took flesh. To be great is to be misunderstood.";
 
@@ -651,5 +653,95 @@ static const char *RSI_8_SAMPLE_TEXT = "Is it so bad, then, to be misunderstood?
     NSLog(@"UT-KEYRING: - all tests completed successfully.");
 }
 
+/*
+ *  Wait until the key pool has the requested number of spares.
+ */
+-(BOOL) waitForSpareKeys:(NSUInteger) numSpares
+{
+    NSDate *dtLimit = [NSDate dateWithTimeIntervalSinceNow:300.0];
+    while ([[RSI_keypool metrics] numAvailable] < numSpares) {
+        if ([dtLimit compare:[NSDate date]] == NSOrderedAscending) {
+            return NO;
+        }
+        [NSThread sleepForTimeInterval:0.1];
+    }
+    return YES;
+}
+
+/*
+ *  Create keyrings one after another and return the average time for each.
+ */
+-(NSTimeInterval) averageCreationTimeForRings:(NSUInteger) numRings intoArray:(NSMutableArray *) maRings
+{
+    NSTimeInterval tiTotal = 0.0;
+    for (NSUInteger i = 0; i < numRings; i++) {
+        NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+        RSI_keyring *kr = [self randomKeyRing];
+        tiTotal += ([NSDate timeIntervalSinceReferenceDate] - tStart);
+        if (kr) {
+            [maRings addObject:kr];
+        }
+    }
+    return tiTotal / (double) numRings;
+}
+
+/*
+ *  Measure keyring creation latency with and without spare keys and verify the pool refills itself.
+ */
+-(void) testUTKEYRING_5_KeyPool
+{
+    static const NSUInteger RSI_8_NUM_POOL_RINGS = 6;
+    
+    NSLog(@"UT-KEYRING: - starting key pool testing.");
+    NSMutableArray *maRings = [NSMutableArray array];
+    BOOL ret                = NO;
+    
+    NSLog(@"UT-KEYRING: - emptying the key pool.");
+    [RSI_keypool stopRefill];
+    [RSI_keypool setMinimumSpares:RSI_8_NUM_POOL_RINGS andMaximumSpares:RSI_8_NUM_POOL_RINGS * 2];
+    NSString *keyTag = nil;
+    while ((keyTag = [RSI_keypool takeSpareKeyTag]) != nil) {
+        ret = [RSI_pubcrypt deleteKeyWithTag:keyTag withError:&err];
+        XCTAssertTrue(ret, @"Failed to delete the spare key %@.  %@", keyTag, [err localizedDescription]);
+    }
+    
+    NSLog(@"UT-KEYRING: - creating %u keyrings with a cold pool.", RSI_8_NUM_POOL_RINGS);
+    NSTimeInterval tiCold = [self averageCreationTimeForRings:RSI_8_NUM_POOL_RINGS intoArray:maRings];
+    
+    NSLog(@"UT-KEYRING: - filling the key pool.");
+    NSTimeInterval tStart = [NSDate timeIntervalSinceReferenceDate];
+    [RSI_keypool startRefill];
+    ret = [self waitForSpareKeys:RSI_8_NUM_POOL_RINGS];
+    XCTAssertTrue(ret, @"The key pool failed to fill.");
+    NSTimeInterval tiFill = [NSDate timeIntervalSinceReferenceDate] - tStart;
+    
+    NSLog(@"UT-KEYRING: - creating %u keyrings with a warm pool.", RSI_8_NUM_POOL_RINGS);
+    NSTimeInterval tiWarm = [self averageCreationTimeForRings:RSI_8_NUM_POOL_RINGS intoArray:maRings];
+    XCTAssertEqual([maRings count], RSI_8_NUM_POOL_RINGS * 2, @"Failed to create all the keyrings.");
+    
+    RSIKeyPoolMetrics *kpm = [RSI_keypool metrics];
+    XCTAssertTrue(kpm.numHits >= RSI_8_NUM_POOL_RINGS, @"The warm pool was not used for every keyring.");
+    XCTAssertTrue(kpm.targetSpares >= RSI_8_NUM_POOL_RINGS, @"The pool target is below its minimum.");
+    
+    NSLog(@"UT-KEYRING: - verifying the pool refills itself after a burst.");
+    ret = [self waitForSpareKeys:RSI_8_NUM_POOL_RINGS];
+    XCTAssertTrue(ret, @"The key pool failed to refill.");
+    
+    kpm = [RSI_keypool metrics];
+    NSLog(@"UT-KEYRING: - cold pool:  %6.1f ms per keyring", tiCold * 1000.0);
+    NSLog(@"UT-KEYRING: - warm pool:  %6.1f ms per keyring", tiWarm * 1000.0);
+    NSLog(@"UT-KEYRING: - pool fill:  %6.1f ms for %u keys", tiFill * 1000.0, RSI_8_NUM_POOL_RINGS);
+    NSLog(@"UT-KEYRING: - pool stats: %u hits, %u misses, %u generated, %u failures, %4.1f ms average generation",
+          kpm.numHits, kpm.numMisses, kpm.numGenerated, kpm.numFailures, kpm.averageGenerationTime * 1000.0);
+    
+    NSLog(@"UT-KEYRING: - discarding the test keyrings.");
+    for (RSI_keyring *kr in maRings) {
+        ret = [RSI_keyring deleteRingWithSealId:kr.sealId andError:&err];
+        XCTAssertTrue(ret, @"Failed to delete the keyring %@.  %@", kr.sealId, [err localizedDescription]);
+    }
+    [RSI_keypool setMinimumSpares:1 andMaximumSpares:4];
+    
+    NSLog(@"UT-KEYRING: - all tests completed successfully.");
+}
 
 @end
@@ -0,0 +1,211 @@
+//
+//  RRAtomic+LockFree.swift
+//  RREngine
+// 
+//  Created on 10/24/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import Foundation
+import Combine
+import Atomics
+
+/*
+ *  DESIGN:  RRAtomic is simple and general, but every access takes its lock and every
+ *			 write publishes through Combine while holding it, which makes the hot paths
+ *			 that are read from the event loops compete with the UI.  These variants are for
+ *			 that state.  Integers and flags are hardware atomics, larger values are
+ *			 immutable snapshots that are replaced whole (read-copy-update) so that readers
+ *			 never wait, and publication is optional and separate from the write.  When it
+ *			 is enabled, any number of writes between two main actor turns produce a single
+ *			 objectWillChange, sent from the main actor after the value has already changed.
+ */
+
+/*
+ *  A lock-free integer, intended for counters.
+ */
+final class RRAtomicCounter<T: AtomicInteger> : ObservableObject, @unchecked Sendable {
+	// - the represented value.
+	nonisolated var value: T {
+		get { storage.load(ordering: .relaxed) }
+		set {
+			storage.store(newValue, ordering: .relaxed)
+			publication?.signal()
+		}
+	}
+	nonisolated var objectWillChange: ObservableObjectPublisher { publication?.objectWillChange ?? .init() }
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(_ value: T = .zero, publishesChanges: Bool = false) {
+		self.storage	 = .init(value)
+		self.publication = publishesChanges ? .init() : nil
+	}
+	
+	/*
+	 *  Add to the value, returning the result.
+	 */
+	@discardableResult
+	nonisolated func add(_ amount: T) -> T {
+		let ret = storage.wrappingIncrementThenLoad(by: amount, ordering: .relaxed)
+		publication?.signal()
+		return ret
+	}
+	
+	/*
+	 *  Atomically set the new value and retrieve the prior one.
+	 */
+	nonisolated func valueThenChanged(to newValue: T) -> T {
+		let ret = storage.exchange(newValue, ordering: .relaxed)
+		publication?.signal()
+		return ret
+	}
+	
+	// - internal
+	private let storage: ManagedAtomic<T>
+	private let publication: RRAtomicPublication?
+}
+
+/*
+ *  A lock-free boolean, intended for flags.
+ */
+final class RRAtomicFlag : ObservableObject, @unchecked Sendable {
+	// - the represented value.
+	nonisolated var value: Bool {
+		get { storage.load(ordering: .acquiring) }
+		set {
+			storage.store(newValue, ordering: .releasing)
+			publication?.signal()
+		}
+	}
+	nonisolated var objectWillChange: ObservableObjectPublisher { publication?.objectWillChange ?? .init() }
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(_ value: Bool = false, publishesChanges: Bool = false) {
+		self.storage	 = .init(value)
+		self.publication = publishesChanges ? .init() : nil
+	}
+	
+	/*
+	 *  Set the flag only if it has the expected value, returning whether it was changed.
+	 */
+	nonisolated func change(from expected: Bool, to newValue: Bool) -> Bool {
+		guard storage.compareExchange(expected: expected, desired: newValue, ordering: .acquiringAndReleasing).exchanged else { return false }
+		publication?.signal()
+		return true
+	}
+	
+	/*
+	 *  Atomically set the new value and retrieve the prior one.
+	 *  - unlike a failed change, this always writes, which orders it with every other
+	 *    write of the flag.
+	 */
+	nonisolated func valueThenChanged(to newValue: Bool) -> Bool {
+		let ret = storage.exchange(newValue, ordering: .acquiringAndReleasing)
+		publication?.signal()
+		return ret
+	}
+	
+	// - internal
+	private let storage: ManagedAtomic<Bool>
+	private let publication: RRAtomicPublication?
+}
+
+/*
+ *  A value that is replaced as a whole, allowing any number of readers to proceed
+ *  without waiting while it is modified.
+ *  - modifications may be retried under contention, so their blocks must not
+ *    have side effects.
+ */
+final class RRAtomicSnapshot<T> : ObservableObject, @unchecked Sendable {
+	// - the represented value.
+	nonisolated var value: T {
+		get { storage.load(ordering: .acquiring).value }
+		set {
+			storage.store(.init(newValue), ordering: .releasing)
+			publication?.signal()
+		}
+	}
+	nonisolated var objectWillChange: ObservableObjectPublisher { publication?.objectWillChange ?? .init() }
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(_ value: T, publishesChanges: Bool = false) {
+		self.storage	 = .init(.init(value))
+		self.publication = publishesChanges ? .init() : nil
+	}
+	
+	/*
+	 *  Modify a copy of the current value and install it if no other modification
+	 *  intervened, retrying otherwise.
+	 */
+	@discardableResult
+	nonisolated func update<R>(_ block: (_ value: inout T) -> R) -> R {
+		var current = storage.load(ordering: .acquiring)
+		while true {
+			var newValue = current.value
+			let ret		 = block(&newValue)
+			let result	 = storage.compareExchange(expected: current, desired: .init(newValue), ordering: .acquiringAndReleasing)
+			if result.exchanged {
+				publication?.signal()
+				return ret
+			}
+			current = result.original
+		}
+	}
+	
+	/*
+	 *  Atomically set the new value and retrieve the prior one.
+	 */
+	nonisolated func valueThenChanged(to newValue: T) -> T {
+		let ret = storage.exchange(.init(newValue), ordering: .acquiringAndReleasing).value
+		publication?.signal()
+		return ret
+	}
+	
+	// - internal
+	private let storage: ManagedAtomic<Box>
+	private let publication: RRAtomicPublication?
+}
+
+/*
+ *  Types
+ */
+extension RRAtomicSnapshot {
+	// - one immutable version of the value.
+	private final class Box : AtomicReference {
+		let value: T
+		
+		init(_ value: T) {
+			self.value = value
+		}
+	}
+}
+
+/*
+ *  Delivers change notifications on the main actor, coalescing those that arrive
+ *  before it gets a chance to run.
+ */
+final class RRAtomicPublication : @unchecked Sendable {
+	let objectWillChange: ObservableObjectPublisher = .init()
+	
+	/*
+	 *  A change has occurred.
+	 */
+	nonisolated func signal() {
+		// - only the first change since the last delivery schedules another.
+		guard isPending.compareExchange(expected: false, desired: true, ordering: .acquiringAndReleasing).exchanged else { return }
+		Task { @MainActor in
+			// ...cleared first so that changes made while observers run aren't lost.
+			self.isPending.store(false, ordering: .releasing)
+			self.objectWillChange.send()
+		}
+	}
+	
+	// - internal
+	private let isPending: ManagedAtomic<Bool>	= .init(false)
+}
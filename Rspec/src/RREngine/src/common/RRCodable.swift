@@ -38,9 +38,9 @@ class RRCodableRegistry {
 			return
 		}
 		
-		_codableTypes.withLock {
-			assert(_codableTypes.value[typeId] == nil || _codableTypes.value[typeId] == type, "Conflicting codable class type registration detected.")
-			_codableTypes.value[typeId] = type as AnyClass
+		_codableTypes.update { types in
+			assert(types[typeId] == nil || types[typeId] == type, "Conflicting codable class type registration detected.")
+			types[typeId] = type as AnyClass
 		}
 	}
 	
@@ -72,7 +72,8 @@ class RRCodableRegistry {
 	
 	// ...it is VERY IMPORTANT that we save as AnyClass and not just RRDynamoCodable.Type
 	//	  or the process of decoding won't understand the inheritance hierarchy at all.
-	private static let _codableTypes: RRAtomic<[ String : AnyClass]> = .init([:])
+	// ...registration happens once per type, but lookups occur for every decoded object.
+	private static let _codableTypes: RRAtomicSnapshot<[ String : AnyClass]> = .init([:])
 }
 
 /*
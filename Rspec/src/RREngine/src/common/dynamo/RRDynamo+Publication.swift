@@ -0,0 +1,246 @@
+//
+//  RRDynamo+Publication.swift
+//  RREngine
+// 
+//  Created on 10/27/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import Foundation
+import Combine
+
+/*
+ *  DESIGN:  Runtime state changes at the pace of the work, which for something like a busy
+ *			 firewall port is far faster than any UI can usefully show.  Instead of publishing
+ *			 each modification, a runtime only counts it and, when it wasn't already waiting,
+ *			 queues itself with the scheduler.  The scheduler wakes on the main actor at a fixed
+ *			 interval (one frame by default) and delivers a single update to each queued
+ *			 runtime, describing every modification since the last one as a version range.
+ *			 No matter how often a runtime changes, it is queued at most once, and each pass
+ *			 delivers to a limited number of runtimes, deferring the rest to the next pass, so
+ *			 the main actor does a bounded amount of work per interval.
+ */
+
+/*
+ *  A consolidated set of modifications to the state of a runtime.
+ */
+struct RRDynamoStateUpdate : Sendable, Equatable {
+	// - the version last delivered and the one the state is at now.
+	let fromVersion: UInt64
+	let toVersion: UInt64
+	
+	// - the number of modifications since the last delivery.
+	var changeCount: UInt64 { toVersion - fromVersion }
+}
+
+/*
+ *  Publishes the state modifications of one runtime through a scheduler.
+ */
+final class RRDynamoStatePublication : @unchecked Sendable {
+	// - updates are only ever sent from the main actor.
+	let updates: PassthroughSubject<RRDynamoStateUpdate, Never> = .init()
+	
+	// - the current version of the state.
+	var version: UInt64 { _version.value }
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(with scheduler: RRDynamoStateScheduler) {
+		self.scheduler = scheduler
+	}
+	
+	/*
+	 *  The state was modified.
+	 */
+	func stateDidChange() {
+		// - the flag is written even when it is already set so that a delivery clearing
+		//   it at the same moment is guaranteed to see this version.
+		_version.add(1)
+		guard !isQueued.valueThenChanged(to: true) else { return }
+		scheduler.enqueue(self)
+	}
+	
+	/*
+	 *  Send the modifications since the last delivery, returning whether there were any.
+	 */
+	@MainActor
+	fileprivate func deliver() -> Bool {
+		// - cleared first so that modifications made while delivering queue it again, and
+		//   with an exchange so that it sees the versions of those that found it queued.
+		_ = isQueued.valueThenChanged(to: false)
+		let toVersion = _version.value
+		guard toVersion != delivered else { return false }
+		let update	  = RRDynamoStateUpdate(fromVersion: delivered, toVersion: toVersion)
+		delivered	  = toVersion
+		updates.send(update)
+		return true
+	}
+	
+	// - internal
+	private let scheduler: RRDynamoStateScheduler
+	private let _version: RRAtomicCounter<UInt64>	= .init()
+	private let isQueued: RRAtomicFlag				= .init()
+	private var delivered: UInt64					= 0
+}
+
+/*
+ *  Delivers the state modifications of runtimes to the main actor at a steady cadence.
+ */
+final class RRDynamoStateScheduler : @unchecked Sendable {
+	static let shared: RRDynamoStateScheduler = .init()
+	static let DefaultInterval: Duration	  = .microseconds(16_667)
+	static let DefaultDeliveryBudget: Int	  = 128
+	
+	/*
+	 *  Initialize the object.
+	 *  - a manual clock only makes a pass when it is advanced, which keeps tests independent of timing.
+	 */
+	init(interval: Duration = DefaultInterval, deliveryBudget: Int = DefaultDeliveryBudget, clock: PassClock = .continuous) {
+		self._interval		 = interval
+		self._deliveryBudget = deliveryBudget
+		self.clock			 = clock
+	}
+	
+	// - the time between deliveries.
+	var interval: Duration {
+		get { withLock { _interval } }
+		set { withLock { _interval = newValue } }
+	}
+	
+	// - the most runtimes delivered to in one pass, the rest wait for the next.
+	var deliveryBudget: Int {
+		get { withLock { _deliveryBudget } }
+		set { withLock { _deliveryBudget = max(newValue, 1) } }
+	}
+	
+	// - a summary of the scheduler's activity.
+	var statistics: Statistics { withLock { _statistics } }
+	
+	/*
+	 *  Make the pass that is due at the end of the current interval, returning whether
+	 *  there was anything to deliver.
+	 *  - only a manual clock is advanced this way.
+	 */
+	@MainActor
+	@discardableResult
+	func advance() -> Bool {
+		precondition(clock == .manual, "Only a manual clock can be advanced.")
+		guard withLock({ isPassScheduled }) else { return false }
+		deliverPending()
+		return true
+	}
+	
+	// - internal
+	private let clock: PassClock
+	private let sLock: NSLock							= .init()
+	private var _interval: Duration
+	private var _deliveryBudget: Int
+	private var pending: [RRDynamoStatePublication]		= []
+	private var isPassScheduled: Bool					= false
+	private var _statistics: Statistics					= .init()
+}
+
+/*
+ *  Types
+ */
+extension RRDynamoStateScheduler {
+	/*
+	 *  How the scheduler measures its interval.
+	 */
+	enum PassClock : Sendable {
+		// - passes are made on the main actor after each interval elapses.
+		case continuous
+		
+		// - passes are only made when the scheduler is advanced.
+		case manual
+	}
+	
+	/*
+	 *  The activity of the scheduler.
+	 */
+	struct Statistics : Sendable {
+		// - the number of passes made on the main actor.
+		var passes: Int						= 0
+		
+		// - the number of updates delivered.
+		var deliveries: Int					= 0
+		
+		// - the time spent on the main actor delivering updates, including that of their subscribers.
+		var mainActorTime: Duration			= .zero
+		
+		// - the most runtimes that were ever waiting for delivery.
+		var maximumBacklog: Int				= 0
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRDynamoStateScheduler {
+	/*
+	 *  Queue a runtime for its next delivery.
+	 */
+	fileprivate func enqueue(_ publication: RRDynamoStatePublication) {
+		let delay: Duration? = withLock {
+			pending.append(publication)
+			_statistics.maximumBacklog = max(_statistics.maximumBacklog, pending.count)
+			guard !isPassScheduled else { return nil }
+			isPassScheduled = true
+			return _interval
+		}
+		if let delay = delay {
+			schedulePass(after: delay)
+		}
+	}
+	
+	/*
+	 *  Wait for the interval, then deliver on the main actor.
+	 */
+	private func schedulePass(after delay: Duration) {
+		guard clock == .continuous else { return }
+		Task { @MainActor in
+			try? await Task.sleep(for: delay)
+			self.deliverPending()
+		}
+	}
+	
+	/*
+	 *  Deliver to the runtimes that have waited the longest.
+	 */
+	@MainActor
+	private func deliverPending() {
+		let start = ContinuousClock.now
+		let batch = withLock {
+			let ret = Array(pending.prefix(_deliveryBudget))
+			pending.removeFirst(ret.count)
+			return ret
+		}
+		var delivered = 0
+		for p in batch where p.deliver() {
+			delivered += 1
+		}
+		let elapsed = ContinuousClock.now - start
+		
+		// - the pass repeats only while runtimes are waiting.
+		let delay: Duration? = withLock {
+			_statistics.passes		  += 1
+			_statistics.deliveries	  += delivered
+			_statistics.mainActorTime += elapsed
+			isPassScheduled			  = !pending.isEmpty
+			return isPassScheduled ? _interval : nil
+		}
+		if let delay = delay {
+			schedulePass(after: delay)
+		}
+	}
+	
+	/*
+	 *  Access the scheduler under lock.
+	 */
+	private func withLock<R>(_ block: () -> R) -> R {
+		sLock.lock()
+		defer { sLock.unlock() }
+		return block()
+	}
+}
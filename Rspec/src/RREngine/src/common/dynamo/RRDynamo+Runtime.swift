@@ -66,17 +66,18 @@ extension Float : RRDynamoRuntimeStateful {}
  */
 class RRDynamoRuntime<Config: RRDynamoConfigurable, State: RRDynamoRuntimeStateful> : RRActiveDynamoRunnable {
 	var environment: RREngineEnvironment? { __env.value }
-	var statefulPublisher: RRDynamoRuntimePublisher {self.__state.objectWillChange.map({_ in self }).eraseToAnyPublisher()}
+	var statefulPublisher: RRDynamoRuntimePublisher { self.stateUpdates.map({ _ in self }).eraseToAnyPublisher() }
 	
 	/*
 	 *  Initialize the object.
 	 *  - the 'context' is an optional runtime-specific configuration that can be safely managed under lock.
+	 *  - the 'scheduler' paces the delivery of state changes to the main actor.
 	 */
-	init(with environment: RREngineEnvironment?, config: Config, context: Any? = nil) {
-		self.__env   = .init(environment)
-		self.__state = .init(nil)
-		self.__data  = .init(.init(isPaused: environment?.isEnginePaused ?? false, config: config, context: context))
-		self.state   = self.buildRuntimeState()
+	init(with environment: RREngineEnvironment?, config: Config, context: Any? = nil, publishingWith scheduler: RRDynamoStateScheduler = .shared) {
+		self.__env		   = .init(environment)
+		self.__publication = .init(with: scheduler)
+		self.__data		   = .init(.init(isPaused: environment?.isEnginePaused ?? false, config: config, context: context))
+		self.state		   = self.buildRuntimeState()
 	}
 	
 	/*
@@ -92,7 +93,7 @@ class RRDynamoRuntime<Config: RRDynamoConfigurable, State: RRDynamoRuntimeStatef
 	 *  Receives updated configuration from the owning dynamo.
 	 */
 	final func apply(_ config: Config) async {
-		self.__data.value.config = config
+		self.__data.update { $0.config = config }
 		configurationHasChanged()
 	}
 	
@@ -106,7 +107,7 @@ class RRDynamoRuntime<Config: RRDynamoConfigurable, State: RRDynamoRuntimeStatef
 	 *  Change the paused status of the dynamo.
 	 */
 	final func pause(_ isPaused: Bool) async {
-		self.__data.value.isPaused = isPaused
+		self.__data.update { $0.isPaused = isPaused }
 		await pausedStatusWasUpdated()
 	}
 	
@@ -122,9 +123,9 @@ class RRDynamoRuntime<Config: RRDynamoConfigurable, State: RRDynamoRuntimeStatef
 	final func shutdown() async -> RRShutdownResult {
 		// - NOTE: I preferred to not reset the state until after shutdown so that the
 		//         implementation can use its standard accessors without modification.
-		guard let _ = __state.value else { return .failure(RRError.notProcessing) }
+		guard let _ = self.state else { return .failure(RRError.notProcessing) }
 		let ret = await shutdown(with: self.config, andContext: __context)
-		__state.value = nil
+		self.state = nil
 		return ret
 	}
 	
@@ -136,8 +137,10 @@ class RRDynamoRuntime<Config: RRDynamoConfigurable, State: RRDynamoRuntimeStatef
 	}
 
 	private let __env: RRWeakAtomic<RREngineEnvironment>
-	private let __data: RRAtomic<Data>
-	private let __state: RRAtomic<State?>
+	private let __data: RRAtomicSnapshot<Data>
+	private let __stateLock: NSRecursiveLock = .init()
+	private var __state: State?
+	private let __publication: RRDynamoStatePublication
 }
 
 /*
@@ -164,37 +167,67 @@ extension RRDynamoRuntime {
 	// - the dynamo configuration provided to the runtime.
 	var config: Config { __data.value.config }
 	
+	// - the state is only published after its lock is released so that subscribers never run inside it.
 	var state: State? {
-		get { self.__state.value }
-		set { self.__state.value = newValue }
+		get { __withStateLock { __state } }
+		set {
+			__withStateLock { __state = newValue }
+			__publication.stateDidChange()
+		}
 	}
 	
+	// - the number of modifications made to the state so far.
+	var stateVersion: UInt64 { __publication.version }
+	
+	// - consolidated state modifications, delivered on the main actor at the pace of the scheduler.
+	var stateUpdates: AnyPublisher<RRDynamoStateUpdate, Never> { __publication.updates.eraseToAnyPublisher() }
+	
 	/*
 	 *  Access the state under lock.
 	 */
 	func withStateIfRunning<R>(_ block: (_ state: inout State) -> R?) -> R? {
-		return __state.withLock {
-			guard var state = __state.value else { return nil }
+		let (isRunning, ret): (Bool, R?) = __withStateLock {
+			guard var state = __state else { return (false, nil) }
 			let ret = block(&state)
-			__state.value = state
-			return ret
+			__state = state
+			return (true, ret)
+		}
+		if isRunning {
+			__publication.stateDidChange()
+		}
+		return ret
+	}
+	
+	/*
+	 *  Read the state under lock without modifying it, which publishes nothing.
+	 */
+	func readStateIfRunning<R>(_ block: (_ state: State) -> R?) -> R? {
+		return __withStateLock {
+			guard let state = __state else { return nil }
+			return block(state)
 		}
 	}
 		
 	// - the custom configuration for the runtime.
 	var __context: Any? {
 		get { __data.value.context }
-		set { __data.value.context = newValue }
+		set { __data.update { $0.context = newValue } }
 	}
 	
 	/*
-	 *  Access the context under lock.
+	 *  Access the state storage under lock.
+	 */
+	private func __withStateLock<R>(_ block: () -> R) -> R {
+		__stateLock.lock()
+		defer { __stateLock.unlock() }
+		return block()
+	}
+	
+	/*
+	 *  Modify the context atomically.
+	 *  - the block may be retried under contention.
 	 */
 	func __withContext(_ block: (_ value: inout Any?)-> Void) {
-		__data.withLock {
-			var ctx = __data.value.context
-			block(&ctx)
-			__data.value.context = ctx
-		}
+		__data.update { block(&$0.context) }
 	}
 }
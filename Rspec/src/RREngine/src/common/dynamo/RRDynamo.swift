@@ -66,7 +66,7 @@ public class RRDynamo : ObservableObject, RRStatefulProcessor, RRLoggableCategor
 		//   for that many updates in a short time period.
 		if let runtime = self.__runtime {
 			self.applyConfigToRuntime()
-			self.__runtimeSub = runtime.statefulPublisher.receive(on: DispatchQueue.main).sink(receiveValue: { [weak self] (_) in
+			self.__runtimeSub = runtime.statefulPublisher.sink(receiveValue: { [weak self] (_) in
 				guard let self = self else { return }
 				Task {
 					await self.runtimeStateHasBeenUpdated()
@@ -0,0 +1,71 @@
+//
+//  RRFirewallBufferPool.swift
+//  RREngine
+// 
+//  Created on 10/21/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import Foundation
+import NIOCore
+import NIOPosix
+
+/*
+ *  DESIGN:  NIO doesn't allow a custom allocator to be installed on a channel, but a
+ *			 buffer whose write has completed is no longer shared with the channel, so
+ *			 clearing it keeps its storage for the next response.  Each event loop runs on
+ *			 its own thread, so the pool is kept per-thread and needs no synchronization.
+ */
+
+/*
+ *  Recycles outbound buffers for the connections of one event loop.
+ */
+final class RRFirewallBufferPool {
+	static let MaximumPooled: Int	= 64
+	static let MaximumCapacity: Int	= 64 * 1024
+	
+	/*
+	 *  Return the pool for the event loop that is currently running.
+	 */
+	static func current(for eventLoop: EventLoop) -> RRFirewallBufferPool {
+		eventLoop.assertInEventLoop()
+		if let ret = threadPool.currentValue {
+			return ret
+		}
+		let ret					= RRFirewallBufferPool()
+		threadPool.currentValue = ret
+		return ret
+	}
+	
+	/*
+	 *  Return an empty buffer with at least the given capacity.
+	 */
+	func buffer(minimumCapacity: Int, allocator: ByteBufferAllocator) -> ByteBuffer {
+		guard var ret = available.popLast() else {
+			misses += 1
+			return allocator.buffer(capacity: minimumCapacity)
+		}
+		hits += 1
+		ret.reserveCapacity(minimumCapacity)
+		return ret
+	}
+	
+	/*
+	 *  Return a buffer to the pool once it has been written.
+	 */
+	func recycle(_ buffer: ByteBuffer) {
+		// - very large buffers would only pin memory after a burst.
+		guard available.count < Self.MaximumPooled, buffer.capacity <= Self.MaximumCapacity else { return }
+		var buffer = buffer
+		buffer.clear()
+		available.append(buffer)
+	}
+	
+	// - the number of requests satisfied by the pool and otherwise.
+	private (set) var hits: UInt	= 0
+	private (set) var misses: UInt	= 0
+	
+	// - internal
+	private static let threadPool: ThreadSpecificVariable<RRFirewallBufferPool> = .init()
+	private var available: [ByteBuffer]	= []
+}
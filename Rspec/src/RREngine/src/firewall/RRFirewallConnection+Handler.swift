@@ -11,7 +11,8 @@ import NIOCore
 
 /*
  *  The connection lifecycle handler that tracks basic traffic statistics and the
- *  presence of the connection.
+ *  presence of the connection.  The statistics are accumulated on the event loop and
+ *  delivered in batches by RRFirewallTrafficMetrics.
  *  DESIGN: This object interfaces with the runtime(s) specifically (and not the model) so
  *  		the model can be isolated from what may be verbose background events as a rule,
  *			or at least until it requires more info.
@@ -24,21 +25,36 @@ final class RRFirewallConnectionHandler : ChannelInboundHandler, ChannelOutbound
 	/*
 	 *  Initialize the object.
 	 */
-	init(withPortRuntime portRuntime: (any RRFirewallPortRunnable)?, andConnectionRuntime connRuntime: RRFirewallConnectionRuntime?) {
+	init(withPortRuntime portRuntime: (any RRFirewallPortRunnable)?, andConnectionRuntime connRuntime: RRFirewallConnectionRuntime?, recordingTo trafficMetrics: RRFirewallTrafficMetrics) {
 		self.portRuntime 	   = portRuntime
 		self.connectionRuntime = connRuntime
+		self.trafficMetrics	   = trafficMetrics
+	}
+	
+	/*
+	 *  The handler is now in the pipeline, so its event loop is known.
+	 */
+	func handlerAdded(context: ChannelHandlerContext) {
+		let recorder  = trafficMetrics.recorder(for: context.eventLoop)
+		self.recorder = recorder
+		self.slot	  = recorder.open(forPort: portRuntime, andConnection: connectionRuntime)
+	}
+	
+	/*
+	 *  The handler is leaving the pipeline, deliver what remains of the stats.
+	 */
+	func handlerRemoved(context: ChannelHandlerContext) {
+		guard let slot = slot else { return }
+		self.slot = nil
+		recorder?.close(slot)
 	}
 	
 	/*
 	 *  Data is inbound, record the stats.
 	 */
 	func channelRead(context: ChannelHandlerContext, data: NIOAny) {
-		let count = UInt(max(self.unwrapInboundIn(data).readableBytes, 0))
-		
-		Task {
-			connectionRuntime?.notifyNetworkTrafficMetrics(.init(bytesIn: count))
-			await portRuntime?.notifyNetworkTrafficMetrics(.init(bytesIn: count))
-		}
+		// - counted in place, the recorder delivers it later.
+		slot?.recordBytesIn(self.unwrapInboundIn(data).readableBytes)
 				
 		// - send to the next handler.
 		context.fireChannelRead(data)
@@ -48,12 +64,7 @@ final class RRFirewallConnectionHandler : ChannelInboundHandler, ChannelOutbound
 	 *  Data is outbound, record the stats.
 	 */
 	func write(context: ChannelHandlerContext, data: NIOAny, promise: EventLoopPromise<Void>?) {
-		let count = UInt(max(self.unwrapOutboundIn(data).readableBytes, 0))
-		
-		Task {
-			connectionRuntime?.notifyNetworkTrafficMetrics(.init(bytesOut: count))
-			await portRuntime?.notifyNetworkTrafficMetrics(.init(bytesOut: count))
-		}
+		slot?.recordBytesOut(self.unwrapOutboundIn(data).readableBytes)
 		
 		// - send to the next handler.
 		context.write(data, promise: promise)
@@ -79,4 +90,7 @@ final class RRFirewallConnectionHandler : ChannelInboundHandler, ChannelOutbound
 	// - internal
 	private var portRuntime: (any RRFirewallPortRunnable)?
 	private var connectionRuntime: RRFirewallConnectionRuntime?
+	private let trafficMetrics: RRFirewallTrafficMetrics
+	private var recorder: RRFirewallTrafficMetrics.Recorder?
+	private var slot: RRFirewallTrafficMetrics.Slot?
 }
@@ -33,7 +33,7 @@ public final class RRFirewallConnection : RRDynamo, Equatable {
 		Task {
 			await MainActor.run(body: {
 				let conn    = RRFirewallConnection(from: owner, with: controller, andChannel: channel)
-				let handler = RRFirewallConnectionHandler(withPortRuntime: owner, andConnectionRuntime: conn.runtime)
+				let handler = RRFirewallConnectionHandler(withPortRuntime: owner, andConnectionRuntime: conn.runtime, recordingTo: owner.trafficMetrics)
 				owner.connectionWasCreated(conn)
 				
 				let runtime = conn.runtime as? C.Runtime
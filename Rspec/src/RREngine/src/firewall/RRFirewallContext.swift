@@ -16,18 +16,22 @@ import NIOPosix
 actor RRFirewallContext : RRStatefulProcessor, RRLoggableCategory {
 	static var logCategory: String? = "Firewall"
 	
+	// - the traffic counters of every connection, shared by the ports.
+	nonisolated let trafficMetrics: RRFirewallTrafficMetrics
+	
 	/*
 	 *  Initialize the object.
 	 */
-	init() {
+	init(trafficFlushInterval: TimeAmount = RRFirewallTrafficMetrics.DefaultFlushInterval) {
+		self.trafficMetrics = .init(flushInterval: trafficFlushInterval)
 		Task.detached {	let _ = await self.eventLooopGroup }
 	}
 	
 	/*
-	 *  Bootstrap a new server instance.
+	 *  Bootstrap a new server instance, using the common threads unless a group is provided.
 	 */
-	func bootstrapServer(toPort portValue: NetworkPortValue, with block: @Sendable (_ bootstrap: ServerBootstrap) -> ServerBootstrap) async -> Result<Channel, Error> {
-		let bootstrap = ServerBootstrap(group: self.eventLooopGroup)
+	func bootstrapServer(toPort portValue: NetworkPortValue, in group: EventLoopGroup? = nil, with block: @Sendable (_ bootstrap: ServerBootstrap) -> ServerBootstrap) async -> Result<Channel, Error> {
+		let bootstrap = ServerBootstrap(group: group ?? self.eventLooopGroup)
 		do {
 			let serverChannel = try await block(bootstrap).bind(host: "localhost", port: Int(portValue)).get()
 			return .success(serverChannel)
@@ -47,6 +51,7 @@ actor RRFirewallContext : RRStatefulProcessor, RRLoggableCategory {
 		
 		let ret: RRShutdownResult
 		do {
+			self.trafficMetrics.shutdown()
 			try await self.eventLooopGroup.shutdownGracefully()
 			isOnline  = false
 			self._elg = nil
@@ -22,6 +22,7 @@ protocol RRFirewallPortConfigurable : RRDynamoConfigurable, RRIdentifiable {
 	var value: NetworkPortValue? { get set }
 	var defaultValue: NetworkPortValue? { get }
 	var clientBacklog: UInt16 { get set }
+	var transport: RRFirewallTransport { get set }
 	
 	// - custom formatting
 	var targetURL: URL? { get }
@@ -50,7 +51,7 @@ extension RRFirewallPortConfigurable {
  *  Consistent network metrics handling.
  */
 protocol RRFirewallPortNetworkMetricsCapable : AnyObject {
-	func notifyNetworkTrafficMetrics(_ metricUpdates: RRNetworkMetrics) async
+	func notifyNetworkTrafficMetrics(_ metricUpdates: RRNetworkMetrics)
 }
 
 /*
@@ -61,6 +62,7 @@ protocol RRFirewallPortRunnable : RRActiveDynamoRunnable, RRFirewallPortNetworkM
 	nonisolated var portStatus: RRFirewallPort.PortStatus { get }
 	nonisolated var portMetrics: RRFirewallPort.PortMetrics { get }
 	nonisolated var connections: [RRFirewallConnection] { get }
+	nonisolated var trafficMetrics: RRFirewallTrafficMetrics { get }
 
 	nonisolated func connectionWasCreated(_ connection: RRFirewallConnection)
 	nonisolated func connectionWasDisconnected(_ connection: RRFirewallConnection)
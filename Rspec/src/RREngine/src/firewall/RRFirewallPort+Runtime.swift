@@ -92,6 +92,7 @@ extension RRFirewallPortRuntime {
 		weak var owner: RRFirewallPort?
 		var cTask: Task<Void, Never>?
 		var serverChannel: Channel?
+		var dedicatedGroup: MultiThreadedEventLoopGroup?
 		
 		var inReconfig: Bool
 		var isFirewallEnabledOverride: Bool
@@ -157,7 +158,7 @@ extension RRFirewallPortRuntime : RRFirewallPortRunnable {
 		
 	// - the networking status of the port
 	nonisolated var portStatus: RRFirewallPort.PortStatus {
-		return withStateIfRunning { state in
+		return readStateIfRunning { state in
 			if state.inReconfig {
 				return .reconfiguring
 			}
@@ -170,6 +171,9 @@ extension RRFirewallPortRuntime : RRFirewallPortRunnable {
 	
 	// - the active connections.
 	nonisolated var connections: [RRFirewallConnection] { self.state?.connections ?? [] }
+	
+	// - where the connections record their traffic.
+	nonisolated var trafficMetrics: RRFirewallTrafficMetrics { self.fwContext.trafficMetrics }
 }
 
 /*
@@ -306,37 +310,47 @@ extension RRFirewallPortRuntime {
 			return RRFirewallConnection.addHandler(from: rt, with: self.config.buildController(), andChannel: channel)
 		}
 		
-		let ret	= await self.fwContext.bootstrapServer(toPort: portValue) { bootstrap in
-			bootstrap.serverChannelOption(ChannelOptions.backlog, value: ChannelOptions.Types.BacklogOption.Value(newConfig.clientBacklog))
+		// - a busy port may be given its own threads so it can't starve the others.
+		let transport = newConfig.transport
+		let dGroup	  = transport.dedicatedThreadCount.map({ MultiThreadedEventLoopGroup(numberOfThreads: $0) })
+		
+		let ret	= await self.fwContext.bootstrapServer(toPort: portValue, in: dGroup) { bootstrap in
+			transport.applyChildOptions(to: bootstrap.serverChannelOption(ChannelOptions.backlog, value: ChannelOptions.Types.BacklogOption.Value(newConfig.clientBacklog))
 				.serverChannelOption(ChannelOptions.socketOption(.so_reuseaddr), value: 1)
 				.childChannelOption(ChannelOptions.socketOption(.so_reuseaddr), value: 1)
-				.childChannelOption(ChannelOptions.maxMessagesPerRead, value: 1)
-				.childChannelOption(ChannelOptions.allowRemoteHalfClosure, value: false)		// - this isn't useful for this purpose.
+				.childChannelOption(ChannelOptions.allowRemoteHalfClosure, value: false))		// - this isn't useful for this purpose.
 				.childChannelInitializer(childChannelInitializer(channel:))
 		}
 
 		withStateIfRunning { state in
 			switch ret {
 			case .success(let channel):
-				state.serverChannel = channel
-				state.portStatus    = .online
+				state.serverChannel  = channel
+				state.dedicatedGroup = dGroup
+				state.portStatus     = .online
 				
 			case .failure(let err):
-				state.portStatus 	= .error(err)
+				state.portStatus 	 = .error(err)
 			}
 		}
+		if case .failure(_) = ret, let dGroup = dGroup {
+			try? await dGroup.shutdownGracefully()
+		}
 	}
 	
 	/*
 	 *  Stop the server.
 	 */
 	private func stopServer(from oldConfig: Config) async -> Void {
-		guard let serverChannel = withStateIfRunning({ (state) -> Channel? in
+		guard let stopping = withStateIfRunning({ (state) -> (channel: Channel, group: MultiThreadedEventLoopGroup?)? in
 			guard let sc = state.serverChannel else { return nil }
-			state.portStatus    = .stopping
-			state.serverChannel = nil
-			return sc
+			let ret				 = (sc, state.dedicatedGroup)
+			state.portStatus     = .stopping
+			state.serverChannel  = nil
+			state.dedicatedGroup = nil
+			return ret
 		}) else { return }
+		let serverChannel = stopping.channel
 		
 		// ...NIO channels won't shut down until all of their clients are disconnected.
 		for conn in self.state?.connections ?? [] {
@@ -355,6 +369,12 @@ extension RRFirewallPortRuntime {
 			self.log.error("Failed to stop the port \(oldConfig.id.briefId, privacy: .public) listening on \(oldConfig.targetURL?.absoluteString ?? "n/a", privacy: .public).  \(error.localizedDescription, privacy: .public)")
 		}
 		
+		// ...and the threads that were dedicated to it.
+		if let dGroup = stopping.group {
+			self.trafficMetrics.discardRecorders(in: dGroup)
+			try? await dGroup.shutdownGracefully()
+		}
+		
 		self.state?.portStatus = .offline
 	}
 	
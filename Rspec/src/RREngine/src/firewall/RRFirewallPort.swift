@@ -193,6 +193,12 @@ extension RRFirewallPort {
 		get { self.config.clientBacklog }
 		set { self.config.clientBacklog = newValue }
 	}
+	
+	/// The tuning for how network traffic is moved through the port.  Defaults to ``RRFirewallTransport/standard``.
+	public var transport: RRFirewallTransport {
+		get { self.config.transport }
+		set { self.config.transport = newValue }
+	}
 }
 
 /*
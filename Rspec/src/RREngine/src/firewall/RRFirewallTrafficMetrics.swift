@@ -0,0 +1,210 @@
+//
+//  RRFirewallTrafficMetrics.swift
+//  RREngine
+// 
+//  Created on 10/19/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import Foundation
+import NIOCore
+
+/*
+ *  DESIGN:  Every buffer that moves through a connection is counted, which is far too
+ *			 often to hop into the runtimes each time since every delivery locks the runtime
+ *			 state and publishes a change.  Instead, the counts are kept beside the event loop
+ *			 that serves the connection.  Only that loop's thread ever touches them so they
+ *			 need no synchronization, and the loop periodically delivers what accumulated
+ *			 to the connection and port runtimes in one update for each.
+ */
+
+/*
+ *  Collects the network traffic of firewall connections for delivery at a fixed cadence.
+ */
+final class RRFirewallTrafficMetrics : @unchecked Sendable {
+	static let DefaultFlushInterval: TimeAmount = .milliseconds(250)
+	
+	// - how often the accumulated traffic is delivered to the runtimes.
+	let flushInterval: TimeAmount
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(flushInterval: TimeAmount = DefaultFlushInterval) {
+		self.flushInterval = flushInterval
+	}
+	
+	/*
+	 *  Return the recorder for the connections served by an event loop.
+	 */
+	func recorder(for eventLoop: EventLoop) -> Recorder {
+		mLock.lock()
+		defer { mLock.unlock() }
+		
+		let key = ObjectIdentifier(eventLoop)
+		if let ret = recorders[key] {
+			return ret
+		}
+		let ret		   = Recorder(on: eventLoop, flushInterval: flushInterval)
+		recorders[key] = ret
+		return ret
+	}
+	
+	/*
+	 *  Stop the periodic deliveries, sending whatever remains.
+	 */
+	func shutdown() {
+		mLock.lock()
+		let all   = recorders.values
+		recorders = [:]
+		mLock.unlock()
+		
+		for r in all {
+			r.stop()
+		}
+	}
+	
+	/*
+	 *  Stop the recorders of a group that is about to be shut down.
+	 */
+	func discardRecorders(in group: EventLoopGroup) {
+		mLock.lock()
+		let discarded = group.makeIterator().compactMap({ recorders.removeValue(forKey: ObjectIdentifier($0)) })
+		mLock.unlock()
+		
+		for r in discarded {
+			r.stop()
+		}
+	}
+	
+	// - internal
+	private let mLock: NSLock								= .init()
+	private var recorders: [ObjectIdentifier : Recorder]	= [:]
+}
+
+/*
+ *  Types
+ */
+extension RRFirewallTrafficMetrics {
+	/*
+	 *  Accumulates the traffic of every connection on one event loop.
+	 *  DESIGN:  Apart from its creation, this is only used from its event loop.
+	 */
+	final class Recorder : @unchecked Sendable {
+		let eventLoop: EventLoop
+		
+		/*
+		 *  Initialize the object.
+		 */
+		fileprivate init(on eventLoop: EventLoop, flushInterval: TimeAmount) {
+			self.eventLoop = eventLoop
+			self.flushTask = eventLoop.scheduleRepeatedTask(initialDelay: flushInterval, delay: flushInterval) { [weak self] _ in
+				self?.flush()
+			}
+		}
+		
+		/*
+		 *  Begin recording the traffic for a connection.
+		 */
+		func open(forPort port: (any RRFirewallPortNetworkMetricsCapable)?, andConnection connection: (any RRFirewallPortNetworkMetricsCapable)?) -> Slot {
+			eventLoop.assertInEventLoop()
+			let ret = Slot(port: port, connection: connection)
+			slots.append(ret)
+			return ret
+		}
+		
+		/*
+		 *  Stop recording a connection, delivering what it has accumulated right away.
+		 */
+		func close(_ slot: Slot) {
+			eventLoop.assertInEventLoop()
+			guard !slot.isClosed else { return }
+			slot.isClosed = true
+			if let metrics = slot.take() {
+				slot.connection?.notifyNetworkTrafficMetrics(metrics)
+				slot.port?.notifyNetworkTrafficMetrics(metrics)
+			}
+		}
+		
+		/*
+		 *  Deliver the accumulated traffic to the runtimes.
+		 */
+		func flush() {
+			eventLoop.assertInEventLoop()
+			guard !slots.isEmpty else { return }
+			
+			// - ports are shared by many connections, so they get a single total.
+			var portTotals: [ObjectIdentifier : (port: any RRFirewallPortNetworkMetricsCapable, metrics: RRNetworkMetrics)] = [:]
+			for s in slots where !s.isClosed {
+				guard let metrics = s.take() else { continue }
+				s.connection?.notifyNetworkTrafficMetrics(metrics)
+				if let port = s.port {
+					portTotals[ObjectIdentifier(port), default: (port, .init())].metrics += metrics
+				}
+			}
+			slots.removeAll(where: { $0.isClosed })
+			
+			for pt in portTotals.values {
+				pt.port.notifyNetworkTrafficMetrics(pt.metrics)
+			}
+		}
+		
+		/*
+		 *  Stop delivering periodically.
+		 */
+		fileprivate func stop() {
+			eventLoop.execute {
+				self.flushTask?.cancel()
+				self.flushTask = nil
+				self.flush()
+			}
+		}
+		
+		// - internal
+		private var flushTask: RepeatedTask?
+		private var slots: [Slot]	= []
+	}
+	
+	/*
+	 *  The traffic of one connection that has yet to be delivered.
+	 */
+	final class Slot {
+		/*
+		 *  Data was received.
+		 */
+		func recordBytesIn(_ count: Int) {
+			pending.bytesIn &+= UInt(truncatingIfNeeded: count)
+		}
+		
+		/*
+		 *  Data was sent.
+		 */
+		func recordBytesOut(_ count: Int) {
+			pending.bytesOut &+= UInt(truncatingIfNeeded: count)
+		}
+		
+		/*
+		 *  Initialize the object.
+		 */
+		fileprivate init(port: (any RRFirewallPortNetworkMetricsCapable)?, connection: (any RRFirewallPortNetworkMetricsCapable)?) {
+			self.port		= port
+			self.connection = connection
+		}
+		
+		/*
+		 *  Return the pending traffic, if any, and reset it.
+		 */
+		fileprivate func take() -> RRNetworkMetrics? {
+			guard pending.bytesIn > 0 || pending.bytesOut > 0 else { return nil }
+			let ret = pending
+			pending = .init()
+			return ret
+		}
+		
+		// - internal
+		fileprivate weak var port: (any RRFirewallPortNetworkMetricsCapable)?
+		fileprivate weak var connection: (any RRFirewallPortNetworkMetricsCapable)?
+		fileprivate var isClosed: Bool				= false
+		private var pending: RRNetworkMetrics		= .init()
+	}
+}
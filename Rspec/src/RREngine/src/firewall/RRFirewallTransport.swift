@@ -0,0 +1,93 @@
+//
+//  RRFirewallTransport.swift
+//  RREngine
+// 
+//  Created on 10/21/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import Foundation
+import NIOCore
+
+///  Tunes how a firewall port moves data between its sockets and the engine.
+///
+///  The defaults favor throughput for many small requests, which is the common
+///  case for local triggers.  None of these alter the protocol behavior of a port.
+public struct RRFirewallTransport : Sendable, Equatable {
+	/// The tuning used by ports unless configured otherwise.
+	public static let standard: RRFirewallTransport = .init()
+	
+	/// The smallest size a receive buffer will shrink to after a series of small reads.
+	public var minimumReceiveBufferSize: Int
+	
+	/// The size of the first receive buffer for a connection.
+	public var initialReceiveBufferSize: Int
+	
+	/// The largest size a receive buffer will grow to after a series of full reads.
+	public var maximumReceiveBufferSize: Int
+	
+	/// The number of reads performed on a connection each time it becomes readable.
+	public var maxMessagesPerRead: UInt
+	
+	/// The number of attempts made to flush pending writes before waiting for the socket to be writable.
+	public var writeSpinCount: UInt
+	
+	/// Whether outbound buffers are recycled by each event loop instead of allocated for every response.
+	public var isBufferPoolingEnabled: Bool
+	
+	/// The number of threads dedicated to serving the port, or `nil` to share those of the firewall.
+	public var eventLoopThreads: Int?
+	
+	///  Initialize the object.
+	///
+	///  - Parameter minimumReceiveBufferSize: The smallest receive buffer size.
+	///  - Parameter initialReceiveBufferSize: The first receive buffer size.
+	///  - Parameter maximumReceiveBufferSize: The largest receive buffer size.
+	///  - Parameter maxMessagesPerRead: The reads per readable notification.
+	///  - Parameter writeSpinCount: The flush attempts before waiting for writability.
+	///  - Parameter isBufferPoolingEnabled: Whether outbound buffers are recycled.
+	///  - Parameter eventLoopThreads: The threads dedicated to the port, if any.
+	public init(minimumReceiveBufferSize: Int = 64,
+				initialReceiveBufferSize: Int = 2048,
+				maximumReceiveBufferSize: Int = 64 * 1024,
+				maxMessagesPerRead: UInt = 4,
+				writeSpinCount: UInt = 16,
+				isBufferPoolingEnabled: Bool = true,
+				eventLoopThreads: Int? = nil) {
+		self.minimumReceiveBufferSize = minimumReceiveBufferSize
+		self.initialReceiveBufferSize = initialReceiveBufferSize
+		self.maximumReceiveBufferSize = maximumReceiveBufferSize
+		self.maxMessagesPerRead		  = maxMessagesPerRead
+		self.writeSpinCount			  = writeSpinCount
+		self.isBufferPoolingEnabled	  = isBufferPoolingEnabled
+		self.eventLoopThreads		  = eventLoopThreads
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRFirewallTransport {
+	// - the receive sizes, ordered and within reason so that a bad configuration
+	//   can't prevent the port from starting.
+	private var receiveAllocator: AdaptiveRecvByteBufferAllocator {
+		let minimum = max(minimumReceiveBufferSize, 64)
+		let maximum = max(maximumReceiveBufferSize, minimum)
+		return .init(minimum: minimum, initial: min(max(initialReceiveBufferSize, minimum), maximum), maximum: maximum)
+	}
+	
+	// - the number of dedicated threads, if any.
+	var dedicatedThreadCount: Int? {
+		guard let eventLoopThreads = eventLoopThreads, eventLoopThreads > 0 else { return nil }
+		return min(eventLoopThreads, System.coreCount)
+	}
+	
+	/*
+	 *  Apply the tuning to the connections accepted by a server.
+	 */
+	func applyChildOptions(to bootstrap: ServerBootstrap) -> ServerBootstrap {
+		bootstrap.childChannelOption(ChannelOptions.recvAllocator, value: receiveAllocator)
+			.childChannelOption(ChannelOptions.maxMessagesPerRead, value: max(maxMessagesPerRead, 1))
+			.childChannelOption(ChannelOptions.writeSpin, value: writeSpinCount)
+	}
+}
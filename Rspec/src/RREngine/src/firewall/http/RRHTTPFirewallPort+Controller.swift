@@ -74,7 +74,8 @@ fileprivate final class RRHTTPFirewallPortHandler<Runtime: RRFirewallConnectionR
 			
 			self.reqHead = nil
 			var responseHead = httpResponseHead(request: reqHead, status: .ok)
-			var buffer = context.channel.allocator.buffer(capacity: 0)
+			let pool   = config.transport.isBufferPoolingEnabled ? RRFirewallBufferPool.current(for: context.eventLoop) : nil
+			var buffer = pool?.buffer(minimumCapacity: 128, allocator: context.channel.allocator) ?? context.channel.allocator.buffer(capacity: 0)
 			buffer.clear()
 			buffer.writeString("RR-OK [\(RRIdentifier().uuidString)] --> \(Date().description)\n")
 			responseHead.headers.add(name: "content-length", value: String(buffer.readableBytes))
@@ -82,10 +83,14 @@ fileprivate final class RRHTTPFirewallPortHandler<Runtime: RRFirewallConnectionR
 			context.write(self.wrapOutboundOut(response), promise: nil)
 			let content = HTTPServerResponsePart.body(.byteBuffer(buffer.slice()))
 			let promise = {() -> EventLoopPromise<Void>? in
-				guard !reqHead.isKeepAlive else { return nil }
+				guard !reqHead.isKeepAlive || pool != nil else { return nil }
 				let ret = context.eventLoop.makePromise(of: Void.self)
 				ret.futureResult.whenComplete({ _ in
-					context.close(promise: nil)
+					// ...once written, the channel no longer shares the buffer.
+					pool?.recycle(buffer)
+					if !reqHead.isKeepAlive {
+						context.close(promise: nil)
+					}
 				})
 				return ret
 			}()
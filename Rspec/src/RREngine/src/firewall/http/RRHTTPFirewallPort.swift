@@ -43,6 +43,7 @@ extension RRHTTPFirewallPort : RRFirewallPortInternal {
 		var defaultValue: NetworkPortValue?
 		var clientBacklog: UInt16
 		var reuseAddr: Bool
+		var transport: RRFirewallTransport
 		
 		var targetURL: URL? {
 			guard let value = value else { return nil }
@@ -57,13 +58,15 @@ extension RRHTTPFirewallPort : RRFirewallPortInternal {
 			 value: NetworkPortValue? = nil,
 			 defaultValue: NetworkPortValue? = nil,
 			 clientBacklog: UInt16 = Self.DefaultClientBacklog,
-			 reuseAddr: Bool = true) {
+			 reuseAddr: Bool = true,
+			 transport: RRFirewallTransport = .standard) {
 			self.id 					= id
 			self.isEnabled 				= isEnabled
 			self.value 					= value
 			self.defaultValue 			= defaultValue
 			self.clientBacklog 			= clientBacklog
 			self.reuseAddr 				= reuseAddr
+			self.transport				= transport
 		}
 
 		/*
@@ -0,0 +1,154 @@
+//
+//  RRDynamoPublicationTests.swift
+//  RREngineTests
+// 
+//  Created on 10/27/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import XCTest
+import Combine
+@testable import RREngine
+
+/*
+ *  Verify the paced delivery of runtime state to the main actor.
+ */
+@MainActor
+final class RRDynamoPublicationTests: RREngineTestCase {
+	/*
+	 *  Drive a sustained stream of state modifications and verify they arrive as one
+	 *  update per interval that together account for all of them.
+	 */
+	func testSustainedModification() async throws {
+		let scheduler		  = RRDynamoStateScheduler(clock: .manual)
+		let runtime			  = RRTestCounterRuntime(publishingWith: scheduler)
+		var updates: [RRDynamoStateUpdate] = []
+		let sub = runtime.stateUpdates.sink { updates.append($0) }
+		
+		// - each interval receives a slice of the modifications, so the rate is sustained rather than a burst.
+		for i in 0..<Self.ModificationSlices {
+			await Task.detached {
+				for _ in 0..<Self.ModificationsPerSlice {
+					runtime.withStateIfRunning { $0 += 1 }
+				}
+			}.value
+			XCTAssertTrue(scheduler.advance())
+			XCTAssertEqual(updates.count, i + 1)
+		}
+		XCTAssertFalse(scheduler.advance())
+		sub.cancel()
+		
+		let stats = scheduler.statistics
+		log.info("\(Self.TotalModifications, privacy: .public) modifications --> \(updates.count, privacy: .public) updates, \(stats.passes, privacy: .public) passes, \(stats.mainActorTime, privacy: .public) on the main actor")
+		XCTAssertEqual(runtime.state, Self.TotalModifications)
+		
+		// - the updates are consecutive and complete, including the initial state.
+		XCTAssertEqual(updates.first?.fromVersion, 0)
+		XCTAssertEqual(updates.first?.changeCount, UInt64(Self.ModificationsPerSlice) + 1)
+		XCTAssertEqual(updates.last?.toVersion, UInt64(Self.TotalModifications) + 1)
+		XCTAssertEqual(updates.last?.toVersion, runtime.stateVersion)
+		for (prior, next) in zip(updates, updates.dropFirst()) {
+			XCTAssertEqual(prior.toVersion, next.fromVersion)
+			XCTAssertEqual(next.changeCount, UInt64(Self.ModificationsPerSlice))
+		}
+		XCTAssertEqual(stats.passes, Self.ModificationSlices)
+		XCTAssertEqual(stats.deliveries, updates.count)
+	}
+	
+	/*
+	 *  Verify that many busy runtimes are limited by the delivery budget and never queued
+	 *  more than once each.
+	 */
+	func testDeliveryBudget() async throws {
+		let scheduler = RRDynamoStateScheduler(deliveryBudget: 16, clock: .manual)
+		let runtimes  = (0..<Self.BusyRuntimes).map { _ in RRTestCounterRuntime(publishingWith: scheduler) }
+		var versions  = Array(repeating: UInt64(0), count: runtimes.count)
+		let subs	  = runtimes.indices.map { i in runtimes[i].stateUpdates.sink { versions[i] = $0.toVersion } }
+		
+		await Task.detached {
+			DispatchQueue.concurrentPerform(iterations: runtimes.count) { i in
+				for _ in 0..<1_000 {
+					runtimes[i].withStateIfRunning { $0 += 1 }
+				}
+			}
+		}.value
+		
+		// - each pass delivers no more than the budget.
+		var passes = 0
+		while scheduler.advance() {
+			passes += 1
+			XCTAssertLessThanOrEqual(scheduler.statistics.deliveries, passes * 16)
+		}
+		subs.forEach { $0.cancel() }
+		
+		// - every runtime caught up, a few at a time.
+		let stats = scheduler.statistics
+		XCTAssertEqual(versions, runtimes.map { $0.stateVersion })
+		XCTAssertEqual(stats.passes, Self.BusyRuntimes / 16)
+		XCTAssertEqual(stats.deliveries, Self.BusyRuntimes)
+		XCTAssertEqual(stats.maximumBacklog, Self.BusyRuntimes)
+	}
+	
+	/*
+	 *  Modify the state from many threads while it is being delivered and verify that the
+	 *  last modification is never left undelivered.
+	 */
+	func testConcurrentModification() async throws {
+		let scheduler			= RRDynamoStateScheduler(clock: .manual)
+		let publication			= RRDynamoStatePublication(with: scheduler)
+		var delivered: UInt64	= 0
+		let sub = publication.updates.sink { delivered = $0.toVersion }
+		
+		for _ in 0..<Self.ConcurrentRounds {
+			let isDone = RRAtomicFlag()
+			Task.detached {
+				DispatchQueue.concurrentPerform(iterations: Self.ConcurrentWriters) { _ in
+					for _ in 0..<Self.ModificationsPerWriter {
+						publication.stateDidChange()
+					}
+				}
+				isDone.value = true
+			}
+			
+			// - the deliveries race the modifications...
+			while !isDone.value {
+				scheduler.advance()
+				await Task.yield()
+			}
+			
+			// ...and whatever is left is delivered once they stop.
+			while scheduler.advance() {}
+			XCTAssertEqual(delivered, publication.version)
+		}
+		sub.cancel()
+		XCTAssertEqual(publication.version, UInt64(Self.ConcurrentRounds * Self.ConcurrentWriters * Self.ModificationsPerWriter))
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRDynamoPublicationTests {
+	nonisolated static let ModificationSlices: Int		= 100
+	nonisolated static let ModificationsPerSlice: Int	= 1_000
+	nonisolated static let TotalModifications: Int		= ModificationSlices * ModificationsPerSlice
+	static let BusyRuntimes: Int						= 64
+	nonisolated static let ConcurrentRounds: Int		= 50
+	nonisolated static let ConcurrentWriters: Int		= 8
+	nonisolated static let ModificationsPerWriter: Int	= 2_000
+}
+
+fileprivate struct RRTestCounterConfig : RRDynamoConfigurable {}
+
+/*
+ *  A runtime whose state is a simple count.
+ */
+fileprivate final class RRTestCounterRuntime : RRDynamoRuntime<RRTestCounterConfig, Int>, @unchecked Sendable {
+	init(publishingWith scheduler: RRDynamoStateScheduler) {
+		super.init(with: nil, config: .init(), publishingWith: scheduler)
+	}
+	
+	override func buildRuntimeState() -> Int {
+		return 0
+	}
+}
@@ -0,0 +1,275 @@
+//
+//  RRFirewallTrafficTests.swift
+//  RREngineTests
+// 
+//  Created on 10/19/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import XCTest
+import NIOCore
+import NIOPosix
+import NIOEmbedded
+@testable import RREngine
+
+/*
+ *  Verifies the collection of network traffic through firewall connections.
+ */
+final class RRFirewallTrafficTests: RREngineTestCase {
+	/*
+	 *  Verify that traffic is delivered at the flush cadence, one update per runtime.
+	 */
+	func testBatchedDelivery() throws {
+		let loop	 = EmbeddedEventLoop()
+		let metrics	 = RRFirewallTrafficMetrics(flushInterval: .milliseconds(100))
+		let recorder = metrics.recorder(for: loop)
+		XCTAssertTrue(recorder === metrics.recorder(for: loop))
+		
+		let port  = MetricsSink()
+		let conn1 = MetricsSink()
+		let conn2 = MetricsSink()
+		let s1	  = recorder.open(forPort: port, andConnection: conn1)
+		let s2	  = recorder.open(forPort: port, andConnection: conn2)
+		for _ in 0..<10 {
+			s1.recordBytesIn(100)
+			s2.recordBytesOut(50)
+		}
+		XCTAssertEqual(port.deliveries, 0)
+		
+		// - one update for each runtime, no matter how many buffers.
+		loop.advanceTime(by: .milliseconds(100))
+		XCTAssertEqual(conn1.deliveries, 1)
+		XCTAssertEqual(conn1.totals.bytesIn, 1000)
+		XCTAssertEqual(conn2.totals.bytesOut, 500)
+		XCTAssertEqual(port.deliveries, 1)
+		XCTAssertEqual(port.totals.bytesIn, 1000)
+		XCTAssertEqual(port.totals.bytesOut, 500)
+		
+		// - an idle interval delivers nothing.
+		loop.advanceTime(by: .milliseconds(100))
+		XCTAssertEqual(port.deliveries, 1)
+		
+		// - a closing connection doesn't wait for the next interval.
+		s2.recordBytesOut(7)
+		recorder.close(s2)
+		XCTAssertEqual(conn2.deliveries, 2)
+		XCTAssertEqual(conn2.totals.bytesOut, 507)
+		XCTAssertEqual(port.totals.bytesOut, 507)
+		
+		s2.recordBytesOut(1)
+		loop.advanceTime(by: .milliseconds(100))
+		XCTAssertEqual(conn2.deliveries, 2)
+		try loop.syncShutdownGracefully()
+	}
+	
+	/*
+	 *  Verify that the port metrics reflect the traffic of its requests.
+	 */
+	@MainActor
+	func testPortTraffic() async throws {
+		let engine = createEngine()
+		engine.debugAddHTTPPort()
+		let port   = engine.firewall.ports[0]
+		port.value = 8083
+		await observableChange(for: port, until: { model in
+			model.portStatus == .online
+		})
+		
+		let (_, resp) = try await URLSession.shared.data(from: URL(string: "http://localhost:8083/traffic")!)
+		XCTAssertEqual((resp as? HTTPURLResponse)?.statusCode, 200)
+		await observableChange(for: port, until: { model in
+			model.portMetrics.networkMetrics.bytesIn > 0 && model.portMetrics.networkMetrics.bytesOut > 0
+		})
+		
+		let eRet = await engine.shutdown()
+		XCTAssertTrue(eRet.isOk)
+	}
+	
+	/*
+	 *  Measure loopback throughput when every buffer reports with its own task.
+	 */
+	func testLoopbackPerBufferTasks() throws {
+		try measureLoopback(isBatched: false)
+	}
+	
+	/*
+	 *  Measure loopback throughput when buffers are counted on the event loop.
+	 */
+	func testLoopbackBatched() throws {
+		try measureLoopback(isBatched: true)
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRFirewallTrafficTests {
+	static let BufferSize: Int	= 4 * 1024
+	static let BufferCount: Int	= 20_000
+	
+	/*
+	 *  Receives the traffic deliveries in place of a runtime.
+	 */
+	private final class MetricsSink : RRFirewallPortNetworkMetricsCapable, @unchecked Sendable {
+		var deliveries: Int { withLock { _deliveries } }
+		var totals: RRNetworkMetrics { withLock { _totals } }
+		
+		func notifyNetworkTrafficMetrics(_ metricUpdates: RRNetworkMetrics) {
+			withLock {
+				_deliveries += 1
+				_totals		+= metricUpdates
+			}
+		}
+		
+		private func withLock<T>(_ block: () -> T) -> T {
+			sLock.lock()
+			defer { sLock.unlock() }
+			return block()
+		}
+		
+		private let sLock: NSLock				= .init()
+		private var _deliveries: Int			= 0
+		private var _totals: RRNetworkMetrics	= .init()
+	}
+	
+	/*
+	 *  The prior approach, which hops off the event loop for every buffer.
+	 */
+	private final class PerBufferTaskHandler : ChannelInboundHandler, @unchecked Sendable {
+		typealias InboundIn = ByteBuffer
+		
+		init(port: MetricsSink, connection: MetricsSink) {
+			self.port		= port
+			self.connection = connection
+		}
+		
+		func channelRead(context: ChannelHandlerContext, data: NIOAny) {
+			let count = UInt(self.unwrapInboundIn(data).readableBytes)
+			Task { [port, connection] in
+				connection.notifyNetworkTrafficMetrics(.init(bytesIn: count))
+				port.notifyNetworkTrafficMetrics(.init(bytesIn: count))
+			}
+			context.fireChannelRead(data)
+		}
+		
+		private let port: MetricsSink
+		private let connection: MetricsSink
+	}
+	
+	/*
+	 *  Counts in place, the way RRFirewallConnectionHandler does.
+	 */
+	private final class BatchedHandler : ChannelInboundHandler {
+		typealias InboundIn = ByteBuffer
+		
+		init(metrics: RRFirewallTrafficMetrics, port: MetricsSink, connection: MetricsSink) {
+			self.metrics	= metrics
+			self.port		= port
+			self.connection = connection
+		}
+		
+		func handlerAdded(context: ChannelHandlerContext) {
+			recorder = metrics.recorder(for: context.eventLoop)
+			slot	 = recorder?.open(forPort: port, andConnection: connection)
+		}
+		
+		func handlerRemoved(context: ChannelHandlerContext) {
+			if let slot = slot {
+				recorder?.close(slot)
+			}
+			slot = nil
+		}
+		
+		func channelRead(context: ChannelHandlerContext, data: NIOAny) {
+			slot?.recordBytesIn(self.unwrapInboundIn(data).readableBytes)
+			context.fireChannelRead(data)
+		}
+		
+		private let metrics: RRFirewallTrafficMetrics
+		private let port: MetricsSink
+		private let connection: MetricsSink
+		private var recorder: RRFirewallTrafficMetrics.Recorder?
+		private var slot: RRFirewallTrafficMetrics.Slot?
+	}
+	
+	/*
+	 *  Discards what it receives, completing once everything has arrived.
+	 */
+	private final class DrainHandler : ChannelInboundHandler {
+		typealias InboundIn = ByteBuffer
+		
+		init(expecting total: Int, completion: EventLoopPromise<Void>) {
+			self.remaining  = total
+			self.completion = completion
+		}
+		
+		func channelRead(context: ChannelHandlerContext, data: NIOAny) {
+			remaining -= self.unwrapInboundIn(data).readableBytes
+			if remaining <= 0 {
+				completion.succeed()
+			}
+		}
+		
+		private var remaining: Int
+		private let completion: EventLoopPromise<Void>
+	}
+	
+	/*
+	 *  Push a fixed volume through a loopback connection, measuring the time and memory to
+	 *  receive it and verifying that every byte was eventually counted.
+	 */
+	private func measureLoopback(isBatched: Bool) throws {
+		let group	= MultiThreadedEventLoopGroup(numberOfThreads: 2)
+		defer { try? group.syncShutdownGracefully() }
+		let metrics	= RRFirewallTrafficMetrics()
+		let total	= Self.BufferSize * Self.BufferCount
+		let payload	= ByteBuffer(repeating: 0x52, count: Self.BufferSize)
+		
+		var round = 0
+		measure(metrics: [XCTClockMetric(), XCTCPUMetric(), XCTMemoryMetric()]) {
+			round += 1
+			let port	   = MetricsSink()
+			let connection = MetricsSink()
+			let received   = group.next().makePromise(of: Void.self)
+			let start	   = Date()
+			
+			do {
+				let server = try ServerBootstrap(group: group)
+					.childChannelInitializer { channel in
+						let counter: ChannelHandler = isBatched ? BatchedHandler(metrics: metrics, port: port, connection: connection) :
+																  PerBufferTaskHandler(port: port, connection: connection)
+						return channel.pipeline.addHandlers([counter, DrainHandler(expecting: total, completion: received)])
+					}
+					.bind(host: "127.0.0.1", port: 0).wait()
+				let client = try ClientBootstrap(group: group).connect(to: server.localAddress!).wait()
+				for _ in 0..<Self.BufferCount {
+					client.write(payload, promise: nil)
+				}
+				client.flush()
+				try received.futureResult.wait()
+				let elapsed = Date().timeIntervalSince(start)
+				
+				try client.close().wait()
+				try server.close().wait()
+				
+				// - the counts arrive after the data, either as tasks complete or on close.
+				let deadline = Date().addingTimeInterval(10)
+				while port.totals.bytesIn < UInt(total), Date() < deadline {
+					Thread.sleep(forTimeInterval: 0.01)
+				}
+				XCTAssertEqual(port.totals.bytesIn, UInt(total))
+				XCTAssertEqual(connection.totals.bytesIn, UInt(total))
+				
+				let mbps = Double(total) / elapsed / (1024 * 1024)
+				log.info("Loopback round \(round, privacy: .public) (\(isBatched ? "batched" : "per-buffer task", privacy: .public)) --> \(String(format: "%.1f", mbps), privacy: .public) MB/s, \(port.deliveries, privacy: .public) port deliveries.")
+				if isBatched {
+					XCTAssertLessThan(port.deliveries, 100)
+				}
+			}
+			catch {
+				XCTFail("Loopback failed.  \(error.localizedDescription)")
+			}
+		}
+		metrics.shutdown()
+	}
+}
@@ -0,0 +1,186 @@
+//
+//  RRHTTPFirewallPortLoadTests.swift
+//  RREngineTests
+// 
+//  Created on 10/21/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import XCTest
+import NIOCore
+import NIOPosix
+import NIOHTTP1
+import RREngine
+
+/*
+ *  Drives sustained local request load against the HTTP port, in the spirit of 'wrk'.
+ */
+@MainActor
+final class RRHTTPFirewallPortLoadTests: RREngineTestCase {
+	/*
+	 *  Report the request rate and latency of the standard transport.
+	 */
+	func testHTTPLoad() async throws {
+		let report = try await runLoad(with: .standard)
+		XCTAssertGreaterThan(report.requests, 0)
+		XCTAssertEqual(report.errors, 0)
+		XCTAssertLessThan(report.p99, 1.0)
+	}
+	
+	/*
+	 *  Report the request rate and latency of the transport variations side by side.
+	 */
+	func testHTTPLoadByTransport() async throws {
+		let variations: [(name: String, transport: RRFirewallTransport)] = [
+			("single read, unpooled", .init(maxMessagesPerRead: 1, isBufferPoolingEnabled: false)),
+			("standard", .standard),
+			("dedicated threads", .init(eventLoopThreads: 2))
+		]
+		
+		for v in variations {
+			let report = try await runLoad(with: v.transport)
+			log.info("\(v.name, privacy: .public) --> \(report.description, privacy: .public)")
+			XCTAssertGreaterThan(report.requests, 0)
+			XCTAssertEqual(report.errors, 0)
+		}
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRHTTPFirewallPortLoadTests {
+	static let PortValue: NetworkPortValue		= 8083
+	static let Connections: Int					= 16
+	static let Duration: TimeAmount				= .seconds(3)
+	
+	// - the outcome of a load run.
+	private struct LoadReport : CustomStringConvertible {
+		let requests: Int
+		let errors: Int
+		let elapsed: TimeInterval
+		let p50: TimeInterval
+		let p99: TimeInterval
+		
+		var requestsPerSecond: Double { elapsed > 0 ? Double(requests) / elapsed : 0 }
+		var description: String {
+			String(format: "%ld requests, %.0f req/s, p50 %.2fms, p99 %.2fms, %ld errors", requests, requestsPerSecond, p50 * 1000, p99 * 1000, errors)
+		}
+	}
+	
+	/*
+	 *  Issues requests one after another on a keep-alive connection until the deadline,
+	 *  recording the latency of each.
+	 */
+	private final class LoadClientHandler : ChannelInboundHandler {
+		typealias InboundIn = HTTPClientResponsePart
+		typealias OutboundOut = HTTPClientRequestPart
+		
+		init(until deadline: NIODeadline, completion: EventLoopPromise<[UInt64]>) {
+			self.deadline	= deadline
+			self.completion = completion
+		}
+		
+		func channelActive(context: ChannelHandlerContext) {
+			sendRequest(context: context)
+			context.fireChannelActive()
+		}
+		
+		func channelRead(context: ChannelHandlerContext, data: NIOAny) {
+			guard case .end(_) = self.unwrapInboundIn(data) else { return }
+			latencies.append(DispatchTime.now().uptimeNanoseconds - sentAt)
+			if NIODeadline.now() < deadline {
+				sendRequest(context: context)
+			}
+			else {
+				finish(with: .success(latencies))
+				context.close(promise: nil)
+			}
+		}
+		
+		func errorCaught(context: ChannelHandlerContext, error: Error) {
+			finish(with: .failure(error))
+			context.close(promise: nil)
+		}
+		
+		func channelInactive(context: ChannelHandlerContext) {
+			finish(with: .failure(ChannelError.ioOnClosedChannel))
+			context.fireChannelInactive()
+		}
+		
+		private func sendRequest(context: ChannelHandlerContext) {
+			var head = HTTPRequestHead(version: .http1_1, method: .GET, uri: "/load")
+			head.headers.add(name: "host", value: "localhost")
+			sentAt = DispatchTime.now().uptimeNanoseconds
+			context.write(self.wrapOutboundOut(.head(head)), promise: nil)
+			context.writeAndFlush(self.wrapOutboundOut(.end(nil)), promise: nil)
+		}
+		
+		private func finish(with result: Result<[UInt64], Error>) {
+			guard !isFinished else { return }
+			isFinished = true
+			completion.completeWith(result)
+		}
+		
+		private let deadline: NIODeadline
+		private let completion: EventLoopPromise<[UInt64]>
+		private var latencies: [UInt64]	= []
+		private var sentAt: UInt64		= 0
+		private var isFinished: Bool	= false
+	}
+	
+	/*
+	 *  Bring up a port with the transport and load it from concurrent connections.
+	 */
+	private func runLoad(with transport: RRFirewallTransport) async throws -> LoadReport {
+		let engine = createEngine()
+		engine.debugAddHTTPPort()
+		let port	   = engine.firewall.ports[0]
+		port.transport = transport
+		port.value	   = Self.PortValue
+		await observableChange(for: port, until: { model in
+			model.portStatus == .online
+		})
+		
+		// - the client gets its own threads so it doesn't compete with the port's.
+		let group = MultiThreadedEventLoopGroup(numberOfThreads: 2)
+		let start = Date()
+		var all: [UInt64] = []
+		var errors		  = 0
+		let deadline	  = NIODeadline.now() + Self.Duration
+		let results		  = (0..<Self.Connections).map({ _ -> EventLoopFuture<[UInt64]> in
+			let completion = group.next().makePromise(of: [UInt64].self)
+			ClientBootstrap(group: group)
+				.channelInitializer({ channel in
+					channel.pipeline.addHTTPClientHandlers().flatMap({
+						channel.pipeline.addHandler(LoadClientHandler(until: deadline, completion: completion))
+					})
+				})
+				.connect(host: "localhost", port: Int(Self.PortValue))
+				.whenFailure({ completion.fail($0) })
+			return completion.futureResult
+		})
+		for r in results {
+			do {
+				all += try await r.get()
+			}
+			catch {
+				errors += 1
+			}
+		}
+		let elapsed = Date().timeIntervalSince(start)
+		try await group.shutdownGracefully()
+		
+		let eRet = await engine.shutdown()
+		XCTAssertTrue(eRet.isOk)
+		
+		all.sort()
+		func percentile(_ p: Double) -> TimeInterval {
+			guard !all.isEmpty else { return 0 }
+			return TimeInterval(all[min(Int(Double(all.count) * p), all.count - 1)]) / 1_000_000_000
+		}
+		let ret = LoadReport(requests: all.count, errors: errors, elapsed: elapsed, p50: percentile(0.5), p99: percentile(0.99))
+		log.info("HTTP load --> \(ret.description, privacy: .public)")
+		return ret
+	}
+}
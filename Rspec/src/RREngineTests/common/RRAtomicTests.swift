@@ -0,0 +1,170 @@
+//
+//  RRAtomicTests.swift
+//  RREngineTests
+// 
+//  Created on 10/24/23
+//  Copyright © 2023 RealProven, LLC.  All rights reserved. 
+//
+
+import XCTest
+@testable import RREngine
+
+final class RRAtomicTests: RREngineTestCase {
+	/*
+	 *  Verify that counters don't lose increments under contention.
+	 */
+	func testCounter() throws {
+		let counter = RRAtomicCounter<Int>()
+		DispatchQueue.concurrentPerform(iterations: 16) { _ in
+			for _ in 0..<10_000 {
+				counter.add(1)
+			}
+		}
+		XCTAssertEqual(counter.value, 160_000)
+		XCTAssertEqual(counter.valueThenChanged(to: 0), 160_000)
+		XCTAssertEqual(counter.value, 0)
+		
+		let flag = RRAtomicFlag()
+		XCTAssertTrue(flag.change(from: false, to: true))
+		XCTAssertFalse(flag.change(from: false, to: true))
+		XCTAssertTrue(flag.value)
+	}
+	
+	/*
+	 *  Verify that snapshot modifications are never lost and readers never see
+	 *  a partial one.
+	 */
+	func testSnapshot() throws {
+		let snapshot = RRAtomicSnapshot(Pair())
+		DispatchQueue.concurrentPerform(iterations: 8) { i in
+			for _ in 0..<5_000 {
+				if i % 2 == 0 {
+					snapshot.update { p in
+						p.first  += 1
+						p.second += 1
+					}
+				}
+				else {
+					let p = snapshot.value
+					XCTAssertEqual(p.first, p.second)
+				}
+			}
+		}
+		XCTAssertEqual(snapshot.value.first, 20_000)
+		XCTAssertEqual(snapshot.value.second, 20_000)
+	}
+	
+	/*
+	 *  Verify that many changes are delivered to the main actor as few notifications,
+	 *  the last of which follows the final change.
+	 */
+	@MainActor
+	func testCoalescedPublication() async throws {
+		let counter				= RRAtomicCounter<Int>(publishesChanges: true)
+		var deliveries			= 0
+		var lastObserved: Int	= -1
+		let sub = counter.objectWillChange.sink {
+			deliveries	 += 1
+			lastObserved = counter.value
+		}
+		
+		await Task.detached {
+			DispatchQueue.concurrentPerform(iterations: 4) { _ in
+				for _ in 0..<25_000 {
+					counter.add(1)
+				}
+			}
+		}.value
+		try await Task.sleep(for: .milliseconds(100))
+		sub.cancel()
+		
+		log.info("Delivered \(deliveries, privacy: .public) notifications for 100000 changes.")
+		XCTAssertGreaterThan(deliveries, 0)
+		XCTAssertLessThan(deliveries, 10_000)
+		XCTAssertEqual(lastObserved, 100_000)
+	}
+	
+	/*
+	 *  Compare contended throughput of the locked and lock-free variants with a read-mostly
+	 *  workload, which is typical of engine state.
+	 */
+	func testContendedThroughput() throws {
+		log.info("threads | locked int | lock-free int | locked struct | snapshot struct  (Mops/s)")
+		for threads in [1, 2, 4, 8, 16] {
+			let lockedInt	  = RRAtomic<Int>(0)
+			let counter		  = RRAtomicCounter<Int>()
+			let lockedStruct  = RRAtomic<Pair>(.init())
+			let snapshot	  = RRAtomicSnapshot(Pair())
+			
+			let r0 = throughput(threads: threads) { i in
+				if i % Self.WriteEvery == 0 {
+					lockedInt.withLock { lockedInt.value += 1 }
+				}
+				else {
+					_ = lockedInt.value
+				}
+			}
+			let r1 = throughput(threads: threads) { i in
+				if i % Self.WriteEvery == 0 {
+					counter.add(1)
+				}
+				else {
+					_ = counter.value
+				}
+			}
+			let r2 = throughput(threads: threads) { i in
+				if i % Self.WriteEvery == 0 {
+					lockedStruct.withLock { lockedStruct.value.first += 1 }
+				}
+				else {
+					_ = lockedStruct.value.first
+				}
+			}
+			let r3 = throughput(threads: threads) { i in
+				if i % Self.WriteEvery == 0 {
+					snapshot.update { $0.first += 1 }
+				}
+				else {
+					_ = snapshot.value.first
+				}
+			}
+			
+			// - every write must have landed in each.
+			let writes = threads * (Self.OpsPerThread / Self.WriteEvery)
+			XCTAssertEqual(lockedInt.value, writes)
+			XCTAssertEqual(counter.value, writes)
+			XCTAssertEqual(lockedStruct.value.first, writes)
+			XCTAssertEqual(snapshot.value.first, writes)
+			
+			log.info("\(String(format: "%7ld | %10.2f | %13.2f | %13.2f | %15.2f", threads, r0, r1, r2, r3), privacy: .public)")
+		}
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension RRAtomicTests {
+	static let OpsPerThread: Int	= 200_000
+	static let WriteEvery: Int		= 10
+	
+	// - a value with an invariant that is only true of complete modifications.
+	private struct Pair {
+		var first: Int	= 0
+		var second: Int	= 0
+	}
+	
+	/*
+	 *  Run the operation from each thread, returning millions of operations per second.
+	 */
+	private func throughput(threads: Int, _ op: (_ index: Int) -> Void) -> Double {
+		let start = Date()
+		DispatchQueue.concurrentPerform(iterations: threads) { _ in
+			for i in 0..<Self.OpsPerThread {
+				op(i)
+			}
+		}
+		let elapsed = Date().timeIntervalSince(start)
+		return Double(threads * Self.OpsPerThread) / elapsed / 1_000_000
+	}
+}
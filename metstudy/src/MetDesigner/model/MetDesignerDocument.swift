@@ -138,7 +138,8 @@ struct MDDocumentSnapshot : Identifiable {
  */
 extension MetDesignerDocument {
 	private static var Manifest: String		= "manifest.json"
-	private static var ObjectIndex: String  = "object-index.json"
+	private static var ObjectIndex: String  = "object-index.mmidx"
+	private static var ObjectIndexJSON: String = "object-index.json"		// - saved before the binary format
 	
 	/*
 	 *  Write the document to disk.
@@ -150,7 +151,7 @@ extension MetDesignerDocument {
 		try ret.writeChildEncoded(snapshot.manifest, asName: Self.Manifest)
 		
 		// - the index, which may not have been set yet.
-		if let curIdx = ret.fileWrappers?[Self.ObjectIndex] {
+		if let curIdx = ret.fileWrappers?[Self.ObjectIndex] ?? ret.fileWrappers?[Self.ObjectIndexJSON] {
 			/// ...normally the index is not overwritten, but if it is discarded then
 			///    remove the item.
 			if snapshot.objectIndex == nil {
@@ -158,7 +159,9 @@ extension MetDesignerDocument {
 			}
 		}
 		else if let newIdx = snapshot.objectIndex {
-			try ret.writeChildEncoded(newIdx, asName: Self.ObjectIndex, isPretty: false)
+			let fwChild 			  = FileWrapper(regularFileWithContents: try newIdx.binaryEncoding())
+			fwChild.preferredFilename = Self.ObjectIndex
+			ret.addFileWrapper(fwChild)
 		}
 				
 		return ret
@@ -175,8 +178,14 @@ extension MetDesignerDocument {
 		}
 		var ret = MDDocumentSnapshot(with: manifest)
 		
-		// - the object index if it exists.
-		ret.objectIndex = try file.readChildEncoded(named: Self.ObjectIndex, asType: MMObjectIndex.self)
+		// - the object index if it exists, preferring the binary format which doesn't
+		//   need to be decoded up front.
+		if let data = file.fileWrappers?[Self.ObjectIndex]?.regularFileContents {
+			ret.objectIndex = try MetModel.openIndex(from: data)
+		}
+		else {
+			ret.objectIndex = try file.readChildEncoded(named: Self.ObjectIndexJSON, asType: MMObjectIndex.self)
+		}
 		
 		return ret
 	}
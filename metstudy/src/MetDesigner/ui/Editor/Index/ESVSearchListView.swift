@@ -56,6 +56,11 @@ struct ESVSearchListView: View {
 					guard let rowIndex = self.currentRowIndex else { return }
 					self.selectRow(index: rowIndex, proxy: proxy)
 				})
+				.onChange(of: userState.selectionState, { _, _ in
+					// - the neighbors are likely to be inspected next.
+					guard let rowIndex = self.currentRowIndex else { return }
+					self.exhibitList.prefetchExhibits(around: rowIndex)
+				})
 			}
 			.background(.white)
 		}
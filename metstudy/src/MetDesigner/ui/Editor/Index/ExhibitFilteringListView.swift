@@ -94,6 +94,9 @@ extension ExhibitFilteringListView {
 						}
 					}
 				}
+				catch MMError.cancelled {
+					// - a newer filter replaced this one.
+				}
 				catch {
 					MDLog.error("The exhibit index failed to be filtered successfully.  \(error.localizedDescription)")
 					self.alert = .init(error: error)
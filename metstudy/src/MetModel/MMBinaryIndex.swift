@@ -0,0 +1,443 @@
+//
+//  MMBinaryIndex.swift
+//  MetModel
+// 
+//  Created on 3/14/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+
+/*
+ *  DESIGN:  The JSON encoding of a full index is hundreds of megabytes of text that must
+ *			 be completely parsed into objects before the index can be used.  This format is
+ *			 columnar so that it can be mapped and used immediately, decoding an exhibit
+ *			 reference only when it is first requested.
+ *
+ *			 header:	 'MMIX', version, index id, row/unique/string/tag counts
+ *			 sections:	 a table of byte offsets to every section, followed by the end of file
+ *			 strings:	 each distinct string is stored once as UTF-8 and referenced by its
+ *						 ordinal in an offset table so repeated values (departments, cultures,
+ *						 media) cost only four bytes per row.
+ *			 columns:	 fixed-width ids, years and dates, a flag byte and a string ordinal
+ *						 per text field, with `NoYear`/`NoString` for values that are absent.
+ *			 tags:		 an offset table per row into a list of string ordinals.
+ *			 id order:	 row offsets sorted by object id for identifier lookups.
+ *
+ *			 Every value is little-endian and every section is 8-byte aligned.
+ */
+#if _endian(big)
+#error("The binary index format assumes a little-endian host.")
+#endif
+
+/*
+ *  A read-only object index in its binary format.
+ */
+final class MMBinaryIndex {
+	///  The file extension for saved binary indices.
+	static var FileExtension: String { "mmidx" }
+	
+	/*
+	 *  Open a binary index from a file, mapping it when possible.
+	 */
+	convenience init(contentsOf url: URL) throws {
+		let data: NSData
+		do {
+			data = try NSData(contentsOf: url, options: .alwaysMapped)
+		}
+		catch {
+			throw MMError.invalidFile
+		}
+		try self.init(backing: data)
+	}
+	
+	/*
+	 *  Open a binary index from data.
+	 */
+	convenience init(data: Data) throws {
+		// - the bridged instance is immutable, so its bytes are stable for its lifetime
+		//   and if the data came from a mapped file, they're still not copied.
+		try self.init(backing: data as NSData)
+	}
+	
+	/*
+	 *  Initialize the object.
+	 */
+	private init(backing: NSData) throws {
+		let len = backing.length
+		guard len >= Self.HeaderSize + Self.SectionTableSize else {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index has no content."))
+		}
+		let base = backing.bytes
+		guard base.loadUnaligned(as: UInt32.self) == Self.Magic else {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The file data is invalid or unexpected."))
+		}
+		guard base.loadUnaligned(fromByteOffset: 4, as: UInt32.self) == Self.Version else {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index was saved by an unsupported version."))
+		}
+		
+		var uuid: uuid_t = UUID().uuid
+		withUnsafeMutableBytes(of: &uuid) { uBuf in
+			uBuf.copyMemory(from: UnsafeRawBufferPointer(start: base + 8, count: 16))
+		}
+		self.backing	 = backing
+		self.base		 = base
+		self.indexId	 = UUID(uuid: uuid)
+		self.count		 = Int(base.loadUnaligned(fromByteOffset: 24, as: UInt32.self))
+		self.uniqueCount = Int(base.loadUnaligned(fromByteOffset: 28, as: UInt32.self))
+		self.stringCount = Int(base.loadUnaligned(fromByteOffset: 32, as: UInt32.self))
+		self.tagRefCount = Int(base.loadUnaligned(fromByteOffset: 36, as: UInt32.self))
+		
+		// - the offsets are converted exactly because a damaged file could hold any value.
+		var sections: [Int] = []
+		for i in 0...Section.allCases.count {
+			guard let offset = Int(exactly: base.loadUnaligned(fromByteOffset: Self.HeaderSize + i * 8, as: UInt64.self)) else {
+				throw MMError.badFormat(msg: .mmLocalized(localized: "The file data is invalid or unexpected."))
+			}
+			sections.append(offset)
+		}
+		self.sections = sections
+		try validate(length: len)
+	}
+	
+	///  The identifier of the index that was saved.
+	let indexId: UUID
+	
+	///  The number of rows.
+	let count: Int
+	
+	///  The number of distinct object identifiers.
+	let uniqueCount: Int
+	
+	/*
+	 *  Return the object identifier of a row without decoding it.
+	 */
+	func objectID(at offset: Int) -> UInt {
+		return UInt(u32(.objectIDs, offset))
+	}
+	
+	/*
+	 *  Return the reference for a row, decoding it if it hasn't been requested before.
+	 */
+	func row(at offset: Int) -> MMExhibitRef {
+		rLock.lock()
+		defer { rLock.unlock() }
+		if rowCache.isEmpty {
+			rowCache = .init(repeating: nil, count: count)
+		}
+		if let ret = rowCache[offset] {
+			return ret
+		}
+		let ret = decodeRow(at: offset)
+		rowCache[offset] = ret
+		return ret
+	}
+		
+	/*
+	 *  Decode the reference for a row without retaining it.
+	 */
+	func decodeRow(at offset: Int) -> MMExhibitRef {
+		let flags = base.load(fromByteOffset: sections[Section.flags.rawValue] + offset, as: UInt8.self)
+		let aYear = base.loadUnaligned(fromByteOffset: sections[Section.accessionYears.rawValue] + offset * 2, as: UInt16.self)
+		var tags: [String] = []
+		let tBegin = Int(u32(.tagOffsets, offset))
+		let tEnd   = Int(u32(.tagOffsets, offset + 1))
+		for i in tBegin..<tEnd {
+			tags.append(string(ordinal: u32(.tagRefs, i)) ?? "")
+		}
+		return MMExhibitRef(objectID: objectID(at: offset),
+							   accessionNumber: string(.accessionNumbers, offset) ?? "",
+							   isHighlight: flags & Flag.isHighlight != 0,
+							   isTimelineWork: flags & Flag.isTimelineWork != 0,
+							   isPublicDomain: flags & Flag.isPublicDomain != 0,
+							   department: string(.departments, offset) ?? "",
+							   accessionYear: aYear != Self.NoYear ? UInt(aYear) : nil,
+							   objectName: string(.objectNames, offset),
+							   title: string(.titles, offset),
+							   culture: string(.cultures, offset),
+							   artistDisplayName: string(.artistNames, offset),
+							   artistDisplayBio: string(.artistBios, offset),
+							   objectBeginDate: Int(i32(.beginDates, offset)),
+							   objectEndDate: Int(i32(.endDates, offset)),
+							   medium: string(.media, offset),
+							   linkResource: string(.linkResources, offset) ?? "",
+							   tags: tags)
+	}
+	
+	/*
+	 *  Find the row for an object identifier, preferring the last one when it is repeated.
+	 */
+	func offset(ofObjectID objectID: UInt) -> Int? {
+		var lower = 0
+		var upper = count
+		while lower < upper {
+			let mid = (lower + upper) / 2
+			if self.objectID(at: Int(u32(.idOrder, mid))) <= objectID {
+				lower = mid + 1
+			}
+			else {
+				upper = mid
+			}
+		}
+		guard lower > 0 else { return nil }
+		let ret = Int(u32(.idOrder, lower - 1))
+		return self.objectID(at: ret) == objectID ? ret : nil
+	}
+	
+	/*
+	 *  Encode the references in the binary format.
+	 */
+	static func encode<C: RandomAccessCollection>(_ refs: C, indexId: UUID) throws -> Data where C.Element == MMExhibitRef, C.Index == Int {
+		guard refs.count < Int(UInt32.max) else {
+			throw MMError.badArguments(msg: "The object index is too large to be saved.")
+		}
+		
+		var strings = StringTable()
+		var ids: [UInt32]			  = []
+		var years: [UInt16]			  = []
+		var begins: [Int32]			  = []
+		var ends: [Int32]			  = []
+		var flags: [UInt8]			  = []
+		var textCols: [[UInt32]]	  = .init(repeating: [], count: Self.TextSections.count)
+		var tagOffsets: [UInt32]	  = [0]
+		var tagRefs: [UInt32]		  = []
+		var unique: Set<UInt>		  = []
+		for ref in refs {
+			guard let oId = UInt32(exactly: ref.objectID),
+				  let bDate = Int32(exactly: ref.objectBeginDate), let eDate = Int32(exactly: ref.objectEndDate),
+				  let aYear = UInt16(exactly: ref.accessionYear ?? UInt(Self.NoYear)), ref.accessionYear != UInt(Self.NoYear) else {
+				throw MMError.badArguments(msg: "The exhibit \(ref.objectID) cannot be saved in the binary format.")
+			}
+			ids.append(oId)
+			years.append(aYear)
+			begins.append(bDate)
+			ends.append(eDate)
+			flags.append((ref.isHighlight ? Flag.isHighlight : 0) | (ref.isTimelineWork ? Flag.isTimelineWork : 0) | (ref.isPublicDomain ? Flag.isPublicDomain : 0))
+			unique.insert(ref.objectID)
+			
+			let texts: [String?] = [ref.accessionNumber, ref.department, ref.objectName, ref.title, ref.culture,
+									ref.artistDisplayName, ref.artistDisplayBio, ref.medium, ref.linkResource]
+			for i in 0..<texts.count {
+				if let oneText = texts[i] {
+					textCols[i].append(try strings.ordinal(of: oneText))
+				}
+				else {
+					textCols[i].append(Self.NoString)
+				}
+			}
+			for oneTag in ref.tags {
+				tagRefs.append(try strings.ordinal(of: oneTag))
+			}
+			tagOffsets.append(UInt32(tagRefs.count))
+		}
+		
+		// - the identifiers in ascending order, which is stable so that a
+		//   repeated identifier always resolves to its last row.
+		let idOrder = (0..<UInt32(ids.count)).sorted { ids[Int($0)] != ids[Int($1)] ? ids[Int($0)] < ids[Int($1)] : $0 < $1 }
+		
+		// - assemble the file.
+		var ret = Data(count: Self.HeaderSize + Self.SectionTableSize)
+		var sections: [UInt64] = []
+		for oneSection in Section.allCases {
+			while ret.count % 8 != 0 {
+				ret.append(0)
+			}
+			sections.append(UInt64(ret.count))
+			switch oneSection {
+			case .stringOffsets:	strings.offsets.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .stringData:		ret.append(contentsOf: strings.data)
+			case .objectIDs:		ids.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .accessionYears:	years.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .beginDates:		begins.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .endDates:			ends.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .flags:			ret.append(contentsOf: flags)
+			case .tagOffsets:		tagOffsets.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .tagRefs:			tagRefs.withUnsafeBytes { ret.append(contentsOf: $0) }
+			case .idOrder:			idOrder.withUnsafeBytes { ret.append(contentsOf: $0) }
+			default:
+				guard let tOffset = Self.TextSections.firstIndex(of: oneSection) else {
+					assert(false, "Unexpected section.")
+					throw MMError.failedAssertion
+				}
+				textCols[tOffset].withUnsafeBytes { ret.append(contentsOf: $0) }
+			}
+		}
+		sections.append(UInt64(ret.count))
+		
+		ret.withUnsafeMutableBytes { rBuf in
+			rBuf.storeBytes(of: Self.Magic, toByteOffset: 0, as: UInt32.self)
+			rBuf.storeBytes(of: Self.Version, toByteOffset: 4, as: UInt32.self)
+			withUnsafeBytes(of: indexId.uuid) { uBuf in
+				UnsafeMutableRawBufferPointer(rebasing: rBuf[8..<24]).copyMemory(from: uBuf)
+			}
+			rBuf.storeBytes(of: UInt32(ids.count), toByteOffset: 24, as: UInt32.self)
+			rBuf.storeBytes(of: UInt32(unique.count), toByteOffset: 28, as: UInt32.self)
+			rBuf.storeBytes(of: UInt32(strings.offsets.count - 1), toByteOffset: 32, as: UInt32.self)
+			rBuf.storeBytes(of: UInt32(tagRefs.count), toByteOffset: 36, as: UInt32.self)
+			for i in 0..<sections.count {
+				rBuf.storeBytes(of: sections[i], toByteOffset: Self.HeaderSize + i * 8, as: UInt64.self)
+			}
+		}
+		return ret
+	}
+	
+	// - internal
+	private static var Magic: UInt32 { 0x58494D4D }			// - 'MMIX'
+	private static var Version: UInt32 { 1 }
+	private static var HeaderSize: Int { 40 }
+	private static var SectionTableSize: Int { (Section.allCases.count + 1) * 8 }
+	private static var NoString: UInt32 { .max }
+	private static var NoYear: UInt16 { .max }
+	
+	private let backing: NSData
+	private let base: UnsafeRawPointer
+	private let sections: [Int]
+	private let stringCount: Int
+	private let tagRefCount: Int
+	private let rLock: NSLock				 = .init()
+	private var rowCache: [MMExhibitRef?] = []
+	
+	// - the sections of the file, in order.
+	private enum Section : Int, CaseIterable {
+		case stringOffsets
+		case stringData
+		case objectIDs
+		case accessionYears
+		case beginDates
+		case endDates
+		case flags
+		case accessionNumbers
+		case departments
+		case objectNames
+		case titles
+		case cultures
+		case artistNames
+		case artistBios
+		case media
+		case linkResources
+		case tagOffsets
+		case tagRefs
+		case idOrder
+	}
+	
+	// - the text columns, in the order they are encoded.
+	private static let TextSections: [Section] = [.accessionNumbers, .departments, .objectNames, .titles, .cultures,
+												  .artistNames, .artistBios, .media, .linkResources]
+	
+	// - the bits of the flags column.
+	private enum Flag {
+		static let isHighlight: UInt8	 = 0x01
+		static let isTimelineWork: UInt8 = 0x02
+		static let isPublicDomain: UInt8 = 0x04
+	}
+	
+	// - the distinct strings of an index while it is encoded.
+	private struct StringTable {
+		var ordinals: [String : UInt32] = [:]
+		var offsets: [UInt32]			= [0]
+		var data: [UInt8]				= []
+		
+		/*
+		 *  Return the ordinal of the string, adding it if it is new.
+		 */
+		mutating func ordinal(of text: String) throws -> UInt32 {
+			if let ret = ordinals[text] {
+				return ret
+			}
+			data.append(contentsOf: text.utf8)
+			guard data.count < Int(UInt32.max), offsets.count < Int(MMBinaryIndex.NoString) else {
+				throw MMError.badArguments(msg: "The object index is too large to be saved.")
+			}
+			let ret = UInt32(offsets.count - 1)
+			offsets.append(UInt32(data.count))
+			ordinals[text] = ret
+			return ret
+		}
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMBinaryIndex {
+	/*
+	 *  Verify the section table and offset tables so that rows can be decoded without
+	 *  further bounds checks.
+	 */
+	private func validate(length: Int) throws {
+		let badFormat = MMError.badFormat(msg: .mmLocalized(localized: "The file data is invalid or unexpected."))
+		guard sections.last == length else { throw badFormat }
+		for oneSection in Section.allCases {
+			let begin = sections[oneSection.rawValue]
+			let end	  = sections[oneSection.rawValue + 1]
+			guard begin % 8 == 0, begin <= end, begin >= Self.HeaderSize + Self.SectionTableSize else { throw badFormat }
+			
+			let minLength: Int
+			switch oneSection {
+			case .stringOffsets:	minLength = (stringCount + 1) * 4
+			case .stringData:		minLength = 0
+			case .accessionYears:	minLength = count * 2
+			case .flags:			minLength = count
+			case .tagOffsets:		minLength = (count + 1) * 4
+			case .tagRefs:			minLength = tagRefCount * 4
+			default:				minLength = count * 4
+			}
+			guard end - begin >= minLength else { throw badFormat }
+		}
+		
+		// - the offset tables must be ordered and in range.
+		let sLength = sections[Section.stringData.rawValue + 1] - sections[Section.stringData.rawValue]
+		guard isAscending(.stringOffsets, count: stringCount + 1, limit: sLength) &&
+				isAscending(.tagOffsets, count: count + 1, limit: tagRefCount) else { throw badFormat }
+		
+		// ...and the id order must only refer to rows.
+		for i in 0..<count {
+			guard Int(u32(.idOrder, i)) < count else { throw badFormat }
+		}
+	}
+	
+	/*
+	 *  Test that the offset table begins at zero, never decreases and ends within the limit.
+	 */
+	private func isAscending(_ section: Section, count: Int, limit: Int) -> Bool {
+		var last: UInt32 = 0
+		guard u32(section, 0) == 0 else { return false }
+		for i in 0..<count {
+			let cur = u32(section, i)
+			guard cur >= last else { return false }
+			last = cur
+		}
+		return Int(last) <= limit
+	}
+	
+	/*
+	 *  Load a four-byte value from a column.
+	 */
+	@inline(__always) private func u32(_ section: Section, _ offset: Int) -> UInt32 {
+		return base.loadUnaligned(fromByteOffset: sections[section.rawValue] + offset * 4, as: UInt32.self)
+	}
+	
+	/*
+	 *  Load a signed four-byte value from a column.
+	 */
+	@inline(__always) private func i32(_ section: Section, _ offset: Int) -> Int32 {
+		return base.loadUnaligned(fromByteOffset: sections[section.rawValue] + offset * 4, as: Int32.self)
+	}
+	
+	/*
+	 *  Decode the string in a text column for a row.
+	 */
+	private func string(_ section: Section, _ offset: Int) -> String? {
+		return string(ordinal: u32(section, offset))
+	}
+	
+	/*
+	 *  Decode a string from the dictionary.
+	 */
+	private func string(ordinal: UInt32) -> String? {
+		guard Int(ordinal) < stringCount else { return nil }
+		let begin = Int(u32(.stringOffsets, Int(ordinal)))
+		let end	  = Int(u32(.stringOffsets, Int(ordinal) + 1))
+		return String(decoding: UnsafeRawBufferPointer(start: base + sections[Section.stringData.rawValue] + begin, count: end - begin), as: UTF8.self)
+	}
+}
@@ -39,8 +39,9 @@ public class MMExhibit : MMExhibitIdentifiable, Codable, Identifiable, Equatable
 			await withTaskGroup(of: Void.self) { group in
 				for img in eResources {
 					group.addTask { [weak self] () in
-						// ...route through the cache owner so that they get saved.
-						let _ = await self?.cacheOwner?.queryMetArtFile(atURL: img)
+						// ...route through the cache owner so that they get saved, but
+						//    after anything that is being displayed.
+						let _ = await self?.cacheOwner?.queryMetArtFile(atURL: img, lane: .prefetch)
 					}
 				}
 			}
@@ -87,7 +88,8 @@ public class MMExhibit : MMExhibitIdentifiable, Codable, Identifiable, Equatable
  *
  */
 protocol MMExhibitCacheOwnable : AnyObject {
-	func queryMetArtFile(atURL url: URL) async -> MMNetworkClient.MetArtFileResult
+	func queryMetArtFile(atURL url: URL, lane: MMRateLimiter.Lane) async -> MMNetworkClient.MetArtFileResult
+	func queryMetArtImage(atURL url: URL, lane: MMRateLimiter.Lane) async -> MMImageRef?
 }
 
 /*
@@ -160,7 +162,7 @@ extension MMExhibit {
 		// ...try to go through the cache if available.
 		let result: MMNetworkClient.MetArtFileResult
 		if let cOwner = cacheOwner {
-			result = await cOwner.queryMetArtFile(atURL: url)
+			result = await cOwner.queryMetArtFile(atURL: url, lane: .visible)
 		}
 		else {
 			result = await MMNetworkClient.shared.queryMetArtFile(atURL: url)
@@ -180,6 +182,10 @@ extension MMExhibit {
 	 *  Retrieve image data from a remote file.
 	 */
 	private func queryImageData(for url: URL?) async -> MMImageRef? {
+		// ...the cache owner keeps recently decoded images.
+		if let url = url, let cOwner = cacheOwner {
+			return await cOwner.queryMetArtImage(atURL: url, lane: .visible)
+		}
 		guard let fd = await queryFileData(for: url) else { return nil }
 		return await MMImageRef.fromData(fd, withFileData: true)
 	}
@@ -0,0 +1,467 @@
+//
+//  MMExhibitCache.swift
+//  MetModel
+// 
+//  Created on 3/22/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+import CryptoKit
+
+/*
+ *  DESIGN:  The index caches what it retrieves in two tiers.  Decoded images are kept in a
+ *			 memory tier limited by their approximate cost so that revisiting an exhibit never
+ *			 decodes them again.  Exhibit descriptions and file data are kept on disk in tiers
+ *			 limited by their total size, which discard the least recently used items once
+ *			 they are full.  Each disk item is named by a hash of where it came from and begins
+ *			 with a digest of its content, which is verified when it is read so that a damaged
+ *			 file is discarded and retrieved again instead of being displayed.
+ */
+
+/*
+ *  A bounded cache of exhibits and their files for an object index.
+ */
+final class MMExhibitCache {
+	static let DefaultMemoryLimit: Int	= 256 * 1024 * 1024
+	static let DefaultExhibitLimit: Int	= 64 * 1024 * 1024
+	static let DefaultFileLimit: Int	= 2 * 1024 * 1024 * 1024
+	
+	// - how well the cache is serving displayed content.
+	struct Statistics {
+		var memoryHits: Int	= 0				// - decoded images
+		var diskHits: Int	= 0				// - exhibits and files
+		var misses: Int		= 0
+		var evictions: Int	= 0
+		var discarded: Int	= 0				// - items that failed verification
+		
+		// ...the portion of lookups that didn't require the network.
+		var hitRate: Double {
+			let total = memoryHits + diskHits + misses
+			return total > 0 ? Double(memoryHits + diskHits) / Double(total) : 0
+		}
+	}
+	
+	/*
+	 *  Initialize the object.
+	 */
+	init(rootURL: URL, memoryLimit: Int = DefaultMemoryLimit, exhibitLimit: Int = DefaultExhibitLimit, fileLimit: Int = DefaultFileLimit) throws {
+		let eURL = rootURL.appending(path: "exhibits")
+		let fURL = rootURL.appending(path: "files")
+		try FileManager.default.createDirectory(at: eURL, withIntermediateDirectories: true)
+		try FileManager.default.createDirectory(at: fURL, withIntermediateDirectories: true)
+		self.images	  = .init(limit: memoryLimit)
+		self.exhibits = .init(url: eURL, limit: exhibitLimit)
+		self.files	  = .init(url: fURL, limit: fileLimit)
+	}
+	
+	// - the counts since the cache was created.
+	var statistics: Statistics {
+		cLock.lock()
+		defer { cLock.unlock() }
+		var ret		  = stats
+		ret.evictions = exhibits.evictions + files.evictions + images.evictions
+		ret.discarded = exhibits.discarded + files.discarded
+		return ret
+	}
+	
+	/*
+	 *  Return a decoded image.
+	 *  - only displayed content is counted in the statistics.
+	 */
+	func image(for url: URL, lane: MMRateLimiter.Lane = .visible) -> MMImageRef? {
+		let ret = images[url]
+		if ret != nil {
+			record(lane, { $0.memoryHits += 1 })
+		}
+		return ret
+	}
+	
+	/*
+	 *  Remember a decoded image.
+	 */
+	func saveImage(_ image: MMImageRef, for url: URL) {
+		images.insert(image, for: url, cost: image.approximateCost)
+	}
+	
+	/*
+	 *  Return the archived form of an exhibit.
+	 */
+	func exhibitData(for objectID: MMObjectIdentifier, lane: MMRateLimiter.Lane = .visible) -> Data? {
+		return lookup(in: exhibits, key: "exhibit-\(objectID)", lane: lane)
+	}
+	
+	/*
+	 *  Save the archived form of an exhibit.
+	 */
+	func saveExhibitData(_ data: Data, for objectID: MMObjectIdentifier) throws {
+		try exhibits.write(data, for: "exhibit-\(objectID)")
+	}
+	
+	/*
+	 *  Return the data of a remote file.
+	 */
+	func fileData(for url: URL, lane: MMRateLimiter.Lane = .visible) -> Data? {
+		return lookup(in: files, key: url.absoluteString, lane: lane)
+	}
+	
+	/*
+	 *  Save the data of a remote file.
+	 */
+	func saveFileData(_ data: Data, for url: URL) throws {
+		try files.write(data, for: url.absoluteString)
+	}
+	
+	// - internal
+	private let cLock: NSLock			= .init()
+	private var stats: Statistics		= .init()
+	private let images: MemoryTier<URL, MMImageRef>
+	private let exhibits: DiskTier
+	private let files: DiskTier
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMExhibitCache {
+	/*
+	 *  Read from a disk tier, recording the outcome.
+	 */
+	private func lookup(in tier: DiskTier, key: String, lane: MMRateLimiter.Lane) -> Data? {
+		let ret = tier.read(key)
+		record(lane) { stats in
+			if ret != nil {
+				stats.diskHits += 1
+			}
+			else {
+				stats.misses += 1
+			}
+		}
+		return ret
+	}
+	
+	/*
+	 *  Update the statistics for displayed content.
+	 */
+	private func record(_ lane: MMRateLimiter.Lane, _ update: (inout Statistics) -> Void) {
+		guard lane == .visible else { return }
+		cLock.lock()
+		update(&stats)
+		cLock.unlock()
+	}
+}
+
+/*
+ *  Types
+ */
+extension MMExhibitCache {
+	/*
+	 *  A least-recently-used collection of values limited by their total cost.
+	 *  - the order is kept in a list linked through slots so that every operation is constant time.
+	 */
+	fileprivate final class MemoryTier<Key : Hashable, Value> {
+		/*
+		 *  Initialize the object.
+		 */
+		init(limit: Int) {
+			self.limit = limit
+		}
+		
+		// - the number of values that were discarded to make room.
+		var evictions: Int {
+			mLock.lock()
+			defer { mLock.unlock() }
+			return _evictions
+		}
+		
+		/*
+		 *  Return a value, marking it as the most recently used.
+		 */
+		subscript(key: Key) -> Value? {
+			mLock.lock()
+			defer { mLock.unlock() }
+			guard let slot = slotsByKey[key] else { return nil }
+			unlink(slot)
+			linkAsNewest(slot)
+			return slots[slot].value
+		}
+		
+		/*
+		 *  Add or replace a value, discarding the least recently used to stay within the limit.
+		 *  - a value larger than the limit is never kept.
+		 */
+		func insert(_ value: Value, for key: Key, cost: Int) {
+			mLock.lock()
+			defer { mLock.unlock() }
+			if let slot = slotsByKey[key] {
+				remove(slot)
+			}
+			guard cost <= limit else { return }
+			while totalCost + cost > limit, oldest != Self.None {
+				remove(oldest)
+				_evictions += 1
+			}
+			
+			let node = Node(key: key, value: value, cost: cost)
+			let slot: Int
+			if let free = freeSlots.popLast() {
+				slot		= free
+				slots[slot] = node
+			}
+			else {
+				slot = slots.count
+				slots.append(node)
+			}
+			slotsByKey[key] = slot
+			totalCost	   += cost
+			linkAsNewest(slot)
+		}
+		
+		// - internal
+		private static var None: Int { -1 }
+		private struct Node {
+			let key: Key
+			var value: Value?
+			let cost: Int
+			var older: Int	= MemoryTier.None
+			var newer: Int	= MemoryTier.None
+		}
+		private let limit: Int
+		private let mLock: NSLock			= .init()
+		private var slots: [Node]			= []
+		private var freeSlots: [Int]		= []
+		private var slotsByKey: [Key : Int]	= [:]
+		private var oldest: Int				= MemoryTier.None
+		private var newest: Int				= MemoryTier.None
+		private var totalCost: Int			= 0
+		private var _evictions: Int			= 0
+		
+		/*
+		 *  Detach a slot from the recency order.
+		 */
+		private func unlink(_ slot: Int) {
+			let older = slots[slot].older
+			let newer = slots[slot].newer
+			if older != Self.None { slots[older].newer = newer } else { oldest = newer }
+			if newer != Self.None { slots[newer].older = older } else { newest = older }
+			slots[slot].older = Self.None
+			slots[slot].newer = Self.None
+		}
+		
+		/*
+		 *  Attach a slot as the most recently used.
+		 */
+		private func linkAsNewest(_ slot: Int) {
+			slots[slot].older = newest
+			if newest != Self.None { slots[newest].newer = slot } else { oldest = slot }
+			newest = slot
+		}
+		
+		/*
+		 *  Discard the value in a slot.
+		 */
+		private func remove(_ slot: Int) {
+			unlink(slot)
+			slotsByKey[slots[slot].key] = nil
+			totalCost		  -= slots[slot].cost
+			slots[slot].value = nil
+			freeSlots.append(slot)
+		}
+	}
+	
+	/*
+	 *  A directory of verified items limited by their total size.
+	 *  - the sizes and order of use are loaded when the tier is first accessed and
+	 *	  the time of use is saved as the modification date so that it survives restarts.
+	 */
+	fileprivate final class DiskTier {
+		/*
+		 *  Initialize the object.
+		 */
+		init(url: URL, limit: Int) {
+			self.url   = url
+			self.limit = limit
+		}
+		
+		// - the number of items that were discarded to make room.
+		var evictions: Int {
+			dLock.lock()
+			defer { dLock.unlock() }
+			return _evictions
+		}
+		
+		// - the number of items that failed verification.
+		var discarded: Int {
+			dLock.lock()
+			defer { dLock.unlock() }
+			return _discarded
+		}
+		
+		/*
+		 *  Read and verify an item.
+		 */
+		func read(_ key: String) -> Data? {
+			let name = Self.name(for: key)
+			let now	 = Date()
+			dLock.lock()
+			loadEntriesIfNecessary()
+			guard let lastUse = entries[name]?.lastUse else {
+				dLock.unlock()
+				return nil
+			}
+			entries[name]?.lastUse = now
+			dLock.unlock()
+			
+			// ...a file that was evicted after the check is just a miss.
+			let fURL = url.appending(path: name)
+			guard let stored = try? Data(contentsOf: fURL, options: .mappedIfSafe) else { return nil }
+			guard let ret = Self.verifiedPayload(of: stored) else {
+				MMLog.error("Discarding the damaged cache file \(name, privacy: .public).")
+				dLock.lock()
+				if let entry = entries.removeValue(forKey: name) {
+					totalSize -= entry.size
+				}
+				_discarded += 1
+				dLock.unlock()
+				try? FileManager.default.removeItem(at: fURL)
+				return nil
+			}
+			
+			// - the order of use only needs to be approximate on disk.
+			if now.timeIntervalSince(lastUse) > Self.UseResolution {
+				try? FileManager.default.setAttributes([.modificationDate: now], ofItemAtPath: fURL.path(percentEncoded: false))
+			}
+			return Data(ret)
+		}
+		
+		/*
+		 *  Save an item, discarding the least recently used to stay within the limit.
+		 */
+		func write(_ data: Data, for key: String) throws {
+			let name   = Self.name(for: key)
+			let stored = Self.stored(data)
+			try stored.write(to: url.appending(path: name), options: [.atomic])
+			
+			dLock.lock()
+			loadEntriesIfNecessary()
+			if let prior = entries[name] {
+				totalSize -= prior.size
+			}
+			entries[name] = .init(size: stored.count, lastUse: .init())
+			totalSize	 += stored.count
+			
+			// ...evict to below the limit so that this isn't repeated for every write.
+			var victims: [String] = []
+			if totalSize > limit {
+				let target = Int(Double(limit) * Self.LowWaterMark)
+				for (oneName, oneEntry) in entries.sorted(by: { $0.value.lastUse < $1.value.lastUse }) {
+					guard totalSize > target else { break }
+					guard oneName != name else { continue }
+					victims.append(oneName)
+					entries[oneName] = nil
+					totalSize		-= oneEntry.size
+				}
+				_evictions += victims.count
+			}
+			dLock.unlock()
+			
+			for oneName in victims {
+				try? FileManager.default.removeItem(at: url.appending(path: oneName))
+			}
+		}
+		
+		// - internal
+		private struct Entry {
+			let size: Int
+			var lastUse: Date
+		}
+		private static let Magic: UInt32				= 0x31434D4D			// - 'MMC1'
+		private static let HeaderLength: Int			= 4 + 8 + SHA256.byteCount
+		private static let Extension: String			= "mmc"
+		private static let LowWaterMark: Double			= 0.9
+		private static let UseResolution: TimeInterval	= 60
+		private let url: URL
+		private let limit: Int
+		private let dLock: NSLock						= .init()
+		private var entries: [String : Entry]			= [:]
+		private var isLoaded: Bool						= false
+		private var totalSize: Int						= 0
+		private var _evictions: Int						= 0
+		private var _discarded: Int						= 0
+		
+		/*
+		 *  Load the sizes and time of use of the items on disk.
+		 *  - the lock must be held.
+		 */
+		private func loadEntriesIfNecessary() {
+			guard !isLoaded else { return }
+			isLoaded = true
+			
+			let keys: [URLResourceKey] = [.fileSizeKey, .contentModificationDateKey]
+			guard let contents = try? FileManager.default.contentsOfDirectory(at: url, includingPropertiesForKeys: keys) else { return }
+			var legacy = 0
+			for oneURL in contents {
+				// ...files from before they were verified can't be trusted.
+				guard oneURL.pathExtension == Self.Extension else {
+					try? FileManager.default.removeItem(at: oneURL)
+					legacy += 1
+					continue
+				}
+				let values = try? oneURL.resourceValues(forKeys: Set(keys))
+				let size   = values?.fileSize ?? 0
+				entries[oneURL.lastPathComponent] = .init(size: size, lastUse: values?.contentModificationDate ?? .distantPast)
+				totalSize += size
+			}
+			if legacy > 0 {
+				MMLog.info("Removed \(legacy, privacy: .public) unverified files from the cache at \(self.url.lastPathComponent, privacy: .public).")
+			}
+		}
+		
+		/*
+		 *  The name of the file for an item.
+		 */
+		private static func name(for key: String) -> String {
+			let digest = SHA256.hash(data: Data(key.utf8))
+			return digest.map({ String(format: "%02x", $0) }).joined() + ".\(Extension)"
+		}
+		
+		/*
+		 *  The stored form of an item with its verification header.
+		 */
+		private static func stored(_ payload: Data) -> Data {
+			var ret = Data(capacity: HeaderLength + payload.count)
+			withUnsafeBytes(of: Magic.littleEndian) { ret.append(contentsOf: $0) }
+			withUnsafeBytes(of: UInt64(payload.count).littleEndian) { ret.append(contentsOf: $0) }
+			ret.append(contentsOf: SHA256.hash(data: payload))
+			ret.append(payload)
+			return ret
+		}
+		
+		/*
+		 *  Return the payload of a stored item if it is intact.
+		 */
+		private static func verifiedPayload(of stored: Data) -> Data? {
+			guard stored.count >= HeaderLength else { return nil }
+			let (magic, length) = stored.withUnsafeBytes { ptr in
+				(UInt32(littleEndian: ptr.loadUnaligned(fromByteOffset: 0, as: UInt32.self)),
+				 UInt64(littleEndian: ptr.loadUnaligned(fromByteOffset: 4, as: UInt64.self)))
+			}
+			guard magic == Magic, length == UInt64(stored.count - HeaderLength) else { return nil }
+			let base	= stored.startIndex
+			let payload = stored[(base + HeaderLength)...]
+			guard SHA256.hash(data: payload).elementsEqual(stored[(base + 12)..<(base + HeaderLength)]) else { return nil }
+			return payload
+		}
+	}
+}
+
+/*
+ *  Utilities.
+ */
+fileprivate extension MMImageRef {
+	// - the memory used by the decoded image and its file data.
+	var approximateCost: Int {
+		let pixels = Int(size.width * size.height)
+		return pixels * 4 + (data?.count ?? 0)
+	}
+}
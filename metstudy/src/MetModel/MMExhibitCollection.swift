@@ -81,6 +81,13 @@ extension MMExhibitCollection : RandomAccessCollection {
 		let offset = context._offsets?[index] ?? index
 		return objectIndex.objectList[offset]
 	}
+	
+	///  Warm the cache with the exhibits that are likely to be displayed after the one at
+	///  the index, which replaces any prior request for this index.
+	public func prefetchExhibits(around index: Int) {
+		guard index >= startIndex && index < endIndex else { return }
+		objectIndex.prefetcher.prefetch(around: index, in: self, from: objectIndex)
+	}
 }
 
 /*
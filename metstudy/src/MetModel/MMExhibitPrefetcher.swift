@@ -0,0 +1,116 @@
+//
+//  MMExhibitPrefetcher.swift
+//  MetModel
+// 
+//  Created on 3/22/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+
+/*
+ *  DESIGN:  Exhibits are browsed in the order of a collection, one row at a time, so the
+ *			 ones most likely to be displayed next are the ones just past the current row in
+ *			 the direction of travel.  The prefetcher warms a small window of those through
+ *			 the low-priority lane whenever the position changes.  Exhibits that remain in the
+ *			 window keep loading, while those that left it are abandoned since a user that
+ *			 moved on is unlikely to return to them soon.
+ */
+
+/*
+ *  Warms the cache with the exhibits near the one being displayed.
+ */
+final class MMExhibitPrefetcher {
+	static let Ahead: Int	= 8
+	static let Behind: Int	= 2
+	
+	/*
+	 *  Warm the exhibits around a position in a collection, replacing the prior window.
+	 */
+	func prefetch(around position: Int, in collection: MMExhibitCollection, from objectIndex: MMObjectIndex) {
+		pLock.lock()
+		defer { pLock.unlock() }
+		
+		// - the direction is only meaningful within the same list.
+		if lastCollection === collection, let lastPosition = lastPosition, position != lastPosition {
+			isForward = position > lastPosition
+		}
+		else if lastCollection !== collection {
+			isForward = true
+		}
+		lastCollection = collection
+		lastPosition   = position
+		
+		// - only what is still nearby is worth the requests.
+		let refs = Self.window(around: position, count: collection.count, isForward: isForward).map({ collection[$0] })
+		let ids  = Set(refs.map({ $0.objectID }))
+		for (oneId, oneTask) in inFlight where !ids.contains(oneId) {
+			oneTask.task.cancel()
+			inFlight[oneId] = nil
+		}
+		for oneRef in refs where inFlight[oneRef.objectID] == nil {
+			let pGen	= generation
+			generation	+= 1
+			let task	= Task(priority: .utility) { [weak self, weak objectIndex] in
+				await objectIndex?.prefetchExhibit(oneRef)
+				self?.completed(oneRef.objectID, generation: pGen)
+			}
+			inFlight[oneRef.objectID] = .init(generation: pGen, task: task)
+		}
+	}
+	
+	/*
+	 *  Stop warming the cache.
+	 */
+	func cancel() {
+		pLock.lock()
+		defer { pLock.unlock() }
+		inFlight.values.forEach({ $0.task.cancel() })
+		inFlight = [:]
+	}
+	
+	/*
+	 *  Return the positions to warm, nearest first and those ahead before those behind.
+	 */
+	static func window(around position: Int, count: Int, isForward: Bool) -> [Int] {
+		let step		= isForward ? 1 : -1
+		var ret: [Int]	= []
+		for d in 1...Ahead {
+			ret.append(position + d * step)
+		}
+		for d in 1...Behind {
+			ret.append(position - d * step)
+		}
+		return ret.filter({ $0 >= 0 && $0 < count })
+	}
+	
+	// - internal
+	private let pLock: NSLock						= .init()
+	private weak var lastCollection: MMExhibitCollection?
+	private var lastPosition: Int?
+	private var isForward: Bool						= true
+	private var inFlight: [MMObjectIdentifier : Request] = [:]
+	private var generation: UInt64					= 0
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMExhibitPrefetcher {
+	// - an exhibit that is being warmed.
+	private struct Request {
+		let generation: UInt64
+		let task: Task<Void, Never>
+	}
+	
+	/*
+	 *  An exhibit is no longer being warmed.
+	 */
+	private func completed(_ objectID: MMObjectIdentifier, generation pGen: UInt64) {
+		pLock.lock()
+		defer { pLock.unlock() }
+		if inFlight[objectID]?.generation == pGen {
+			inFlight[objectID] = nil
+		}
+	}
+}
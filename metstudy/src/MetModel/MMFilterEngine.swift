@@ -0,0 +1,223 @@
+//
+//  MMFilterEngine.swift
+//  MetModel
+// 
+//  Created on 3/21/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+
+/*
+ *  DESIGN:  Filtering is requested for every keystroke, so most criteria are either one
+ *			 that was just evaluated (backspace) or one that narrows it (one more character).
+ *			 The engine remembers a few recent results and when the new criteria can only
+ *			 match a subset of one of them, checks just those offsets in parallel instead of
+ *			 consulting the search index for the whole list.  Only one evaluation is useful
+ *			 at a time, so starting one cancels any that is still in progress, and partial
+ *			 results are never remembered.
+ */
+
+/*
+ *  Evaluates filter criteria for an object index.
+ */
+final class MMFilterEngine {
+	// - how a result was produced, for verification.
+	enum Evaluation {
+		case cached
+		case refined(candidates: Int)
+		case indexed
+	}
+	
+	/*
+	 *  Return the ascending offsets of the references in the index that match the criteria.
+	 */
+	func offsets(matching criteria: MMFilterCriteria, in objectIndex: MMObjectIndex) async throws -> [Int] {
+		let query = Query(criteria)
+		
+		eLock.lock()
+		if let cached = recent.firstIndex(where: { $0.query == query }) {
+			// ...the most recent result is always last.
+			let entry = recent.remove(at: cached)
+			recent.append(entry)
+			_lastEvaluation = .cached
+			eLock.unlock()
+			return entry.offsets
+		}
+		
+		// - the smallest remembered result that includes every possible match is
+		//   the best place to start.
+		let rowCount = objectIndex.objectList.count
+		let base	 = recent.filter({ query.refines($0.query) }).min(by: { $0.offsets.count < $1.offsets.count })
+		let refine	 = base.map({ $0.offsets.count <= Swift.max(Self.MinRefinementLimit, rowCount / Self.RefinementFraction) }) ?? false
+		
+		// - anything in progress is now stale.
+		inFlight?.cancel()
+		generation	 += 1
+		let eGen	  = generation
+		let task	  = Task(priority: .userInitiated) { () async throws -> [Int] in
+			let ret: [Int]
+			if let base = base, refine {
+				ret = await Self.refined(base.offsets, matching: criteria, in: objectIndex.objectList)
+			}
+			else {
+				ret = await objectIndex.searchIndex().offsets(matching: criteria)
+			}
+			guard !Task.isCancelled else { throw MMError.cancelled }
+			return ret
+		}
+		inFlight		= task
+		_lastEvaluation = refine ? .refined(candidates: base?.offsets.count ?? 0) : .indexed
+		eLock.unlock()
+		
+		let ret = try await withTaskCancellationHandler {
+			try await task.value
+		} onCancel: {
+			task.cancel()
+		}
+		
+		// - a result is only remembered once it is known to be complete.
+		eLock.lock()
+		defer { eLock.unlock() }
+		if generation == eGen {
+			inFlight = nil
+		}
+		remember(query, offsets: ret)
+		return ret
+	}
+	
+	/*
+	 *  Discard every remembered result because the index has changed.
+	 */
+	func reset() {
+		eLock.lock()
+		defer { eLock.unlock() }
+		inFlight?.cancel()
+		inFlight = nil
+		recent	 = []
+	}
+	
+	// - how the most recent request was evaluated.
+	var lastEvaluation: Evaluation? {
+		eLock.lock()
+		defer { eLock.unlock() }
+		return _lastEvaluation
+	}
+	
+	// - internal
+	private static let MaxRecent: Int			= 16
+	private static let MaxRecentOffsets: Int	= 1_000_000
+	private static let MinRefinementLimit: Int	= 4_096
+	private static let RefinementFraction: Int	= 32
+	private static let RefinementChunk: Int		= 1_024
+	private let eLock: NSLock					= .init()
+	private var recent: [Entry]					= []
+	private var inFlight: Task<[Int], Error>?
+	private var generation: UInt64				= 0
+	private var _lastEvaluation: Evaluation?
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMFilterEngine {
+	// - criteria in the form used for comparison.
+	private struct Query : Equatable {
+		let words: [String]
+		let matchingRule: MMFilterCriteria.MatchingRule
+		let creationYear: Int?
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(_ criteria: MMFilterCriteria) {
+			var words: [String] = []
+			for oneWord in (criteria.searchText ?? "").trimmingCharacters(in: .whitespacesAndNewlines).split(separator: " ") {
+				let word = String(oneWord)
+				guard !words.contains(word) else { continue }
+				words.append(word)
+			}
+			self.words		  = words.sorted()
+			self.matchingRule = words.isEmpty ? .andMatch : criteria.matchingRule
+			self.creationYear = criteria.creationYear
+		}
+		
+		/*
+		 *  Determine if every reference that matches this query must also match the other.
+		 *  - a word that contains another can only match where the other also does.
+		 */
+		func refines(_ other: Query) -> Bool {
+			if let oYear = other.creationYear, oYear != creationYear {
+				return false
+			}
+			guard !other.words.isEmpty else { return true }
+			guard !words.isEmpty else { return false }
+			
+			let implies = { (word: String, oWord: String) in word.localizedCaseInsensitiveContains(oWord) }
+			switch (matchingRule, other.matchingRule) {
+			case (.andMatch, .andMatch):
+				// ...every other word is in one of these.
+				return other.words.allSatisfy({ oWord in words.contains(where: { implies($0, oWord) }) })
+			
+			case (.andMatch, .orMatch):
+				// ...one of these words includes one of the others.
+				return words.contains(where: { word in other.words.contains(where: { implies(word, $0) }) })
+			
+			case (.orMatch, .andMatch):
+				// ...each of these words includes all of the others.
+				return words.allSatisfy({ word in other.words.allSatisfy({ implies(word, $0) }) })
+			
+			case (.orMatch, .orMatch):
+				// ...each of these words includes one of the others.
+				return words.allSatisfy({ word in other.words.contains(where: { implies(word, $0) }) })
+			}
+		}
+	}
+	
+	// - a remembered result.
+	private struct Entry {
+		let query: Query
+		let offsets: [Int]
+	}
+	
+	/*
+	 *  Remember a result, discarding the least recently used to stay within limits.
+	 *  - the lock must be held.
+	 */
+	private func remember(_ query: Query, offsets: [Int]) {
+		recent.removeAll(where: { $0.query == query })
+		recent.append(.init(query: query, offsets: offsets))
+		var total = recent.reduce(0, { $0 + $1.offsets.count })
+		while recent.count > Self.MaxRecent || (total > Self.MaxRecentOffsets && recent.count > 1) {
+			total -= recent.removeFirst().offsets.count
+		}
+	}
+	
+	/*
+	 *  Check only the provided offsets against the criteria in parallel.
+	 *  - the result is incomplete when the task is cancelled.
+	 */
+	private static func refined(_ candidates: [Int], matching criteria: MMFilterCriteria, in objectList: MMObjectIndex.ObjectList) async -> [Int] {
+		let numChunks = (candidates.count + RefinementChunk - 1) / RefinementChunk
+		return await withTaskGroup(of: (chunk: Int, offsets: [Int]).self) { group in
+			for c in 0..<numChunks {
+				group.addTask {
+					var ret: [Int] = []
+					for offset in candidates[(c * RefinementChunk)..<Swift.min((c + 1) * RefinementChunk, candidates.count)] {
+						if Task.isCancelled { break }
+						guard MMExhibitCollection.includeInCollection(exhibit: objectList.transientRef(at: offset), criteria: criteria) else { continue }
+						ret.append(offset)
+					}
+					return (c, ret)
+				}
+			}
+			
+			// ...reassemble in the original order.
+			var chunks = [[Int]](repeating: [], count: numChunks)
+			for await result in group {
+				chunks[result.chunk] = result.offsets
+			}
+			return chunks.flatMap({ $0 })
+		}
+	}
+}
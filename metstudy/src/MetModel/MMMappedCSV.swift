@@ -0,0 +1,468 @@
+//
+//  MMMappedCSV.swift
+//  MetModel
+// 
+//  Created on 3/12/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+
+/*
+ *  DESIGN:  The Met Open Access file is several hundred megabytes with ~480k records, so
+ *			 it is mapped instead of read and its records are parsed in parallel.  The
+ *			 difficulty with CSV is that a newline only ends a record when it is outside
+ *			 a quoted string, which can't be known from the middle of the file.  This
+ *			 uses two passes over equally-sized chunks:
+ *				(1) every chunk counts its quotes and finds its first record-ending newline
+ *				    and number of records for _both_ possible starting states, since that
+ *				    doesn't depend on anything before it.
+ *				(2) a quick serial walk carries the quote state from the top of the file to
+ *				    choose the right answer for each chunk, after which every chunk starts
+ *				    on a true record boundary and can be parsed independently.
+ *			 Both passes classify 64 bytes at a time into bitmasks so that the per-byte
+ *			 work is limited to the delimiters themselves.
+ *
+ *  - NOTE:  Quotes toggle escaping and are discarded, which is how the original line-based
+ *			 parser treated them.  Doubled quotes are not collapsed into one.
+ */
+
+/*
+ *  A read-only, memory-mapped CSV file.
+ */
+final class MMMappedCSV {
+	/*
+	 *  Map the file at the provided location.
+	 */
+	init(with url: URL) throws {
+		let fd = open(url.path(percentEncoded: false), O_RDONLY)
+		guard fd >= 0 else {
+			throw MMError.invalidFile
+		}
+		defer { close(fd) }
+		
+		var st = stat()
+		guard fstat(fd, &st) == 0 else {
+			throw MMError.fileError(errno: errno)
+		}
+		guard st.st_size > 0 else {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index has no content."))
+		}
+		
+		let len = Int(st.st_size)
+		guard let mem = mmap(nil, len, PROT_READ, MAP_PRIVATE, fd, 0), mem != UnsafeMutableRawPointer(bitPattern: -1) else {
+			throw MMError.fileError(errno: errno)
+		}
+		madvise(mem, len, MADV_SEQUENTIAL)
+		self.base	   = UnsafeRawPointer(mem)
+		self.byteCount = len
+	}
+	
+	/*
+	 *  Destructor
+	 */
+	deinit {
+		munmap(UnsafeMutableRawPointer(mutating: base), byteCount)
+	}
+	
+	/*
+	 *  Read the columns of the first record.
+	 */
+	func readHeader() throws -> [String] {
+		var ret: [String]	 = []
+		var bErr: Error?	 = nil
+		self.bodyStart		 = byteCount
+		forEachField(in: 0..<byteCount) { field, hasQuote, endsRecord in
+			guard let text = decodeField(field, hasQuote: hasQuote) else {
+				bErr = MMError.badFormat(msg: .mmLocalized(localized: "The source data is not valid UTF-8."))
+				return false
+			}
+			
+			// ...a trailing delimiter doesn't define another column.
+			if !(endsRecord && text.isEmpty && !ret.isEmpty) {
+				ret.append(text)
+			}
+			if endsRecord {
+				self.bodyStart = Swift.min(field.upperBound + 1, byteCount)
+			}
+			return !endsRecord
+		}
+		if let bErr = bErr {
+			throw bErr
+		}
+		return ret
+	}
+	
+	/*
+	 *  Divide the records after the header into chunks that can be parsed
+	 *  independently, returning the total number of records.
+	 */
+	func countRecords() -> Int {
+		let body = bodyStart..<byteCount
+		guard !body.isEmpty else {
+			self.chunks = []
+			return 0
+		}
+		
+		// - 1. scan every chunk without knowing how it begins.
+		let numChunks = Swift.max(1, (body.count + Self.ChunkSize - 1) / Self.ChunkSize)
+		var scans	  = [ChunkScan](repeating: .init(), count: numChunks)
+		scans.withUnsafeMutableBufferPointer { sBuf in
+			DispatchQueue.concurrentPerform(iterations: numChunks) { i in
+				let lower = body.lowerBound + i * Self.ChunkSize
+				sBuf[i]	  = scanChunk(lower..<Swift.min(lower + Self.ChunkSize, body.upperBound))
+			}
+		}
+		
+		// - 2. carry the quote state forward to find where records begin.
+		var starts: [Int] = []
+		var total: Int	  = 0
+		var inQuote		  = false
+		for i in 0..<numChunks {
+			let scan = scans[i]
+			if i == 0 {
+				starts.append(body.lowerBound)
+			}
+			else if let brk = inQuote ? scan.firstBreakInside : scan.firstBreakOutside {
+				starts.append(brk + 1)
+			}
+			// ...otherwise the chunk is entirely in the middle of a record and
+			//    belongs to the one before it.
+			total  += inQuote ? scan.breaksInside : scan.breaksOutside
+			inQuote = inQuote != scan.quoteParity
+		}
+		
+		// ...a final record need not end with a newline.
+		let lastByte = base.load(fromByteOffset: byteCount - 1, as: UInt8.self)
+		if lastByte != Self.Newline {
+			total += 1
+		}
+		
+		var ret: [Range<Int>] = []
+		for i in 0..<starts.count {
+			ret.append(starts[i]..<(i + 1 < starts.count ? starts[i + 1] : body.upperBound))
+		}
+		self.chunks = ret
+		return total
+	}
+	
+	/*
+	 *  Parse all the records after the header in parallel, converting each into a result.
+	 *  - the `columnSlots` maps each column in a record to its offset in the `fields` passed
+	 *	  to the transform or `nil` to ignore the column entirely.
+	 *  - the progress is always reported serially with the number of records completed.
+	 */
+	func parseRecords<T>(columnSlots: [Int?], numSlots: Int, progress: (_ completed: Int) -> Void,
+						 transform: (_ fields: [String]) -> T?) throws -> (records: [T], skipped: Int) {
+		let chunks = self.chunks ?? []
+		if chunks.isEmpty && bodyStart < byteCount {
+			assert(false, "The records must be counted before they are parsed.")
+			throw MMError.failedAssertion
+		}
+		
+		let pLock 			= NSLock()
+		var completed: Int	= 0
+		var results			= [ChunkResult<T>?](repeating: nil, count: chunks.count)
+		results.withUnsafeMutableBufferPointer { rBuf in
+			DispatchQueue.concurrentPerform(iterations: chunks.count) { i in
+				let cr = parseChunk(chunks[i], columnSlots: columnSlots, numSlots: numSlots, transform: transform)
+				rBuf[i] = cr
+				
+				pLock.lock()
+				completed += cr.numRecords
+				progress(completed)
+				pLock.unlock()
+			}
+		}
+		
+		// - merge in file order.
+		var ret: [T]	 = []
+		var skipped: Int = 0
+		ret.reserveCapacity(results.reduce(0, { $0 + ($1?.records.count ?? 0) }))
+		for oneResult in results {
+			guard let oneResult = oneResult else { continue }
+			if let err = oneResult.error {
+				throw err
+			}
+			ret.append(contentsOf: oneResult.records)
+			skipped += oneResult.skipped
+		}
+		return (ret, skipped)
+	}
+	
+	// - internal
+	private static var ChunkSize: Int { 1024 * 1024 }
+	private static var Quote: UInt8 { 0x22 }
+	private static var Comma: UInt8 { 0x2C }
+	private static var Newline: UInt8 { 0x0A }
+	
+	private let base: UnsafeRawPointer
+	private let byteCount: Int
+	private var bodyStart: Int = 0
+	private var chunks: [Range<Int>]?
+	
+	// - the outcome of the first pass over a chunk, answered for both of the ways it may begin.
+	private struct ChunkScan {
+		var quoteParity: Bool		= false
+		var firstBreakOutside: Int?	= nil
+		var firstBreakInside: Int?	= nil
+		var breaksOutside: Int		= 0
+		var breaksInside: Int		= 0
+	}
+	
+	// - the outcome of parsing a chunk.
+	private struct ChunkResult<T> {
+		var records: [T]	= []
+		var numRecords: Int	= 0
+		var skipped: Int	= 0
+		var error: Error?	= nil
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMMappedCSV {
+	// - the bit for each lane within its group of eight.
+	private static let laneBits: SIMD64<UInt8> = {
+		var ret = SIMD64<UInt8>.zero
+		for i in 0..<64 {
+			ret[i] = 1 << UInt8(i % 8)
+		}
+		return ret
+	}()
+	
+	// - the position of each group of eight within a 64-bit mask.
+	private static let groupShifts: SIMD8<UInt64> = .init(0, 8, 16, 24, 32, 40, 48, 56)
+	
+	/*
+	 *  Load 64 bytes starting at the offset, padding with zeroes past the end of the file.
+	 */
+	@inline(__always) private func block(at offset: Int) -> SIMD64<UInt8> {
+		guard offset + 64 > byteCount else {
+			return base.loadUnaligned(fromByteOffset: offset, as: SIMD64<UInt8>.self)
+		}
+		var ret = SIMD64<UInt8>.zero
+		withUnsafeMutableBytes(of: &ret) { rBuf in
+			rBuf.copyMemory(from: UnsafeRawBufferPointer(start: base + offset, count: byteCount - offset))
+		}
+		return ret
+	}
+	
+	/*
+	 *  Return a bitmask of the bytes in the block that match the value.
+	 */
+	@inline(__always) private static func mask(_ v: SIMD64<UInt8>, matching value: UInt8) -> UInt64 {
+		// - each lane in a group of eight owns a distinct bit, so multiplying sums the
+		//   group into its top byte without carries.
+		let lanes  = SIMD64<UInt8>.zero.replacing(with: laneBits, where: v .== value)
+		let groups = (unsafeBitCast(lanes, to: SIMD8<UInt64>.self) &* 0x0101_0101_0101_0101) &>> 56
+		return (groups &<< groupShifts).wrappedSum()
+	}
+	
+	/*
+	 *  Return a mask with every bit set from an opening quote up to (but not including)
+	 *  its closing quote.
+	 */
+	@inline(__always) private static func prefixXor(_ bits: UInt64) -> UInt64 {
+		var ret = bits
+		ret ^= ret << 1
+		ret ^= ret << 2
+		ret ^= ret << 4
+		ret ^= ret << 8
+		ret ^= ret << 16
+		ret ^= ret << 32
+		return ret
+	}
+	
+	/*
+	 *  Return a mask of the bytes in the block at the offset that are within the range.
+	 */
+	@inline(__always) private static func validMask(at offset: Int, upperBound: Int) -> UInt64 {
+		let len = upperBound - offset
+		return len >= 64 ? ~0 : (UInt64(1) << UInt64(len)) - 1
+	}
+	
+	/*
+	 *  First pass over a chunk.
+	 */
+	private func scanChunk(_ range: Range<Int>) -> ChunkScan {
+		var ret				= ChunkScan()
+		var carry: UInt64	= 0			// - all ones when inside quotes, assuming the chunk begins outside them
+		var offset			= range.lowerBound
+		while offset < range.upperBound {
+			let v		= block(at: offset)
+			let valid	= Self.validMask(at: offset, upperBound: range.upperBound)
+			let quotes	= Self.mask(v, matching: Self.Quote) & valid
+			let breaks	= Self.mask(v, matching: Self.Newline) & valid
+			let inside	= Self.prefixXor(quotes) ^ carry
+			carry		= UInt64(bitPattern: Int64(bitPattern: inside) >> 63)
+			
+			// ...if the chunk actually begins inside quotes, these are reversed.
+			let bOutside = breaks & ~inside
+			let bInside  = breaks & inside
+			if ret.firstBreakOutside == nil && bOutside != 0 {
+				ret.firstBreakOutside = offset + bOutside.trailingZeroBitCount
+			}
+			if ret.firstBreakInside == nil && bInside != 0 {
+				ret.firstBreakInside = offset + bInside.trailingZeroBitCount
+			}
+			ret.breaksOutside += bOutside.nonzeroBitCount
+			ret.breaksInside  += bInside.nonzeroBitCount
+			offset += 64
+		}
+		ret.quoteParity = carry != 0
+		return ret
+	}
+	
+	/*
+	 *  Iterate over the fields in the range, which must begin on a record boundary.  The
+	 *  body returns `false` to stop iterating.
+	 */
+	@inline(__always) private func forEachField(in range: Range<Int>, _ body: (_ field: Range<Int>, _ hasQuote: Bool, _ endsRecord: Bool) -> Bool) {
+		var carry: UInt64 = 0
+		var fStart		  = range.lowerBound
+		var hasQuote	  = false
+		var offset		  = range.lowerBound
+		while offset < range.upperBound {
+			let v		= block(at: offset)
+			let valid	= Self.validMask(at: offset, upperBound: range.upperBound)
+			let quotes	= Self.mask(v, matching: Self.Quote) & valid
+			let breaks	= Self.mask(v, matching: Self.Newline) & valid
+			let commas	= Self.mask(v, matching: Self.Comma) & valid
+			let inside	= Self.prefixXor(quotes) ^ carry
+			carry		= UInt64(bitPattern: Int64(bitPattern: inside) >> 63)
+			
+			// - only quotes and unescaped delimiters need attention.
+			var bits = ((breaks | commas) & ~inside) | quotes
+			while bits != 0 {
+				let bit = UInt64(bits.trailingZeroBitCount)
+				let pos = offset + Int(bit)
+				bits   &= bits - 1
+				if quotes & (1 << bit) != 0 {
+					hasQuote = true
+					continue
+				}
+				
+				let endsRecord = breaks & (1 << bit) != 0
+				guard body(fStart..<pos, hasQuote, endsRecord) else { return }
+				fStart	 = pos + 1
+				hasQuote = false
+			}
+			offset += 64
+		}
+		
+		// - a final record without a trailing newline.
+		if fStart < range.upperBound {
+			_ = body(fStart..<range.upperBound, hasQuote, true)
+		}
+	}
+	
+	/*
+	 *  Second pass over a chunk.
+	 */
+	private func parseChunk<T>(_ range: Range<Int>, columnSlots: [Int?], numSlots: Int, transform: (_ fields: [String]) -> T?) -> ChunkResult<T> {
+		var ret			  = ChunkResult<T>()
+		var fields		  = [String](repeating: "", count: numSlots)
+		var column		  = 0
+		var recordStart	  = range.lowerBound
+		forEachField(in: range) { field, hasQuote, endsRecord in
+			if column < columnSlots.count, let slot = columnSlots[column] {
+				guard let text = decodeField(field, hasQuote: hasQuote) else {
+					ret.error = MMError.badFormat(msg: .mmLocalized(localized: "The source data is not valid UTF-8."))
+					return false
+				}
+				fields[slot] = text
+			}
+			column += 1
+			guard endsRecord else { return true }
+			
+			// - a blank line isn't a record.
+			if column > 1 || !isBlank(recordStart..<field.upperBound) {
+				ret.numRecords += 1
+				if let oneRecord = transform(fields) {
+					ret.records.append(oneRecord)
+				}
+				else {
+					ret.skipped += 1
+				}
+			}
+			
+			for i in 0..<numSlots {
+				fields[i] = ""
+			}
+			column		= 0
+			recordStart	= field.upperBound + 1
+			return true
+		}
+		return ret
+	}
+	
+	/*
+	 *  Test if a byte is ASCII whitespace, including newlines.
+	 */
+	@inline(__always) private static func isSpace(_ c: UInt8) -> Bool {
+		return c == 0x20 || c == 0x09 || c == 0x0A || c == 0x0D
+	}
+	
+	/*
+	 *  Test if a range contains only whitespace.
+	 */
+	private func isBlank(_ range: Range<Int>) -> Bool {
+		for i in range {
+			guard Self.isSpace(base.load(fromByteOffset: i, as: UInt8.self)) else { return false }
+		}
+		return true
+	}
+	
+	/*
+	 *  Convert the bytes of one field into trimmed text, returning `nil` if it isn't valid UTF-8.
+	 */
+	private func decodeField(_ range: Range<Int>, hasQuote: Bool) -> String? {
+		guard hasQuote else {
+			return decodeText(UnsafeRawBufferPointer(start: base + range.lowerBound, count: range.count))
+		}
+		
+		// - quotes are dropped along with any unescaped line breaks.
+		var buf: [UInt8]  = []
+		var isEscaped	  = false
+		buf.reserveCapacity(range.count)
+		for i in range {
+			let c = base.load(fromByteOffset: i, as: UInt8.self)
+			if c == Self.Quote {
+				isEscaped.toggle()
+			}
+			else if isEscaped || (c != Self.Newline && c != 0x0D) {
+				buf.append(c)
+			}
+		}
+		return buf.withUnsafeBytes { decodeText($0) }
+	}
+	
+	/*
+	 *  Trim and decode the text.
+	 */
+	@inline(__always) private func decodeText(_ bytes: UnsafeRawBufferPointer) -> String? {
+		var lower = 0
+		var upper = bytes.count
+		while lower < upper && Self.isSpace(bytes[lower]) {
+			lower += 1
+		}
+		while upper > lower && Self.isSpace(bytes[upper - 1]) {
+			upper -= 1
+		}
+		guard lower < upper else { return "" }
+		
+		// - invalid sequences are replaced during decoding, so a faithful round trip
+		//   is the proof that the text was valid.
+		let slice = UnsafeRawBufferPointer(rebasing: bytes[lower..<upper])
+		let ret   = String(decoding: slice, as: UTF8.self)
+		guard ret.utf8.elementsEqual(slice) else { return nil }
+		
+		// ...non-ASCII whitespace is uncommon, but still shouldn't be retained.
+		if slice[0] >= 0x80 || slice[slice.count - 1] >= 0x80 {
+			return ret.trimmingCharacters(in: .whitespacesAndNewlines)
+		}
+		return ret
+	}
+}
@@ -13,6 +13,11 @@ import Foundation
  *  Met Art back-end systems.
  *
  *  The MetArt RESTful API: https://metmuseum.github.io
+ *
+ *  DESIGN:  Several views often ask for the same object or image at once, so identical
+ *			 requests that are in progress are shared instead of being repeated.  A shared
+ *			 request is only cancelled when every one of its callers has been cancelled, and
+ *			 it waits in the most urgent lane of any of its callers.
  */
 actor MMNetworkClient {
 	// - a common shared instance for most use cases.
@@ -22,6 +27,24 @@ actor MMNetworkClient {
 	//   process don't exceed the limits and it is set to be only half of the MetArt
 	//   published limit for clients to be sure usage doesn't raise any concerns.
 	private static let rateLimit: MMRateLimiter = .init(requestsPerSecond: MMRateLimiter.MetArtLimit / 2)
+	static let MetArtAPIURL: URL				= URL(string: "https://collectionapi.metmuseum.org/public/collection/v1")!
+	
+	/*
+	 *  Initialize the object.
+	 *  - the session, API location and limiter are configurable for testing.
+	 */
+	init(session: URLSession = .shared, apiURL: URL = MMNetworkClient.MetArtAPIURL, rateLimiter: MMRateLimiter? = nil) {
+		self.session	 = session
+		self.apiURL		 = apiURL
+		self.rateLimiter = rateLimiter ?? Self.rateLimit
+	}
+	
+	// - internal
+	private let session: URLSession
+	private let apiURL: URL
+	private let rateLimiter: MMRateLimiter
+	private var inFlight: [RequestKey : AnyObject] = [:]
+	private var nextRequestId: UInt64			   = 0
 }
 
 /*
@@ -31,22 +54,20 @@ extension MMNetworkClient {
 	/*
 	 *  Standardized rate limiting.
 	 */
-	private func rateLimitedRequest<T>(_ block: () async -> T) async -> T {
-		await Self.rateLimit.waitForAccess()
+	private func rateLimitedRequest<T>(ticket: MMRateLimiter.Ticket, _ block: () async -> T) async -> T {
+		await rateLimiter.waitForAccess(ticket: ticket)
 		return await block()
 	}
 	
 	/*
 	 *  Query for object data.
 	 */
-	func queryMetArtObject(identifiedBy objectID: MMObjectIdentifier) async -> Result<MMObject, Error> {
-		return await self.rateLimitedRequest {
-			guard let url = URL(string: "https://collectionapi.metmuseum.org/public/collection/v1/objects/\(objectID)") else {
-				return .failure(MMError.failedAssertion)
-			}
-			
+	func queryMetArtObject(identifiedBy objectID: MMObjectIdentifier, lane: MMRateLimiter.Lane = .visible) async -> Result<MMObject, Error> {
+		let url = apiURL.appending(path: "objects").appending(path: "\(objectID)")
+		let session = self.session
+		return await self.coalescedRequest(.object(objectID), lane: lane) {
 			do {
-				let (data, resp) = try await URLSession.shared.data(from: url)
+				let (data, resp) = try await session.data(from: url)
 				
 				let hStatus = (resp as? HTTPURLResponse)?.statusCode
 				guard hStatus == 200 else {
@@ -75,8 +96,9 @@ extension MMNetworkClient {
 	 *  Query for file data.
 	 */
 	typealias MetArtFileResult = Result<Data, Error>
-	func queryMetArtFile(atURL url: URL) async -> MetArtFileResult {
-		return await self.rateLimitedRequest {
+	func queryMetArtFile(atURL url: URL, lane: MMRateLimiter.Lane = .visible) async -> MetArtFileResult {
+		let session = self.session
+		return await self.coalescedRequest(.file(url), lane: lane) {
 			do {
 				// ...this is provided for local file access, mainly for testing purposes.
 				guard !url.isFileURL else {
@@ -89,7 +111,7 @@ extension MMNetworkClient {
 				}
 				
 				// - otherwise, contact the network
-				let (data, resp) = try await URLSession.shared.data(from: url)
+				let (data, resp) = try await session.data(from: url)
 				
 				let hStatus = (resp as? HTTPURLResponse)?.statusCode
 				guard hStatus == 200 else {
@@ -110,3 +132,83 @@ extension MMNetworkClient {
 		}
 	}
 }
+
+/*
+ *  Internal implementation.
+ */
+extension MMNetworkClient {
+	// - identifies requests that can be shared.
+	private enum RequestKey : Hashable {
+		case object(MMObjectIdentifier)
+		case file(URL)
+	}
+	
+	// - a request in progress, the number of callers waiting for it and the most
+	//   urgent lane any of them asked for.
+	private final class SharedRequest<T> {
+		let id: UInt64
+		let ticket: MMRateLimiter.Ticket
+		let task: Task<T, Never>
+		var lane: MMRateLimiter.Lane
+		var waiters: Int = 0
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(id: UInt64, ticket: MMRateLimiter.Ticket, lane: MMRateLimiter.Lane, task: Task<T, Never>) {
+			self.id		= id
+			self.ticket = ticket
+			self.lane	= lane
+			self.task	= task
+		}
+	}
+	
+	/*
+	 *  Perform a rate-limited request or wait for an identical one that is
+	 *  already in progress.
+	 */
+	private func coalescedRequest<T>(_ key: RequestKey, lane: MMRateLimiter.Lane, _ block: @escaping () async -> T) async -> T {
+		let shared: SharedRequest<T>
+		if let pending = inFlight[key] as? SharedRequest<T>, !pending.task.isCancelled {
+			shared = pending
+			
+			// ...a more urgent caller doesn't wait behind the lane of the first one.
+			if lane.rawValue < shared.lane.rawValue {
+				shared.lane = lane
+				let rateLimiter = self.rateLimiter
+				Task { await rateLimiter.promote(shared.ticket, to: lane) }
+			}
+		}
+		else {
+			// ...the request is only visible to others until it completes.
+			let rId		  = nextRequestId
+			nextRequestId += 1
+			let ticket	  = MMRateLimiter.Ticket(lane: lane)
+			shared		  = .init(id: rId, ticket: ticket, lane: lane, task: Task {
+				let ret = await self.rateLimitedRequest(ticket: ticket, block)
+				if (self.inFlight[key] as? SharedRequest<T>)?.id == rId {
+					self.inFlight[key] = nil
+				}
+				return ret
+			})
+			inFlight[key] = shared
+		}
+		shared.waiters += 1
+		
+		return await withTaskCancellationHandler {
+			await shared.task.value
+		} onCancel: {
+			Task { await self.abandonRequest(shared) }
+		}
+	}
+	
+	/*
+	 *  A caller is no longer interested in a shared request.
+	 */
+	private func abandonRequest<T>(_ shared: SharedRequest<T>) {
+		shared.waiters -= 1
+		if shared.waiters == 0 {
+			shared.task.cancel()
+		}
+	}
+}
@@ -39,12 +39,11 @@ public class MMObjectIndex : Codable, Identifiable {
 				}
 				
 				// - the act of parsing the file consumes a lot of string memory
-				//   that isn't easily returned to the process, but by encoding
-				//	 and decoding it, we can release what I'm assuming is a more
-				//   fragmented heap in favor of better aligned string data.
+				//   that isn't easily returned to the process, so the result is
+				//	 saved in the binary format and reopened from a mapping, which
+				//   only decodes the references that are actually used.
 				Task.detached {	await MainActor.run { receivingStatus?(.optimizing) } }
-				let jData = try ret.standardMMJSONEncoding()
-				return try MMObjectIndex.standardMMJSONDecoding(of: jData)
+				return try ret.reopenedFromBinary()
 			}
 			catch {
 				MMLog.error("\(error.localizedDescription, privacy: .public)")
@@ -70,39 +69,39 @@ public class MMObjectIndex : Codable, Identifiable {
 	static var emptyIndex: MMObjectIndex { .init() }
 	init() {
 		self.id 		= UUID()
-		self.objectList = []
-		self.objectMap	= [:]
+		self.objectList = .init()
+	}
+	
+	/*
+	 *  Initialize the object from a binary index.
+	 */
+	init(mapped: MMBinaryIndex) {
+		self.id			= mapped.indexId
+		self.objectList = .init(mapped: mapped)
 	}
 	
 	/*
 	 *  Initialize the object.
 	 */
 	convenience init(with url: URL) throws {
-		guard let fs = fopen(url.path(), "r") else {
-			throw MMError.invalidFile
-		}
+		let csv = try MMMappedCSV(with: url)
 		self.init()
-		self.fStream = fs
+		self.csvFile = csv
 	}
 		
 	/// Decode the object.
 	public required init(from decoder: Decoder) throws {
 		let container 		= try decoder.container(keyedBy: CodingKeys.self)
 		self.id				= try container.decode(UUID.self, forKey: .indexId)
-		self.fStream 		= nil
-		self.objectList		= []
-		self.objectMap		= [:]
 		let objs 			= try container.decode([MMExhibitRef].self, forKey: .objectList)
-		for oneObj in objs {
-			self.addReferenceToIndex(oneObj)
-		}		
+		self.objectList		= .init(objs)
 	}
 	
 	/// Encode the object.
 	public func encode(to encoder: Encoder) throws {
 		var container = encoder.container(keyedBy: CodingKeys.self)
 		try container.encode(self.id, forKey: .indexId)
-		try container.encode(self.objectList, forKey: .objectList)
+		try container.encode(Array(self.objectList), forKey: .objectList)
 	}
 	
 	/// Assign a local directory for caching purposes to the index.  The cache directory will not
@@ -113,20 +112,7 @@ public class MMObjectIndex : Codable, Identifiable {
 		guard FileManager.default.fileExists(atPath: url.path(percentEncoded: false), isDirectory: &isDir), isDir.boolValue else {
 			throw MMError.invalidFile
 		}
-		let eCacheURL	   = url.appending(path: "MMObjectIndex").appending(path: "exhibits")
-		let eCacheFilesURL = url.appending(path: "MMObjectIndex").appending(path: "files")
-		try FileManager.default.createDirectory(at: eCacheURL, withIntermediateDirectories: true)
-		try FileManager.default.createDirectory(at: eCacheFilesURL, withIntermediateDirectories: true)
-		self.exhibitCacheURL 	 = eCacheURL
-		self.exhibitFileCacheURL = eCacheFilesURL
-	}
-	
-	/*
-	 *  Destructor
-	 */
-	deinit {
-		guard self.fStream != nil else { return }
-		fclose(self.fStream)
+		self.exhibitCache = try MMExhibitCache(rootURL: url.appending(path: "MMObjectIndex"))
 	}
 	
 	// - codable keys.
@@ -136,16 +122,15 @@ public class MMObjectIndex : Codable, Identifiable {
 	}
 	
 	// - internal
-	private var fStream: UnsafeMutablePointer<FILE>?		// - only for creation
-	private var lineCount: Int?								// - only for creation
-	private var headerMap: [IndexedColumn : Int]?			// - only for creation
-	private var columnCount: Int = 0						// - only for creation
-	private var columnCache: [String] = []					// - only for creation
-	
-	var objectList: [ MMExhibitRef ]
-	var objectMap: [ UInt : MMExhibitRef]
-	private var exhibitCacheURL: URL?
-	private var exhibitFileCacheURL: URL?
+	private var csvFile: MMMappedCSV?						// - only for creation
+	
+	var objectList: ObjectList
+	private let sLock: NSLock							= .init()
+	private var searchIndexTask: Task<MMSearchIndex, Never>?
+	let filterEngine: MMFilterEngine					= .init()
+	let prefetcher: MMExhibitPrefetcher					= .init()
+	var networkClient: MMNetworkClient					= .shared
+	private(set) var exhibitCache: MMExhibitCache?
 }
 
 /*
@@ -153,7 +138,7 @@ public class MMObjectIndex : Codable, Identifiable {
  */
 extension MMObjectIndex : Sequence {
 	/// The number of indexed objects.
-	public var count: Int { objectMap.count }
+	public var count: Int { objectList.uniqueCount }
 	
 	/// Return an object by offset.
 	public subscript(index: Int) -> MMExhibitRef? {
@@ -168,7 +153,7 @@ extension MMObjectIndex : Sequence {
 	
 	/// Return an object by ObjectID
 	public func object(byID objectID: UInt) -> MMExhibitRef? {
-		return objectMap[objectID]
+		return objectList.object(byID: objectID)
 	}
 	
 	/// A type that provides Sequence-compatible iteration over an index.
@@ -200,11 +185,11 @@ extension MMObjectIndex : Sequence {
 	public func exhibit(from exhibitRef: MMExhibitRef) async -> Result<MMExhibit, Error> {		
 		do {
 			let ret: MMExhibit
-			if let eCached = exhibitFromCache(eRef: exhibitRef) {
+			if let eCached = exhibitFromCache(eRef: exhibitRef, lane: .visible) {
 				ret = eCached
 			}
 			else {
-				let obj = try await MMNetworkClient.shared.queryMetArtObject(identifiedBy: exhibitRef.objectID).get()
+				let obj = try await networkClient.queryMetArtObject(identifiedBy: exhibitRef.objectID).get()
 				ret 	= MMExhibit(object: obj, owner: self)
 				saveExhibitToCache(exhibit: ret)
 			}
@@ -239,6 +224,7 @@ extension MMObjectIndex {
 	}
 	
 	/// Filter the contents of the object index, returning a collection representing the results.  Pass `nil` to return an unfiltered collection.
+	/// A request that is cancelled or superseded by a newer one throws `MMError.cancelled`.
 	private static var MinimumSearchTextLength: Int { 3 }
 	public func filtered(by filterCriteria: MMFilterCriteria?) async throws -> MMExhibitCollection {
 		guard let filterCriteria = filterCriteria,
@@ -247,15 +233,108 @@ extension MMObjectIndex {
 			return self.fullIndex
 		}
 		
-		// - search the index
+		// - search the index, possibly within a recent result.
+		let offsets = try await filterEngine.offsets(matching: filterCriteria, in: self)
+		return .init(context: .init(indexId: self.id, criteria: filterCriteria, _offsets: offsets), objectIndex: self)
+	}
+	
+	/*
+	 *  Filter the contents by checking every reference, which is the definition of
+	 *  what the search index must return.
+	 */
+	func scanned(by filterCriteria: MMFilterCriteria) -> [Int] {
 		var offsets: [Int] = []
 		for i in 0..<objectList.count {
 			if Task.isCancelled { break }
-			guard MMExhibitCollection.includeInCollection(exhibit: objectList[i], criteria: filterCriteria) else { continue }
+			guard MMExhibitCollection.includeInCollection(exhibit: objectList.transientRef(at: i), criteria: filterCriteria) else { continue }
 			offsets.append(i)
 		}
+		return offsets
+	}
 		
-		return .init(context: .init(indexId: self.id, criteria: filterCriteria, _offsets: offsets), objectIndex: self)
+	/*
+	 *  Return the search index, building it the first time it is needed.
+	 *  - concurrent requests share the same build.
+	 *  - a build that was replaced because the list changed is never returned.
+	 */
+	func searchIndex() async -> MMSearchIndex {
+		while true {
+			sLock.lock()
+			let task: Task<MMSearchIndex, Never>
+			if let pending = searchIndexTask {
+				task = pending
+			}
+			else {
+				let objectList  = self.objectList
+				task 			= Task.detached(priority: .userInitiated) { MMSearchIndex(objectList) }
+				searchIndexTask = task
+			}
+			sLock.unlock()
+			
+			let ret = await task.value
+			sLock.lock()
+			let isCurrent = searchIndexTask == task
+			sLock.unlock()
+			if isCurrent {
+				return ret
+			}
+		}
+	}
+	
+	/*
+	 *  The object list was modified, so anything derived from it must be rebuilt.
+	 */
+	private func objectListWasChanged() {
+		sLock.lock()
+		searchIndexTask?.cancel()
+		searchIndexTask = nil
+		sLock.unlock()
+		filterEngine.reset()
+	}
+}
+
+/*
+ *  Binary persistence.
+ */
+extension MMObjectIndex {
+	/// Return the index in a compact binary format.  The binary format can be reopened
+	/// with `MetModel.openIndex(at:)` in a fraction of the time it takes to decode the JSON
+	/// encoding because its exhibit references are only decoded when they are accessed.
+	public func binaryEncoding() throws -> Data {
+		return try MMBinaryIndex.encode(objectList, indexId: id)
+	}
+	
+	/// Save the index to a file in its binary format.
+	public func write(to url: URL) throws {
+		try binaryEncoding().write(to: url, options: [.atomic])
+	}
+	
+	/*
+	 *  Open an index file that was saved in the binary format.
+	 */
+	static func open(at url: URL) throws -> MMObjectIndex {
+		return .init(mapped: try MMBinaryIndex(contentsOf: url))
+	}
+	
+	/*
+	 *  Open an index from data in the binary format.
+	 */
+	static func open(from data: Data) throws -> MMObjectIndex {
+		return .init(mapped: try MMBinaryIndex(data: data))
+	}
+	
+	/*
+	 *  Save the index and reopen it from a mapping of the saved file.
+	 *  - the file is removed right away because the mapping remains valid until
+	 *    it is closed.
+	 */
+	private func reopenedFromBinary() throws -> MMObjectIndex {
+		let tmpURL = FileManager.default.temporaryDirectory.appending(path: "index-\(id.uuidString).\(MMBinaryIndex.FileExtension)")
+		defer {
+			try? FileManager.default.removeItem(at: tmpURL)
+		}
+		try write(to: tmpURL)
+		return try Self.open(at: tmpURL)
 	}
 }
 
@@ -263,8 +342,82 @@ extension MMObjectIndex {
  *  Types
  */
 extension MMObjectIndex {
+	// - the references in an index, which are either held in memory or decoded
+	//   on demand from a binary index.
+	struct ObjectList : RandomAccessCollection {
+		/*
+		 *  Initialize the object.
+		 */
+		init(_ refs: [MMExhibitRef] = []) {
+			self.refs	= []
+			self.idMap	= [:]
+			self.mapped = nil
+			self.refs.reserveCapacity(refs.count)
+			for oneRef in refs {
+				self.append(oneRef)
+			}
+		}
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(mapped: MMBinaryIndex) {
+			self.refs	= []
+			self.idMap	= [:]
+			self.mapped = mapped
+		}
+		
+		var startIndex: Int { 0 }
+		var endIndex: Int { mapped?.count ?? refs.count }
+		
+		// - the number of distinct object identifiers.
+		var uniqueCount: Int { mapped?.uniqueCount ?? idMap.count }
+		
+		/*
+		 *  Return a reference by offset.
+		 */
+		subscript(position: Int) -> MMExhibitRef {
+			return mapped?.row(at: position) ?? refs[position]
+		}
+		
+		/*
+		 *  Return a reference by offset without retaining it if it must be decoded,
+		 *  which is intended for visiting every reference once.
+		 */
+		func transientRef(at position: Int) -> MMExhibitRef {
+			return mapped?.decodeRow(at: position) ?? refs[position]
+		}
+		
+		/*
+		 *  Return a reference by its object identifier.
+		 */
+		func object(byID objectID: UInt) -> MMExhibitRef? {
+			if let mapped = mapped {
+				guard let offset = mapped.offset(ofObjectID: objectID) else { return nil }
+				return mapped.row(at: offset)
+			}
+			guard let offset = idMap[objectID] else { return nil }
+			return refs[offset]
+		}
+		
+		/*
+		 *  Add a reference to the end of the list.
+		 */
+		mutating func append(_ ref: MMExhibitRef) {
+			assert(mapped == nil, "Binary indices are read-only.")
+			idMap[ref.objectID] = refs.count
+			refs.append(ref)
+		}
+		
+		// - internal
+		private var refs: [MMExhibitRef]
+		private var idMap: [UInt : Int]
+		private let mapped: MMBinaryIndex?
+	}
+	
 	// - the columns from the file that are used for indexing
-	private enum IndexedColumn : CaseIterable {
+	// - the raw value is the column's offset in a parsed row.
+	private enum IndexedColumn : Int, CaseIterable {
 		case objectNumber
 		case isHighlight
 		case isTimelineWork
@@ -302,7 +455,7 @@ extension MMObjectIndex {
 		}()
 				
 		// - these *must* match the columns in the first row of the file.
-		private var columnName: String {
+		var columnName: String {
 			switch self {
 			case .objectNumber:
 				return "Object Number"
@@ -493,198 +646,66 @@ extension MMObjectIndex {
  */
 extension MMObjectIndex : MMExhibitCacheOwnable {
 	/*
-	 *  Read a line from the file.
-	 *  - DESIGN: the newline characters are *not* automatically discarded because
-	 *            some rows may use strings to express multi-line column data.
-	 */
-	private func readLine() throws -> String? {
-		guard let fStream = fStream else {
-			throw MMError.invalidFile
-		}
-		
-		let BufSize: Int = 8192
-		let ptr 	     = UnsafeMutablePointer<CChar>.allocate(capacity: BufSize)
-		defer {
-			ptr.deallocate()
-		}
-		ptr.initialize(repeating: CChar(0), count: BufSize)
-		guard let oneLine = fgets(ptr, Int32(BufSize), fStream) else {
-			let errNo = ferror(self.fStream)
-			guard errNo == 0 else {
-				throw MMError.fileError(errno: errNo)
-			}
-			
-			// - end of file
-			return nil
-		}
-		
-		guard let sLine = String(validatingUTF8: oneLine)?.trimmingCharacters(in: .whitespaces) else {
-			throw MMError.badFormat(msg: .mmLocalized(localized: "The source data is not valid UTF-8."))
-		}
-
-		return sLine
-	}
-	
-	/*
-	 *  Read from the file and attempt to cache either:
-	 * 		(1) all of the columns in a single line or
-	 *  	(2) enough columns to satisfy the header-specified column count.
-	 *  - Returns `false` if no columns are available.
-	 */
-	private func cacheColumns(asHeader isHeader: Bool) throws -> Bool {
-		var updCache: [String] = columnCache
-		var curCol 	  		   = ""
-		var isEscaped 		   = false
-		
-		// - the challenge with this parsing is the use of escape characters, specifically double-quotes
-		//   to represent a string that may include commas and newlines.  That requires a loop
-		//   for iterating over the lines until we fill the expected number of columns.
-		while updCache.count == 0 || (!isHeader && updCache.count < self.columnCount) {
-			guard let text = try readLine() else { break }
-			self.lineCount = (lineCount ?? 0) + 1
-		
-			for c in text {
-				if c == "\"" {
-					isEscaped.toggle()
-				}
-				else if isEscaped || (c != "," && !c.isNewline) {
-					curCol.append(c)
-				}
-				
-				// ...end of column
-				if c == "," && !isEscaped {
-					updCache.append(curCol.trimmingCharacters(in: .whitespacesAndNewlines))
-					curCol = ""
-				}
-			}
-			
-			// - unless we're crossing line boundaries.
-			// - NOTE:  If a row doesn't have a last column after its final comma delimiter, it
-			//   will appear as just a comma followed by newline.  The implication is there is
-			//   an _empty column value_ there if we're not expecting to escape across two lines.
-			if !isEscaped {
-				// ...when not escaping and there is data, always add it.
-				// ...with the caveat if we should have a final column, but it is empty,
-				//    add that special case also.
-				let lastCol = curCol.trimmingCharacters(in: .whitespacesAndNewlines)
-				if !lastCol.isEmpty || (!isHeader && updCache.count < self.columnCount) {
-					updCache.append(lastCol)
-				}
-			}
-		}
-		
-		self.columnCache = updCache
-		return !updCache.isEmpty
-	}
-	
-	/*
-	 *  Read a specific number of columns from a line.
-	 */
-	private func readColumnarLine(asHeader isHeader: Bool) throws -> [String]? {
-		// - cache as many as possible.
-		guard try cacheColumns(asHeader: isHeader) else { return nil }
-		
-		
-		let ret: [String]
-		if isHeader {
-			// ...intended for the header, just return one line's worth.
-			ret 			 = self.columnCache
-			self.columnCache = []
-		}
-		else {
-			// ...every other row has specific requirements and allow for
-			//    an abbreviated final row, just for completeness.
-			guard self.columnCache.count >= self.columnCount else { return nil }
-			ret = Array<String>(self.columnCache.prefix(self.columnCount))
-			self.columnCache.removeFirst(self.columnCount)
-		}
-		
-		return ret
-	}
-	
-	/*
-	 *  Read a single line from the file, parsing columns known to be indexed.
+	 *  Perform file indexing.
 	 */
-	private func readIndexedLine() throws -> [IndexedColumn : String]? {
-		guard let headerMap = headerMap else {
+	func parseAndIndexFile(receivingStatus: StatusCallback) async throws {
+		guard let csvFile = csvFile else {
 			throw MMError.invalidFile
 		}
-
-		guard let cols = try readColumnarLine(asHeader: false) else { return nil }
 		
-		var ret: [IndexedColumn : String] = [:]
-		for ic in IndexedColumn.allCases {
-			guard let mc = headerMap[ic] else {
-				assert(false, "The column names should have alredy been verified.")
-				throw MMError.failedAssertion
-			}
-			let colItem = cols[mc]
-			ret[ic] = colItem.isEmpty ? "" : colItem
-		}
-		return ret
-	}
-	
-	/*
-	 *  Perform file indexing.
-	 */
-	private func parseAndIndexFile(receivingStatus: StatusCallback) async throws {
-		// 1. Count the lines to be able to establish progress
-		var totalCount = 0
-		while let _ = try readLine() {
-			totalCount += 1
-		}
-		guard totalCount > 1 else {
-			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index has no content."))
-		}
-		guard fseek(self.fStream, 0, SEEK_SET) == 0 else {
-			throw MMError.fileError(errno: ferror(self.fStream))
-		}
-				
-		// - 2.  Map header items to offsets in each row
-		guard let hdrItems = try readColumnarLine(asHeader: true) else {
+		// - 1.  Map header items to offsets in each row
+		let hdrItems = try csvFile.readHeader()
+		guard !hdrItems.isEmpty else {
 			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index is missing a header row."))
 		}
-		var headerMap: [IndexedColumn : Int] = [:]
+		var columnSlots: [Int?] = .init(repeating: nil, count: hdrItems.count)
 		for i in 0..<hdrItems.count {
 			let col = hdrItems[i].trimmingCharacters(in: .controlCharacters)		// - the first item is going to have UTF-8 control characters.
 			guard let ic = IndexedColumn(for: col) else {
 				continue
 			}
-			headerMap[ic] = i
+			columnSlots[i] = ic.rawValue
+		}
+		let foundSlots = Set(columnSlots.compactMap({ $0 }))
+		if let missing = IndexedColumn.allCases.first(where: { !foundSlots.contains($0.rawValue) }) {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index is missing the '\(missing.columnName)' column."))
+		}
+		
+		// - 2.  Count the records to be able to establish progress
+		let totalCount = csvFile.countRecords() + 1
+		guard totalCount > 1 else {
+			throw MMError.badFormat(msg: .mmLocalized(localized: "The object index has no content."))
 		}
-		self.columnCount = hdrItems.count
-		self.headerMap 	 = headerMap
 		receivingStatus(.started(totalCount: totalCount))
-		var rowCount = 1
-		receivingStatus(.progress(row: rowCount, totalCount: totalCount))
-
-		// - 3.  Read each line and parse it into a reference if it is valid.
+		receivingStatus(.progress(row: 1, totalCount: totalCount))
+		
+		// - 3.  Parse the records in parallel, converting each into a reference if it is valid.
 		let dBegin: Date = .init()
-		var skipped: Int = 0
-		while true {
-			guard let row = try readIndexedLine() else { break }
-			if let ref = rowToReference(row, rowNumber: rowCount - 1) {
-				addReferenceToIndex(ref)
-			}
-			else {
-				skipped += 1
-			}
-			rowCount += 1
-			receivingStatus(.progress(row: rowCount, totalCount: totalCount))
+		let parsed		 = try csvFile.parseRecords(columnSlots: columnSlots, numSlots: IndexedColumn.allCases.count) { completed in
+			receivingStatus(.progress(row: completed + 1, totalCount: totalCount))
+		} transform: { fields in
+			rowToReference(.init(fields: fields))
 		}
+		let rowCount = parsed.records.count + parsed.skipped
 		
 		// - 4.  Sorting
-		self.objectList.sort { $0.sortText < $1.sortText }
+		self.objectList = .init(parsed.records.sorted { $0.sortText < $1.sortText })
+		objectListWasChanged()
 		
 		// - 5.  Final rate calculation
 		let diff = Date().timeIntervalSince(dBegin)
 		let rVal = Double(rowCount) / Double(diff)
 		let indexRate = !rVal.isNaN ? rVal : 0.0
-		receivingStatus(.completed(skipped: skipped, indexed: objectList.count, indexingRate: indexRate))
+		receivingStatus(.completed(skipped: parsed.skipped, indexed: objectList.count, indexingRate: indexRate))
 		
-		// ...close the file stream
-		fclose(self.fStream)
-		self.fStream = nil
+		// ...release the file mapping
+		self.csvFile = nil
+	}
+	
+	// - the indexed columns of a single row.
+	private struct IndexedRow {
+		let fields: [String]
+		subscript(column: IndexedColumn) -> String? { fields[column.rawValue] }
 	}
 		
 	/*
@@ -698,7 +719,7 @@ extension MMObjectIndex : MMExhibitCacheOwnable {
 	/*
 	 *  Convert the row into an object reference if is meets the criteria.
 	 */
-	private func rowToReference(_ row: [IndexedColumn : String], rowNumber: Int) -> MMExhibitRef? {
+	private func rowToReference(_ row: IndexedRow) -> MMExhibitRef? {
 		// - the idea here is to normalize the data into strong types and omit
 		//   records that won't be used for this app.
 		
@@ -759,28 +780,20 @@ extension MMObjectIndex : MMExhibitCacheOwnable {
 	 */
 	private func addReferenceToIndex(_ ref: MMExhibitRef) {
 		objectList.append(ref)
-		objectMap[ref.objectID] = ref
-	}
 		
-	/*
-	 *  Convert an exhibit into a URL.
-	 */
-	private func exhibitURLFrom(_ exhibit: MMExhibitIdentifiable) -> URL? {
-		guard let exhibitCacheURL = exhibitCacheURL else { return nil }
-		return exhibitCacheURL.appending(path: "exhibit-\(exhibit.objectID).json")
+		// ...the search index no longer describes the list.
+		objectListWasChanged()
 	}
-	
+		
 	/*
 	 *  Retrieve an exhibit from local cache if it exists.
 	 */
-	private func exhibitFromCache(eRef: MMExhibitRef) -> MMExhibit? {
+	private func exhibitFromCache(eRef: MMExhibitRef, lane: MMRateLimiter.Lane) -> MMExhibit? {
+		guard let eData = exhibitCache?.exhibitData(for: eRef.objectID, lane: lane) else { return nil }
 		do {
-			if let eURL = exhibitURLFrom(eRef), FileManager.default.fileExists(atPath: eURL.path(percentEncoded: false)) {
-				let data = try Data(contentsOf: eURL)
-				let ret  = try MMExhibit.standardMMJSONDecoding(of: data)
-				ret.cacheOwner = self
-				return ret
-			}
+			let ret = try MMExhibit.standardMMJSONDecoding(of: eData)
+			ret.cacheOwner = self
+			return ret
 		}
 		catch {
 			MMLog.error("Failed to load an exhibit from local cache.  \(error.localizedDescription, privacy: .public)")
@@ -795,11 +808,11 @@ extension MMObjectIndex : MMExhibitCacheOwnable {
 	 *  Save an exhibit to local cache if possible.
 	 */
 	private func saveExhibitToCache(exhibit: MMExhibit) {
-		guard let eURL = exhibitURLFrom(exhibit) else { return }
+		guard let exhibitCache = exhibitCache else { return }
 		Task(priority: .background) {
 			do {
 				let eData = try exhibit.standardMMJSONEncoding()
-				try eData.write(to: eURL, options: [.atomic])
+				try exhibitCache.saveExhibitData(eData, for: exhibit.objectID)
 			}
 			catch {
 				MMLog.error("Failed to save an exhibit to local cache.  \(error.localizedDescription, privacy: .public)")
@@ -807,41 +820,14 @@ extension MMObjectIndex : MMExhibitCacheOwnable {
 		}
 	}
 	
-	/*
-	 *  Convert a remote URL into a cache-local URL.
-	 */
-	private func fileURLFromRemoteURL(_ url: URL) -> URL? {
-		guard let exhibitFileCacheURL = exhibitFileCacheURL else { return nil }
-		let hash = url.absoluteString.shaHash
-		let ext  = url.pathExtension
-		return exhibitFileCacheURL.appending(path: "file-\(hash).\(ext.isEmpty ? "data" : ext)")
-	}
-	
-	/*
-	 *  Attempt to load a file from cache.
-	 */
-	private func fileFromCache(url: URL) -> Data? {
-		do {
-			if let fURL = fileURLFromRemoteURL(url), FileManager.default.fileExists(atPath: fURL.path(percentEncoded: false)) {
-				return try Data(contentsOf: fURL)
-			}
-		}
-		catch {
-			MMLog.error("Failed to read the cache file \(self.fileURLFromRemoteURL(url)?.path(percentEncoded: false) ?? url.absoluteString).  \(error.localizedDescription, privacy: .public)")
-		}
-		return nil
-	}
-	
 	/*
 	 *  Save a file to the cache.
 	 */
 	private func saveFileToCache(_ result: MMNetworkClient.MetArtFileResult, fromURL url: URL) {
-		guard let fURL = fileURLFromRemoteURL(url) else { return }
+		guard let exhibitCache = exhibitCache, case .success(let data) = result else { return }
 		Task(priority: .background) {
 			do {
-				if case .success(let data) = result {
-					try data.write(to: fURL, options: [.atomic])
-				}
+				try exhibitCache.saveFileData(data, for: url)
 			}
 			catch {
 				MMLog.error("Failed to save file data to local cache. \(error.localizedDescription, privacy: .public)")
@@ -852,16 +838,55 @@ extension MMObjectIndex : MMExhibitCacheOwnable {
 	/*
 	 *  Retrieve a file object, first by cache and then by network.
 	 */
-	func queryMetArtFile(atURL url: URL) async -> MMNetworkClient.MetArtFileResult {
-		if let cfData = fileFromCache(url: url) {
+	func queryMetArtFile(atURL url: URL, lane: MMRateLimiter.Lane) async -> MMNetworkClient.MetArtFileResult {
+		if let cfData = exhibitCache?.fileData(for: url, lane: lane) {
 			return .success(cfData)
 		}
 
 		// ...not in cache, retrieve it and save it now.
-		let ret = await MMNetworkClient.shared.queryMetArtFile(atURL: url)
+		let ret = await networkClient.queryMetArtFile(atURL: url, lane: lane)
 		saveFileToCache(ret, fromURL: url)
 		return ret
 	}
+	
+	/*
+	 *  Retrieve a decoded image, first from memory and then as a file.
+	 */
+	func queryMetArtImage(atURL url: URL, lane: MMRateLimiter.Lane) async -> MMImageRef? {
+		if let img = exhibitCache?.image(for: url, lane: lane) {
+			return img
+		}
+		
+		switch await queryMetArtFile(atURL: url, lane: lane) {
+		case .success(let data):
+			guard let ret = await MMImageRef.fromData(data, withFileData: true) else { return nil }
+			exhibitCache?.saveImage(ret, for: url)
+			return ret
+			
+		case .failure(let error):
+			// ...don't log cancellations since they can easily occur.
+			if !Task.isCancelled {
+				MMLog.error("Failed to query for MetArt image data at \(url.absoluteString, privacy: .public).  \(error.localizedDescription, privacy: .public)")
+			}
+			return nil
+		}
+	}
+	
+	/*
+	 *  Warm the cache with an exhibit and the image used to preview it.
+	 *  - the exhibit is created without an owner so that its full sized images aren't retrieved.
+	 */
+	func prefetchExhibit(_ exhibitRef: MMExhibitRef) async {
+		guard exhibitCache != nil, !Task.isCancelled else { return }
+		var exhibit: MMExhibit? = exhibitFromCache(eRef: exhibitRef, lane: .prefetch)
+		if exhibit == nil, let obj = try? await networkClient.queryMetArtObject(identifiedBy: exhibitRef.objectID, lane: .prefetch).get() {
+			let ret = MMExhibit(object: obj)
+			saveExhibitToCache(exhibit: ret)
+			exhibit = ret
+		}
+		guard !Task.isCancelled, let sURL = exhibit?.primaryImageSmallURL else { return }
+		let _ = await queryMetArtImage(atURL: sURL, lane: .prefetch)
+	}
 }
 
 /*
@@ -14,103 +14,260 @@ import Foundation
  *  they've specified on their API site https://metmuseum.github.io as:
  
  *		> Please limit request rate to 80 requests per second.
+ *
+ *  DESIGN:  Access is paced with a token bucket that refills continuously, so requests
+ *			 are spread evenly across each second instead of being released all at once
+ *			 when a counter resets.  The burst is the number of tokens the bucket can hold,
+ *			 which is how many requests may proceed together after an idle period.  Waiting
+ *			 requests are released from the most urgent lane first and in order within it.
+ *			 A request may become more urgent while it waits, in which case it moves to the
+ *			 end of the more urgent lane.
  */
 actor MMRateLimiter {
 	static let MetArtLimit: UInt = 80
 	
+	// - the lanes for waiting requests, in order of urgency.
+	enum Lane : Int, CaseIterable {
+		case visible				// - content that is being displayed
+		case prefetch				// - content that may be displayed soon
+	}
+	
 	let requestsPerSecond: UInt
+	let burst: UInt
 	var isSchedulerRunning: Bool { self.scheduler != nil }
 	
 	/*
 	 *  Initialize the actor.
+	 *  - the default burst allows a tenth of a second of requests at once.
 	 */
-	init(requestsPerSecond: UInt) {
+	init(requestsPerSecond: UInt, burst: UInt? = nil) {
 		assert(requestsPerSecond > 0, "Unexpected non-limit.")
-		MMLog.info("Configuring model request rate limiter for \(requestsPerSecond, privacy: .public)rps.")
+		let burst = Swift.max(burst ?? requestsPerSecond / 10, 1)
+		MMLog.info("Configuring model request rate limiter for \(requestsPerSecond, privacy: .public)rps with a burst of \(burst, privacy: .public).")
 		self.requestsPerSecond = requestsPerSecond
-		self.reqCount 		   = 0
-		self.waitPending  	   = []
+		self.burst			   = burst
+		self.origin			   = .now
+		self.schedule		   = .init(requestsPerSecond: requestsPerSecond, burst: burst, now: 0)
 	}
 	
 	/*
 	 *  Wait for rate-limited access to the shared resource.
+	 *  - a cancelled task returns right away without consuming any capacity.
 	 */
-	func waitForAccess() async {
-		guard !canRunWithCurrentCapacity() else { return }
-		await self.scheduledWait()
+	func waitForAccess(lane: Lane = .visible) async {
+		await waitForAccess(ticket: .init(lane: lane))
 	}
-
-		
+	
+	/*
+	 *  Wait for rate-limited access to the shared resource in the lane of the ticket,
+	 *  which may be promoted while waiting.
+	 */
+	func waitForAccess(ticket: Ticket) async {
+		guard !Task.isCancelled else { return }
+		let wId = nextWaiterId
+		nextWaiterId += 1
+		await withTaskCancellationHandler {
+			await withCheckedContinuation { (continuation: CheckedContinuation<Void, Never>) in
+				guard !self.schedule.request(.init(id: wId, ticket: ticket, continuation: continuation), lane: ticket.lane, at: elapsed) else {
+					continuation.resume()
+					return
+				}
+				self.createSchedulerIfNecessary()
+			}
+		} onCancel: {
+			Task { await self.cancelWaiter(wId) }
+		}
+	}
+	
+	/*
+	 *  Move a request to a more urgent lane, whether or not it has started waiting.
+	 *  - a request that was already released is unaffected.
+	 */
+	func promote(_ ticket: Ticket, to lane: Lane) {
+		guard lane.rawValue < ticket.lane.rawValue else { return }
+		ticket.lane = lane
+		schedule.promote(where: { $0.ticket === ticket }, to: lane)
+	}
+	
 	// - internal
 	private typealias VoidTask = Task<Void, Never>
+	private let origin: ContinuousClock.Instant
 	private var scheduler: VoidTask?
-	private var reqCount: Int
-	private var waitPending: [VoidTask]
+	private var schedule: Schedule<Waiter>
+	private var nextWaiterId: UInt64				= 0
 }
 
 /*
- *  Internal implementation
+ *  Types
  */
 extension MMRateLimiter {
 	/*
-	 *  The scheduler ensures orderly access to the shared resource 
-	 *  in with a FIFO algorithm.
+	 *  Identifies the lane of a request that may become more urgent.
+	 *  - the lane is only changed by the limiter so that a promotion is never lost
+	 *    while the request is on its way to waiting.
 	 */
-	private func createSchedulerIfNecessary() {
-		guard self.scheduler == nil else { return }
-		self.scheduler = Task {[weak self] () in
-			while true {
-				try? await Task.sleep(for: .seconds(1))				// - must be once per second
-				guard !Task.isCancelled, let self = self else { break }
-				await self.runSchedulerCycle()
-			}
+	final class Ticket {
+		fileprivate(set) var lane: Lane
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(lane: Lane) {
+			self.lane = lane
 		}
 	}
 	
 	/*
-	 *  Executes the scheduler activities.
+	 *  The pacing of requests against a clock, which is separate from the actor so
+	 *  that it may be driven by any source of time.
 	 */
-	private func runSchedulerCycle() {
-		// - reset the request count and enqueue what is waiting.
-		self.reqCount = 0
-
-		// - nothing to do, then pause the scheduler.
-		guard !self.waitPending.isEmpty else {
-			self.scheduler?.cancel()
-			self.scheduler = nil
-			return
+	struct Schedule<Element> {
+		/*
+		 *  Initialize the object.
+		 */
+		init(requestsPerSecond: UInt, burst: UInt, now: TimeInterval) {
+			self.rate	  = Double(requestsPerSecond)
+			self.capacity = Double(burst)
+			self.tokens	  = Double(burst)
+			self.refilled = now
+			self.lanes	  = .init(repeating: [], count: Lane.allCases.count)
+		}
+		
+		// - indicates whether nothing is waiting.
+		var isEmpty: Bool { lanes.allSatisfy({ $0.isEmpty }) }
+		
+		/*
+		 *  Request access, returning `true` when it is granted immediately or
+		 *  `false` when the element must wait for `dispatch(at:)`.
+		 */
+		mutating func request(_ element: Element, lane: Lane, at now: TimeInterval) -> Bool {
+			// ...nothing may pass others that are already waiting.
+			refill(at: now)
+			if isEmpty && tokens >= 1 - Self.Epsilon {
+				tokens = Swift.max(tokens - 1, 0)
+				return true
+			}
+			lanes[lane.rawValue].append(element)
+			return false
+		}
+		
+		/*
+		 *  Remove a waiting element.
+		 */
+		mutating func remove(where predicate: (Element) -> Bool) -> Element? {
+			for l in 0..<lanes.count {
+				if let idx = lanes[l].firstIndex(where: predicate) {
+					return lanes[l].remove(at: idx)
+				}
+			}
+			return nil
+		}
+		
+		/*
+		 *  Move a waiting element to the end of a more urgent lane.
+		 */
+		mutating func promote(where predicate: (Element) -> Bool, to lane: Lane) {
+			for l in (lane.rawValue + 1)..<lanes.count {
+				if let idx = lanes[l].firstIndex(where: predicate) {
+					lanes[lane.rawValue].append(lanes[l].remove(at: idx))
+					return
+				}
+			}
+		}
+		
+		/*
+		 *  Release as many waiting elements as the current capacity permits, most urgent first.
+		 */
+		mutating func dispatch(at now: TimeInterval) -> [Element] {
+			refill(at: now)
+			var ret: [Element] = []
+			for l in 0..<lanes.count {
+				while !lanes[l].isEmpty && tokens >= 1 - Self.Epsilon {
+					tokens = Swift.max(tokens - 1, 0)
+					ret.append(lanes[l].removeFirst())
+				}
+			}
+			return ret
+		}
+		
+		/*
+		 *  Return the time when the next waiting element can be released, or `nil` when
+		 *  nothing is waiting.
+		 */
+		func nextDispatch(at now: TimeInterval) -> TimeInterval? {
+			guard !isEmpty else { return nil }
+			let available = Swift.min(capacity, tokens + Swift.max(now - refilled, 0) * rate)
+			return available >= 1 - Self.Epsilon ? now : now + (1 - available) / rate
 		}
 		
-		// - to free the waiting tasks, just cancel them
-		while !self.waitPending.isEmpty, canRunWithCurrentCapacity() {
-			let first = waitPending.removeFirst()
-			first.cancel()
+		// - internal
+		private static var Epsilon: Double { 1e-9 }
+		private let rate: Double
+		private let capacity: Double
+		private var tokens: Double
+		private var refilled: TimeInterval
+		private var lanes: [[Element]]
+		
+		/*
+		 *  Add the tokens accumulated since the last refill.
+		 */
+		private mutating func refill(at now: TimeInterval) {
+			guard now > refilled else { return }
+			tokens	 = Swift.min(capacity, tokens + (now - refilled) * rate)
+			refilled = now
 		}
 	}
 	
+	// - a request that is waiting for access.
+	private struct Waiter {
+		let id: UInt64
+		let ticket: Ticket
+		let continuation: CheckedContinuation<Void, Never>
+	}
+}
+
+/*
+ *  Internal implementation
+ */
+extension MMRateLimiter {
+	// - the seconds since the limiter was created.
+	private var elapsed: TimeInterval {
+		let comps = origin.duration(to: .now).components
+		return Double(comps.seconds) + Double(comps.attoseconds) * 1e-18
+	}
+	
 	/*
-	 *  Checks if the current
+	 *  The scheduler releases waiting requests as capacity becomes available and
+	 *  stops once nothing is waiting.
 	 */
-	private func canRunWithCurrentCapacity() -> Bool {
-		if self.reqCount < self.requestsPerSecond {
-			self.reqCount += 1
-			return true
+	private func createSchedulerIfNecessary() {
+		guard self.scheduler == nil else { return }
+		self.scheduler = Task {
+			await self.runScheduler()
 		}
-		return false
 	}
 	
 	/*
-	 *  The inbound requests have exceeded capacity, schedule a wait in the
-	 *  FIFO queue until capacity becomes available.
+	 *  Executes the scheduler activities.
 	 */
-	private func scheduledWait() async {
-		let ret: VoidTask = Task {
-			while !Task.isCancelled  {
-				try? await Task.sleep(for: .milliseconds(250))
+	private func runScheduler() async {
+		while true {
+			let now = elapsed
+			for oneWaiter in schedule.dispatch(at: now) {
+				oneWaiter.continuation.resume()
 			}
+			
+			// - nothing to do, then pause the scheduler.
+			guard let next = schedule.nextDispatch(at: now) else { break }
+			try? await Task.sleep(until: origin.advanced(by: .seconds(next)), clock: .continuous)
 		}
-		self.waitPending.append(ret)
-		self.createSchedulerIfNecessary()
-		await ret.value
+		self.scheduler = nil
+	}
+	
+	/*
+	 *  Release a waiting request that was cancelled.
+	 */
+	private func cancelWaiter(_ wId: UInt64) {
+		schedule.remove(where: { $0.id == wId })?.continuation.resume()
 	}
 }
@@ -0,0 +1,488 @@
+//
+//  MMSearchIndex.swift
+//  MetModel
+// 
+//  Created on 3/18/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import Foundation
+
+/*
+ *  DESIGN:  Filtering must produce exactly the same offsets as checking every reference
+ *			 with `MMExhibitCollection.includeInCollection(exhibit:criteria:)`, but without
+ *			 visiting every reference on every keystroke.
+ *
+ *			 columns:	 every text field that is matched is indexed separately.  Each distinct
+ *						 value is stored once with the ascending list of rows that include it,
+ *						 and each tag is its own value.  Because search words never include
+ *						 spaces, a word matches the combined text of a reference only when it
+ *						 matches one of these values.
+ *			 trigrams:	 every three-byte sequence of a lowercased value maps to the ascending
+ *						 list of values that include it, so the candidates for a word are the
+ *						 intersection of the lists for its trigrams.  Candidates are always
+ *						 confirmed with the same comparison used for the scan, so this only
+ *						 narrows the search.  Words that are short or non-ASCII, and values
+ *						 whose case-insensitive form isn't their lowercased form, skip the
+ *						 trigrams and are always compared.
+ *			 years:		 rows are sorted by their begin and end dates so the rows that
+ *						 overlap a year are the smaller of two binary-searched ranges,
+ *						 filtered by the other date.
+ *
+ *			 The rows for each word are a union across the columns, then words are intersected
+ *			 smallest first for AND-matching or combined for OR-matching.
+ */
+
+/*
+ *  An index of the text and dates of an object list for filtering.
+ */
+final class MMSearchIndex {
+	/*
+	 *  Build the index from the references in an object list.
+	 */
+	init(_ objectList: MMObjectIndex.ObjectList) {
+		let rowCount = objectList.count
+		var builders = [ColumnBuilder](repeating: .init(), count: Column.allCases.count)
+		var begins	 = [Int32](repeating: 0, count: rowCount)
+		var ends	 = [Int32](repeating: 0, count: rowCount)
+		
+		// - each reference is decoded once without being retained by the list.
+		for i in 0..<rowCount {
+			let ref = objectList.transientRef(at: i)
+			let row = UInt32(i)
+			builders[Column.accessionNumber.rawValue].add(ref.accessionNumber, row: row)
+			builders[Column.department.rawValue].add(ref.department, row: row)
+			builders[Column.objectName.rawValue].add(ref.objectName, row: row)
+			builders[Column.title.rawValue].add(ref.title, row: row)
+			builders[Column.culture.rawValue].add(ref.culture, row: row)
+			builders[Column.medium.rawValue].add(ref.medium, row: row)
+			for (t, tag) in ref.tags.enumerated() where !ref.tags[..<t].contains(tag) {
+				builders[Column.tags.rawValue].add(tag, row: row)
+			}
+			builders[Column.artistDisplayName.rawValue].add(ref.artistDisplayName, row: row)
+			builders[Column.artistDisplayBio.rawValue].add(ref.artistDisplayBio, row: row)
+			begins[i] = Int32(clamping: ref.objectBeginDate)
+			ends[i]	  = Int32(clamping: ref.objectEndDate)
+		}
+		
+		// - the trigrams are the expensive part and each column is independent.
+		var columns = [ColumnIndex?](repeating: nil, count: builders.count)
+		columns.withUnsafeMutableBufferPointer { cBuf in
+			DispatchQueue.concurrentPerform(iterations: builders.count) { i in
+				cBuf[i] = ColumnIndex(builders[i])
+			}
+		}
+		
+		self.rowCount = rowCount
+		self.columns  = columns.compactMap({ $0 })
+		self.years	  = .init(begins: begins, ends: ends)
+	}
+	
+	// - the number of rows that were indexed.
+	let rowCount: Int
+	
+	/*
+	 *  Return the ascending offsets of the rows that match the criteria.
+	 *  - the result is abandoned and empty when the task is cancelled.
+	 */
+	func offsets(matching criteria: MMFilterCriteria) -> [Int] {
+		var lists: [[UInt32]] = []
+		if let cYear = criteria.creationYear {
+			lists.append(years.rows(overlapping: cYear))
+		}
+		
+		if let sValue = criteria.searchText?.trimmingCharacters(in: .whitespacesAndNewlines), !sValue.isEmpty {
+			var words: [[UInt32]] = []
+			var found: Set<Substring> = []
+			for word in sValue.split(separator: " ") where found.insert(word).inserted {
+				if Task.isCancelled { return [] }
+				let wRows = rows(matching: word)
+				
+				// - when using AND-notation, a missing word means nothing qualifies.
+				if wRows.isEmpty && criteria.matchingRule == .andMatch { return [] }
+				words.append(wRows)
+			}
+			
+			switch criteria.matchingRule {
+			case .andMatch:
+				lists.append(contentsOf: words)
+			
+			case .orMatch:
+				var union = RowSet(count: rowCount)
+				for oneList in words {
+					union.insert(contentsOf: oneList[...])
+				}
+				lists.append(union.rows)
+			}
+		}
+		
+		// ...intersect from the smallest list so that each pass is bounded by it.
+		guard !lists.isEmpty else { return Array(0..<rowCount) }
+		lists.sort(by: { $0.count < $1.count })
+		var ret = lists[0]
+		for oneList in lists.dropFirst() {
+			if ret.isEmpty { break }
+			ret = Self.intersect(ret, oneList)
+		}
+		return ret.map({ Int($0) })
+	}
+	
+	// - internal
+	private let columns: [ColumnIndex]
+	private let years: YearColumn
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMSearchIndex {
+	// - the matched fields of a reference.
+	fileprivate enum Column : Int, CaseIterable {
+		case accessionNumber
+		case department
+		case objectName
+		case title
+		case culture
+		case medium
+		case tags
+		case artistDisplayName
+		case artistDisplayBio
+	}
+	
+	// - the values of one column as they are collected.
+	fileprivate struct ColumnBuilder {
+		var valueIds: [String : UInt32] = [:]
+		var values: [String]			= []
+		var entryValues: [UInt32]		= []
+		var entryRows: [UInt32]			= []
+		
+		/*
+		 *  Record that a row includes a value.
+		 */
+		mutating func add(_ value: String?, row: UInt32) {
+			guard let value = value, !value.isEmpty else { return }
+			let vid: UInt32
+			if let existing = valueIds[value] {
+				vid = existing
+			}
+			else {
+				vid				= UInt32(values.count)
+				valueIds[value] = vid
+				values.append(value)
+			}
+			entryValues.append(vid)
+			entryRows.append(row)
+		}
+	}
+	
+	// - the indexed values of one column.
+	fileprivate struct ColumnIndex {
+		let values: [String]
+		let rowStarts: [UInt32]					// - per value, with one extra for the end
+		let rowPostings: [UInt32]
+		let trigrams: [UInt32 : [UInt32]]		// - trigram to ascending value ids
+		let unfolded: [UInt32]					// - values that must always be compared
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(_ builder: ColumnBuilder) {
+			// - group the rows by value, which keeps them ascending because
+			//   they were recorded in row order.
+			var starts = [UInt32](repeating: 0, count: builder.values.count + 1)
+			for vid in builder.entryValues {
+				starts[Int(vid) + 1] += 1
+			}
+			for i in 1..<starts.count {
+				starts[i] += starts[i - 1]
+			}
+			var fill	 = starts
+			var postings = [UInt32](repeating: 0, count: builder.entryValues.count)
+			for (i, vid) in builder.entryValues.enumerated() {
+				postings[Int(fill[Int(vid)])] = builder.entryRows[i]
+				fill[Int(vid)] += 1
+			}
+			
+			var trigrams: [UInt32 : [UInt32]] = [:]
+			var unfolded: [UInt32]			  = []
+			var vTrigrams: [UInt32]			  = []
+			for (i, value) in builder.values.enumerated() {
+				guard let key = MMSearchIndex.trigramKey(for: value) else {
+					unfolded.append(UInt32(i))
+					continue
+				}
+				MMSearchIndex.trigrams(of: key, into: &vTrigrams)
+				for t in vTrigrams {
+					trigrams[t, default: []].append(UInt32(i))
+				}
+			}
+			
+			self.values		 = builder.values
+			self.rowStarts	 = starts
+			self.rowPostings = postings
+			self.trigrams	 = trigrams
+			self.unfolded	 = unfolded
+		}
+		
+		/*
+		 *  Add the rows of every value that includes the word.
+		 */
+		func addRows(matching word: Substring, trigrams wTrigrams: [UInt32]?, to rows: inout RowSet) {
+			func addValue(_ vid: Int) {
+				guard values[vid].localizedCaseInsensitiveContains(word) else { return }
+				rows.insert(contentsOf: rowPostings[Int(rowStarts[vid])..<Int(rowStarts[vid + 1])])
+			}
+			
+			// - without trigrams, every value is a candidate.
+			guard let wTrigrams = wTrigrams else {
+				for vid in 0..<values.count {
+					addValue(vid)
+				}
+				return
+			}
+			
+			var lists: [[UInt32]] = []
+			for t in wTrigrams {
+				guard let oneList = trigrams[t] else {
+					lists = []
+					break
+				}
+				lists.append(oneList)
+			}
+			if !lists.isEmpty {
+				lists.sort(by: { $0.count < $1.count })
+				var candidates = lists[0]
+				for oneList in lists.dropFirst() {
+					if candidates.isEmpty { break }
+					candidates = MMSearchIndex.intersect(candidates, oneList)
+				}
+				for vid in candidates {
+					addValue(Int(vid))
+				}
+			}
+			for vid in unfolded {
+				addValue(Int(vid))
+			}
+		}
+	}
+	
+	// - the creation dates of every row.
+	fileprivate struct YearColumn {
+		let begins: [Int32]
+		let ends: [Int32]
+		let byBegin: [UInt32]
+		let byEnd: [UInt32]
+		
+		/*
+		 *  Initialize the object.
+		 */
+		init(begins: [Int32], ends: [Int32]) {
+			self.begins	 = begins
+			self.ends	 = ends
+			self.byBegin = (0..<UInt32(begins.count)).sorted(by: { begins[Int($0)] < begins[Int($1)] })
+			self.byEnd	 = (0..<UInt32(ends.count)).sorted(by: { ends[Int($0)] < ends[Int($1)] })
+		}
+		
+		/*
+		 *  Return the ascending rows that were created during the year.
+		 */
+		func rows(overlapping year: Int) -> [UInt32] {
+			let year = Int32(clamping: year)
+			
+			// - the rows that begin in or before the year are a prefix of one list and
+			//   the rows that end in or after it are a suffix of the other.
+			let nBegin	= Self.partition(byBegin, where: { begins[Int($0)] > year })
+			let endFrom = Self.partition(byEnd, where: { ends[Int($0)] >= year })
+			var ret		= RowSet(count: begins.count)
+			if nBegin <= byEnd.count - endFrom {
+				for row in byBegin[..<nBegin] where ends[Int(row)] >= year {
+					ret.insert(row)
+				}
+			}
+			else {
+				for row in byEnd[endFrom...] where begins[Int(row)] <= year {
+					ret.insert(row)
+				}
+			}
+			return ret.rows
+		}
+		
+		/*
+		 *  Return the first position in a list where the predicate is true, assuming
+		 *  it is true for every position after that.
+		 */
+		private static func partition(_ list: [UInt32], where predicate: (UInt32) -> Bool) -> Int {
+			var low  = 0
+			var high = list.count
+			while low < high {
+				let mid = (low + high) / 2
+				if predicate(list[mid]) {
+					high = mid
+				}
+				else {
+					low = mid + 1
+				}
+			}
+			return low
+		}
+	}
+	
+	// - a set of rows that is built in any order and read in ascending order.
+	fileprivate struct RowSet {
+		/*
+		 *  Initialize the object.
+		 */
+		init(count: Int) {
+			self.bits = .init(repeating: 0, count: (count + 63) / 64)
+		}
+		
+		/*
+		 *  Add a row.
+		 */
+		mutating func insert(_ row: UInt32) {
+			bits[Int(row >> 6)] |= 1 << UInt64(row & 63)
+		}
+		
+		/*
+		 *  Add a list of rows.
+		 */
+		mutating func insert(contentsOf rows: ArraySlice<UInt32>) {
+			bits.withUnsafeMutableBufferPointer { bBuf in
+				for row in rows {
+					bBuf[Int(row >> 6)] |= 1 << UInt64(row & 63)
+				}
+			}
+		}
+		
+		// - the rows in ascending order.
+		var rows: [UInt32] {
+			var ret: [UInt32] = []
+			ret.reserveCapacity(bits.reduce(0, { $0 + $1.nonzeroBitCount }))
+			for (i, oneWord) in bits.enumerated() {
+				var word = oneWord
+				while word != 0 {
+					ret.append(UInt32(i << 6 + word.trailingZeroBitCount))
+					word &= word - 1
+				}
+			}
+			return ret
+		}
+		
+		private var bits: [UInt64]
+	}
+	
+	/*
+	 *  Return the ascending rows with a value that matches the word in any column.
+	 */
+	private func rows(matching word: Substring) -> [UInt32] {
+		let wTrigrams = Self.trigrams(ofWord: word)
+		var ret		  = RowSet(count: rowCount)
+		for oneColumn in columns {
+			oneColumn.addRows(matching: word, trigrams: wTrigrams, to: &ret)
+		}
+		return ret.rows
+	}
+	
+	/*
+	 *  Return the lowercased form of a value when its trigrams can be used to find
+	 *  every word it may include.
+	 */
+	private static func trigramKey(for value: String) -> String? {
+		let lower = value.lowercased()
+		if value.utf8.allSatisfy({ $0 < 0x80 }) {
+			return lower
+		}
+		
+		// - case-insensitive comparison folds some characters differently than
+		//   lowercasing them (ß, ligatures, dotted I) and ignores others.
+		let key = lower.precomposedStringWithCanonicalMapping
+		guard lower == value.folding(options: .caseInsensitive, locale: nil),
+			  key.unicodeScalars.count == value.precomposedStringWithCanonicalMapping.unicodeScalars.count,
+			  !key.unicodeScalars.contains(where: { $0.properties.generalCategory == .format }) else {
+			return nil
+		}
+		return key
+	}
+	
+	/*
+	 *  Return the trigrams to search for a word or `nil` when they can't be used.
+	 */
+	private static func trigrams(ofWord word: Substring) -> [UInt32]? {
+		guard word.utf8.count >= 3, word.utf8.allSatisfy({ $0 < 0x80 }) else { return nil }
+		
+		// ...the current locale may not lowercase letters the same way (Turkish 'I')
+		let lower = word.lowercased()
+		guard lower == word.lowercased(with: .current) else { return nil }
+		var ret: [UInt32] = []
+		trigrams(of: lower, into: &ret)
+		return ret
+	}
+	
+	/*
+	 *  Compute the distinct, packed byte trigrams of the text.
+	 */
+	private static func trigrams(of text: String, into trigrams: inout [UInt32]) {
+		trigrams.removeAll(keepingCapacity: true)
+		var packed: UInt32 = 0
+		for (i, byte) in text.utf8.enumerated() {
+			packed = ((packed << 8) | UInt32(byte)) & 0xFFFFFF
+			if i >= 2 {
+				trigrams.append(packed)
+			}
+		}
+		trigrams.sort()
+		var last: UInt32? = nil
+		trigrams.removeAll(where: { t in
+			defer { last = t }
+			return t == last
+		})
+	}
+	
+	/*
+	 *  Intersect two ascending lists.
+	 */
+	private static func intersect(_ lhs: [UInt32], _ rhs: [UInt32]) -> [UInt32] {
+		let (small, large) = lhs.count <= rhs.count ? (lhs, rhs) : (rhs, lhs)
+		var ret: [UInt32] = []
+		ret.reserveCapacity(small.count)
+		
+		// - when the sizes are very different, search the larger list instead of
+		//   walking it.
+		if small.count * 16 < large.count {
+			var low = 0
+			for value in small {
+				var high = large.count
+				while low < high {
+					let mid = (low + high) / 2
+					if large[mid] < value {
+						low = mid + 1
+					}
+					else {
+						high = mid
+					}
+				}
+				if low == large.count { break }
+				if large[low] == value {
+					ret.append(value)
+				}
+			}
+			return ret
+		}
+		
+		var i = 0, j = 0
+		while i < small.count && j < large.count {
+			if small[i] < large[j] {
+				i += 1
+			}
+			else if small[i] > large[j] {
+				j += 1
+			}
+			else {
+				ret.append(small[i])
+				i += 1
+				j += 1
+			}
+		}
+		return ret
+	}
+}
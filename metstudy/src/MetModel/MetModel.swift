@@ -20,6 +20,17 @@ public class MetModel {
 	public static func readIndex(from url: URL, receivingStatus: MMObjectIndex.StatusCallback? = nil) async throws -> MMObjectIndex {
 		return try await MMObjectIndex.read(from: url, receivingStatus: receivingStatus)
 	}
+	
+	///  Open an index that was saved with `MMObjectIndex.write(to:)`.  The file
+	///  is mapped and its exhibit references are decoded only when accessed.
+	public static func openIndex(at url: URL) throws -> MMObjectIndex {
+		return try MMObjectIndex.open(at: url)
+	}
+	
+	///  Open an index from the data returned by `MMObjectIndex.binaryEncoding()`.
+	public static func openIndex(from data: Data) throws -> MMObjectIndex {
+		return try MMObjectIndex.open(from: data)
+	}
 		
 	/// An index that can be used for UI design or testing  containing a constant-sized list of sample exhibits.
 	public static let samplingIndex: MMObjectIndex = MMObjectIndex.createSamplingIndex()
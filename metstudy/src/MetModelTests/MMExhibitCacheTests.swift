@@ -0,0 +1,251 @@
+//
+//  MMExhibitCacheTests.swift
+//  MetModelTests
+// 
+//  Created on 3/22/24
+//  Copyright © 2024 Francis Grolemund.  All rights reserved. 
+//
+
+import XCTest
+import AppKit
+@testable import MetModel
+
+/*
+ *  Verifies the behavior of the exhibit cache and prefetching.
+ */
+final class MMExhibitCacheTests: XCTestCase {
+	/*
+	 *  Verify that decoded images are discarded in the order they were used.
+	 */
+	func testMemoryTier() async throws {
+		let iData  = standInImageData(width: 64, height: 64)
+		let cost   = 64 * 64 * 4 + iData.count
+		let cache  = try MMExhibitCache(rootURL: try temporaryCacheURL(), memoryLimit: cost * 3 + cost / 2)
+		let urls   = (0..<4).map({ MMStandInProtocol.baseURL.appending(path: "images/memory-\($0).png") })
+		let images = await withTaskGroup(of: MMImageRef?.self) { group in
+			for _ in urls {
+				group.addTask { await MMImageRef.fromData(iData, withFileData: true) }
+			}
+			return await group.reduce(into: [MMImageRef](), { if let img = $1 { $0.append(img) } })
+		}
+		XCTAssertEqual(images.count, urls.count)
+		
+		for i in 0..<3 {
+			cache.saveImage(images[i], for: urls[i])
+		}
+		XCTAssertNotNil(cache.image(for: urls[0]))
+		
+		// - the least recently used makes room for the new one.
+		cache.saveImage(images[3], for: urls[3])
+		XCTAssertNotNil(cache.image(for: urls[0]))
+		XCTAssertNil(cache.image(for: urls[1]))
+		XCTAssertNotNil(cache.image(for: urls[2]))
+		XCTAssertNotNil(cache.image(for: urls[3]))
+		
+		let stats = cache.statistics
+		XCTAssertEqual(stats.evictions, 1)
+		XCTAssertEqual(stats.memoryHits, 4)
+	}
+	
+	/*
+	 *  Verify that the disk tier stays within its limit by discarding the least recently
+	 *  used items, and that it remembers them between instances.
+	 */
+	func testDiskEviction() throws {
+		let FileLimit: Int	  = 10_000
+		let PayloadSize: Int  = 1_000
+		let cacheURL 		  = try temporaryCacheURL()
+		let cache 	 		  = try MMExhibitCache(rootURL: cacheURL, fileLimit: FileLimit)
+		let urls 	 		  = (0..<20).map({ MMStandInProtocol.baseURL.appending(path: "images/disk-\($0).jpg") })
+		let payload			  = { (i: Int) in Data(repeating: UInt8(i), count: PayloadSize) }
+		
+		// - the first one is used all along.
+		for (i, oneURL) in urls.enumerated() {
+			try cache.saveFileData(payload(i), for: oneURL)
+			XCTAssertEqual(cache.fileData(for: urls[0]), payload(0))
+		}
+		
+		let fURL  = cacheURL.appending(path: "files")
+		let sizes = try FileManager.default.contentsOfDirectory(at: fURL, includingPropertiesForKeys: [.fileSizeKey]).map({ try $0.resourceValues(forKeys: [.fileSizeKey]).fileSize ?? 0 })
+		XCTAssertLessThanOrEqual(sizes.reduce(0, +), FileLimit)
+		XCTAssertGreaterThan(cache.statistics.evictions, 0)
+		XCTAssertNil(cache.fileData(for: urls[1]))
+		XCTAssertEqual(cache.fileData(for: urls[19]), payload(19))
+		
+		// ...another instance finds what was saved.
+		let reopened = try MMExhibitCache(rootURL: cacheURL, fileLimit: FileLimit)
+		XCTAssertEqual(reopened.fileData(for: urls[0]), payload(0))
+		XCTAssertEqual(reopened.fileData(for: urls[19]), payload(19))
+		XCTAssertNil(reopened.fileData(for: urls[1]))
+		XCTAssertEqual(reopened.statistics.diskHits, 2)
+		XCTAssertEqual(reopened.statistics.misses, 1)
+	}
+	
+	/*
+	 *  Verify that damaged and unverified files are never returned.
+	 */
+	func testIntegrityCheck() throws {
+		let cacheURL = try temporaryCacheURL()
+		let fURL	 = cacheURL.appending(path: "files")
+		let eURL	 = cacheURL.appending(path: "exhibits")
+		
+		// - files from before the cache was verified are discarded.
+		try FileManager.default.createDirectory(at: eURL, withIntermediateDirectories: true)
+		let legacyURL = eURL.appending(path: "exhibit-45734.json")
+		try Data("{}".utf8).write(to: legacyURL)
+		let cache = try MMExhibitCache(rootURL: cacheURL)
+		XCTAssertNil(cache.exhibitData(for: 45734))
+		XCTAssertFalse(FileManager.default.fileExists(atPath: legacyURL.path(percentEncoded: false)))
+		
+		// - a damaged file is discarded.
+		let iURL	= MMStandInProtocol.baseURL.appending(path: "images/damaged.jpg")
+		let payload = Data((0..<4096).map({ UInt8($0 % 251) }))
+		try cache.saveFileData(payload, for: iURL)
+		XCTAssertEqual(cache.fileData(for: iURL), payload)
+		
+		let stored	= try XCTUnwrap(FileManager.default.contentsOfDirectory(at: fURL, includingPropertiesForKeys: nil).first)
+		var damaged	= try Data(contentsOf: stored)
+		damaged[damaged.count - 100] ^= 0xFF
+		try damaged.write(to: stored)
+		XCTAssertNil(cache.fileData(for: iURL))
+		XCTAssertFalse(FileManager.default.fileExists(atPath: stored.path(percentEncoded: false)))
+		XCTAssertEqual(cache.statistics.discarded, 1)
+		
+		// ...as is one that is incomplete.
+		try cache.saveFileData(payload, for: iURL)
+		let full = try Data(contentsOf: stored)
+		try full.prefix(full.count / 2).write(to: stored)
+		XCTAssertNil(cache.fileData(for: iURL))
+		XCTAssertEqual(cache.statistics.discarded, 2)
+		
+		// - it is saved again once it is retrieved again.
+		try cache.saveFileData(payload, for: iURL)
+		XCTAssertEqual(cache.fileData(for: iURL), payload)
+	}
+	
+	/*
+	 *  Verify the window of exhibits chosen for prefetching.
+	 */
+	func testPrefetchWindow() {
+		XCTAssertEqual(MMExhibitPrefetcher.window(around: 10, count: 100, isForward: true), [11, 12, 13, 14, 15, 16, 17, 18, 9, 8])
+		XCTAssertEqual(MMExhibitPrefetcher.window(around: 10, count: 100, isForward: false), [9, 8, 7, 6, 5, 4, 3, 2, 11, 12])
+		XCTAssertEqual(MMExhibitPrefetcher.window(around: 0, count: 3, isForward: true), [1, 2])
+		XCTAssertEqual(MMExhibitPrefetcher.window(around: 2, count: 3, isForward: true), [1, 0])
+	}
+	
+	/*
+	 *  Replay a recorded browsing session against a local stand-in for the MetArt servers
+	 *  and measure the hit rate and the time to display each exhibit, with and without
+	 *  prefetching.
+	 */
+	func testBrowsingTracePerformance() async throws {
+		let trace: BrowsingTrace = try decodeJSON(try Data(contentsOf: testDataURLForFile("browsing-trace.json")))
+		let mi = try await MetModel.readIndex(from: testDataURLForFile("MetObjects-Med.csv"))
+		XCTAssertEqual(mi.count, trace.rowCount)
+		
+		// - every object has only a small image so that the time is spent on what is displayed.
+		let iData = standInImageData(width: 299, height: 623)
+		MMStandInProtocol.reset(latency: 0.05) { url in
+			let comps = url.pathComponents
+			if comps.count >= 2, comps[comps.count - 2] == "objects", let oId = MMObjectIdentifier(comps[comps.count - 1]) {
+				return (try? Self.standInObject(oId).standardMMJSONEncoding()) ?? Data()
+			}
+			return iData
+		}
+		
+		let baseline   = try await replay(trace, in: mi, prefetching: false)
+		let prefetched = try await replay(trace, in: mi, prefetching: true)
+		
+		let describe = { (result: (stats: MMExhibitCache.Statistics, latencies: [TimeInterval])) -> String in
+			let sorted = result.latencies
+			return String(format: "hit rate %.1f%% (memory %d, disk %d, miss %d), p50 %.2f ms, p90 %.2f ms, max %.2f ms",
+						  result.stats.hitRate * 100.0, result.stats.memoryHits, result.stats.diskHits, result.stats.misses,
+						  sorted[sorted.count / 2] * 1000.0, sorted[sorted.count * 9 / 10] * 1000.0, (sorted.last ?? 0) * 1000.0)
+		}
+		self.log.info("\(trace.events.count, privacy: .public) selections")
+		self.log.info("Without prefetching: \(describe(baseline), privacy: .public)")
+		self.log.info("With prefetching: \(describe(prefetched), privacy: .public)")
+		
+		XCTAssertGreaterThan(prefetched.stats.hitRate, baseline.stats.hitRate + 0.2)
+		XCTAssertLessThan(prefetched.latencies[prefetched.latencies.count / 2], baseline.latencies[baseline.latencies.count / 2])
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMExhibitCacheTests {
+	// - a browsing session as the selected rows and how long each remained selected.
+	private struct BrowsingTrace : Decodable {
+		struct Event : Decodable {
+			let row: Int
+			let dwellMs: Int
+		}
+		let rowCount: Int
+		let events: [Event]
+	}
+	
+	// - the portion of the recorded time to spend on a replay.
+	private static var TraceTimeScale: Double { 0.2 }
+	
+	/*
+	 *  Replay a trace with an empty cache, loading each selection the way the inspector does.
+	 */
+	private func replay(_ trace: BrowsingTrace, in objectIndex: MMObjectIndex, prefetching: Bool) async throws -> (stats: MMExhibitCache.Statistics, latencies: [TimeInterval]) {
+		let cacheURL = try temporaryCacheURL()
+		try objectIndex.setCacheRootDirectory(url: cacheURL)
+		objectIndex.networkClient = .init(session: MMStandInProtocol.session, apiURL: MMStandInProtocol.baseURL,
+										  rateLimiter: .init(requestsPerSecond: MMRateLimiter.MetArtLimit / 2))
+		let collection = try await objectIndex.filtered(by: nil)
+		
+		var latencies: [TimeInterval] = []
+		for oneEvent in trace.events {
+			let start = Date()
+			if prefetching {
+				collection.prefetchExhibits(around: oneEvent.row)
+			}
+			let exhibit = try await objectIndex.exhibit(from: collection[oneEvent.row]).get()
+			let image	= await exhibit.primaryImageSmall
+			XCTAssertNotNil(image)
+			let latency = Date().timeIntervalSince(start)
+			latencies.append(latency)
+			
+			// ...the user looks at it for a while.
+			let dwell = Double(oneEvent.dwellMs) / 1000.0 * Self.TraceTimeScale
+			if dwell > latency {
+				try await Task.sleep(for: .seconds(dwell - latency))
+			}
+		}
+		objectIndex.prefetcher.cancel()
+		return (try XCTUnwrap(objectIndex.exhibitCache?.statistics), latencies.sorted())
+	}
+	
+	/*
+	 *  Return a new, empty cache directory.
+	 */
+	private func temporaryCacheURL() throws -> URL {
+		let ret = FileManager.default.temporaryDirectory.appending(path: "MMExhibitCache-\(UUID().uuidString)")
+		try FileManager.default.createDirectory(at: ret, withIntermediateDirectories: true)
+		addTeardownBlock {
+			try? FileManager.default.removeItem(at: ret)
+		}
+		return ret
+	}
+	
+	/*
+	 *  Return the encoded data of a generated image.
+	 */
+	private func standInImageData(width: Int, height: Int) -> Data {
+		let rep = NSBitmapImageRep(bitmapDataPlanes: nil, pixelsWide: width, pixelsHigh: height, bitsPerSample: 8, samplesPerPixel: 4,
+								   hasAlpha: true, isPlanar: false, colorSpaceName: .deviceRGB, bytesPerRow: 0, bitsPerPixel: 0)
+		return rep?.representation(using: .png, properties: [:]) ?? Data()
+	}
+	
+	/*
+	 *  Return an object as the MetArt API describes it.
+	 */
+	private static func standInObject(_ objectID: MMObjectIdentifier) -> MMObject {
+		let pSmall = MMStandInProtocol.baseURL.appending(path: "images/\(objectID)-small.png").absoluteString
+		return MMObject(objectID: objectID, isHighlight: false, accessionNumber: "\(objectID)", accessionYear: "1936", isPublicDomain: true, primaryImage: "", primaryImageSmall: pSmall, additionalImages: [], constituents: nil, department: "Asian Art", objectName: "Hanging scroll", title: "Stand-in \(objectID)", culture: "Japan", period: "", dynasty: "", reign: "", portfolio: "", artistRole: "", artistPrefix: "", artistDisplayName: "", artistDisplayBio: "", artistSuffix: "", artistAlphaSort: "", artistNationality: "", artistBeginDate: "", artistEndDate: "", artistGender: "", artistWikidata_URL: "", artistULAN_URL: "", objectDate: "late 17th century", objectBeginDate: 1667, objectEndDate: 1682, medium: "Hanging scroll; ink and color on silk", dimensions: "", measurements: nil, creditLine: "", geographyType: "", city: "", state: "", county: "", country: "", region: "", subregion: "", locale: "", locus: "", excavation: "", river: "", classification: "Paintings", rightsAndReproduction: "", linkResource: "", metadataDate: "2022-10-20T04:55:06.267Z", repository: "Metropolitan Museum of Art, New York, NY", objectURL: "https://www.metmuseum.org/art/collection/search/\(objectID)", tags: nil, objectWikidata_URL: "", isTimelineWork: false, GalleryNumber: "")
+	}
+}
@@ -36,4 +36,149 @@ final class MMNetworkClientTests: XCTestCase {
 		let pData	= await exhibit?.primaryImage
 		XCTAssertNotNil(pData)
 	}
+	
+	/*
+	 *  Verify that identical requests in progress are sent only once.
+	 */
+	func testCoalescedRequests() async throws {
+		let nc	 = MMNetworkClient(session: MMStandInProtocol.session, apiURL: MMStandInProtocol.baseURL,
+								   rateLimiter: .init(requestsPerSecond: 1000, burst: 100))
+		let fURL = MMStandInProtocol.baseURL.appending(path: "images/coalesced.jpg")
+		MMStandInProtocol.reset(latency: 0.1)
+		
+		// - many callers for the same image.
+		let results = await withTaskGroup(of: Data?.self) { group in
+			for _ in 0..<20 {
+				group.addTask { try? await nc.queryMetArtFile(atURL: fURL).get() }
+			}
+			return await group.reduce(into: [Data?](), { $0.append($1) })
+		}
+		XCTAssertEqual(results.count, 20)
+		XCTAssertTrue(results.allSatisfy({ $0 == MMStandInProtocol.body(for: fURL) }))
+		XCTAssertEqual(MMStandInProtocol.requestCount(for: fURL), 1)
+		
+		// ...and the same object, which the stand-in doesn't describe correctly.
+		let oURL = MMStandInProtocol.baseURL.appending(path: "objects/2")
+		let objs = await withTaskGroup(of: Bool.self) { group in
+			for _ in 0..<5 {
+				group.addTask { (try? await nc.queryMetArtObject(identifiedBy: 2).get()) != nil }
+			}
+			return await group.reduce(into: [Bool](), { $0.append($1) })
+		}
+		XCTAssertEqual(objs, .init(repeating: false, count: 5))
+		XCTAssertEqual(MMStandInProtocol.requestCount(for: oURL), 1)
+		
+		// - cancelling one caller doesn't affect the others.
+		let gURL	= MMStandInProtocol.baseURL.appending(path: "images/shared.jpg")
+		let first	= Task { await nc.queryMetArtFile(atURL: gURL) }
+		let second	= Task { await nc.queryMetArtFile(atURL: gURL) }
+		try await Task.sleep(for: .milliseconds(20))
+		first.cancel()
+		let sData = try await second.value.get()
+		XCTAssertEqual(sData, MMStandInProtocol.body(for: gURL))
+		XCTAssertEqual(MMStandInProtocol.requestCount(for: gURL), 1)
+		_ = await first.value
+		
+		// ...once it is complete, it is requested again.
+		_ = try await nc.queryMetArtFile(atURL: gURL).get()
+		XCTAssertEqual(MMStandInProtocol.requestCount(for: gURL), 2)
+	}
+	
+	/*
+	 *  Verify that a visible caller that joins a prefetch request doesn't wait behind the
+	 *  prefetch lane.
+	 */
+	func testPromotedRequest() async throws {
+		let nc	 = MMNetworkClient(session: MMStandInProtocol.session, apiURL: MMStandInProtocol.baseURL,
+								   rateLimiter: .init(requestsPerSecond: 10, burst: 1))
+		let tURL = MMStandInProtocol.baseURL.appending(path: "images/promoted.jpg")
+		MMStandInProtocol.reset(latency: 0.01)
+		
+		// - two seconds of prefetching, followed by the image that is about to be displayed.
+		var backlog: [Task<MMNetworkClient.MetArtFileResult, Never>] = []
+		for i in 0..<20 {
+			backlog.append(Task { await nc.queryMetArtFile(atURL: MMStandInProtocol.baseURL.appending(path: "images/backlog-\(i).jpg"), lane: .prefetch) })
+		}
+		try await Task.sleep(for: .milliseconds(50))
+		let prefetch = Task { await nc.queryMetArtFile(atURL: tURL, lane: .prefetch) }
+		try await Task.sleep(for: .milliseconds(50))
+		
+		// - once it is displayed, it arrives long before the prefetching is done.
+		let start = Date()
+		let vData = try await nc.queryMetArtFile(atURL: tURL, lane: .visible).get()
+		XCTAssertLessThan(Date().timeIntervalSince(start), 0.5)
+		XCTAssertEqual(vData, MMStandInProtocol.body(for: tURL))
+		let pData = try await prefetch.value.get()
+		XCTAssertEqual(pData, vData)
+		XCTAssertEqual(MMStandInProtocol.requestCount(for: tURL), 1)
+		backlog.forEach({ $0.cancel() })
+	}
+	
+	/*
+	 *  Measure the achieved request rate and the latency of each lane against a local
+	 *  stand-in for the MetArt servers.
+	 */
+	func testStandInThroughput() async throws {
+		let RequestsPerSecond: UInt = 80
+		let Burst: UInt				= 8
+		let NumPrefetch: Int		= 160
+		let NumVisible: Int			= 40
+		let nc = MMNetworkClient(session: MMStandInProtocol.session, apiURL: MMStandInProtocol.baseURL,
+								 rateLimiter: .init(requestsPerSecond: RequestsPerSecond, burst: Burst))
+		MMStandInProtocol.reset(latency: 0.02)
+		
+		// - a long prefetch is interrupted by content that is displayed.
+		let start = Date()
+		let (prefetch, visible) = await withTaskGroup(of: (isVisible: Bool, latency: TimeInterval).self) { group in
+			for i in 0..<NumPrefetch {
+				group.addTask {
+					let rStart = Date()
+					_ = await nc.queryMetArtFile(atURL: MMStandInProtocol.baseURL.appending(path: "images/prefetch-\(i).jpg"), lane: .prefetch)
+					return (false, Date().timeIntervalSince(rStart))
+				}
+			}
+			try? await Task.sleep(for: .milliseconds(500))
+			for i in 0..<NumVisible {
+				group.addTask {
+					let rStart = Date()
+					_ = await nc.queryMetArtFile(atURL: MMStandInProtocol.baseURL.appending(path: "images/visible-\(i).jpg"), lane: .visible)
+					return (true, Date().timeIntervalSince(rStart))
+				}
+			}
+			var prefetch: [TimeInterval] = []
+			var visible: [TimeInterval]	 = []
+			for await result in group {
+				if result.isVisible {
+					visible.append(result.latency)
+				}
+				else {
+					prefetch.append(result.latency)
+				}
+			}
+			return (prefetch.sorted(), visible.sorted())
+		}
+		let elapsed = Date().timeIntervalSince(start)
+		
+		// - the stand-in saw every request and never more than the limit allows.
+		let arrivals = MMStandInProtocol.arrivalTimes
+		XCTAssertEqual(arrivals.count, NumPrefetch + NumVisible)
+		let achieved = Double(arrivals.count) / elapsed
+		var maxInSecond = 0
+		var first		= 0
+		for i in 0..<arrivals.count {
+			while arrivals[i] - arrivals[first] >= 1.0 {
+				first += 1
+			}
+			maxInSecond = Swift.max(maxInSecond, i - first + 1)
+		}
+		XCTAssertLessThanOrEqual(maxInSecond, Int(RequestsPerSecond + Burst) + 2)
+		XCTAssertGreaterThan(achieved, Double(RequestsPerSecond) * 0.8)
+		
+		// ...and visible content didn't wait behind the prefetch.
+		let percentile = { (sorted: [TimeInterval], p: Double) -> TimeInterval in sorted[Swift.min(Int(Double(sorted.count) * p), sorted.count - 1)] }
+		XCTAssertLessThan(percentile(visible, 0.99), percentile(prefetch, 0.5))
+		self.log.info("Achieved \(achieved, privacy: .public) rps (limit \(RequestsPerSecond, privacy: .public)), busiest second \(maxInSecond, privacy: .public)")
+		self.log.info("Visible latency p50 \(percentile(visible, 0.5) * 1000.0, privacy: .public) ms, p99 \(percentile(visible, 0.99) * 1000.0, privacy: .public) ms")
+		self.log.info("Prefetch latency p50 \(percentile(prefetch, 0.5) * 1000.0, privacy: .public) ms, p99 \(percentile(prefetch, 0.99) * 1000.0, privacy: .public) ms")
+	}
 }
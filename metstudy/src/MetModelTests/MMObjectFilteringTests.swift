@@ -7,7 +7,7 @@
 //
 
 import XCTest
-import MetModel
+@testable import MetModel
 
 /*
  *  Verifies the behavior while filtering an object index.
@@ -140,4 +140,214 @@ final class MMObjectFilteringTests: XCTestCase {
 			wait(for: [exp])
 		}
 	}
+	
+	/*
+	 *  Verify the search index returns exactly what checking every reference returns.
+	 */
+	func testIndexMatchesScan() async throws {
+		self.log.info("Parsing the medium index file.")
+		let mmURL = testDataURLForFile("MetObjects-Med.csv")
+		let mmIdx = try await MetModel.readIndex(from: mmURL)
+		
+		let criteria: [MMFilterCriteria] = [
+			.init(searchText: "pressed"),
+			.init(searchText: "PRESSED glass"),
+			.init(searchText: "  glass   Pressed  "),
+			.init(searchText: "gl ass"),
+			.init(searchText: "a"),
+			.init(searchText: "18"),
+			.init(searchText: "1901"),
+			.init(searchText: "the of"),
+			.init(searchText: "silver gold", matchingRule: .orMatch),
+			.init(searchText: "silver gold", matchingRule: .andMatch),
+			.init(searchText: "Liège"),
+			.init(searchText: "–1869"),
+			.init(searchText: "zzzqqq"),
+			.init(searchText: "zzzqqq silver", matchingRule: .orMatch),
+			.init(creationYear: 1850),
+			.init(creationYear: -500),
+			.init(searchText: "wood", creationYear: 1800),
+			.init(searchText: "ab", creationYear: 1900),
+			.init(searchText: "coin medal", matchingRule: .orMatch, creationYear: 1900)
+		]
+		for oneCriteria in criteria {
+			let indexed = try await mmIdx.filtered(by: oneCriteria)
+			let scanned = mmIdx.scanned(by: oneCriteria)
+			XCTAssertEqual(indexed.context._offsets, scanned, "\(oneCriteria)")
+		}
+	}
+	
+	/*
+	 *  Compare the latency of the search index against checking every reference.
+	 */
+	func testIndexedSearchPerformance() async throws {
+		let NumRows: Int = 100_000
+		let sfURL		 = FileManager.default.temporaryDirectory.appending(path: "MetObjects-Synthetic-\(UUID().uuidString).csv")
+		defer {
+			try? FileManager.default.removeItem(at: sfURL)
+		}
+		self.log.info("Generating \(NumRows, privacy: .public) synthetic rows...")
+		try writeSyntheticIndex(rows: NumRows, to: sfURL)
+		let mi = try await MetModel.readIndex(from: sfURL)
+		
+		var start = Date()
+		_ = await mi.searchIndex()
+		self.log.info("Built the search index in \(Date().timeIntervalSince(start), privacy: .public)s")
+		
+		// ...a mix of selective, common, short and dated queries.
+		let criteria: [MMFilterCriteria] = [
+			.init(searchText: "object 4217"),
+			.init(searchText: "maker 42", matchingRule: .orMatch),
+			.init(searchText: "gold coin eagles"),
+			.init(searchText: "ob"),
+			.init(searchText: "sample", creationYear: 1750),
+			.init(creationYear: 1620)
+		]
+		var indexedTotal: TimeInterval = 0
+		var scannedTotal: TimeInterval = 0
+		for oneCriteria in criteria {
+			start			= Date()
+			let indexed		= try await mi.filtered(by: oneCriteria)
+			let iElapsed	= Date().timeIntervalSince(start)
+			
+			start			= Date()
+			let scanned		= mi.scanned(by: oneCriteria)
+			let sElapsed	= Date().timeIntervalSince(start)
+			
+			XCTAssertEqual(indexed.context._offsets, scanned)
+			indexedTotal += iElapsed
+			scannedTotal += sElapsed
+			self.log.info("'\(oneCriteria.searchText ?? "", privacy: .public)' (\(oneCriteria.creationYear ?? 0, privacy: .public)): \(scanned.count, privacy: .public) rows, indexed \(iElapsed * 1000.0, privacy: .public) ms, scanned \(sElapsed * 1000.0, privacy: .public) ms")
+		}
+		self.log.info("Indexed: \(indexedTotal * 1000.0, privacy: .public) ms, scanned: \(scannedTotal * 1000.0, privacy: .public) ms")
+		XCTAssertLessThan(indexedTotal, scannedTotal)
+	}
+	
+	/*
+	 *  Verify that criteria which narrow a recent result are filtered within it.
+	 */
+	func testFilterRefinement() async throws {
+		self.log.info("Parsing the medium index file.")
+		let mmURL = testDataURLForFile("MetObjects-Med.csv")
+		let mmIdx = try await MetModel.readIndex(from: mmURL)
+		
+		// - typing, backspacing and changing the other criteria.
+		let session: [(criteria: MMFilterCriteria, expected: String)] = [
+			(.init(searchText: "pre"), "indexed"),
+			(.init(searchText: "pres"), "refined"),
+			(.init(searchText: "pressed"), "refined"),
+			(.init(searchText: "pressed g"), "refined"),
+			(.init(searchText: "pressed gl"), "refined"),
+			(.init(searchText: "pressed g"), "cached"),
+			(.init(searchText: "pressed g", matchingRule: .orMatch), "indexed"),
+			(.init(searchText: "pressed g", creationYear: 1880), "refined"),
+			(.init(searchText: "PRESSED"), "refined"),
+			(.init(searchText: "silver"), "indexed"),
+			(.init(searchText: "silver pressed", matchingRule: .orMatch), "indexed"),
+			(.init(searchText: "silver pressed", matchingRule: .andMatch), "refined"),
+			(.init(creationYear: 1880), "indexed"),
+			(.init(searchText: "pre", creationYear: 1880), "refined")
+		]
+		for (criteria, expected) in session {
+			let res = try await mmIdx.filtered(by: criteria)
+			XCTAssertEqual(res.context._offsets, mmIdx.scanned(by: criteria), "\(criteria)")
+			
+			let evaluation: String
+			switch mmIdx.filterEngine.lastEvaluation {
+			case .cached:		evaluation = "cached"
+			case .refined:		evaluation = "refined"
+			case .indexed:		evaluation = "indexed"
+			case .none:			evaluation = "none"
+			}
+			XCTAssertEqual(evaluation, expected, "\(criteria)")
+		}
+	}
+	
+	/*
+	 *  Verify that a newer request cancels an older one and that nothing partial is remembered.
+	 */
+	func testSupersededFilter() async throws {
+		self.log.info("Parsing the medium index file.")
+		let mmURL = testDataURLForFile("MetObjects-Med.csv")
+		let mmIdx = try await MetModel.readIndex(from: mmURL)
+		_ = await mmIdx.searchIndex()
+		
+		let first  = MMFilterCriteria(searchText: "a e", matchingRule: .orMatch)
+		let second = MMFilterCriteria(searchText: "silver")
+		let stale  = Task { try await mmIdx.filtered(by: first) }
+		let cancel = Task { try await mmIdx.filtered(by: .init(searchText: "o u", matchingRule: .orMatch)) }
+		cancel.cancel()
+		let latest = try await mmIdx.filtered(by: second)
+		XCTAssertEqual(latest.context._offsets, mmIdx.scanned(by: second))
+		
+		// ...the older requests either finished or were cancelled.
+		for oneTask in [stale, cancel] {
+			do {
+				_ = try await oneTask.value
+			}
+			catch MMError.cancelled {
+			}
+		}
+		
+		// ...and asking again returns a complete result.
+		let again = try await mmIdx.filtered(by: first)
+		XCTAssertEqual(again.context._offsets, mmIdx.scanned(by: first))
+	}
+	
+	/*
+	 *  Replay a typing session and measure the latency of each keystroke, with and without
+	 *  refinement.
+	 */
+	func testTypingSessionPerformance() async throws {
+		let NumRows: Int = 100_000
+		let sfURL		 = FileManager.default.temporaryDirectory.appending(path: "MetObjects-Synthetic-\(UUID().uuidString).csv")
+		defer {
+			try? FileManager.default.removeItem(at: sfURL)
+		}
+		self.log.info("Generating \(NumRows, privacy: .public) synthetic rows...")
+		try writeSyntheticIndex(rows: NumRows, to: sfURL)
+		let mi		= try await MetModel.readIndex(from: sfURL)
+		let sIndex	= await mi.searchIndex()
+		
+		// - type a phrase, making a correction along the way.
+		let Backspace: Character = "\u{8}"
+		var keystrokes: [String] = []
+		var text = ""
+		for oneKey in "sample objecr\u{8}t 42 maker" {
+			if oneKey == Backspace {
+				text.removeLast()
+			}
+			else {
+				text.append(oneKey)
+			}
+			keystrokes.append(text)
+		}
+		
+		var refinedTimes: [TimeInterval] = []
+		var indexedTimes: [TimeInterval] = []
+		for oneText in keystrokes {
+			let criteria = MMFilterCriteria(searchText: oneText)
+			var start	 = Date()
+			let res		 = try await mi.filtered(by: criteria)
+			refinedTimes.append(Date().timeIntervalSince(start))
+			
+			start 		 = Date()
+			let indexed	 = sIndex.offsets(matching: criteria)
+			indexedTimes.append(Date().timeIntervalSince(start))
+			
+			if let offsets = res.context._offsets {
+				XCTAssertEqual(offsets, indexed, oneText)
+			}
+		}
+		
+		let describe = { (times: [TimeInterval]) -> String in
+			let sorted = times.sorted()
+			return String(format: "p50 %.2f ms, p90 %.2f ms, max %.2f ms, total %.2f ms",
+						  sorted[sorted.count / 2] * 1000.0, sorted[sorted.count * 9 / 10] * 1000.0,
+						  (sorted.last ?? 0) * 1000.0, sorted.reduce(0, +) * 1000.0)
+		}
+		self.log.info("\(keystrokes.count, privacy: .public) keystrokes")
+		self.log.info("Refined: \(describe(refinedTimes), privacy: .public)")
+		self.log.info("Indexed: \(describe(indexedTimes), privacy: .public)")
+	}
 }
@@ -129,4 +129,139 @@ final class MMObjectIndexingTests: XCTestCase {
 		XCTAssertEqual(mi[1309]?.tags.contains("Birds"), true)
 		XCTAssertEqual(mi[1309]?.tags.contains("Men"), true)
 	}
+	
+	/*
+	 *  Measure the ingest rate with a synthetic file the same shape as the full index.
+	 */
+	func testIngestPerformance() async throws {
+		let NumRows: Int = 100_000		// - the published file is ~480k rows
+		let sfURL		 = FileManager.default.temporaryDirectory.appending(path: "MetObjects-Synthetic-\(UUID().uuidString).csv")
+		defer {
+			try? FileManager.default.removeItem(at: sfURL)
+		}
+		self.log.info("Generating \(NumRows, privacy: .public) synthetic rows...")
+		try writeSyntheticIndex(rows: NumRows, to: sfURL)
+		
+		self.log.info("Indexing the synthetic file...")
+		let (mi, peakBytes) = try await measurePeakFootprint { () -> MMObjectIndex in
+			let ret = try MMObjectIndex(with: sfURL)
+			try await ret.parseAndIndexFile { _ in }
+			return ret
+		}
+		
+		// ...the rate is measured separately from the index because it includes the sorting.
+		let start = Date()
+		let miRate = try MMObjectIndex(with: sfURL)
+		try await miRate.parseAndIndexFile { _ in }
+		let elapsed = Date().timeIntervalSince(start)
+		self.log.info("Indexed \(NumRows, privacy: .public) rows in \(elapsed, privacy: .public)s --> \(Double(NumRows) / elapsed, privacy: .public) rows/s, peak footprint +\(peakBytes / (1024 * 1024), privacy: .public) MB")
+		
+		// - every fifth row is not in the public domain and is skipped.
+		XCTAssertEqual(mi.count, NumRows - (NumRows + 4) / 5)
+		XCTAssertEqual(miRate.count, mi.count)
+		
+		self.log.info("Spot checking...")
+		let obj = mi.object(byID: 2)
+		XCTAssertNotNil(obj)
+		XCTAssertEqual(obj?.accessionNumber, "1901.1")
+		XCTAssertEqual(obj?.title, "Sample object 1, with a comma")
+		XCTAssertEqual(obj?.artistDisplayBio, "American, Philadelphia 1794–1869")
+		XCTAssertEqual(obj?.objectBeginDate, 1601)
+		XCTAssertEqual(obj?.tags, ["Men", "Eagles"])
+		XCTAssertNil(mi.object(byID: 1))
+		
+		// ...the multi-line rows must not disturb their neighbors.
+		let last = mi.object(byID: UInt(NumRows))
+		XCTAssertEqual(last?.linkResource, "http://www.metmuseum.org/art/collection/search/\(NumRows)")
+	}
+	
+	/*
+	 *  Verify the binary format reproduces every reference.
+	 */
+	func testBinaryFormat() async throws {
+		self.log.info("Parsing the object file.")
+		let sfURL = testDataURLForFile("MetObjects-Med.csv")
+		let miTmp = try await MetModel.readIndex(from: sfURL)
+		let mi: MMObjectIndex = try decodeJSON(try encodeJSON(miTmp))
+		
+		self.log.info("Saving and reopening the binary format...")
+		let bURL = FileManager.default.temporaryDirectory.appending(path: "\(UUID().uuidString).mmidx")
+		defer {
+			try? FileManager.default.removeItem(at: bURL)
+		}
+		try mi.write(to: bURL)
+		let miBin = try MetModel.openIndex(at: bURL)
+		XCTAssertEqual(miBin.id, mi.id)
+		XCTAssertEqual(miBin.count, mi.count)
+		
+		self.log.info("Comparing the references...")
+		for i in 0..<mi.count {
+			XCTAssertEqual(miBin[i]?.description, mi[i]?.description)
+			XCTAssertEqual(miBin.object(byID: mi[i]!.objectID)?.description, mi[i]?.description)
+		}
+		XCTAssertNil(miBin.object(byID: 0))
+		XCTAssertEqual(miBin[1309]?.tags.count, 4)
+		
+		self.log.info("Verifying corrupted data is rejected...")
+		var bData = try Data(contentsOf: bURL)
+		XCTAssertThrowsError(try MetModel.openIndex(from: bData.prefix(100)))
+		bData[4] = 99
+		XCTAssertThrowsError(try MetModel.openIndex(from: bData))
+		XCTAssertThrowsError(try MetModel.openIndex(from: Data(count: 4096)))
+		
+		// ...including a section offset too large to be an integer.
+		bData = try Data(contentsOf: bURL)
+		bData.replaceSubrange(40..<48, with: Data(repeating: 0xFF, count: 8))
+		XCTAssertThrowsError(try MetModel.openIndex(from: bData))
+	}
+	
+	/*
+	 *  Compare opening a saved index in its binary format with decoding its JSON.
+	 */
+	func testBinaryOpenPerformance() async throws {
+		let NumRows: Int = 100_000
+		let tmpDir		 = FileManager.default.temporaryDirectory.appending(path: UUID().uuidString)
+		try FileManager.default.createDirectory(at: tmpDir, withIntermediateDirectories: true)
+		defer {
+			try? FileManager.default.removeItem(at: tmpDir)
+		}
+		let sfURL = tmpDir.appending(path: "MetObjects-Synthetic.csv")
+		let jURL  = tmpDir.appending(path: "index.json")
+		let bURL  = tmpDir.appending(path: "index.mmidx")
+		self.log.info("Generating and saving \(NumRows, privacy: .public) synthetic rows...")
+		try writeSyntheticIndex(rows: NumRows, to: sfURL)
+		do {
+			let mi = try await MetModel.readIndex(from: sfURL)
+			try mi.standardMMJSONEncoding().write(to: jURL)
+			try mi.write(to: bURL)
+		}
+		let jSize = try FileManager.default.attributesOfItem(atPath: jURL.path(percentEncoded: false))[.size] as? Int ?? 0
+		let bSize = try FileManager.default.attributesOfItem(atPath: bURL.path(percentEncoded: false))[.size] as? Int ?? 0
+		
+		self.log.info("Opening the JSON encoding...")
+		var start = Date()
+		let (miJSON, jPeak) = try await measurePeakFootprint { () -> MMObjectIndex in
+			return try MMObjectIndex.standardMMJSONDecoding(of: try Data(contentsOf: jURL))
+		}
+		let jElapsed = Date().timeIntervalSince(start)
+		
+		self.log.info("Opening the binary encoding...")
+		start = Date()
+		let (miBin, bPeak) = try await measurePeakFootprint { () -> MMObjectIndex in
+			return try MetModel.openIndex(at: bURL)
+		}
+		let bElapsed = Date().timeIntervalSince(start)
+		
+		self.log.info("JSON:   \(jSize / 1024, privacy: .public) KB opened in \(jElapsed * 1000.0, privacy: .public) ms, peak footprint +\(jPeak / 1024, privacy: .public) KB")
+		self.log.info("Binary: \(bSize / 1024, privacy: .public) KB opened in \(bElapsed * 1000.0, privacy: .public) ms, peak footprint +\(bPeak / 1024, privacy: .public) KB")
+		XCTAssertEqual(miBin.count, miJSON.count)
+		XCTAssertLessThan(bElapsed, jElapsed)
+		
+		// - touching every row decodes them all, which is the worst case for the binary format.
+		start = Date()
+		for i in 0..<miBin.count {
+			XCTAssertEqual(miBin[i]?.objectID, miJSON[i]?.objectID)
+		}
+		self.log.info("Binary: decoded every row in \(Date().timeIntervalSince(start) * 1000.0, privacy: .public) ms")
+	}
 }
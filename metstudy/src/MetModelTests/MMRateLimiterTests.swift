@@ -26,7 +26,7 @@ final class MMRateLimiterTests: XCTestCase {
 		//   no less than 3 seconds total to complete this.
 		let TotalItems: Int = 31					// - must be 1 more than what is evenly divisible by the test time so that it has a final cycle.
 		let TargetTestTime: TimeInterval = 3.0
-		let rLim = MMRateLimiter(requestsPerSecond: UInt(Double(TotalItems) / TargetTestTime))
+		let rLim = MMRateLimiter(requestsPerSecond: UInt(Double(TotalItems) / TargetTestTime), burst: 1)
 		
 		// - two rounds so that
 		for _ in 0..<2 {
@@ -49,17 +49,150 @@ final class MMRateLimiterTests: XCTestCase {
 			self.log.info("Time elapsed --> \(elapsed, privacy: .public)")
 			XCTAssertTrue(elapsed >= TargetTestTime && elapsed < (TargetTestTime + 0.5))
 			
-			var sRun = await rLim.isSchedulerRunning
-			XCTAssertTrue(sRun)
-			self.log.info("Rate limiting scheduler is still online.")
-			
-			// ... ensure the scheduler runs one more time to detect the empty queue
-			try await Task.sleep(for: .milliseconds(1100))
-			
 			// ...at this point the ratelimiter's backlog should be emnpty and its scheduler paused.
-			sRun = await rLim.isSchedulerRunning
+			let sRun = await rLim.isSchedulerRunning
 			XCTAssertFalse(sRun)
 			self.log.info("Rate limiting scheduler is now offline.")
 		}
 	}
+	
+	/*
+	 *  Verify that a cancelled request stops waiting without using any capacity.
+	 */
+	func testCancelledWait() async throws {
+		let rLim = MMRateLimiter(requestsPerSecond: 2, burst: 1)
+		await rLim.waitForAccess()
+		
+		// - this would wait half a second.
+		let start  = Date()
+		let waiter = Task {
+			await rLim.waitForAccess()
+		}
+		try await Task.sleep(for: .milliseconds(50))
+		waiter.cancel()
+		await waiter.value
+		XCTAssertLessThan(Date().timeIntervalSince(start), 0.25)
+		
+		// ...the next one still gets the token the cancelled one didn't use.
+		await rLim.waitForAccess()
+		let elapsed = Date().timeIntervalSince(start)
+		XCTAssertGreaterThanOrEqual(elapsed, 0.49)
+		XCTAssertLessThan(elapsed, 0.75)
+	}
+	
+	/*
+	 *  Verify that requests are paced evenly after the initial burst.
+	 */
+	func testSmoothPacing() {
+		let grants = simulate(requestsPerSecond: 40, burst: 4, arrivals: .init(repeating: (0, .visible), count: 200)).sorted()
+		XCTAssertEqual(grants.prefix(4), [0, 0, 0, 0])
+		for i in 4..<grants.count {
+			XCTAssertEqual(grants[i] - grants[i - 1], 0.025, accuracy: 1e-6)
+		}
+		XCTAssertEqual(grants.last ?? 0, 196.0 / 40.0, accuracy: 1e-6)
+		
+		// ...no second ever has more than the rate plus the burst.
+		XCTAssertLessThanOrEqual(maxInAnySecond(grants), 44)
+		
+		// - an idle period restores the burst, but no more than the burst.
+		var arrivals: [(at: TimeInterval, lane: MMRateLimiter.Lane)] = .init(repeating: (0, .visible), count: 10)
+		arrivals += .init(repeating: (10, .visible), count: 10)
+		let later = simulate(requestsPerSecond: 40, burst: 4, arrivals: arrivals).suffix(10).sorted()
+		XCTAssertEqual(later.prefix(4), [10, 10, 10, 10])
+		XCTAssertEqual(later[4], 10.025, accuracy: 1e-6)
+	}
+	
+	/*
+	 *  Verify that visible requests are released before prefetch requests that were waiting.
+	 */
+	func testPriorityLanes() {
+		var arrivals: [(at: TimeInterval, lane: MMRateLimiter.Lane)] = .init(repeating: (0, .prefetch), count: 100)
+		arrivals += .init(repeating: (1.0, .visible), count: 10)
+		let grants = simulate(requestsPerSecond: 40, burst: 4, arrivals: arrivals)
+		
+		// - each visible request waits only for the ones ahead of it in its lane.
+		let visible = grants.suffix(10).sorted()
+		for (i, oneGrant) in visible.enumerated() {
+			XCTAssertLessThanOrEqual(oneGrant, 1.0 + Double(i + 1) * 0.025 + 1e-6)
+		}
+		
+		// ...while the prefetch requests stall.
+		let lastVisible = visible.last ?? 0
+		XCTAssertFalse(grants.prefix(100).contains(where: { $0 > 1.0 && $0 < lastVisible }))
+		XCTAssertEqual(grants.prefix(100).max() ?? 0, Double(110 - 4) / 40.0, accuracy: 1e-6)
+	}
+	
+	/*
+	 *  Verify that a promoted request is released after the visible requests already waiting,
+	 *  but before the lane it left.
+	 */
+	func testPromotion() {
+		var schedule = MMRateLimiter.Schedule<Int>(requestsPerSecond: 10, burst: 1, now: 0)
+		XCTAssertTrue(schedule.request(0, lane: .prefetch, at: 0))
+		for i in 1...5 {
+			XCTAssertFalse(schedule.request(i, lane: .prefetch, at: 0))
+		}
+		XCTAssertFalse(schedule.request(6, lane: .visible, at: 0))
+		schedule.promote(where: { $0 == 4 }, to: .visible)
+		schedule.promote(where: { $0 == 6 }, to: .visible)
+		
+		var order: [Int] = []
+		var now			 = 0.0
+		while let next = schedule.nextDispatch(at: now) {
+			now	  = next
+			order += schedule.dispatch(at: now)
+		}
+		XCTAssertEqual(order, [6, 4, 1, 2, 3, 5])
+	}
+}
+
+/*
+ *  Internal implementation.
+ */
+extension MMRateLimiterTests {
+	/*
+	 *  Drive a schedule with a simulated clock, returning the time each arrival was granted access.
+	 */
+	private func simulate(requestsPerSecond: UInt, burst: UInt, arrivals: [(at: TimeInterval, lane: MMRateLimiter.Lane)]) -> [TimeInterval] {
+		var schedule = MMRateLimiter.Schedule<Int>(requestsPerSecond: requestsPerSecond, burst: burst, now: 0)
+		var grants	 = [TimeInterval](repeating: -1, count: arrivals.count)
+		let order	 = arrivals.indices.sorted(by: { arrivals[$0].at < arrivals[$1].at || (arrivals[$0].at == arrivals[$1].at && $0 < $1) })
+		var next	 = 0
+		var now		 = 0.0
+		while next < order.count || !schedule.isEmpty {
+			let tArrive	  = next < order.count ? arrivals[order[next]].at : .infinity
+			let tDispatch = schedule.nextDispatch(at: now) ?? .infinity
+			if tArrive <= tDispatch {
+				now = Swift.max(now, tArrive)
+				let idx = order[next]
+				next += 1
+				if schedule.request(idx, lane: arrivals[idx].lane, at: now) {
+					grants[idx] = now
+				}
+			}
+			else {
+				now = Swift.max(now, tDispatch)
+				for idx in schedule.dispatch(at: now) {
+					grants[idx] = now
+				}
+			}
+		}
+		XCTAssertFalse(grants.contains(-1))
+		return grants
+	}
+	
+	/*
+	 *  Return the largest number of grants in any one second.
+	 */
+	private func maxInAnySecond(_ sorted: [TimeInterval]) -> Int {
+		var ret	  = 0
+		var first = 0
+		for i in 0..<sorted.count {
+			while sorted[i] - sorted[first] >= 1.0 - 1e-9 {
+				first += 1
+			}
+			ret = Swift.max(ret, i - first + 1)
+		}
+		return ret
+	}
 }
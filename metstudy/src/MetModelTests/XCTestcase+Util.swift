@@ -8,6 +8,7 @@
 
 import XCTest
 import OSLog
+import Darwin
 
 /*
  *  Utilities for testing.
@@ -52,4 +53,175 @@ extension XCTestCase {
 		jd.dataDecodingStrategy = .base64
 		return try jd.decode(T.self, from: item)
 	}
+	
+	/*
+	 *  Return the physical memory footprint of the process.
+	 */
+	var physicalFootprint: UInt64 {
+		var info  = task_vm_info_data_t()
+		var count = mach_msg_type_number_t(MemoryLayout<task_vm_info_data_t>.size / MemoryLayout<natural_t>.size)
+		let kr	  = withUnsafeMutablePointer(to: &info) { ptr in
+			ptr.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+				task_info(mach_task_self_, task_flavor_t(TASK_VM_INFO), $0, &count)
+			}
+		}
+		return kr == KERN_SUCCESS ? info.phys_footprint : 0
+	}
+	
+	/*
+	 *  Run the block while sampling the memory footprint, returning its result and the
+	 *  largest growth in footprint that was observed.
+	 */
+	func measurePeakFootprint<T>(_ block: () async throws -> T) async rethrows -> (result: T, peakBytes: UInt64) {
+		let baseline = physicalFootprint
+		let sampler  = Task.detached(priority: .high) { () -> UInt64 in
+			var peak: UInt64 = 0
+			while !Task.isCancelled {
+				peak = Swift.max(peak, self.physicalFootprint)
+				try? await Task.sleep(for: .milliseconds(5))
+			}
+			return peak
+		}
+		let ret = try await block()
+		sampler.cancel()
+		let peak = Swift.max(await sampler.value, physicalFootprint)
+		return (ret, peak > baseline ? peak - baseline : 0)
+	}
+	
+	/*
+	 *  Write an index file with the published columns and the requested number of generated rows.
+	 */
+	func writeSyntheticIndex(rows: Int, to url: URL) throws {
+		let sample = try String(contentsOf: testDataURLForFile("MetObjects-Small.csv"))
+		let header = String(sample.prefix(while: { !$0.isNewline }))
+		let cols   = header.components(separatedBy: ",")
+		
+		FileManager.default.createFile(atPath: url.path(percentEncoded: false), contents: nil)
+		let fh = try FileHandle(forWritingTo: url)
+		defer {
+			try? fh.close()
+		}
+		var text = header + "\r\n"
+		for i in 0..<rows {
+			var row: [String] = []
+			for oneCol in cols {
+				switch oneCol {
+				case "Object Number":		row.append("\(1900 + i % 120).\(i)")
+				case "Is Highlight":		row.append(i % 13 == 0 ? "True" : "False")
+				case "Is Timeline Work":	row.append(i % 17 == 0 ? "True" : "False")
+				case "Is Public Domain":	row.append(i % 5 == 0 ? "False" : "True")
+				case "Object ID":			row.append("\(i + 1)")
+				case "Department":			row.append("The American Wing")
+				case "AccessionYear":		row.append(i % 11 == 0 ? "" : "\(1870 + i % 150)")
+				case "Object Name":			row.append("Coin")
+				case "Title":				row.append("\"Sample object \(i), with a comma\"")
+				case "Artist Display Name":	row.append("Maker \(i % 500)")
+				case "Artist Display Bio":	row.append("\"American, Philadelphia 1794–1869\"")
+				case "Object Begin Date":	row.append("\(1600 + i % 300)")
+				case "Object End Date":		row.append("\(1650 + i % 300)")
+				case "Medium":				row.append("Gold")
+				case "Dimensions":			row.append(i % 3 == 0 ? "\"Diam. 1 in.\r\n(2.5 cm)\"" : "Dimensions unavailable")
+				case "Credit Line":			row.append("\"Gift of Heinz L. Stoppelmann, \(1900 + i % 100)\"")
+				case "Link Resource":		row.append("http://www.metmuseum.org/art/collection/search/\(i + 1)")
+				case "Repository":			row.append("\"Metropolitan Museum of Art, New York, NY\"")
+				case "Tags":				row.append("Men|Eagles")
+				default:					row.append("")
+				}
+			}
+			text += row.joined(separator: ",") + "\r\n"
+			
+			// ...flush periodically to keep the generated text small.
+			if text.utf8.count > 1024 * 1024 {
+				try fh.write(contentsOf: Data(text.utf8))
+				text = ""
+			}
+		}
+		try fh.write(contentsOf: Data(text.utf8))
+	}
+}
+
+/*
+ *  A local stand-in for the MetArt servers that answers every request after a delay.
+ */
+final class MMStandInProtocol : URLProtocol {
+	static let baseURL: URL = URL(string: "https://mm-stand-in.local/v1")!
+	static let session: URLSession = {
+		let cfg 						  = URLSessionConfiguration.ephemeral
+		cfg.protocolClasses 			  = [MMStandInProtocol.self]
+		cfg.httpMaximumConnectionsPerHost = 256
+		return URLSession(configuration: cfg)
+	}()
+	
+	/*
+	 *  Forget all prior requests.
+	 */
+	static func reset(latency: TimeInterval, responder: ((URL) -> Data)? = nil) {
+		sLock.lock()
+		defer { sLock.unlock() }
+		self.latency   = latency
+		self.responder = responder
+		self.counts	   = [:]
+		self.arrivals  = []
+		self.origin	   = Date()
+	}
+	
+	/*
+	 *  The number of times a URL was requested.
+	 */
+	static func requestCount(for url: URL) -> Int {
+		sLock.lock()
+		defer { sLock.unlock() }
+		return counts[url.path(percentEncoded: false)] ?? 0
+	}
+	
+	/*
+	 *  The seconds after the reset when each request arrived.
+	 */
+	static var arrivalTimes: [TimeInterval] {
+		sLock.lock()
+		defer { sLock.unlock() }
+		return arrivals
+	}
+	
+	/*
+	 *  The content returned for a URL when no responder was provided.
+	 */
+	static func body(for url: URL) -> Data {
+		return Data("stand-in:\(url.path(percentEncoded: false))".utf8)
+	}
+	
+	override class func canInit(with request: URLRequest) -> Bool {
+		return request.url?.host == baseURL.host
+	}
+	
+	override class func canonicalRequest(for request: URLRequest) -> URLRequest {
+		return request
+	}
+	
+	override func startLoading() {
+		guard let url = request.url else { return }
+		Self.sLock.lock()
+		Self.counts[url.path(percentEncoded: false), default: 0] += 1
+		Self.arrivals.append(Date().timeIntervalSince(Self.origin))
+		let latency   = Self.latency
+		let responder = Self.responder
+		Self.sLock.unlock()
+		
+		DispatchQueue.global().asyncAfter(deadline: .now() + latency) {
+			let resp = HTTPURLResponse(url: url, statusCode: 200, httpVersion: "HTTP/1.1", headerFields: nil)!
+			self.client?.urlProtocol(self, didReceive: resp, cacheStoragePolicy: .notAllowed)
+			self.client?.urlProtocol(self, didLoad: responder?(url) ?? Self.body(for: url))
+			self.client?.urlProtocolDidFinishLoading(self)
+		}
+	}
+	
+	override func stopLoading() {
+	}
+	
+	private static let sLock: NSLock				= .init()
+	private static var latency: TimeInterval		= 0
+	private static var responder: ((URL) -> Data)?
+	private static var counts: [String : Int]		= [:]
+	private static var arrivals: [TimeInterval]		= []
+	private static var origin: Date					= .init()
 }